@@ -56,6 +56,12 @@ class PlatformThread {
   static bool Create(size_t stack_size, Delegate* delegate,
                      PlatformThreadHandle* thread_handle);
 
+  // CreateNonJoinable() does the same thing as Create() except the thread
+  // cannot be Join()'d.  Therefore, it also does not output a
+  // PlatformThreadHandle.  The |delegate| must clean itself up, typically by
+  // deleting itself at the end of its ThreadMain method.
+  static bool CreateNonJoinable(size_t stack_size, Delegate* delegate);
+
   // Joins with a thread created via the Create function.  This function blocks
   // the caller until the designated thread exits.  This will invalidate
   // |thread_handle|.
@@ -81,6 +81,15 @@ bool PlatformThread::Create(size_t stack_size, Delegate* delegate,
   return *thread_handle != NULL;
 }
 
+// static
+bool PlatformThread::CreateNonJoinable(size_t stack_size, Delegate* delegate) {
+  PlatformThreadHandle thread_handle;
+  if (!Create(stack_size, delegate, &thread_handle))
+    return false;
+  CloseHandle(thread_handle);
+  return true;
+}
+
 // static
 void PlatformThread::Join(PlatformThreadHandle thread_handle) {
   DCHECK(thread_handle);
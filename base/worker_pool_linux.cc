@@ -0,0 +1,221 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/worker_pool.h"
+#include "base/worker_pool_linux.h"
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/platform_thread.h"
+#include "base/ref_counted.h"
+#include "base/string_util.h"
+#include "base/task.h"
+
+namespace {
+
+// Worker threads that have been idle for this long exit, so that a burst of
+// tasks does not leave a large number of threads behind forever.
+const int kIdleSecondsBeforeExit = 60;
+
+// Fast tasks are expected to finish quickly, so a small number of threads is
+// enough to keep their queue drained.
+const int kMaxFastThreads = 16;
+
+// Slow tasks (such as blocking host resolution) may tie up a thread for a long
+// time.  They get their own, larger lane so that they never starve fast tasks.
+const int kMaxSlowThreads = 64;
+
+class WorkerPoolImpl {
+ public:
+  WorkerPoolImpl();
+  ~WorkerPoolImpl();
+
+  void PostTask(const tracked_objects::Location& from_here, Task* task,
+                bool task_is_slow);
+
+ private:
+  scoped_refptr<base::LinuxDynamicThreadPool> fast_pool_;
+  scoped_refptr<base::LinuxDynamicThreadPool> slow_pool_;
+};
+
+WorkerPoolImpl::WorkerPoolImpl()
+    : fast_pool_(new base::LinuxDynamicThreadPool(
+          "WorkerPool", kIdleSecondsBeforeExit, kMaxFastThreads)),
+      slow_pool_(new base::LinuxDynamicThreadPool(
+          "WorkerPool/slow", kIdleSecondsBeforeExit, kMaxSlowThreads)) {
+}
+
+WorkerPoolImpl::~WorkerPoolImpl() {
+  fast_pool_->Terminate();
+  slow_pool_->Terminate();
+}
+
+void WorkerPoolImpl::PostTask(const tracked_objects::Location& from_here,
+                              Task* task, bool task_is_slow) {
+  task->SetBirthPlace(from_here);
+  if (task_is_slow)
+    slow_pool_->PostTask(task);
+  else
+    fast_pool_->PostTask(task);
+}
+
+base::LazyInstance<WorkerPoolImpl> g_lazy_worker_pool(base::LINKER_INITIALIZED);
+
+class WorkerThread : public PlatformThread::Delegate {
+ public:
+  explicit WorkerThread(base::LinuxDynamicThreadPool* pool)
+      : pool_(pool) {}
+
+  virtual void ThreadMain();
+
+ private:
+  scoped_refptr<base::LinuxDynamicThreadPool> pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerThread);
+};
+
+void WorkerThread::ThreadMain() {
+  const std::string name = StringPrintf("%s/%d",
+                                        pool_->name_prefix().c_str(),
+                                        PlatformThread::CurrentId());
+  PlatformThread::SetName(name.c_str());
+
+  for (;;) {
+    Task* task = pool_->WaitForTask();
+    if (!task)
+      break;
+    task->Run();
+    delete task;
+  }
+
+  // The WorkerThread is non-joinable, so it deletes itself.
+  delete this;
+}
+
+}  // namespace
+
+bool WorkerPool::PostTask(const tracked_objects::Location& from_here,
+                          Task* task, bool task_is_slow) {
+  g_lazy_worker_pool.Pointer()->PostTask(from_here, task, task_is_slow);
+  return true;
+}
+
+namespace base {
+
+LinuxDynamicThreadPool::LinuxDynamicThreadPool(
+    const std::string& name_prefix,
+    int idle_seconds_before_exit,
+    int max_threads)
+    : name_prefix_(name_prefix),
+      idle_time_before_exit_(TimeDelta::FromSeconds(idle_seconds_before_exit)),
+      max_threads_(max_threads),
+      tasks_available_cv_(&lock_),
+      num_threads_(0),
+      num_idle_threads_(0),
+      num_threads_created_(0),
+      terminated_(false) {
+  DCHECK_GT(max_threads, 0);
+}
+
+LinuxDynamicThreadPool::~LinuxDynamicThreadPool() {
+  while (!tasks_.empty()) {
+    Task* task = tasks_.front();
+    tasks_.pop();
+    delete task;
+  }
+}
+
+void LinuxDynamicThreadPool::Terminate() {
+  {
+    AutoLock locked(lock_);
+    DCHECK(!terminated_) << "Thread pool is already terminated.";
+    terminated_ = true;
+  }
+  tasks_available_cv_.Broadcast();
+}
+
+void LinuxDynamicThreadPool::PostTask(Task* task) {
+  bool start_thread = false;
+  {
+    AutoLock locked(lock_);
+    if (terminated_) {
+      DLOG(WARNING) << "Dropping task posted to terminated thread pool "
+                    << name_prefix_;
+      // Delete outside of the lock below.
+    } else {
+      tasks_.push(task);
+      task = NULL;
+      // Idle threads which have already been signaled still count as idle
+      // until they wake up, so only wake another one if there are more queued
+      // tasks than idle threads to take them.  Otherwise grow the pool, or
+      // leave the task queued for the next busy thread to pick up.
+      if (static_cast<int>(tasks_.size()) <= num_idle_threads_) {
+        tasks_available_cv_.Signal();
+      } else if (num_threads_ < max_threads_) {
+        num_threads_++;
+        num_threads_created_++;
+        start_thread = true;
+      }
+    }
+  }
+
+  if (task) {
+    delete task;
+    return;
+  }
+
+  if (start_thread) {
+    WorkerThread* worker = new WorkerThread(this);
+    if (!PlatformThread::CreateNonJoinable(0, worker)) {
+      // The task stays queued and is picked up by the next worker thread.
+      DLOG(ERROR) << "Failed to start worker thread for " << name_prefix_;
+      delete worker;
+      AutoLock locked(lock_);
+      num_threads_--;
+    }
+  }
+}
+
+Task* LinuxDynamicThreadPool::WaitForTask() {
+  AutoLock locked(lock_);
+
+  if (tasks_.empty() && !terminated_) {
+    const TimeTicks deadline = TimeTicks::Now() + idle_time_before_exit_;
+    num_idle_threads_++;
+    while (tasks_.empty() && !terminated_) {
+      TimeDelta remaining = deadline - TimeTicks::Now();
+      if (remaining <= TimeDelta())
+        break;
+      tasks_available_cv_.TimedWait(remaining);
+    }
+    num_idle_threads_--;
+  }
+
+  if (terminated_ || tasks_.empty()) {
+    // The calling thread is going to exit.
+    num_threads_--;
+    return NULL;
+  }
+
+  Task* task = tasks_.front();
+  tasks_.pop();
+  return task;
+}
+
+int LinuxDynamicThreadPool::num_threads() const {
+  AutoLock locked(lock_);
+  return num_threads_;
+}
+
+int LinuxDynamicThreadPool::num_idle_threads() const {
+  AutoLock locked(lock_);
+  return num_idle_threads_;
+}
+
+int LinuxDynamicThreadPool::num_threads_created() const {
+  AutoLock locked(lock_);
+  return num_threads_created_;
+}
+
+}  // namespace base
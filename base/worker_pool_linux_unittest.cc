@@ -0,0 +1,153 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/worker_pool_linux.h"
+
+#include "base/lock.h"
+#include "base/platform_thread.h"
+#include "base/ref_counted.h"
+#include "base/task.h"
+#include "base/waitable_event.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Signals |started| when it begins running, then blocks until |unblock| is
+// signaled before bumping |*counter|.
+class BlockingTask : public Task {
+ public:
+  BlockingTask(WaitableEvent* started, WaitableEvent* unblock,
+               Lock* counter_lock, int* counter)
+      : started_(started),
+        unblock_(unblock),
+        counter_lock_(counter_lock),
+        counter_(counter) {
+  }
+
+  virtual void Run() {
+    if (started_)
+      started_->Signal();
+    if (unblock_)
+      unblock_->Wait();
+    AutoLock locked(*counter_lock_);
+    (*counter_)++;
+  }
+
+ private:
+  WaitableEvent* started_;
+  WaitableEvent* unblock_;
+  Lock* counter_lock_;
+  int* counter_;
+};
+
+class LinuxDynamicThreadPoolTest : public testing::Test {
+ protected:
+  LinuxDynamicThreadPoolTest()
+      : unblock_(true, false),
+        counter_(0) {
+  }
+
+  virtual void SetUp() {
+    pool_ = new LinuxDynamicThreadPool("dynamic_pool", 60 * 60, 2);
+  }
+
+  virtual void TearDown() {
+    pool_->Terminate();
+  }
+
+  int counter() {
+    AutoLock locked(counter_lock_);
+    return counter_;
+  }
+
+  // Spins until |count| tasks have completed or a timeout expires.
+  void WaitForCount(int count) {
+    for (int i = 0; i < 1000 && counter() < count; ++i)
+      PlatformThread::Sleep(5);
+  }
+
+  // Spins until the pool has |count| idle threads or a timeout expires.
+  void WaitForIdleThreads(int count) {
+    for (int i = 0; i < 1000 && pool_->num_idle_threads() < count; ++i)
+      PlatformThread::Sleep(5);
+  }
+
+  Task* CreateNewBlockingTask(WaitableEvent* started) {
+    return new BlockingTask(started, &unblock_, &counter_lock_, &counter_);
+  }
+
+  Task* CreateNewTask() {
+    return new BlockingTask(NULL, NULL, &counter_lock_, &counter_);
+  }
+
+  scoped_refptr<LinuxDynamicThreadPool> pool_;
+  WaitableEvent unblock_;
+  Lock counter_lock_;
+  int counter_;
+};
+
+}  // namespace
+
+TEST_F(LinuxDynamicThreadPoolTest, Basic) {
+  EXPECT_EQ(0, pool_->num_threads());
+
+  pool_->PostTask(CreateNewTask());
+  WaitForCount(1);
+  EXPECT_EQ(1, counter());
+  EXPECT_EQ(1, pool_->num_threads_created());
+}
+
+TEST_F(LinuxDynamicThreadPoolTest, ReuseIdle) {
+  pool_->PostTask(CreateNewTask());
+  WaitForCount(1);
+  WaitForIdleThreads(1);
+  EXPECT_EQ(1, pool_->num_idle_threads());
+
+  // The idle thread picks up the next task instead of a new thread starting.
+  pool_->PostTask(CreateNewTask());
+  WaitForCount(2);
+  EXPECT_EQ(2, counter());
+  EXPECT_EQ(1, pool_->num_threads_created());
+}
+
+TEST_F(LinuxDynamicThreadPoolTest, BoundedThreads) {
+  WaitableEvent started1(false, false);
+  WaitableEvent started2(false, false);
+  pool_->PostTask(CreateNewBlockingTask(&started1));
+  pool_->PostTask(CreateNewBlockingTask(&started2));
+  started1.Wait();
+  started2.Wait();
+
+  // Both threads are busy and the pool is at its limit, so these queue up.
+  for (int i = 0; i < 8; ++i)
+    pool_->PostTask(CreateNewTask());
+  EXPECT_EQ(2, pool_->num_threads());
+  EXPECT_EQ(0, counter());
+
+  unblock_.Signal();
+  WaitForCount(10);
+  EXPECT_EQ(10, counter());
+  EXPECT_EQ(2, pool_->num_threads_created());
+}
+
+TEST_F(LinuxDynamicThreadPoolTest, IdleThreadsExit) {
+  scoped_refptr<LinuxDynamicThreadPool> pool(
+      new LinuxDynamicThreadPool("exiting_pool", 0, 2));
+  pool->PostTask(CreateNewTask());
+  WaitForCount(1);
+  for (int i = 0; i < 1000 && pool->num_threads() > 0; ++i)
+    PlatformThread::Sleep(5);
+  EXPECT_EQ(0, pool->num_threads());
+
+  // A new thread is started for work posted after the old one exited.
+  pool->PostTask(CreateNewTask());
+  WaitForCount(2);
+  EXPECT_EQ(2, counter());
+  EXPECT_EQ(2, pool->num_threads_created());
+  pool->Terminate();
+}
+
+}  // namespace base
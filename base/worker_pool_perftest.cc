@@ -0,0 +1,99 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/atomicops.h"
+#include "base/perftimer.h"
+#include "base/platform_thread.h"
+#include "base/task.h"
+#include "base/waitable_event.h"
+#include "base/worker_pool.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using base::WaitableEvent;
+
+namespace {
+
+class WorkerPoolPerfTest : public testing::Test { };
+
+const int kNumTasks = 10000;
+
+// Counts down |*remaining| and signals |done| when the last task has run.
+class CountdownTask : public Task {
+ public:
+  CountdownTask(base::subtle::Atomic32* remaining, WaitableEvent* done)
+      : remaining_(remaining), done_(done) {
+  }
+
+  virtual void Run() {
+    if (base::subtle::Barrier_AtomicIncrement(remaining_, -1) == 0)
+      done_->Signal();
+  }
+
+ private:
+  base::subtle::Atomic32* remaining_;
+  WaitableEvent* done_;
+};
+
+// Runs a single task on a thread of its own and then goes away.  This is what
+// WorkerPool used to do on Linux for every posted task.
+class ThreadPerTask : public PlatformThread::Delegate {
+ public:
+  explicit ThreadPerTask(Task* task) : task_(task) {}
+
+  virtual void ThreadMain() {
+    task_->Run();
+    delete task_;
+    delete this;
+  }
+
+ private:
+  Task* task_;
+};
+
+void LogTasksPerSecond(const char* test_name, const PerfTimer& timer) {
+  double seconds = timer.Elapsed().InMillisecondsF() / 1000;
+  LogPerfResult(test_name, kNumTasks / seconds, "tasks/s");
+}
+
+}  // namespace
+
+TEST_F(WorkerPoolPerfTest, ThreadPerTask) {
+  base::subtle::Atomic32 remaining = kNumTasks;
+  WaitableEvent done(false, false);
+
+  PerfTimer timer;
+  for (int i = 0; i < kNumTasks; ++i) {
+    ThreadPerTask* thread =
+        new ThreadPerTask(new CountdownTask(&remaining, &done));
+    ASSERT_TRUE(PlatformThread::CreateNonJoinable(0, thread));
+  }
+  done.Wait();
+  LogTasksPerSecond("WorkerPool_thread_per_task", timer);
+}
+
+TEST_F(WorkerPoolPerfTest, PostTask) {
+  base::subtle::Atomic32 remaining = kNumTasks;
+  WaitableEvent done(false, false);
+
+  PerfTimer timer;
+  for (int i = 0; i < kNumTasks; ++i) {
+    EXPECT_TRUE(WorkerPool::PostTask(
+        FROM_HERE, new CountdownTask(&remaining, &done), false));
+  }
+  done.Wait();
+  LogTasksPerSecond("WorkerPool_post_task", timer);
+}
+
+TEST_F(WorkerPoolPerfTest, PostSlowTask) {
+  base::subtle::Atomic32 remaining = kNumTasks;
+  WaitableEvent done(false, false);
+
+  PerfTimer timer;
+  for (int i = 0; i < kNumTasks; ++i) {
+    EXPECT_TRUE(WorkerPool::PostTask(
+        FROM_HERE, new CountdownTask(&remaining, &done), true));
+  }
+  done.Wait();
+  LogTasksPerSecond("WorkerPool_post_slow_task", timer);
+}
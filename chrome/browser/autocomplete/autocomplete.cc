@@ -6,6 +6,7 @@
 
 #include "chrome/browser/autocomplete/autocomplete.h"
 
+#include "base/histogram.h"
 #include "base/string_util.h"
 #include "chrome/browser/autocomplete/history_url_provider.h"
 #include "chrome/browser/autocomplete/history_contents_provider.h"
@@ -516,6 +517,8 @@ void AutocompleteResult::Validate() const {
 
 const int AutocompleteController::kNoItemSelected = -1;
 
+const int AutocompleteController::kQueryDeadlineMs = 1500;
+
 namespace {
 // The amount of time we'll wait after a provider returns before updating,
 // in order to coalesce results.
@@ -524,11 +527,36 @@ const int kResultCoalesceMs = 100;
 // The maximum time we'll allow the results to go without updating to the
 // latest set.
 const int kResultUpdateMaxDelayMs = 300;
+
+// Adds |time| to the histogram of how long the provider named |provider_name|
+// takes, either in its synchronous pass or to finish.  There is one histogram
+// per provider name; like the ones the HISTOGRAM macros create, they are
+// never deleted.
+void RecordProviderTime(const char* provider_name,
+                        bool synchronous,
+                        TimeDelta time) {
+  typedef std::map<std::string, Histogram*> ProviderHistograms;
+  static ProviderHistograms histograms[2];
+  ProviderHistograms& provider_histograms = histograms[synchronous ? 0 : 1];
+  ProviderHistograms::iterator i = provider_histograms.find(provider_name);
+  if (i == provider_histograms.end()) {
+    std::wstring name(synchronous ? L"Autocomplete.SyncPassTime." :
+                                    L"Autocomplete.FinishTime.");
+    name.append(ASCIIToWide(provider_name));
+    Histogram* histogram = new Histogram(name.c_str(),
+        TimeDelta::FromMilliseconds(1), TimeDelta::FromSeconds(10), 50);
+    histogram->SetFlags(kUmaTargetedHistogramFlag);
+    i = provider_histograms.insert(
+        std::make_pair(std::string(provider_name), histogram)).first;
+  }
+  i->second->AddTime(time);
+}
 };
 
 AutocompleteController::AutocompleteController(Profile* profile)
     : update_pending_(false),
-      done_(true) {
+      done_(true),
+      query_deadline_(TimeDelta::FromMilliseconds(kQueryDeadlineMs)) {
   providers_.push_back(new SearchProvider(this, profile));
   providers_.push_back(new HistoryURLProvider(this, profile));
   providers_.push_back(new KeywordProvider(this, profile));
@@ -536,6 +564,7 @@ AutocompleteController::AutocompleteController(Profile* profile)
   providers_.push_back(history_contents_provider_);
   for (ACProviders::iterator i(providers_.begin()); i != providers_.end(); ++i)
     (*i)->AddRef();
+  provider_running_.resize(providers_.size(), false);
 }
 
 AutocompleteController::~AutocompleteController() {
@@ -566,20 +595,40 @@ void AutocompleteController::Start(const std::wstring& text,
   input_ = AutocompleteInput(text, desired_tld, prevent_inline_autocomplete,
                              prefer_keyword, synchronous_only);
 
-  // If we're starting a brand new query, stop caring about any old query.
+  // If we're starting a brand new query, stop caring about any old query, and
+  // stop the providers working on it before any of them starts on the new
+  // one, so that work queued for the old text is dropped as soon as possible.
   if (!minimal_changes && !done_) {
     update_pending_ = false;
     coalesce_timer_.Stop();
+    for (ACProviders::iterator i(providers_.begin()); i != providers_.end();
+         ++i) {
+      if (!(*i)->done())
+        (*i)->Stop();
+    }
   }
 
   // Start the new query.
-  for (ACProviders::iterator i(providers_.begin()); i != providers_.end();
-       ++i) {
-    (*i)->Start(input_, minimal_changes);
+  query_start_time_ = TimeTicks::Now();
+  for (size_t i = 0; i < providers_.size(); ++i) {
+    AutocompleteProvider* provider = providers_[i];
+    const TimeTicks provider_start_time = TimeTicks::Now();
+    provider->Start(input_, minimal_changes);
+    RecordProviderTime(provider->name(), true,
+                       TimeTicks::Now() - provider_start_time);
+    provider_running_[i] = !provider->done();
     if (synchronous_only)
-      DCHECK((*i)->done());
+      DCHECK(provider->done());
   }
+  UMA_HISTOGRAM_TIMES(L"Autocomplete.SyncPassTime",
+                      TimeTicks::Now() - query_start_time_);
+
+  deadline_timer_.Stop();
   UpdateLatestResult(true);
+  if (!done_) {
+    deadline_timer_.Start(query_deadline_, this,
+                          &AutocompleteController::OnQueryDeadline);
+  }
 }
 
 void AutocompleteController::Stop(bool clear_result) {
@@ -597,6 +646,8 @@ void AutocompleteController::Stop(bool clear_result) {
                                      // internal state consistent.
   coalesce_timer_.Stop();
   max_delay_timer_.Stop();
+  deadline_timer_.Stop();
+  provider_running_.assign(providers_.size(), false);
 }
 
 void AutocompleteController::DeleteMatch(const AutocompleteMatch& match) {
@@ -613,6 +664,8 @@ void AutocompleteController::DeleteMatch(const AutocompleteMatch& match) {
 void AutocompleteController::OnProviderUpdate(bool updated_matches) {
   DCHECK(!input_.synchronous_only());
 
+  RecordFinishedProviders();
+
   if (updated_matches) {
     UpdateLatestResult(false);
     return;
@@ -684,10 +737,12 @@ void AutocompleteController::CommitResult() {
   // timer should always just be stopped.
   update_pending_ = false;
   coalesce_timer_.Stop();
-  if (done_)
+  if (done_) {
     max_delay_timer_.Stop();
-  else
+    deadline_timer_.Stop();
+  } else {
     max_delay_timer_.Reset();
+  }
 
   result_.CopyFrom(latest_result_);
   NotificationService::current()->Notify(
@@ -695,6 +750,33 @@ void AutocompleteController::CommitResult() {
       Source<AutocompleteController>(this), NotificationService::NoDetails());
 }
 
+void AutocompleteController::RecordFinishedProviders() {
+  for (size_t i = 0; i < providers_.size(); ++i) {
+    if (provider_running_[i] && providers_[i]->done()) {
+      provider_running_[i] = false;
+      RecordProviderTime(providers_[i]->name(), false,
+                         TimeTicks::Now() - query_start_time_);
+    }
+  }
+}
+
+void AutocompleteController::OnQueryDeadline() {
+  int missed_deadline_count = 0;
+  for (size_t i = 0; i < providers_.size(); ++i) {
+    if (!providers_[i]->done()) {
+      providers_[i]->Stop();
+      ++missed_deadline_count;
+    }
+  }
+  provider_running_.assign(providers_.size(), false);
+  UMA_HISTOGRAM_COUNTS_100(L"Autocomplete.ProvidersPastDeadline",
+                           missed_deadline_count);
+
+  // Stopping providers can't change their matches, but it does mean the query
+  // is done.
+  UpdateLatestResult(false);
+}
+
 size_t AutocompleteController::CountMatchesNotInLatestResult(
     const AutocompleteProvider* provider,
     AutocompleteMatch* first_match) const {
@@ -657,17 +657,28 @@ class AutocompleteController : public ACProviderListener {
   // and for merging results.
   static const int kNoItemSelected;
 
+  // How long the providers have to finish a query, counted from the Start()
+  // call.  Providers still running then are stopped, and the query finishes
+  // with the matches that are in.
+  static const int kQueryDeadlineMs;
+
   // Normally, you will call the first constructor.  Unit tests can use the
   // second to set the providers to some known testing providers.  The default
   // providers will be overridden and the controller will take ownership of the
   // providers, Release()ing them on destruction.
   explicit AutocompleteController(Profile* profile);
-#ifdef UNIT_TEST
+#if defined(UNIT_TEST) || defined(PERF_TEST)
   explicit AutocompleteController(const ACProviders& providers)
       : providers_(providers),
+        provider_running_(providers.size(), false),
         history_contents_provider_(NULL),
         update_pending_(false),
-        done_(true) {
+        done_(true),
+        query_deadline_(TimeDelta::FromMilliseconds(kQueryDeadlineMs)) {
+  }
+
+  void set_query_deadline(TimeDelta query_deadline) {
+    query_deadline_ = query_deadline;
   }
 #endif
   ~AutocompleteController();
@@ -694,6 +705,10 @@ class AutocompleteController : public ACProviderListener {
   // return results which are synchronously available, which should mean that
   // all providers will be done immediately.
   //
+  // If this replaces a query with different text, the providers still running
+  // the old query are stopped before any of them start the new one, so work
+  // for keystrokes the user has typed past is canceled as early as possible.
+  //
   // The controller will fire
   // NOTIFY_AUTOCOMPLETE_CONTROLLER_SYNCHRONOUS_RESULTS_AVAILABLE from inside
   // this call, and unless the query is stopped, will fire at least one (and
@@ -735,6 +750,14 @@ class AutocompleteController : public ACProviderListener {
   // Copies |latest_result_| to |result_| and notifies observers of updates.
   void CommitResult();
 
+  // Records how long after Start() each provider that has finished since the
+  // last call took to finish.
+  void RecordFinishedProviders();
+
+  // Called by |deadline_timer_|; stops the providers that are still running
+  // and commits the matches we have.
+  void OnQueryDeadline();
+
   // Returns the number of matches from provider whose destination urls are
   // not in |latest_result_|. first_match is set to the first match whose
   // destination url is NOT in the results.
@@ -749,6 +772,10 @@ class AutocompleteController : public ACProviderListener {
   // A list of all providers.
   ACProviders providers_;
 
+  // Whether each of |providers_| has asynchronous work outstanding for the
+  // current query whose completion time has not yet been recorded.
+  std::vector<bool> provider_running_;
+
   HistoryContentsProvider* history_contents_provider_;
 
   // Input passed to Start.
@@ -781,6 +808,15 @@ class AutocompleteController : public ACProviderListener {
   // responsively even when the user types continuously.
   base::RepeatingTimer<AutocompleteController> max_delay_timer_;
 
+  // When the current query was started.
+  TimeTicks query_start_time_;
+
+  // How long the providers have to finish a query; see kQueryDeadlineMs.
+  TimeDelta query_deadline_;
+
+  // Fires when the current query's deadline has passed.
+  base::OneShotTimer<AutocompleteController> deadline_timer_;
+
   DISALLOW_EVIL_CONSTRUCTORS(AutocompleteController);
 };
 
@@ -0,0 +1,204 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/compiler_specific.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "base/string_util.h"
+#include "base/time.h"
+#include "chrome/browser/autocomplete/autocomplete.h"
+#include "chrome/common/notification_registrar.h"
+#include "chrome/common/notification_service.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+// What the user types, one keystroke at a time.
+const wchar_t kTypedText[] = L"www.example.com/autocomplete";
+
+// How far apart the keystrokes are; a fast typist.
+const int kKeystrokeIntervalMs = 30;
+
+// Autocomplete provider that spends |sync_cost_ms| in its synchronous pass
+// and adds the rest of its matches |async_delay_ms| later, the way the
+// history and search providers wait on the history thread and the network.
+class SlowProvider : public AutocompleteProvider {
+ public:
+  SlowProvider(const char* name, int relevance, int sync_cost_ms,
+               int async_delay_ms)
+      : AutocompleteProvider(NULL, NULL, name),
+        relevance_(relevance),
+        sync_cost_(TimeDelta::FromMilliseconds(sync_cost_ms)),
+        async_delay_ms_(async_delay_ms),
+        query_id_(0),
+        stop_count_(0) {
+  }
+
+  virtual void Start(const AutocompleteInput& input,
+                     bool minimal_changes) {
+    // Any Run() still pending is for a previous query.
+    ++query_id_;
+
+    TimeTicks end_time = TimeTicks::Now() + sync_cost_;
+    while (TimeTicks::Now() < end_time) {
+    }
+
+    matches_.clear();
+    AddMatch(input.text(), 0);
+    if (input.synchronous_only())
+      return;
+
+    done_ = false;
+    MessageLoop::current()->PostDelayedTask(FROM_HERE, NewRunnableMethod(
+        this, &SlowProvider::Run, query_id_, input.text()), async_delay_ms_);
+  }
+
+  virtual void Stop() {
+    if (!done_)
+      ++stop_count_;
+    ++query_id_;
+    AutocompleteProvider::Stop();
+  }
+
+  void set_listener(ACProviderListener* listener) {
+    listener_ = listener;
+  }
+
+  // The number of times a query was stopped before it was done.
+  int stop_count() const { return stop_count_; }
+
+ private:
+  void Run(int query_id, const std::wstring& text) {
+    if (query_id != query_id_)
+      return;
+    AddMatch(text, 1);
+    AddMatch(text, 2);
+    done_ = true;
+    listener_->OnProviderUpdate(true);
+  }
+
+  void AddMatch(const std::wstring& text, int i) {
+    AutocompleteMatch match(this, relevance_ - i, false);
+    match.fill_into_edit = text + IntToWString(relevance_ + i);
+    match.destination_url = match.fill_into_edit;
+    match.contents = match.destination_url;
+    match.contents_class.push_back(
+        ACMatchClassification(0, ACMatchClassification::NONE));
+    match.description = match.destination_url;
+    match.description_class.push_back(
+        ACMatchClassification(0, ACMatchClassification::NONE));
+    matches_.push_back(match);
+  }
+
+  int relevance_;
+  TimeDelta sync_cost_;
+  int async_delay_ms_;
+  int query_id_;
+  int stop_count_;
+};
+
+// Types kTypedText into the controller, one keystroke every
+// kKeystrokeIntervalMs, and quits the message loop once the query for the
+// whole text is done.
+class Typist : public NotificationObserver {
+ public:
+  explicit Typist(AutocompleteController* controller)
+      : controller_(controller),
+        typed_length_(0),
+        keystroke_count_(0),
+        ALLOW_THIS_IN_INITIALIZER_LIST(timer_factory_(this)) {
+    registrar_.Add(this, NOTIFY_AUTOCOMPLETE_CONTROLLER_RESULT_UPDATED,
+                   NotificationService::AllSources());
+  }
+
+  // Types the first keystroke once the message loop runs.
+  void Start() {
+    MessageLoop::current()->PostTask(FROM_HERE,
+        timer_factory_.NewRunnableMethod(&Typist::TypeNextKeystroke));
+  }
+
+  // NotificationObserver
+  virtual void Observe(NotificationType type,
+                       const NotificationSource& source,
+                       const NotificationDetails& details) {
+    if (typed_length_ == wcslen(kTypedText) && controller_->done()) {
+      time_to_done_ = TimeTicks::Now() - last_keystroke_time_;
+      MessageLoop::current()->Quit();
+    }
+  }
+
+  int keystroke_count() const { return keystroke_count_; }
+  TimeDelta sync_time() const { return sync_time_; }
+  TimeDelta time_to_done() const { return time_to_done_; }
+
+ private:
+  void TypeNextKeystroke() {
+    std::wstring text(kTypedText);
+    ++typed_length_;
+    ++keystroke_count_;
+    PerfTimer sync_timer;
+    controller_->Start(text.substr(0, typed_length_), std::wstring(), true,
+                       false, false);
+    sync_time_ += sync_timer.Elapsed();
+    if (typed_length_ < text.size()) {
+      MessageLoop::current()->PostDelayedTask(FROM_HERE,
+          timer_factory_.NewRunnableMethod(&Typist::TypeNextKeystroke),
+          kKeystrokeIntervalMs);
+    } else {
+      last_keystroke_time_ = TimeTicks::Now();
+    }
+  }
+
+  AutocompleteController* controller_;
+  size_t typed_length_;
+  int keystroke_count_;
+  TimeDelta sync_time_;
+  TimeTicks last_keystroke_time_;
+  TimeDelta time_to_done_;
+  NotificationRegistrar registrar_;
+  ScopedRunnableMethodFactory<Typist> timer_factory_;
+};
+
+}  // namespace
+
+// Types a URL with providers whose asynchronous work takes longer than the
+// gap between keystrokes, the common case for the history and search
+// providers, and logs how long the synchronous passes take, how soon the
+// final query is done, and how many superseded queries were stopped.
+TEST(AutocompletePerfTest, TypedQuery) {
+  NotificationService notification_service;
+
+  SlowProvider* fast = new SlowProvider("Fast", 1300, 0, 5);
+  SlowProvider* history = new SlowProvider("History", 1200, 2, 80);
+  SlowProvider* search = new SlowProvider("Search", 1100, 0, 150);
+  ACProviders providers;
+  providers.push_back(fast);
+  providers.push_back(history);
+  providers.push_back(search);
+  for (size_t i = 0; i < providers.size(); ++i)
+    providers[i]->AddRef();
+
+  AutocompleteController controller(providers);
+  fast->set_listener(&controller);
+  history->set_listener(&controller);
+  search->set_listener(&controller);
+
+  Typist typist(&controller);
+  typist.Start();
+  MessageLoop::current()->Run();
+
+  ASSERT_TRUE(controller.done());
+  LogPerfResult("Autocomplete_sync_pass_keystroke",
+                typist.sync_time().InMillisecondsF() /
+                    typist.keystroke_count(),
+                "ms");
+  LogPerfResult("Autocomplete_last_keystroke_to_done",
+                typist.time_to_done().InMillisecondsF(), "ms");
+  LogPerfResult("Autocomplete_superseded_queries_stopped",
+                fast->stop_count() + history->stop_count() +
+                    search->stop_count(),
+                "queries");
+}
@@ -87,6 +87,31 @@ void TestProvider::AddResults(int start_at, int num) {
   }
 }
 
+// Autocomplete provider whose asynchronous work never finishes unless it is
+// stopped.
+class HangingProvider : public AutocompleteProvider {
+ public:
+  HangingProvider()
+      : AutocompleteProvider(NULL, NULL, "Hanging"),
+        stop_count_(0) {
+  }
+
+  virtual void Start(const AutocompleteInput& input,
+                     bool minimal_changes) {
+    done_ = input.synchronous_only();
+  }
+
+  virtual void Stop() {
+    ++stop_count_;
+    AutocompleteProvider::Stop();
+  }
+
+  int stop_count() const { return stop_count_; }
+
+ private:
+  int stop_count_;
+};
+
 class AutocompleteProviderTest : public testing::Test,
                                  public NotificationObserver {
  protected:
@@ -95,6 +120,10 @@ class AutocompleteProviderTest : public testing::Test,
 
   void ResetController(bool same_destinations);
 
+  // Resets the controller with the usual two providers and a
+  // HangingProvider, which is returned.
+  HangingProvider* ResetControllerWithHangingProvider();
+
   // Runs a query on the input "a", and makes sure both providers' input is
   // properly collected.
   void RunTest();
@@ -104,6 +133,8 @@ class AutocompleteProviderTest : public testing::Test,
 
   AutocompleteResult result_;
 
+  scoped_ptr<AutocompleteController> controller_;
+
  private:
   // NotificationObserver
   virtual void Observe(NotificationType type,
@@ -111,7 +142,6 @@ class AutocompleteProviderTest : public testing::Test,
                        const NotificationDetails& details);
 
   MessageLoopForUI message_loop_;
-  scoped_ptr<AutocompleteController> controller_;
   NotificationRegistrar registrar_;
 };
 
@@ -146,6 +176,22 @@ void AutocompleteProviderTest::ResetController(bool same_destinations) {
   providerB->set_listener(controller);
 }
 
+HangingProvider* AutocompleteProviderTest::ResetControllerWithHangingProvider() {
+  ResetController(false);
+  HangingProvider* hanging_provider = new HangingProvider;
+  hanging_provider->AddRef();
+  providers_.push_back(hanging_provider);
+  AutocompleteController* controller = new AutocompleteController(providers_);
+  // The old controller Release()s the providers, so they need another
+  // reference for the new one.
+  for (size_t i = 0; i < providers_.size() - 1; ++i) {
+    providers_[i]->AddRef();
+    static_cast<TestProvider*>(providers_[i])->set_listener(controller);
+  }
+  controller_.reset(controller);
+  return hanging_provider;
+}
+
 void AutocompleteProviderTest::RunTest() {
   result_.Reset();
   controller_->Start(L"a", std::wstring(), true, false, false);
@@ -200,6 +246,42 @@ TEST_F(AutocompleteProviderTest, RemoveDuplicates) {
   ResetController(false);
 }
 
+// A provider that doesn't finish by the deadline is stopped, and the query
+// completes with the matches of the others.
+TEST_F(AutocompleteProviderTest, QueryDeadline) {
+  HangingProvider* hanging_provider = ResetControllerWithHangingProvider();
+  controller_->set_query_deadline(TimeDelta::FromMilliseconds(10));
+
+  RunTest();
+
+  EXPECT_EQ(1, hanging_provider->stop_count());
+  EXPECT_EQ(num_results_per_provider * 2, result_.size());
+
+  ResetController(false);
+}
+
+// Starting a query for new text stops the providers still working on the
+// previous one before starting any of them on the new text.
+TEST_F(AutocompleteProviderTest, StopsSupersededQuery) {
+  HangingProvider* hanging_provider = ResetControllerWithHangingProvider();
+
+  controller_->Start(L"a", std::wstring(), true, false, false);
+  EXPECT_EQ(0, hanging_provider->stop_count());
+  EXPECT_FALSE(controller_->done());
+
+  // The same text again lets the running query continue.
+  controller_->Start(L"a", std::wstring(), false, false, false);
+  EXPECT_EQ(0, hanging_provider->stop_count());
+
+  controller_->Start(L"ab", std::wstring(), true, false, false);
+  EXPECT_EQ(1, hanging_provider->stop_count());
+
+  controller_->Stop(true);
+  EXPECT_EQ(2, hanging_provider->stop_count());
+
+  ResetController(false);
+}
+
 TEST(AutocompleteTest, InputType) {
   struct test_data {
     const wchar_t* input;
@@ -12,6 +12,7 @@
 #include "chrome/browser/history/history.h"
 #include "chrome/browser/history/history_backend.h"
 #include "chrome/browser/history/history_database.h"
+#include "chrome/browser/history/in_memory_url_index.h"
 #include "chrome/browser/profile.h"
 #include "chrome/browser/url_fixer_upper.h"
 #include "chrome/common/gfx/url_elider.h"
@@ -125,7 +126,7 @@ void HistoryURLProvider::ExecuteWithDB(history::HistoryBackend* backend,
 // Used by both autocomplete passes, and therefore called on multiple different
 // threads (though not simultaneously).
 void HistoryURLProvider::DoAutocomplete(history::HistoryBackend* backend,
-                                        history::URLDatabase* db,
+                                        history::URLAutocompleteSource* db,
                                         HistoryURLProviderParams* params) {
   // Get the matching URLs from the DB
   typedef std::vector<history::URLRow> URLRowVector;
@@ -177,9 +178,31 @@ void HistoryURLProvider::DoAutocomplete(history::HistoryBackend* backend,
   if (!backend)
     return;
 
+  // Looking up redirects takes a query per match, so don't bother if the user
+  // has typed past this input in the meantime.
+  if (params->cancel)
+    return;
+
   // Remove redirects and trim list to size.
   CullRedirects(backend, &history_matches, max_matches() + exact_suggestion);
 
+  // Fill any remaining space with URLs whose titles matched the input.
+  HistoryMatches title_matches;
+  for (URLRowVector::const_iterator i(params->title_matches.begin());
+       i != params->title_matches.end(); ++i)
+    title_matches.push_back(HistoryMatch(*i, std::wstring::npos, false, false));
+  CullPoorMatches(&title_matches);
+  for (HistoryMatches::const_iterator i(title_matches.begin());
+       (i != title_matches.end()) &&
+       (history_matches.size() < max_matches() + exact_suggestion); ++i) {
+    const GURL& url = i->url_info.url();
+    if ((std::find(history_matches.begin(), history_matches.end(), url) ==
+         history_matches.end()) &&
+        (!exact_suggestion ||
+         (url != GURL(params->matches.front().destination_url))))
+      history_matches.push_back(*i);
+  }
+
   // Convert the history matches to autocomplete matches.
   for (size_t i = first_match; i < history_matches.size(); ++i) {
     const HistoryMatch& match = history_matches[i];
@@ -255,9 +278,10 @@ void HistoryURLProvider::SuggestExactInput(const AutocompleteInput& input,
   matches_.push_back(match);
 }
 
-bool HistoryURLProvider::FixupExactSuggestion(history::URLDatabase* db,
-                                              HistoryURLProviderParams* params,
-                                              HistoryMatches* matches) const {
+bool HistoryURLProvider::FixupExactSuggestion(
+    history::URLAutocompleteSource* db,
+    HistoryURLProviderParams* params,
+    HistoryMatches* matches) const {
   DCHECK(!params->matches.empty());
 
   history::URLRow info;
@@ -487,7 +511,7 @@ GURL HistoryURLProvider::ConvertToHostOnly(const HistoryMatch& match,
 
 // static
 void HistoryURLProvider::PromoteOrCreateShorterSuggestion(
-    history::URLDatabase* db,
+    history::URLAutocompleteSource* db,
     const HistoryURLProviderParams& params,
     HistoryMatches* matches) {
   if (matches->empty())
@@ -604,6 +628,22 @@ void HistoryURLProvider::RunAutocompletePasses(const AutocompleteInput& input,
   scoped_ptr<HistoryURLProviderParams> params(
       new HistoryURLProviderParams(input, trim_http, matches_, languages));
 
+  // url_index can be NULL if it hasn't finished initializing (or failed to
+  // initialize).  In this case all we can do is fall back on the second
+  // pass.  Ultimately, we should probably try to ensure the history system
+  // starts properly before we get here, as otherwise this can cause
+  // inconsistent behavior when the user has just started the browser and
+  // tries to type immediately.
+  history::InMemoryURLIndex* url_index =
+      history_service->in_memory_url_index();
+
+  // The index only lives on the main thread, so look up title matches here
+  // for the second pass to merge in.
+  if (url_index) {
+    url_index->TitleWordMatches(input.text(), max_matches(),
+                                &params->title_matches);
+  }
+
   if (fixup_input_and_run_pass_1) {
     // Do some fixup on the user input before matching against it, so we provide
     // good results for local file paths, input with spaces, etc.
@@ -626,17 +666,15 @@ void HistoryURLProvider::RunAutocompletePasses(const AutocompleteInput& input,
     }
     params->input.set_text(fixed_text);
 
-    // Pass 1: Get the in-memory URL database, and use it to find and promote
-    // the inline autocomplete match, if any.
-    history::URLDatabase* url_db = history_service->in_memory_database();
-    // url_db can be NULL if it hasn't finished initializing (or failed to
-    // initialize).  In this case all we can do is fall back on the second
-    // pass.  Ultimately, we should probably try to ensure the history system
-    // starts properly before we get here, as otherwise this can cause
-    // inconsistent behavior when the user has just started the browser and
-    // tries to type immediately.
-    if (url_db) {
-      DoAutocomplete(NULL, url_db, params.get());
+    // Pass 1: Use the in-memory URL index to find and promote the inline
+    // autocomplete match, if any.
+    if (url_index) {
+      TimeTicks beginning_time = TimeTicks::Now();
+
+      DoAutocomplete(NULL, url_index, params.get());
+
+      HISTOGRAM_TIMES(L"Autocomplete.HistorySyncQueryTime",
+                      TimeTicks::Now() - beginning_time);
       // params->matches now has the matches we should expose to the provider.
       // Since pass 2 expects a "clean slate" set of matches that only contains
       // the not-yet-fixed-up What You Typed match, which is exactly what
@@ -796,7 +834,10 @@ AutocompleteMatch HistoryURLProvider::HistoryMatchToACMatch(
   match.destination_url = UTF8ToWide(info.url().possibly_invalid_spec());
   match.fill_into_edit = gfx::ElideUrl(info.url(), ChromeFont(), 0,
       match_type == WHAT_YOU_TYPED ? std::wstring() : params->languages);
-  if (!params->input.prevent_inline_autocomplete()) {
+  // Title matches can't be inline autocompleted, since the input isn't a
+  // prefix of the URL.
+  const bool url_match = history_match.input_location != std::wstring::npos;
+  if (url_match && !params->input.prevent_inline_autocomplete()) {
     match.inline_autocomplete_offset =
         history_match.input_location + params->input.text().length();
   }
@@ -813,7 +854,8 @@ AutocompleteMatch HistoryURLProvider::HistoryMatchToACMatch(
 
   match.contents = match.fill_into_edit;
   AutocompleteMatch::ClassifyLocationInString(
-      history_match.input_location - offset, params->input.text().length(),
+      url_match ? (history_match.input_location - offset) : std::wstring::npos,
+      params->input.text().length(),
       match.contents.length(), ACMatchClassification::URL,
       &match.contents_class);
   match.description = info.title();
@@ -36,8 +36,9 @@ class HistoryBackend;
 //       -> RunAutocompletePasses
 //         -> SuggestExactInput
 //         [params_ allocated]
+//         -> InMemoryURLIndex::TitleWordMatches
 //         -> DoAutocomplete (for inline autocomplete)
-//           -> URLDatabase::AutocompleteForPrefix (on in-memory DB)
+//           -> InMemoryURLIndex::AutocompleteForPrefix
 //         -> HistoryService::ScheduleAutocomplete
 //         (return to controller) \
 //                              HistoryBackend::ScheduleAutocomplete
@@ -51,15 +52,15 @@ class HistoryBackend;
 //
 // The autocomplete controller calls us, and must be called back, on the main
 // thread.  When called, we run two autocomplete passes.  The first pass runs
-// synchronously on the main thread and queries the in-memory URL database.
+// synchronously on the main thread and queries the in-memory URL index.
 // This pass promotes matches for inline autocomplete if applicable.  We do
 // this synchronously so that users get consistent behavior when they type
 // quickly and hit enter, no matter how loaded the main history database is.
 // Doing this synchronously also prevents inline autocomplete from being
-// "flickery" in the AutocompleteEdit.  Because the in-memory DB does not have
-// redirect data, results other than the top match might change between the
-// two passes, so we can't just decide to use this pass' matches as the final
-// results.
+// "flickery" in the AutocompleteEdit.  Because the in-memory index does not
+// have redirect data, results other than the top match might change between
+// the two passes, so we can't just decide to use this pass' matches as the
+// final results.
 //
 // The second autocomplete pass uses the full history database, which must be
 // queried on the history thread.  Start() asks the history service schedule to
@@ -111,6 +112,11 @@ struct HistoryURLProviderParams {
   // to matches_ on the main thread in QueryComplete().
   ACMatches matches;
 
+  // Typed URLs with a title word starting with the input.  These are looked
+  // up in the in-memory URL index on the main thread, and the second pass
+  // lists them after the URL matches.
+  std::vector<history::URLRow> title_matches;
+
   // Languages we should pass to gfx::ElideUrl.
   std::wstring languages;
 
@@ -165,7 +171,7 @@ class HistoryURLProvider : public AutocompleteProvider {
   // Actually runs the autocomplete job on the given database, which is
   // guaranteed not to be NULL.
   void DoAutocomplete(history::HistoryBackend* backend,
-                      history::URLDatabase* db,
+                      history::URLAutocompleteSource* db,
                       HistoryURLProviderParams* params);
 
   // Dispatches the results to the autocomplete controller. Called on the
@@ -216,7 +222,8 @@ class HistoryURLProvider : public AutocompleteProvider {
 
     history::URLRow url_info;
 
-    // The offset of the user's input within the URL.
+    // The offset of the user's input within the URL, or npos when the input
+    // matched the title instead.
     size_t input_location;
 
     // Whether this is a match in the scheme.  This determines whether we'll go
@@ -293,7 +300,7 @@ class HistoryURLProvider : public AutocompleteProvider {
   // we'll suggest http://example.com/ even if they've never been to it.  See
   // the function body for the exact heuristics used.
   static void PromoteOrCreateShorterSuggestion(
-      history::URLDatabase* db,
+      history::URLAutocompleteSource* db,
       const HistoryURLProviderParams& params,
       HistoryMatches* matches);
 
@@ -333,7 +340,7 @@ class HistoryURLProvider : public AutocompleteProvider {
   // autocomplete match (maybe it should be slightly better?), and places it on
   // the front of |params|->matches (so we pick the right matches to throw away
   // when culling redirects to/from it).  Returns whether a match was promoted.
-  bool FixupExactSuggestion(history::URLDatabase* db,
+  bool FixupExactSuggestion(history::URLAutocompleteSource* db,
                             HistoryURLProviderParams* params,
                             HistoryMatches* matches) const;
 
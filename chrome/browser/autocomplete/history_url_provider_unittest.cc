@@ -270,6 +270,24 @@ TEST_F(HistoryURLProviderTest, DISABLED_Starred) {
   RunTest(L"startest.com/y", std::wstring(), true, star_2, arraysize(star_2));
 }
 
+TEST_F(HistoryURLProviderTest, TitleMatches) {
+  // The in-memory URL index only sees the typed URLs from FillData() once the
+  // history thread has processed them, so run one query to let that happen.
+  AutocompleteInput input(L"favorite", std::wstring(), true, false, false);
+  autocomplete_->Start(input, false);
+  if (!autocomplete_->done())
+    MessageLoop::current()->Run();
+
+  // "favorite" only appears in the title of this page, so it should be listed
+  // after the What You Typed result without being inline autocompleted.
+  const std::wstring title_1[] = {
+    L"http://favorite/",
+    L"http://slashdot.org/favorite_page.html",
+  };
+  RunTest(L"favorite", std::wstring(), false, title_1, arraysize(title_1));
+  EXPECT_EQ(std::wstring::npos, matches_[1].inline_autocomplete_offset);
+}
+
 TEST_F(HistoryURLProviderTest, CullRedirects) {
   // URLs we will be using, plus the visit counts they will initially get
   // (the redirect set below will also increment the visit counts). We want
@@ -0,0 +1,181 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/bookmarks/bookmark_index.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "base/logging.h"
+#include "base/string_util.h"
+#include "chrome/browser/history/query_parser.h"
+#include "chrome/common/l10n_util.h"
+#include "chrome/common/scoped_vector.h"
+
+namespace {
+
+// Orders the matches the way BookmarkModel::nodes_ordered_by_url_set_ is.
+bool NodeURLLessThan(BookmarkNode* n1, BookmarkNode* n2) {
+  return n1->GetURL() < n2->GetURL();
+}
+
+// Used to intersect the smallest sets first.
+bool SmallerNodeVector(const std::vector<BookmarkNode*>* v1,
+                       const std::vector<BookmarkNode*>* v2) {
+  return v1->size() < v2->size();
+}
+
+}  // namespace
+
+BookmarkIndex::BookmarkIndex() {
+}
+
+BookmarkIndex::~BookmarkIndex() {
+}
+
+void BookmarkIndex::Add(BookmarkNode* node) {
+  DCHECK(node->is_url());
+  std::vector<QueryWord> words;
+  ExtractTitleWords(node, &words);
+  ExtractURLWords(node, &words);
+  for (size_t i = 0; i < words.size(); ++i)
+    index_[words[i].word].insert(node);
+}
+
+void BookmarkIndex::Remove(BookmarkNode* node) {
+  DCHECK(node->is_url());
+  std::vector<QueryWord> words;
+  ExtractTitleWords(node, &words);
+  ExtractURLWords(node, &words);
+  for (size_t i = 0; i < words.size(); ++i) {
+    Index::iterator word = index_.find(words[i].word);
+    if (word == index_.end())
+      continue;  // The word appears more than once in node.
+    word->second.erase(node);
+    if (word->second.empty())
+      index_.erase(word);
+  }
+}
+
+void BookmarkIndex::GetBookmarksMatchingText(
+    const std::wstring& query,
+    size_t max_count,
+    std::vector<BookmarkModel::TitleMatch>* matches) {
+  QueryParser parser;
+  ScopedVector<QueryNode> query_nodes;
+  parser.ParseQuery(query, &query_nodes.get());
+  if (query_nodes.empty())
+    return;
+
+  std::vector<std::wstring> query_words;
+  for (size_t i = 0; i < query_nodes.size(); ++i)
+    query_nodes[i]->AppendWords(&query_words);
+
+  // The posting list of each query word. A node can only match the query if
+  // it is in all of them.
+  ScopedVector<std::vector<BookmarkNode*> > posting_lists;
+  for (size_t i = 0; i < query_words.size(); ++i) {
+    std::vector<BookmarkNode*>* nodes = new std::vector<BookmarkNode*>;
+    posting_lists.push_back(nodes);
+    GetNodesMatchingWord(query_words[i], nodes);
+    if (nodes->empty())
+      return;
+  }
+  std::sort(posting_lists.begin(), posting_lists.end(), &SmallerNodeVector);
+
+  std::vector<BookmarkNode*> candidates(*posting_lists[0]);
+  for (size_t i = 1; i < posting_lists.size() && !candidates.empty(); ++i) {
+    std::vector<BookmarkNode*> intersection;
+    std::set_intersection(candidates.begin(), candidates.end(),
+                          posting_lists[i]->begin(), posting_lists[i]->end(),
+                          std::back_inserter(intersection));
+    candidates.swap(intersection);
+  }
+
+  // The candidates have every word, but a phrase also needs them in order, so
+  // each is checked against the query.
+  std::sort(candidates.begin(), candidates.end(), &NodeURLLessThan);
+  Snippet::MatchPositions match_positions;
+  for (size_t i = 0; i < candidates.size() && matches->size() < max_count;
+       ++i) {
+    if (DoesNodeMatch(query_nodes.get(), candidates[i], &match_positions)) {
+      matches->push_back(BookmarkModel::TitleMatch());
+      matches->back().node = candidates[i];
+      matches->back().match_positions.swap(match_positions);
+    }
+    match_positions.clear();
+  }
+}
+
+// static
+bool BookmarkIndex::DoesNodeMatch(
+    const std::vector<QueryNode*>& query_nodes,
+    BookmarkNode* node,
+    Snippet::MatchPositions* title_match_positions) {
+  if (query_nodes.empty())
+    return false;
+
+  std::vector<QueryWord> title_words;
+  ExtractTitleWords(node, &title_words);
+  std::vector<QueryWord> url_words;
+  ExtractURLWords(node, &url_words);
+
+  Snippet::MatchPositions title_matches;
+  Snippet::MatchPositions url_matches;
+  for (size_t i = 0; i < query_nodes.size(); ++i) {
+    if (!query_nodes[i]->HasMatchIn(title_words, &title_matches) &&
+        !query_nodes[i]->HasMatchIn(url_words, &url_matches)) {
+      return false;
+    }
+  }
+  title_match_positions->swap(title_matches);
+  return true;
+}
+
+// static
+void BookmarkIndex::ExtractTitleWords(BookmarkNode* node,
+                                      std::vector<QueryWord>* words) {
+  QueryParser parser;
+  parser.ExtractQueryWords(l10n_util::ToLower(node->GetTitle()), words);
+}
+
+// static
+void BookmarkIndex::ExtractURLWords(BookmarkNode* node,
+                                    std::vector<QueryWord>* words) {
+  const GURL& url = node->GetURL();
+  if (!url.is_valid())
+    return;
+
+  // Leave out the scheme, otherwise every bookmark would match 'http'.
+  std::wstring text(UTF8ToWide(url.spec().substr(url.scheme().size())));
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] < 0x80 && !IsAsciiAlpha(text[i]) && !IsAsciiDigit(text[i]))
+      text[i] = L' ';
+  }
+  QueryParser parser;
+  parser.ExtractQueryWords(l10n_util::ToLower(text), words);
+}
+
+void BookmarkIndex::GetNodesMatchingWord(
+    const std::wstring& word,
+    std::vector<BookmarkNode*>* nodes) const {
+  if (!QueryParser::IsWordLongEnoughForPrefixSearch(word)) {
+    Index::const_iterator i = index_.find(word);
+    if (i != index_.end())
+      nodes->assign(i->second.begin(), i->second.end());
+    return;
+  }
+
+  int matching_words = 0;
+  for (Index::const_iterator i = index_.lower_bound(word);
+       i != index_.end() && i->first.compare(0, word.size(), word) == 0;
+       ++i, ++matching_words) {
+    nodes->insert(nodes->end(), i->second.begin(), i->second.end());
+  }
+  if (matching_words > 1) {
+    // The same node may have several of the words.
+    std::sort(nodes->begin(), nodes->end());
+    nodes->erase(std::unique(nodes->begin(), nodes->end()), nodes->end());
+  }
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_BOOKMARKS_BOOKMARK_INDEX_H_
+#define CHROME_BROWSER_BOOKMARKS_BOOKMARK_INDEX_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "chrome/browser/bookmarks/bookmark_model.h"
+
+class QueryNode;
+struct QueryWord;
+
+// BookmarkIndex maps each word in the titles and URLs of the url nodes of a
+// BookmarkModel to the nodes containing it. Queries only look at the nodes
+// that have a word matching every word of the query, rather than at every
+// bookmark.
+//
+// Titles are split into words the same way QueryParser splits them. URLs are
+// split at punctuation, so that 'google' matches http://www.google.com/.
+//
+// BookmarkIndex is not thread safe; BookmarkModel only uses it on the main
+// thread.
+class BookmarkIndex {
+ public:
+  BookmarkIndex();
+  ~BookmarkIndex();
+
+  // Adds or removes the words of node. Remove must be invoked before the title
+  // of node changes, and Add after.
+  void Add(BookmarkNode* node);
+  void Remove(BookmarkNode* node);
+
+  // Returns up to max_count of the nodes matching query, ordered by URL.
+  void GetBookmarksMatchingText(
+      const std::wstring& query,
+      size_t max_count,
+      std::vector<BookmarkModel::TitleMatch>* matches);
+
+  // Returns true if every node of the parsed query matches a word of the title
+  // or URL of node. The positions of the words matched in the title are
+  // added to title_match_positions.
+  static bool DoesNodeMatch(const std::vector<QueryNode*>& query_nodes,
+                            BookmarkNode* node,
+                            Snippet::MatchPositions* title_match_positions);
+
+  // Returns the number of distinct words in the index.
+  size_t word_count() const { return index_.size(); }
+
+ private:
+  typedef std::set<BookmarkNode*> NodeSet;
+  typedef std::map<std::wstring, NodeSet> Index;
+
+  // Extracts the lower case words from the title and URL of node.
+  static void ExtractTitleWords(BookmarkNode* node,
+                                std::vector<QueryWord>* words);
+  static void ExtractURLWords(BookmarkNode* node,
+                              std::vector<QueryWord>* words);
+
+  // Adds the nodes containing a word matched by the query word |word| to
+  // nodes, sorted. If word is long enough for prefix searching this is the
+  // union of the nodes of every word that begins with it.
+  void GetNodesMatchingWord(const std::wstring& word,
+                            std::vector<BookmarkNode*>* nodes) const;
+
+  Index index_;
+
+  DISALLOW_COPY_AND_ASSIGN(BookmarkIndex);
+};
+
+#endif  // CHROME_BROWSER_BOOKMARKS_BOOKMARK_INDEX_H_
@@ -0,0 +1,114 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/perftimer.h"
+#include "base/string_util.h"
+#include "chrome/browser/bookmarks/bookmark_model.h"
+#include "chrome/browser/history/query_parser.h"
+#include "chrome/common/scoped_vector.h"
+#include "googleurl/src/gurl.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kBookmarkCount = 20000;
+
+// The number of titles that are typed out, one keystroke at a time.
+const int kTypedTitleCount = 20;
+
+// What HistoryContentsProvider asks for.
+const size_t kMaxMatchCount = 50;
+
+const char* const kSyllables[] = {
+  "ba", "co", "de", "fi", "go", "ha", "ji", "ka", "lo", "me", "ni", "op",
+  "pu", "qua", "ro", "sa", "te", "ul", "vi", "wo", "xe", "yo", "zu", "an",
+};
+
+// A fixed sequence of pseudo-random numbers, so each run sees the same
+// bookmarks.
+class Random {
+ public:
+  Random() : seed_(0x12345678) {
+  }
+  int Next(int range) {
+    seed_ = seed_ * 1103515245 + 12345;
+    return static_cast<int>((seed_ >> 16) % range);
+  }
+
+ private:
+  uint32 seed_;
+};
+
+std::string Word(Random* random) {
+  std::string word;
+  int syllables = 2 + random->Next(3);
+  for (int i = 0; i < syllables; ++i)
+    word.append(kSyllables[random->Next(arraysize(kSyllables))]);
+  return word;
+}
+
+// Returns each keystroke of typing the first two words of title.
+void AddKeystrokes(const std::wstring& title,
+                   std::vector<std::wstring>* keystrokes) {
+  size_t end = title.find(L' ');
+  end = title.find(L' ', end + 1);
+  for (size_t length = 1; length <= end && length < title.size(); ++length)
+    keystrokes->push_back(title.substr(0, length));
+}
+
+}  // namespace
+
+// Compares GetBookmarksMatchingText with matching the query against the title
+// of every bookmark, which is what it did before BookmarkIndex.
+TEST(BookmarkIndexPerfTest, TypedQueries) {
+  BookmarkModel model(NULL);
+  BookmarkNode* parent = model.GetBookmarkBarNode();
+  Random random;
+  std::vector<std::wstring> keystrokes;
+  PerfTimeLogger add_timer("BookmarkIndex_add_20k");
+  for (int i = 0; i < kBookmarkCount; ++i) {
+    if (i % 100 == 0)
+      parent = model.AddGroup(model.other_node(), 0, L"group");
+    std::wstring title(UTF8ToWide(Word(&random) + " " + Word(&random) + " " +
+                                  Word(&random)));
+    GURL url("http://www." + Word(&random) + ".com/" + Word(&random));
+    model.AddURL(parent, parent->GetChildCount(), title, url);
+    if (i % (kBookmarkCount / kTypedTitleCount) == 0)
+      AddKeystrokes(title, &keystrokes);
+  }
+  add_timer.Done();
+
+  std::vector<BookmarkNode*> nodes;
+  model.GetMostRecentlyAddedEntries(kBookmarkCount, &nodes);
+  ASSERT_EQ(static_cast<size_t>(kBookmarkCount), nodes.size());
+
+  PerfTimer scan_timer;
+  for (size_t i = 0; i < keystrokes.size(); ++i) {
+    QueryParser parser;
+    ScopedVector<QueryNode> query_nodes;
+    parser.ParseQuery(keystrokes[i], &query_nodes.get());
+    size_t match_count = 0;
+    Snippet::MatchPositions match_positions;
+    for (size_t j = 0; j < nodes.size() && match_count < kMaxMatchCount; ++j) {
+      if (parser.DoesQueryMatch(nodes[j]->GetTitle(), query_nodes.get(),
+                                &match_positions))
+        ++match_count;
+    }
+  }
+  LogPerfResult("BookmarkModel_scan_keystroke_20k",
+                scan_timer.Elapsed().InMillisecondsF() / keystrokes.size(),
+                "ms");
+
+  PerfTimer index_timer;
+  for (size_t i = 0; i < keystrokes.size(); ++i) {
+    std::vector<BookmarkModel::TitleMatch> matches;
+    model.GetBookmarksMatchingText(keystrokes[i], kMaxMatchCount, &matches);
+  }
+  LogPerfResult("BookmarkIndex_keystroke_20k",
+                index_timer.Elapsed().InMillisecondsF() / keystrokes.size(),
+                "ms");
+}
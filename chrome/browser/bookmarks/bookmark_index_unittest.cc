@@ -0,0 +1,137 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/string_util.h"
+#include "chrome/browser/bookmarks/bookmark_index.h"
+#include "chrome/browser/bookmarks/bookmark_model.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+class BookmarkIndexTest : public testing::Test {
+ public:
+  BookmarkIndexTest() : model_(NULL) {}
+
+  BookmarkNode* AddURL(const wchar_t* title, const char* url) {
+    BookmarkNode* bar = model_.GetBookmarkBarNode();
+    return model_.AddURL(bar, bar->GetChildCount(), title, GURL(url));
+  }
+
+  // Returns the titles of the bookmarks matching query, in order.
+  std::vector<std::wstring> TitlesMatching(const std::wstring& query) {
+    std::vector<BookmarkModel::TitleMatch> matches;
+    model_.GetBookmarksMatchingText(query, 100, &matches);
+    std::vector<std::wstring> titles;
+    for (size_t i = 0; i < matches.size(); ++i)
+      titles.push_back(matches[i].node->GetTitle());
+    return titles;
+  }
+
+ protected:
+  BookmarkModel model_;
+};
+
+// Every word of the query has to match, each of them either exactly or as a
+// prefix if it is long enough.
+TEST_F(BookmarkIndexTest, MatchesAllWords) {
+  AddURL(L"Cheap flights to Paris", "http://a.com/");
+  AddURL(L"Flight status", "http://b.com/");
+  AddURL(L"Paris hotels", "http://c.com/");
+  AddURL(L"x y", "http://d.com/");
+
+  std::vector<std::wstring> titles(TitlesMatching(L"flight"));
+  ASSERT_EQ(2U, titles.size());
+  EXPECT_EQ(L"Cheap flights to Paris", titles[0]);
+  EXPECT_EQ(L"Flight status", titles[1]);
+
+  titles = TitlesMatching(L"PAR fli");
+  ASSERT_EQ(1U, titles.size());
+  EXPECT_EQ(L"Cheap flights to Paris", titles[0]);
+
+  EXPECT_TRUE(TitlesMatching(L"paris status").empty());
+  EXPECT_TRUE(TitlesMatching(L"flightz").empty());
+
+  // Short words only match whole words.
+  EXPECT_TRUE(TitlesMatching(L"fl").empty());
+  EXPECT_EQ(1U, TitlesMatching(L"x").size());
+}
+
+TEST_F(BookmarkIndexTest, MatchPositions) {
+  AddURL(L"Cheap flights to Paris", "http://a.com/");
+
+  std::vector<BookmarkModel::TitleMatch> matches;
+  model_.GetBookmarksMatchingText(L"paris fli", 10, &matches);
+  ASSERT_EQ(1U, matches.size());
+  ASSERT_EQ(2U, matches[0].match_positions.size());
+  EXPECT_EQ(17, matches[0].match_positions[0].first);
+  EXPECT_EQ(22, matches[0].match_positions[0].second);
+  EXPECT_EQ(6, matches[0].match_positions[1].first);
+  EXPECT_EQ(9, matches[0].match_positions[1].second);
+}
+
+// The words of the URL, but not its scheme, are matched too.
+TEST_F(BookmarkIndexTest, MatchesURL) {
+  AddURL(L"Search", "http://www.google.com/");
+  AddURL(L"Mail", "https://mail.google.com/mail/");
+
+  std::vector<BookmarkModel::TitleMatch> matches;
+  model_.GetBookmarksMatchingText(L"goog", 10, &matches);
+  ASSERT_EQ(2U, matches.size());
+  EXPECT_TRUE(matches[0].match_positions.empty());
+
+  std::vector<std::wstring> titles(TitlesMatching(L"mail goo"));
+  ASSERT_EQ(1U, titles.size());
+  EXPECT_EQ(L"Mail", titles[0]);
+
+  EXPECT_TRUE(TitlesMatching(L"http").empty());
+}
+
+// Words in quotes have to be whole words, in order.
+TEST_F(BookmarkIndexTest, Phrase) {
+  AddURL(L"New York Times", "http://a.com/");
+  AddURL(L"York, New", "http://b.com/");
+  AddURL(L"Newer York", "http://c.com/");
+
+  std::vector<std::wstring> titles(TitlesMatching(L"\"new york\""));
+  ASSERT_EQ(1U, titles.size());
+  EXPECT_EQ(L"New York Times", titles[0]);
+}
+
+// The index follows the bookmarks as they are retitled and removed.
+TEST_F(BookmarkIndexTest, TitleChangeAndRemove) {
+  BookmarkNode* node = AddURL(L"blah", "http://a.com/");
+  AddURL(L"blah blah", "http://b.com/");
+
+  model_.SetTitle(node, L"foo");
+  EXPECT_EQ(1U, TitlesMatching(L"blah").size());
+  EXPECT_EQ(1U, TitlesMatching(L"foo").size());
+
+  // Removing the group removes the bookmarks in it.
+  BookmarkNode* group =
+      model_.AddGroup(model_.other_node(), 0, L"blah group");
+  model_.AddURL(group, 0, L"blah", GURL("http://c.com/"));
+  EXPECT_EQ(2U, TitlesMatching(L"blah").size());
+  model_.Remove(model_.other_node(), 0);
+  EXPECT_EQ(1U, TitlesMatching(L"blah").size());
+
+  BookmarkNode* bar = model_.GetBookmarkBarNode();
+  model_.Remove(bar, 1);
+  model_.Remove(bar, 0);
+  EXPECT_TRUE(TitlesMatching(L"blah").empty());
+  EXPECT_TRUE(TitlesMatching(L"foo").empty());
+}
+
+// Matches are ordered by URL and capped at max_count.
+TEST_F(BookmarkIndexTest, MaxCount) {
+  for (int i = 9; i >= 0; --i)
+    AddURL(L"blah", StringPrintf("http://a.com/%d", i).c_str());
+
+  std::vector<BookmarkModel::TitleMatch> matches;
+  model_.GetBookmarksMatchingText(L"blah", 3, &matches);
+  ASSERT_EQ(3U, matches.size());
+  EXPECT_EQ("http://a.com/0", matches[0].node->GetURL().spec());
+  EXPECT_EQ("http://a.com/1", matches[1].node->GetURL().spec());
+  EXPECT_EQ("http://a.com/2", matches[2].node->GetURL().spec());
+}
@@ -5,6 +5,7 @@
 #include "chrome/browser/bookmarks/bookmark_model.h"
 
 #include "base/gfx/png_decoder.h"
+#include "chrome/browser/bookmarks/bookmark_index.h"
 #include "chrome/browser/bookmarks/bookmark_storage.h"
 #include "chrome/browser/history/query_parser.h"
 #include "chrome/browser/profile.h"
@@ -75,6 +76,7 @@ BookmarkModel::BookmarkModel(Profile* profile)
       root_(this, GURL()),
       bookmark_bar_node_(NULL),
       other_node_(NULL),
+      index_(new BookmarkIndex()),
       waiting_for_history_load_(false),
       loaded_signal_(CreateEvent(NULL, TRUE, FALSE, NULL)) {
   // Create the bookmark bar and other bookmarks folders. These always exist.
@@ -180,25 +182,7 @@ void BookmarkModel::GetBookmarksMatchingText(
     const std::wstring& text,
     size_t max_count,
     std::vector<TitleMatch>* matches) {
-  QueryParser parser;
-  ScopedVector<QueryNode> query_nodes;
-  parser.ParseQuery(text, &query_nodes.get());
-  if (query_nodes.empty())
-    return;
-
-  AutoLock url_lock(url_lock_);
-  Snippet::MatchPositions match_position;
-  for (NodesOrderedByURLSet::iterator i = nodes_ordered_by_url_set_.begin();
-       i != nodes_ordered_by_url_set_.end(); ++i) {
-    if (parser.DoesQueryMatch((*i)->GetTitle(), query_nodes.get(),
-                              &match_position)) {
-      matches->push_back(TitleMatch());
-      matches->back().node = *i;
-      matches->back().match_positions.swap(match_position);
-      if (matches->size() == max_count)
-        break;
-    }
-  }
+  index_->GetBookmarksMatchingText(text, max_count, matches);
 }
 
 bool BookmarkModel::DoesBookmarkMatchText(const std::wstring& text,
@@ -213,8 +197,7 @@ bool BookmarkModel::DoesBookmarkMatchText(const std::wstring& text,
     return false;
 
   Snippet::MatchPositions match_position;
-  return parser.DoesQueryMatch(node->GetTitle(), query_nodes.get(),
-                               &match_position);
+  return BookmarkIndex::DoesNodeMatch(query_nodes.get(), node, &match_position);
 }
 
 void BookmarkModel::Remove(BookmarkNode* parent, int index) {
@@ -273,7 +256,11 @@ void BookmarkModel::SetTitle(BookmarkNode* node,
   if (node->GetTitle() == title)
     return;
 
+  if (node->is_url())
+    index_->Remove(node);
   node->SetTitle(title);
+  if (node->is_url())
+    index_->Add(node);
 
   if (store_.get())
     store_->ScheduleSave();
@@ -376,6 +363,7 @@ BookmarkNode* BookmarkModel::AddURLWithCreationTime(
     AutoLock url_lock(url_lock_);
     nodes_ordered_by_url_set_.insert(new_node);
   }
+  index_->Add(new_node);
 
   return AddNode(parent, index, new_node, was_bookmarked);
 }
@@ -437,6 +425,8 @@ void BookmarkModel::RemoveNode(BookmarkNode* node,
       ++i;
     nodes_ordered_by_url_set_.erase(i);
     removed_urls->insert(node->GetURL());
+
+    index_->Remove(node);
   }
 
   CancelPendingFavIconLoadRequests(node);
@@ -771,8 +761,10 @@ void BookmarkModel::Observe(NotificationType type,
 void BookmarkModel::PopulateNodesByURL(BookmarkNode* node) {
   // NOTE: this is called with url_lock_ already held. As such, this doesn't
   // explicitly grab the lock.
-  if (node->is_url())
+  if (node->is_url()) {
     nodes_ordered_by_url_set_.insert(node);
+    index_->Add(node);
+  }
   for (int i = 0; i < node->GetChildCount(); ++i)
     PopulateNodesByURL(node->GetChild(i));
 }
@@ -8,6 +8,7 @@
 #include "base/lock.h"
 #include "base/observer_list.h"
 #include "base/scoped_handle.h"
+#include "base/scoped_ptr.h"
 #include "chrome/browser/bookmarks/bookmark_service.h"
 #include "chrome/browser/bookmarks/bookmark_storage.h"
 #include "chrome/browser/cancelable_request.h"
@@ -19,6 +20,7 @@
 #include "skia/include/SkBitmap.h"
 
 class BookmarkEditorView;
+class BookmarkIndex;
 class BookmarkModel;
 class BookmarkCodec;
 class Profile;
@@ -219,18 +221,19 @@ class BookmarkModel : public NotificationObserver, public BookmarkService {
   struct TitleMatch {
     BookmarkNode* node;
 
-    // Location of the matching words in the title of the node.
+    // Location of the matching words in the title of the node. This is empty
+    // if only the URL of the node matched.
     Snippet::MatchPositions match_positions;
   };
 
-  // Returns the bookmarks whose title contains text. At most |max_count|
-  // matches are returned in |matches|.
+  // Returns the bookmarks whose title or URL contains text. At most
+  // |max_count| matches are returned in |matches|, ordered by URL.
   void GetBookmarksMatchingText(const std::wstring& text,
                                 size_t max_count,
                                 std::vector<TitleMatch>* matches);
 
-  // Returns true if the specified bookmark's title matches the specified
-  // text.
+  // Returns true if the specified bookmark's title or URL matches the
+  // specified text.
   bool DoesBookmarkMatchText(const std::wstring& text, BookmarkNode* node);
 
   void AddObserver(BookmarkModelObserver* observer) {
@@ -351,7 +354,7 @@ class BookmarkModel : public NotificationObserver, public BookmarkService {
   // Invoked when loading is finished. Sets loaded_ and notifies observers.
   void DoneLoading();
 
-  // Populates nodes_ordered_by_url_set_ from root.
+  // Populates nodes_ordered_by_url_set_ and index_ from root.
   void PopulateNodesByURL(BookmarkNode* node);
 
   // Removes the node from its parent, sends notification, and deletes it.
@@ -435,6 +438,11 @@ class BookmarkModel : public NotificationObserver, public BookmarkService {
   NodesOrderedByURLSet nodes_ordered_by_url_set_;
   Lock url_lock_;
 
+  // Words of the titles and URLs of the url nodes, used by
+  // GetBookmarksMatchingText. Unlike nodes_ordered_by_url_set_ this is only
+  // used on the main thread, and is not guarded by url_lock_.
+  scoped_ptr<BookmarkIndex> index_;
+
   // Used for loading favicons and the empty history request.
   CancelableRequestConsumerT<BookmarkNode*, NULL> load_consumer_;
 
@@ -15,6 +15,8 @@
 #include "base/process_util.h"
 #include "base/registry.h"
 #include "base/string_util.h"
+#include "base/task.h"
+#include "base/thread.h"
 #include "base/tracked_objects.h"
 #include "base/win_util.h"
 #include "chrome/app/result_codes.h"
@@ -61,6 +63,7 @@
 #include "net/base/net_util.h"
 #include "net/base/sdch_manager.h"
 #include "net/base/winsock_init.h"
+#include "net/disk_cache/disk_cache.h"
 #include "net/http/http_network_layer.h"
 
 #include "chromium_strings.h"
@@ -68,6 +71,32 @@
 
 namespace {
 
+// The most disk space that SDCH dictionaries may take up between runs.
+const int kSdchDictionaryStoreSize = 4 * 1024 * 1024;
+
+// Where SdchManager saves SDCH dictionaries.  The manager adds dictionaries
+// and the SDCH filters use them on the IO thread, so the store is opened,
+// used and deleted there.
+disk_cache::Backend* sdch_dictionary_store = NULL;
+
+// Runs on the IO thread.
+void OpenSdchDictionaryStore(const std::wstring& store_path) {
+  DCHECK(!sdch_dictionary_store);
+  sdch_dictionary_store = disk_cache::CreateCacheBackend(
+      store_path, true, kSdchDictionaryStoreSize);
+  if (sdch_dictionary_store)
+    SdchManager::Global()->set_dictionary_store(sdch_dictionary_store);
+}
+
+// Runs on the IO thread.
+void CloseSdchDictionaryStore() {
+  if (!sdch_dictionary_store)
+    return;
+  SdchManager::Global()->set_dictionary_store(NULL);
+  delete sdch_dictionary_store;
+  sdch_dictionary_store = NULL;
+}
+
 // This function provides some ways to test crash and assertion handling
 // behavior of the program.
 void HandleErrorTestParameters(const CommandLine& command_line) {
@@ -533,13 +562,20 @@ int BrowserMain(CommandLine &parsed_command_line, int show_command,
   // Initialize the CertStore.
   CertStore::Initialize();
 
-  // Prepare for memory caching of SDCH dictionaries.
+  // Prepare for memory caching of SDCH dictionaries, which are also saved in
+  // the profile so they don't have to be fetched again on the next run.
   SdchManager sdch_manager;  // Construct singleton database.
-  if (parsed_command_line.HasSwitch(switches::kSdchFilter)) {
+  bool sdch_enabled = parsed_command_line.HasSwitch(switches::kSdchFilter);
+  if (sdch_enabled) {
     sdch_manager.set_sdch_fetcher(new SdchDictionaryFetcher);
     std::wstring switch_domain =
         parsed_command_line.GetSwitchValue(switches::kSdchFilter);
     sdch_manager.EnableSdchSupport(WideToASCII(switch_domain));
+
+    std::wstring store_path = profile->GetPath();
+    file_util::AppendToPath(&store_path, chrome::kSdchDictionariesDirname);
+    browser_process->io_thread()->message_loop()->PostTask(FROM_HERE,
+        NewRunnableFunction(&OpenSdchDictionaryStore, store_path));
   }
 
   MetricsService* metrics = NULL;
@@ -586,6 +622,13 @@ int BrowserMain(CommandLine &parsed_command_line, int show_command,
   if (metrics)
     metrics->Stop();
 
+  // The IO thread runs this before it stops, along with whatever is left of
+  // the SDCH work.
+  if (sdch_enabled) {
+    browser_process->io_thread()->message_loop()->PostTask(FROM_HERE,
+        NewRunnableFunction(&CloseSdchDictionaryStore));
+  }
+
   // browser_shutdown takes care of deleting browser_process, so we need to
   // release it.
   browser_process.release();
@@ -184,6 +184,12 @@ history::URLDatabase* HistoryService::in_memory_database() const {
   return NULL;
 }
 
+history::InMemoryURLIndex* HistoryService::in_memory_url_index() const {
+  if (in_memory_backend_.get())
+    return in_memory_backend_->index();
+  return NULL;
+}
+
 void HistoryService::SetSegmentPresentationIndex(int64 segment_id, int index) {
   ScheduleAndForget(PRIORITY_UI,
                     &HistoryBackend::SetSegmentPresentationIndex,
@@ -45,6 +45,7 @@ class InMemoryHistoryBackend;
 class HistoryBackend;
 class HistoryDatabase;
 class HistoryQueryTest;
+class InMemoryURLIndex;
 class URLDatabase;
 
 }  // namespace history
@@ -131,6 +132,11 @@ class HistoryService : public CancelableRequestProvider,
   // TODO(brettw) this should return the InMemoryHistoryBackend.
   history::URLDatabase* in_memory_database() const;
 
+  // Returns the in-memory index of the same URLs, which is what the
+  // synchronous autocomplete pass queries.  Like in_memory_database(), this
+  // MAY BE NULL before the in-memory backend has loaded.
+  history::InMemoryURLIndex* in_memory_url_index() const;
+
   // Navigation ----------------------------------------------------------------
 
   // Adds the given canonical URL to history with the current time as the visit
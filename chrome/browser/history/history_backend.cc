@@ -55,8 +55,14 @@ namespace history {
 static const int kSegmentDataRetention = 90;
 
 // The number of milliseconds we'll wait to do a commit, so that things are
-// batched together.
-static const int kCommitIntervalMs = 10000;
+// batched together. This is also the most work a crash can lose, so it is
+// kept short; kMaxPendingChanges bounds the size of each commit.
+static const int kCommitIntervalMs = 2000;
+
+// The number of changes after which we commit right away rather than waiting
+// for kCommitIntervalMs. During a burst of navigations this writes several
+// small transactions instead of one large one that stalls the history thread.
+static const int kMaxPendingChanges = 50;
 
 // The amount of time before we re-fetch the favicon.
 static const int kFavIconRefetchDays = 7;
@@ -192,6 +198,7 @@ HistoryBackend::HistoryBackend(const std::wstring& history_dir,
       history_dir_(history_dir),
 #pragma warning(suppress: 4355)  // OK to pass "this" here.
       expirer_(this, bookmark_service),
+      pending_changes_(0),
       backend_destroy_message_loop_(NULL),
       recent_redirects_(kMaxRedirectCount),
       backend_destroy_task_(NULL),
@@ -1496,6 +1503,7 @@ void HistoryBackend::Commit() {
   // some cases) but it hasn't been important yet.
   CancelScheduledCommit();
 
+  TimeTicks beginning_time = TimeTicks::Now();
   db_->CommitTransaction();
   DCHECK(db_->transaction_nesting() == 0) << "Somebody left a transaction open";
   db_->BeginTransaction();
@@ -1516,9 +1524,28 @@ void HistoryBackend::Commit() {
     text_database_->CommitTransaction();
     text_database_->BeginTransaction();
   }
+
+  UMA_HISTOGRAM_TIMES(L"History.CommitTime",
+                      TimeTicks::Now() - beginning_time);
+  if (pending_changes_) {
+    // How long the oldest change was at risk of being lost in a crash.
+    UMA_HISTOGRAM_TIMES(L"History.CommitDelay",
+                        beginning_time - first_pending_change_time_);
+    UMA_HISTOGRAM_COUNTS(L"History.CommitChanges", pending_changes_);
+    pending_changes_ = 0;
+  }
 }
 
 void HistoryBackend::ScheduleCommit() {
+  if (pending_changes_++ == 0)
+    first_pending_change_time_ = TimeTicks::Now();
+
+  if (pending_changes_ >= kMaxPendingChanges) {
+    // Commit() also cancels the scheduled commit.
+    Commit();
+    return;
+  }
+
   if (scheduled_commit_.get())
     return;
   scheduled_commit_ = new CommitLaterTask(this);
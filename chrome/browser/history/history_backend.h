@@ -259,6 +259,7 @@ class HistoryBackend : public base::RefCountedThreadSafe<HistoryBackend>,
   friend class HistoryTest;  // So the unit tests can poke our innards.
   FRIEND_TEST(HistoryBackendTest, DeleteAll);
   FRIEND_TEST(HistoryBackendTest, URLsNoLongerBookmarked);
+  FRIEND_TEST(HistoryBackendTest, NavigationStorm);
   friend class TestingProfile;
 
   // For invoking methods that circumvent requests.
@@ -326,7 +327,9 @@ class HistoryBackend : public base::RefCountedThreadSafe<HistoryBackend>,
 
   // Schedules a commit to happen in the future. We do this so that many
   // operations over a period of time will be batched together. If there is
-  // already a commit scheduled for the future, this will do nothing.
+  // already a commit scheduled for the future, this will do nothing, unless
+  // enough changes have piled up that the commit is moved up to run as soon
+  // as the tasks already queued are done. Callers call this once per change.
   void ScheduleCommit();
 
   // Cancels the scheduled commit, if any. If there is no scheduled commit,
@@ -437,6 +440,11 @@ class HistoryBackend : public base::RefCountedThreadSafe<HistoryBackend>,
   // scheduled commit at a time (see ScheduleCommit).
   scoped_refptr<CommitLaterTask> scheduled_commit_;
 
+  // The number of ScheduleCommit calls since the last commit, and when the
+  // first of them was made.
+  int pending_changes_;
+  TimeTicks first_pending_change_time_;
+
   // Maps recent redirect destination pages to the chain of redirects that
   // brought us to there. Pages that did not have redirects or were not the
   // final redirect in a chain will not be in this list, as well as pages that
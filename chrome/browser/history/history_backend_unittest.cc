@@ -5,6 +5,7 @@
 #include "base/file_util.h"
 #include "base/path_service.h"
 #include "base/scoped_ptr.h"
+#include "base/string_util.h"
 #include "chrome/browser/bookmarks/bookmark_model.h"
 #include "chrome/browser/history/history_backend.h"
 #include "chrome/browser/history/in_memory_history_backend.h"
@@ -384,5 +385,39 @@ TEST_F(HistoryBackendTest, GetPageThumbnailAfterRedirects) {
   EXPECT_TRUE(data.get());
 }
 
+// A burst of navigations is committed in batches as soon as enough changes
+// are pending, rather than all at once when the commit timer fires.
+TEST_F(HistoryBackendTest, NavigationStorm) {
+  ASSERT_TRUE(backend_.get());
+  backend_->Commit();
+  EXPECT_EQ(0, backend_->pending_changes_);
+
+  const int kStormSize = 500;
+  int commits = 0;
+  std::vector<std::wstring> urls;
+  for (int i = 0; i < kStormSize; ++i) {
+    urls.push_back(StringPrintf(L"http://www.google.com/%d", i % 50));
+    const wchar_t* chain[] = { urls.back().c_str(), NULL };
+    AddRedirectChain(chain, i);
+    if (backend_->pending_changes_ == 0)
+      commits++;
+  }
+  // One commit for every 50 changes (kMaxPendingChanges).
+  EXPECT_EQ(kStormSize / 50, commits);
+  EXPECT_EQ(0, backend_->pending_changes_);
+  EXPECT_FALSE(backend_->scheduled_commit_.get());
+
+  URLRow row;
+  ASSERT_TRUE(backend_->db_->GetRowForURL(GURL(urls[0]), &row));
+  EXPECT_EQ(kStormSize / 50, row.visit_count());
+
+  // A single navigation waits for the timer.
+  const wchar_t* chain[] = { L"http://www.google.com/", NULL };
+  AddRedirectChain(chain, kStormSize);
+  MessageLoop::current()->RunAllPending();
+  EXPECT_EQ(1, backend_->pending_changes_);
+  EXPECT_TRUE(backend_->scheduled_commit_.get());
+}
+
 }  // namespace history
 
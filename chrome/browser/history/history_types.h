@@ -24,6 +24,7 @@ namespace history {
 
 // Forward declaration for friend statements.
 class HistoryBackend;
+class InMemoryURLIndex;
 class URLDatabase;
 
 typedef int64 StarID;  // Unique identifier for star entries.
@@ -127,6 +128,7 @@ class URLRow {
   // when reading out of the DB.
   friend class URLDatabase;
   friend class HistoryBackend;
+  friend class InMemoryURLIndex;
 
   // Initializes all values that need initialization to their defaults.
   // This excludes objects which autoinitialize such as strings.
@@ -7,6 +7,7 @@
 #include "chrome/browser/browser_process.h"
 #include "chrome/browser/history/history_notifications.h"
 #include "chrome/browser/history/in_memory_database.h"
+#include "chrome/browser/history/in_memory_url_index.h"
 #include "chrome/browser/profile.h"
 
 namespace history {
@@ -33,7 +34,12 @@ InMemoryHistoryBackend::~InMemoryHistoryBackend() {
 
 bool InMemoryHistoryBackend::Init(const std::wstring& history_filename) {
   db_.reset(new InMemoryDatabase);
-  return db_->InitFromDisk(history_filename);
+  if (!db_->InitFromDisk(history_filename))
+    return false;
+
+  index_.reset(new InMemoryURLIndex);
+  index_->Init(db_.get());
+  return true;
 }
 
 void InMemoryHistoryBackend::AttachToHistoryService(Profile* profile) {
@@ -105,7 +111,13 @@ void InMemoryHistoryBackend::OnTypedURLsModified(
     if (id)
       db_->UpdateURLRow(id, *i);
     else
-      db_->AddURL(*i);
+      id = db_->AddURL(*i);
+
+    // Give the index the row as the in-memory database has it, so both use
+    // the same IDs.
+    URLRow row;
+    if (id && db_->GetURLRow(id, &row))
+      index_->AddOrUpdateURL(row);
   }
 }
 
@@ -118,6 +130,7 @@ void InMemoryHistoryBackend::OnURLsDeleted(const URLsDeletedDetails& details) {
     db_.reset(new InMemoryDatabase);
     if (!db_->InitFromScratch())
       db_.reset();
+    index_->Clear();
     return;
   }
 
@@ -130,6 +143,7 @@ void InMemoryHistoryBackend::OnURLsDeleted(const URLsDeletedDetails& details) {
       // history, so ignore errors.
       db_->DeleteURLRow(id);
     }
+    index_->DeleteURL(*i);
   }
 }
 
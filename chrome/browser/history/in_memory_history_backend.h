@@ -25,6 +25,7 @@ class Profile;
 namespace history {
 
 class InMemoryDatabase;
+class InMemoryURLIndex;
 
 class InMemoryHistoryBackend : public NotificationObserver {
  public:
@@ -46,6 +47,12 @@ class InMemoryHistoryBackend : public NotificationObserver {
     return db_.get();
   }
 
+  // Returns the index of the URLs in db(), which answers autocomplete queries
+  // without going through SQLite.
+  InMemoryURLIndex* index() const {
+    return index_.get();
+  }
+
   // Notification callback.
   virtual void Observe(NotificationType type,
                        const NotificationSource& source,
@@ -61,6 +68,7 @@ class InMemoryHistoryBackend : public NotificationObserver {
   void OnURLsDeleted(const URLsDeletedDetails& details);
 
   scoped_ptr<InMemoryDatabase> db_;
+  scoped_ptr<InMemoryURLIndex> index_;
 
   // The profile that this object is attached. May be NULL before
   // initialization.
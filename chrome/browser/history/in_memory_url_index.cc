@@ -0,0 +1,661 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/history/in_memory_url_index.h"
+
+#include <algorithm>
+#include <set>
+
+#include "base/logging.h"
+#include "base/string_util.h"
+#include "base/word_iterator.h"
+#include "chrome/browser/history/url_database.h"
+#include "chrome/common/l10n_util.h"
+#include "chrome/common/stl_util-inl.h"
+#include "googleurl/src/gurl.h"
+
+namespace history {
+
+namespace {
+
+// The number of entries in each block when the list is built all at once.
+// Blocks that grow to twice this are split in two.
+const size_t kBlockSize = 16;
+const size_t kMaxBlockSize = 2 * kBlockSize;
+
+// What autocomplete results are sorted by.
+struct Rank {
+  Rank() : typed_count(0), visit_count(0), last_visit(0) {
+  }
+
+  int typed_count;
+  int visit_count;
+  int64 last_visit;
+};
+
+// Typed count first, then visit count, then most recent first.
+bool IsHigherRank(const Rank& a, const Rank& b) {
+  if (a.typed_count != b.typed_count)
+    return a.typed_count > b.typed_count;
+  if (a.visit_count != b.visit_count)
+    return a.visit_count > b.visit_count;
+  return a.last_visit > b.last_visit;
+}
+
+void AppendVarint(uint64 value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+uint64 ReadVarint(const char** pos) {
+  uint64 value = 0;
+  for (int shift = 0; ; shift += 7) {
+    unsigned char c = static_cast<unsigned char>(*(*pos)++);
+    value |= static_cast<uint64>(c & 0x7F) << shift;
+    if (!(c & 0x80))
+      return value;
+  }
+}
+
+// The values of both lists start with the row's rank and hidden flag, so the
+// blocks of either list can be ranked without looking anything up.
+void AppendRank(const URLRow& row, std::string* value) {
+  AppendVarint(static_cast<uint32>(row.typed_count()), value);
+  AppendVarint(static_cast<uint32>(row.visit_count()), value);
+  AppendVarint(static_cast<uint64>(row.last_visit().ToInternalValue()),
+               value);
+  value->push_back(row.hidden() ? 1 : 0);
+}
+
+// Reads the rank that AppendRank() wrote at |*pos|, and moves |*pos| past it.
+// Returns false if the row is hidden.
+bool ReadRank(const char** pos, Rank* rank) {
+  rank->typed_count = static_cast<int>(static_cast<uint32>(ReadVarint(pos)));
+  rank->visit_count = static_cast<int>(static_cast<uint32>(ReadVarint(pos)));
+  rank->last_visit = static_cast<int64>(ReadVarint(pos));
+  return *(*pos)++ == 0;
+}
+
+// A urls_ value is the rank, then the row's ID and its title in UTF-8.
+std::string PackRow(const URLRow& row) {
+  std::string value;
+  AppendRank(row, &value);
+  AppendVarint(static_cast<uint64>(row.id()), &value);
+  value.append(WideToUTF8(row.title()));
+  return value;
+}
+
+struct UnpackedRow {
+  explicit UnpackedRow(const std::string& value) {
+    const char* pos = value.data();
+    hidden = !ReadRank(&pos, &rank);
+    rank_value.assign(value.data(), pos - value.data());
+    id = static_cast<URLID>(ReadVarint(&pos));
+    title.assign(pos, value.data() + value.size() - pos);
+  }
+
+  Rank rank;
+  bool hidden;
+
+  // The packed rank, which is the value of the row's title word entries.
+  std::string rank_value;
+
+  URLID id;
+  std::string title;
+};
+
+// Fills |words| with the distinct words of |title|, in lower case UTF-8.
+void GetTitleWords(const std::string& title, std::set<std::string>* words) {
+  if (title.empty())
+    return;
+  std::wstring lower_title = l10n_util::ToLower(UTF8ToWide(title));
+  WordIterator iter(lower_title, WordIterator::BREAK_WORD);
+  if (!iter.Init())
+    return;
+  while (iter.Advance()) {
+    if (iter.IsWord()) {
+      std::wstring word = iter.GetWord();
+      if (!word.empty())
+        words->insert(WideToUTF8(word));
+    }
+  }
+}
+
+std::string TitleWordKey(const std::string& word, const std::string& url) {
+  std::string key(word);
+  key.push_back('\0');
+  key.append(url);
+  return key;
+}
+
+// Collects the URLs of the best ranked entries seen so far, best first.
+class BestEntries {
+ public:
+  explicit BestEntries(size_t max_size) : max_size_(max_size) {
+    DCHECK(max_size_ > 0);
+  }
+
+  // Returns whether an entry of |rank| would make the list.
+  bool WouldKeep(const Rank& rank) const {
+    return entries_.size() < max_size_ ||
+        IsHigherRank(rank, entries_.back().rank);
+  }
+
+  void Add(const Rank& rank, const std::string& url) {
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      if (entries_[i].url == url)
+        return;
+    }
+    Entry entry;
+    entry.rank = rank;
+    entry.url = url;
+    entries_.insert(std::upper_bound(entries_.begin(), entries_.end(), entry,
+                                     &Entry::IsHigher),
+                    entry);
+    if (entries_.size() > max_size_)
+      entries_.pop_back();
+  }
+
+  void GetURLs(std::vector<std::string>* urls) const {
+    for (size_t i = 0; i < entries_.size(); ++i)
+      urls->push_back(entries_[i].url);
+  }
+
+ private:
+  struct Entry {
+    static bool IsHigher(const Entry& a, const Entry& b) {
+      return IsHigherRank(a.rank, b.rank);
+    }
+
+    Rank rank;
+    std::string url;
+  };
+
+  const size_t max_size_;
+  std::vector<Entry> entries_;
+};
+
+}  // namespace
+
+// A sorted list of string keys and values, stored front coded in blocks.
+class InMemoryURLIndex::CompressedList {
+ public:
+  struct Entry {
+    Entry() {
+    }
+    Entry(const std::string& key, const std::string& value)
+        : key(key),
+          value(value) {
+    }
+
+    static bool KeyLessThan(const Entry& a, const Entry& b) {
+      return a.key < b.key;
+    }
+    static bool KeyEquals(const Entry& a, const Entry& b) {
+      return a.key == b.key;
+    }
+
+    std::string key;
+    std::string value;
+  };
+
+  struct Block {
+    // The key of the first entry, which |data| doesn't repeat.
+    std::string first_key;
+
+    // For each entry, the number of chars its key shares with the previous
+    // key, the number of chars that follow, those chars, the size of the
+    // value and the value, with the numbers as varints.
+    std::string data;
+
+    size_t size;
+
+    // The best rank of the non-hidden entries.  |has_rank| is false when
+    // there are none.
+    bool has_rank;
+    Rank best_rank;
+  };
+
+  // Decodes the entries of a block in order.
+  class Reader {
+   public:
+    explicit Reader(const Block& block)
+        : pos_(block.data.data()),
+          end_(block.data.data() + block.data.size()),
+          key_(block.first_key),
+          value_(NULL),
+          value_size_(0) {
+    }
+
+    // Moves to the next entry.  Returns false when there are no more.
+    bool Next() {
+      if (pos_ == end_)
+        return false;
+      size_t shared = static_cast<size_t>(ReadVarint(&pos_));
+      size_t suffix_size = static_cast<size_t>(ReadVarint(&pos_));
+      key_.resize(shared);
+      key_.append(pos_, suffix_size);
+      pos_ += suffix_size;
+      value_size_ = static_cast<size_t>(ReadVarint(&pos_));
+      value_ = pos_;
+      pos_ += value_size_;
+      return true;
+    }
+
+    const std::string& key() const { return key_; }
+    const char* value() const { return value_; }
+    size_t value_size() const { return value_size_; }
+
+   private:
+    const char* pos_;
+    const char* end_;
+    std::string key_;
+    const char* value_;
+    size_t value_size_;
+
+    DISALLOW_COPY_AND_ASSIGN(Reader);
+  };
+
+  CompressedList() : size_(0) {
+  }
+  ~CompressedList() {
+    STLDeleteElements(&blocks_);
+  }
+
+  // Replaces the contents of the list with |entries|, which this sorts.
+  void Reset(std::vector<Entry>* entries) {
+    Clear();
+    std::sort(entries->begin(), entries->end(), &Entry::KeyLessThan);
+    entries->erase(std::unique(entries->begin(), entries->end(),
+                               &Entry::KeyEquals),
+                   entries->end());
+    size_ = entries->size();
+    blocks_.reserve((size_ + kBlockSize - 1) / kBlockSize);
+    for (size_t i = 0; i < size_; i += kBlockSize) {
+      Block* block = new Block;
+      const Entry* begin = &(*entries)[i];
+      EncodeBlock(begin, begin + std::min(kBlockSize, size_ - i), block);
+      blocks_.push_back(block);
+    }
+  }
+
+  void Clear() {
+    STLDeleteElements(&blocks_);
+    size_ = 0;
+  }
+
+  bool Find(const std::string& key, std::string* value) const {
+    if (blocks_.empty())
+      return false;
+    Reader reader(*blocks_[FindBlock(key)]);
+    while (reader.Next()) {
+      int result = reader.key().compare(key);
+      if (result == 0) {
+        value->assign(reader.value(), reader.value_size());
+        return true;
+      }
+      if (result > 0)
+        break;
+    }
+    return false;
+  }
+
+  // Adds the entry, replacing the value if |key| is already present.
+  void Insert(const std::string& key, const std::string& value) {
+    Entry entry(key, value);
+    if (blocks_.empty()) {
+      Block* block = new Block;
+      EncodeBlock(&entry, &entry + 1, block);
+      blocks_.push_back(block);
+      size_ = 1;
+      return;
+    }
+
+    size_t index = FindBlock(key);
+    std::vector<Entry> entries;
+    DecodeBlock(*blocks_[index], &entries);
+    std::vector<Entry>::iterator i = std::lower_bound(
+        entries.begin(), entries.end(), entry, &Entry::KeyLessThan);
+    if (i != entries.end() && i->key == key) {
+      i->value = value;
+    } else {
+      entries.insert(i, entry);
+      size_++;
+    }
+
+    if (entries.size() <= kMaxBlockSize) {
+      EncodeBlock(&entries[0], &entries[0] + entries.size(), blocks_[index]);
+      return;
+    }
+    size_t half = entries.size() / 2;
+    Block* next = new Block;
+    EncodeBlock(&entries[half], &entries[0] + entries.size(), next);
+    EncodeBlock(&entries[0], &entries[half], blocks_[index]);
+    blocks_.insert(blocks_.begin() + index + 1, next);
+  }
+
+  void Erase(const std::string& key) {
+    if (blocks_.empty())
+      return;
+    size_t index = FindBlock(key);
+    std::vector<Entry> entries;
+    DecodeBlock(*blocks_[index], &entries);
+    std::vector<Entry>::iterator i = std::lower_bound(
+        entries.begin(), entries.end(), Entry(key, std::string()),
+        &Entry::KeyLessThan);
+    if (i == entries.end() || i->key != key)
+      return;
+    entries.erase(i);
+    size_--;
+
+    if (entries.empty()) {
+      delete blocks_[index];
+      blocks_.erase(blocks_.begin() + index);
+    } else {
+      EncodeBlock(&entries[0], &entries[0] + entries.size(), blocks_[index]);
+    }
+  }
+
+  // Adds the URLs of the best ranked entries whose keys begin with |prefix|
+  // to |best|.  Title word keys have their word taken off.
+  void FindBestEntries(const std::string& prefix,
+                       bool title_word_keys,
+                       BestEntries* best) const {
+    if (blocks_.empty())
+      return;
+    size_t first_block = FindBlock(prefix);
+    for (size_t i = first_block; i < blocks_.size(); ++i) {
+      const Block& block = *blocks_[i];
+      if (i != first_block &&
+          block.first_key.compare(0, prefix.size(), prefix) != 0)
+        return;
+      // Nothing in this block can make the list.
+      if (!block.has_rank || !best->WouldKeep(block.best_rank))
+        continue;
+
+      Reader reader(block);
+      while (reader.Next()) {
+        int result = reader.key().compare(0, prefix.size(), prefix);
+        if (result < 0)
+          continue;
+        if (result > 0)
+          return;
+        Rank rank;
+        const char* pos = reader.value();
+        if (!ReadRank(&pos, &rank) || !best->WouldKeep(rank))
+          continue;
+        if (title_word_keys) {
+          const std::string& key = reader.key();
+          best->Add(rank, key.substr(key.find('\0') + 1));
+        } else {
+          best->Add(rank, reader.key());
+        }
+      }
+    }
+  }
+
+  size_t size() const { return size_; }
+
+  size_t EstimateMemoryUsage() const {
+    size_t usage = blocks_.capacity() * sizeof(Block*);
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+      usage += sizeof(Block) + blocks_[i]->first_key.capacity() +
+          blocks_[i]->data.capacity();
+    }
+    return usage;
+  }
+
+
+ private:
+  // Returns the last block whose first key is at or before |key|, which is
+  // where |key| is or would go, or the first block.
+  size_t FindBlock(const std::string& key) const {
+    DCHECK(!blocks_.empty());
+    std::vector<Block*>::const_iterator i = std::upper_bound(
+        blocks_.begin(), blocks_.end(), key, &KeyLessThanBlock);
+    return i == blocks_.begin() ? 0 : i - blocks_.begin() - 1;
+  }
+
+  static bool KeyLessThanBlock(const std::string& key, const Block* block) {
+    return key < block->first_key;
+  }
+
+  static void DecodeBlock(const Block& block, std::vector<Entry>* entries) {
+    entries->reserve(block.size + 1);
+    Reader reader(block);
+    while (reader.Next()) {
+      entries->push_back(Entry(reader.key(),
+                               std::string(reader.value(),
+                                           reader.value_size())));
+    }
+  }
+
+  // Encodes the sorted entries [begin, end) into |block|.
+  static void EncodeBlock(const Entry* begin, const Entry* end,
+                          Block* block) {
+    DCHECK(begin < end);
+    block->first_key = begin->key;
+    block->size = end - begin;
+    block->has_rank = false;
+
+    std::string data;
+    const std::string* previous_key = &begin->key;
+    for (const Entry* i = begin; i != end; ++i) {
+      size_t shared = 0;
+      size_t max_shared = std::min(previous_key->size(), i->key.size());
+      while (shared < max_shared && (*previous_key)[shared] == i->key[shared])
+        shared++;
+      AppendVarint(shared, &data);
+      AppendVarint(i->key.size() - shared, &data);
+      data.append(i->key, shared, std::string::npos);
+      AppendVarint(i->value.size(), &data);
+      data.append(i->value);
+      previous_key = &i->key;
+
+      Rank rank;
+      const char* pos = i->value.data();
+      if (ReadRank(&pos, &rank) &&
+          (!block->has_rank || IsHigherRank(rank, block->best_rank))) {
+        block->has_rank = true;
+        block->best_rank = rank;
+      }
+    }
+    // Copying drops the spare capacity left from appending.
+    block->data = std::string(data.data(), data.size());
+  }
+
+  std::vector<Block*> blocks_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompressedList);
+};
+
+InMemoryURLIndex::InMemoryURLIndex()
+    : urls_(new CompressedList),
+      title_words_(new CompressedList) {
+}
+
+InMemoryURLIndex::~InMemoryURLIndex() {
+}
+
+void InMemoryURLIndex::Init(URLDatabase* db) {
+  std::vector<CompressedList::Entry> urls;
+  std::vector<CompressedList::Entry> title_words;
+
+  URLDatabase::URLEnumerator enumerator;
+  if (db->InitURLEnumeratorForEverything(&enumerator)) {
+    URLRow row;
+    while (enumerator.GetNextURL(&row)) {
+      if (!row.url().is_valid())
+        continue;
+      std::string key = URLDatabase::GURLToDatabaseURL(row.url());
+      urls.push_back(CompressedList::Entry(key, PackRow(row)));
+
+      UnpackedRow unpacked(urls.back().value);
+      std::set<std::string> words;
+      GetTitleWords(unpacked.title, &words);
+      for (std::set<std::string>::const_iterator i = words.begin();
+           i != words.end(); ++i) {
+        title_words.push_back(CompressedList::Entry(TitleWordKey(*i, key),
+                                                    unpacked.rank_value));
+      }
+    }
+  }
+
+  urls_->Reset(&urls);
+  title_words_->Reset(&title_words);
+}
+
+void InMemoryURLIndex::AddOrUpdateURL(const URLRow& row) {
+  if (!row.url().is_valid())
+    return;
+  std::string key = URLDatabase::GURLToDatabaseURL(row.url());
+  std::string old_value;
+  if (urls_->Find(key, &old_value))
+    RemoveTitleWords(key, old_value);
+
+  std::string value = PackRow(row);
+  urls_->Insert(key, value);
+  AddTitleWords(key, value);
+}
+
+void InMemoryURLIndex::DeleteURL(const GURL& url) {
+  std::string key = URLDatabase::GURLToDatabaseURL(url);
+  std::string value;
+  if (!urls_->Find(key, &value))
+    return;
+  RemoveTitleWords(key, value);
+  urls_->Erase(key);
+}
+
+void InMemoryURLIndex::Clear() {
+  urls_->Clear();
+  title_words_->Clear();
+}
+
+size_t InMemoryURLIndex::url_count() const {
+  return urls_->size();
+}
+
+size_t InMemoryURLIndex::EstimateMemoryUsage() const {
+  return urls_->EstimateMemoryUsage() + title_words_->EstimateMemoryUsage();
+}
+
+void InMemoryURLIndex::TitleWordMatches(const std::wstring& term,
+                                        size_t max_results,
+                                        std::vector<URLRow>* results) {
+  results->clear();
+  std::string word = WideToUTF8(l10n_util::ToLower(term));
+  if (word.empty() || !max_results)
+    return;
+
+  BestEntries best(max_results);
+  title_words_->FindBestEntries(word, true, &best);
+  std::vector<std::string> urls;
+  best.GetURLs(&urls);
+  FillResults(urls, results);
+}
+
+URLID InMemoryURLIndex::GetRowForURL(const GURL& url, URLRow* info) {
+  std::string key = URLDatabase::GURLToDatabaseURL(url);
+  std::string value;
+  if (!urls_->Find(key, &value))
+    return 0;
+  if (info)
+    FillURLRow(key, value, info);
+  return UnpackedRow(value).id;
+}
+
+void InMemoryURLIndex::AutocompleteForPrefix(const std::wstring& prefix,
+                                             size_t max_results,
+                                             std::vector<URLRow>* results) {
+  results->clear();
+  if (!max_results)
+    return;
+
+  BestEntries best(max_results);
+  urls_->FindBestEntries(WideToUTF8(prefix), false, &best);
+  std::vector<std::string> urls;
+  best.GetURLs(&urls);
+  FillResults(urls, results);
+}
+
+bool InMemoryURLIndex::FindShortestURLFromBase(const std::string& base,
+                                               const std::string& url,
+                                               int min_visits,
+                                               int min_typed,
+                                               bool allow_base,
+                                               URLRow* info) {
+  // The candidates are the strict prefixes of |url|, shortest first.
+  for (size_t length = 1; length < url.size(); ++length) {
+    std::string candidate(url, 0, length);
+    int result = candidate.compare(base);
+    if (result < 0 || (result == 0 && !allow_base))
+      continue;
+
+    std::string value;
+    if (!urls_->Find(candidate, &value))
+      continue;
+    UnpackedRow unpacked(value);
+    if (unpacked.hidden || unpacked.rank.visit_count < min_visits ||
+        unpacked.rank.typed_count < min_typed)
+      continue;
+
+    DCHECK(info);
+    FillURLRow(candidate, value, info);
+    return true;
+  }
+  return false;
+}
+
+// static
+void InMemoryURLIndex::FillURLRow(const std::string& key,
+                                  const std::string& value,
+                                  URLRow* row) {
+  UnpackedRow unpacked(value);
+  *row = URLRow(GURL(key));
+  row->id_ = unpacked.id;
+  row->set_title(UTF8ToWide(unpacked.title));
+  row->set_visit_count(unpacked.rank.visit_count);
+  row->set_typed_count(unpacked.rank.typed_count);
+  row->set_last_visit(Time::FromInternalValue(unpacked.rank.last_visit));
+  row->set_hidden(unpacked.hidden);
+}
+
+void InMemoryURLIndex::FillResults(const std::vector<std::string>& keys,
+                                   std::vector<URLRow>* results) const {
+  for (size_t i = 0; i < keys.size(); ++i) {
+    std::string value;
+    if (!urls_->Find(keys[i], &value)) {
+      NOTREACHED();
+      continue;
+    }
+    results->push_back(URLRow());
+    FillURLRow(keys[i], value, &results->back());
+  }
+}
+
+void InMemoryURLIndex::AddTitleWords(const std::string& key,
+                                     const std::string& value) {
+  UnpackedRow unpacked(value);
+  std::set<std::string> words;
+  GetTitleWords(unpacked.title, &words);
+  for (std::set<std::string>::const_iterator i = words.begin();
+       i != words.end(); ++i)
+    title_words_->Insert(TitleWordKey(*i, key), unpacked.rank_value);
+}
+
+void InMemoryURLIndex::RemoveTitleWords(const std::string& key,
+                                        const std::string& value) {
+  std::set<std::string> words;
+  GetTitleWords(UnpackedRow(value).title, &words);
+  for (std::set<std::string>::const_iterator i = words.begin();
+       i != words.end(); ++i)
+    title_words_->Erase(TitleWordKey(*i, key));
+}
+
+}  // namespace history
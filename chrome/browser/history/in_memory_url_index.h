@@ -0,0 +1,107 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_HISTORY_IN_MEMORY_URL_INDEX_H__
+#define CHROME_BROWSER_HISTORY_IN_MEMORY_URL_INDEX_H__
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/scoped_ptr.h"
+#include "chrome/browser/history/history_types.h"
+#include "chrome/browser/history/url_autocomplete_source.h"
+
+class GURL;
+
+namespace history {
+
+class URLDatabase;
+
+// An index of the typed URLs that answers HistoryURLProvider's queries from
+// memory, without going through SQLite.  InMemoryHistoryBackend keeps it in
+// sync with the history database.
+//
+// The URLs are kept sorted, in blocks of up to a few dozen.  Within a block
+// each URL is stored as the length of the prefix it shares with the URL
+// before it and the rest of it, followed by the row's counts and title packed
+// as varints.  Typed URLs share long prefixes, so this is much smaller than
+// the rows.  A lookup binary searches the blocks' first URLs, which are kept
+// whole, and decodes a single block.  Each block also records the best typed
+// count, visit count and visit time among its rows, so a prefix query can
+// pass over the blocks that have nothing good enough for its results.
+//
+// The title index is a second list of the same form, holding a
+// "word\0url" key for each word of each title.
+class InMemoryURLIndex : public URLAutocompleteSource {
+ public:
+  InMemoryURLIndex();
+  virtual ~InMemoryURLIndex();
+
+  // Replaces the contents of the index with all the URLs in |db|.
+  void Init(URLDatabase* db);
+
+  // Adds |row|, or replaces the row with the same URL.  Rows with invalid
+  // URLs are ignored.
+  void AddOrUpdateURL(const URLRow& row);
+
+  // Removes the row for |url|, if there is one.
+  void DeleteURL(const GURL& url);
+
+  // Removes all the rows.
+  void Clear();
+
+  // The number of rows in the index.
+  size_t url_count() const;
+
+  // Roughly how many bytes the index is using.
+  size_t EstimateMemoryUsage() const;
+
+  // Fills |results| with the non-hidden URLs whose title has a word beginning
+  // with |term|, ignoring case.  They are sorted the same way as for
+  // AutocompleteForPrefix().
+  void TitleWordMatches(const std::wstring& term,
+                        size_t max_results,
+                        std::vector<URLRow>* results);
+
+  // URLAutocompleteSource
+  virtual URLID GetRowForURL(const GURL& url, URLRow* info);
+  virtual void AutocompleteForPrefix(const std::wstring& prefix,
+                                     size_t max_results,
+                                     std::vector<URLRow>* results);
+  virtual bool FindShortestURLFromBase(const std::string& base,
+                                       const std::string& url,
+                                       int min_visits,
+                                       int min_typed,
+                                       bool allow_base,
+                                       URLRow* info);
+
+ private:
+  class CompressedList;
+
+  // Unpacks the row stored under |key| with |value| into |row|.
+  static void FillURLRow(const std::string& key, const std::string& value,
+                         URLRow* row);
+
+  // Looks up each of |keys| in urls_ and fills |results| with the rows.
+  void FillResults(const std::vector<std::string>& keys,
+                   std::vector<URLRow>* results) const;
+
+  // Adds or removes the title word entries for the row stored under |key|
+  // with |value|.
+  void AddTitleWords(const std::string& key, const std::string& value);
+  void RemoveTitleWords(const std::string& key, const std::string& value);
+
+  // URL spec -> packed row.
+  scoped_ptr<CompressedList> urls_;
+
+  // Lower case title word, '\0', URL spec -> the row's rank.
+  scoped_ptr<CompressedList> title_words_;
+
+  DISALLOW_COPY_AND_ASSIGN(InMemoryURLIndex);
+};
+
+}  // namespace history
+
+#endif  // CHROME_BROWSER_HISTORY_IN_MEMORY_URL_INDEX_H__
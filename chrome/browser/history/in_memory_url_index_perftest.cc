@@ -0,0 +1,152 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/perftimer.h"
+#include "base/string_util.h"
+#include "chrome/browser/history/in_memory_database.h"
+#include "chrome/browser/history/in_memory_url_index.h"
+#include "googleurl/src/gurl.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kURLCount = 500000;
+
+// The number of URLs whose hosts are typed out, one keystroke at a time.
+const int kTypedURLCount = 200;
+const size_t kMaxTypedLength = 12;
+
+// What HistoryURLProvider asks for on each keystroke.
+const size_t kMaxResults = 6;
+const wchar_t* const kSchemePrefixes[] = {
+  L"https://www.", L"http://www.", L"ftp://ftp.", L"ftp://", L"https://",
+  L"http://", L"",
+};
+
+const char* const kSyllables[] = {
+  "ba", "co", "de", "fi", "go", "ha", "ji", "ka", "lo", "me", "ni", "op",
+  "pu", "qua", "ro", "sa", "te", "ul", "vi", "wo", "xe", "yo", "zu", "an",
+};
+
+const char* const kDomains[] = { ".com", ".org", ".net", ".co.uk", ".de" };
+
+// A fixed sequence of pseudo-random numbers, so each run sees the same
+// history.
+class Random {
+ public:
+  Random() : seed_(0x12345678) {
+  }
+  int Next(int range) {
+    seed_ = seed_ * 1103515245 + 12345;
+    return static_cast<int>((seed_ >> 16) % range);
+  }
+
+ private:
+  uint32 seed_;
+};
+
+std::string Word(Random* random) {
+  std::string word;
+  int syllables = 2 + random->Next(3);
+  for (int i = 0; i < syllables; ++i)
+    word.append(kSyllables[random->Next(arraysize(kSyllables))]);
+  return word;
+}
+
+// Fills |rows| with a history of |count| URLs on |count| / 50 sites, with the
+// counts skewed so that a few URLs are typed a lot.
+void MakeHistory(int count, std::vector<history::URLRow>* rows) {
+  Random random;
+  std::vector<std::string> hosts;
+  for (int i = 0; i < count / 50; ++i) {
+    hosts.push_back((random.Next(3) ? "www." : "") + Word(&random) +
+                    kDomains[random.Next(arraysize(kDomains))]);
+  }
+
+  Time now = Time::Now();
+  for (int i = 0; i < count; ++i) {
+    const std::string& host = hosts[random.Next(hosts.size()) %
+                                    (1 + random.Next(hosts.size()))];
+    std::string spec((random.Next(10) ? "http://" : "https://") + host + "/");
+    if (random.Next(8))
+      spec.append(Word(&random) + "/" + IntToString(i));
+
+    history::URLRow row((GURL(spec)));
+    row.set_title(UTF8ToWide(Word(&random) + " " + Word(&random) + " " +
+                             Word(&random)));
+    int typed_count = 1 + random.Next(100) / (1 + random.Next(50));
+    row.set_typed_count(typed_count);
+    row.set_visit_count(typed_count + random.Next(200));
+    row.set_last_visit(now - TimeDelta::FromMinutes(random.Next(500000)));
+    rows->push_back(row);
+  }
+}
+
+// Returns the text of each keystroke when typing the hosts of some of |rows|.
+void MakeKeystrokes(const std::vector<history::URLRow>& rows,
+                    std::vector<std::wstring>* keystrokes) {
+  Random random;
+  for (int i = 0; i < kTypedURLCount; ++i) {
+    std::string host = rows[random.Next(rows.size())].url().host();
+    if (StartsWithASCII(host, "www.", true))
+      host.erase(0, 4);
+    for (size_t length = 1; length <= std::min(host.size(), kMaxTypedLength);
+         ++length)
+      keystrokes->push_back(UTF8ToWide(host.substr(0, length)));
+  }
+}
+
+// Runs every keystroke against |source| the way HistoryURLProvider's
+// synchronous pass does, and logs the average time for each one.
+void ReplayKeystrokes(history::URLAutocompleteSource* source,
+                      const std::vector<std::wstring>& keystrokes,
+                      const char* test_name) {
+  PerfTimer timer;
+  std::vector<history::URLRow> results;
+  for (size_t i = 0; i < keystrokes.size(); ++i) {
+    for (size_t j = 0; j < arraysize(kSchemePrefixes); ++j) {
+      source->AutocompleteForPrefix(kSchemePrefixes[j] + keystrokes[i],
+                                    kMaxResults * 2, &results);
+    }
+  }
+  LogPerfResult(test_name,
+                timer.Elapsed().InMillisecondsF() / keystrokes.size(), "ms");
+}
+
+}  // namespace
+
+TEST(InMemoryURLIndexPerfTest, TypedQueries) {
+  std::vector<history::URLRow> rows;
+  MakeHistory(kURLCount, &rows);
+  std::vector<std::wstring> keystrokes;
+  MakeKeystrokes(rows, &keystrokes);
+
+  history::InMemoryDatabase db;
+  ASSERT_TRUE(db.InitFromScratch());
+  for (size_t i = 0; i < rows.size(); ++i)
+    db.AddURL(rows[i]);
+
+  history::InMemoryURLIndex index;
+  PerfTimeLogger init_timer("InMemoryURLIndex_init_500k");
+  index.Init(&db);
+  init_timer.Done();
+  LogPerfResult("InMemoryURLIndex_memory_500k",
+                index.EstimateMemoryUsage() / 1024.0, "KB");
+
+  ReplayKeystrokes(&db, keystrokes, "InMemoryDatabase_keystroke_500k");
+  ReplayKeystrokes(&index, keystrokes, "InMemoryURLIndex_keystroke_500k");
+
+  // Title words, typed the same way.
+  PerfTimer title_timer;
+  std::vector<history::URLRow> results;
+  for (size_t i = 0; i < keystrokes.size(); ++i)
+    index.TitleWordMatches(keystrokes[i], kMaxResults, &results);
+  LogPerfResult("InMemoryURLIndex_title_keystroke_500k",
+                title_timer.Elapsed().InMillisecondsF() / keystrokes.size(),
+                "ms");
+}
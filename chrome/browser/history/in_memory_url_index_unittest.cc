@@ -0,0 +1,210 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/string_util.h"
+#include "chrome/browser/history/in_memory_database.h"
+#include "chrome/browser/history/in_memory_url_index.h"
+#include "googleurl/src/gurl.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace history {
+
+namespace {
+
+URLRow MakeRow(const char* url, const wchar_t* title,
+               int typed_count, int visit_count) {
+  URLRow row((GURL(url)));
+  row.set_title(title);
+  row.set_typed_count(typed_count);
+  row.set_visit_count(visit_count);
+  row.set_last_visit(Time::Now());
+  return row;
+}
+
+std::vector<std::string> Specs(const std::vector<URLRow>& rows) {
+  std::vector<std::string> specs;
+  for (size_t i = 0; i < rows.size(); ++i)
+    specs.push_back(rows[i].url().spec());
+  return specs;
+}
+
+}  // namespace
+
+TEST(InMemoryURLIndexTest, GetRowForURL) {
+  InMemoryURLIndex index;
+  URLRow row(MakeRow("http://www.google.com/", L"Google", 2, 4));
+  row.set_hidden(true);
+  index.AddOrUpdateURL(row);
+  EXPECT_EQ(1U, index.url_count());
+
+  URLRow info;
+  EXPECT_EQ(0, index.GetRowForURL(GURL("http://www.google.com/a"), &info));
+  index.GetRowForURL(GURL("http://www.google.com/"), &info);
+  EXPECT_EQ(row.url(), info.url());
+  EXPECT_EQ(L"Google", info.title());
+  EXPECT_EQ(2, info.typed_count());
+  EXPECT_EQ(4, info.visit_count());
+  EXPECT_TRUE(row.last_visit() == info.last_visit());
+  EXPECT_TRUE(info.hidden());
+
+  // Updating replaces the row rather than adding another.
+  row.set_title(L"Google Search");
+  row.set_typed_count(3);
+  index.AddOrUpdateURL(row);
+  EXPECT_EQ(1U, index.url_count());
+  index.GetRowForURL(GURL("http://www.google.com/"), &info);
+  EXPECT_EQ(L"Google Search", info.title());
+  EXPECT_EQ(3, info.typed_count());
+
+  index.DeleteURL(GURL("http://www.google.com/"));
+  EXPECT_EQ(0U, index.url_count());
+  EXPECT_EQ(0, index.GetRowForURL(GURL("http://www.google.com/"), NULL));
+}
+
+// Results are sorted by typed count, then visit count, then visit time, and
+// hidden rows are left out, the same as URLDatabase::AutocompleteForPrefix.
+TEST(InMemoryURLIndexTest, AutocompleteForPrefix) {
+  InMemoryURLIndex index;
+  index.AddOrUpdateURL(MakeRow("http://www.google.com/", L"", 1, 10));
+  index.AddOrUpdateURL(MakeRow("http://www.google.com/a", L"", 3, 1));
+  index.AddOrUpdateURL(MakeRow("http://www.google.com/b", L"", 1, 20));
+  index.AddOrUpdateURL(MakeRow("http://www.googlf.com/", L"", 9, 9));
+  index.AddOrUpdateURL(MakeRow("http://www.goog.com/", L"", 9, 9));
+  URLRow hidden(MakeRow("http://www.google.com/c", L"", 5, 5));
+  hidden.set_hidden(true);
+  index.AddOrUpdateURL(hidden);
+
+  std::vector<URLRow> results;
+  index.AutocompleteForPrefix(L"http://www.google.", 10, &results);
+  std::vector<std::string> specs(Specs(results));
+  ASSERT_EQ(3U, specs.size());
+  EXPECT_EQ("http://www.google.com/a", specs[0]);
+  EXPECT_EQ("http://www.google.com/b", specs[1]);
+  EXPECT_EQ("http://www.google.com/", specs[2]);
+
+  index.AutocompleteForPrefix(L"http://www.google.", 2, &results);
+  EXPECT_EQ(2U, results.size());
+
+  index.AutocompleteForPrefix(L"http://www.goo", 10, &results);
+  EXPECT_EQ(5U, results.size());
+
+  index.AutocompleteForPrefix(L"http://www.googlez", 10, &results);
+  EXPECT_TRUE(results.empty());
+}
+
+TEST(InMemoryURLIndexTest, FindShortestURLFromBase) {
+  InMemoryURLIndex index;
+  index.AddOrUpdateURL(MakeRow("http://foo.com/", L"", 1, 1));
+  index.AddOrUpdateURL(MakeRow("http://foo.com/a", L"", 0, 5));
+  index.AddOrUpdateURL(MakeRow("http://foo.com/a/b", L"", 1, 5));
+  index.AddOrUpdateURL(MakeRow("http://foo.com/a/b/c", L"", 1, 5));
+
+  URLRow info;
+  const std::string url("http://foo.com/a/b/c");
+  ASSERT_TRUE(index.FindShortestURLFromBase("http://foo.com/", url, 0, 0, true,
+                                            &info));
+  EXPECT_EQ("http://foo.com/", info.url().spec());
+  ASSERT_TRUE(index.FindShortestURLFromBase("http://foo.com/", url, 0, 0,
+                                            false, &info));
+  EXPECT_EQ("http://foo.com/a", info.url().spec());
+  ASSERT_TRUE(index.FindShortestURLFromBase("http://foo.com/", url, 2, 1,
+                                            false, &info));
+  EXPECT_EQ("http://foo.com/a/b", info.url().spec());
+
+  // |url| itself doesn't count.
+  EXPECT_FALSE(index.FindShortestURLFromBase("http://foo.com/a/b/", url, 0, 0,
+                                             true, &info));
+}
+
+TEST(InMemoryURLIndexTest, TitleWordMatches) {
+  InMemoryURLIndex index;
+  index.AddOrUpdateURL(MakeRow("http://a.com/", L"Cheap Flights", 1, 1));
+  index.AddOrUpdateURL(MakeRow("http://b.com/", L"flight status", 2, 1));
+  index.AddOrUpdateURL(MakeRow("http://c.com/", L"Inflight magazine", 3, 1));
+
+  std::vector<URLRow> results;
+  index.TitleWordMatches(L"FLIGHT", 10, &results);
+  std::vector<std::string> specs(Specs(results));
+  ASSERT_EQ(2U, specs.size());
+  EXPECT_EQ("http://b.com/", specs[0]);
+  EXPECT_EQ("http://a.com/", specs[1]);
+
+  // Title changes and deletions are reflected.
+  index.AddOrUpdateURL(MakeRow("http://b.com/", L"Status", 2, 1));
+  index.DeleteURL(GURL("http://a.com/"));
+  index.TitleWordMatches(L"fli", 10, &results);
+  EXPECT_TRUE(results.empty());
+  index.TitleWordMatches(L"stat", 10, &results);
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ(L"Status", results[0].title());
+}
+
+// Enough URLs, added out of order, that blocks are split, and then removed.
+TEST(InMemoryURLIndexTest, ManyURLs) {
+  const int kURLCount = 1000;
+  InMemoryURLIndex index;
+  for (int i = 0; i < kURLCount; ++i) {
+    int n = (i * 7919) % kURLCount;
+    index.AddOrUpdateURL(MakeRow(
+        StringPrintf("http://www.example.com/%d", n).c_str(), L"", n, 0));
+  }
+  EXPECT_EQ(static_cast<size_t>(kURLCount), index.url_count());
+
+  for (int i = 0; i < kURLCount; i += 2)
+    index.DeleteURL(GURL(StringPrintf("http://www.example.com/%d", i)));
+  EXPECT_EQ(static_cast<size_t>(kURLCount / 2), index.url_count());
+
+  for (int i = 0; i < kURLCount; ++i) {
+    URLRow info;
+    URLID id = index.GetRowForURL(
+        GURL(StringPrintf("http://www.example.com/%d", i)), &info);
+    if (i % 2) {
+      EXPECT_EQ(i, info.typed_count());
+    } else {
+      EXPECT_EQ(0, id);
+    }
+  }
+
+  // "1", "10"-"19" and "100"-"199", odd ones only.
+  std::vector<URLRow> results;
+  index.AutocompleteForPrefix(L"http://www.example.com/1", 1000, &results);
+  ASSERT_EQ(56U, results.size());
+  EXPECT_EQ(199, results.front().typed_count());
+  EXPECT_EQ(1, results.back().typed_count());
+}
+
+// The index gives the same answers as the database it was loaded from.
+TEST(InMemoryURLIndexTest, InitFromDatabase) {
+  InMemoryDatabase db;
+  ASSERT_TRUE(db.InitFromScratch());
+  db.AddURL(MakeRow("http://www.google.com/", L"Google", 4, 10));
+  db.AddURL(MakeRow("http://www.google.com/reader", L"Reader", 2, 30));
+  db.AddURL(MakeRow("http://www.google.com/news", L"News", 2, 40));
+  db.AddURL(MakeRow("http://www.yahoo.com/", L"Yahoo", 1, 1));
+
+  InMemoryURLIndex index;
+  index.Init(&db);
+  EXPECT_EQ(4U, index.url_count());
+
+  const wchar_t* prefixes[] = {
+    L"http://www.g", L"http://www.google.com/", L"http://", L"ftp://",
+  };
+  for (size_t i = 0; i < arraysize(prefixes); ++i) {
+    std::vector<URLRow> db_results;
+    db.AutocompleteForPrefix(prefixes[i], 10, &db_results);
+    std::vector<URLRow> index_results;
+    index.AutocompleteForPrefix(prefixes[i], 10, &index_results);
+    EXPECT_TRUE(Specs(db_results) == Specs(index_results)) << prefixes[i];
+  }
+
+  std::vector<URLRow> results;
+  index.TitleWordMatches(L"read", 10, &results);
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ("http://www.google.com/reader", results[0].url().spec());
+}
+
+}  // namespace history
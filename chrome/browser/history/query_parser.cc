@@ -11,25 +11,6 @@
 #include "chrome/common/scoped_vector.h"
 #include "unicode/uscript.h"
 
-// For CJK ideographs and Korean Hangul, even a single character
-// can be useful in prefix matching, but that may give us too many
-// false positives. Moreover, the current ICU word breaker gives us
-// back every single Chinese character as a word so that there's no
-// point doing anything for them and we only adjust the minimum length
-// to 2 for Korean Hangul while using 3 for others. This is a temporary
-// hack until we have a segmentation support.
-static inline bool IsWordLongEnoughForPrefixSearch(const std::wstring& word)
-{
-  DCHECK(word.size() > 0);
-  size_t minimum_length = 3;
-  // We intentionally exclude Hangul Jamos (both Conjoining and compatibility)
-  // because they 'behave like' Latin letters. Moreover, we should
-  // normalize the former before reaching here.
-  if (0xAC00 <= word[0] && word[0] <= 0xD7A3)
-    minimum_length = 2;
-  return word.size() >= minimum_length;
-}
-
 // Inheritance structure:
 // Queries are represented as trees of QueryNodes.
 // QueryNodes are either a collection of subnodes (a QueryNodeList)
@@ -51,6 +32,10 @@ class QueryNodeWord : public QueryNode {
 
   virtual bool Matches(const std::wstring& word, bool exact) const;
 
+  virtual void AppendWords(std::vector<std::wstring>* words) const {
+    words->push_back(word_);
+  }
+
  private:
   std::wstring word_;
   bool literal_;
@@ -71,7 +56,7 @@ bool QueryNodeWord::HasMatchIn(const std::vector<QueryWord>& words,
 }
 
 bool QueryNodeWord::Matches(const std::wstring& word, bool exact) const {
-  if (exact || !IsWordLongEnoughForPrefixSearch(word_))
+  if (exact || !QueryParser::IsWordLongEnoughForPrefixSearch(word_))
     return word == word_;
   return word.size() >= word_.size() &&
          (word_.compare(0, word_.size(), word, 0, word_.size()) == 0);
@@ -81,7 +66,7 @@ int QueryNodeWord::AppendToSQLiteQuery(std::wstring* query) const {
   query->append(word_);
 
   // Use prefix search if we're not literal and long enough.
-  if (!literal_ && IsWordLongEnoughForPrefixSearch(word_))
+  if (!literal_ && QueryParser::IsWordLongEnoughForPrefixSearch(word_))
     *query += L'*';
   return 1;
 }
@@ -116,6 +101,8 @@ class QueryNodeList : public QueryNode {
     return false;
   }
 
+  virtual void AppendWords(std::vector<std::wstring>* words) const;
+
  protected:
   int AppendChildrenToString(std::wstring* query) const;
 
@@ -128,6 +115,11 @@ QueryNodeList::~QueryNodeList() {
     delete *node;
 }
 
+void QueryNodeList::AppendWords(std::vector<std::wstring>* words) const {
+  for (size_t i = 0; i < children_.size(); ++i)
+    children_[i]->AppendWords(words);
+}
+
 int QueryNodeList::AppendChildrenToString(std::wstring* query) const {
   int num_words = 0;
   for (QueryNodeVector::const_iterator node = children_.begin();
@@ -187,6 +179,25 @@ bool QueryNodePhrase::HasMatchIn(
 QueryParser::QueryParser() {
 }
 
+// For CJK ideographs and Korean Hangul, even a single character
+// can be useful in prefix matching, but that may give us too many
+// false positives. Moreover, the current ICU word breaker gives us
+// back every single Chinese character as a word so that there's no
+// point doing anything for them and we only adjust the minimum length
+// to 2 for Korean Hangul while using 3 for others. This is a temporary
+// hack until we have a segmentation support.
+// static
+bool QueryParser::IsWordLongEnoughForPrefixSearch(const std::wstring& word) {
+  DCHECK(word.size() > 0);
+  size_t minimum_length = 3;
+  // We intentionally exclude Hangul Jamos (both Conjoining and compatibility)
+  // because they 'behave like' Latin letters. Moreover, we should
+  // normalize the former before reaching here.
+  if (0xAC00 <= word[0] && word[0] <= 0xD7A3)
+    minimum_length = 2;
+  return word.size() >= minimum_length;
+}
+
 // Returns true if the character is considered a quote.
 static bool IsQueryQuote(wchar_t ch) {
   return ch == '"' ||
@@ -48,6 +48,9 @@ class QueryNode {
   // giving the matching region.
   virtual bool HasMatchIn(const std::vector<QueryWord>& words,
                           Snippet::MatchPositions* match_positions) const = 0;
+
+  // Appends the words that make up this node to words.
+  virtual void AppendWords(std::vector<std::wstring>* words) const = 0;
 };
 
 
@@ -74,15 +77,20 @@ class QueryParser {
                       const std::vector<QueryNode*>& nodes,
                       Snippet::MatchPositions* match_positions);
 
+  // Extracts the words from text, placing each word into words. text should
+  // already be lower case.
+  void ExtractQueryWords(const std::wstring& text,
+                         std::vector<QueryWord>* words);
+
+  // Returns true if a query word is long enough that it matches any word it
+  // is a prefix of. Shorter query words only match whole words.
+  static bool IsWordLongEnoughForPrefixSearch(const std::wstring& word);
+
  private:
   // Does the work of parsing a query; creates nodes in QueryNodeList as
   // appropriate. This is invoked from both of the ParseQuery methods.
   bool ParseQueryImpl(const std::wstring& query,
                       QueryNodeList* root);
-
-  // Extracts the words from text, placing each word into words.
-  void ExtractQueryWords(const std::wstring& text,
-                         std::vector<QueryWord>* words);
 };
 
 #endif  // CHROME_BROWSER_HISTORY_QUERY_PARSER_H__
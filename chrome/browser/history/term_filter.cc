@@ -0,0 +1,240 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "chrome/browser/history/term_filter.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "chrome/browser/safe_browsing/bloom_filter.h"
+
+extern "C" {
+#include "third_party/sqlite/fts2_tokenizer.h"
+
+// Defined in fts2_icu.c; this is the tokenizer the "TOKENIZE icu" clause of
+// the full text tables selects.
+void sqlite3Fts2IcuTokenizerModule(
+    sqlite3_tokenizer_module const** module);
+}
+
+namespace history {
+
+namespace {
+
+// About 32K per database. This keeps false positives to a few percent for
+// the tens of thousands of distinct terms a month of browsing has.
+const int kFilterBits = 1 << 18;
+
+// What BloomFilter allocates for kFilterBits.
+const int kFilterBytes = kFilterBits / 8 + 1;
+
+// The number of leading bytes of each term that are added as prefixes.
+// Longer prefixes in a query are checked by their first kMaxPrefixLength
+// bytes.
+const int kMaxPrefixLength = 4;
+
+// The names of the columns of the full text table, which fts2 treats as
+// column specifiers when followed by a colon in a query.
+const char* const kColumnNames[] = { "url", "title", "body" };
+
+// 32-bit FNV-1a. Prefixes are hashed with a different first byte so that a
+// short term and the same prefix of a longer term are different entries.
+uint32 HashTerm(const char* term, int length, bool prefix) {
+  uint32 hash = 2166136261U;
+  hash = (hash ^ (prefix ? '*' : ' ')) * 16777619U;
+  for (int i = 0; i < length; ++i)
+    hash = (hash ^ static_cast<uint8>(term[i])) * 16777619U;
+  return hash;
+}
+
+// Splits UTF-8 text into terms with the fts2 ICU tokenizer.
+class Tokenizer {
+ public:
+  explicit Tokenizer(const std::string& text)
+      : module_(NULL),
+        tokenizer_(NULL),
+        cursor_(NULL) {
+    sqlite3Fts2IcuTokenizerModule(&module_);
+    if (module_->xCreate(0, NULL, &tokenizer_) != SQLITE_OK) {
+      tokenizer_ = NULL;
+      return;
+    }
+    tokenizer_->pModule = module_;
+    if (module_->xOpen(tokenizer_, text.data(), static_cast<int>(text.size()),
+                       &cursor_) != SQLITE_OK) {
+      cursor_ = NULL;
+      return;
+    }
+    cursor_->pTokenizer = tokenizer_;
+  }
+
+  ~Tokenizer() {
+    if (cursor_)
+      module_->xClose(cursor_);
+    if (tokenizer_)
+      module_->xDestroy(tokenizer_);
+  }
+
+  // Returns false if the text couldn't be tokenized.
+  bool is_valid() const { return cursor_ != NULL; }
+
+  // Returns the next term and the byte range of the text it came from.
+  bool Next(std::string* term, int* begin, int* end) {
+    if (!cursor_)
+      return false;
+    const char* token;
+    int length;
+    int position;
+    if (module_->xNext(cursor_, &token, &length, begin, end,
+                       &position) != SQLITE_OK)
+      return false;
+    term->assign(token, length);
+    return true;
+  }
+
+ private:
+  const sqlite3_tokenizer_module* module_;
+  sqlite3_tokenizer* tokenizer_;
+  sqlite3_tokenizer_cursor* cursor_;
+
+  DISALLOW_COPY_AND_ASSIGN(Tokenizer);
+};
+
+// A term of an fts2 query, as fts2's parseQuery sees it.
+struct QueryTerm {
+  QueryTerm(const std::string& t, bool p, bool n)
+      : text(t), is_prefix(p), is_not(n) {}
+
+  std::string text;
+  bool is_prefix;
+  bool is_not;  // Set for "-term", which pages must not contain.
+};
+
+bool IsColumnName(const std::string& term) {
+  for (size_t i = 0; i < arraysize(kColumnNames); ++i) {
+    if (term == kColumnNames[i])
+      return true;
+  }
+  return false;
+}
+
+// Adds the terms of the part of a query between two quotes to |terms|,
+// following fts2's tokenizeSegment. Sets |has_or| if an OR was found.
+void AddSegmentTerms(const std::string& segment,
+                     bool in_phrase,
+                     std::vector<QueryTerm>* terms,
+                     bool* has_or) {
+  Tokenizer tokenizer(segment);
+  std::string term;
+  int begin, end;
+  while (tokenizer.Next(&term, &begin, &end)) {
+    bool at_end = end >= static_cast<int>(segment.size());
+    if (!in_phrase && !at_end && segment[end] == ':' && IsColumnName(term))
+      continue;
+    if (!in_phrase && !terms->empty() && term.size() == 2 &&
+        segment[begin] == 'O' && segment[begin + 1] == 'R') {
+      *has_or = true;
+      continue;
+    }
+    if (!terms->empty() && term.size() == 1 && segment[begin] == '*') {
+      terms->back().is_prefix = true;
+      continue;
+    }
+    terms->push_back(QueryTerm(term, !at_end && segment[end] == '*',
+                               !in_phrase && begin > 0 &&
+                                   segment[begin - 1] == '-'));
+  }
+}
+
+}  // namespace
+
+TermFilter::TermFilter() : bloom_filter_(new BloomFilter(kFilterBits)) {
+}
+
+TermFilter::TermFilter(const std::string& data) {
+  if (static_cast<int>(data.size()) != kFilterBytes)
+    return;
+  char* bits = new char[data.size()];
+  memcpy(bits, data.data(), data.size());
+  bloom_filter_.reset(new BloomFilter(bits, static_cast<int>(data.size())));
+}
+
+TermFilter::~TermFilter() {
+}
+
+void TermFilter::AddText(const std::string& text) {
+  if (!bloom_filter_.get())
+    return;
+  Tokenizer tokenizer(text);
+  if (!tokenizer.is_valid()) {
+    // The index may have terms we don't, so stop filtering.
+    bloom_filter_.reset();
+    return;
+  }
+  std::string term;
+  int begin, end;
+  while (tokenizer.Next(&term, &begin, &end))
+    InsertTerm(term.data(), static_cast<int>(term.size()));
+}
+
+bool TermFilter::MayContainAll(const Terms& terms) const {
+  if (!bloom_filter_.get())
+    return true;
+  for (size_t i = 0; i < terms.size(); ++i) {
+    const std::string& text = terms[i].text;
+    int length = static_cast<int>(text.size());
+    if (terms[i].is_prefix)
+      length = std::min(length, kMaxPrefixLength);
+    if (!bloom_filter_->Exists(static_cast<int>(
+            HashTerm(text.data(), length, terms[i].is_prefix))))
+      return false;
+  }
+  return true;
+}
+
+// static
+bool TermFilter::GetRequiredTerms(const std::string& fts_query,
+                                  Terms* terms) {
+  // Like parseQuery, alternate between words and phrases at each quote.
+  std::vector<QueryTerm> query_terms;
+  bool has_or = false;
+  bool in_phrase = false;
+  size_t begin = 0;
+  while (begin <= fts_query.size()) {
+    size_t end = fts_query.find('"', begin);
+    if (end == std::string::npos)
+      end = fts_query.size();
+    if (end > begin) {
+      AddSegmentTerms(fts_query.substr(begin, end - begin), in_phrase,
+                      &query_terms, &has_or);
+    }
+    in_phrase = !in_phrase;
+    begin = end + 1;
+  }
+  if (has_or)
+    return false;
+
+  terms->clear();
+  for (size_t i = 0; i < query_terms.size(); ++i) {
+    if (!query_terms[i].is_not)
+      terms->push_back(Term(query_terms[i].text, query_terms[i].is_prefix));
+  }
+  return true;
+}
+
+std::string TermFilter::data() const {
+  if (!bloom_filter_.get())
+    return std::string();
+  return std::string(bloom_filter_->data(), bloom_filter_->size());
+}
+
+void TermFilter::InsertTerm(const char* term, int length) {
+  bloom_filter_->Insert(static_cast<int>(HashTerm(term, length, false)));
+  for (int i = 1; i <= std::min(length, kMaxPrefixLength); ++i)
+    bloom_filter_->Insert(static_cast<int>(HashTerm(term, i, true)));
+}
+
+}  // namespace history
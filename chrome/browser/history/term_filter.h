@@ -0,0 +1,75 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_HISTORY_TERM_FILTER_H_
+#define CHROME_BROWSER_HISTORY_TERM_FILTER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/scoped_ptr.h"
+
+class BloomFilter;
+
+namespace history {
+
+// A bloom filter over the terms in the full text index of one TextDatabase.
+// TextDatabaseManager uses it to skip the databases that can't match a query
+// without opening or searching them.
+//
+// Text is split into terms by the same fts2 ICU tokenizer the index uses, so
+// every term in the index is in the filter. Besides each term, the filter has
+// its first few bytes so that prefix queries ("goog*") can be checked too.
+// Deleting pages doesn't remove their terms, which only makes the filter
+// less selective.
+class TermFilter {
+ public:
+  // A term a page must contain to match a query.
+  struct Term {
+    Term(const std::string& t, bool p) : text(t), is_prefix(p) {}
+
+    std::string text;
+
+    // Set when any term beginning with |text| will do.
+    bool is_prefix;
+  };
+  typedef std::vector<Term> Terms;
+
+  // Constructs an empty filter.
+  TermFilter();
+
+  // Constructs a filter from data previously returned by data(). Data of the
+  // wrong size gives a filter that matches everything.
+  explicit TermFilter(const std::string& data);
+
+  ~TermFilter();
+
+  // Adds the terms of |text|, which is UTF-8.
+  void AddText(const std::string& text);
+
+  // Returns true if a page with all of |terms| may have been added.
+  bool MayContainAll(const Terms& terms) const;
+
+  // Fills |terms| with the terms a page must contain to match |fts_query|, a
+  // query string for fts2's MATCH operator. Returns false if the query has
+  // alternatives (OR), in which case no single set of terms is required.
+  static bool GetRequiredTerms(const std::string& fts_query, Terms* terms);
+
+  // Returns the serialized filter.
+  std::string data() const;
+
+ private:
+  // Adds |term| and its prefixes.
+  void InsertTerm(const char* term, int length);
+
+  // NULL if this filter matches everything.
+  scoped_ptr<BloomFilter> bloom_filter_;
+
+  DISALLOW_COPY_AND_ASSIGN(TermFilter);
+};
+
+}  // namespace history
+
+#endif  // CHROME_BROWSER_HISTORY_TERM_FILTER_H_
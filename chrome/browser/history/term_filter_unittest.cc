@@ -0,0 +1,130 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "chrome/browser/history/term_filter.h"
+#include "chrome/common/sqlite_utils.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using history::TermFilter;
+
+namespace {
+
+// Returns true if |filter| may have a page matching the fts2 query.
+bool MayMatch(const TermFilter& filter, const std::string& fts_query) {
+  TermFilter::Terms terms;
+  if (!TermFilter::GetRequiredTerms(fts_query, &terms))
+    return true;
+  return filter.MayContainAll(terms);
+}
+
+}  // namespace
+
+TEST(TermFilterTest, Terms) {
+  TermFilter filter;
+  filter.AddText("http://www.google.com/search?q=flights");
+  filter.AddText("Cheap Flights to Paris");
+
+  EXPECT_TRUE(MayMatch(filter, "google"));
+  EXPECT_TRUE(MayMatch(filter, "paris flights"));
+  EXPECT_TRUE(MayMatch(filter, "PARIS"));
+  EXPECT_FALSE(MayMatch(filter, "london"));
+  EXPECT_FALSE(MayMatch(filter, "paris london"));
+
+  // Prefixes only match when asked for.
+  EXPECT_TRUE(MayMatch(filter, "goog*"));
+  EXPECT_TRUE(MayMatch(filter, "fli *"));
+  EXPECT_FALSE(MayMatch(filter, "goog"));
+  EXPECT_FALSE(MayMatch(filter, "lond*"));
+}
+
+TEST(TermFilterTest, QuerySyntax) {
+  TermFilter::Terms terms;
+
+  // Excluded words aren't required, phrases are. With the ICU tokenizer the
+  // minus sign is a term of its own, which fts2 requires too.
+  ASSERT_TRUE(TermFilter::GetRequiredTerms(
+      "\"cheap flights\" -london par*", &terms));
+  ASSERT_EQ(4U, terms.size());
+  EXPECT_EQ("cheap", terms[0].text);
+  EXPECT_FALSE(terms[0].is_prefix);
+  EXPECT_EQ("flights", terms[1].text);
+  EXPECT_EQ("-", terms[2].text);
+  EXPECT_EQ("par", terms[3].text);
+  EXPECT_TRUE(terms[3].is_prefix);
+
+  // A column name followed by a colon only restricts the column.
+  ASSERT_TRUE(TermFilter::GetRequiredTerms("title:paris", &terms));
+  ASSERT_EQ(2U, terms.size());
+  EXPECT_EQ(":", terms[0].text);
+  EXPECT_EQ("paris", terms[1].text);
+
+  // Either side of an OR will do, so nothing in particular is required.
+  EXPECT_FALSE(TermFilter::GetRequiredTerms("paris OR london", &terms));
+  EXPECT_TRUE(TermFilter::GetRequiredTerms("paris or london", &terms));
+  EXPECT_EQ(3U, terms.size());
+}
+
+TEST(TermFilterTest, Serialization) {
+  TermFilter filter;
+  filter.AddText("Cheap Flights to Paris");
+
+  TermFilter copy(filter.data());
+  EXPECT_TRUE(MayMatch(copy, "paris"));
+  EXPECT_FALSE(MayMatch(copy, "london"));
+  EXPECT_EQ(filter.data(), copy.data());
+
+  // A filter that can't be read matches everything.
+  TermFilter bad("bad");
+  EXPECT_TRUE(MayMatch(bad, "london"));
+  bad.AddText("Paris");
+  EXPECT_TRUE(bad.data().empty());
+}
+
+// Whatever fts2 finds, the filter must not rule out. The text has the
+// punctuation, case and non-ASCII text the tokenizer has to agree on.
+TEST(TermFilterTest, AgreesWithFullTextIndex) {
+  const char* const kTexts[] = {
+    "http://en.wikipedia.org/wiki/Caf%C3%A9",
+    "Caf\xC3\xA9 \xE2\x80\x94 Wikipedia",
+    "O'Reilly Media: Books, Safari Books Online & Conferences",
+    "e-mail address@example.com 3.14159 C++",
+    "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E \xED\x95\x9C\xEA\xB5\xAD\xEC\x96\xB4",
+  };
+  const char* const kQueries[] = {
+    "wikipedia", "caf\xC3\xA9", "CAF\xC3\x89", "caf*", "o'reilly",
+    "\"safari books\"", "\"e-mail\"", "mail*", "address@example.com",
+    "3.14159", "c++", "\xE6\x97\xA5*", "\xED\x95\x9C\xEA\xB5\xAD*",
+    "wiki/caf*", "body:safari",
+  };
+
+  sqlite3* db;
+  ASSERT_EQ(SQLITE_OK, sqlite3_open(":memory:", &db));
+  ASSERT_EQ(SQLITE_OK, sqlite3_exec(db,
+      "CREATE VIRTUAL TABLE pages USING fts2(TOKENIZE icu, body)",
+      NULL, NULL, NULL));
+
+  TermFilter filter;
+  for (size_t i = 0; i < arraysize(kTexts); ++i) {
+    SQLStatement insert;
+    ASSERT_EQ(SQLITE_OK,
+              insert.prepare(db, "INSERT INTO pages(body) VALUES(?)"));
+    insert.bind_string(0, kTexts[i]);
+    ASSERT_EQ(SQLITE_DONE, insert.step());
+    filter.AddText(kTexts[i]);
+  }
+
+  for (size_t i = 0; i < arraysize(kQueries); ++i) {
+    SQLStatement select;
+    ASSERT_EQ(SQLITE_OK, select.prepare(db,
+        "SELECT rowid FROM pages WHERE pages MATCH ?"));
+    select.bind_string(0, kQueries[i]);
+    bool found = select.step() == SQLITE_ROW;
+    EXPECT_TRUE(found) << kQueries[i];
+    if (found)
+      EXPECT_TRUE(MayMatch(filter, kQueries[i])) << kQueries[i];
+  }
+  sqlite3_close(db);
+}
@@ -10,6 +10,7 @@
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/string_util.h"
+#include "chrome/browser/history/term_filter.h"
 #include "chrome/common/sqlite_utils.h"
 
 // There are two tables in each database, one full-text search (FTS) table which
@@ -31,6 +32,10 @@
 // keep in sync between the two tables. The internal rowid is the only part of
 // an FTS table that is indexed like a normal table, and the index over it is
 // free since sqlite always indexes the internal rowid.
+//
+// "term_filter" regular table, in databases created since it was added:
+//   data  The serialized TermFilter of the terms in the pages table, in a
+//         single row.
 
 namespace history {
 
@@ -38,6 +43,10 @@ namespace {
 
 const int kCurrentVersionNumber = 1;
 
+// Meta table key set when the database has been optimized and no pages have
+// been added since.
+const char kOptimizedKey[] = "optimized";
+
 // Snippet computation relies on the index of the columns in the original
 // create statement. These are the 0-based indices (as strings) of the
 // corresponding columns.
@@ -75,7 +84,10 @@ TextDatabase::TextDatabase(const std::wstring& path,
       path_(path),
       ident_(id),
       allow_create_(allow_create),
-      transaction_nesting_(0) {
+      transaction_nesting_(0),
+      optimized_(false),
+      term_filter_(NULL),
+      term_filter_dirty_(false) {
   // Compute the file name.
   file_name_ = path_;
   file_util::AppendToPath(&file_name_, IDToFileName(ident_));
@@ -171,6 +183,10 @@ bool TextDatabase::Init() {
     return false;
   }
 
+  int optimized = 0;
+  meta_table_.GetValue(kOptimizedKey, &optimized);
+  optimized_ = optimized != 0;
+
   return CreateTables();
 }
 
@@ -183,13 +199,21 @@ void TextDatabase::BeginTransaction() {
 void TextDatabase::CommitTransaction() {
   DCHECK(transaction_nesting_);
   transaction_nesting_--;
-  if (!transaction_nesting_)
+  if (!transaction_nesting_) {
+    WriteTermFilter();
     sqlite3_exec(db_, "COMMIT", NULL, NULL, NULL);
+  }
 }
 
 bool TextDatabase::CreateTables() {
   // FTS table of page contents.
   if (!DoesSqliteTableExist(db_, "pages")) {
+    // Only a new database gets a term filter; one added to an existing
+    // database would be missing the terms of the pages already in it.
+    if (sqlite3_exec(db_, "CREATE TABLE IF NOT EXISTS term_filter(data BLOB)",
+                     NULL, NULL, NULL) != SQLITE_OK)
+      return false;
+
     if (sqlite3_exec(db_,
                      "CREATE VIRTUAL TABLE pages USING fts2("
                      "TOKENIZE icu,"
@@ -251,6 +275,17 @@ bool TextDatabase::AddPageData(Time time,
     return false;
   }
 
+  if (term_filter_) {
+    term_filter_->AddText(url);
+    term_filter_->AddText(title);
+    term_filter_->AddText(contents);
+    term_filter_dirty_ = true;
+  }
+  if (optimized_) {
+    meta_table_.SetValue(kOptimizedKey, 0);
+    optimized_ = false;
+  }
+
   return true;
 }
 
@@ -301,6 +336,48 @@ void TextDatabase::Optimize() {
   if (!statement.is_valid())
     return;
   statement->step();
+
+  if (!optimized_) {
+    meta_table_.SetValue(kOptimizedKey, 1);
+    optimized_ = true;
+  }
+}
+
+TermFilter* TextDatabase::ReadTermFilter() {
+  if (!DoesSqliteTableExist(db_, "term_filter"))
+    return NULL;
+
+  SQLITE_UNIQUE_STATEMENT(statement, *statement_cache_,
+      "SELECT data FROM term_filter LIMIT 1");
+  if (!statement.is_valid())
+    return NULL;
+  if (statement->step() != SQLITE_ROW) {
+    // The filter is written with the first pages, so without one there
+    // should be no pages. If there are, we can't tell what is in them.
+    SQLITE_UNIQUE_STATEMENT(any_page, *statement_cache_,
+        "SELECT rowid FROM info LIMIT 1");
+    if (!any_page.is_valid() || any_page->step() == SQLITE_ROW)
+      return NULL;
+    return new TermFilter;
+  }
+
+  std::string data;
+  statement->column_blob_as_string(0, &data);
+  return new TermFilter(data);
+}
+
+void TextDatabase::WriteTermFilter() {
+  if (!term_filter_ || !term_filter_dirty_)
+    return;
+
+  SQLITE_UNIQUE_STATEMENT(statement, *statement_cache_,
+      "INSERT OR REPLACE INTO term_filter(rowid, data) VALUES(1, ?)");
+  if (!statement.is_valid())
+    return;
+  std::string data = term_filter_->data();
+  statement->bind_blob(0, data.data(), static_cast<int>(data.size()));
+  if (statement->step() == SQLITE_DONE)
+    term_filter_dirty_ = false;
 }
 
 void TextDatabase::GetTextMatches(const std::string& query,
@@ -18,6 +18,8 @@ struct sqlite3;
 
 namespace history {
 
+class TermFilter;
+
 // Encapsulation of a full-text indexed database file.
 class TextDatabase {
  public:
@@ -114,6 +116,22 @@ class TextDatabase {
   // form. This function will clean that up.
   void Optimize();
 
+  // Returns true if no pages have been added since the last Optimize().
+  bool is_optimized() const { return optimized_; }
+
+  // Term filter ---------------------------------------------------------------
+
+  // Returns a new TermFilter with the terms of the pages in this database,
+  // which the caller owns. Returns NULL if the database predates term filters
+  // and so has pages whose terms are unknown.
+  TermFilter* ReadTermFilter();
+
+  // Sets the filter the terms of added pages go into. It is written to the
+  // database when the outermost transaction commits, so the filter on disk
+  // always covers the pages on disk. The filter is not owned and may be NULL,
+  // the default.
+  void set_term_filter(TermFilter* term_filter) { term_filter_ = term_filter; }
+
   // Querying ------------------------------------------------------------------
 
   // Executes the given query. See QueryOptions for more info on input.
@@ -143,6 +161,9 @@ class TextDatabase {
   // Ensures that the tables and indices are created. Returns true on success.
   bool CreateTables();
 
+  // Writes |term_filter_| if pages were added to it.
+  void WriteTermFilter();
+
   // See the constructor.
   sqlite3* db_;
   SqliteStatementCache* statement_cache_;
@@ -162,6 +183,14 @@ class TextDatabase {
 
   MetaTableHelper meta_table_;
 
+  // Cached from the meta table; see is_optimized().
+  bool optimized_;
+
+  // See set_term_filter(). |term_filter_dirty_| is set when pages have been
+  // added since it was last written.
+  TermFilter* term_filter_;
+  bool term_filter_dirty_;
+
   DISALLOW_EVIL_CONSTRUCTORS(TextDatabase);
 };
 
@@ -29,6 +29,11 @@ std::string ConvertStringForIndexer(
 // haven't gotten a title and/or body.
 const int kExpirationSec = 20;
 
+// How long after startup, and then between databases, old databases are
+// merged. Each merge rewrites a whole month of the index, so they are spread
+// out to stay out of the way of other history work.
+const int kMergeDelaySec = 60;
+
 }  // namespace
 
 // TextDatabaseManager::PageInfo -----------------------------------------------
@@ -71,7 +76,9 @@ TextDatabaseManager::TextDatabaseManager(const std::wstring& dir,
       transaction_nesting_(0),
       db_cache_(DBCache::NO_AUTO_EVICT),
       present_databases_loaded_(false),
-      ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)) {
+      merge_cursor_(0),
+      ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)),
+      ALLOW_THIS_IN_INITIALIZER_LIST(merge_factory_(this)) {
 }
 
 TextDatabaseManager::~TextDatabaseManager() {
@@ -101,6 +108,7 @@ Time TextDatabaseManager::IDToTime(TextDatabase::DBIdent id) {
 bool TextDatabaseManager::Init() {
   // Start checking recent changes and committing them.
   ScheduleFlushOldChanges();
+  ScheduleMergeOldDatabase();
   return true;
 }
 
@@ -307,6 +315,7 @@ void TextDatabaseManager::DeleteAll() {
 
   // Close all open databases.
   db_cache_.ShrinkToSize(0);
+  term_filters_.clear();
 
   // Now go through and delete all the files.
   for (DBIdentSet::iterator i = present_databases_.begin();
@@ -355,6 +364,11 @@ void TextDatabaseManager::GetTextMatches(
   query_parser_.ParseQuery(query, &fts_query_wide);
   std::string fts_query = WideToUTF8(fts_query_wide);
 
+  // The terms every match has, used to skip databases that don't have them.
+  TermFilter::Terms required_terms;
+  bool use_term_filters =
+      TermFilter::GetRequiredTerms(fts_query, &required_terms);
+
   // Need a copy of the options so we can modify the max count for each call
   // to the individual databases.
   QueryOptions cur_options(options);
@@ -386,9 +400,14 @@ void TextDatabaseManager::GetTextMatches(
     if (*i < min_ident)
       break;  // Covered all the time range.
 
+    // Opening the database reads its term filter, so check again after.
+    if (use_term_filters && CanSkipDB(*i, required_terms))
+      continue;
     TextDatabase* cur_db = GetDB(*i, false);
     if (!cur_db)
       continue;
+    if (use_term_filters && CanSkipDB(*i, required_terms))
+      continue;
 
     // Adjust the max count according to how many results we've already got.
     if (options.max_count) {
@@ -439,6 +458,13 @@ TextDatabase* TextDatabaseManager::GetDB(TextDatabase::DBIdent id,
   db_cache_.Put(id, new_db);
   present_databases_.insert(id);
 
+  TermFilterMap::iterator filter = term_filters_.find(id);
+  if (filter == term_filters_.end()) {
+    filter = term_filters_.insert(std::make_pair(
+        id, linked_ptr<TermFilter>(new_db->ReadTermFilter()))).first;
+  }
+  new_db->set_term_filter(filter->second.get());
+
   if (transaction_nesting_ && for_writing) {
     // If we currently have an open transaction and the new database will be
     // written to, it needs to be part of our transaction.
@@ -453,6 +479,14 @@ TextDatabase* TextDatabaseManager::GetDB(TextDatabase::DBIdent id,
   return new_db;
 }
 
+bool TextDatabaseManager::CanSkipDB(TextDatabase::DBIdent id,
+                                    const TermFilter::Terms& terms) const {
+  TermFilterMap::const_iterator found = term_filters_.find(id);
+  if (found == term_filters_.end() || !found->second.get())
+    return false;
+  return !found->second->MayContainAll(terms);
+}
+
 TextDatabase* TextDatabaseManager::GetDBForTime(Time time,
                                                 bool create_if_necessary) {
   return GetDB(TimeToID(time), create_if_necessary);
@@ -482,5 +516,67 @@ void TextDatabaseManager::FlushOldChangesForTime(TimeTicks now) {
   ScheduleFlushOldChanges();
 }
 
+void TextDatabaseManager::ScheduleMergeOldDatabase() {
+  MessageLoop::current()->PostDelayedTask(FROM_HERE,
+      merge_factory_.NewRunnableMethod(
+          &TextDatabaseManager::MergeOldDatabaseTask),
+      kMergeDelaySec * Time::kMillisecondsPerSecond);
+}
+
+bool TextDatabaseManager::MergeOldDatabase() {
+  // Pages are still added to this month's database and, for a while after
+  // the month ends, to last month's, so only older ones are merged.
+  Time::Exploded exploded;
+  Time::Now().UTCExplode(&exploded);
+  TextDatabase::DBIdent last_month = exploded.month == 1 ?
+      (exploded.year - 1) * 100 + 12 :
+      exploded.year * 100 + exploded.month - 1;
+
+  InitDBList();
+  if (!merge_cursor_) {
+    // Databases are merged oldest first, so the merged ones are all older
+    // than the ones left. Walk back from the newest to the first one that is
+    // already merged; once everything has been, that is the only one opened.
+    merge_cursor_ = last_month;
+    for (DBIdentSet::reverse_iterator i = present_databases_.rbegin();
+         i != present_databases_.rend(); ++i) {
+      if (*i >= last_month)
+        continue;
+      TextDatabase* db = GetDB(*i, false);
+      if (db && db->is_optimized())
+        break;
+      merge_cursor_ = *i;
+    }
+  }
+
+  DBIdentSet::const_iterator next =
+      present_databases_.lower_bound(merge_cursor_);
+  if (next == present_databases_.end() || *next >= last_month)
+    return false;
+
+  // Merging a database written to in the open transaction would make the
+  // transaction a long one; try again once it has been committed.
+  if (open_transactions_.find(*next) != open_transactions_.end())
+    return true;
+  merge_cursor_ = *next + 1;
+
+  // Each database is its own connection, and opening it for reading leaves it
+  // out of any transaction we have open, so the merge is committed by itself.
+  TextDatabase* db = GetDB(*next, false);
+  if (!db || db->is_optimized())
+    return true;
+
+  TimeTicks begin_time = TimeTicks::Now();
+  db->Optimize();
+  HISTOGRAM_TIMES(L"History.TextDatabaseMerge",
+                  TimeTicks::Now() - begin_time);
+  return true;
+}
+
+void TextDatabaseManager::MergeOldDatabaseTask() {
+  if (MergeOldDatabase())
+    ScheduleMergeOldDatabase();
+}
+
 }  // namespace history
 
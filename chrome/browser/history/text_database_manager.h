@@ -5,14 +5,17 @@
 #ifndef CHROME_BROWSER_HISTORY_TEXT_DATABASE_MANAGER_H__
 #define CHROME_BROWSER_HISTORY_TEXT_DATABASE_MANAGER_H__
 
+#include <map>
 #include <set>
 #include <vector>
 
 #include "base/basictypes.h"
+#include "base/linked_ptr.h"
 #include "base/task.h"
 #include "chrome/browser/history/history_types.h"
 #include "chrome/browser/history/text_database.h"
 #include "chrome/browser/history/query_parser.h"
+#include "chrome/browser/history/term_filter.h"
 #include "chrome/browser/history/url_database.h"
 #include "chrome/browser/history/visit_database.h"
 #include "chrome/common/mru_cache.h"
@@ -34,6 +37,11 @@ namespace history {
 // This allows us to minimize inserts and modifications, which are slow for the
 // full text database, since each page's information is added exactly once.
 //
+// Each database has a TermFilter of the terms in it. Once a database has been
+// opened, queries skip it when its filter shows it can't match, without
+// opening it again. Databases that are no longer written to are optimized in
+// the background, which merges their full text index into one segment.
+//
 // Note: be careful to delete the relevant entries from this uncommitted list
 // when clearing history or this information may get added to the database soon
 // after the clear.
@@ -154,6 +162,9 @@ class TextDatabaseManager {
  private:
   // These tests call ExpireRecentChangesForTime to force expiration.
   FRIEND_TEST(TextDatabaseManagerTest, InsertPartial);
+  FRIEND_TEST(TextDatabaseManagerTest, TermFilters);
+  FRIEND_TEST(TextDatabaseManagerTest, MergeOldDatabases);
+  FRIEND_TEST(TextDatabaseManagerTest, MergeOldDatabasesInTransaction);
   FRIEND_TEST(ExpireHistoryTest, DeleteURLAndFavicon);
   FRIEND_TEST(ExpireHistoryTest, FlushRecentURLsUnstarred);
 
@@ -219,6 +230,11 @@ class TextDatabaseManager {
   TextDatabase* GetDB(TextDatabase::DBIdent id, bool for_writing);
   TextDatabase* GetDBForTime(Time time, bool for_writing);
 
+  // Returns true if the term filter of the database shows it has no pages
+  // with all of |terms|. Returns false when the filter isn't known.
+  bool CanSkipDB(TextDatabase::DBIdent id,
+                 const TermFilter::Terms& terms) const;
+
   // Populates the present_databases_ list based on which files are on disk.
   // When the list is already initialized, this will do nothing, so you can
   // call it whenever you want to ensure the present_databases_ set is filled.
@@ -236,6 +252,16 @@ class TextDatabaseManager {
   // by the unit tests with fake times.
   void FlushOldChangesForTime(TimeTicks now);
 
+  // Schedules a call to MergeOldDatabase in the future.
+  void ScheduleMergeOldDatabase();
+
+  // Optimizes the oldest database older than last month that hasn't been
+  // optimized and that |merge_cursor_| hasn't passed. Returns false when
+  // there are none left. The task calls it and schedules itself again until
+  // it returns false.
+  bool MergeOldDatabase();
+  void MergeOldDatabaseTask();
+
   // Directory holding our index files.
   const std::wstring dir_;
 
@@ -287,9 +313,24 @@ class TextDatabaseManager {
 
   QueryParser query_parser_;
 
+  // The term filters of the databases opened so far. They are kept when the
+  // databases are closed, so later queries can skip the databases without
+  // opening them. The filter is NULL for databases created before there were
+  // term filters, which always have to be searched.
+  typedef std::map<TextDatabase::DBIdent, linked_ptr<TermFilter> >
+      TermFilterMap;
+  TermFilterMap term_filters_;
+
+  // The oldest database MergeOldDatabase still has to look at. It is 0 until
+  // the first call finds where the unmerged databases start.
+  TextDatabase::DBIdent merge_cursor_;
+
   // Generates tasks for our periodic checking of expired "recent changes".
   ScopedRunnableMethodFactory<TextDatabaseManager> factory_;
 
+  // Generates the tasks merging old databases.
+  ScopedRunnableMethodFactory<TextDatabaseManager> merge_factory_;
+
   DISALLOW_EVIL_CONSTRUCTORS(TextDatabaseManager);
 };
 
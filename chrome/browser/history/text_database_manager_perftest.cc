@@ -0,0 +1,236 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/perftimer.h"
+#include "base/string_util.h"
+#include "chrome/browser/history/text_database_manager.h"
+#include "googleurl/src/gurl.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using history::QueryOptions;
+using history::TextDatabase;
+using history::TextDatabaseManager;
+
+namespace {
+
+// Three years of history.
+const int kMonthCount = 36;
+const int kPagesPerMonth = 150;
+const int kWordsPerPage = 80;
+const int kVocabularySize = 2000;
+
+// Each month has a few pages on a topic no other month has.
+const int kTopicPagesPerMonth = 3;
+
+const char* const kSyllables[] = {
+  "ba", "co", "de", "fi", "go", "ha", "ji", "ka", "lo", "me", "ni", "op",
+  "pu", "qua", "ro", "sa", "te", "ul", "vi", "wo", "xe", "yo", "zu", "an",
+};
+
+// A fixed sequence of pseudo-random numbers, so each run sees the same
+// history.
+class Random {
+ public:
+  Random() : seed_(0x12345678) {
+  }
+  int Next(int range) {
+    seed_ = seed_ * 1103515245 + 12345;
+    return static_cast<int>((seed_ >> 16) % range);
+  }
+
+ private:
+  uint32 seed_;
+};
+
+std::string Word(Random* random) {
+  std::string word;
+  int syllables = 2 + random->Next(3);
+  for (int i = 0; i < syllables; ++i)
+    word.append(kSyllables[random->Next(arraysize(kSyllables))]);
+  return word;
+}
+
+// The word only the topic pages of |month| have.
+std::wstring TopicWord(int month) {
+  return ASCIIToWide(std::string("zy") +
+                     kSyllables[month % arraysize(kSyllables)] +
+                     kSyllables[month / arraysize(kSyllables)] + "ta");
+}
+
+// A VisitDatabase in memory; the manager updates it as pages are indexed.
+class InMemVisitDB : public history::VisitDatabase {
+ public:
+  InMemVisitDB() {
+    sqlite3_open(":memory:", &db_);
+    statement_cache_ = new SqliteStatementCache(db_);
+    InitVisitTable();
+  }
+  ~InMemVisitDB() {
+    delete statement_cache_;
+    sqlite3_close(db_);
+  }
+
+ private:
+  virtual sqlite3* GetDB() { return db_; }
+  virtual SqliteStatementCache& GetStatementCache() {
+    return *statement_cache_;
+  }
+
+  sqlite3* db_;
+  SqliteStatementCache* statement_cache_;
+
+  DISALLOW_EVIL_CONSTRUCTORS(InMemVisitDB);
+};
+
+// Returns the first day of the |month|th month of the history.
+Time MonthTime(int month) {
+  Time::Exploded exploded;
+  memset(&exploded, 0, sizeof(Time::Exploded));
+  exploded.year = 2006 + month / 12;
+  exploded.month = 1 + month % 12;
+  exploded.day_of_month = 1;
+  return Time::FromUTCExploded(exploded);
+}
+
+// Returns the identifier of the database of the |month|th month, which is
+// the year and month as a 6-digit number.
+TextDatabase::DBIdent MonthID(int month) {
+  return (2006 + month / 12) * 100 + 1 + month % 12;
+}
+
+void AddHistory(TextDatabaseManager* manager) {
+  Random random;
+  std::vector<std::string> vocabulary;
+  for (int i = 0; i < kVocabularySize; ++i)
+    vocabulary.push_back(Word(&random));
+
+  history::URLID url_id = 0;
+  for (int month = 0; month < kMonthCount; ++month) {
+    manager->BeginTransaction();
+    for (int i = 0; i < kPagesPerMonth; ++i) {
+      std::string body;
+      for (int j = 0; j < kWordsPerPage; ++j) {
+        body.append(vocabulary[random.Next(kVocabularySize)]);
+        body.push_back(' ');
+      }
+      std::wstring wide_body(UTF8ToWide(body));
+      if (i < kTopicPagesPerMonth)
+        wide_body.append(TopicWord(month));
+
+      ++url_id;
+      GURL url("http://www." + vocabulary[random.Next(kVocabularySize)] +
+               ".com/" + IntToString(static_cast<int>(url_id)));
+      manager->AddPageData(url, url_id, 0,
+                           MonthTime(month) + TimeDelta::FromHours(i),
+                           UTF8ToWide(vocabulary[i]), wide_body);
+    }
+    manager->CommitTransaction();
+  }
+}
+
+// Searches every month from the most recent backwards, which is what
+// TextDatabaseManager did before it had term filters. With three years of
+// history most months weren't among the few it kept open, so each is opened.
+size_t SearchAllMonths(const std::wstring& dir, const std::wstring& query) {
+  QueryParser parser;
+  std::wstring fts_query;
+  parser.ParseQuery(query, &fts_query);
+
+  QueryOptions options;
+  std::vector<TextDatabase::Match> results;
+  TextDatabase::URLSet found_urls;
+  Time first_time_searched;
+  for (int month = kMonthCount - 1; month >= 0; --month) {
+    TextDatabase db(dir, MonthID(month), false);
+    if (!db.Init())
+      continue;
+    db.GetTextMatches(WideToUTF8(fts_query), options, &results, &found_urls,
+                      &first_time_searched);
+  }
+  return results.size();
+}
+
+}  // namespace
+
+// Searches three years of history for words found in one month, and for
+// common words, and logs how long it takes to search every month against
+// skipping the months the term filters rule out.
+TEST(TextDatabaseManagerPerfTest, Search) {
+  std::wstring dir;
+  ASSERT_TRUE(file_util::CreateNewTempDirectory(L"TextDBPerfTest", &dir));
+
+  InMemVisitDB visit_db;
+  {
+    TextDatabaseManager manager(dir, &visit_db);
+    ASSERT_TRUE(manager.Init());
+    PerfTimeLogger add_timer("TextDatabaseManager_add_3_years");
+    AddHistory(&manager);
+    add_timer.Done();
+  }
+
+  std::vector<std::wstring> rare_queries;
+  for (int month = 0; month < kMonthCount; month += 3)
+    rare_queries.push_back(TopicWord(month));
+  std::vector<std::wstring> common_queries;
+  Random random;
+  for (int i = 0; i < 12; ++i)
+    common_queries.push_back(UTF8ToWide(Word(&random)));
+
+  PerfTimer rare_scan_timer;
+  for (size_t i = 0; i < rare_queries.size(); ++i)
+    EXPECT_EQ(kTopicPagesPerMonth, SearchAllMonths(dir, rare_queries[i]));
+  LogPerfResult("TextDatabaseManager_rare_query_all_months",
+                rare_scan_timer.Elapsed().InMillisecondsF() /
+                    rare_queries.size(),
+                "ms");
+
+  PerfTimer common_scan_timer;
+  for (size_t i = 0; i < common_queries.size(); ++i)
+    SearchAllMonths(dir, common_queries[i]);
+  LogPerfResult("TextDatabaseManager_common_query_all_months",
+                common_scan_timer.Elapsed().InMillisecondsF() /
+                    common_queries.size(),
+                "ms");
+
+  {
+    TextDatabaseManager manager(dir, &visit_db);
+    ASSERT_TRUE(manager.Init());
+    QueryOptions options;
+    std::vector<TextDatabase::Match> results;
+    Time first_time_searched;
+
+    // The first query reads the term filters of the months it opens.
+    PerfTimer first_timer;
+    manager.GetTextMatches(rare_queries[0], options, &results,
+                           &first_time_searched);
+    LogPerfResult("TextDatabaseManager_first_query",
+                  first_timer.Elapsed().InMillisecondsF(), "ms");
+
+    PerfTimer rare_timer;
+    for (size_t i = 0; i < rare_queries.size(); ++i) {
+      manager.GetTextMatches(rare_queries[i], options, &results,
+                             &first_time_searched);
+      EXPECT_EQ(kTopicPagesPerMonth, results.size());
+    }
+    LogPerfResult("TextDatabaseManager_rare_query",
+                  rare_timer.Elapsed().InMillisecondsF() / rare_queries.size(),
+                  "ms");
+
+    PerfTimer common_timer;
+    for (size_t i = 0; i < common_queries.size(); ++i) {
+      manager.GetTextMatches(common_queries[i], options, &results,
+                             &first_time_searched);
+    }
+    LogPerfResult("TextDatabaseManager_common_query",
+                  common_timer.Elapsed().InMillisecondsF() /
+                      common_queries.size(),
+                  "ms");
+  }
+
+  file_util::Delete(dir, true);
+}
@@ -460,4 +460,127 @@ TEST_F(TextDatabaseManagerTest, QueryBackwards) {
   EXPECT_EQ(0, results.size());
 }
 
+// Tests that queries skip the databases whose term filters rule them out, and
+// still find the pages in the others.
+TEST_F(TextDatabaseManagerTest, TermFilters) {
+  ASSERT_TRUE(Init());
+  InMemVisitDB visit_db;
+  std::vector<Time> times;
+  {
+    TextDatabaseManager manager(dir_, &visit_db);
+    ASSERT_TRUE(manager.Init());
+    AddAllPages(manager, &visit_db, &times);
+  }
+
+  // The filters should have been written to disk with the pages.
+  TextDatabaseManager manager(dir_, &visit_db);
+  ASSERT_TRUE(manager.Init());
+  TextDatabase::DBIdent january = TextDatabaseManager::TimeToID(times[0]);
+  TextDatabase::DBIdent february = TextDatabaseManager::TimeToID(times[5]);
+
+  QueryOptions options;
+  std::vector<TextDatabase::Match> results;
+  Time first_time_searched;
+  manager.GetTextMatches(L"drei", options, &results, &first_time_searched);
+  ASSERT_EQ(1, results.size());
+  EXPECT_TRUE(ResultsHaveURL(results, kURL3));
+  EXPECT_TRUE(first_time_searched.is_null());
+
+  manager.GetTextMatches(L"lalala", options, &results, &first_time_searched);
+  ASSERT_EQ(1, results.size());
+  EXPECT_TRUE(ResultsHaveURL(results, kURL4));
+
+  TermFilter::Terms terms;
+  ASSERT_TRUE(TermFilter::GetRequiredTerms("drei", &terms));
+  EXPECT_FALSE(manager.CanSkipDB(january, terms));
+  EXPECT_TRUE(manager.CanSkipDB(february, terms));
+  ASSERT_TRUE(TermFilter::GetRequiredTerms("google foo", &terms));
+  EXPECT_FALSE(manager.CanSkipDB(january, terms));
+  EXPECT_FALSE(manager.CanSkipDB(february, terms));
+
+  // Pages added later are in the filter too.
+  manager.AddPageData(GURL("http://www.google.com/tyui"), 3, 0, times[5],
+                      L"Google six", L"sechs");
+  manager.GetTextMatches(L"sechs", options, &results, &first_time_searched);
+  ASSERT_EQ(1, results.size());
+  ASSERT_TRUE(TermFilter::GetRequiredTerms("sechs", &terms));
+  EXPECT_TRUE(manager.CanSkipDB(january, terms));
+  EXPECT_FALSE(manager.CanSkipDB(february, terms));
+}
+
+// Tests that old databases are optimized one at a time until none are left,
+// and the recent ones aren't.
+TEST_F(TextDatabaseManagerTest, MergeOldDatabases) {
+  ASSERT_TRUE(Init());
+  InMemVisitDB visit_db;
+  Time now = Time::Now();
+  std::vector<Time> times;
+  {
+    TextDatabaseManager manager(dir_, &visit_db);
+    ASSERT_TRUE(manager.Init());
+
+    AddAllPages(manager, &visit_db, &times);
+    manager.AddPageData(GURL("http://www.google.com/tyui"), 3, 0, now,
+                        L"Google six", L"FOO sechs");
+
+    EXPECT_TRUE(manager.MergeOldDatabase());
+    EXPECT_TRUE(manager.GetDBForTime(times[0], false)->is_optimized());
+    EXPECT_FALSE(manager.GetDBForTime(times[5], false)->is_optimized());
+    EXPECT_TRUE(manager.MergeOldDatabase());
+    EXPECT_TRUE(manager.GetDBForTime(times[5], false)->is_optimized());
+    EXPECT_FALSE(manager.MergeOldDatabase());
+    EXPECT_FALSE(manager.GetDBForTime(now, false)->is_optimized());
+
+    // Merging doesn't change what is found.
+    QueryOptions options;
+    std::vector<TextDatabase::Match> results;
+    Time first_time_searched;
+    manager.GetTextMatches(L"FOO", options, &results, &first_time_searched);
+    EXPECT_EQ(7, results.size());
+  }
+
+  // Once everything is merged, the next launch only opens the newest old
+  // database to find that out.
+  TextDatabaseManager manager(dir_, &visit_db);
+  ASSERT_TRUE(manager.Init());
+  EXPECT_FALSE(manager.MergeOldDatabase());
+  EXPECT_EQ(1U, manager.db_cache_.size());
+}
+
+// The history backend always has a transaction open on the manager, so
+// merging has to work with one open.
+TEST_F(TextDatabaseManagerTest, MergeOldDatabasesInTransaction) {
+  ASSERT_TRUE(Init());
+  InMemVisitDB visit_db;
+  TextDatabaseManager manager(dir_, &visit_db);
+  ASSERT_TRUE(manager.Init());
+
+  std::vector<Time> times;
+  AddAllPages(manager, &visit_db, &times);
+
+  manager.BeginTransaction();
+  manager.AddPageData(GURL("http://www.google.com/tyui"), 3, 0, Time::Now(),
+                      L"Google six", L"FOO sechs");
+  EXPECT_TRUE(manager.MergeOldDatabase());
+  EXPECT_TRUE(manager.GetDBForTime(times[0], false)->is_optimized());
+
+  // A database written to in the transaction waits until it is committed.
+  manager.AddPageData(GURL("http://www.google.com/ghjk"), 4, 0,
+                      times[5] + TimeDelta::FromHours(1),
+                      L"Google seven", L"FOO sieben");
+  EXPECT_TRUE(manager.MergeOldDatabase());
+  EXPECT_FALSE(manager.GetDBForTime(times[5], false)->is_optimized());
+  manager.CommitTransaction();
+
+  EXPECT_TRUE(manager.MergeOldDatabase());
+  EXPECT_TRUE(manager.GetDBForTime(times[5], false)->is_optimized());
+  EXPECT_FALSE(manager.MergeOldDatabase());
+
+  QueryOptions options;
+  std::vector<TextDatabase::Match> results;
+  Time first_time_searched;
+  manager.GetTextMatches(L"FOO", options, &results, &first_time_searched);
+  EXPECT_EQ(8, results.size());
+}
+
 }  // namespace history
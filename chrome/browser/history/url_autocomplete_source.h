@@ -0,0 +1,50 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_HISTORY_URL_AUTOCOMPLETE_SOURCE_H__
+#define CHROME_BROWSER_HISTORY_URL_AUTOCOMPLETE_SOURCE_H__
+
+#include <string>
+#include <vector>
+
+#include "chrome/browser/history/history_types.h"
+
+class GURL;
+
+namespace history {
+
+// The URL lookups HistoryURLProvider makes as the user types.  URLDatabase
+// answers them with SQL queries, and InMemoryURLIndex answers them from
+// memory for the synchronous pass on the main thread.
+class URLAutocompleteSource {
+ public:
+  virtual ~URLAutocompleteSource() {}
+
+  // Looks up the given URL and if it exists, fills |info| (which may be NULL)
+  // and returns the ID of that URL.  Returns 0 if the URL was not found.
+  virtual URLID GetRowForURL(const GURL& url, URLRow* info) = 0;
+
+  // Fills the given array with the non-hidden URLs beginning with |prefix|.
+  // They will be sorted by typed count, then by visit count, then by visit
+  // date (most recent first) up to the given maximum number.
+  virtual void AutocompleteForPrefix(const std::wstring& prefix,
+                                     size_t max_results,
+                                     std::vector<URLRow>* results) = 0;
+
+  // Tries to find the shortest URL beginning with |base| that strictly
+  // prefixes |url|, and has minimum visit_ and typed_counts as specified.
+  // If found, fills in |info| and returns true; otherwise returns false,
+  // leaving |info| unchanged.
+  // We allow matches of exactly |base| iff |allow_base| is true.
+  virtual bool FindShortestURLFromBase(const std::string& base,
+                                       const std::string& url,
+                                       int min_visits,
+                                       int min_typed,
+                                       bool allow_base,
+                                       URLRow* info) = 0;
+};
+
+}  // namespace history
+
+#endif  // CHROME_BROWSER_HISTORY_URL_AUTOCOMPLETE_SOURCE_H__
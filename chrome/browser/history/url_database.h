@@ -7,6 +7,7 @@
 
 #include "base/basictypes.h"
 #include "chrome/browser/history/history_types.h"
+#include "chrome/browser/history/url_autocomplete_source.h"
 #include "chrome/browser/template_url.h"
 
 // Temporary until DBCloseScoper moves elsewhere.
@@ -79,7 +80,7 @@ class DBCloseScoper {
 //
 // This is refcounted to support calling InvokeLater() with some of its methods
 // (necessary to maintain ordering of DB operations).
-class URLDatabase {
+class URLDatabase : public URLAutocompleteSource {
  public:
   // Must call CreateURLTable() and CreateURLIndexes() before using to make
   // sure the database is initialized.
@@ -110,7 +111,7 @@ class URLDatabase {
   // associated info and returns the ID of that URL. If the info pointer is
   // NULL, no information about the URL will be filled in, only the ID will be
   // returned. Returns 0 if the URL was not found.
-  URLID GetRowForURL(const GURL& url, URLRow* info);
+  virtual URLID GetRowForURL(const GURL& url, URLRow* info);
 
   // Given an already-existing row in the URL table, updates that URL's stats.
   // This can not change the URL.  Returns true on success.
@@ -187,21 +188,21 @@ class URLDatabase {
   // Fills the given array with URLs matching the given prefix. They will be
   // sorted by typed count, then by visit count, then by visit date (most
   // recent first) up to the given maximum number. Called by HistoryURLProvider.
-  void AutocompleteForPrefix(const std::wstring& prefix,
-                             size_t max_results,
-                             std::vector<URLRow>* results);
+  virtual void AutocompleteForPrefix(const std::wstring& prefix,
+                                     size_t max_results,
+                                     std::vector<URLRow>* results);
 
   // Tries to find the shortest URL beginning with |base| that strictly
   // prefixes |url|, and has minimum visit_ and typed_counts as specified.
   // If found, fills in |info| and returns true; otherwise returns false,
   // leaving |info| unchanged.
   // We allow matches of exactly |base| iff |allow_base| is true.
-  bool FindShortestURLFromBase(const std::string& base,
-                               const std::string& url,
-                               int min_visits,
-                               int min_typed,
-                               bool allow_base,
-                               history::URLRow* info);
+  virtual bool FindShortestURLFromBase(const std::string& base,
+                                       const std::string& url,
+                                       int min_visits,
+                                       int min_typed,
+                                       bool allow_base,
+                                       history::URLRow* info);
 
   // Keyword Search Terms ------------------------------------------------------
 
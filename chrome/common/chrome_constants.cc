@@ -32,6 +32,7 @@ const wchar_t kHistoryFilename[] = L"History";
 const wchar_t kLocalStateFilename[] = L"Local State";
 const wchar_t kPreferencesFilename[] = L"Preferences";
 const wchar_t kSafeBrowsingFilename[] = L"Safe Browsing";
+const wchar_t kSdchDictionariesDirname[] = L"Sdch Dictionaries";
 const wchar_t kThumbnailsFilename[] = L"Thumbnails";
 const wchar_t kUserDataDirname[] = L"User Data";
 const wchar_t kWebDataFilename[] = L"Web Data";
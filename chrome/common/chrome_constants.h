@@ -29,6 +29,7 @@ extern const wchar_t kHistoryFilename[];
 extern const wchar_t kLocalStateFilename[];
 extern const wchar_t kPreferencesFilename[];
 extern const wchar_t kSafeBrowsingFilename[];
+extern const wchar_t kSdchDictionariesDirname[];
 extern const wchar_t kThumbnailsFilename[];
 extern const wchar_t kUserDataDirname[];
 extern const wchar_t kWebDataFilename[];
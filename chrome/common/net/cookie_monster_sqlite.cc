@@ -4,18 +4,24 @@
 
 #include "chrome/common/net/cookie_monster_sqlite.h"
 
-#include <list>
+#include <map>
 
 #include "base/basictypes.h"
+#include "base/histogram.h"
 #include "base/logging.h"
 #include "base/ref_counted.h"
 #include "base/string_util.h"
 #include "base/thread.h"
+#include "base/waitable_event.h"
 #include "chrome/common/sqlite_compiled_statement.h"
 #include "chrome/common/sqlite_utils.h"
 
 // This class is designed to be shared between any calling threads and the
 // database thread.  It batches operations and commits them on a timer.
+// Operations are batched per cookie (cookies are keyed on their creation
+// time), so that a cookie which is added and deleted again before the next
+// commit never touches the database, and several updates of the same cookie
+// only write its final state.
 class SQLitePersistentCookieStore::Backend
     : public base::RefCountedThreadSafe<SQLitePersistentCookieStore::Backend> {
  public:
@@ -40,8 +46,9 @@ class SQLitePersistentCookieStore::Backend
                  const net::CookieMonster::CanonicalCookie& cc);
   // Batch a cookie delete
   void DeleteCookie(const net::CookieMonster::CanonicalCookie& cc);
-  // Commit and pending operations and close the database, must be called
-  // before the object is destructed.
+  // Commit any pending operations and close the database, must be called
+  // before the object is destructed.  Blocks until the background thread is
+  // done, so that nothing is lost if the browser is about to exit.
   void Close();
 
  private:
@@ -50,6 +57,8 @@ class SQLitePersistentCookieStore::Backend
     typedef enum {
       COOKIE_ADD,
       COOKIE_DELETE,
+      // A delete followed by an add of a cookie with the same creation time.
+      COOKIE_UPDATE,
     } OperationType;
 
     PendingOperation(OperationType op,
@@ -63,7 +72,7 @@ class SQLitePersistentCookieStore::Backend
 
    private:
     OperationType op_;
-    std::string key_;  // Only used for OP_ADD
+    std::string key_;  // Only used for COOKIE_ADD and COOKIE_UPDATE
     net::CookieMonster::CanonicalCookie cc_;
   };
 
@@ -74,16 +83,20 @@ class SQLitePersistentCookieStore::Backend
                       const net::CookieMonster::CanonicalCookie& cc);
   // Commit our pending operations to the database.
   void Commit();
-  // Close() executed on the background thread.
-  void InternalBackgroundClose();
+  // Close() executed on the background thread.  Signals |done| once the
+  // database is closed.
+  void InternalBackgroundClose(base::WaitableEvent* done);
 
   sqlite3* db_;
   MessageLoop* background_loop_;
   SqliteStatementCache* cache_;
 
-  typedef std::list<PendingOperation*> PendingOperationsList;
-  PendingOperationsList pending_;
-  PendingOperationsList::size_type num_pending_;
+  // The pending operations, keyed by the cookie's creation time.
+  typedef std::map<int64, PendingOperation*> PendingOperationsMap;
+  PendingOperationsMap pending_;
+  // The number of operations batched since the last commit, including the
+  // ones which were collapsed.
+  size_t num_pending_;
   Lock pending_lock_;  // Guard pending_ and num_pending_
 
   DISALLOW_EVIL_CONSTRUCTORS(Backend);
@@ -106,19 +119,39 @@ void SQLitePersistentCookieStore::Backend::BatchOperation(
     const net::CookieMonster::CanonicalCookie& cc) {
   // Commit every 30 seconds.
   static const int kCommitIntervalMs = 30 * 1000;
-  // Commit right away if we have more than 512 outstanding operations.
+  // Commit right away once 512 cookies have pending operations.
   static const size_t kCommitAfterBatchSize = 512;
   DCHECK(MessageLoop::current() != background_loop_);
 
-  // We do a full copy of the cookie here, and hopefully just here.
-  scoped_ptr<PendingOperation> po(new PendingOperation(op, key, cc));
-  CHECK(po.get());
+  const int64 creation = cc.CreationDate().ToInternalValue();
 
-  PendingOperationsList::size_type num_pending;
+  size_t num_pending;
+  bool batch_full = false;
   {
     AutoLock locked(pending_lock_);
-    pending_.push_back(po.release());
     num_pending = ++num_pending_;
+
+    PendingOperationsMap::iterator it = pending_.find(creation);
+    if (it != pending_.end()) {
+      // Collapse this operation with the one already pending for the cookie.
+      scoped_ptr<PendingOperation> old_po(it->second);
+      if (op == PendingOperation::COOKIE_DELETE) {
+        if (old_po->op() == PendingOperation::COOKIE_ADD) {
+          // The cookie never made it to the database.
+          pending_.erase(it);
+        } else {
+          it->second = new PendingOperation(op, key, cc);
+        }
+      } else {
+        if (old_po->op() != PendingOperation::COOKIE_ADD)
+          op = PendingOperation::COOKIE_UPDATE;
+        it->second = new PendingOperation(op, key, cc);
+      }
+    } else {
+      // We do a full copy of the cookie here, and hopefully just here.
+      pending_[creation] = new PendingOperation(op, key, cc);
+      batch_full = (pending_.size() == kCommitAfterBatchSize);
+    }
   }
 
   // TODO(abarth): What if the DB thread is being destroyed on the UI thread?
@@ -126,7 +159,7 @@ void SQLitePersistentCookieStore::Backend::BatchOperation(
     // We've gotten our first entry for this batch, fire off the timer.
     background_loop_->PostDelayedTask(FROM_HERE,
         NewRunnableMethod(this, &Backend::Commit), kCommitIntervalMs);
-  } else if (num_pending == kCommitAfterBatchSize) {
+  } else if (batch_full) {
     // We've reached a big enough batch, fire off a commit now.
     background_loop_->PostTask(FROM_HERE,
         NewRunnableMethod(this, &Backend::Commit));
@@ -135,7 +168,7 @@ void SQLitePersistentCookieStore::Backend::BatchOperation(
 
 void SQLitePersistentCookieStore::Backend::Commit() {
   DCHECK(MessageLoop::current() == background_loop_);
-  PendingOperationsList ops;
+  PendingOperationsMap ops;
   {
     AutoLock locked(pending_lock_);
     pending_.swap(ops);
@@ -146,12 +179,21 @@ void SQLitePersistentCookieStore::Backend::Commit() {
   if (!db_ || ops.empty())
     return;
 
+  UMA_HISTOGRAM_COUNTS(L"Cookie.CommitBatchSize", static_cast<int>(ops.size()));
+
   SQLITE_UNIQUE_STATEMENT(add_smt, *cache_,
                           "INSERT INTO cookies VALUES (?,?,?,?,?,?,?,?)");
   if (!add_smt.is_valid()) {
     NOTREACHED();
     return;
   }
+  SQLITE_UNIQUE_STATEMENT(update_smt, *cache_,
+                          "INSERT OR REPLACE INTO cookies "
+                          "VALUES (?,?,?,?,?,?,?,?)");
+  if (!update_smt.is_valid()) {
+    NOTREACHED();
+    return;
+  }
   SQLITE_UNIQUE_STATEMENT(del_smt, *cache_,
                           "DELETE FROM cookies WHERE creation_utc=?");
   if (!del_smt.is_valid()) {
@@ -161,25 +203,29 @@ void SQLitePersistentCookieStore::Backend::Commit() {
 
   SQLTransaction transaction(db_);
   transaction.Begin();
-  for (PendingOperationsList::iterator it = ops.begin();
+  for (PendingOperationsMap::iterator it = ops.begin();
        it != ops.end(); ++it) {
     // Free the cookies as we commit them to the database.
-    scoped_ptr<PendingOperation> po(*it);
+    scoped_ptr<PendingOperation> po(it->second);
     switch (po->op()) {
       case PendingOperation::COOKIE_ADD:
-        add_smt->reset();
-        add_smt->bind_int64(0, po->cc().CreationDate().ToInternalValue());
-        add_smt->bind_string(1, po->key());
-        add_smt->bind_string(2, po->cc().Name());
-        add_smt->bind_string(3, po->cc().Value());
-        add_smt->bind_string(4, po->cc().Path());
-        add_smt->bind_int64(5, po->cc().ExpiryDate().ToInternalValue());
-        add_smt->bind_int(6, po->cc().IsSecure());
-        add_smt->bind_int(7, po->cc().IsHttpOnly());
-        if (add_smt->step() != SQLITE_DONE) {
+      case PendingOperation::COOKIE_UPDATE: {
+        SQLStatement* smt = (po->op() == PendingOperation::COOKIE_ADD) ?
+            add_smt.statement() : update_smt.statement();
+        smt->reset();
+        smt->bind_int64(0, po->cc().CreationDate().ToInternalValue());
+        smt->bind_string(1, po->key());
+        smt->bind_string(2, po->cc().Name());
+        smt->bind_string(3, po->cc().Value());
+        smt->bind_string(4, po->cc().Path());
+        smt->bind_int64(5, po->cc().ExpiryDate().ToInternalValue());
+        smt->bind_int(6, po->cc().IsSecure());
+        smt->bind_int(7, po->cc().IsHttpOnly());
+        if (smt->step() != SQLITE_DONE) {
           NOTREACHED() << "Could not add a cookie to the DB.";
         }
         break;
+      }
       case PendingOperation::COOKIE_DELETE:
         del_smt->reset();
         del_smt->bind_int64(0, po->cc().CreationDate().ToInternalValue());
@@ -195,18 +241,22 @@ void SQLitePersistentCookieStore::Backend::Commit() {
   transaction.Commit();
 }
 
-// Fire off a close message to the background thread.  We could still have a
-// pending commit timer that will be holding a reference on us, but if/when
-// this fires we will already have been cleaned up and it will be ignored.
+// Fire off a close message to the background thread and wait for it to
+// finish.  We could still have a pending commit timer that will be holding a
+// reference on us, but if/when this fires we will already have been cleaned up
+// and it will be ignored.
 void SQLitePersistentCookieStore::Backend::Close() {
   DCHECK(MessageLoop::current() != background_loop_);
   // Must close the backend on the background thread.
   // TODO(abarth): What if the DB thread is being destroyed on the UI thread?
+  base::WaitableEvent done(false, false);
   background_loop_->PostTask(FROM_HERE,
-      NewRunnableMethod(this, &Backend::InternalBackgroundClose));
+      NewRunnableMethod(this, &Backend::InternalBackgroundClose, &done));
+  done.Wait();
 }
 
-void SQLitePersistentCookieStore::Backend::InternalBackgroundClose() {
+void SQLitePersistentCookieStore::Backend::InternalBackgroundClose(
+    base::WaitableEvent* done) {
   DCHECK(MessageLoop::current() == background_loop_);
   // Commit any pending operations
   Commit();
@@ -215,6 +265,7 @@ void SQLitePersistentCookieStore::Backend::InternalBackgroundClose() {
   cache_ = NULL;
   sqlite3_close(db_);
   db_ = NULL;
+  done->Signal();
 }
 
 SQLitePersistentCookieStore::SQLitePersistentCookieStore(
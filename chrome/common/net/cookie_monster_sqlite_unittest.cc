@@ -0,0 +1,101 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/file_util.h"
+#include "base/scoped_ptr.h"
+#include "base/thread.h"
+#include "chrome/common/net/cookie_monster_sqlite.h"
+#include "chrome/common/stl_util-inl.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+typedef std::vector<net::CookieMonster::KeyedCanonicalCookie> CookieVector;
+
+class SQLitePersistentCookieStoreTest : public testing::Test {
+ public:
+  SQLitePersistentCookieStoreTest() : db_thread_("TestDBThread") {
+  }
+
+ protected:
+  virtual void SetUp() {
+    ASSERT_TRUE(db_thread_.Start());
+    ASSERT_TRUE(file_util::CreateNewTempDirectory(L"CookieStoreTest",
+                                                  &temp_dir_));
+    db_path_ = temp_dir_;
+    file_util::AppendToPath(&db_path_, L"Cookies");
+  }
+
+  virtual void TearDown() {
+    store_.reset();
+    db_thread_.Stop();
+    file_util::Delete(temp_dir_, true);
+  }
+
+  // Opens the store, replacing any previous one, and loads its cookies.
+  void LoadStore(CookieVector* cookies) {
+    // Destroying the old store flushes its pending operations.
+    store_.reset();
+    store_.reset(new SQLitePersistentCookieStore(db_path_,
+                                                 db_thread_.message_loop()));
+    ASSERT_TRUE(store_->Load(cookies));
+  }
+
+  static net::CookieMonster::CanonicalCookie MakeCookie(
+      const std::string& name,
+      const std::string& value,
+      const Time& creation) {
+    return net::CookieMonster::CanonicalCookie(
+        name, value, "/", false, false, creation, true,
+        creation + TimeDelta::FromDays(1));
+  }
+
+  base::Thread db_thread_;
+  std::wstring temp_dir_;
+  std::wstring db_path_;
+  scoped_ptr<SQLitePersistentCookieStore> store_;
+};
+
+}  // namespace
+
+TEST_F(SQLitePersistentCookieStoreTest, PersistsOperations) {
+  CookieVector cookies;
+  LoadStore(&cookies);
+  EXPECT_EQ(0U, cookies.size());
+
+  Time now = Time::Now() - TimeDelta::FromMinutes(1);
+  Time creation_a = now;
+  Time creation_b = now + TimeDelta::FromSeconds(1);
+  Time creation_c = now + TimeDelta::FromSeconds(2);
+
+  store_->AddCookie("a.com", MakeCookie("A", "1", creation_a));
+  store_->AddCookie("b.com", MakeCookie("B", "1", creation_b));
+  store_->AddCookie("c.com", MakeCookie("C", "1", creation_c));
+
+  // These all collapse with the operations above before they are committed.
+  store_->DeleteCookie(MakeCookie("B", "1", creation_b));
+  store_->AddCookie("c.com", MakeCookie("C", "2", creation_c));
+
+  // The store is closed synchronously, so everything is on disk once the
+  // store is opened again.
+  LoadStore(&cookies);
+  ASSERT_EQ(2U, cookies.size());
+  EXPECT_EQ("a.com", cookies[0].first);
+  EXPECT_EQ("A", cookies[0].second->Name());
+  EXPECT_EQ("c.com", cookies[1].first);
+  EXPECT_EQ("2", cookies[1].second->Value());
+  STLDeleteContainerPairSecondPointers(cookies.begin(), cookies.end());
+  cookies.clear();
+
+  // Delete and re-add a cookie that is already in the database.
+  store_->DeleteCookie(MakeCookie("A", "1", creation_a));
+  store_->AddCookie("a.com", MakeCookie("A", "3", creation_a));
+  store_->DeleteCookie(MakeCookie("C", "2", creation_c));
+
+  LoadStore(&cookies);
+  ASSERT_EQ(1U, cookies.size());
+  EXPECT_EQ("a.com", cookies[0].first);
+  EXPECT_EQ("3", cookies[0].second->Value());
+  STLDeleteContainerPairSecondPointers(cookies.begin(), cookies.end());
+}
@@ -17,6 +17,15 @@ BZip2Filter::~BZip2Filter() {
   }
 }
 
+// static
+Filter* BZip2Filter::Create(Filter::FilterType type_id, int buffer_size) {
+  scoped_ptr<BZip2Filter> bzip2_filter(new BZip2Filter());
+  if (!bzip2_filter->InitBuffer(buffer_size) ||
+      !bzip2_filter->InitDecoding(false))
+    return NULL;
+  return bzip2_filter.release();
+}
+
 bool BZip2Filter::InitDecoding(bool use_small_memory) {
   if (decoding_status_ != DECODING_UNINITIALIZED)
     return false;
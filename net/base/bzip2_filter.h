@@ -30,6 +30,9 @@ class BZip2Filter : public Filter {
 
   virtual ~BZip2Filter();
 
+  // The Filter::FilterCreator for bzip2.  Returns NULL on failure.
+  static Filter* Create(Filter::FilterType type_id, int buffer_size);
+
   // Initializes filter decoding mode and internal control blocks.
   // Parameter use_small_memory specifies whether use small memory
   // to decompresss data. If small is nonzero, the bzip2 library will
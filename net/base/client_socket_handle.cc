@@ -24,6 +24,15 @@ int ClientSocketHandle::Init(const std::string& group_name,
   return pool_->RequestSocket(this, callback);
 }
 
+bool ClientSocketHandle::InitWithIdleSocket(const std::string& group_name) {
+  Reset();
+  group_name_ = group_name;
+  if (pool_->RequestIdleSocket(this))
+    return true;
+  group_name_.clear();
+  return false;
+}
+
 void ClientSocketHandle::Reset() {
   if (group_name_.empty())  // Was Init called?
     return;
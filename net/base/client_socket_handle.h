@@ -45,6 +45,12 @@ class ClientSocketHandle {
   //
   int Init(const std::string& group_name, CompletionCallback* callback);
 
+  // Initializes the handle only if the ClientSocketPool has an idle socket of
+  // the group that is still connected.  Returns true on success, in which case
+  // the socket member is that socket.  Otherwise, the handle is left
+  // un-initialized and nothing is asked of the pool.
+  bool InitWithIdleSocket(const std::string& group_name);
+
   // An initialized handle can be reset, which causes it to return to the
   // un-initialized state.  This releases the underlying socket, which in the
   // case of a socket that still has an established connection, indicates that
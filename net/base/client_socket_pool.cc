@@ -4,6 +4,7 @@
 
 #include "net/base/client_socket_pool.h"
 
+#include "base/histogram.h"
 #include "base/message_loop.h"
 #include "net/base/client_socket.h"
 #include "net/base/client_socket_handle.h"
@@ -18,9 +19,13 @@ const int kCleanupInterval = 5;
 
 namespace net {
 
-ClientSocketPool::ClientSocketPool(int max_sockets_per_group)
+ClientSocketPool::ClientSocketPool(int max_sockets_per_group, int max_sockets)
     : idle_socket_count_(0),
-      max_sockets_per_group_(max_sockets_per_group) {
+      active_socket_count_(0),
+      next_sequence_number_(0),
+      max_sockets_per_group_(max_sockets_per_group),
+      max_sockets_(max_sockets) {
+  DCHECK_LE(max_sockets_per_group, max_sockets);
 }
 
 ClientSocketPool::~ClientSocketPool() {
@@ -35,44 +40,47 @@ int ClientSocketPool::RequestSocket(ClientSocketHandle* handle,
                                     CompletionCallback* callback) {
   Group& group = group_map_[handle->group_name_];
 
-  // Can we make another active socket now?
-  if (group.active_socket_count == max_sockets_per_group_) {
+  // Can we hand out a socket now?  Note that there can be no pending requests
+  // that could be satisfied, so nobody older is waiting for this socket.
+  if (!CanGrantRequest(group)) {
     Request r;
     r.handle = handle;
     DCHECK(callback);
     r.callback = callback;
+    r.request_time = TimeTicks::Now();
+    r.sequence_number = next_sequence_number_++;
     group.pending_requests.push_back(r);
     return ERR_IO_PENDING;
   }
 
-  // OK, we are going to activate one.
-  group.active_socket_count++;
+  GrantSocket(&group, handle);
+  return OK;
+}
 
-  // Use idle sockets in LIFO order because they're more likely to be
-  // still connected.
-  while (!group.idle_sockets.empty()) {
-    ClientSocketPtr* ptr = group.idle_sockets.back();
-    group.idle_sockets.pop_back();
-    DecrementIdleCount();
-    if ((*ptr)->IsConnected()) {
-      // We found one we can reuse!
-      handle->socket_ = ptr;
-      return OK;
-    }
-    delete ptr;
+bool ClientSocketPool::RequestIdleSocket(ClientSocketHandle* handle) {
+  GroupMap::iterator i = group_map_.find(handle->group_name_);
+  if (i == group_map_.end())
+    return false;
+  Group& group = i->second;
+
+  if (group.active_socket_count >= max_sockets_per_group_ ||
+      !TakeIdleSocket(&group, handle)) {
+    // We may have closed the last idle sockets of the group.
+    if (group.IsEmpty())
+      group_map_.erase(i);
+    return false;
   }
 
-  handle->socket_ = new ClientSocketPtr();
-  return OK;
+  group.active_socket_count++;
+  active_socket_count_++;
+  RecordSocketReuse(true);
+  return true;
 }
 
 void ClientSocketPool::CancelRequest(ClientSocketHandle* handle) {
-  Group& group = group_map_[handle->group_name_];
-
-  // In order for us to be canceling a pending request, we must have active
-  // sockets equaling the limit.  NOTE: The correctness of the code doesn't
-  // require this assertion.
-  DCHECK(group.active_socket_count == max_sockets_per_group_);
+  GroupMap::iterator i = group_map_.find(handle->group_name_);
+  DCHECK(i != group_map_.end());
+  Group& group = i->second;
 
   // Search pending_requests for matching handle.
   std::deque<Request>::iterator it = group.pending_requests.begin();
@@ -82,6 +90,11 @@ void ClientSocketPool::CancelRequest(ClientSocketHandle* handle) {
       break;
     }
   }
+
+  // A request that was waiting for the global limit may be the only thing
+  // left on its group.
+  if (group.IsEmpty())
+    group_map_.erase(i);
 }
 
 void ClientSocketPool::ReleaseSocket(ClientSocketHandle* handle) {
@@ -106,10 +119,10 @@ void ClientSocketPool::MaybeCloseIdleSockets(
   while (i != group_map_.end()) {
     Group& group = i->second;
 
-    std::deque<ClientSocketPtr*>::iterator j = group.idle_sockets.begin();
+    std::deque<IdleSocket>::iterator j = group.idle_sockets.begin();
     while (j != group.idle_sockets.end()) {
-      if (!only_if_disconnected || !(*j)->get()->IsConnected()) {
-        delete *j;
+      if (!only_if_disconnected || !j->ptr->get()->IsConnected()) {
+        delete j->ptr;
         j = group.idle_sockets.erase(j);
         DecrementIdleCount();
       } else {
@@ -118,8 +131,7 @@ void ClientSocketPool::MaybeCloseIdleSockets(
     }
 
     // Delete group if no longer needed.
-    if (group.active_socket_count == 0 && group.idle_sockets.empty()) {
-      DCHECK(group.pending_requests.empty());
+    if (group.IsEmpty()) {
       group_map_.erase(i++);
     } else {
       ++i;
@@ -147,30 +159,136 @@ void ClientSocketPool::DoReleaseSocket(const std::string& group_name,
 
   DCHECK(group.active_socket_count > 0);
   group.active_socket_count--;
+  active_socket_count_--;
 
   bool can_reuse = ptr->get() && (*ptr)->IsConnected();
   if (can_reuse) {
-    group.idle_sockets.push_back(ptr);
+    IdleSocket idle_socket;
+    idle_socket.ptr = ptr;
+    idle_socket.start_time = TimeTicks::Now();
+    group.idle_sockets.push_back(idle_socket);
     IncrementIdleCount();
   } else {
     delete ptr;
   }
 
-  // Process one pending request.
-  if (!group.pending_requests.empty()) {
-    Request r = group.pending_requests.front();
-    group.pending_requests.pop_front();
-    int rv = RequestSocket(r.handle, NULL);
-    DCHECK(rv == OK);
-    r.callback->Run(rv);
+  // The socket (or the room for a new one) goes to whoever has been waiting
+  // for the longest time, not necessarily to a request of this group.
+  ProcessPendingRequests();
+
+  // Delete group if no longer needed.  Note that the callbacks may have
+  // modified the map.
+  i = group_map_.find(group_name);
+  if (i != group_map_.end() && i->second.IsEmpty())
+    group_map_.erase(i);
+}
+
+bool ClientSocketPool::CanGrantRequest(const Group& group) const {
+  if (group.active_socket_count >= max_sockets_per_group_)
+    return false;
+
+  // Reusing a socket doesn't change the number of sockets, and we can always
+  // close an idle socket to make room for a new one.
+  if (!group.idle_sockets.empty() || idle_socket_count_)
+    return true;
+
+  return active_socket_count_ < max_sockets_;
+}
+
+bool ClientSocketPool::TakeIdleSocket(Group* group,
+                                      ClientSocketHandle* handle) {
+  // Use idle sockets in LIFO order because they're more likely to be
+  // still connected.
+  while (!group->idle_sockets.empty()) {
+    ClientSocketPtr* ptr = group->idle_sockets.back().ptr;
+    group->idle_sockets.pop_back();
+    DecrementIdleCount();
+    if ((*ptr)->IsConnected()) {
+      // We found one we can reuse!
+      handle->socket_ = ptr;
+      return true;
+    }
+    delete ptr;
+  }
+  return false;
+}
+
+void ClientSocketPool::GrantSocket(Group* group, ClientSocketHandle* handle) {
+  DCHECK(CanGrantRequest(*group));
+  group->active_socket_count++;
+  active_socket_count_++;
+
+  if (TakeIdleSocket(group, handle)) {
+    RecordSocketReuse(true);
     return;
   }
 
-  // Delete group if no longer needed.
-  if (group.active_socket_count == 0 && group.idle_sockets.empty()) {
-    DCHECK(group.pending_requests.empty());
-    group_map_.erase(i);
+  if (active_socket_count_ + idle_socket_count_ > max_sockets_)
+    CloseOldestIdleSocket();
+  DCHECK_LE(active_socket_count_ + idle_socket_count_, max_sockets_);
+
+  handle->socket_ = new ClientSocketPtr();
+  RecordSocketReuse(false);
+}
+
+void ClientSocketPool::ProcessPendingRequests() {
+  for (;;) {
+    // Look for the oldest request that can be satisfied.
+    Group* oldest = NULL;
+    for (GroupMap::iterator i = group_map_.begin(); i != group_map_.end();
+         ++i) {
+      Group& group = i->second;
+      if (group.pending_requests.empty() || !CanGrantRequest(group))
+        continue;
+      if (!oldest || group.pending_requests.front().sequence_number <
+                     oldest->pending_requests.front().sequence_number) {
+        oldest = &group;
+      }
+    }
+    if (!oldest)
+      return;
+
+    Request r = oldest->pending_requests.front();
+    oldest->pending_requests.pop_front();
+    GrantSocket(oldest, r.handle);
+    UMA_HISTOGRAM_TIMES(L"Net.SocketPool_ConnectWaitTime",
+                        TimeTicks::Now() - r.request_time);
+
+    // The callback may issue or cancel requests, so |oldest| may not be valid
+    // after this point.
+    r.callback->Run(OK);
+  }
+}
+
+void ClientSocketPool::CloseOldestIdleSocket() {
+  GroupMap::iterator oldest = group_map_.end();
+  for (GroupMap::iterator i = group_map_.begin(); i != group_map_.end(); ++i) {
+    const std::deque<IdleSocket>& idle_sockets = i->second.idle_sockets;
+    if (idle_sockets.empty())
+      continue;
+    if (oldest == group_map_.end() || idle_sockets.front().start_time <
+        oldest->second.idle_sockets.front().start_time) {
+      oldest = i;
+    }
+  }
+  if (oldest == group_map_.end()) {
+    NOTREACHED();
+    return;
   }
+
+  Group& group = oldest->second;
+  delete group.idle_sockets.front().ptr;
+  group.idle_sockets.pop_front();
+  DecrementIdleCount();
+  if (group.IsEmpty())
+    group_map_.erase(oldest);
+}
+
+void ClientSocketPool::RecordSocketReuse(bool reused) {
+  // Samples go to the buckets for 0 (new socket) and 1 (reused socket).
+  static LinearHistogram histogram(L"Net.SocketPool_Reused", 1, 2, 3);
+  histogram.SetFlags(kUmaTargetedHistogramFlag);
+  histogram.Add(reused ? 1 : 0);
 }
 
 void ClientSocketPool::DoTimeout() {
@@ -10,6 +10,7 @@
 #include <string>
 
 #include "base/ref_counted.h"
+#include "base/time.h"
 #include "base/timer.h"
 #include "net/base/completion_callback.h"
 
@@ -18,8 +19,14 @@ namespace net {
 class ClientSocket;
 class ClientSocketHandle;
 
-// A ClientSocketPool is used to restrict the number of sockets open at a time.
-// It also maintains a list of idle persistent sockets.
+// A ClientSocketPool is used to restrict the number of sockets open at a time,
+// both per group and across all groups.  It also maintains a list of idle
+// persistent sockets.
+//
+// Requests that cannot be satisfied right away are not tied to any particular
+// socket: whenever a socket is released (or a slot to create one frees up),
+// it goes to the oldest waiting request that can use it.  Idle sockets are
+// reused in LIFO order, so the most recently used connection is picked first.
 //
 // The ClientSocketPool allocates scoped_ptr<ClientSocket> objects, but it is
 // not responsible for allocating the associated ClientSocket objects.  The
@@ -27,7 +34,7 @@ class ClientSocketHandle;
 //
 class ClientSocketPool : public base::RefCounted<ClientSocketPool> {
  public:
-  explicit ClientSocketPool(int max_sockets_per_group);
+  ClientSocketPool(int max_sockets_per_group, int max_sockets);
 
   // Called to request a socket for the given handle.  There are three possible
   // results: 1) the handle will be initialized with a socket to reuse, 2) the
@@ -48,6 +55,11 @@ class ClientSocketPool : public base::RefCounted<ClientSocketPool> {
   //
   int RequestSocket(ClientSocketHandle* handle, CompletionCallback* callback);
 
+  // Like RequestSocket, but only initializes |handle| if an idle socket of its
+  // group that is still connected can be reused right away.  Returns false,
+  // leaving the pool untouched, otherwise.
+  bool RequestIdleSocket(ClientSocketHandle* handle);
+
   // Called to cancel a RequestSocket call that returned ERR_IO_PENDING.  The
   // same handle parameter must be passed to this method as was passed to the
   // RequestSocket call being cancelled.  The associated CompletionCallback is
@@ -81,30 +93,68 @@ class ClientSocketPool : public base::RefCounted<ClientSocketPool> {
   void IncrementIdleCount();
   void DecrementIdleCount();
 
-  // Called via PostTask by ReleaseSocket.
-  void DoReleaseSocket(const std::string& group_name, ClientSocketPtr* ptr);
-
-  // Called when timer_ fires.  This method scans the idle sockets checking to
-  // see if any have been disconnected.
-  void DoTimeout();
-
   // A Request is allocated per call to RequestSocket that results in
   // ERR_IO_PENDING.
   struct Request {
     ClientSocketHandle* handle;
     CompletionCallback* callback;
+    TimeTicks request_time;
+    int64 sequence_number;  // Orders requests of different groups.
+  };
+
+  // An idle socket, and the time when it was released.
+  struct IdleSocket {
+    ClientSocketPtr* ptr;
+    TimeTicks start_time;
   };
 
   // A Group is allocated per group_name when there are idle sockets or pending
   // requests.  Otherwise, the Group object is removed from the map.
   struct Group {
     Group() : active_socket_count(0) {}
-    std::deque<ClientSocketPtr*> idle_sockets;
+
+    bool IsEmpty() const {
+      return active_socket_count == 0 && idle_sockets.empty() &&
+             pending_requests.empty();
+    }
+
+    std::deque<IdleSocket> idle_sockets;
     std::deque<Request> pending_requests;
     int active_socket_count;
   };
 
   typedef std::map<std::string, Group> GroupMap;
+
+  // Returns true if a request for |group| can be given a socket now, either
+  // an idle one or a new one (closing an idle socket of another group if the
+  // global limit has been reached).
+  bool CanGrantRequest(const Group& group) const;
+
+  // Initializes |handle| with the most recently used idle socket of |group|
+  // that is still connected, if there is one.  Disconnected idle sockets found
+  // on the way are closed.  Does not update the active socket counts.
+  bool TakeIdleSocket(Group* group, ClientSocketHandle* handle);
+
+  // Initializes |handle| with an idle socket of |group| or with a new one.
+  // CanGrantRequest must be true.
+  void GrantSocket(Group* group, ClientSocketHandle* handle);
+
+  // Gives sockets to the oldest pending requests, for as long as possible.
+  void ProcessPendingRequests();
+
+  // Closes the idle socket that has been idle for the longest time.
+  void CloseOldestIdleSocket();
+
+  // Records whether a request was satisfied with an idle socket.
+  void RecordSocketReuse(bool reused);
+
+  // Called via PostTask by ReleaseSocket.
+  void DoReleaseSocket(const std::string& group_name, ClientSocketPtr* ptr);
+
+  // Called when timer_ fires.  This method scans the idle sockets checking to
+  // see if any have been disconnected.
+  void DoTimeout();
+
   GroupMap group_map_;
 
   // Timer used to periodically prune sockets that have been disconnected.
@@ -113,9 +163,18 @@ class ClientSocketPool : public base::RefCounted<ClientSocketPool> {
   // The total number of idle sockets in the system.
   int idle_socket_count_;
 
+  // The total number of sockets handed out to consumers.
+  int active_socket_count_;
+
+  // The sequence number for the next pending request.
+  int64 next_sequence_number_;
+
   // The maximum number of sockets kept per group.
   int max_sockets_per_group_;
-  
+
+  // The maximum number of sockets (active or idle) kept by the pool.
+  int max_sockets_;
+
   DISALLOW_COPY_AND_ASSIGN(ClientSocketPool);
 };
 
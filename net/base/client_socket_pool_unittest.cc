@@ -14,6 +14,7 @@ namespace {
 typedef testing::Test ClientSocketPoolTest;
 
 const int kMaxSocketsPerGroup = 6;
+const int kMaxSockets = 20;
 
 class MockClientSocket : public net::ClientSocket {
  public:
@@ -83,7 +84,7 @@ int TestSocketRequest::completion_count = 0;
 
 TEST(ClientSocketPoolTest, Basic) {
   scoped_refptr<net::ClientSocketPool> pool =
-      new net::ClientSocketPool(kMaxSocketsPerGroup);
+      new net::ClientSocketPool(kMaxSocketsPerGroup, kMaxSockets);
 
   TestSocketRequest r(pool);
   int rv;
@@ -100,7 +101,7 @@ TEST(ClientSocketPoolTest, Basic) {
 
 TEST(ClientSocketPoolTest, WithIdleConnection) {
   scoped_refptr<net::ClientSocketPool> pool =
-      new net::ClientSocketPool(kMaxSocketsPerGroup);
+      new net::ClientSocketPool(kMaxSocketsPerGroup, kMaxSockets);
 
   TestSocketRequest r(pool);
   int rv;
@@ -122,7 +123,7 @@ TEST(ClientSocketPoolTest, WithIdleConnection) {
 
 TEST(ClientSocketPoolTest, PendingRequests) {
   scoped_refptr<net::ClientSocketPool> pool =
-      new net::ClientSocketPool(kMaxSocketsPerGroup);
+      new net::ClientSocketPool(kMaxSocketsPerGroup, kMaxSockets);
 
   int rv;
 
@@ -162,7 +163,7 @@ TEST(ClientSocketPoolTest, PendingRequests) {
 
 TEST(ClientSocketPoolTest, PendingRequests_NoKeepAlive) {
   scoped_refptr<net::ClientSocketPool> pool =
-      new net::ClientSocketPool(kMaxSocketsPerGroup);
+      new net::ClientSocketPool(kMaxSocketsPerGroup, kMaxSockets);
 
   int rv;
 
@@ -203,7 +204,7 @@ TEST(ClientSocketPoolTest, PendingRequests_NoKeepAlive) {
 
 TEST(ClientSocketPoolTest, CancelRequest) {
   scoped_refptr<net::ClientSocketPool> pool =
-      new net::ClientSocketPool(kMaxSocketsPerGroup);
+      new net::ClientSocketPool(kMaxSocketsPerGroup, kMaxSockets);
 
   int rv;
 
@@ -246,3 +247,119 @@ TEST(ClientSocketPoolTest, CancelRequest) {
   EXPECT_EQ(9, TestSocketRequest::completion_count);
 }
 
+TEST(ClientSocketPoolTest, IdleSocketsReusedLIFO) {
+  scoped_refptr<net::ClientSocketPool> pool =
+      new net::ClientSocketPool(kMaxSocketsPerGroup, kMaxSockets);
+
+  TestSocketRequest r1(pool), r2(pool), r3(pool);
+  EXPECT_EQ(net::OK, r1.handle.Init("a", &r1));
+  r1.EnsureSocket();
+  EXPECT_EQ(net::OK, r2.handle.Init("a", &r2));
+  r2.EnsureSocket();
+  net::ClientSocket* second_socket = r2.handle.socket();
+
+  // Release the sockets in order; the last one should be reused first.
+  r1.handle.Reset();
+  MessageLoop::current()->RunAllPending();
+  r2.handle.Reset();
+  MessageLoop::current()->RunAllPending();
+
+  EXPECT_EQ(net::OK, r3.handle.Init("a", &r3));
+  EXPECT_TRUE(r3.handle.socket() == second_socket);
+
+  r3.handle.Reset();
+  MessageLoop::current()->RunAllPending();
+}
+
+TEST(ClientSocketPoolTest, GlobalLimit) {
+  const int kMaxPerGroup = 2;
+  scoped_refptr<net::ClientSocketPool> pool =
+      new net::ClientSocketPool(kMaxPerGroup, kMaxPerGroup * 2);
+
+  TestSocketRequest a1(pool), a2(pool), a3(pool);
+  TestSocketRequest b1(pool), b2(pool), c1(pool);
+  MockClientSocket::allocation_count = 0;
+  TestSocketRequest::completion_count = 0;
+
+  EXPECT_EQ(net::OK, a1.handle.Init("a", &a1));
+  a1.EnsureSocket();
+  EXPECT_EQ(net::OK, a2.handle.Init("a", &a2));
+  a2.EnsureSocket();
+  EXPECT_EQ(net::OK, b1.handle.Init("b", &b1));
+  b1.EnsureSocket();
+  EXPECT_EQ(net::OK, b2.handle.Init("b", &b2));
+  b2.EnsureSocket();
+
+  // The pool is full, so this one has to wait even though its group is empty.
+  EXPECT_EQ(net::ERR_IO_PENDING, c1.handle.Init("c", &c1));
+  EXPECT_EQ(net::ERR_IO_PENDING, a3.handle.Init("a", &a3));
+
+  // Releasing a socket of group "a" should not benefit a3 over c1, which has
+  // been waiting for longer: the idle socket is closed to make room.
+  a1.handle.Reset();
+  MessageLoop::current()->RunAllPending();
+  EXPECT_TRUE(c1.handle.is_initialized());
+  EXPECT_FALSE(a3.handle.is_initialized());
+  EXPECT_EQ(1, TestSocketRequest::completion_count);
+
+  // Now a3 can go.
+  b1.handle.Reset();
+  MessageLoop::current()->RunAllPending();
+  EXPECT_TRUE(a3.handle.is_initialized());
+  EXPECT_EQ(2, TestSocketRequest::completion_count);
+  EXPECT_EQ(6, MockClientSocket::allocation_count);
+
+  a2.handle.Reset();
+  a3.handle.Reset();
+  b2.handle.Reset();
+  c1.handle.Reset();
+  MessageLoop::current()->RunAllPending();
+}
+
+TEST(ClientSocketPoolTest, CancelRequestOnFullPool) {
+  scoped_refptr<net::ClientSocketPool> pool =
+      new net::ClientSocketPool(kMaxSocketsPerGroup, kMaxSocketsPerGroup);
+
+  scoped_ptr<TestSocketRequest> reqs[kMaxSocketsPerGroup];
+  for (size_t i = 0; i < arraysize(reqs); ++i) {
+    reqs[i].reset(new TestSocketRequest(pool));
+    EXPECT_EQ(net::OK, reqs[i]->handle.Init("a", reqs[i].get()));
+    reqs[i]->EnsureSocket();
+  }
+
+  // A request of another group that is canceled while waiting should not
+  // leave anything behind.
+  TestSocketRequest r(pool);
+  EXPECT_EQ(net::ERR_IO_PENDING, r.handle.Init("b", &r));
+  r.handle.Reset();
+
+  for (size_t i = 0; i < arraysize(reqs); ++i)
+    reqs[i]->handle.Reset();
+  MessageLoop::current()->RunAllPending();
+}
+
+TEST(ClientSocketPoolTest, RequestIdleSocket) {
+  scoped_refptr<net::ClientSocketPool> pool =
+      new net::ClientSocketPool(kMaxSocketsPerGroup, kMaxSockets);
+
+  // Without an idle socket, the handle is left alone.
+  TestSocketRequest r1(pool), r2(pool);
+  EXPECT_FALSE(r2.handle.InitWithIdleSocket("a"));
+  EXPECT_FALSE(r2.handle.is_initialized());
+
+  EXPECT_EQ(net::OK, r1.handle.Init("a", &r1));
+  r1.EnsureSocket();
+  net::ClientSocket* socket = r1.handle.socket();
+  r1.handle.Reset();
+  MessageLoop::current()->RunAllPending();
+
+  EXPECT_TRUE(r2.handle.InitWithIdleSocket("a"));
+  EXPECT_TRUE(r2.handle.socket() == socket);
+
+  // A disconnected idle socket is not handed out.
+  r2.handle.socket()->Disconnect();
+  r2.handle.Reset();
+  MessageLoop::current()->RunAllPending();
+  EXPECT_FALSE(r2.handle.InitWithIdleSocket("a"));
+  EXPECT_FALSE(r2.handle.is_initialized());
+}
@@ -436,7 +436,7 @@ void CookieMonster::InternalInsertCookie(const std::string& key,
                                          bool sync_to_store) {
   if (cc->IsPersistent() && store_ && sync_to_store)
     store_->AddCookie(key, *cc);
-  cookies_.insert(CookieMap::value_type(key, cc));
+  IndexCookie(cookies_.insert(CookieMap::value_type(key, cc)));
 }
 
 void CookieMonster::InternalDeleteCookie(CookieMap::iterator it,
@@ -445,10 +445,95 @@ void CookieMonster::InternalDeleteCookie(CookieMap::iterator it,
   COOKIE_DLOG(INFO) << "InternalDeleteCookie() cc: " << cc->DebugString();
   if (cc->IsPersistent() && store_ && sync_to_store)
     store_->DeleteCookie(*cc);
+  // DeleteAll() drops the whole index up front.
+  if (!domain_index_.empty())
+    UnindexCookie(it);
   cookies_.erase(it);
   delete cc;
 }
 
+// Mozilla sorts on the path length (longest first), and then it
+// sorts by creation time (oldest first).
+// The RFC says the sort order for the domain attribute is undefined.
+static bool CookieSorter(const CookieMonster::CookieMap::iterator& it1,
+                         const CookieMonster::CookieMap::iterator& it2) {
+  const CookieMonster::CanonicalCookie* cc1 = it1->second;
+  const CookieMonster::CanonicalCookie* cc2 = it2->second;
+  if (cc1->Path().length() == cc2->Path().length())
+    return cc1->CreationDate() < cc2->CreationDate();
+  return cc1->Path().length() > cc2->Path().length();
+}
+
+// static
+std::string CookieMonster::GetDomainIndexKey(const std::string& key) {
+  const std::string domain(
+      RegistryControlledDomainService::GetDomainAndRegistry(key));
+  return domain.empty() ? key : domain;
+}
+
+void CookieMonster::IndexCookie(CookieMap::iterator it) {
+  DomainBucket& bucket = domain_index_[GetDomainIndexKey(it->first)];
+
+  // Keep the bucket in the order the cookies are sent in.
+  bucket.cookies.insert(std::upper_bound(bucket.cookies.begin(),
+                                         bucket.cookies.end(),
+                                         it, CookieSorter),
+                        it);
+  bucket.cookie_lines.clear();
+
+  const CanonicalCookie* cc = it->second;
+  if (cc->DoesExpire() && (bucket.earliest_expiry.is_null() ||
+                           cc->ExpiryDate() < bucket.earliest_expiry))
+    bucket.earliest_expiry = cc->ExpiryDate();
+}
+
+void CookieMonster::UnindexCookie(CookieMap::iterator it) {
+  DomainIndex::iterator bucket_it =
+      domain_index_.find(GetDomainIndexKey(it->first));
+  DCHECK(bucket_it != domain_index_.end());
+  if (bucket_it == domain_index_.end())
+    return;
+
+  DomainBucket& bucket = bucket_it->second;
+  std::vector<CookieMap::iterator>::iterator pos =
+      std::find(bucket.cookies.begin(), bucket.cookies.end(), it);
+  DCHECK(pos != bucket.cookies.end());
+  if (pos != bucket.cookies.end())
+    bucket.cookies.erase(pos);
+
+  // |earliest_expiry| is left alone; it is recomputed by the next purge.
+  if (bucket.cookies.empty())
+    domain_index_.erase(bucket_it);
+  else
+    bucket.cookie_lines.clear();
+}
+
+void CookieMonster::PurgeExpiredCookies(const std::string& index_key,
+                                        const Time& current) {
+  DomainIndex::iterator bucket_it = domain_index_.find(index_key);
+  if (bucket_it == domain_index_.end())
+    return;
+
+  // Deleting a cookie modifies the bucket, so find the expired ones first.
+  std::vector<CookieMap::iterator> expired;
+  Time earliest_expiry;
+  const std::vector<CookieMap::iterator>& cookies = bucket_it->second.cookies;
+  for (size_t i = 0; i < cookies.size(); ++i) {
+    CanonicalCookie* cc = cookies[i]->second;
+    if (cc->IsExpired(current)) {
+      expired.push_back(cookies[i]);
+    } else if (cc->DoesExpire() && (earliest_expiry.is_null() ||
+                                    cc->ExpiryDate() < earliest_expiry)) {
+      earliest_expiry = cc->ExpiryDate();
+    }
+  }
+  bucket_it->second.earliest_expiry = earliest_expiry;
+
+  // This may delete the bucket along with its last cookie.
+  for (size_t i = 0; i < expired.size(); ++i)
+    InternalDeleteCookie(expired[i], true);
+}
+
 int CookieMonster::DeleteEquivalentCookies(const std::string& key,
                                            const CanonicalCookie& ecc) {
   int num_deleted = 0;
@@ -562,6 +647,8 @@ int CookieMonster::DeleteAll(bool sync_to_store) {
   AutoLock autolock(lock_);
   InitIfNecessary();
 
+  domain_index_.clear();
+
   int num_deleted = 0;
   for (CookieMap::iterator it = cookies_.begin(); it != cookies_.end();) {
     CookieMap::iterator curit = it;
@@ -617,32 +704,17 @@ bool CookieMonster::DeleteCookie(const std::string& domain,
   return false;
 }
 
-// Mozilla sorts on the path length (longest first), and then it
-// sorts by creation time (oldest first).
-// The RFC says the sort order for the domain attribute is undefined.
-static bool CookieSorter(CookieMonster::CanonicalCookie* cc1,
-                         CookieMonster::CanonicalCookie* cc2) {
-  if (cc1->Path().length() == cc2->Path().length())
-    return cc1->CreationDate() < cc2->CreationDate();
-  return cc1->Path().length() > cc2->Path().length();
-}
-
 std::string CookieMonster::GetCookies(const GURL& url) {
   return GetCookiesWithOptions(url, NORMAL);
 }
 
-// Currently our cookie datastructure is based on Mozilla's approach.  We have a
-// hash keyed on the cookie's domain, and for any query we walk down the domain
-// components and probe for cookies until we reach the TLD, where we stop.
-// For example, a.b.blah.com, we would probe
-//   - a.b.blah.com
-//   - .a.b.blah.com (TODO should we check this first or second?)
-//   - .b.blah.com
-//   - .blah.com
-// There are some alternative datastructures we could try, like a
-// search/prefix trie, where we reverse the hostname and query for all
-// keys that are a prefix of our hostname.  I think the hash probing
-// should be fast and simple enough for now.
+// Our cookie datastructure started out based on Mozilla's approach, a hash
+// keyed on the cookie's domain, where a query walks down the domain components
+// of the host and probes for cookies at each of them.  Walking and probing
+// gets expensive with lots of cookies, so the cookies are now also indexed by
+// registrable domain: every cookie which could be sent to a.b.blah.com lives
+// in the bucket for blah.com, already in the order it is sent in.  The
+// resulting cookie lines are cached in the bucket until it changes.
 std::string CookieMonster::GetCookiesWithOptions(const GURL& url,
                                                  CookieOptions options) {
   if (!HasCookieableScheme(url)) {
@@ -650,100 +722,78 @@ std::string CookieMonster::GetCookiesWithOptions(const GURL& url,
     return std::string();
   }
 
-  // Get the cookies for this host and its domain(s).
-  std::vector<CanonicalCookie*> cookies;
-  FindCookiesForHostAndDomain(url, options, &cookies);
-  std::sort(cookies.begin(), cookies.end(), CookieSorter);
-
-  std::string cookie_line;
-  for (std::vector<CanonicalCookie*>::const_iterator it = cookies.begin();
-       it != cookies.end(); ++it) {
-    if (it != cookies.begin())
-      cookie_line += "; ";
-    // In Mozilla if you set a cookie like AAAA, it will have an empty token
-    // and a value of AAAA.  When it sends the cookie back, it will send AAAA,
-    // so we need to avoid sending =AAAA for a blank token value.
-    if (!(*it)->Name().empty())
-      cookie_line += (*it)->Name() + "=";
-    cookie_line += (*it)->Value();
-  }
-
-  COOKIE_DLOG(INFO) << "GetCookies() result: " << cookie_line;
-
-  return cookie_line;
-}
-
-// TODO(deanm): We could have expired cookies that haven't been purged yet,
-// and exporting these would be inaccurate, for example in the cookie manager
-// it might show cookies that are actually expired already.  We should do
-// a full garbage collection before ...  There actually isn't a way to do
-// this right now (a forceful full GC), so we'll have to live with the
-// possibility of showing the user expired cookies.  This shouldn't be very
-// common since most persistent cookies have a long lifetime.
-CookieMonster::CookieList CookieMonster::GetAllCookies() {
   AutoLock autolock(lock_);
   InitIfNecessary();
 
-  CookieList cookie_list;
+  const Time current_time(CurrentTime());
+  const std::string host(url.host());
+  const std::string index_key(GetDomainIndexKey(host));
 
-  for (CookieMap::iterator it = cookies_.begin(); it != cookies_.end(); ++it) {
-    cookie_list.push_back(CookieListPair(it->first, *it->second));
-  }
+  DomainIndex::iterator bucket_it = domain_index_.find(index_key);
+  if (bucket_it == domain_index_.end())
+    return std::string();
 
-  return cookie_list;
-}
+  if (!bucket_it->second.earliest_expiry.is_null() &&
+      current_time >= bucket_it->second.earliest_expiry) {
+    PurgeExpiredCookies(index_key, current_time);
+    bucket_it = domain_index_.find(index_key);
+    if (bucket_it == domain_index_.end())
+      return std::string();
+  }
+  DomainBucket& bucket = bucket_it->second;
 
-void CookieMonster::FindCookiesForHostAndDomain(
-    const GURL& url,
-    CookieOptions options,
-    std::vector<CanonicalCookie*>* cookies) {
-  AutoLock autolock(lock_);
-  InitIfNecessary();
+  std::string line_key(host);
+  line_key.append(url.SchemeIsSecure() ? "|s" : "|");
+  line_key.append((options & INCLUDE_HTTPONLY) ? "h" : "");
 
-  const Time current_time(CurrentTime());
+  CookieLineCache::const_iterator cached = bucket.cookie_lines.find(line_key);
+  if (cached != bucket.cookie_lines.end() &&
+      (!cached->second.path_dependent || cached->second.path == url.path())) {
+    return cached->second.line;
+  }
 
-  // Query for the full host, For example: 'a.c.blah.com'.
-  std::string key(url.host());
-  FindCookiesForKey(key, url, options, current_time, cookies);
+  // Don't let a bucket collect lines for an unbounded number of hosts.
+  static const size_t kMaxCookieLinesPerBucket = 16;
+  if (bucket.cookie_lines.size() >= kMaxCookieLinesPerBucket)
+    bucket.cookie_lines.clear();
 
-  // See if we can search for domain cookies, i.e. if the host has a TLD + 1.
-  const std::string domain(
-      RegistryControlledDomainService::GetDomainAndRegistry(key));
-  if (domain.empty())
-    return;
-  DCHECK_LE(domain.length(), key.length());
-  DCHECK_EQ(0, key.compare(key.length() - domain.length(), domain.length(),
-                           domain));
-
-  // Walk through the string and query at the dot points (GURL should have
-  // canonicalized the dots, so this should be safe).  Stop once we reach the
-  // domain + registry; we can't write cookies past this point, and with some
-  // registrars other domains can, in which case we don't want to read their
-  // cookies.
-  for (key = "." + key; key.length() > domain.length(); ) {
-    FindCookiesForKey(key, url, options, current_time, cookies);
-    const size_t next_dot = key.find('.', 1);  // Skip over leading dot.
-    key.erase(0, next_dot);
-  }
-}
+  CachedCookieLine& cookie_line = bucket.cookie_lines[line_key];
+  BuildCookieLine(bucket, url, options, &cookie_line);
 
-void CookieMonster::FindCookiesForKey(
-    const std::string& key,
-    const GURL& url,
-    CookieOptions options,
-    const Time& current,
-    std::vector<CanonicalCookie*>* cookies) {
-  bool secure = url.SchemeIsSecure();
+  COOKIE_DLOG(INFO) << "GetCookies() result: " << cookie_line.line;
 
-  for (CookieMapItPair its = cookies_.equal_range(key);
-       its.first != its.second; ) {
-    CookieMap::iterator curit = its.first;
-    CanonicalCookie* cc = curit->second;
-    ++its.first;
+  return cookie_line.line;
+}
 
-    // If the cookie is expired, delete it.
-    if (cc->IsExpired(current)) {
-      InternalDeleteCookie(curit, true);
+void CookieMonster::BuildCookieLine(const DomainBucket& bucket,
+                                    const GURL& url,
+                                    CookieOptions options,
+                                    CachedCookieLine* cookie_line) {
+  const std::string host(url.host());
+  const std::string& path = url.path();
+  const bool secure = url.SchemeIsSecure();
+
+  cookie_line->line.clear();
+  cookie_line->path_dependent = false;
+  cookie_line->path = path;
+
+  for (std::vector<CookieMap::iterator>::const_iterator it =
+           bucket.cookies.begin();
+       it != bucket.cookies.end(); ++it) {
+    const std::string& key = (*it)->first;
+    const CanonicalCookie* cc = (*it)->second;
+
+    // Host cookies must match the host exactly.  Domain cookies (".x.com")
+    // match x.com and any of its subdomains; the bucket only holds domains up
+    // to the registrable domain, so we never read the registrar's cookies.
+    if (key[0] == '.') {
+      if (host.length() + 1 < key.length())
+        continue;
+      if (host.length() + 1 == key.length() ?
+          key.compare(1, host.length(), host) :
+          host.compare(host.length() - key.length(), key.length(), key))
+        continue;
+    } else if (key != host) {
       continue;
     }
 
@@ -755,14 +805,44 @@ void CookieMonster::FindCookiesForKey(
     if (!secure && cc->IsSecure())
       continue;
 
-    if (!cc->IsOnPath(url.path()))
+    if (cc->Path() != "/")
+      cookie_line->path_dependent = true;
+    if (!cc->IsOnPath(path))
       continue;
 
     // Congratulations Charlie, you passed the test!
-    cookies->push_back(cc);
+    if (!cookie_line->line.empty())
+      cookie_line->line.append("; ");
+    // In Mozilla if you set a cookie like AAAA, it will have an empty token
+    // and a value of AAAA.  When it sends the cookie back, it will send AAAA,
+    // so we need to avoid sending =AAAA for a blank token value.
+    if (!cc->Name().empty()) {
+      cookie_line->line.append(cc->Name());
+      cookie_line->line.append("=");
+    }
+    cookie_line->line.append(cc->Value());
   }
 }
 
+// TODO(deanm): We could have expired cookies that haven't been purged yet,
+// and exporting these would be inaccurate, for example in the cookie manager
+// it might show cookies that are actually expired already.  We should do
+// a full garbage collection before ...  There actually isn't a way to do
+// this right now (a forceful full GC), so we'll have to live with the
+// possibility of showing the user expired cookies.  This shouldn't be very
+// common since most persistent cookies have a long lifetime.
+CookieMonster::CookieList CookieMonster::GetAllCookies() {
+  AutoLock autolock(lock_);
+  InitIfNecessary();
+
+  CookieList cookie_list;
+
+  for (CookieMap::iterator it = cookies_.begin(); it != cookies_.end(); ++it) {
+    cookie_list.push_back(CookieListPair(it->first, *it->second));
+  }
+
+  return cookie_list;
+}
 
 CookieMonster::ParsedCookie::ParsedCookie(const std::string& cookie_line)
     : is_valid_(false),
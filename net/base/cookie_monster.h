@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "base/basictypes.h"
+#include "base/hash_tables.h"
 #include "base/lock.h"
 #include "base/time.h"
 
@@ -132,15 +133,51 @@ class CookieMonster {
   // Should only be called by InitIfNecessary().
   void InitStore();
 
-  void FindCookiesForHostAndDomain(const GURL& url,
-                                   CookieOptions options,
-                                   std::vector<CanonicalCookie*>* cookies);
+  // Cookies are indexed by the registrable domain (eTLD+1) of their key, so
+  // that all the cookies which could be sent to a host are found with a
+  // single lookup.  Each bucket keeps its cookies in the order they are sent
+  // (see CookieSorter), along with the cookie lines recently built from them.
+  struct CachedCookieLine {
+    CachedCookieLine() : path_dependent(false) {}
 
-  void FindCookiesForKey(const std::string& key,
-                         const GURL& url,
-                         CookieOptions options,
-                         const Time& current,
-                         std::vector<CanonicalCookie*>* cookies);
+    std::string line;
+
+    // True if some of the cookies considered have a path other than "/", in
+    // which case the line is only valid for requests to |path|.
+    bool path_dependent;
+    std::string path;
+  };
+  typedef std::map<std::string, CachedCookieLine> CookieLineCache;
+
+  struct DomainBucket {
+    std::vector<CookieMap::iterator> cookies;
+
+    // Cookie lines keyed by host, scheme security and options.  Cleared
+    // whenever a cookie in the bucket is added or removed.
+    CookieLineCache cookie_lines;
+
+    // The earliest expiry among the bucket's cookies; cached lines may contain
+    // expired cookies from then on.  Null if none of them expires.
+    Time earliest_expiry;
+  };
+  typedef base::hash_map<std::string, DomainBucket> DomainIndex;
+
+  // Returns the key of the bucket holding cookies stored under |key|: the
+  // registrable domain, or |key| itself for hosts that have none, such as IP
+  // addresses and intranet hosts.
+  static std::string GetDomainIndexKey(const std::string& key);
+
+  // Deletes the expired cookies indexed under |index_key|.
+  void PurgeExpiredCookies(const std::string& index_key, const Time& current);
+
+  // Builds the cookie line for |url| from the cookies in |bucket|.
+  void BuildCookieLine(const DomainBucket& bucket,
+                       const GURL& url,
+                       CookieOptions options,
+                       CachedCookieLine* cookie_line);
+
+  void IndexCookie(CookieMap::iterator it);
+  void UnindexCookie(CookieMap::iterator it);
 
   int DeleteEquivalentCookies(const std::string& key,
                               const CanonicalCookie& ecc);
@@ -159,6 +196,7 @@ class CookieMonster {
                           size_t num_purge);
 
   CookieMap cookies_;
+  DomainIndex domain_index_;
 
   // Indicates whether the cookie store has been initialized. This happens
   // lazily in InitStoreIfNecessary().
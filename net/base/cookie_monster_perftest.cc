@@ -94,3 +94,87 @@ TEST(CookieMonsterTest, TestAddCookieOnManyHosts) {
   timer3.Done();
 }
 
+namespace {
+
+// Hands a large, pre-built cookie jar to the CookieMonster, since SetCookie
+// garbage collects down to a few thousand cookies.  Each domain gets a mix of
+// host and domain cookies, spread over two hosts and a couple of paths.
+class LargeCookieStore : public net::CookieMonster::PersistentCookieStore {
+ public:
+  static const int kCookiesPerDomain = 10;
+
+  explicit LargeCookieStore(int num_cookies) : num_cookies_(num_cookies) {}
+
+  virtual bool Load(
+      std::vector<net::CookieMonster::KeyedCanonicalCookie>* cookies) {
+    Time creation = Time::Now();
+    Time expires = creation + TimeDelta::FromDays(30);
+    for (int i = 0; i < num_cookies_; ++i) {
+      int domain = i / kCookiesPerDomain;
+      std::string key;
+      if (i % 3 == 0)
+        key = StringPrintf(".domain%05d.izzle", domain);
+      else
+        key = StringPrintf("www%d.domain%05d.izzle", i % 2, domain);
+      creation += TimeDelta::FromMicroseconds(1);
+      cookies->push_back(std::make_pair(key,
+          new net::CookieMonster::CanonicalCookie(
+              StringPrintf("c%d", i), "value", (i % 4 == 0) ? "/path" : "/",
+              false, false, creation, true, expires)));
+    }
+    return true;
+  }
+
+  virtual void AddCookie(const std::string&,
+                         const net::CookieMonster::CanonicalCookie&) {}
+  virtual void DeleteCookie(const net::CookieMonster::CanonicalCookie&) {}
+
+ private:
+  int num_cookies_;
+};
+
+// Queries every host of a jar of |num_cookies| cookies, first cold and then
+// with the cookie lines already built.
+void QueryLargeCookieJar(int num_cookies, const char* test_name) {
+  LargeCookieStore store(num_cookies);
+  net::CookieMonster cm(&store);
+
+  std::vector<GURL> gurls;
+  int num_domains = num_cookies / LargeCookieStore::kCookiesPerDomain;
+  for (int i = 0; i < num_domains; ++i) {
+    gurls.push_back(GURL(StringPrintf("http://www%d.domain%05d.izzle/path",
+                                      i % 2, i)));
+  }
+
+  // The first query loads the jar from the store.
+  PerfTimeLogger load_timer(StringPrintf("%s_load", test_name).c_str());
+  cm.GetCookies(gurls[0]);
+  load_timer.Done();
+
+  PerfTimeLogger timer(StringPrintf("%s_query", test_name).c_str());
+  for (std::vector<GURL>::const_iterator it = gurls.begin();
+       it != gurls.end(); ++it) {
+    EXPECT_FALSE(cm.GetCookies(*it).empty());
+  }
+  timer.Done();
+
+  PerfTimeLogger timer2(StringPrintf("%s_query_repeated", test_name).c_str());
+  for (int i = 0; i < 10; ++i) {
+    for (std::vector<GURL>::const_iterator it = gurls.begin();
+         it != gurls.end(); ++it) {
+      cm.GetCookies(*it);
+    }
+  }
+  timer2.Done();
+}
+
+}  // namespace
+
+TEST(CookieMonsterTest, TestQuery10kCookies) {
+  QueryLargeCookieJar(10000, "Cookie_monster_10k");
+}
+
+TEST(CookieMonsterTest, TestQuery100kCookies) {
+  QueryLargeCookieJar(100000, "Cookie_monster_100k");
+}
+
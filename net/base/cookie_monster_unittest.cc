@@ -809,5 +809,53 @@ TEST(CookieMonsterTest, TestDeleteSingleCookie) {
   EXPECT_EQ("A=B; E=F", cm.GetCookies(url_google));
 }
 
+// Cookie lines are cached per host; make sure the cache never serves a stale
+// or wrong line.
+TEST(CookieMonsterTest, TestCookieLineCache) {
+  GURL url_google(kUrlGoogle);
+  GURL url_google_secure(kUrlGoogleSecure);
+  GURL url_google_foo("http://www.google.izzle/foo");
+  GURL url_mail_google("http://mail.google.izzle");
+
+  net::CookieMonster cm;
+  EXPECT_TRUE(cm.SetCookie(url_google, "A=B"));
+  EXPECT_EQ("A=B", cm.GetCookies(url_google));
+  EXPECT_EQ("", cm.GetCookies(url_mail_google));
+
+  // Adding a domain cookie shows up on every host of the domain.
+  EXPECT_TRUE(cm.SetCookie(url_mail_google, "C=D; domain=.google.izzle"));
+  EXPECT_EQ("A=B; C=D", cm.GetCookies(url_google));
+  EXPECT_EQ("C=D", cm.GetCookies(url_mail_google));
+
+  // Secure cookies are only sent over https, whatever was cached before.
+  EXPECT_TRUE(cm.SetCookie(url_google_secure, "E=F; secure"));
+  EXPECT_EQ("A=B; C=D", cm.GetCookies(url_google));
+  EXPECT_EQ("A=B; C=D; E=F", cm.GetCookies(url_google_secure));
+
+  // A line built with a path-specific cookie isn't reused for other paths,
+  // and longer paths are sent first.
+  EXPECT_TRUE(cm.SetCookie(url_google_foo, "G=H; path=/foo"));
+  EXPECT_EQ("G=H; A=B; C=D", cm.GetCookies(url_google_foo));
+  EXPECT_EQ("A=B; C=D", cm.GetCookies(url_google));
+  EXPECT_EQ("G=H; A=B; C=D", cm.GetCookies(url_google_foo));
+
+  // Overwriting and deleting cookies are both reflected.
+  EXPECT_TRUE(cm.SetCookie(url_google, "A=Z"));
+  EXPECT_EQ("C=D; A=Z", cm.GetCookies(url_google));
+  EXPECT_TRUE(FindAndDeleteCookie(cm, ".google.izzle", "C"));
+  EXPECT_EQ("A=Z", cm.GetCookies(url_google));
+  EXPECT_EQ("", cm.GetCookies(url_mail_google));
+
+  // HttpOnly cookies are cached separately from the normal line.
+  EXPECT_TRUE(cm.SetCookie(url_google, "I=J; httponly"));
+  EXPECT_EQ("A=Z", cm.GetCookies(url_google));
+  EXPECT_EQ("A=Z; I=J", cm.GetCookiesWithOptions(
+      url_google, net::CookieMonster::INCLUDE_HTTPONLY));
+
+  cm.DeleteAll(false);
+  EXPECT_EQ("", cm.GetCookies(url_google));
+  EXPECT_EQ("", cm.GetCookies(url_google_secure));
+}
+
 // TODO test overwrite cookie
 
@@ -4,9 +4,14 @@
 
 #include "net/base/filter.h"
 
+#include <map>
+
+#include "base/logging.h"
+#include "base/singleton.h"
 #include "base/string_util.h"
 #include "net/base/gzip_filter.h"
 #include "net/base/bzip2_filter.h"
+#include "net/base/lzma_filter.h"
 #include "net/base/sdch_filter.h"
 
 namespace {
@@ -17,6 +22,8 @@ const char kGZip[]         = "gzip";
 const char kXGZip[]        = "x-gzip";
 const char kBZip2[]        = "bzip2";
 const char kXBZip2[]       = "x-bzip2";
+const char kLZMA[]         = "lzma";
+const char kXLZMA[]        = "x-lzma";
 const char kSdch[]         = "sdch";
 // compress and x-compress are currently not supported.  If we decide to support
 // them, we'll need the same mime type compatibility hack we have for gzip.  For
@@ -33,6 +40,65 @@ const char kApplicationXGunzip[]   = "application/x-gunzip";
 const char kApplicationXCompress[] = "application/x-compress";
 const char kApplicationCompress[]  = "application/compress";
 
+// Maps content encodings to filter types, and filter types to the functions
+// that create their filters.  See Filter::RegisterFilterType.
+class FilterRegistry {
+ public:
+  FilterRegistry() {
+    Register(kGZip, Filter::FILTER_TYPE_GZIP, &GZipFilter::Create, true);
+    Register(kXGZip, Filter::FILTER_TYPE_GZIP, &GZipFilter::Create, false);
+    Register(kDeflate, Filter::FILTER_TYPE_DEFLATE, &GZipFilter::Create, true);
+    Register(kBZip2, Filter::FILTER_TYPE_BZIP2, &BZip2Filter::Create, true);
+    Register(kXBZip2, Filter::FILTER_TYPE_BZIP2, &BZip2Filter::Create, false);
+    Register(kLZMA, Filter::FILTER_TYPE_LZMA, &LZMAFilter::Create, true);
+    Register(kXLZMA, Filter::FILTER_TYPE_LZMA, &LZMAFilter::Create, false);
+    // SDCH is only advertised for domains that have dictionaries, so
+    // URLRequestHttpJob adds it to the Accept-Encoding header itself.
+    Register(kSdch, Filter::FILTER_TYPE_SDCH, &SdchFilter::Create, false);
+    Register("", Filter::FILTER_TYPE_GZIP_HELPING_SDCH, &GZipFilter::Create,
+             false);
+  }
+
+  void Register(const std::string& encoding, Filter::FilterType type_id,
+                Filter::FilterCreator creator, bool advertise) {
+    DCHECK(creator);
+    creators_[type_id] = creator;
+    if (encoding.empty())
+      return;
+    types_[StringToLowerASCII(encoding)] = type_id;
+    if (advertise) {
+      if (!accept_encodings_.empty())
+        accept_encodings_.append(",");
+      accept_encodings_.append(encoding);
+    }
+  }
+
+  // Returns FILTER_TYPE_UNSUPPORTED for unknown encodings.
+  Filter::FilterType GetType(const std::string& encoding) const {
+    TypeMap::const_iterator it = types_.find(StringToLowerASCII(encoding));
+    return it == types_.end() ? Filter::FILTER_TYPE_UNSUPPORTED : it->second;
+  }
+
+  // Returns NULL for types without a creator.
+  Filter::FilterCreator GetCreator(Filter::FilterType type_id) const {
+    CreatorMap::const_iterator it = creators_.find(type_id);
+    return it == creators_.end() ? NULL : it->second;
+  }
+
+  const std::string& accept_encodings() const { return accept_encodings_; }
+
+ private:
+  typedef std::map<std::string, Filter::FilterType> TypeMap;
+  typedef std::map<Filter::FilterType, Filter::FilterCreator> CreatorMap;
+
+  // Keyed by lower case content encoding.
+  TypeMap types_;
+  CreatorMap creators_;
+  std::string accept_encodings_;
+
+  DISALLOW_COPY_AND_ASSIGN(FilterRegistry);
+};
+
 }  // namespace
 
 Filter* Filter::Factory(const std::vector<std::string>& filter_types,
@@ -58,35 +124,36 @@ Filter* Filter::Factory(const std::vector<std::string>& filter_types,
   return filter_list;
 }
 
+// static
+void Filter::RegisterFilterType(const std::string& encoding,
+                                FilterType type_id,
+                                FilterCreator creator,
+                                bool advertise) {
+  Singleton<FilterRegistry>::get()->Register(encoding, type_id, creator,
+                                             advertise);
+}
+
+// static
+std::string Filter::GetAcceptEncodings() {
+  return Singleton<FilterRegistry>::get()->accept_encodings();
+}
+
 // static
 Filter::FilterType Filter::ConvertEncodingToType(const std::string& filter_type,
                                                  const std::string& mime_type) {
-  FilterType type_id;
-  if (LowerCaseEqualsASCII(filter_type, kDeflate)) {
-    type_id = FILTER_TYPE_DEFLATE;
-  } else if (LowerCaseEqualsASCII(filter_type, kGZip) ||
-             LowerCaseEqualsASCII(filter_type, kXGZip)) {
-    if (LowerCaseEqualsASCII(mime_type, kApplicationXGzip) ||
-        LowerCaseEqualsASCII(mime_type, kApplicationGzip) ||
-        LowerCaseEqualsASCII(mime_type, kApplicationXGunzip)) {
-      // The server has told us that it sent us gziped content with a gzip
-      // content encoding.  Sadly, Apache mistakenly sets these headers for all
-      // .gz files.  We match Firefox's nsHttpChannel::ProcessNormal and ignore
-      // the Content-Encoding here.
-      // TODO(jar): Move all this encoding type "fixup" into the
-      // GetContentEncoding() methods.  Combine this defaulting with SDCH fixup.
-      type_id = FILTER_TYPE_UNSUPPORTED;
-    } else {
-      type_id = FILTER_TYPE_GZIP;
-    }
-  } else if (LowerCaseEqualsASCII(filter_type, kBZip2) ||
-             LowerCaseEqualsASCII(filter_type, kXBZip2)) {
-    type_id = FILTER_TYPE_BZIP2;
-  } else if (LowerCaseEqualsASCII(filter_type, kSdch)) {
-    type_id = FILTER_TYPE_SDCH;
-  } else {
-    // Note we also consider "identity" and "uncompressed" UNSUPPORTED as
-    // filter should be disabled in such cases.
+  // Note we also consider "identity" and "uncompressed" UNSUPPORTED as
+  // filter should be disabled in such cases.
+  FilterType type_id = Singleton<FilterRegistry>::get()->GetType(filter_type);
+  if (FILTER_TYPE_GZIP == type_id &&
+      (LowerCaseEqualsASCII(mime_type, kApplicationXGzip) ||
+       LowerCaseEqualsASCII(mime_type, kApplicationGzip) ||
+       LowerCaseEqualsASCII(mime_type, kApplicationXGunzip))) {
+    // The server has told us that it sent us gziped content with a gzip
+    // content encoding.  Sadly, Apache mistakenly sets these headers for all
+    // .gz files.  We match Firefox's nsHttpChannel::ProcessNormal and ignore
+    // the Content-Encoding here.
+    // TODO(jar): Move all this encoding type "fixup" into the
+    // GetContentEncoding() methods.  Combine this defaulting with SDCH fixup.
     type_id = FILTER_TYPE_UNSUPPORTED;
   }
   return type_id;
@@ -95,41 +162,9 @@ Filter::FilterType Filter::ConvertEncodingToType(const std::string& filter_type,
 // static
 Filter* Filter::PrependNewFilter(FilterType type_id, int buffer_size,
                                  Filter* filter_list) {
-  Filter* first_filter = NULL;  // Soon to be start of chain.
-  switch (type_id) {
-    case FILTER_TYPE_GZIP_HELPING_SDCH:
-    case FILTER_TYPE_DEFLATE:
-    case FILTER_TYPE_GZIP: {
-      scoped_ptr<GZipFilter> gz_filter(new GZipFilter());
-      if (gz_filter->InitBuffer(buffer_size)) {
-        if (gz_filter->InitDecoding(type_id)) {
-          first_filter = gz_filter.release();
-        }
-      }
-      break;
-    }
-    case FILTER_TYPE_BZIP2: {
-      scoped_ptr<BZip2Filter> bzip2_filter(new BZip2Filter());
-      if (bzip2_filter->InitBuffer(buffer_size)) {
-        if (bzip2_filter->InitDecoding(false)) {
-          first_filter = bzip2_filter.release();
-        }
-      }
-      break;
-    }
-    case FILTER_TYPE_SDCH: {
-      scoped_ptr<SdchFilter> sdch_filter(new SdchFilter());
-      if (sdch_filter->InitBuffer(buffer_size)) {
-        if (sdch_filter->InitDecoding()) {
-          first_filter = sdch_filter.release();
-        }
-      }
-      break;
-    }
-    default: {
-      break;
-    }
-  }
+  FilterCreator creator = Singleton<FilterRegistry>::get()->GetCreator(type_id);
+  // Soon to be start of chain.
+  Filter* first_filter = creator ? creator(type_id, buffer_size) : NULL;
 
   if (first_filter) {
     first_filter->next_filter_.reset(filter_list);
@@ -142,8 +177,7 @@ Filter* Filter::PrependNewFilter(FilterType type_id, int buffer_size,
 }
 
 Filter::Filter()
-    : stream_buffer_(NULL),
-      stream_buffer_size_(0),
+    : stream_buffer_size_(0),
       next_stream_data_(NULL),
       stream_data_len_(0),
       url_(),
@@ -158,7 +192,7 @@ bool Filter::InitBuffer(int buffer_size) {
   if (buffer_size < 0 || stream_buffer())
     return false;
 
-  stream_buffer_.reset(new char[buffer_size]);
+  stream_buffer_ = new net::IOBuffer(buffer_size);
 
   if (stream_buffer()) {
     stream_buffer_size_ = buffer_size;
@@ -203,6 +237,14 @@ Filter::FilterStatus Filter::ReadData(char* dest_buffer, int* dest_len) {
     return last_status_ = ReadFilteredData(dest_buffer, dest_len);
   if (last_status_ == FILTER_NEED_MORE_DATA && !stream_data_len())
     return next_filter_->ReadData(dest_buffer, dest_len);
+  if (next_filter_->last_status() == FILTER_NEED_MORE_DATA &&
+      PassesThroughStreamData() && !next_filter_->stream_data_len() &&
+      next_filter_->stream_buffer_size() == stream_buffer_size_) {
+    // Our output would be a copy of our input, so hand the input over.
+    PassStreamBufferTo(next_filter_.get());
+    last_status_ = FILTER_NEED_MORE_DATA;
+    return next_filter_->ReadData(dest_buffer, dest_len);
+  }
   if (next_filter_->last_status() == FILTER_NEED_MORE_DATA) {
     // Push data into next filter's input.
     char* next_buffer = next_filter_->stream_buffer();
@@ -228,6 +270,16 @@ Filter::FilterStatus Filter::ReadData(char* dest_buffer, int* dest_len) {
   return (status == FILTER_ERROR) ? FILTER_ERROR : FILTER_OK;
 }
 
+void Filter::PassStreamBufferTo(Filter* next) {
+  DCHECK(!next->stream_data_len_);
+  DCHECK_EQ(stream_buffer_size_, next->stream_buffer_size_);
+  stream_buffer_.swap(next->stream_buffer_);
+  next->next_stream_data_ = next_stream_data_;
+  next->stream_data_len_ = stream_data_len_;
+  next_stream_data_ = NULL;
+  stream_data_len_ = 0;
+}
+
 bool Filter::FlushStreamBuffer(int stream_data_len) {
   if (stream_data_len <= 0 || stream_data_len > stream_buffer_size_)
     return false;
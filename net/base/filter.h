@@ -33,8 +33,10 @@
 #include <vector>
 
 #include "base/basictypes.h"
+#include "base/ref_counted.h"
 #include "base/scoped_ptr.h"
 #include "googleurl/src/gurl.h"
+#include "net/base/io_buffer.h"
 #include "testing/gtest/include/gtest/gtest_prod.h"
 
 class Filter {
@@ -55,6 +57,22 @@ class Filter {
     FILTER_ERROR
   };
 
+  // Specifies type of filters that can be created.
+  enum FilterType {
+    FILTER_TYPE_DEFLATE,
+    FILTER_TYPE_GZIP,
+    FILTER_TYPE_BZIP2,
+    FILTER_TYPE_GZIP_HELPING_SDCH,
+    FILTER_TYPE_SDCH,  // open-vcdiff compression relative to a dictionary.
+    FILTER_TYPE_LZMA,
+    FILTER_TYPE_UNSUPPORTED
+  };
+
+  // Returns a new filter for |type_id| data, with a stream buffer of
+  // |buffer_size| chars and its decoding already initialized, or NULL if the
+  // filter can't be constructed.
+  typedef Filter* (*FilterCreator)(FilterType type_id, int buffer_size);
+
   virtual ~Filter();
 
   // Creates a Filter object.
@@ -75,12 +93,33 @@ class Filter {
                          const std::string& mime_type,
                          int buffer_size);
 
+  // Makes Factory() use |creator| to build filters of type |type_id|, and
+  // translate the content encoding |encoding| (compared case insensitively)
+  // into |type_id|.  A type may be registered under several encodings, and
+  // |encoding| may be empty for types which are only used internally.  If
+  // |advertise| is true, |encoding| is included in GetAcceptEncodings().
+  //
+  // The built-in filters are registered before the first use.  Registration
+  // is not thread safe, so other filters should be registered at startup.
+  static void RegisterFilterType(const std::string& encoding,
+                                 FilterType type_id,
+                                 FilterCreator creator,
+                                 bool advertise);
+
+  // Returns the comma separated list of advertised content encodings, for use
+  // in an Accept-Encoding header.
+  static std::string GetAcceptEncodings();
+
   // External call to obtain data from this filter chain.  If ther is no
   // next_filter_, then it obtains data from this specific filter.
   FilterStatus ReadData(char* dest_buffer, int* dest_len);
 
-  // Returns a pointer to the beginning of stream_buffer_.
-  char* stream_buffer() const { return stream_buffer_.get(); }
+  // Returns a pointer to the beginning of stream_buffer_.  Filters in a chain
+  // may trade their stream buffers, so the caller should not hold on to the
+  // pointer across calls to ReadData.
+  char* stream_buffer() const {
+    return stream_buffer_.get() ? stream_buffer_->data() : NULL;
+  }
 
   // Returns the maximum size of stream_buffer_ in number of chars.
   int stream_buffer_size() const { return stream_buffer_size_; }
@@ -111,16 +150,6 @@ class Filter {
   const std::string& mime_type() const { return mime_type_; }
 
  protected:
-  // Specifies type of filters that can be created.
-  enum FilterType {
-    FILTER_TYPE_DEFLATE,
-    FILTER_TYPE_GZIP,
-    FILTER_TYPE_BZIP2,
-    FILTER_TYPE_GZIP_HELPING_SDCH,
-    FILTER_TYPE_SDCH,  // open-vcdiff compression relative to a dictionary.
-    FILTER_TYPE_UNSUPPORTED
-  };
-
   Filter();
 
   FRIEND_TEST(SdchFilterTest, ContentTypeId);
@@ -140,6 +169,11 @@ class Filter {
   // Copy pre-filter data directly to destination buffer without decoding.
   FilterStatus CopyOut(char* dest_buffer, int* dest_len);
 
+  // Returns true if the filter is currently passing the pre-filter data
+  // through without decoding it, so the data left in stream_buffer_ may be
+  // handed to the next filter as is.
+  virtual bool PassesThroughStreamData() const { return false; }
+
   // Allocates and initializes stream_buffer_.
   // Buffer_size is the maximum size of stream_buffer_ in number of chars.
   bool InitBuffer(int buffer_size);
@@ -159,8 +193,13 @@ class Filter {
 
   FilterStatus last_status() const { return last_status_; }
 
-  // Buffer to hold the data to be filtered.
-  scoped_array<char> stream_buffer_;
+  // Gives the data left in stream_buffer_ to |next|, whose stream buffer must
+  // be empty, by trading stream buffers with it instead of copying the data.
+  void PassStreamBufferTo(Filter* next);
+
+  // Buffer to hold the data to be filtered.  It is ref counted so that a
+  // filter which passes data through can hand it over to the next filter.
+  scoped_refptr<net::IOBuffer> stream_buffer_;
 
   // Maximum size of stream_buffer_ in number of chars.
   int stream_buffer_size_;
@@ -0,0 +1,254 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/path_service.h"
+#include "base/perftimer.h"
+#include "base/process_util.h"
+#include "base/scoped_ptr.h"
+#include "base/string_util.h"
+#include "googleurl/src/gurl.h"
+#include "net/base/filter.h"
+#include "net/base/sdch_manager.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/zlib/zlib.h"
+
+namespace {
+
+// The same sizes that URLRequestJob and URLRequest use.
+const int kFilterBufferSize = 32 * 1024;
+const int kReadBufferSize = 4 * 1024;
+
+// How many copies of the test window or text make up a response body.
+const int kBodyRepeats = 20000;
+
+// How many times each response body is decoded.
+const int kIterations = 20;
+
+// How many times the small test file is decoded.
+const int kSmallFileIterations = 5000;
+
+// How many filters are kept alive at once to measure their memory use.
+const int kLiveFilters = 100;
+
+const char kSampleDomain[] = "sdchtest.com";
+
+// A VCDIFF dictionary, and a delta window that decodes against it.  A delta
+// file made of many copies of the window decodes to as many copies of the
+// window's text.
+const char kVcdiffDictionary[] = "DictionaryFor"
+    "SdchCompression1SdchCompression2SdchCompression3SdchCompression\n";
+const char kVcdiffHeader[] = "\326\303\304\0\0";
+const char kVcdiffWindow[] = "\001M\0\022I\0\t\003\001TestData \n\023\100\r";
+
+// Returns |input| compressed with gzip.
+std::string GZipCompress(const std::string& input) {
+  z_stream zlib_stream;
+  memset(&zlib_stream, 0, sizeof(zlib_stream));
+  // Adding 16 to the window bits asks for a gzip header and footer.
+  int code = deflateInit2(&zlib_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                          MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+  CHECK(code == Z_OK);
+
+  size_t output_length = input.size() + input.size() / 100 + 100;
+  scoped_array<char> output(new char[output_length]);
+  zlib_stream.next_in = bit_cast<Bytef*>(input.data());
+  zlib_stream.avail_in = input.size();
+  zlib_stream.next_out = bit_cast<Bytef*>(output.get());
+  zlib_stream.avail_out = output_length;
+  code = MOZ_Z_deflate(&zlib_stream, Z_FINISH);
+  CHECK(code == Z_STREAM_END);
+
+  std::string compressed(output.get(),
+                         output_length - zlib_stream.avail_out);
+  MOZ_Z_deflateEnd(&zlib_stream);
+  return compressed;
+}
+
+class FilterPerfTest : public testing::Test {
+ protected:
+  FilterPerfTest() : sdch_manager_(new SdchManager) {
+    sdch_manager_->EnableSdchSupport("");
+  }
+
+  virtual void SetUp() {
+    std::string dictionary("Domain: ");
+    dictionary.append(kSampleDomain);
+    dictionary.append("\n\n");
+    dictionary.append(kVcdiffDictionary, sizeof(kVcdiffDictionary) - 1);
+    url_ = GURL(std::string("http://") + kSampleDomain);
+    ASSERT_TRUE(sdch_manager_->AddSdchDictionary(dictionary, url_));
+
+    std::string client_hash, server_hash;
+    SdchManager::GenerateHash(dictionary, &client_hash, &server_hash);
+    sdch_body_ = server_hash;
+    sdch_body_.append("\0", 1);
+    sdch_body_.append(kVcdiffHeader, sizeof(kVcdiffHeader) - 1);
+    for (int i = 0; i < kBodyRepeats; ++i)
+      sdch_body_.append(kVcdiffWindow, sizeof(kVcdiffWindow) - 1);
+
+    for (int i = 0; i < kBodyRepeats; ++i)
+      text_body_.append(StringPrintf("<p>Paragraph %d of the page.</p>\n", i));
+
+    std::wstring file_path;
+    PathService::Get(base::DIR_SOURCE_ROOT, &file_path);
+    file_util::AppendToPath(&file_path, L"net");
+    file_util::AppendToPath(&file_path, L"data");
+    file_util::AppendToPath(&file_path, L"filter_unittests");
+    std::wstring text_path = file_path;
+    file_util::AppendToPath(&text_path, L"google.txt");
+    std::wstring lzma_path = file_path;
+    file_util::AppendToPath(&lzma_path, L"google.txt.lzma");
+    ASSERT_TRUE(file_util::ReadFileToString(text_path, &google_text_));
+    ASSERT_TRUE(file_util::ReadFileToString(lzma_path, &google_lzma_));
+  }
+
+  // Decodes |body| |iterations| times through the filters for |encodings|,
+  // the way URLRequestJob feeds them, and logs the time it took.
+  void TimeDecoding(const char* name,
+                    const std::vector<std::string>& encodings,
+                    const std::string& body, int iterations) {
+    scoped_array<char> read_buffer(new char[kReadBufferSize]);
+    size_t output_size = 0;
+
+    PerfTimeLogger timer(name);
+    for (int i = 0; i < iterations; ++i) {
+      scoped_ptr<Filter> filter(Filter::Factory(encodings, "text/html",
+                                                kFilterBufferSize));
+      ASSERT_TRUE(filter.get());
+      filter->SetURL(url_);
+
+      output_size = 0;
+      size_t offset = 0;
+      for (;;) {
+        if (!filter->stream_data_len() && offset < body.size()) {
+          int amount = std::min(static_cast<int>(body.size() - offset),
+                                filter->stream_buffer_size());
+          memcpy(filter->stream_buffer(), body.data() + offset, amount);
+          filter->FlushStreamBuffer(amount);
+          offset += amount;
+        }
+        int bytes_read = kReadBufferSize;
+        Filter::FilterStatus status =
+            filter->ReadData(read_buffer.get(), &bytes_read);
+        ASSERT_NE(Filter::FILTER_ERROR, status);
+        output_size += bytes_read;
+        if (status == Filter::FILTER_DONE ||
+            (!bytes_read && !filter->stream_data_len() &&
+             offset == body.size()))
+          break;
+      }
+    }
+    timer.Done();
+
+    LOG(INFO) << name << ": " << body.size() << " bytes decoded to "
+              << output_size << " bytes";
+  }
+
+#if defined(OS_WIN)
+  // Keeps kLiveFilters filters for |encodings| alive, each having decoded
+  // its first read of |body|, and logs how much memory they hold on to.
+  void MeasureMemory(const char* name,
+                     const std::vector<std::string>& encodings,
+                     const std::string& body) {
+    scoped_ptr<process_util::ProcessMetrics> metrics(
+        process_util::ProcessMetrics::CreateProcessMetrics(
+            process_util::GetCurrentProcessHandle()));
+    scoped_array<char> read_buffer(new char[kReadBufferSize]);
+
+    size_t private_bytes = metrics->GetPrivateBytes();
+    std::vector<Filter*> filters;
+    for (int i = 0; i < kLiveFilters; ++i) {
+      Filter* filter = Filter::Factory(encodings, "text/html",
+                                       kFilterBufferSize);
+      ASSERT_TRUE(filter);
+      filters.push_back(filter);
+      int amount = std::min(static_cast<int>(body.size()),
+                            filter->stream_buffer_size());
+      memcpy(filter->stream_buffer(), body.data(), amount);
+      filter->FlushStreamBuffer(amount);
+      int bytes_read = kReadBufferSize;
+      ASSERT_NE(Filter::FILTER_ERROR,
+                filter->ReadData(read_buffer.get(), &bytes_read));
+    }
+    size_t used = metrics->GetPrivateBytes() - private_bytes;
+    for (size_t i = 0; i < filters.size(); ++i)
+      delete filters[i];
+
+    LogPerfResult(name, static_cast<double>(used) / kLiveFilters, "bytes");
+  }
+#endif
+
+  scoped_ptr<SdchManager> sdch_manager_;
+  GURL url_;
+  std::string sdch_body_;
+  std::string text_body_;
+  std::string google_text_;
+  std::string google_lzma_;
+};
+
+}  // namespace
+
+TEST_F(FilterPerfTest, GZip) {
+  std::vector<std::string> encodings;
+  encodings.push_back("gzip");
+  TimeDecoding("Filter_gzip", encodings, GZipCompress(text_body_),
+               kIterations);
+}
+
+TEST_F(FilterPerfTest, Sdch) {
+  std::vector<std::string> encodings;
+  encodings.push_back("sdch");
+  TimeDecoding("Filter_sdch", encodings, sdch_body_, kIterations);
+}
+
+TEST_F(FilterPerfTest, SdchGZip) {
+  std::vector<std::string> encodings;
+  encodings.push_back("sdch");
+  encodings.push_back("gzip");
+  TimeDecoding("Filter_sdch_gzip", encodings, GZipCompress(sdch_body_),
+               kIterations);
+}
+
+// Content that claims to be sdch encoded but is not, which both filters of
+// the chain pass through.
+TEST_F(FilterPerfTest, SdchPassThrough) {
+  std::vector<std::string> encodings;
+  encodings.push_back("sdch");
+  TimeDecoding("Filter_sdch_pass_through", encodings, text_body_,
+               kIterations);
+}
+
+// The same page compressed with gzip and with lzma.
+TEST_F(FilterPerfTest, GZipPage) {
+  std::vector<std::string> encodings;
+  encodings.push_back("gzip");
+  TimeDecoding("Filter_gzip_page", encodings, GZipCompress(google_text_),
+               kSmallFileIterations);
+}
+
+TEST_F(FilterPerfTest, LZMAPage) {
+  std::vector<std::string> encodings;
+  encodings.push_back("lzma");
+  TimeDecoding("Filter_lzma_page", encodings, google_lzma_,
+               kSmallFileIterations);
+}
+
+#if defined(OS_WIN)
+TEST_F(FilterPerfTest, GZipMemory) {
+  std::vector<std::string> encodings;
+  encodings.push_back("gzip");
+  MeasureMemory("Filter_gzip_memory", encodings, GZipCompress(google_text_));
+}
+
+TEST_F(FilterPerfTest, LZMAMemory) {
+  std::vector<std::string> encodings;
+  encodings.push_back("lzma");
+  MeasureMemory("Filter_lzma_memory", encodings, google_lzma_);
+}
+#endif
@@ -23,6 +23,14 @@ GZipFilter::~GZipFilter() {
   }
 }
 
+// static
+Filter* GZipFilter::Create(Filter::FilterType type_id, int buffer_size) {
+  scoped_ptr<GZipFilter> gz_filter(new GZipFilter());
+  if (!gz_filter->InitBuffer(buffer_size) || !gz_filter->InitDecoding(type_id))
+    return NULL;
+  return gz_filter.release();
+}
+
 bool GZipFilter::InitDecoding(Filter::FilterType filter_type) {
   if (decoding_status_ != DECODING_UNINITIALIZED)
     return false;
@@ -144,6 +152,11 @@ Filter::FilterStatus GZipFilter::ReadFilteredData(char* dest_buffer,
   return status;
 }
 
+bool GZipFilter::PassesThroughStreamData() const {
+  return decoding_status_ == DECODING_DONE &&
+         gzip_header_status_ == GZIP_GET_INVALID_HEADER;
+}
+
 Filter::FilterStatus GZipFilter::CheckGZipHeader() {
   DCHECK_EQ(gzip_header_status_, GZIP_CHECK_HEADER_IN_PROGRESS);
 
@@ -27,6 +27,11 @@ class GZipFilter : public Filter {
 
   virtual ~GZipFilter();
 
+  // Returns a new GZipFilter initialized to decode |type_id|, which is one of
+  // the deflate or gzip types, or NULL on failure.  See
+  // Filter::RegisterFilterType.
+  static Filter* Create(Filter::FilterType type_id, int buffer_size);
+
   // Initializes filter decoding mode and internal control blocks.
   // Parameter filter_type specifies the type of filter, which corresponds to
   // either gzip or deflate decoding. The function returns true if success and
@@ -48,6 +53,11 @@ class GZipFilter : public Filter {
   // but not produce output yet.
   virtual FilterStatus ReadFilteredData(char* dest_buffer, int* dest_len);
 
+ protected:
+  // A GZipFilter helping SDCH passes the data through once it has found out
+  // that the data is not gzipped.
+  virtual bool PassesThroughStreamData() const;
+
  private:
   enum DecodingStatus {
     DECODING_UNINITIALIZED,
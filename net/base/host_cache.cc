@@ -0,0 +1,88 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/host_cache.h"
+
+#include "base/logging.h"
+#include "net/base/net_errors.h"
+
+namespace net {
+
+HostCache::HostCache(size_t max_entries,
+                     const TimeDelta& success_entry_ttl,
+                     const TimeDelta& failure_entry_ttl)
+    : max_entries_(max_entries),
+      success_entry_ttl_(success_entry_ttl),
+      failure_entry_ttl_(failure_entry_ttl) {
+}
+
+HostCache::~HostCache() {
+}
+
+const HostCache::Entry* HostCache::Lookup(const std::string& key,
+                                          const TimeTicks& now) const {
+  EntryMap::const_iterator it = entries_.find(key);
+  if (it == entries_.end())
+    return NULL;
+  if (it->second.expiration <= now)
+    return NULL;
+  return &it->second;
+}
+
+void HostCache::Set(const std::string& key,
+                    int error,
+                    const AddressList& addrlist,
+                    const TimeTicks& now) {
+  const TimeDelta& ttl = (error == OK) ? success_entry_ttl_ :
+                                         failure_entry_ttl_;
+  if (max_entries_ == 0 || ttl <= TimeDelta()) {
+    // Caching of this kind of result is disabled, but don't leave a stale
+    // entry behind.
+    entries_.erase(key);
+    return;
+  }
+
+  EntryMap::iterator it = entries_.find(key);
+  if (it == entries_.end()) {
+    if (entries_.size() >= max_entries_)
+      Compact(now);
+    it = entries_.insert(std::make_pair(key, Entry())).first;
+  }
+
+  Entry& entry = it->second;
+  entry.error = error;
+  entry.addrlist = (error == OK) ? addrlist : AddressList();
+  entry.expiration = now + ttl;
+}
+
+void HostCache::Clear() {
+  entries_.clear();
+}
+
+void HostCache::Compact(const TimeTicks& now) {
+  // Drop everything that has expired.
+  EntryMap::iterator it = entries_.begin();
+  while (it != entries_.end()) {
+    if (it->second.expiration <= now) {
+      entries_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+
+  if (entries_.size() < max_entries_)
+    return;
+
+  // Everything is still fresh, so evict the entry which would have expired
+  // first.
+  EntryMap::iterator oldest = entries_.begin();
+  for (it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->second.expiration < oldest->second.expiration)
+      oldest = it;
+  }
+  DCHECK(oldest != entries_.end());
+  entries_.erase(oldest);
+}
+
+}  // namespace net
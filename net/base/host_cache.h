@@ -0,0 +1,81 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_BASE_HOST_CACHE_H_
+#define NET_BASE_HOST_CACHE_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/hash_tables.h"
+#include "base/time.h"
+#include "net/base/address_list.h"
+
+namespace net {
+
+// Cache used by HostResolver to map a "host:port" key to the result of its
+// last resolution.  Both successful and failed lookups are cached, each with
+// its own time to live.  This class is not thread-safe; the caller must
+// serialize access to it.
+class HostCache {
+ public:
+  // Stores the latest result of a host resolution.
+  struct Entry {
+    Entry() : error(0) {}
+
+    // The resulting error code (OK or a net error).
+    int error;
+
+    // The resolved addresses.  Only valid when |error| is OK.
+    AddressList addrlist;
+
+    // The time at which this entry stops being valid.
+    TimeTicks expiration;
+  };
+
+  // Creates a cache holding at most |max_entries| results.  Successful results
+  // live for |success_entry_ttl| and failures for |failure_entry_ttl|.  A
+  // zero TTL disables caching of that kind of result.
+  HostCache(size_t max_entries,
+            const TimeDelta& success_entry_ttl,
+            const TimeDelta& failure_entry_ttl);
+  ~HostCache();
+
+  // Returns the cached entry for |key|, or NULL if there is none or it has
+  // expired as of |now|.  The returned pointer is only valid until the next
+  // call to Set or Clear.
+  const Entry* Lookup(const std::string& key, const TimeTicks& now) const;
+
+  // Stores the result of resolving |key|, replacing any previous entry.  If
+  // the cache is full, expired entries are dropped first, followed by the
+  // entries closest to expiring.
+  void Set(const std::string& key,
+           int error,
+           const AddressList& addrlist,
+           const TimeTicks& now);
+
+  // Drops every entry.
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+  size_t max_entries() const { return max_entries_; }
+
+ private:
+  typedef base::hash_map<std::string, Entry> EntryMap;
+
+  // Makes room for one more entry, assuming the cache is full.
+  void Compact(const TimeTicks& now);
+
+  const size_t max_entries_;
+  const TimeDelta success_entry_ttl_;
+  const TimeDelta failure_entry_ttl_;
+
+  EntryMap entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(HostCache);
+};
+
+}  // namespace net
+
+#endif  // NET_BASE_HOST_CACHE_H_
@@ -0,0 +1,114 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/host_cache.h"
+
+#include "net/base/net_errors.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kMaxCacheEntries = 3;
+const int kSuccessEntryTTLSeconds = 60;
+const int kFailureEntryTTLSeconds = 10;
+
+class HostCacheTest : public testing::Test {
+ protected:
+  HostCacheTest()
+      : cache_(kMaxCacheEntries,
+               TimeDelta::FromSeconds(kSuccessEntryTTLSeconds),
+               TimeDelta::FromSeconds(kFailureEntryTTLSeconds)) {
+  }
+
+  net::HostCache cache_;
+  net::AddressList addrlist_;
+};
+
+}  // namespace
+
+TEST_F(HostCacheTest, Basic) {
+  TimeTicks now = TimeTicks::Now();
+
+  EXPECT_TRUE(NULL == cache_.Lookup("foobar.com:80", now));
+
+  cache_.Set("foobar.com:80", net::OK, addrlist_, now);
+  const net::HostCache::Entry* entry = cache_.Lookup("foobar.com:80", now);
+  ASSERT_TRUE(NULL != entry);
+  EXPECT_EQ(net::OK, entry->error);
+  EXPECT_EQ(1U, cache_.size());
+
+  // The port is part of the key.
+  EXPECT_TRUE(NULL == cache_.Lookup("foobar.com:443", now));
+
+  // Overwriting an entry doesn't grow the cache.
+  cache_.Set("foobar.com:80", net::ERR_NAME_NOT_RESOLVED, addrlist_, now);
+  entry = cache_.Lookup("foobar.com:80", now);
+  ASSERT_TRUE(NULL != entry);
+  EXPECT_EQ(net::ERR_NAME_NOT_RESOLVED, entry->error);
+  EXPECT_EQ(1U, cache_.size());
+
+  cache_.Clear();
+  EXPECT_EQ(0U, cache_.size());
+  EXPECT_TRUE(NULL == cache_.Lookup("foobar.com:80", now));
+}
+
+TEST_F(HostCacheTest, Expiration) {
+  TimeTicks now = TimeTicks::Now();
+
+  cache_.Set("success.com:80", net::OK, addrlist_, now);
+  cache_.Set("failure.com:80", net::ERR_NAME_NOT_RESOLVED, addrlist_, now);
+
+  // Failures expire sooner than successes.
+  now += TimeDelta::FromSeconds(kFailureEntryTTLSeconds);
+  EXPECT_TRUE(NULL != cache_.Lookup("success.com:80", now));
+  EXPECT_TRUE(NULL == cache_.Lookup("failure.com:80", now));
+
+  now += TimeDelta::FromSeconds(kSuccessEntryTTLSeconds);
+  EXPECT_TRUE(NULL == cache_.Lookup("success.com:80", now));
+}
+
+TEST_F(HostCacheTest, Eviction) {
+  TimeTicks now = TimeTicks::Now();
+
+  cache_.Set("a.com:80", net::OK, addrlist_, now);
+  cache_.Set("b.com:80", net::ERR_NAME_NOT_RESOLVED, addrlist_, now);
+  now += TimeDelta::FromSeconds(1);
+  cache_.Set("c.com:80", net::OK, addrlist_, now);
+  EXPECT_EQ(3U, cache_.size());
+
+  // The cache is full and nothing has expired, so the entry closest to
+  // expiring goes first.
+  cache_.Set("d.com:80", net::OK, addrlist_, now);
+  EXPECT_EQ(3U, cache_.size());
+  EXPECT_TRUE(NULL == cache_.Lookup("b.com:80", now));
+  EXPECT_TRUE(NULL != cache_.Lookup("a.com:80", now));
+
+  // Once entries have expired, they are all dropped to make room.
+  now += TimeDelta::FromSeconds(kSuccessEntryTTLSeconds + 1);
+  cache_.Set("e.com:80", net::OK, addrlist_, now);
+  EXPECT_EQ(1U, cache_.size());
+  EXPECT_TRUE(NULL != cache_.Lookup("e.com:80", now));
+}
+
+TEST_F(HostCacheTest, DisabledCaching) {
+  TimeTicks now = TimeTicks::Now();
+
+  net::HostCache no_failures(kMaxCacheEntries,
+                             TimeDelta::FromSeconds(kSuccessEntryTTLSeconds),
+                             TimeDelta());
+  no_failures.Set("a.com:80", net::ERR_NAME_NOT_RESOLVED, addrlist_, now);
+  EXPECT_TRUE(NULL == no_failures.Lookup("a.com:80", now));
+  no_failures.Set("a.com:80", net::OK, addrlist_, now);
+  EXPECT_TRUE(NULL != no_failures.Lookup("a.com:80", now));
+
+  // A failure replaces the successful entry rather than leaving it cached.
+  no_failures.Set("a.com:80", net::ERR_NAME_NOT_RESOLVED, addrlist_, now);
+  EXPECT_TRUE(NULL == no_failures.Lookup("a.com:80", now));
+
+  net::HostCache no_entries(0,
+                            TimeDelta::FromSeconds(kSuccessEntryTTLSeconds),
+                            TimeDelta::FromSeconds(kFailureEntryTTLSeconds));
+  no_entries.Set("a.com:80", net::OK, addrlist_, now);
+  EXPECT_EQ(0U, no_entries.size());
+}
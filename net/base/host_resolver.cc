@@ -12,10 +12,18 @@
 #include <sys/socket.h>
 #endif
 
+#include <deque>
+#include <map>
+#include <vector>
+
 #include "base/message_loop.h"
+#include "base/scoped_ptr.h"
+#include "base/singleton.h"
+#include "base/stats_counters.h"
 #include "base/string_util.h"
 #include "base/worker_pool.h"
 #include "net/base/address_list.h"
+#include "net/base/host_cache.h"
 #include "net/base/net_errors.h"
 
 #if defined(OS_WIN)
@@ -30,6 +38,7 @@ static HostMapper* host_mapper;
 
 HostMapper* SetHostMapper(HostMapper* value) {
   std::swap(host_mapper, value);
+  HostResolver::FlushCache();
   return value;
 }
 
@@ -59,32 +68,43 @@ static int ResolveAddrInfo(
 
 //-----------------------------------------------------------------------------
 
+// Defaults for HostResolver::ServiceParams.
+static const size_t kDefaultMaxCacheEntries = 100;
+static const int kDefaultCacheDurationSeconds = 60;
+static const int kDefaultFailureCacheDurationSeconds = 10;
+static const int kDefaultMaxConcurrentLookups = 16;
+
+static std::string GetCacheKey(const std::string& host,
+                               const std::string& port) {
+  return host + ":" + port;
+}
+
+//-----------------------------------------------------------------------------
+
+// A Request is the pending Resolve call of a single HostResolver.  It lives on
+// the origin thread, but is notified of the result of its Job on the worker
+// thread, so it is reference counted.
 class HostResolver::Request :
     public base::RefCountedThreadSafe<HostResolver::Request> {
  public:
   Request(HostResolver* resolver,
-          const std::string& host,
-          const std::string& port,
+          const std::string& key,
           AddressList* addresses,
           CompletionCallback* callback)
-      : host_(host),
-        port_(port),
+      : key_(key),
         resolver_(resolver),
         addresses_(addresses),
         callback_(callback),
         origin_loop_(MessageLoop::current()),
-        error_(OK),
-        results_(NULL) {
-  }
-  
-  ~Request() {
-    if (results_)
-      freeaddrinfo(results_);
+        error_(OK) {
   }
 
-  void DoLookup() {
-    // Running on the worker thread
-    error_ = ResolveAddrInfo(host_, port_, &results_);
+  const std::string& key() const { return key_; }
+
+  // Called by the Job on the worker thread once the lookup has finished.
+  void OnComplete(int error, const AddressList& addrlist) {
+    error_ = error;
+    addrlist_ = addrlist;
 
     Task* reply = NewRunnableMethod(this, &Request::DoCallback);
 
@@ -97,23 +117,20 @@ class HostResolver::Request :
         reply = NULL;
       }
     }
-    
+
     // Does nothing if it got posted.
     delete reply;
   }
 
   void DoCallback() {
     // Running on the origin thread.
-    DCHECK(error_ || results_);
 
     // We may have been cancelled!
     if (!resolver_)
       return;
 
-    if (!error_) {
-      addresses_->Adopt(results_);
-      results_ = NULL;
-    }
+    if (!error_)
+      *addresses_ = addrlist_;
 
     // Drop the resolver's reference to us.  Do this before running the
     // callback since the callback might result in the resolver being
@@ -129,11 +146,10 @@ class HostResolver::Request :
     AutoLock locked(origin_loop_lock_);
     origin_loop_ = NULL;
   }
-  
+
  private:
-  // Set on the origin thread, read on the worker thread.
-  std::string host_;
-  std::string port_;
+  // Never changes after construction.
+  std::string key_;
 
   // Only used on the origin thread (where Resolve was called).
   HostResolver* resolver_;
@@ -146,11 +162,293 @@ class HostResolver::Request :
 
   // Assigned on the worker thread, read on the origin thread.
   int error_;
-  struct addrinfo* results_;
+  AddressList addrlist_;
+};
+
+//-----------------------------------------------------------------------------
+
+// A Job is a single call to the system's name resolver.  Every Request for the
+// same host and port that arrives while the Job is queued or running is
+// attached to it, and all of them receive its result.
+class HostResolver::Job :
+    public base::RefCountedThreadSafe<HostResolver::Job> {
+ public:
+  Job(Service* service,
+      const std::string& key,
+      const std::string& host,
+      const std::string& port)
+      : service_(service),
+        key_(key),
+        host_(host),
+        port_(port),
+        started_(false) {
+  }
+
+  const std::string& key() const { return key_; }
+
+  // The following methods must be called with the service's lock held.
+
+  void AddRequest(Request* request) { requests_.push_back(request); }
+
+  // Detaches |request|.  Returns true if the Job still has requests attached.
+  bool RemoveRequest(Request* request) {
+    for (RequestList::iterator it = requests_.begin();
+         it != requests_.end(); ++it) {
+      if (*it == request) {
+        requests_.erase(it);
+        break;
+      }
+    }
+    return !requests_.empty();
+  }
+
+  // Hands the attached requests over to the caller.
+  void TakeRequests(std::vector<scoped_refptr<Request> >* requests) {
+    requests->swap(requests_);
+  }
+
+  bool started() const { return started_; }
+
+  // Posts the lookup to a worker thread.  Returns false on failure.
+  bool Start() {
+    started_ = true;
+    return WorkerPool::PostTask(FROM_HERE,
+                                NewRunnableMethod(this, &Job::DoLookup), true);
+  }
+
+ private:
+  typedef std::vector<scoped_refptr<Request> > RequestList;
+
+  void DoLookup();
+
+  // The service is never deleted, see Service::LeakySingletonTraits.
+  Service* service_;
+
+  // Set on the origin thread, read on the worker thread.
+  std::string key_;
+  std::string host_;
+  std::string port_;
+
+  // Protected by the service's lock.
+  RequestList requests_;
+  bool started_;
 };
 
 //-----------------------------------------------------------------------------
 
+// The Service owns the cache and the Jobs in progress.  It is shared by all
+// HostResolver instances, which may live on different threads, so all of its
+// state is protected by |lock_|.
+class HostResolver::Service {
+ public:
+  static Service* GetInstance();
+
+  // Returns true and fills in |error| and |addresses| if a result for |key|
+  // is cached.
+  bool LookupCache(const std::string& key, int* error, AddressList* addresses);
+
+  // Stores the result of a synchronous lookup in the cache.
+  void CacheResult(const std::string& key, int error,
+                   const AddressList& addresses);
+
+  // Attaches |request| to the Job resolving |host| and |port|, creating and
+  // starting a new Job if there is none.
+  void StartRequest(Request* request, const std::string& host,
+                    const std::string& port);
+
+  // Detaches |request| from its Job.  Queued Jobs without requests are
+  // dropped.
+  void CancelRequest(Request* request);
+
+  // Called on the worker thread when |job| has finished.
+  void OnJobComplete(Job* job, int error, const AddressList& addrlist);
+
+  void SetParams(const ServiceParams& params);
+  void FlushCache();
+
+ private:
+  friend struct DefaultSingletonTraits<Service>;
+  typedef std::map<std::string, scoped_refptr<Job> > JobMap;
+
+  // Jobs may finish on worker threads during shutdown, so the Service is
+  // never deleted.
+  struct LeakySingletonTraits : public DefaultSingletonTraits<Service> {
+    static const bool kRegisterAtExit = false;
+  };
+
+  Service();
+
+  // Starts queued Jobs until the concurrency limit is reached.  Must be called
+  // with |lock_| held.
+  void StartPendingJobs();
+
+  // You must acquire this lock before using any private data of this object.
+  // You must not block while holding this lock.
+  Lock lock_;
+
+  ServiceParams params_;
+  scoped_ptr<HostCache> cache_;
+
+  // All queued or running Jobs, by key.
+  JobMap jobs_;
+
+  // Jobs that have not been started yet, oldest first.
+  std::deque<scoped_refptr<Job> > pending_jobs_;
+
+  int num_running_jobs_;
+
+  DISALLOW_COPY_AND_ASSIGN(Service);
+};
+
+void HostResolver::Job::DoLookup() {
+  // Running on the worker thread
+  struct addrinfo* results = NULL;
+  int error = ResolveAddrInfo(host_, port_, &results);
+
+  AddressList addrlist;
+  if (error == OK)
+    addrlist.Adopt(results);
+
+  service_->OnJobComplete(this, error, addrlist);
+}
+
+HostResolver::ServiceParams::ServiceParams()
+    : max_cache_entries(kDefaultMaxCacheEntries),
+      cache_duration(TimeDelta::FromSeconds(kDefaultCacheDurationSeconds)),
+      failure_cache_duration(
+          TimeDelta::FromSeconds(kDefaultFailureCacheDurationSeconds)),
+      max_concurrent_lookups(kDefaultMaxConcurrentLookups) {
+}
+
+HostResolver::Service::Service()
+    : cache_(new HostCache(params_.max_cache_entries,
+                           params_.cache_duration,
+                           params_.failure_cache_duration)),
+      num_running_jobs_(0) {
+}
+
+// static
+HostResolver::Service* HostResolver::Service::GetInstance() {
+  return Singleton<Service, LeakySingletonTraits>::get();
+}
+
+bool HostResolver::Service::LookupCache(const std::string& key,
+                                        int* error,
+                                        AddressList* addresses) {
+  static StatsCounter cache_hits(L"HostResolver.CacheHit");
+  static StatsCounter cache_misses(L"HostResolver.CacheMiss");
+
+  AutoLock locked(lock_);
+  const HostCache::Entry* entry = cache_->Lookup(key, TimeTicks::Now());
+  if (!entry) {
+    cache_misses.Increment();
+    return false;
+  }
+
+  cache_hits.Increment();
+  *error = entry->error;
+  if (entry->error == OK)
+    *addresses = entry->addrlist;
+  return true;
+}
+
+void HostResolver::Service::CacheResult(const std::string& key,
+                                        int error,
+                                        const AddressList& addresses) {
+  AutoLock locked(lock_);
+  cache_->Set(key, error, addresses, TimeTicks::Now());
+}
+
+void HostResolver::Service::StartRequest(Request* request,
+                                         const std::string& host,
+                                         const std::string& port) {
+  static StatsCounter coalesced(L"HostResolver.Coalesced");
+
+  AutoLock locked(lock_);
+  JobMap::iterator it = jobs_.find(request->key());
+  if (it != jobs_.end()) {
+    coalesced.Increment();
+    it->second->AddRequest(request);
+    return;
+  }
+
+  Job* job = new Job(this, request->key(), host, port);
+  job->AddRequest(request);
+  jobs_[request->key()] = job;
+  pending_jobs_.push_back(job);
+  StartPendingJobs();
+}
+
+void HostResolver::Service::CancelRequest(Request* request) {
+  AutoLock locked(lock_);
+  JobMap::iterator it = jobs_.find(request->key());
+  if (it == jobs_.end())
+    return;
+
+  scoped_refptr<Job> job = it->second;
+  if (job->RemoveRequest(request) || job->started())
+    return;
+
+  // Nobody is waiting for this Job anymore, and it has not reached the system
+  // resolver yet, so drop it.
+  jobs_.erase(it);
+  for (std::deque<scoped_refptr<Job> >::iterator pending =
+           pending_jobs_.begin();
+       pending != pending_jobs_.end(); ++pending) {
+    if (*pending == job) {
+      pending_jobs_.erase(pending);
+      break;
+    }
+  }
+}
+
+void HostResolver::Service::OnJobComplete(Job* job,
+                                          int error,
+                                          const AddressList& addrlist) {
+  // Running on the worker thread
+  std::vector<scoped_refptr<Request> > requests;
+  {
+    AutoLock locked(lock_);
+    cache_->Set(job->key(), error, addrlist, TimeTicks::Now());
+    job->TakeRequests(&requests);
+    jobs_.erase(job->key());
+    num_running_jobs_--;
+    StartPendingJobs();
+  }
+
+  for (size_t i = 0; i < requests.size(); ++i)
+    requests[i]->OnComplete(error, addrlist);
+}
+
+void HostResolver::Service::SetParams(const ServiceParams& params) {
+  AutoLock locked(lock_);
+  params_ = params;
+  cache_.reset(new HostCache(params_.max_cache_entries,
+                             params_.cache_duration,
+                             params_.failure_cache_duration));
+  StartPendingJobs();
+}
+
+void HostResolver::Service::FlushCache() {
+  AutoLock locked(lock_);
+  cache_->Clear();
+}
+
+void HostResolver::Service::StartPendingJobs() {
+  while (!pending_jobs_.empty() &&
+         num_running_jobs_ < params_.max_concurrent_lookups) {
+    scoped_refptr<Job> job = pending_jobs_.front();
+    pending_jobs_.pop_front();
+    num_running_jobs_++;
+    if (!job->Start()) {
+      NOTREACHED();
+      num_running_jobs_--;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
 HostResolver::HostResolver() {
 #if defined(OS_WIN)
   EnsureWinsockInit();
@@ -158,8 +456,10 @@ HostResolver::HostResolver() {
 }
 
 HostResolver::~HostResolver() {
-  if (request_)
+  if (request_) {
+    Service::GetInstance()->CancelRequest(request_);
     request_->Cancel();
+  }
 }
 
 int HostResolver::Resolve(const std::string& hostname, int port,
@@ -168,27 +468,39 @@ int HostResolver::Resolve(const std::string& hostname, int port,
   DCHECK(!request_) << "resolver already in use";
 
   const std::string& port_str = IntToString(port);
+  const std::string& key = GetCacheKey(hostname, port_str);
+  Service* service = Service::GetInstance();
+
+  int rv;
+  if (service->LookupCache(key, &rv, addresses))
+    return rv;
 
   // Do a synchronous resolution.
   if (!callback) {
     struct addrinfo* results;
-    int rv = ResolveAddrInfo(hostname, port_str, &results);
+    rv = ResolveAddrInfo(hostname, port_str, &results);
+    AddressList addrlist;
     if (rv == OK)
-      addresses->Adopt(results);
+      addrlist.Adopt(results);
+    service->CacheResult(key, rv, addrlist);
+    if (rv == OK)
+      *addresses = addrlist;
     return rv;
   }
 
-  request_ = new Request(this, hostname, port_str, addresses, callback);
+  request_ = new Request(this, key, addresses, callback);
+  service->StartRequest(request_, hostname, port_str);
+  return ERR_IO_PENDING;
+}
 
-  // Dispatch to worker thread...
-  if (!WorkerPool::PostTask(FROM_HERE,
-          NewRunnableMethod(request_.get(), &Request::DoLookup), true)) {
-    NOTREACHED();
-    request_ = NULL;
-    return ERR_FAILED;
-  }
+// static
+void HostResolver::SetServiceParams(const ServiceParams& params) {
+  Service::GetInstance()->SetParams(params);
+}
 
-  return ERR_IO_PENDING;
+// static
+void HostResolver::FlushCache() {
+  Service::GetInstance()->FlushCache();
 }
 
 }  // namespace net
@@ -9,6 +9,7 @@
 
 #include "base/basictypes.h"
 #include "base/ref_counted.h"
+#include "base/time.h"
 #include "net/base/completion_callback.h"
 
 namespace net {
@@ -20,13 +21,34 @@ class AddressList;
 // a time, so if you need to resolve multiple hostnames at the same time, you
 // will need to allocate a HostResolver object for each hostname.
 //
-// No attempt is made at this level to cache or pin resolution results.  For
-// each request, this API talks directly to the underlying name resolver of
-// the local system, which may or may not result in a DNS query.  The exact
-// behavior depends on the system configuration.
+// All HostResolver instances share a single resolver service.  The service
+// keeps a cache of recent results (including failures), merges concurrent
+// lookups of the same host and port into a single job, and limits the number
+// of lookups outstanding in the underlying name resolver of the local system.
+// Cache misses may or may not result in a DNS query, depending on the system
+// configuration.
 //
 class HostResolver {
  public:
+  // Tuning parameters of the resolver service shared by all instances.
+  struct ServiceParams {
+    // Initializes the parameters to their defaults.
+    ServiceParams();
+
+    // The maximum number of results to keep in the cache.  Zero disables the
+    // cache.
+    size_t max_cache_entries;
+
+    // How long successful and failed lookups are cached for.  A zero duration
+    // disables caching of that kind of result.
+    TimeDelta cache_duration;
+    TimeDelta failure_cache_duration;
+
+    // The maximum number of lookups that may be outstanding in the system's
+    // name resolver at once.  Further lookups are queued.
+    int max_concurrent_lookups;
+  };
+
   HostResolver();
 
   // If a completion callback is pending when the resolver is destroyed, the
@@ -41,15 +63,24 @@ class HostResolver {
   //
   // When callback is null, the operation completes synchronously.
   //
-  // When callback is non-null, ERR_IO_PENDING is returned if the operation
-  // could not be completed synchronously, in which case the result code will
-  // be passed to the callback when available.
+  // When callback is non-null, the operation may still complete synchronously
+  // if the result is cached.  Otherwise, ERR_IO_PENDING is returned, in which
+  // case the result code will be passed to the callback when available.
   //
   int Resolve(const std::string& hostname, int port,
               AddressList* addresses, CompletionCallback* callback);
 
+  // Replaces the parameters of the shared resolver service.  This drops all
+  // cached results, but does not affect lookups already in progress.
+  static void SetServiceParams(const ServiceParams& params);
+
+  // Drops all cached results of the shared resolver service.
+  static void FlushCache();
+
  private:
+  class Job;
   class Request;
+  class Service;
   friend class Request;
   scoped_refptr<Request> request_;
   DISALLOW_COPY_AND_ASSIGN(HostResolver);
@@ -69,6 +100,8 @@ class HostMapper {
 // to map to a fixed IP address such as 127.0.0.1.
 //
 // The previously set HostMapper (or NULL if there was none) is returned.
+// Setting a HostMapper flushes the resolver cache, since cached results may
+// no longer match the new mapping.
 //
 // NOTE: This function is not thread-safe, so take care to only call this
 // function while there are no outstanding HostResolver instances.
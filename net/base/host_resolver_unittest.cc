@@ -11,12 +11,68 @@
 #include <netdb.h>
 #endif
 
+#include "base/lock.h"
+#include "base/message_loop.h"
+#include "base/platform_thread.h"
+#include "base/waitable_event.h"
 #include "net/base/address_list.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace {
 
-TEST(HostResolverTest, NumericAddresses) {
+// A HostMapper that maps every hostname to |replacement|, counts how many
+// lookups reach the system resolver, and optionally holds them until
+// Unblock() is called.
+class CountingHostMapper : public net::HostMapper {
+ public:
+  CountingHostMapper(const std::string& replacement, bool blocking)
+      : replacement_(replacement),
+        unblocked_(true, !blocking),
+        count_(0) {
+    previous_host_mapper_ = net::SetHostMapper(this);
+  }
+
+  ~CountingHostMapper() {
+    net::SetHostMapper(previous_host_mapper_);
+  }
+
+  virtual std::string Map(const std::string& host) {
+    {
+      AutoLock locked(lock_);
+      count_++;
+    }
+    unblocked_.Wait();
+    return replacement_;
+  }
+
+  void Unblock() { unblocked_.Signal(); }
+
+  int count() {
+    AutoLock locked(lock_);
+    return count_;
+  }
+
+ private:
+  std::string replacement_;
+  base::WaitableEvent unblocked_;
+  net::HostMapper* previous_host_mapper_;
+  Lock lock_;
+  int count_;
+};
+
+class HostResolverTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    // Start every test with the default parameters and an empty cache.
+    net::HostResolver::SetServiceParams(net::HostResolver::ServiceParams());
+  }
+
+  MessageLoop message_loop_;
+};
+
+TEST_F(HostResolverTest, NumericAddresses) {
   // Stevens says dotted quads with AI_UNSPEC resolve to a single sockaddr_in.
 
   net::HostResolver host_resolver;
@@ -35,4 +91,119 @@ TEST(HostResolverTest, NumericAddresses) {
   EXPECT_EQ(htonl(0x7f000001), sa_in->sin_addr.s_addr);
 }
 
-} // namespace
+TEST_F(HostResolverTest, CachesResults) {
+  CountingHostMapper mapper("127.0.0.1", false);
+
+  net::HostResolver host_resolver;
+  net::AddressList adrlist;
+  EXPECT_EQ(net::OK, host_resolver.Resolve("foo.test", 80, &adrlist, NULL));
+  EXPECT_EQ(1, mapper.count());
+
+  // Answered from the cache, even though a callback was given.
+  TestCompletionCallback callback;
+  net::AddressList cached_adrlist;
+  EXPECT_EQ(net::OK, host_resolver.Resolve("foo.test", 80, &cached_adrlist,
+                                           &callback));
+  EXPECT_EQ(1, mapper.count());
+  EXPECT_EQ(adrlist.head(), cached_adrlist.head());
+
+  // A different port is a different cache entry.
+  EXPECT_EQ(net::OK, host_resolver.Resolve("foo.test", 81, &adrlist, NULL));
+  EXPECT_EQ(2, mapper.count());
+
+  net::HostResolver::FlushCache();
+  EXPECT_EQ(net::OK, host_resolver.Resolve("foo.test", 80, &adrlist, NULL));
+  EXPECT_EQ(3, mapper.count());
+}
+
+TEST_F(HostResolverTest, CachesFailures) {
+  CountingHostMapper mapper("", false);
+
+  net::HostResolver host_resolver;
+  net::AddressList adrlist;
+  EXPECT_EQ(net::ERR_NAME_NOT_RESOLVED,
+            host_resolver.Resolve("bad.test", 80, &adrlist, NULL));
+  EXPECT_EQ(net::ERR_NAME_NOT_RESOLVED,
+            host_resolver.Resolve("bad.test", 80, &adrlist, NULL));
+  EXPECT_EQ(1, mapper.count());
+
+  net::HostResolver::ServiceParams params;
+  params.failure_cache_duration = TimeDelta();
+  net::HostResolver::SetServiceParams(params);
+  EXPECT_EQ(net::ERR_NAME_NOT_RESOLVED,
+            host_resolver.Resolve("bad.test", 80, &adrlist, NULL));
+  EXPECT_EQ(net::ERR_NAME_NOT_RESOLVED,
+            host_resolver.Resolve("bad.test", 80, &adrlist, NULL));
+  EXPECT_EQ(3, mapper.count());
+}
+
+TEST_F(HostResolverTest, CoalescesConcurrentLookups) {
+  CountingHostMapper mapper("127.0.0.1", true);
+
+  net::HostResolver resolver1, resolver2, resolver3;
+  net::AddressList adrlist1, adrlist2, adrlist3;
+  TestCompletionCallback callback1, callback2, callback3;
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            resolver1.Resolve("foo.test", 80, &adrlist1, &callback1));
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            resolver2.Resolve("foo.test", 80, &adrlist2, &callback2));
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            resolver3.Resolve("foo.test", 80, &adrlist3, &callback3));
+
+  mapper.Unblock();
+  EXPECT_EQ(net::OK, callback1.WaitForResult());
+  EXPECT_EQ(net::OK, callback2.WaitForResult());
+  EXPECT_EQ(net::OK, callback3.WaitForResult());
+
+  EXPECT_EQ(1, mapper.count());
+  EXPECT_EQ(adrlist1.head(), adrlist2.head());
+  EXPECT_EQ(adrlist1.head(), adrlist3.head());
+}
+
+TEST_F(HostResolverTest, CancelOneOfCoalescedLookups) {
+  CountingHostMapper mapper("127.0.0.1", true);
+
+  net::HostResolver resolver1;
+  net::AddressList adrlist1, adrlist2;
+  TestCompletionCallback callback1, callback2;
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            resolver1.Resolve("foo.test", 80, &adrlist1, &callback1));
+  {
+    net::HostResolver resolver2;
+    EXPECT_EQ(net::ERR_IO_PENDING,
+              resolver2.Resolve("foo.test", 80, &adrlist2, &callback2));
+  }
+
+  mapper.Unblock();
+  EXPECT_EQ(net::OK, callback1.WaitForResult());
+  EXPECT_EQ(1, mapper.count());
+}
+
+TEST_F(HostResolverTest, LimitsConcurrentLookups) {
+  CountingHostMapper mapper("127.0.0.1", true);
+
+  net::HostResolver::ServiceParams params;
+  params.max_concurrent_lookups = 1;
+  net::HostResolver::SetServiceParams(params);
+
+  net::HostResolver resolver1, resolver2;
+  net::AddressList adrlist1, adrlist2;
+  TestCompletionCallback callback1, callback2;
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            resolver1.Resolve("a.test", 80, &adrlist1, &callback1));
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            resolver2.Resolve("b.test", 80, &adrlist2, &callback2));
+
+  // Only the first lookup may reach the system resolver.
+  for (int i = 0; i < 100 && mapper.count() == 0; ++i)
+    PlatformThread::Sleep(10);
+  PlatformThread::Sleep(50);
+  EXPECT_EQ(1, mapper.count());
+
+  mapper.Unblock();
+  EXPECT_EQ(net::OK, callback1.WaitForResult());
+  EXPECT_EQ(net::OK, callback2.WaitForResult());
+  EXPECT_EQ(2, mapper.count());
+}
+
+}  // namespace
@@ -0,0 +1,42 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_BASE_IO_BUFFER_H_
+#define NET_BASE_IO_BUFFER_H_
+
+#include "base/basictypes.h"
+#include "base/logging.h"
+#include "base/ref_counted.h"
+#include "base/scoped_ptr.h"
+
+namespace net {
+
+// A fixed-size buffer that is ref counted, so that its data can be handed
+// from one owner to the next (for instance, from one stage of a filter chain
+// to the following one) instead of being copied.
+class IOBuffer : public base::RefCounted<IOBuffer> {
+ public:
+  explicit IOBuffer(int buffer_size)
+      : data_(new char[buffer_size]),
+        size_(buffer_size) {
+    DCHECK(buffer_size >= 0);
+  }
+
+  char* data() const { return data_.get(); }
+  int size() const { return size_; }
+
+ private:
+  friend class base::RefCounted<IOBuffer>;
+
+  ~IOBuffer() {}
+
+  scoped_array<char> data_;
+  const int size_;
+
+  DISALLOW_COPY_AND_ASSIGN(IOBuffer);
+};
+
+}  // namespace net
+
+#endif  // NET_BASE_IO_BUFFER_H_
@@ -0,0 +1,323 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/lzma_filter.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace {
+
+// The .lzma header: the stream properties, then the uncompressed size.
+const size_t kUncompressedSizeBytes = 8;
+const size_t kHeaderSize = LZMA_PROPERTIES_SIZE + kUncompressedSizeBytes;
+
+// Streams with more literal context bits than this need a probability model
+// far larger than any encoder uses by default, so we don't accept them.
+const int kMaxLiteralBits = 4;
+
+// The dictionary starts at this size, and doubles as needed.
+const uint32 kMinDictionaryAllocation = 4096;
+
+// LzmaDecode() sets RemainLen to this once it has seen the end marker
+// (kLzmaStreamWasFinishedId in LzmaDecode.c).
+const int kStreamFinished = -1;
+
+// LzmaDecode() can't stop partway through a symbol when it runs out of input;
+// it fails, having already changed the probabilities.  We avoid that by
+// asking for no more output than the input is sure to cover.  Every symbol
+// produces at least one char, and uses at most one input byte per bit it
+// decodes.  The longest symbol, a match with a 30 bit distance, is 48 bits.
+const size_t kMaxInputPerSymbol = 48;
+
+// The range decoder reads 5 bytes at the start of the stream, and
+// LzmaDecode() may read 1 more byte before it returns.
+const size_t kMaxInputOverhead = 5 + 1;
+
+// How much of the input we copy at a time when decoding across the end of
+// one buffer of pre-filter data and the start of the next.
+const size_t kMaxInputTail = 512;
+
+}  // namespace
+
+// Large enough for "xz --format=lzma -7".
+const uint32 LZMAFilter::kMaxDictionarySize = 16 * 1024 * 1024;
+
+LZMAFilter::LZMAFilter()
+    : decoding_status_(DECODING_UNINITIALIZED),
+      num_probs_(0),
+      dictionary_size_(0),
+      uncompressed_size_(-1),
+      output_bytes_(0) {
+  memset(&decoder_state_, 0, sizeof(decoder_state_));
+}
+
+LZMAFilter::~LZMAFilter() {
+}
+
+// static
+Filter* LZMAFilter::Create(Filter::FilterType type_id, int buffer_size) {
+  scoped_ptr<LZMAFilter> lzma_filter(new LZMAFilter());
+  if (!lzma_filter->InitBuffer(buffer_size) || !lzma_filter->InitDecoding())
+    return NULL;
+  return lzma_filter.release();
+}
+
+bool LZMAFilter::InitDecoding() {
+  if (decoding_status_ != DECODING_UNINITIALIZED)
+    return false;
+
+  // The decoder is set up once we have the header.
+  decoding_status_ = DECODING_HEADER;
+  return true;
+}
+
+Filter::FilterStatus LZMAFilter::ReadFilteredData(char* dest_buffer,
+                                                  int* dest_len) {
+  if (!dest_buffer || !dest_len || *dest_len <= 0)
+    return Filter::FILTER_ERROR;
+
+  int available_space = *dest_len;
+  *dest_len = 0;
+
+  if (decoding_status_ == DECODING_DONE) {
+    // Ignore anything after the end of the stream.
+    SkipStreamData(stream_data_len_);
+    return Filter::FILTER_DONE;
+  }
+
+  if (decoding_status_ == DECODING_HEADER) {
+    Filter::FilterStatus status = ReadHeader();
+    if (status != Filter::FILTER_OK)
+      return status;
+  }
+
+  if (decoding_status_ != DECODING_IN_PROGRESS)
+    return Filter::FILTER_ERROR;
+
+  while (*dest_len < available_space) {
+    // If the last call left input that was too short to decode, top it up
+    // with a little of the new input until the decoder moves past it.
+    bool from_tail = !input_tail_.empty();
+    const char* input = next_stream_data_;
+    size_t input_len = stream_data_len_;
+    size_t borrowed = 0;
+    if (from_tail) {
+      borrowed = std::min(static_cast<size_t>(stream_data_len_),
+                          kMaxInputTail - input_tail_.size());
+      input_tail_.append(next_stream_data_, borrowed);
+      input = input_tail_.data();
+      input_len = input_tail_.size();
+    }
+
+    size_t consumed = 0;
+    size_t produced = 0;
+    DecodeResult result = Decode(input, input_len, dest_buffer + *dest_len,
+                                 available_space - *dest_len,
+                                 &consumed, &produced);
+    *dest_len += static_cast<int>(produced);
+
+    if (from_tail) {
+      // The borrowed chars are still in the pre-filter data.
+      size_t tail_size = input_tail_.size() - borrowed;
+      if (consumed >= tail_size) {
+        input_tail_.clear();
+        SkipStreamData(consumed - tail_size);
+      } else {
+        input_tail_.resize(tail_size);
+        input_tail_.erase(0, consumed);
+      }
+    } else {
+      SkipStreamData(consumed);
+    }
+
+    switch (result) {
+      case DECODE_OK:
+        break;
+      case DECODE_END:
+        decoding_status_ = DECODING_DONE;
+        input_tail_.clear();
+        SkipStreamData(stream_data_len_);
+        return Filter::FILTER_DONE;
+      case DECODE_NEED_MORE_INPUT:
+        // Keep what is left until more arrives.
+        input_tail_.append(next_stream_data_, stream_data_len_);
+        SkipStreamData(stream_data_len_);
+        return Filter::FILTER_NEED_MORE_DATA;
+      default:
+        decoding_status_ = DECODING_ERROR;
+        return Filter::FILTER_ERROR;
+    }
+  }
+
+  return stream_data_len_ ? Filter::FILTER_OK : Filter::FILTER_NEED_MORE_DATA;
+}
+
+Filter::FilterStatus LZMAFilter::ReadHeader() {
+  DCHECK_EQ(decoding_status_, DECODING_HEADER);
+
+  size_t amount = std::min(kHeaderSize - header_.size(),
+                           static_cast<size_t>(stream_data_len_));
+  if (amount) {
+    header_.append(next_stream_data_, amount);
+    SkipStreamData(amount);
+  }
+  if (header_.size() < kHeaderSize)
+    return Filter::FILTER_NEED_MORE_DATA;
+
+  const unsigned char* header =
+      reinterpret_cast<const unsigned char*>(header_.data());
+  CLzmaProperties* properties = &decoder_state_.Properties;
+  if (LzmaDecodeProperties(properties, header, LZMA_PROPERTIES_SIZE) !=
+          LZMA_RESULT_OK ||
+      properties->lc + properties->lp > kMaxLiteralBits ||
+      properties->DictionarySize > kMaxDictionarySize) {
+    decoding_status_ = DECODING_ERROR;
+    return Filter::FILTER_ERROR;
+  }
+
+  uint64 size = 0;
+  for (size_t i = 0; i < kUncompressedSizeBytes; ++i)
+    size |= static_cast<uint64>(header[LZMA_PROPERTIES_SIZE + i]) << (8 * i);
+  if (size == kuint64max) {
+    uncompressed_size_ = -1;
+  } else if (size > static_cast<uint64>(kint64max)) {
+    decoding_status_ = DECODING_ERROR;
+    return Filter::FILTER_ERROR;
+  } else {
+    uncompressed_size_ = static_cast<int64>(size);
+  }
+
+  // The dictionary is allocated by GrowDictionary().
+  dictionary_size_ = std::max(properties->DictionarySize, 1U);
+  properties->DictionarySize = 0;
+
+  num_probs_ = LzmaGetNumProbs(properties);
+  probs_.reset(new CProb[num_probs_]);
+  decoder_state_.Probs = probs_.get();
+  LzmaDecoderInit(&decoder_state_);
+
+  header_.clear();
+  decoding_status_ = DECODING_IN_PROGRESS;
+  return Filter::FILTER_OK;
+}
+
+LZMAFilter::DecodeResult LZMAFilter::Decode(const char* input,
+                                            size_t input_len,
+                                            char* dest, size_t dest_len,
+                                            size_t* consumed,
+                                            size_t* produced) {
+  *consumed = 0;
+  *produced = 0;
+
+  size_t output_limit = dest_len;
+  if (uncompressed_size_ >= 0) {
+    uint64 remaining = uncompressed_size_ - output_bytes_;
+    if (remaining < output_limit)
+      output_limit = static_cast<size_t>(remaining);
+    if (!output_limit)
+      return DECODE_END;
+  }
+  if (!input_len)
+    return DECODE_NEED_MORE_INPUT;
+
+  // See kMaxInputPerSymbol.  When the input can't cover even one symbol, we
+  // let LzmaDecode() try anyway, since this may be the end of the stream, and
+  // undo what it did if it runs out.
+  size_t safe_output = 0;
+  if (input_len > kMaxInputOverhead)
+    safe_output = (input_len - kMaxInputOverhead) / kMaxInputPerSymbol;
+  bool may_run_out = !safe_output;
+  if (!may_run_out)
+    output_limit = std::min(output_limit, safe_output);
+
+  GrowDictionary(output_limit);
+  if (may_run_out)
+    SaveDecoder(output_limit);
+
+  SizeT in_processed = 0;
+  SizeT out_processed = 0;
+  int rv = LzmaDecode(&decoder_state_,
+                      reinterpret_cast<const unsigned char*>(input), input_len,
+                      &in_processed, reinterpret_cast<unsigned char*>(dest),
+                      output_limit, &out_processed);
+  if (rv != LZMA_RESULT_OK) {
+    if (!may_run_out)
+      return DECODE_ERROR;
+    RestoreDecoder();
+    return DECODE_NEED_MORE_INPUT;
+  }
+
+  *consumed = in_processed;
+  *produced = out_processed;
+  output_bytes_ += out_processed;
+  if (decoder_state_.RemainLen == kStreamFinished ||
+      output_bytes_ == uncompressed_size_)
+    return DECODE_END;
+  return DECODE_OK;
+}
+
+void LZMAFilter::GrowDictionary(size_t output_size) {
+  // Until the dictionary reaches the size the stream asked for, we keep it
+  // large enough that it never wraps, so the data in it stays where
+  // LzmaDecode() put it and can simply be copied to a larger buffer.  Short
+  // responses then need only a small dictionary.
+  uint32 allocated = decoder_state_.Properties.DictionarySize;
+  if (allocated == dictionary_size_)
+    return;
+  uint64 needed = output_bytes_ + output_size + 1;
+  if (needed <= allocated)
+    return;
+
+  uint64 new_size = std::max(needed, static_cast<uint64>(allocated) * 2);
+  new_size = std::max(new_size, static_cast<uint64>(kMinDictionaryAllocation));
+  new_size = std::min(new_size, static_cast<uint64>(dictionary_size_));
+
+  scoped_array<unsigned char> dictionary(
+      new unsigned char[static_cast<size_t>(new_size)]);
+  if (output_bytes_)
+    memcpy(dictionary.get(), dictionary_.get(),
+           static_cast<size_t>(output_bytes_));
+  dictionary_.swap(dictionary);
+  decoder_state_.Dictionary = dictionary_.get();
+  decoder_state_.Properties.DictionarySize = static_cast<uint32>(new_size);
+}
+
+void LZMAFilter::SaveDecoder(size_t output_size) {
+  // LzmaDecode() only updates decoder_state_ when it succeeds, but it changes
+  // the probabilities and writes to the dictionary as it goes.
+  if (!saved_probs_.get())
+    saved_probs_.reset(new CProb[num_probs_]);
+  memcpy(saved_probs_.get(), probs_.get(), num_probs_ * sizeof(CProb));
+
+  uint32 size = decoder_state_.Properties.DictionarySize;
+  uint32 pos = decoder_state_.DictionaryPos;
+  size_t amount = std::min(output_size, static_cast<size_t>(size));
+  size_t first = std::min(amount, static_cast<size_t>(size - pos));
+  const char* dictionary = reinterpret_cast<const char*>(dictionary_.get());
+  saved_dictionary_.assign(dictionary + pos, first);
+  saved_dictionary_.append(dictionary, amount - first);
+}
+
+void LZMAFilter::RestoreDecoder() {
+  memcpy(probs_.get(), saved_probs_.get(), num_probs_ * sizeof(CProb));
+
+  uint32 size = decoder_state_.Properties.DictionarySize;
+  uint32 pos = decoder_state_.DictionaryPos;
+  size_t first = std::min(saved_dictionary_.size(),
+                          static_cast<size_t>(size - pos));
+  memcpy(dictionary_.get() + pos, saved_dictionary_.data(), first);
+  memcpy(dictionary_.get(), saved_dictionary_.data() + first,
+         saved_dictionary_.size() - first);
+}
+
+void LZMAFilter::SkipStreamData(size_t amount) {
+  DCHECK(amount <= static_cast<size_t>(stream_data_len_));
+  stream_data_len_ -= static_cast<int>(amount);
+  if (stream_data_len_)
+    next_stream_data_ += amount;
+  else
+    next_stream_data_ = NULL;
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// LZMAFilter decodes content that was compressed with LZMA, the algorithm used
+// by 7-Zip, into the ".lzma" format written by the LZMA SDK and by xz.  That
+// format is a 5 byte properties header, the 8 byte little endian size of the
+// uncompressed data (all ones if unknown, in which case the stream ends with
+// an end marker), then the compressed stream.
+//
+// LZMA compresses text noticeably better than gzip or bzip2, and decodes much
+// faster than bzip2.  Its window can be large, so the filter grows its
+// dictionary as output is produced rather than allocating all of it up front,
+// and refuses streams whose dictionary is larger than kMaxDictionarySize.
+//
+// This LZMAFilter internally uses the third_party/lzma_sdk decoder, built with
+// _LZMA_OUT_READ so that it can be called repeatedly on pieces of the stream.
+//
+// LZMAFilter is also a subclass of Filter. See the latter's header file
+// filter.h for sample usage.
+
+#ifndef NET_BASE_LZMA_FILTER_H_
+#define NET_BASE_LZMA_FILTER_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/scoped_ptr.h"
+#include "net/base/filter.h"
+
+extern "C" {
+#include "third_party/lzma_sdk/Compress/Lzma/LzmaDecode.h"
+}
+
+#ifndef _LZMA_OUT_READ
+#error LZMAFilter needs the streaming decoder; see using_lzma_sdk_stream.scons.
+#endif
+
+class LZMAFilter : public Filter {
+ public:
+  // The largest dictionary a stream may ask for.
+  static const uint32 kMaxDictionarySize;
+
+  LZMAFilter();
+
+  virtual ~LZMAFilter();
+
+  // The Filter::FilterCreator for lzma.  Returns NULL on failure.
+  static Filter* Create(Filter::FilterType type_id, int buffer_size);
+
+  // Initializes filter decoding mode and internal control blocks.
+  // The function returns true if success and false otherwise.
+  // The filter can only be initialized once.
+  bool InitDecoding();
+
+  // Decodes the pre-filter data and writes the output into the dest_buffer
+  // passed in.
+  // The function returns FilterStatus. See filter.h for its description.
+  //
+  // Upon entry, *dest_len is the total size (in number of chars) of the
+  // destination buffer. Upon exit, *dest_len is the actual number of chars
+  // written into the destination buffer.
+  virtual FilterStatus ReadFilteredData(char* dest_buffer, int* dest_len);
+
+ private:
+  enum DecodingStatus {
+    DECODING_UNINITIALIZED,
+    DECODING_HEADER,
+    DECODING_IN_PROGRESS,
+    DECODING_DONE,
+    DECODING_ERROR
+  };
+
+  enum DecodeResult {
+    DECODE_OK,
+    DECODE_NEED_MORE_INPUT,
+    DECODE_END,
+    DECODE_ERROR
+  };
+
+  // Collects the .lzma header from the pre-filter data and sets up the
+  // decoder from it.  Returns FILTER_OK once the decoder is ready.
+  FilterStatus ReadHeader();
+
+  // Decodes from |input| into |dest|, and sets |*consumed| and |*produced| to
+  // the number of chars used from each.  DECODE_NEED_MORE_INPUT means that
+  // |input| ended partway through a symbol; nothing was consumed or produced.
+  DecodeResult Decode(const char* input, size_t input_len,
+                      char* dest, size_t dest_len,
+                      size_t* consumed, size_t* produced);
+
+  // Makes sure the dictionary can take |output_size| more chars without
+  // wrapping, unless it already has the size the stream asked for.
+  void GrowDictionary(size_t output_size);
+
+  // Saves and restores what a call to LzmaDecode() that may produce up to
+  // |output_size| chars can change when it fails.
+  void SaveDecoder(size_t output_size);
+  void RestoreDecoder();
+
+  // Drops |amount| chars from the front of the pre-filter data.
+  void SkipStreamData(size_t amount);
+
+  // Tracks the status of decoding.
+  // This variable is initialized by InitDecoding and updated only by
+  // ReadFilteredData.
+  DecodingStatus decoding_status_;
+
+  // The .lzma header, while we don't have all of it yet.
+  std::string header_;
+
+  // The decoder, its probability model and its sliding window.
+  CLzmaDecoderState decoder_state_;
+  scoped_array<CProb> probs_;
+  size_t num_probs_;
+  scoped_array<unsigned char> dictionary_;
+
+  // The dictionary size from the header.  The allocated size is in
+  // decoder_state_.Properties.DictionarySize.
+  uint32 dictionary_size_;
+
+  // The size of the decoded data from the header, or -1 if the stream ends
+  // with an end marker instead.
+  int64 uncompressed_size_;
+  int64 output_bytes_;
+
+  // Pre-filter data that was too short for the decoder to use, kept until
+  // more arrives.
+  std::string input_tail_;
+
+  // Copies of the probabilities and of the part of the dictionary that a
+  // failed call to LzmaDecode() may have changed.
+  scoped_array<CProb> saved_probs_;
+  std::string saved_dictionary_;
+
+  DISALLOW_COPY_AND_ASSIGN(LZMAFilter);
+};
+
+#endif  // NET_BASE_LZMA_FILTER_H_
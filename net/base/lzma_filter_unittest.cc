@@ -0,0 +1,218 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/path_service.h"
+#include "base/platform_test.h"
+#include "base/scoped_ptr.h"
+#include "net/base/lzma_filter.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kDefaultBufferSize = 4096;
+const int kSmallBufferSize = 128;
+
+const char kApplicationOctetStream[] = "application/octet-stream";
+
+// Where the uncompressed size is in a .lzma header.
+const int kUncompressedSizeOffset = 5;
+
+// These tests use the path service, which uses autoreleased objects on the
+// Mac, so this needs to be a PlatformTest.
+class LZMAFilterUnitTest : public PlatformTest {
+ protected:
+  virtual void SetUp() {
+    PlatformTest::SetUp();
+
+    std::wstring file_path;
+    PathService::Get(base::DIR_SOURCE_ROOT, &file_path);
+    file_util::AppendToPath(&file_path, L"net");
+    file_util::AppendToPath(&file_path, L"data");
+    file_util::AppendToPath(&file_path, L"filter_unittests");
+    std::wstring source_path = file_path;
+    file_util::AppendToPath(&source_path, L"google.txt");
+    std::wstring encoded_path = file_path;
+    // Made with "xz --format=lzma", so it ends with an end marker and has no
+    // uncompressed size.
+    file_util::AppendToPath(&encoded_path, L"google.txt.lzma");
+
+    ASSERT_TRUE(file_util::ReadFileToString(source_path, &source_));
+    ASSERT_TRUE(file_util::ReadFileToString(encoded_path, &encoded_));
+    ASSERT_GT(source_.size(), 0U);
+    ASSERT_GT(encoded_.size(), 0U);
+  }
+
+  Filter* CreateFilter(int buffer_size) {
+    std::vector<std::string> filters;
+    filters.push_back("lzma");
+    return Filter::Factory(filters, kApplicationOctetStream, buffer_size);
+  }
+
+  // Feeds |encoded| to |filter| as much as its stream buffer will hold at a
+  // time, and reads the output |output_buffer_size| chars at a time into
+  // |*decoded|.  Returns the last status from the filter.
+  Filter::FilterStatus Decode(Filter* filter, const std::string& encoded,
+                              int output_buffer_size, std::string* decoded) {
+    std::vector<char> output_buffer(output_buffer_size);
+    size_t offset = 0;
+    Filter::FilterStatus status = Filter::FILTER_NEED_MORE_DATA;
+    while (status != Filter::FILTER_DONE && status != Filter::FILTER_ERROR) {
+      if (!filter->stream_data_len()) {
+        if (offset == encoded.size())
+          break;
+        int amount = std::min(static_cast<int>(encoded.size() - offset),
+                              filter->stream_buffer_size());
+        memcpy(filter->stream_buffer(), encoded.data() + offset, amount);
+        filter->FlushStreamBuffer(amount);
+        offset += amount;
+      }
+      int output_len = output_buffer_size;
+      status = filter->ReadData(&output_buffer[0], &output_len);
+      decoded->append(&output_buffer[0], output_len);
+    }
+    return status;
+  }
+
+  // Returns the test data with the uncompressed size filled in.
+  std::string EncodedWithSize() const {
+    std::string encoded(encoded_);
+    uint64 size = source_.size();
+    for (int i = 0; i < 8; ++i)
+      encoded[kUncompressedSizeOffset + i] = static_cast<char>(size >> (8 * i));
+    return encoded;
+  }
+
+  std::string source_;
+  std::string encoded_;
+};
+
+// Basic scenario: decoding lzma data with big enough buffers.
+TEST_F(LZMAFilterUnitTest, DecodeLZMA) {
+  scoped_ptr<Filter> filter(CreateFilter(kDefaultBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_DONE,
+            Decode(filter.get(), encoded_, kDefaultBufferSize, &decoded));
+  EXPECT_TRUE(source_ == decoded);
+}
+
+// Tests we can call filter repeatedly to get all the data decoded.
+TEST_F(LZMAFilterUnitTest, DecodeWithSmallInputBuffer) {
+  scoped_ptr<Filter> filter(CreateFilter(kSmallBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_DONE,
+            Decode(filter.get(), encoded_, kDefaultBufferSize, &decoded));
+  EXPECT_TRUE(source_ == decoded);
+}
+
+TEST_F(LZMAFilterUnitTest, DecodeWithSmallOutputBuffer) {
+  scoped_ptr<Filter> filter(CreateFilter(kDefaultBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_DONE,
+            Decode(filter.get(), encoded_, kSmallBufferSize, &decoded));
+  EXPECT_TRUE(source_ == decoded);
+}
+
+// With one byte at a time the decoder keeps running out of input partway
+// through a symbol, and has to wait for more.
+TEST_F(LZMAFilterUnitTest, DecodeWithOneByteInputAndOutputBuffer) {
+  scoped_ptr<Filter> filter(CreateFilter(1));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_DONE, Decode(filter.get(), encoded_, 1, &decoded));
+  EXPECT_TRUE(source_ == decoded);
+}
+
+// A stream with a known size is done once it has produced that much.
+TEST_F(LZMAFilterUnitTest, DecodeWithUncompressedSize) {
+  scoped_ptr<Filter> filter(CreateFilter(kSmallBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_DONE,
+            Decode(filter.get(), EncodedWithSize(), kSmallBufferSize,
+                   &decoded));
+  EXPECT_TRUE(source_ == decoded);
+}
+
+// Data after the end of the stream is dropped.
+TEST_F(LZMAFilterUnitTest, DecodeWithExtraData) {
+  scoped_ptr<Filter> filter(CreateFilter(kSmallBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_DONE,
+            Decode(filter.get(), encoded_ + "Extra data", kDefaultBufferSize,
+                   &decoded));
+  EXPECT_TRUE(source_ == decoded);
+}
+
+TEST_F(LZMAFilterUnitTest, DecodeCorruptedData) {
+  std::string corrupt_data(encoded_);
+  for (size_t i = corrupt_data.size() / 2; i < corrupt_data.size() / 2 + 16;
+       ++i)
+    corrupt_data[i] = ~corrupt_data[i];
+
+  scoped_ptr<Filter> filter(CreateFilter(kDefaultBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_NE(Filter::FILTER_DONE,
+            Decode(filter.get(), corrupt_data, kDefaultBufferSize, &decoded));
+  EXPECT_FALSE(source_ == decoded);
+}
+
+TEST_F(LZMAFilterUnitTest, DecodeCorruptedHeader) {
+  // Properties past the last valid value.
+  std::string corrupt_data(encoded_);
+  corrupt_data[0] = static_cast<char>(9 * 5 * 5);
+
+  scoped_ptr<Filter> filter(CreateFilter(kDefaultBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_ERROR,
+            Decode(filter.get(), corrupt_data, kDefaultBufferSize, &decoded));
+  EXPECT_TRUE(decoded.empty());
+}
+
+TEST_F(LZMAFilterUnitTest, RejectLargeDictionary) {
+  std::string large_dictionary(encoded_);
+  uint32 dictionary_size = LZMAFilter::kMaxDictionarySize * 2;
+  for (int i = 0; i < 4; ++i)
+    large_dictionary[1 + i] = static_cast<char>(dictionary_size >> (8 * i));
+
+  scoped_ptr<Filter> filter(CreateFilter(kDefaultBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_ERROR,
+            Decode(filter.get(), large_dictionary, kDefaultBufferSize,
+                   &decoded));
+}
+
+// Filters can be registered under new content encodings.
+TEST_F(LZMAFilterUnitTest, RegisterFilterType) {
+  std::vector<std::string> filters;
+  filters.push_back("x-test-lzma");
+  scoped_ptr<Filter> filter(
+      Filter::Factory(filters, kApplicationOctetStream, kDefaultBufferSize));
+  EXPECT_FALSE(filter.get());
+
+  Filter::RegisterFilterType("x-test-lzma", Filter::FILTER_TYPE_LZMA,
+                             &LZMAFilter::Create, false);
+  filter.reset(
+      Filter::Factory(filters, kApplicationOctetStream, kDefaultBufferSize));
+  ASSERT_TRUE(filter.get());
+  std::string decoded;
+  EXPECT_EQ(Filter::FILTER_DONE,
+            Decode(filter.get(), encoded_, kDefaultBufferSize, &decoded));
+  EXPECT_TRUE(source_ == decoded);
+
+  // It was not advertised.
+  EXPECT_EQ("gzip,deflate,bzip2,lzma", Filter::GetAcceptEncodings());
+}
+
+}  // namespace
@@ -224,6 +224,10 @@ NET_ERROR(RESPONSE_HEADERS_TOO_BIG, -325)
 // The cache does not have the requested entry.
 NET_ERROR(CACHE_MISS, -400)
 
+// The cache entry could not be read in full, for instance because the
+// transaction that was writing it failed.
+NET_ERROR(CACHE_READ_FAILURE, -401)
+
 // The server's response was insecure (e.g. there was a cert error).
 NET_ERROR(INSECURE_RESPONSE, -501)
 
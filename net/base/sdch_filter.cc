@@ -13,6 +13,57 @@
 
 #include "sdch/open-vcdiff/src/google/vcdecoder.h"
 
+namespace {
+
+// The output "string" that SdchFilter hands to the vcdiff decoder.  Decoded
+// data goes straight into the caller's buffer, and only what doesn't fit
+// there is appended to |excess|, so we don't copy every byte through an
+// intermediate string.  The decoder takes any type with the interface of
+// OutputString (see google/output_string.h, new in open-vcdiff 0.2).
+class SdchOutputSink {
+ public:
+  SdchOutputSink(char* dest_buffer, size_t dest_len, std::string* excess)
+      : dest_buffer_(dest_buffer),
+        dest_len_(dest_len),
+        dest_used_(0),
+        excess_(excess) {
+    DCHECK(excess_->empty());
+  }
+
+  // The number of bytes written into the caller's buffer.
+  size_t dest_used() const { return dest_used_; }
+
+  // The interface the decoder expects from its output string.
+  SdchOutputSink& append(const char* data, size_t len) {
+    size_t amount = std::min(len, dest_len_ - dest_used_);
+    memcpy(dest_buffer_ + dest_used_, data, amount);
+    dest_used_ += amount;
+    if (amount < len)
+      excess_->append(data + amount, len - amount);
+    return *this;
+  }
+  void push_back(char c) { append(&c, 1); }
+  void clear() {
+    dest_used_ = 0;
+    excess_->clear();
+  }
+  void reserve(size_t size) {
+    if (size > dest_len_)
+      excess_->reserve(size - dest_len_);
+  }
+  size_t size() const { return dest_used_ + excess_->size(); }
+
+ private:
+  char* const dest_buffer_;
+  const size_t dest_len_;
+  size_t dest_used_;
+  std::string* excess_;
+
+  DISALLOW_COPY_AND_ASSIGN(SdchOutputSink);
+};
+
+}  // namespace
+
 SdchFilter::SdchFilter()
     : decoding_status_(DECODING_UNINITIALIZED),
       vcdiff_streaming_decoder_(NULL),
@@ -45,6 +96,14 @@ SdchFilter::~SdchFilter() {
     dictionary_->Release();
 }
 
+// static
+Filter* SdchFilter::Create(Filter::FilterType type_id, int buffer_size) {
+  scoped_ptr<SdchFilter> sdch_filter(new SdchFilter());
+  if (!sdch_filter->InitBuffer(buffer_size) || !sdch_filter->InitDecoding())
+    return NULL;
+  return sdch_filter.release();
+}
+
 bool SdchFilter::InitDecoding() {
   if (decoding_status_ != DECODING_UNINITIALIZED)
     return false;
@@ -120,7 +179,11 @@ Filter::FilterStatus SdchFilter::ReadFilteredData(char* dest_buffer,
       return FILTER_NEED_MORE_DATA;
     }
     if (PASS_THROUGH == decoding_status_) {
-      return CopyOut(dest_buffer, dest_len);
+      // CopyOut takes the space left, not what we already wrote.
+      int copied = available_space;
+      FilterStatus status = CopyOut(dest_buffer, &copied);
+      *dest_len += copied;
+      return status;
     }
     DCHECK(false);
     decoding_status_ = DECODING_ERROR;
@@ -131,13 +194,14 @@ Filter::FilterStatus SdchFilter::ReadFilteredData(char* dest_buffer,
   if (!next_stream_data_ || stream_data_len_ <= 0)
     return FILTER_NEED_MORE_DATA;
 
+  SdchOutputSink sink(dest_buffer, available_space, &dest_buffer_excess_);
   bool ret = vcdiff_streaming_decoder_->DecodeChunk(
-    next_stream_data_, stream_data_len_, &dest_buffer_excess_);
+    next_stream_data_, stream_data_len_, &sink);
   // Assume all data was used in decoding.
   next_stream_data_ = NULL;
   source_bytes_ += stream_data_len_;
   stream_data_len_ = 0;
-  output_bytes_ += dest_buffer_excess_.size();
+  output_bytes_ += sink.size();
   if (!ret) {
     vcdiff_streaming_decoder_.reset(NULL);  // Don't call it again.
     decoding_status_ = DECODING_ERROR;
@@ -145,14 +209,16 @@ Filter::FilterStatus SdchFilter::ReadFilteredData(char* dest_buffer,
     return FILTER_ERROR;
   }
 
-  amount = OutputBufferExcess(dest_buffer, available_space);
-  *dest_len += amount;
-  dest_buffer += amount;
-  if (0 == available_space && !dest_buffer_excess_.empty())
-      return FILTER_OK;
+  *dest_len += sink.dest_used();
+  if (!dest_buffer_excess_.empty())
+    return FILTER_OK;
   return FILTER_NEED_MORE_DATA;
 }
 
+bool SdchFilter::PassesThroughStreamData() const {
+  return PASS_THROUGH == decoding_status_ && dest_buffer_excess_.empty();
+}
+
 Filter::FilterStatus SdchFilter::InitializeDictionary() {
   const size_t kServerIdLength = 9;  // Dictionary hash plus null from server.
   size_t bytes_needed = kServerIdLength - dictionary_hash_.size();
@@ -200,9 +266,14 @@ Filter::FilterStatus SdchFilter::InitializeDictionary() {
     return FILTER_ERROR;
   }
   dictionary_->AddRef();
+  // The decoder works straight from the dictionary's text, which all filters
+  // using the dictionary share.
+  TimeTicks decoder_setup_start = TimeTicks::Now();
   vcdiff_streaming_decoder_.reset(new open_vcdiff::VCDiffStreamingDecoder);
   vcdiff_streaming_decoder_->StartDecoding(dictionary_->text().data(),
                                            dictionary_->text().size());
+  HISTOGRAM_TIMES(L"Sdch.Decoder setup time",
+                  TimeTicks::Now() - decoder_setup_start);
   decoding_status_ = DECODING_IN_PROGRESS;
   return FILTER_OK;
 }
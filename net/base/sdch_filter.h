@@ -32,6 +32,9 @@ class SdchFilter : public Filter {
 
   virtual ~SdchFilter();
 
+  // The Filter::FilterCreator for sdch.  Returns NULL on failure.
+  static Filter* Create(Filter::FilterType type_id, int buffer_size);
+
   // Initializes filter decoding mode and internal control blocks.
   bool InitDecoding();
 
@@ -43,6 +46,10 @@ class SdchFilter : public Filter {
   // written into the destination buffer.
   virtual FilterStatus ReadFilteredData(char* dest_buffer, int* dest_len);
 
+ protected:
+  // Non-sdch content is handed to the next filter as is.
+  virtual bool PassesThroughStreamData() const;
+
  private:
   // Internal status.  Once we enter an error state, we stop processing data.
   enum DecodingStatus {
@@ -87,8 +94,9 @@ class SdchFilter : public Filter {
   // The char* data is embedded in a RefCounted dictionary_.
   SdchManager::Dictionary* dictionary_;
 
-  // The decoder may demand a larger output buffer than the target of
-  // ReadFilteredData so we buffer the excess output between calls.
+  // The decoder writes straight into the target of ReadFilteredData, but it
+  // may produce more output than fits there, so we buffer the excess output
+  // between calls.
   std::string dest_buffer_excess_;
   // To avoid moving strings around too much, we save the index into
   // dest_buffer_excess_ that has the next byte to output.
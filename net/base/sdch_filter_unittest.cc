@@ -9,9 +9,11 @@
 #include <vector>
 
 #include "base/logging.h"
+#include "base/message_loop.h"
 #include "base/scoped_ptr.h"
 #include "net/base/filter.h"
 #include "net/base/sdch_filter.h"
+#include "net/disk_cache/disk_cache.h"
 #include "net/url_request/url_request_http_job.cc"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "third_party/zlib/zlib.h"
@@ -566,6 +568,41 @@ TEST_F(SdchFilterTest, DefaultGzipIfSdch) {
   EXPECT_EQ(output, expanded_);
 }
 
+// Content that is neither gzipped nor sdch encoded is passed through by both
+// filters of the default chain, which hand their input buffers down instead of
+// copying the data.
+TEST_F(SdchFilterTest, NonSdchContentPassesThrough) {
+  std::string plain_text;
+  for (int i = 0; i < 50; ++i)
+    plain_text.append("This is not sdch encoded. ");
+
+  std::vector<std::string> filters;
+  filters.push_back("sdch");
+
+  const int kInputBufferSize(100);
+  scoped_ptr<Filter> filter(Filter::Factory(filters, "missing-mime",
+                                            kInputBufferSize));
+  filter->SetURL(GURL("http://ignore.com"));
+
+  size_t feed_block_size = 100;
+  size_t output_block_size = 100;
+  std::string output;
+  EXPECT_TRUE(FilterTestData(plain_text, feed_block_size, output_block_size,
+                             filter.get(), &output));
+  EXPECT_EQ(plain_text, output);
+
+  // Output buffers smaller than the scanned dictionary hash, and odd feeds.
+  filter.reset(Filter::Factory(filters, "missing-mime", kInputBufferSize));
+  filter->SetURL(GURL("http://ignore.com"));
+
+  feed_block_size = 7;
+  output_block_size = 5;
+  output.clear();
+  EXPECT_TRUE(FilterTestData(plain_text, feed_block_size, output_block_size,
+                             filter.get(), &output));
+  EXPECT_EQ(plain_text, output);
+}
+
 TEST_F(SdchFilterTest, DomainSupported) {
   GURL test_url("http://www.test.com");
   GURL google_url("http://www.google.com");
@@ -590,6 +627,107 @@ TEST_F(SdchFilterTest, DomainBlacklisting) {
   EXPECT_FALSE(SdchManager::Global()->IsInSupportedDomain(google_url));
 }
 
+// Dictionaries in the dictionary store are available after a restart.
+TEST_F(SdchFilterTest, DictionaryStore) {
+  MessageLoop message_loop;
+  scoped_ptr<disk_cache::Backend> store(
+      disk_cache::CreateInMemoryCacheBackend(0));
+  ASSERT_TRUE(store.get());
+  sdch_manager_->set_dictionary_store(store.get());
+
+  const std::string kSampleDomain = "sdchtest.com";
+  std::string dictionary(NewSdchDictionary(kSampleDomain));
+  GURL url("http://" + kSampleDomain);
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary, url));
+  EXPECT_EQ(1, store->GetEntryCount());
+
+  // Start over with the same store.
+  sdch_manager_.reset();
+  sdch_manager_.reset(new SdchManager);
+  sdch_manager_->EnableSdchSupport("");
+  sdch_manager_->set_dictionary_store(store.get());
+
+  // The dictionary is known, but not advertised until it has been read.
+  EXPECT_FALSE(sdch_manager_->AddSdchDictionary(dictionary, url));
+  std::string dictionary_list;
+  sdch_manager_->GetAvailDictionaryList(url, &dictionary_list);
+  EXPECT_TRUE(dictionary_list.empty());
+
+  sdch_manager_->LoadStoredDictionaries();
+  std::string client_hash, server_hash;
+  SdchManager::GenerateHash(dictionary, &client_hash, &server_hash);
+  sdch_manager_->GetAvailDictionaryList(url, &dictionary_list);
+  EXPECT_EQ(client_hash, dictionary_list);
+
+  std::vector<std::string> filters;
+  filters.push_back("sdch");
+  scoped_ptr<Filter> filter(Filter::Factory(filters, "missing-mime", 100));
+  filter->SetURL(url);
+  std::string output;
+  EXPECT_TRUE(FilterTestData(NewSdchCompressedData(dictionary), 100, 100,
+                             filter.get(), &output));
+  EXPECT_EQ(expanded_, output);
+}
+
+TEST_F(SdchFilterTest, DictionaryStoreDropsExpiredDictionary) {
+  MessageLoop message_loop;
+  scoped_ptr<disk_cache::Backend> store(
+      disk_cache::CreateInMemoryCacheBackend(0));
+  ASSERT_TRUE(store.get());
+  sdch_manager_->set_dictionary_store(store.get());
+
+  const std::string kSampleDomain = "sdchtest.com";
+  std::string dictionary("Domain: " + kSampleDomain + "\nMax-Age: 0\n");
+  dictionary.append(NewSdchDictionary(""));
+  GURL url("http://" + kSampleDomain);
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary, url));
+  EXPECT_EQ(1, store->GetEntryCount());
+
+  sdch_manager_.reset();
+  sdch_manager_.reset(new SdchManager);
+  sdch_manager_->EnableSdchSupport("");
+  sdch_manager_->set_dictionary_store(store.get());
+  EXPECT_EQ(0, store->GetEntryCount());
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary, url));
+}
+
+TEST_F(SdchFilterTest, DictionaryStoreDropsCorruptDictionary) {
+  MessageLoop message_loop;
+  scoped_ptr<disk_cache::Backend> store(
+      disk_cache::CreateInMemoryCacheBackend(0));
+  ASSERT_TRUE(store.get());
+  sdch_manager_->set_dictionary_store(store.get());
+
+  const std::string kSampleDomain = "sdchtest.com";
+  std::string dictionary(NewSdchDictionary(kSampleDomain));
+  GURL url("http://" + kSampleDomain);
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary, url));
+
+  // Change the text behind the manager's back.
+  std::string client_hash, server_hash;
+  SdchManager::GenerateHash(dictionary, &client_hash, &server_hash);
+  disk_cache::Entry* entry;
+  ASSERT_TRUE(store->OpenEntry(server_hash, &entry));
+  std::string corrupt_text(dictionary);
+  corrupt_text[corrupt_text.size() - 2] = '!';
+  EXPECT_EQ(static_cast<int>(corrupt_text.size()),
+            entry->WriteData(1, 0, corrupt_text.data(),
+                             static_cast<int>(corrupt_text.size()), NULL,
+                             true));
+  entry->Close();
+
+  sdch_manager_.reset();
+  sdch_manager_.reset(new SdchManager);
+  sdch_manager_->EnableSdchSupport("");
+  sdch_manager_->set_dictionary_store(store.get());
+  sdch_manager_->LoadStoredDictionaries();
+  EXPECT_EQ(0, store->GetEntryCount());
+
+  std::string dictionary_list;
+  sdch_manager_->GetAvailDictionaryList(url, &dictionary_list);
+  EXPECT_TRUE(dictionary_list.empty());
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary, url));
+}
 
 // TODO(jar): move this sort of test into filter_unittest.cc, or
 // url_request_http_job_unittest.cc if that is more applicable after refactoring
@@ -617,6 +755,12 @@ TEST_F(SdchFilterTest, ContentTypeId) {
             Filter::ConvertEncodingToType("x-bzip2", "nothing"));
   EXPECT_EQ(Filter::FILTER_TYPE_BZIP2,
             Filter::ConvertEncodingToType("X-BZiP2", "nothing"));
+  EXPECT_EQ(Filter::FILTER_TYPE_LZMA,
+            Filter::ConvertEncodingToType("lzma", "nothing"));
+  EXPECT_EQ(Filter::FILTER_TYPE_LZMA,
+            Filter::ConvertEncodingToType("LzMa", "nothing"));
+  EXPECT_EQ(Filter::FILTER_TYPE_LZMA,
+            Filter::ConvertEncodingToType("x-lzma", "nothing"));
   EXPECT_EQ(Filter::FILTER_TYPE_SDCH,
             Filter::ConvertEncodingToType("sdch", "nothing"));
   EXPECT_EQ(Filter::FILTER_TYPE_SDCH,
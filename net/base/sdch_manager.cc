@@ -2,15 +2,44 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <vector>
+
+#include "base/compiler_specific.h"
 #include "base/histogram.h"
 #include "base/logging.h"
+#include "base/message_loop.h"
+#include "base/pickle.h"
 #include "base/sha2.h"
 #include "base/string_util.h"
 #include "net/base/base64.h"
 #include "net/base/registry_controlled_domain.h"
 #include "net/base/sdch_manager.h"
+#include "net/disk_cache/disk_cache.h"
 #include "net/url_request/url_request_http_job.h"
 
+namespace {
+
+// Each dictionary in the dictionary store is an entry keyed by its server
+// hash.  One stream holds its metadata, and the other the full text it was
+// added with, so that the hash can be checked when it is read back.
+const int kMetadataIndex = 0;
+const int kTextIndex = 1;
+
+// Change this when the metadata format changes; entries written with another
+// version are dropped.
+const int kStoreVersion = 1;
+
+// Reads stream |index| of |entry| into |*data|.
+bool ReadEntryData(disk_cache::Entry* entry, int index, std::string* data) {
+  int size = entry->GetDataSize(index);
+  data->clear();
+  if (size <= 0)
+    return size == 0;
+  return entry->ReadData(index, 0, WriteInto(data, size + 1), size,
+                         NULL) == size;
+}
+
+}  // namespace
 
 //------------------------------------------------------------------------------
 // static
@@ -29,6 +58,14 @@ void SdchManager::SdchErrorRecovery(ProblemCodes problem) {
   histogram.Add(problem);
 }
 
+// static
+void SdchManager::RecordDictionaryLookup(DictionaryLookup lookup) {
+  static LinearHistogram histogram(L"Sdch.Dictionary lookups", 1,
+                                   MAX_DICTIONARY_LOOKUP - 1,
+                                   MAX_DICTIONARY_LOOKUP);
+  histogram.Add(lookup);
+}
+
 // static
 void SdchManager::ClearBlacklistings() {
   Global()->blacklisted_domains_.clear();
@@ -36,7 +73,10 @@ void SdchManager::ClearBlacklistings() {
 
 
 //------------------------------------------------------------------------------
-SdchManager::SdchManager() : sdch_enabled_(false) {
+SdchManager::SdchManager()
+    : dictionary_store_(NULL),
+      ALLOW_THIS_IN_INITIALIZER_LIST(method_factory_(this)),
+      sdch_enabled_(false) {
   DCHECK(!global_);
   global_ = this;
 }
@@ -115,12 +155,39 @@ bool SdchManager::AddSdchDictionary(const std::string& dictionary_text,
     return false;  // Already loaded.
   }
 
+  size_t header_end;
   std::string domain, path;
   std::set<int> ports;
   Time expiration;
+  if (!ParseDictionaryHeader(dictionary_text, &header_end, &domain, &path,
+                             &ports, &expiration))
+    return false;
 
-  size_t header_end = dictionary_text.find("\n\n");
-  if (std::string::npos == header_end) {
+  if (!Dictionary::CanSet(domain, path, ports, dictionary_url))
+    return false;
+
+  HISTOGRAM_COUNTS(L"Sdch.Dictionary size loaded", dictionary_text.size());
+  DLOG(INFO) << "Loaded dictionary with client hash " << client_hash <<
+      " and server hash " << server_hash;
+  Dictionary* dictionary =
+      new Dictionary(dictionary_text, header_end + 2, client_hash,
+                     dictionary_url, domain, path, expiration, ports);
+  dictionary->AddRef();
+  dictionaries_[server_hash] = dictionary;
+  if (dictionary_store_)
+    StoreDictionary(server_hash, dictionary_text, *dictionary);
+  return true;
+}
+
+// static
+bool SdchManager::ParseDictionaryHeader(const std::string& dictionary_text,
+                                        size_t* header_end,
+                                        std::string* domain,
+                                        std::string* path,
+                                        std::set<int>* ports,
+                                        Time* expiration) {
+  *header_end = dictionary_text.find("\n\n");
+  if (std::string::npos == *header_end) {
     SdchErrorRecovery(DICTIONARY_HAS_NO_HEADER);
     return false;  // Missing header.
   }
@@ -128,7 +195,7 @@ bool SdchManager::AddSdchDictionary(const std::string& dictionary_text,
   while (1) {
     size_t line_end = dictionary_text.find('\n', line_start);
     DCHECK(std::string::npos != line_end);
-    DCHECK(line_end <= header_end);
+    DCHECK(line_end <= *header_end);
 
     size_t colon_index = dictionary_text.find(':', line_start);
     if (std::string::npos == colon_index) {
@@ -148,37 +215,26 @@ bool SdchManager::AddSdchDictionary(const std::string& dictionary_text,
       std::string value(dictionary_text, value_start, line_end - value_start);
       name = StringToLowerASCII(name);
       if (name == "domain") {
-        domain = value;
+        *domain = value;
       } else if (name == "path") {
-        path = value;
+        *path = value;
       } else if (name == "format-version") {
         if (value != "1.0")
           return false;
       } else if (name == "max-age") {
-        expiration = Time::Now() + TimeDelta::FromSeconds(StringToInt64(value));
+        *expiration = Time::Now() +
+            TimeDelta::FromSeconds(StringToInt64(value));
       } else if (name == "port") {
         int port = StringToInt(value);
         if (port >= 0)
-          ports.insert(port);
+          ports->insert(port);
       }
     }
 
-    if (line_end >= header_end)
+    if (line_end >= *header_end)
       break;
     line_start = line_end + 1;
   }
-
-  if (!Dictionary::CanSet(domain, path, ports, dictionary_url))
-    return false;
-
-  HISTOGRAM_COUNTS(L"Sdch.Dictionary size loaded", dictionary_text.size());
-  DLOG(INFO) << "Loaded dictionary with client hash " << client_hash <<
-      " and server hash " << server_hash;
-  Dictionary* dictionary =
-      new Dictionary(dictionary_text, header_end + 2, client_hash,
-                     dictionary_url, domain, path, expiration, ports);
-  dictionary->AddRef();
-  dictionaries_[server_hash] = dictionary;
   return true;
 }
 
@@ -188,11 +244,18 @@ void SdchManager::GetVcdiffDictionary(const std::string& server_hash,
   DictionaryMap::iterator it = dictionaries_.find(server_hash);
   if (it == dictionaries_.end()) {
     SdchErrorRecovery(DICTIONARY_NOT_FOUND_FOR_HASH);
+    RecordDictionaryLookup(DICTIONARY_LOOKUP_NOT_FOUND);
     return;
   }
   Dictionary* matching_dictionary = it->second;
+  if (!matching_dictionary->text_loaded_) {
+    // We haven't advertised it yet, so the server shouldn't be using it.
+    RecordDictionaryLookup(DICTIONARY_LOOKUP_NOT_LOADED_YET);
+    return;
+  }
   if (!matching_dictionary->CanUse(referring_url))
     return;
+  RecordDictionaryLookup(DICTIONARY_LOOKUP_FOUND);
   *dictionary = matching_dictionary;
 }
 
@@ -203,7 +266,7 @@ void SdchManager::GetAvailDictionaryList(const GURL& target_url,
                                          std::string* list) {
   for (DictionaryMap::iterator it = dictionaries_.begin();
        it != dictionaries_.end(); ++it) {
-    if (!it->second->CanAdvertise(target_url))
+    if (!it->second->text_loaded_ || !it->second->CanAdvertise(target_url))
       continue;
     if (!list->empty())
       list->append(",");
@@ -216,6 +279,7 @@ SdchManager::Dictionary::Dictionary(const std::string& dictionary_text,
     const std::string& domain, const std::string& path, const Time& expiration,
     const std::set<int> ports)
       : text_(dictionary_text, offset),
+        text_loaded_(true),
         client_hash_(client_hash),
         url_(gurl),
         domain_(domain),
@@ -239,6 +303,174 @@ void SdchManager::GenerateHash(const std::string& dictionary_text,
   DCHECK(client_hash->length() == 8);
 }
 
+void SdchManager::set_dictionary_store(disk_cache::Backend* store) {
+  // A pending load would read from the previous store.
+  method_factory_.RevokeAll();
+  dictionary_store_ = store;
+  if (!dictionary_store_)
+    return;
+
+  std::vector<std::string> unusable_entries;
+  bool found_dictionaries = false;
+  void* iter = NULL;
+  disk_cache::Entry* entry;
+  while (dictionary_store_->OpenNextEntry(&iter, &entry)) {
+    std::string server_hash = entry->GetKey();
+    Dictionary* dictionary = ReadStoredDictionary(entry);
+    entry->Close();
+    if (!dictionary) {
+      unusable_entries.push_back(server_hash);
+      continue;
+    }
+    dictionary->AddRef();
+    if (dictionaries_.find(server_hash) != dictionaries_.end()) {
+      // We already have it in memory.
+      dictionary->Release();
+      continue;
+    }
+    dictionaries_[server_hash] = dictionary;
+    found_dictionaries = true;
+  }
+
+  // The store may not be changed while we enumerate it.
+  for (size_t i = 0; i < unusable_entries.size(); ++i)
+    dictionary_store_->DoomEntry(unusable_entries[i]);
+  HISTOGRAM_COUNTS(L"Sdch.Dictionaries in store",
+                   dictionary_store_->GetEntryCount());
+
+  if (found_dictionaries) {
+    MessageLoop::current()->PostDelayedTask(FROM_HERE,
+        method_factory_.NewRunnableMethod(
+            &SdchManager::LoadStoredDictionaries),
+        kMsDelayBeforeLoadingStoredDictionaries);
+  }
+}
+
+void SdchManager::LoadStoredDictionaries() {
+  DictionaryMap::iterator it = dictionaries_.begin();
+  while (it != dictionaries_.end()) {
+    Dictionary* dictionary = it->second;
+    if (dictionary->text_loaded_ ||
+        LoadDictionaryText(it->first, dictionary)) {
+      ++it;
+      continue;
+    }
+    // Forget about it, so that it can be fetched again.
+    SdchErrorRecovery(DICTIONARY_FAILED_TO_LOAD_FROM_STORE);
+    if (dictionary_store_)
+      dictionary_store_->DoomEntry(it->first);
+    dictionary->Release();
+    dictionaries_.erase(it++);
+  }
+}
+
+void SdchManager::StoreDictionary(const std::string& server_hash,
+                                  const std::string& dictionary_text,
+                                  const Dictionary& dictionary) {
+  DCHECK(dictionary_store_);
+  // Replace any stale copy, such as one that failed to load.
+  dictionary_store_->DoomEntry(server_hash);
+  disk_cache::Entry* entry;
+  if (!dictionary_store_->CreateEntry(server_hash, &entry))
+    return;
+
+  Pickle pickle;
+  pickle.WriteInt(kStoreVersion);
+  pickle.WriteString(dictionary.url().spec());
+  pickle.WriteString(dictionary.client_hash());
+  pickle.WriteString(dictionary.domain_);
+  pickle.WriteString(dictionary.path_);
+  pickle.WriteInt64(dictionary.expiration_.ToInternalValue());
+  pickle.WriteInt(static_cast<int>(dictionary.ports_.size()));
+  for (std::set<int>::const_iterator it = dictionary.ports_.begin();
+       it != dictionary.ports_.end(); ++it)
+    pickle.WriteInt(*it);
+
+  int metadata_len = static_cast<int>(pickle.size());
+  int text_len = static_cast<int>(dictionary_text.size());
+  bool ok = entry->WriteData(kMetadataIndex, 0,
+                             static_cast<const char*>(pickle.data()),
+                             metadata_len, NULL, true) == metadata_len &&
+            entry->WriteData(kTextIndex, 0, dictionary_text.data(), text_len,
+                             NULL, true) == text_len;
+  if (!ok) {
+    DLOG(ERROR) << "Failed to store dictionary " << server_hash;
+    entry->Doom();
+  }
+  entry->Close();
+}
+
+// static
+SdchManager::Dictionary* SdchManager::ReadStoredDictionary(
+    disk_cache::Entry* entry) {
+  std::string metadata;
+  if (!ReadEntryData(entry, kMetadataIndex, &metadata))
+    return NULL;
+
+  Pickle pickle(metadata.data(), static_cast<int>(metadata.size()));
+  void* iter = NULL;
+  int version;
+  std::string url_spec, client_hash, domain, path;
+  int64 expiration_value;
+  int port_count;
+  if (!pickle.ReadInt(&iter, &version) || version != kStoreVersion ||
+      !pickle.ReadString(&iter, &url_spec) ||
+      !pickle.ReadString(&iter, &client_hash) ||
+      !pickle.ReadString(&iter, &domain) ||
+      !pickle.ReadString(&iter, &path) ||
+      !pickle.ReadInt64(&iter, &expiration_value) ||
+      !pickle.ReadInt(&iter, &port_count) || port_count < 0)
+    return NULL;
+  std::set<int> ports;
+  for (int i = 0; i < port_count; ++i) {
+    int port;
+    if (!pickle.ReadInt(&iter, &port))
+      return NULL;
+    ports.insert(port);
+  }
+
+  Time expiration = Time::FromInternalValue(expiration_value);
+  if (!expiration.is_null() && expiration <= Time::Now())
+    return NULL;
+
+  Dictionary* dictionary = new Dictionary(std::string(), 0, client_hash,
+                                          GURL(url_spec), domain, path,
+                                          expiration, ports);
+  dictionary->text_loaded_ = false;
+  return dictionary;
+}
+
+bool SdchManager::LoadDictionaryText(const std::string& server_hash,
+                                     Dictionary* dictionary) {
+  DCHECK(!dictionary->text_loaded_);
+  if (!dictionary_store_)
+    return false;
+
+  TimeTicks start = TimeTicks::Now();
+  disk_cache::Entry* entry;
+  if (!dictionary_store_->OpenEntry(server_hash, &entry))
+    return false;
+  std::string dictionary_text;
+  bool ok = ReadEntryData(entry, kTextIndex, &dictionary_text);
+  entry->Close();
+  if (!ok)
+    return false;
+
+  std::string client_hash, stored_server_hash;
+  GenerateHash(dictionary_text, &client_hash, &stored_server_hash);
+  size_t header_end = dictionary_text.find("\n\n");
+  if (stored_server_hash != server_hash ||
+      client_hash != dictionary->client_hash() ||
+      std::string::npos == header_end)
+    return false;
+
+  dictionary->text_.assign(dictionary_text, header_end + 2,
+                           std::string::npos);
+  dictionary->text_loaded_ = true;
+  HISTOGRAM_TIMES(L"Sdch.Dictionary load time", TimeTicks::Now() - start);
+  return true;
+}
+
 // static
 void SdchManager::UrlSafeBase64Encode(const std::string& input,
                                       std::string* output) {
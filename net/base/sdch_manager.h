@@ -17,6 +17,10 @@
 // (containing metadata) as well as a VCDIFF dictionary (for use by a VCDIFF
 // module) to decompress data.
 
+// When given a dictionary store (a disk cache), the SdchManager also saves the
+// dictionaries it acquires there, and makes the stored ones available again
+// after a restart without fetching them.
+
 #ifndef NET_BASE_SDCH_MANAGER_H_
 #define NET_BASE_SDCH_MANAGER_H_
 
@@ -24,10 +28,16 @@
 #include <set>
 #include <string>
 
+#include "base/logging.h"
 #include "base/ref_counted.h"
+#include "base/task.h"
 #include "base/time.h"
 #include "googleurl/src/gurl.h"
 
+namespace disk_cache {
+class Backend;
+class Entry;
+}
 
 //------------------------------------------------------------------------------
 // Create a public interface to help us load SDCH dictionaries.
@@ -91,6 +101,7 @@ class SdchManager {
     DICTIONARY_LOAD_ATTEMPT_FROM_DIFFERENT_HOST = 30,
     DICTIONARY_SELECTED_FOR_SSL,
     DICTIONARY_ALREADY_LOADED,
+    DICTIONARY_FAILED_TO_LOAD_FROM_STORE,
 
     MAX_PROBLEM_CODE  // Used to bound histogram
   };
@@ -100,7 +111,11 @@ class SdchManager {
   class Dictionary : public base::RefCounted<Dictionary> {
    public:
     // Sdch filters can get our text to use in decoding compressed data.
-    const std::string& text() const { return text_; }
+    // Dictionaries handed out by the SdchManager always have their text.
+    const std::string& text() const {
+      DCHECK(text_loaded_);
+      return text_;
+    }
 
    private:
     friend class SdchManager;  // Only manager can construct an instance.
@@ -137,8 +152,10 @@ class SdchManager {
     static bool DomainMatch(const GURL& url, const std::string& restriction);
 
 
-    // The actual text of the dictionary.
+    // The actual text of the dictionary.  Dictionaries that were found in the
+    // dictionary store don't have it until it is first needed.
     std::string text_;
+    bool text_loaded_;
 
     // Part of the hash of text_ that the client uses to advertise the fact that
     // it has a specific dictionary pre-cached.
@@ -227,10 +244,62 @@ class SdchManager {
   static void GenerateHash(const std::string& dictionary_text,
                            std::string* client_hash, std::string* server_hash);
 
+  // Save dictionaries in |store| as they are added, and pick up the unexpired
+  // dictionaries that are already there.  Only their metadata is read here;
+  // a task posted to the current thread calls LoadStoredDictionaries() a
+  // little later, so that reading them doesn't slow down startup.  The store
+  // is only used on this thread, which must be the one that adds and uses
+  // dictionaries.  The caller keeps ownership of |store|, and must call
+  // set_dictionary_store(NULL) on that thread before deleting it.
+  void set_dictionary_store(disk_cache::Backend* store);
+
+  // Read the text of the stored dictionaries that set_dictionary_store()
+  // found.  They are not advertised or used until then.
+  void LoadStoredDictionaries();
+
  private:
   // A map of dictionaries info indexed by the hash that the server provides.
   typedef std::map<std::string, Dictionary*> DictionaryMap;
 
+  // The outcomes of GetVcdiffDictionary(), for the Sdch.Dictionary lookups
+  // histogram.
+  enum DictionaryLookup {
+    DICTIONARY_LOOKUP_FOUND,
+    DICTIONARY_LOOKUP_NOT_LOADED_YET,
+    DICTIONARY_LOOKUP_NOT_FOUND,
+    MAX_DICTIONARY_LOOKUP  // Used to bound histogram
+  };
+
+  // How long set_dictionary_store() waits before loading the dictionaries.
+  static const int kMsDelayBeforeLoadingStoredDictionaries = 5000;
+
+  static void RecordDictionaryLookup(DictionaryLookup lookup);
+
+  // Parses the metadata header at the start of |dictionary_text|.  Returns
+  // false if the header is malformed.  Otherwise, sets |*header_end| to the
+  // offset of the blank line that ends the header, and the other arguments to
+  // the values of the corresponding headers.  |*expiration| is left null if
+  // there is no Max-Age header.
+  static bool ParseDictionaryHeader(const std::string& dictionary_text,
+                                    size_t* header_end, std::string* domain,
+                                    std::string* path, std::set<int>* ports,
+                                    Time* expiration);
+
+  // Writes |dictionary|, whose full text (including the header) is
+  // |dictionary_text|, to the dictionary store.
+  void StoreDictionary(const std::string& server_hash,
+                       const std::string& dictionary_text,
+                       const Dictionary& dictionary);
+
+  // Reads the metadata of the dictionary in |entry| and returns a dictionary
+  // without text for it, or NULL if the entry is unusable or expired.
+  static Dictionary* ReadStoredDictionary(disk_cache::Entry* entry);
+
+  // Reads the text of the stored dictionary for |server_hash| into
+  // |dictionary|.  Returns false if it is missing or doesn't match the hash.
+  bool LoadDictionaryText(const std::string& server_hash,
+                          Dictionary* dictionary);
+
   // The one global instance of that holds all the data.
   static SdchManager* global_;
 
@@ -242,6 +311,12 @@ class SdchManager {
   // An instance that can fetch a dictionary given a URL.
   scoped_ptr<SdchFetcher> fetcher_;
 
+  // Where dictionaries are saved, if anywhere.  Not owned.
+  disk_cache::Backend* dictionary_store_;
+
+  // Posts the delayed LoadStoredDictionaries() call.
+  ScopedRunnableMethodFactory<SdchManager> method_factory_;
+
   // Support SDCH compression, by advertising in headers.
   bool sdch_enabled_;
 
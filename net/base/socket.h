@@ -12,6 +12,12 @@ namespace net {
 // Represents a read/write socket.
 class Socket {
  public:
+  // One of the buffers handed to WriteV.
+  struct WriteBuffer {
+    const char* data;
+    int len;
+  };
+
   virtual ~Socket() {}
 
   // Reads data, up to buf_len bytes, from the socket.  The number of bytes
@@ -29,6 +35,16 @@ class Socket {
   // passed to the callback when available.
   virtual int Write(const char* buf, int buf_len,
                     CompletionCallback* callback) = 0;
+
+  // Writes data from |buf_count| buffers, in order, as though they were one
+  // buffer.  Returns just like Write, and likewise may write only part of the
+  // data.  The data must stay valid until the write completes, but |bufs|
+  // itself need not.  Sockets that can hand several buffers to the OS at once
+  // override this; by default only the first buffer is written.
+  virtual int WriteV(const WriteBuffer* bufs, int buf_count,
+                     CompletionCallback* callback) {
+    return Write(bufs[0].data, bufs[0].len, callback);
+  }
 };
 
 }  // namespace net
@@ -13,14 +13,21 @@
 #include <pk11pub.h>
 #undef Lock
 
+#include "base/histogram.h"
+#include "base/lock.h"
 #include "base/logging.h"
 #include "base/nss_init.h"
+#include "base/singleton.h"
 #include "base/string_util.h"
 #include "net/base/net_errors.h"
 #include "net/base/ssl_info.h"
+#include "net/base/ssl_session_cache.h"
 
 static const int kRecvBufferSize = 4096;
 
+// The number of servers whose SSL sessions we may resume.
+static const size_t kMaxSessionCacheEntries = 100;
+
 /*
  * nss calls this if an incoming certificate is invalid.
  * TODO(port): expose to app via GetSSLInfo so it can put up 
@@ -38,6 +45,40 @@ ownBadCertHandler(void * arg, PRFileDesc * socket)
 
 namespace net {
 
+namespace {
+
+// The SSLSessionCache shared by all the sockets of the process.  Sockets may
+// live on different threads, so access to the cache is serialized.
+class SharedSessionCache {
+ public:
+  SharedSessionCache() : cache_(kMaxSessionCacheEntries) {}
+
+  static SharedSessionCache* GetInstance() {
+    return Singleton<SharedSessionCache>::get();
+  }
+
+  std::string GetPeerID(const std::string& host, int port) {
+    AutoLock locked(lock_);
+    return cache_.GetPeerID(host, port, TimeTicks::Now());
+  }
+
+  bool OnHandshakeComplete(const std::string& host, int port,
+                           const std::string& session_id,
+                           const TimeDelta& lifetime) {
+    AutoLock locked(lock_);
+    return cache_.OnHandshakeComplete(host, port, session_id, lifetime,
+                                      TimeTicks::Now());
+  }
+
+ private:
+  Lock lock_;
+  SSLSessionCache cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedSessionCache);
+};
+
+}  // namespace
+
 bool SSLClientSocketNSS::nss_options_initialized_ = false;
 
 SSLClientSocketNSS::SSLClientSocketNSS(ClientSocket* transport_socket,
@@ -52,6 +93,8 @@ SSLClientSocketNSS::SSLClientSocketNSS(ClientSocket* transport_socket,
       transport_(transport_socket),
       hostname_(hostname),
       ssl_config_(ssl_config),
+      peer_port_(0),
+      session_resumed_(false),
       user_callback_(NULL),
       user_buf_(NULL),
       user_buf_len_(0),
@@ -96,6 +139,7 @@ void SSLClientSocketNSS::Disconnect() {
     nss_fd_ = NULL;
   }
   completed_handshake_ = false;
+  session_resumed_ = false;
   transport_->Disconnect();
 }
 
@@ -298,6 +342,7 @@ int SSLClientSocketNSS::DoConnectComplete(int result) {
     return 9999;  // TODO(port): real error
   }
   memio_SetPeerName(nss_fd_, &peername);
+  peer_port_ = PR_ntohs(PR_NetAddrInetPort(&peername));
 
   // Grab pointer to buffers 
   nss_bufs_ = memio_GetSecret(nss_fd_);
@@ -336,6 +381,22 @@ int SSLClientSocketNSS::DoConnectComplete(int result) {
   if (rv != SECSuccess)
      return ERR_UNEXPECTED;
 
+  // NSS keeps the sessions itself, but it only offers one to the server if
+  // it was established under the same peer ID, which lets the shared cache
+  // decide how long and for how many servers sessions are resumed.
+  bool caching = ssl_config_.session_cache_timeout > TimeDelta();
+  rv = SSL_OptionSet(nss_fd_, SSL_NO_CACHE, !caching);
+  if (rv != SECSuccess)
+     return ERR_UNEXPECTED;
+
+  if (caching) {
+    std::string peer_id =
+        SharedSessionCache::GetInstance()->GetPeerID(hostname_, peer_port_);
+    rv = SSL_SetSockPeerID(nss_fd_, const_cast<char*>(peer_id.c_str()));
+    if (rv != SECSuccess)
+       return ERR_UNEXPECTED;
+  }
+
   // Tell SSL the hostname we're trying to connect to.
   SSL_SetURL(nss_fd_, hostname_.c_str());
 
@@ -351,6 +412,7 @@ int SSLClientSocketNSS::DoHandshakeRead() {
   if (rv == SECSuccess) {
     // there's a callback for this, too
     completed_handshake_ = true;
+    OnHandshakeComplete();
     // Indicate we're ready to handle I/O.  Badly named?
     next_state_ = STATE_NONE;
     return OK;
@@ -365,6 +427,23 @@ int SSLClientSocketNSS::DoHandshakeRead() {
   return ERR_SSL_PROTOCOL_ERROR;
 }
     
+void SSLClientSocketNSS::OnHandshakeComplete() {
+  SSLChannelInfo info;
+  std::string session_id;
+  if (SSL_GetChannelInfo(nss_fd_, &info, sizeof(info)) == SECSuccess) {
+    session_id.assign(reinterpret_cast<const char*>(info.sessionID),
+                      info.sessionIDLength);
+  }
+
+  session_resumed_ = SharedSessionCache::GetInstance()->OnHandshakeComplete(
+      hostname_, peer_port_, session_id, ssl_config_.session_cache_timeout);
+
+  // Track how often we get away with an abbreviated handshake.
+  static LinearHistogram histogram(L"Net.SSL_SessionResumed", 1, 2, 3);
+  histogram.SetFlags(kUmaTargetedHistogramFlag);
+  histogram.Add(session_resumed_ ? 1 : 0);
+}
+
 int SSLClientSocketNSS::DoPayloadRead() {
   int rv = PR_Read(nss_fd_, user_buf_, user_buf_len_);
   if (rv >= 0)
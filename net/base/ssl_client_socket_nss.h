@@ -44,6 +44,10 @@ class SSLClientSocketNSS : public SSLClientSocket {
   virtual int Read(char* buf, int buf_len, CompletionCallback* callback);
   virtual int Write(const char* buf, int buf_len, CompletionCallback* callback);
 
+  // True if the last handshake resumed a cached SSL session instead of
+  // negotiating a new one.
+  bool session_resumed() const { return session_resumed_; }
+
  private:
   void DoCallback(int result);
   void OnIOComplete(int result);
@@ -54,6 +58,7 @@ class SSLClientSocketNSS : public SSLClientSocket {
   int DoHandshakeRead();
   int DoPayloadRead();
   int DoPayloadWrite();
+  void OnHandshakeComplete();
   int Init();
   int BufferSend(void);
   int BufferRecv(void);
@@ -70,6 +75,11 @@ class SSLClientSocketNSS : public SSLClientSocket {
   std::string hostname_;
   SSLConfig ssl_config_;
 
+  // The port of the server, which is part of the session cache key.
+  int peer_port_;
+
+  bool session_resumed_;
+
   CompletionCallback* user_callback_;
 
   // Used by both Read and Write functions.
@@ -2,13 +2,21 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "base/file_util.h"
+#include "base/path_service.h"
 #include "base/platform_test.h"
+#include "base/platform_thread.h"
+#include "base/process_util.h"
+#include "base/string_util.h"
 #include "net/base/address_list.h"
 #include "net/base/client_socket_factory.h"
 #include "net/base/host_resolver.h"
 #include "net/base/net_errors.h"
 #include "net/base/scoped_host_mapper.h"
 #include "net/base/ssl_client_socket.h"
+#if defined(OS_LINUX)
+#include "net/base/ssl_client_socket_nss.h"
+#endif
 #include "net/base/ssl_config_service.h"
 #include "net/base/tcp_client_socket.h"
 #include "net/base/test_completion_callback.h"
@@ -200,3 +208,143 @@ TEST_F(SSLClientSocketTest, DISABLED_Read_Interrupted) {
   EXPECT_NE(rv, 0);
 }
 
+#if defined(OS_LINUX)
+
+// Runs net/tools/testserver/testserver.py as an https server on |kPort|.
+// The server is built on tlslite, which resumes the sessions it has cached.
+class TLSLiteTestServer {
+ public:
+  static const int kPort = 9443;
+
+  TLSLiteTestServer() : process_handle_(0) {
+  }
+
+  ~TLSLiteTestServer() {
+    if (process_handle_)
+      process_util::KillProcess(process_handle_, 1, true);
+  }
+
+  // Starts the server and waits until it accepts connections.
+  bool Start() {
+    std::wstring source_root;
+    if (!PathService::Get(base::DIR_SOURCE_ROOT, &source_root))
+      return false;
+
+    std::wstring tlslite_path(source_root);
+    file_util::AppendToPath(&tlslite_path, L"third_party");
+    file_util::AppendToPath(&tlslite_path, L"tlslite");
+    setenv("PYTHONPATH", WideToUTF8(tlslite_path).c_str(), 1);
+
+    std::wstring testserver_path(source_root);
+    file_util::AppendToPath(&testserver_path, L"net");
+    file_util::AppendToPath(&testserver_path, L"tools");
+    file_util::AppendToPath(&testserver_path, L"testserver");
+    file_util::AppendToPath(&testserver_path, L"testserver.py");
+
+    std::wstring cert_path(source_root);
+    file_util::AppendToPath(&cert_path, L"net");
+    file_util::AppendToPath(&cert_path, L"data");
+    file_util::AppendToPath(&cert_path, L"ssl_client_socket_unittest");
+    file_util::AppendToPath(&cert_path, L"tlslite_cert.pem");
+
+    std::vector<std::string> argv;
+    argv.push_back("/usr/bin/python");
+    argv.push_back(WideToUTF8(testserver_path));
+    argv.push_back("--port=" + IntToString(kPort));
+    argv.push_back("--https=" + WideToUTF8(cert_path));
+    if (!process_util::LaunchApp(argv, false, &process_handle_))
+      return false;
+
+    // Give the server some time to start listening.
+    net::AddressList addr;
+    net::HostResolver resolver;
+    if (resolver.Resolve("127.0.0.1", kPort, &addr, NULL) != net::OK)
+      return false;
+    for (int retries = 0; retries < 50; ++retries) {
+      TestCompletionCallback callback;
+      net::TCPClientSocket sock(addr);
+      int rv = sock.Connect(&callback);
+      if (rv == net::ERR_IO_PENDING)
+        rv = callback.WaitForResult();
+      if (rv == net::OK)
+        return true;
+      PlatformThread::Sleep(100);
+    }
+    return false;
+  }
+
+ private:
+  ProcessHandle process_handle_;
+
+  DISALLOW_COPY_AND_ASSIGN(TLSLiteTestServer);
+};
+
+// Connects to |hostname|, fetches "/" and returns whether the handshake
+// resumed a session.
+static bool FetchAndCheckResumed(const std::string& hostname,
+                                 const net::AddressList& addr) {
+  TestCompletionCallback callback;
+  net::SSLClientSocketNSS sock(new net::TCPClientSocket(addr), hostname,
+                               kDefaultSSLConfig);
+
+  int rv = sock.Connect(&callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = callback.WaitForResult();
+  EXPECT_EQ(net::OK, rv);
+  EXPECT_TRUE(sock.IsConnected());
+
+  const char request_text[] = "GET / HTTP/1.0\r\n\r\n";
+  rv = sock.Write(request_text, arraysize(request_text) - 1, &callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = callback.WaitForResult();
+  EXPECT_EQ(static_cast<int>(arraysize(request_text) - 1), rv);
+
+  // Read the whole response, so the server shuts the connection down
+  // cleanly and keeps the session resumable.
+  char buf[4096];
+  for (;;) {
+    rv = sock.Read(buf, sizeof(buf), &callback);
+    if (rv == net::ERR_IO_PENDING)
+      rv = callback.WaitForResult();
+    if (rv <= 0)
+      break;
+  }
+
+  bool resumed = sock.session_resumed();
+  sock.Disconnect();
+  return resumed;
+}
+
+TEST_F(SSLClientSocketTest, SessionResumption) {
+  TLSLiteTestServer server;
+  ASSERT_TRUE(server.Start());
+
+  net::AddressList addr;
+  net::HostResolver resolver;
+  int rv = resolver.Resolve("127.0.0.1", TLSLiteTestServer::kPort, &addr,
+                            NULL);
+  ASSERT_EQ(net::OK, rv);
+
+  // The first connection negotiates a new session, which the next ones
+  // resume.
+  EXPECT_FALSE(FetchAndCheckResumed("127.0.0.1", addr));
+  EXPECT_TRUE(FetchAndCheckResumed("127.0.0.1", addr));
+  EXPECT_TRUE(FetchAndCheckResumed("127.0.0.1", addr));
+
+  // A configuration that disables session caching always gets a full
+  // handshake.
+  net::SSLConfig no_cache_config;
+  no_cache_config.session_cache_timeout = TimeDelta();
+  for (int i = 0; i < 2; ++i) {
+    TestCompletionCallback callback;
+    net::SSLClientSocketNSS sock(new net::TCPClientSocket(addr), "127.0.0.1",
+                                 no_cache_config);
+    rv = sock.Connect(&callback);
+    if (rv == net::ERR_IO_PENDING)
+      rv = callback.WaitForResult();
+    EXPECT_EQ(net::OK, rv);
+    EXPECT_FALSE(sock.session_resumed());
+  }
+}
+
+#endif  // defined(OS_LINUX)
@@ -17,6 +17,12 @@ static const wchar_t kRevocationValueName[] = L"CertificateRevocation";
 
 static const wchar_t kProtocolsValueName[] = L"SecureProtocols";
 
+static const wchar_t kSChannelSubKeyName[] =
+    L"System\\CurrentControlSet\\Control\\SecurityProviders\\SCHANNEL";
+
+// How long, in milliseconds, SChannel keeps client sessions around.
+static const wchar_t kClientCacheTimeValueName[] = L"ClientCacheTime";
+
 // In SecureProtocols, each SSL version is represented by a bit:
 //   SSL 2.0: 0x08
 //   SSL 3.0: 0x20
@@ -71,6 +77,15 @@ bool SSLConfigService::GetSSLConfigNow(SSLConfig* config) {
   config->ssl3_enabled = ((protocols & SSL3) != 0);
   config->tls1_enabled = ((protocols & TLS1) != 0);
 
+  // Resume sessions for as long as SChannel does.  The value is optional.
+  RegKey schannel;
+  DWORD cache_time;
+  if (schannel.Open(HKEY_LOCAL_MACHINE, kSChannelSubKeyName, KEY_READ) &&
+      schannel.ReadValueDW(kClientCacheTimeValueName, &cache_time)) {
+    config->session_cache_timeout =
+        TimeDelta::FromMilliseconds(static_cast<int64>(cache_time));
+  }
+
   return true;
 }
 
@@ -13,9 +13,11 @@ namespace net {
 struct SSLConfig {
   // Default to no revocation checking.
   // Default to SSL 2.0 off, SSL 3.0 on, and TLS 1.0 on.
+  // Default to resuming SSL sessions for 10 hours, like SChannel.
   SSLConfig()
       : rev_checking_enabled(false), ssl2_enabled(false),
-        ssl3_enabled(true), tls1_enabled(true) {
+        ssl3_enabled(true), tls1_enabled(true),
+        session_cache_timeout(TimeDelta::FromHours(10)) {
   }
 
   bool rev_checking_enabled;  // True if server certificate revocation
@@ -23,6 +25,8 @@ struct SSLConfig {
   bool ssl2_enabled;  // True if SSL 2.0 is enabled.
   bool ssl3_enabled;  // True if SSL 3.0 is enabled.
   bool tls1_enabled;  // True if TLS 1.0 is enabled.
+  TimeDelta session_cache_timeout;  // How long an SSL session may be
+                                    // resumed.  Zero disables resumption.
 };
 
 // This class is responsible for getting and setting the SSL configuration.
@@ -19,6 +19,7 @@ TEST(SSLConfigServiceTest, GetNowTest) {
   EXPECT_EQ(false, config.ssl2_enabled);
   EXPECT_EQ(true, config.ssl3_enabled);
   EXPECT_EQ(true, config.tls1_enabled);
+  EXPECT_EQ(10, config.session_cache_timeout.InHours());
 
   bool rv = net::SSLConfigService::GetSSLConfigNow(&config);
   EXPECT_TRUE(rv);
@@ -0,0 +1,111 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/ssl_session_cache.h"
+
+#include "base/logging.h"
+#include "base/string_util.h"
+
+namespace {
+
+std::string GetKey(const std::string& host, int port) {
+  return host + ":" + IntToString(port);
+}
+
+}  // namespace
+
+namespace net {
+
+SSLSessionCache::SSLSessionCache(size_t max_entries)
+    : max_entries_(max_entries),
+      next_generation_(0) {
+}
+
+SSLSessionCache::~SSLSessionCache() {
+}
+
+std::string SSLSessionCache::GetPeerID(const std::string& host, int port,
+                                       const TimeTicks& now) {
+  std::string key = GetKey(host, port);
+  int64 generation;
+  if (max_entries_ == 0) {
+    // Nothing is remembered, so never hand out the same peer ID twice.
+    generation = next_generation_++;
+  } else {
+    generation = FindOrCreateEntry(key, now)->generation;
+  }
+  return key + "#" + Int64ToString(generation);
+}
+
+bool SSLSessionCache::OnHandshakeComplete(const std::string& host, int port,
+                                          const std::string& session_id,
+                                          const TimeDelta& lifetime,
+                                          const TimeTicks& now) {
+  std::string key = GetKey(host, port);
+  if (max_entries_ == 0 || lifetime <= TimeDelta() || session_id.empty()) {
+    // Don't let a later connection resume a session we can't keep track of.
+    entries_.erase(key);
+    return false;
+  }
+
+  Entry* entry = FindOrCreateEntry(key, now);
+  if (!entry->session_id.empty() && entry->session_id == session_id)
+    return true;
+
+  entry->session_id = session_id;
+  entry->expiration = now + lifetime;
+  return false;
+}
+
+void SSLSessionCache::Clear() {
+  entries_.clear();
+}
+
+SSLSessionCache::Entry* SSLSessionCache::FindOrCreateEntry(
+    const std::string& key,
+    const TimeTicks& now) {
+  EntryMap::iterator it = entries_.find(key);
+  if (it != entries_.end()) {
+    Entry& entry = it->second;
+    if (entry.session_id.empty() || entry.expiration > now)
+      return &entry;
+    // The session has expired, so the server gets a new peer ID.
+    entry.generation = next_generation_++;
+    entry.session_id.clear();
+    return &entry;
+  }
+
+  if (entries_.size() >= max_entries_)
+    Compact(now);
+  Entry& entry = entries_[key];
+  entry.generation = next_generation_++;
+  return &entry;
+}
+
+void SSLSessionCache::Compact(const TimeTicks& now) {
+  // Drop the entries without a session that may still be resumed.
+  EntryMap::iterator it = entries_.begin();
+  while (it != entries_.end()) {
+    if (it->second.session_id.empty() || it->second.expiration <= now) {
+      entries_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+
+  if (entries_.size() < max_entries_)
+    return;
+
+  // Every session may still be resumed, so evict the one which would have
+  // expired first.
+  EntryMap::iterator oldest = entries_.begin();
+  for (it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->second.expiration < oldest->second.expiration)
+      oldest = it;
+  }
+  DCHECK(oldest != entries_.end());
+  entries_.erase(oldest);
+}
+
+}  // namespace net
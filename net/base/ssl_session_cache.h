@@ -0,0 +1,88 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_BASE_SSL_SESSION_CACHE_H_
+#define NET_BASE_SSL_SESSION_CACHE_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/hash_tables.h"
+#include "base/time.h"
+
+namespace net {
+
+// Keeps track of the SSL sessions that the client may resume, keyed by the
+// "host:port" of the server.  The session state itself is kept by the SSL
+// library; this cache decides which session a new connection may offer, by
+// handing out the peer ID under which the library looks the session up.
+// Dropping an entry (because it has expired or the cache is full) gives the
+// server a new peer ID, so its old session is never offered again.
+//
+// This class is not thread-safe; the caller must serialize access to it.
+class SSLSessionCache {
+ public:
+  // Creates a cache that remembers the sessions of at most |max_entries|
+  // servers.
+  explicit SSLSessionCache(size_t max_entries);
+  ~SSLSessionCache();
+
+  // Returns the peer ID to use for a connection to |host|:|port| as of |now|.
+  // Connections that get the same peer ID may resume each other's sessions.
+  std::string GetPeerID(const std::string& host, int port,
+                        const TimeTicks& now);
+
+  // Records that the handshake of a connection to |host|:|port| completed
+  // with |session_id|.  Returns true if the handshake resumed the session
+  // that is cached for the server.  Otherwise the new session is cached for
+  // |lifetime|; a zero |lifetime| disables resumption for the server.
+  bool OnHandshakeComplete(const std::string& host, int port,
+                           const std::string& session_id,
+                           const TimeDelta& lifetime,
+                           const TimeTicks& now);
+
+  // Drops every entry, so no session is resumed after this call.
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+  size_t max_entries() const { return max_entries_; }
+
+ private:
+  struct Entry {
+    Entry() : generation(0) {}
+
+    // Distinguishes this entry from any earlier entry for the same server.
+    int64 generation;
+
+    // The ID of the cached session, empty if there is none yet.
+    std::string session_id;
+
+    // The time at which the session stops being resumable.  Only valid when
+    // |session_id| is not empty.
+    TimeTicks expiration;
+  };
+
+  typedef base::hash_map<std::string, Entry> EntryMap;
+
+  // Returns the entry for |key|, creating it if needed.  An entry whose
+  // session has expired as of |now| is replaced by a new one.
+  Entry* FindOrCreateEntry(const std::string& key, const TimeTicks& now);
+
+  // Makes room for one more entry, assuming the cache is full.
+  void Compact(const TimeTicks& now);
+
+  const size_t max_entries_;
+
+  // The generation of the next entry.  It only grows, so a peer ID is never
+  // handed out again once its entry has been dropped.
+  int64 next_generation_;
+
+  EntryMap entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(SSLSessionCache);
+};
+
+}  // namespace net
+
+#endif  // NET_BASE_SSL_SESSION_CACHE_H_
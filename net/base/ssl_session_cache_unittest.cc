@@ -0,0 +1,123 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/ssl_session_cache.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kMaxCacheEntries = 3;
+const int kSessionLifetimeSeconds = 60;
+
+class SSLSessionCacheTest : public testing::Test {
+ protected:
+  SSLSessionCacheTest()
+      : cache_(kMaxCacheEntries),
+        lifetime_(TimeDelta::FromSeconds(kSessionLifetimeSeconds)) {
+  }
+
+  net::SSLSessionCache cache_;
+  TimeDelta lifetime_;
+};
+
+}  // namespace
+
+TEST_F(SSLSessionCacheTest, Basic) {
+  TimeTicks now = TimeTicks::Now();
+
+  std::string peer_id = cache_.GetPeerID("foobar.com", 443, now);
+  EXPECT_EQ(peer_id, cache_.GetPeerID("foobar.com", 443, now));
+  EXPECT_EQ(1U, cache_.size());
+
+  // The port is part of the key.
+  EXPECT_NE(peer_id, cache_.GetPeerID("foobar.com", 8443, now));
+  EXPECT_NE(peer_id, cache_.GetPeerID("other.com", 443, now));
+  EXPECT_EQ(3U, cache_.size());
+
+  // The first handshake is a full one, the next one resumes its session.
+  EXPECT_FALSE(cache_.OnHandshakeComplete("foobar.com", 443, "session1",
+                                          lifetime_, now));
+  EXPECT_EQ(peer_id, cache_.GetPeerID("foobar.com", 443, now));
+  EXPECT_TRUE(cache_.OnHandshakeComplete("foobar.com", 443, "session1",
+                                         lifetime_, now));
+
+  // The server may refuse to resume the session.
+  EXPECT_FALSE(cache_.OnHandshakeComplete("foobar.com", 443, "session2",
+                                          lifetime_, now));
+  EXPECT_TRUE(cache_.OnHandshakeComplete("foobar.com", 443, "session2",
+                                         lifetime_, now));
+
+  cache_.Clear();
+  EXPECT_EQ(0U, cache_.size());
+  EXPECT_NE(peer_id, cache_.GetPeerID("foobar.com", 443, now));
+}
+
+TEST_F(SSLSessionCacheTest, Expiration) {
+  TimeTicks now = TimeTicks::Now();
+
+  std::string peer_id = cache_.GetPeerID("foobar.com", 443, now);
+  EXPECT_FALSE(cache_.OnHandshakeComplete("foobar.com", 443, "session1",
+                                          lifetime_, now));
+
+  now += TimeDelta::FromSeconds(kSessionLifetimeSeconds - 1);
+  EXPECT_EQ(peer_id, cache_.GetPeerID("foobar.com", 443, now));
+
+  // Resuming the session doesn't extend its lifetime.
+  EXPECT_TRUE(cache_.OnHandshakeComplete("foobar.com", 443, "session1",
+                                         lifetime_, now));
+
+  // Once the session expires, the server gets a new peer ID so the old
+  // session is not offered again.
+  now += TimeDelta::FromSeconds(1);
+  std::string new_peer_id = cache_.GetPeerID("foobar.com", 443, now);
+  EXPECT_NE(peer_id, new_peer_id);
+  EXPECT_EQ(new_peer_id, cache_.GetPeerID("foobar.com", 443, now));
+  EXPECT_EQ(1U, cache_.size());
+}
+
+TEST_F(SSLSessionCacheTest, Eviction) {
+  TimeTicks now = TimeTicks::Now();
+
+  std::string peer_id1 = cache_.GetPeerID("host1.com", 443, now);
+  cache_.OnHandshakeComplete("host1.com", 443, "session1", lifetime_, now);
+  now += TimeDelta::FromSeconds(1);
+  std::string peer_id2 = cache_.GetPeerID("host2.com", 443, now);
+  cache_.OnHandshakeComplete("host2.com", 443, "session2", lifetime_, now);
+  now += TimeDelta::FromSeconds(1);
+  std::string peer_id3 = cache_.GetPeerID("host3.com", 443, now);
+  cache_.OnHandshakeComplete("host3.com", 443, "session3", lifetime_, now);
+  EXPECT_EQ(3U, cache_.size());
+
+  // The cache is full, so the session closest to expiring is dropped.
+  cache_.GetPeerID("host4.com", 443, now);
+  EXPECT_EQ(3U, cache_.size());
+  EXPECT_NE(peer_id1, cache_.GetPeerID("host1.com", 443, now));
+  EXPECT_EQ(3U, cache_.size());
+
+  // host4.com had no session yet, so it made room for host1.com.
+  EXPECT_EQ(peer_id2, cache_.GetPeerID("host2.com", 443, now));
+  EXPECT_EQ(peer_id3, cache_.GetPeerID("host3.com", 443, now));
+}
+
+TEST_F(SSLSessionCacheTest, DisabledCaching) {
+  TimeTicks now = TimeTicks::Now();
+
+  // A zero lifetime keeps the session from being resumed.
+  std::string peer_id = cache_.GetPeerID("foobar.com", 443, now);
+  EXPECT_FALSE(cache_.OnHandshakeComplete("foobar.com", 443, "session1",
+                                          TimeDelta(), now));
+  EXPECT_EQ(0U, cache_.size());
+  EXPECT_NE(peer_id, cache_.GetPeerID("foobar.com", 443, now));
+
+  // So does a cache that holds no entries.
+  net::SSLSessionCache empty_cache(0);
+  peer_id = empty_cache.GetPeerID("foobar.com", 443, now);
+  EXPECT_NE(peer_id, empty_cache.GetPeerID("foobar.com", 443, now));
+  EXPECT_FALSE(empty_cache.OnHandshakeComplete("foobar.com", 443, "session1",
+                                               lifetime_, now));
+  EXPECT_FALSE(empty_cache.OnHandshakeComplete("foobar.com", 443, "session1",
+                                               lifetime_, now));
+  EXPECT_EQ(0U, empty_cache.size());
+}
@@ -183,18 +183,30 @@ int TCPClientSocket::Read(char* buf,
 int TCPClientSocket::Write(const char* buf,
                            int buf_len,
                            CompletionCallback* callback) {
+  WriteBuffer write_buf = { buf, buf_len };
+  return WriteV(&write_buf, 1, callback);
+}
+
+int TCPClientSocket::WriteV(const WriteBuffer* bufs,
+                            int buf_count,
+                            CompletionCallback* callback) {
   DCHECK(socket_ != INVALID_SOCKET);
   DCHECK(wait_state_ == NOT_WAITING);
   DCHECK(!callback_);
+  DCHECK(buf_count > 0);
 
-  buffer_.len = buf_len;
-  buffer_.buf = const_cast<char*>(buf);
+  write_buffers_.resize(buf_count);
+  for (int i = 0; i < buf_count; ++i) {
+    write_buffers_[i].len = bufs[i].len;
+    write_buffers_[i].buf = const_cast<char*>(bufs[i].data);
+  }
 
   TRACE_EVENT_BEGIN("socket.write", this, "");
   // TODO(wtc): Remove the CHECKs after enough testing.
   CHECK(WaitForSingleObject(overlapped_.hEvent, 0) == WAIT_TIMEOUT);
   DWORD num;
-  int rv = WSASend(socket_, &buffer_, 1, &num, 0, &overlapped_, NULL);
+  int rv = WSASend(socket_, &write_buffers_[0], buf_count, &num, 0,
+                   &overlapped_, NULL);
   if (rv == 0) {
     CHECK(WaitForSingleObject(overlapped_.hEvent, 0) == WAIT_OBJECT_0);
     BOOL ok = WSAResetEvent(overlapped_.hEvent);
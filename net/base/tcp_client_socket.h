@@ -7,17 +7,22 @@
 
 #include "build/build_config.h"
 
+#include <vector>
+
 #if defined(OS_WIN)
 #include <ws2tcpip.h>
 #include "base/object_watcher.h"
 #elif defined(OS_POSIX)
 struct event;  // From libevent
 #include <sys/socket.h>  // for struct sockaddr
+#include <sys/uio.h>  // for struct iovec
 #define SOCKET int
 #include "base/message_pump_libevent.h"
 #endif
 
 #include "base/scoped_ptr.h"
+#include "base/time.h"
+#include "base/timer.h"
 #include "net/base/address_list.h"
 #include "net/base/client_socket.h"
 #include "net/base/completion_callback.h"
@@ -30,6 +35,13 @@ namespace net {
 // Read and Write calls must not be in progress at the same time.
 // The libevent implementation supports full duplex because that
 // made it slightly easier to implement ssl.
+//
+// The windows implementation tries the addresses one after another.  The
+// libevent implementation races them: it starts connecting to the next
+// address whenever the attempts in progress have gone a stagger delay without
+// connecting, uses the first connection to be established, and closes the
+// others.  An address that doesn't answer then holds things up only for the
+// stagger delay rather than until the OS gives up on it.
 class TCPClientSocket : public ClientSocket,
 #if defined(OS_WIN)
                         public base::ObjectWatcher::Delegate
@@ -58,11 +70,20 @@ class TCPClientSocket : public ClientSocket,
   // of SSLClientSocket)
   virtual int Read(char* buf, int buf_len, CompletionCallback* callback);
   virtual int Write(const char* buf, int buf_len, CompletionCallback* callback);
+  virtual int WriteV(const WriteBuffer* bufs, int buf_count,
+                     CompletionCallback* callback);
 
 #if defined(OS_POSIX)
   // Identical to posix system call of same name
   // Needed by ssl_client_socket_nss
   virtual int GetPeerName(struct sockaddr *name, socklen_t *namelen);
+
+  // Sets how long Connect waits on the attempts in progress before it starts
+  // connecting to the next address as well, for all TCPClientSockets.
+  static void SetConnectStaggerDelay(const TimeDelta& delay);
+  static TimeDelta connect_stagger_delay() {
+    return TimeDelta::FromMilliseconds(connect_stagger_delay_ms_);
+  }
 #endif
 
  private:
@@ -89,13 +110,49 @@ class TCPClientSocket : public ClientSocket,
   OVERLAPPED overlapped_;
   WSABUF buffer_;
 
+  // The buffers of the write in progress, which WSASend may use until it
+  // completes.
+  std::vector<WSABUF> write_buffers_;
+
   base::ObjectWatcher watcher_;
 
   void DidCompleteIO();
 #elif defined(OS_POSIX)
+  // A connect() in progress to one of our addresses, on a socket of its own.
+  class ConnectAttempt;
+
+  // Starts connecting to the next address in the list, skipping addresses
+  // that fail right away.  Returns OK if one connected without waiting,
+  // ERR_IO_PENDING if any attempt is in progress, or else the last error.
+  int StartNextConnectAttempt();
+
+  // Called by connect_stagger_timer_ when the attempts in progress have taken
+  // too long.
+  void OnConnectStaggerTimer();
+
+  // Called by |attempt| when its connect() has finished, one way or another.
+  void DidCompleteConnectAttempt(ConnectAttempt* attempt);
+
+  // Closes the attempts in progress and records how the connect went.
+  // Returns |result|.
+  int DidFinishConnect(int result);
+
   // Whether we're currently waiting for connect() to complete
   bool waiting_connect_;
 
+  // The attempts in progress, in the order they were started.
+  std::vector<ConnectAttempt*> connect_attempts_;
+  base::OneShotTimer<TCPClientSocket> connect_stagger_timer_;
+
+  // The error from the last attempt to fail.
+  int last_connect_error_;
+
+  // When Connect was called, and how many addresses it has tried since.
+  TimeTicks connect_start_time_;
+  int connect_attempt_count_;
+
+  static int64 connect_stagger_delay_ms_;
+
   // The socket's libevent wrapper
   scoped_ptr<event> event_;
 
@@ -106,9 +163,8 @@ class TCPClientSocket : public ClientSocket,
   char* buf_;
   int buf_len_;
 
-  // The buffer used by OnSocketReady to retry Write requests
-  const char* write_buf_;
-  int write_buf_len_;
+  // The buffers used by OnSocketReady to retry Write requests
+  std::vector<struct iovec> write_iov_;
 
   // External callback; called when write is complete.
   CompletionCallback* write_callback_;
@@ -121,9 +177,13 @@ class TCPClientSocket : public ClientSocket,
   // External callback; called when read (and on Windows, write) is complete.
   CompletionCallback* callback_;
 
-  int CreateSocket(const struct addrinfo* ai);
   void DoCallback(int rv);
+#if defined(OS_WIN)
+  int CreateSocket(const struct addrinfo* ai);
   void DidCompleteConnect();
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(TCPClientSocket);
 };
 
 }  // namespace net
@@ -6,9 +6,14 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
+#include <algorithm>
+
+#include "base/histogram.h"
 #include "base/message_loop.h"
 #include "net/base/net_errors.h"
 #include "third_party/libevent/event.h"
@@ -61,13 +66,84 @@ static int MapPosixError(int err) {
   }
 }
 
+// Return the socket for a new connection to |ai|, or kInvalidSocket.
+static int CreateSocket(const addrinfo* ai) {
+  int s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (s == kInvalidSocket)
+    return kInvalidSocket;
+
+  // All our socket I/O is nonblocking
+  if (SetNonBlocking(s)) {
+    int err = errno;
+    close(s);
+    errno = err;
+    return kInvalidSocket;
+  }
+
+  return s;
+}
+
+//-----------------------------------------------------------------------------
+
+class TCPClientSocket::ConnectAttempt
+    : public base::MessagePumpLibevent::Watcher {
+ public:
+  ConnectAttempt(TCPClientSocket* owner, int socket)
+      : owner_(owner),
+        socket_(socket),
+        event_(new event) {
+    // POLLOUT is set if the connection is established.
+    // POLLIN is set if the connection fails,
+    // so select for both read and write.
+    MessageLoopForIO::current()->WatchSocket(
+       socket_, EV_READ|EV_WRITE|EV_PERSIST, event_.get(), this);
+  }
+
+  ~ConnectAttempt() {
+    if (socket_ != kInvalidSocket) {
+      MessageLoopForIO::current()->UnwatchSocket(event_.get());
+      close(socket_);
+    }
+  }
+
+  int socket() const { return socket_; }
+
+  // Stops watching the socket, and hands it over to the caller along with its
+  // libevent wrapper, which is swapped into |e|.
+  int ReleaseSocket(scoped_ptr<event>* e) {
+    MessageLoopForIO::current()->UnwatchSocket(event_.get());
+    event_.swap(*e);
+    int s = socket_;
+    socket_ = kInvalidSocket;
+    return s;
+  }
+
+  // base::MessagePumpLibevent::Watcher methods:
+  virtual void OnSocketReady(short flags) {
+    owner_->DidCompleteConnectAttempt(this);
+  }
+
+ private:
+  TCPClientSocket* owner_;
+  int socket_;
+  scoped_ptr<event> event_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConnectAttempt);
+};
+
 //-----------------------------------------------------------------------------
 
+// About how long a connection to a server that is up takes to be established
+// over a slow link.
+int64 TCPClientSocket::connect_stagger_delay_ms_ = 300;
+
 TCPClientSocket::TCPClientSocket(const AddressList& addresses)
   : socket_(kInvalidSocket),
     addresses_(addresses),
     current_ai_(addresses_.head()),
     waiting_connect_(false),
+    last_connect_error_(OK),
+    connect_attempt_count_(0),
     event_(new event),
     write_callback_(NULL),
     callback_(NULL) {
@@ -77,6 +153,11 @@ TCPClientSocket::~TCPClientSocket() {
   Disconnect();
 }
 
+// static
+void TCPClientSocket::SetConnectStaggerDelay(const TimeDelta& delay) {
+  connect_stagger_delay_ms_ = delay.InMilliseconds();
+}
+
 int TCPClientSocket::Connect(CompletionCallback* callback) {
   // If already connected, then just return OK.
   if (socket_ != kInvalidSocket)
@@ -84,33 +165,18 @@ int TCPClientSocket::Connect(CompletionCallback* callback) {
 
   DCHECK(!waiting_connect_);
 
-  const addrinfo* ai = current_ai_;
-  DCHECK(ai);
+  current_ai_ = addresses_.head();
+  connect_start_time_ = TimeTicks::Now();
+  connect_attempt_count_ = 0;
+  last_connect_error_ = OK;
 
-  int rv = CreateSocket(ai);
-  if (rv != OK)
-    return rv;
-
-  if (!connect(socket_, ai->ai_addr, static_cast<int>(ai->ai_addrlen))) {
-    // Connected without waiting!
-    return OK;
-  }
+  int rv = StartNextConnectAttempt();
+  if (rv != ERR_IO_PENDING)
+    return DidFinishConnect(rv);
 
   // Synchronous operation not supported
   DCHECK(callback);
 
-  if (errno != EINPROGRESS) {
-    DLOG(INFO) << "connect failed: " << errno;
-    return MapPosixError(errno);
-  }
-
-  // Initialize event_ and link it to our MessagePump.
-  // POLLOUT is set if the connection is established.
-  // POLLIN is set if the connection fails,
-  // so select for both read and write.
-  MessageLoopForIO::current()->WatchSocket(
-     socket_, EV_READ|EV_WRITE|EV_PERSIST, event_.get(), this);
-
   waiting_connect_ = true;
   callback_ = callback;
   return ERR_IO_PENDING;
@@ -122,16 +188,22 @@ int TCPClientSocket::ReconnectIgnoringLastError(CompletionCallback* callback) {
 }
 
 void TCPClientSocket::Disconnect() {
+  if (waiting_connect_) {
+    // Give up on the connect in progress.
+    DidFinishConnect(ERR_ABORTED);
+    waiting_connect_ = false;
+    callback_ = NULL;
+  }
+
+  // Reset for next time.
+  current_ai_ = addresses_.head();
+
   if (socket_ == kInvalidSocket)
     return;
 
   MessageLoopForIO::current()->UnwatchSocket(event_.get());
   close(socket_);
   socket_ = kInvalidSocket;
-  waiting_connect_ = false;
-
-  // Reset for next time.
-  current_ai_ = addresses_.head();
 }
 
 bool TCPClientSocket::IsConnected() const {
@@ -180,41 +252,46 @@ int TCPClientSocket::Read(char* buf,
 int TCPClientSocket::Write(const char* buf,
                            int buf_len,
                            CompletionCallback* callback) {
+  WriteBuffer write_buf = { buf, buf_len };
+  return WriteV(&write_buf, 1, callback);
+}
+
+int TCPClientSocket::WriteV(const WriteBuffer* bufs,
+                            int buf_count,
+                            CompletionCallback* callback) {
   DCHECK(socket_ != kInvalidSocket);
   DCHECK(!waiting_connect_);
   DCHECK(!write_callback_);
   // Synchronous operation not supported
   DCHECK(callback);
-  DCHECK(buf_len > 0);
+  DCHECK(buf_count > 0);
+
+  // Anything past IOV_MAX buffers is left for the next write.
+  buf_count = std::min(buf_count, IOV_MAX);
+  write_iov_.resize(buf_count);
+  for (int i = 0; i < buf_count; ++i) {
+    DCHECK(bufs[i].len > 0);
+    write_iov_[i].iov_base = const_cast<char*>(bufs[i].data);
+    write_iov_[i].iov_len = bufs[i].len;
+  }
 
-  int nwrite = write(socket_, buf, buf_len);
+  int nwrite = writev(socket_, &write_iov_[0], buf_count);
   if (nwrite >= 0) {
+    write_iov_.clear();
     return nwrite;
   }
-  if (errno != EAGAIN && errno != EWOULDBLOCK)
+  if (errno != EAGAIN && errno != EWOULDBLOCK) {
+    write_iov_.clear();
     return MapPosixError(errno);
+  }
 
   MessageLoopForIO::current()->WatchSocket(
      socket_, EV_WRITE|EV_PERSIST, event_.get(), this);
 
-  write_buf_ = buf;
-  write_buf_len_ = buf_len;
   write_callback_ = callback;
   return ERR_IO_PENDING;
 }
 
-int TCPClientSocket::CreateSocket(const addrinfo* ai) {
-  socket_ = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
-  if (socket_ == kInvalidSocket)
-    return MapPosixError(errno);
-
-  // All our socket I/O is nonblocking
-  if (SetNonBlocking(socket_))
-    return MapPosixError(errno);
-
-  return OK;
-}
-
 void TCPClientSocket::DoCallback(int rv) {
   DCHECK(rv != ERR_IO_PENDING);
   DCHECK(callback_);
@@ -235,38 +312,106 @@ void TCPClientSocket::DoWriteCallback(int rv) {
   c->Run(rv);
 }
 
-void TCPClientSocket::DidCompleteConnect() {
-  int result = ERR_UNEXPECTED;
+int TCPClientSocket::StartNextConnectAttempt() {
+  while (current_ai_) {
+    const addrinfo* ai = current_ai_;
+    current_ai_ = ai->ai_next;
+    ++connect_attempt_count_;
+
+    int s = CreateSocket(ai);
+    if (s == kInvalidSocket) {
+      last_connect_error_ = MapPosixError(errno);
+      continue;
+    }
+
+    if (!connect(s, ai->ai_addr, static_cast<int>(ai->ai_addrlen))) {
+      // Connected without waiting!
+      socket_ = s;
+      return OK;
+    }
+
+    if (errno != EINPROGRESS) {
+      DLOG(INFO) << "connect failed: " << errno;
+      last_connect_error_ = MapPosixError(errno);
+      close(s);
+      continue;
+    }
+
+    connect_attempts_.push_back(new ConnectAttempt(this, s));
+    if (current_ai_) {
+      connect_stagger_timer_.Start(connect_stagger_delay(), this,
+                                   &TCPClientSocket::OnConnectStaggerTimer);
+    }
+    return ERR_IO_PENDING;
+  }
+
+  return connect_attempts_.empty() ? last_connect_error_ : ERR_IO_PENDING;
+}
+
+void TCPClientSocket::OnConnectStaggerTimer() {
+  DCHECK(waiting_connect_);
+
+  int result = StartNextConnectAttempt();
+  if (result != ERR_IO_PENDING) {
+    waiting_connect_ = false;
+    DoCallback(DidFinishConnect(result));
+  }
+}
+
+void TCPClientSocket::DidCompleteConnectAttempt(ConnectAttempt* attempt) {
+  DCHECK(waiting_connect_);
 
   // Check to see if connect succeeded
   int error_code = 0;
   socklen_t len = sizeof(error_code);
-  if (getsockopt(socket_, SOL_SOCKET, SO_ERROR, &error_code, &len) < 0)
+  if (getsockopt(attempt->socket(), SOL_SOCKET, SO_ERROR, &error_code,
+                 &len) < 0)
     error_code = errno;
 
   if (error_code == EINPROGRESS || error_code == EALREADY) {
     NOTREACHED();  // This indicates a bug in libevent or our code.
-    result = ERR_IO_PENDING;
-  } else if (current_ai_->ai_next && (
-             error_code == EADDRNOTAVAIL ||
-             error_code == EAFNOSUPPORT ||
-             error_code == ECONNREFUSED ||
-             error_code == ENETUNREACH ||
-             error_code == EHOSTUNREACH ||
-             error_code == ETIMEDOUT)) {
-    // This address failed, try next one in list.
-    const addrinfo* next = current_ai_->ai_next;
-    Disconnect();
-    current_ai_ = next;
-    result = Connect(callback_);
+    return;
+  }
+
+  std::vector<ConnectAttempt*>::iterator it =
+      std::find(connect_attempts_.begin(), connect_attempts_.end(), attempt);
+  DCHECK(it != connect_attempts_.end());
+
+  int result;
+  if (!error_code) {
+    socket_ = attempt->ReleaseSocket(&event_);
+    result = OK;
   } else {
-    result = MapPosixError(error_code);
-    MessageLoopForIO::current()->UnwatchSocket(event_.get());
-    waiting_connect_ = false;
+    // This address failed.  Rather than wait out the stagger delay, try the
+    // next one now.
+    last_connect_error_ = MapPosixError(error_code);
+    delete attempt;
+    connect_attempts_.erase(it);
+    connect_stagger_timer_.Stop();
+    result = StartNextConnectAttempt();
+    if (result == ERR_IO_PENDING)
+      return;
   }
 
-  if (result != ERR_IO_PENDING)
-    DoCallback(result);
+  waiting_connect_ = false;
+  DoCallback(DidFinishConnect(result));
+}
+
+int TCPClientSocket::DidFinishConnect(int result) {
+  connect_stagger_timer_.Stop();
+  for (size_t i = 0; i < connect_attempts_.size(); ++i)
+    delete connect_attempts_[i];
+  connect_attempts_.clear();
+
+  TimeDelta latency = TimeTicks::Now() - connect_start_time_;
+  if (result == OK) {
+    UMA_HISTOGRAM_TIMES(L"Net.TCP_Connect_Latency", latency);
+    UMA_HISTOGRAM_COUNTS_100(L"Net.TCP_Connect_Attempts",
+                             connect_attempt_count_);
+  } else if (result != ERR_ABORTED) {
+    UMA_HISTOGRAM_TIMES(L"Net.TCP_Connect_Failure_Latency", latency);
+  }
+  return result;
 }
 
 void TCPClientSocket::DidCompleteRead() {
@@ -290,7 +435,8 @@ void TCPClientSocket::DidCompleteRead() {
 
 void TCPClientSocket::DidCompleteWrite() {
   int bytes_transferred;
-  bytes_transferred = write(socket_, write_buf_, write_buf_len_);
+  bytes_transferred = writev(socket_, &write_iov_[0],
+                             static_cast<int>(write_iov_.size()));
 
   int result;
   if (bytes_transferred >= 0) {
@@ -300,8 +446,7 @@ void TCPClientSocket::DidCompleteWrite() {
   }
 
   if (result != ERR_IO_PENDING) {
-    write_buf_ = NULL;
-    write_buf_len_ = 0;
+    write_iov_.clear();
     MessageLoopForIO::current()->UnwatchSocket(event_.get());
     DoWriteCallback(result);
   }
@@ -310,14 +455,10 @@ void TCPClientSocket::DidCompleteWrite() {
 void TCPClientSocket::OnSocketReady(short flags) {
   // the only used bits of flags are EV_READ and EV_WRITE
 
-  if (waiting_connect_) {
-    DidCompleteConnect();
-  } else {
-    if ((flags & EV_WRITE) && write_callback_)
-      DidCompleteWrite();
-    if ((flags & EV_READ) && callback_)
-      DidCompleteRead();
-  }
+  if ((flags & EV_WRITE) && write_callback_)
+    DidCompleteWrite();
+  if ((flags & EV_READ) && callback_)
+    DidCompleteRead();
 }
 
 int TCPClientSocket::GetPeerName(struct sockaddr *name, socklen_t *namelen) {
@@ -2,7 +2,17 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "build/build_config.h"
+
+#if defined(OS_POSIX)
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 #include "base/platform_test.h"
+#include "base/string_util.h"
 #include "net/base/address_list.h"
 #include "net/base/host_resolver.h"
 #include "net/base/net_errors.h"
@@ -171,3 +181,233 @@ TEST_F(TCPClientSocketTest, Read_Interrupted) {
 
   EXPECT_NE(rv, 0);
 }
+
+TEST_F(TCPClientSocketTest, WriteV) {
+  net::AddressList addr;
+  net::HostResolver resolver;
+  TestCompletionCallback callback;
+
+  int rv = resolver.Resolve("www.google.com", 80, &addr, NULL);
+  EXPECT_EQ(rv, net::OK);
+
+  net::TCPClientSocket sock(addr);
+
+  rv = sock.Connect(&callback);
+  if (rv != net::OK) {
+    ASSERT_EQ(rv, net::ERR_IO_PENDING);
+
+    rv = callback.WaitForResult();
+    EXPECT_EQ(rv, net::OK);
+  }
+
+  // The request goes out in pieces, in one write.
+  const char request_line[] = "GET / HTTP/1.0\r\n";
+  const char headers[] = "Host: www.google.com\r\n";
+  const char end_of_headers[] = "\r\n";
+  net::Socket::WriteBuffer bufs[] = {
+    { request_line, arraysize(request_line) - 1 },
+    { headers, arraysize(headers) - 1 },
+    { end_of_headers, arraysize(end_of_headers) - 1 },
+  };
+  int request_len = bufs[0].len + bufs[1].len + bufs[2].len;
+  rv = sock.WriteV(bufs, arraysize(bufs), &callback);
+  EXPECT_TRUE(rv >= 0 || rv == net::ERR_IO_PENDING);
+
+  if (rv == net::ERR_IO_PENDING)
+    rv = callback.WaitForResult();
+  EXPECT_EQ(rv, request_len);
+
+  char buf[4096];
+  rv = sock.Read(buf, sizeof(buf), &callback);
+  EXPECT_TRUE(rv >= 0 || rv == net::ERR_IO_PENDING);
+
+  if (rv == net::ERR_IO_PENDING)
+    rv = callback.WaitForResult();
+
+  ASSERT_GT(rv, 0);
+  EXPECT_EQ(0, memcmp(buf, "HTTP/1.", 7));
+}
+
+#if defined(OS_POSIX)
+
+namespace {
+
+// A TCP socket bound to a port on the loopback interface.  Connections to it
+// are refused until Listen is called.
+class LoopbackSocket {
+ public:
+  LoopbackSocket() : socket_(socket(AF_INET, SOCK_STREAM, 0)), port_(0) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (!bind(socket_, reinterpret_cast<struct sockaddr*>(&addr), addr_len) &&
+        !getsockname(socket_, reinterpret_cast<struct sockaddr*>(&addr),
+                     &addr_len))
+      port_ = ntohs(addr.sin_port);
+  }
+  ~LoopbackSocket() {
+    close(socket_);
+  }
+
+  int port() const { return port_; }
+
+  bool Listen(int backlog) {
+    return !listen(socket_, backlog);
+  }
+
+ private:
+  int socket_;
+  int port_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoopbackSocket);
+};
+
+// Sets |list| to the loopback address at each of |ports|, in order.
+void CreateLoopbackAddressList(const int* ports, int port_count,
+                               net::AddressList* list) {
+  struct addrinfo* head = NULL;
+  struct addrinfo** tail = &head;
+  for (int i = 0; i < port_count; ++i) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST;
+    struct addrinfo* ai = NULL;
+    ASSERT_EQ(0, getaddrinfo("127.0.0.1", IntToString(ports[i]).c_str(),
+                             &hints, &ai));
+    // freeaddrinfo() frees the entries one at a time, so the lists from
+    // separate calls can be joined.
+    *tail = ai;
+    while (*tail)
+      tail = &(*tail)->ai_next;
+  }
+  list->Adopt(head);
+}
+
+// Connects |sock|, and returns the result.
+int ConnectAndWait(net::TCPClientSocket* sock) {
+  TestCompletionCallback callback;
+  int rv = sock->Connect(&callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = callback.WaitForResult();
+  return rv;
+}
+
+// Returns the port |sock| is connected to.
+int GetPeerPort(net::TCPClientSocket* sock) {
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  if (sock->GetPeerName(reinterpret_cast<struct sockaddr*>(&addr), &addr_len))
+    return 0;
+  return ntohs(addr.sin_port);
+}
+
+}  // namespace
+
+TEST_F(TCPClientSocketTest, ConnectToLoopback) {
+  LoopbackSocket listener;
+  ASSERT_TRUE(listener.Listen(5));
+
+  int ports[] = { listener.port() };
+  net::AddressList addr;
+  CreateLoopbackAddressList(ports, arraysize(ports), &addr);
+
+  net::TCPClientSocket sock(addr);
+  EXPECT_EQ(net::OK, ConnectAndWait(&sock));
+  EXPECT_TRUE(sock.IsConnected());
+  EXPECT_EQ(listener.port(), GetPeerPort(&sock));
+}
+
+TEST_F(TCPClientSocketTest, ConnectRefused) {
+  LoopbackSocket not_listening;
+
+  int ports[] = { not_listening.port(), not_listening.port() };
+  net::AddressList addr;
+  CreateLoopbackAddressList(ports, arraysize(ports), &addr);
+
+  net::TCPClientSocket sock(addr);
+  EXPECT_EQ(net::ERR_CONNECTION_REFUSED, ConnectAndWait(&sock));
+  EXPECT_FALSE(sock.IsConnected());
+}
+
+// An address that refuses the connection is passed over right away.
+TEST_F(TCPClientSocketTest, ConnectSkipsRefusedAddress) {
+  LoopbackSocket not_listening;
+  LoopbackSocket listener;
+  ASSERT_TRUE(listener.Listen(5));
+
+  int ports[] = { not_listening.port(), listener.port() };
+  net::AddressList addr;
+  CreateLoopbackAddressList(ports, arraysize(ports), &addr);
+
+  net::TCPClientSocket sock(addr);
+  EXPECT_EQ(net::OK, ConnectAndWait(&sock));
+  EXPECT_EQ(listener.port(), GetPeerPort(&sock));
+}
+
+#if defined(OS_LINUX)
+// An address that doesn't answer only holds things up for the stagger delay.
+TEST_F(TCPClientSocketTest, ConnectRacesStalledAddress) {
+  // Linux drops connections to a listener whose backlog is full, so once one
+  // connection is waiting to be accepted, more just stall.
+  LoopbackSocket stalled;
+  ASSERT_TRUE(stalled.Listen(0));
+  int stalled_ports[] = { stalled.port() };
+  net::AddressList stalled_addr;
+  CreateLoopbackAddressList(stalled_ports, arraysize(stalled_ports),
+                            &stalled_addr);
+  net::TCPClientSocket backlog(stalled_addr);
+  ASSERT_EQ(net::OK, ConnectAndWait(&backlog));
+
+  LoopbackSocket listener;
+  ASSERT_TRUE(listener.Listen(5));
+
+  int ports[] = { stalled.port(), listener.port() };
+  net::AddressList addr;
+  CreateLoopbackAddressList(ports, arraysize(ports), &addr);
+
+  TimeDelta old_delay = net::TCPClientSocket::connect_stagger_delay();
+  net::TCPClientSocket::SetConnectStaggerDelay(
+      TimeDelta::FromMilliseconds(10));
+
+  net::TCPClientSocket sock(addr);
+  TimeTicks start = TimeTicks::Now();
+  EXPECT_EQ(net::OK, ConnectAndWait(&sock));
+  EXPECT_EQ(listener.port(), GetPeerPort(&sock));
+  // Far less than the OS would take to give up on the stalled address.
+  EXPECT_LT((TimeTicks::Now() - start).InMilliseconds(), 1000);
+
+  net::TCPClientSocket::SetConnectStaggerDelay(old_delay);
+}
+
+// Disconnecting gives up on all the attempts in progress.
+TEST_F(TCPClientSocketTest, DisconnectWhileConnecting) {
+  LoopbackSocket stalled;
+  ASSERT_TRUE(stalled.Listen(0));
+  int ports[] = { stalled.port(), stalled.port() };
+  net::AddressList addr;
+  CreateLoopbackAddressList(ports, arraysize(ports), &addr);
+  net::TCPClientSocket backlog(addr);
+  ASSERT_EQ(net::OK, ConnectAndWait(&backlog));
+
+  TimeDelta old_delay = net::TCPClientSocket::connect_stagger_delay();
+  net::TCPClientSocket::SetConnectStaggerDelay(TimeDelta());
+
+  net::TCPClientSocket sock(addr);
+  TestCompletionCallback callback;
+  EXPECT_EQ(net::ERR_IO_PENDING, sock.Connect(&callback));
+  // Let the second attempt start.
+  MessageLoop::current()->RunAllPending();
+  sock.Disconnect();
+  EXPECT_FALSE(sock.IsConnected());
+  MessageLoop::current()->RunAllPending();
+  EXPECT_FALSE(callback.have_result());
+
+  net::TCPClientSocket::SetConnectStaggerDelay(old_delay);
+}
+#endif  // defined(OS_LINUX)
+
+#endif  // defined(OS_POSIX)
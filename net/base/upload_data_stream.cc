@@ -4,107 +4,150 @@
 
 #include "net/base/upload_data_stream.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "net/base/net_errors.h"
 
 namespace net {
 
+namespace {
+
+int WriteBufferLength(size_t len) {
+  // Anything beyond this is written by a later write.
+  return static_cast<int>(std::min(len, static_cast<size_t>(kint32max)));
+}
+
+}  // namespace
+
 UploadDataStream::UploadDataStream(const UploadData* data)
     : data_(data),
       total_size_(data->GetContentLength()) {
   Reset();
-  FillBuf();
 }
 
 UploadDataStream::~UploadDataStream() {
 }
 
-void UploadDataStream::DidConsume(size_t num_bytes) {
-  DCHECK(num_bytes <= buf_len_);
-
-  buf_len_ -= num_bytes;
-  if (buf_len_)
-    memmove(buf_, buf_ + num_bytes, buf_len_);
-
-  FillBuf();
+int UploadDataStream::GetBuffers(Socket::WriteBuffer* bufs,
+                                 int max_bufs) const {
+  if (!buf_len_ || max_bufs <= 0)
+    return 0;
+
+  bufs[0].data = buf_;
+  bufs[0].len = WriteBufferLength(buf_len_);
+  int count = 1;
+
+  // The TYPE_BYTES elements that follow can go out in the same write.  A file
+  // has to be read before it can be sent, so it ends the list, as does the
+  // rest of the current file.
+  if (next_element_->type() == UploadData::TYPE_FILE &&
+      next_element_remaining_)
+    return count;
+  std::vector<UploadData::Element>::const_iterator end =
+      data_->elements().end();
+  std::vector<UploadData::Element>::const_iterator element = next_element_;
+  for (++element; element != end && count < max_bufs; ++element) {
+    if (element->type() != UploadData::TYPE_BYTES)
+      break;
+    const std::vector<char>& d = element->bytes();
+    if (d.empty())
+      continue;
+    bufs[count].data = &d[0];
+    bufs[count].len = WriteBufferLength(d.size());
+    ++count;
+  }
+  return count;
+}
 
+void UploadDataStream::DidConsume(size_t num_bytes) {
   current_position_ += num_bytes;
+
+  while (num_bytes && buf_len_) {
+    size_t amount = std::min(num_bytes, buf_len_);
+    buf_ += amount;
+    buf_len_ -= amount;
+    num_bytes -= amount;
+    if (!buf_len_)
+      LoadNextSegment();
+  }
+  DCHECK(!num_bytes);
 }
 
 void UploadDataStream::Reset() {
   next_element_stream_.Close();
+  buf_ = NULL;
   buf_len_ = 0;
   next_element_ = data_->elements().begin();
-  next_element_offset_ = 0;
+  next_element_started_ = false;
   next_element_remaining_ = 0;
   current_position_ = 0;
+
+  LoadNextSegment();
 }
 
-void UploadDataStream::FillBuf() {
+void UploadDataStream::LoadNextSegment() {
+  DCHECK(!buf_len_);
+
   std::vector<UploadData::Element>::const_iterator end =
       data_->elements().end();
 
-  while (buf_len_ < kBufSize && next_element_ != end) {
-    bool advance_to_next_element = false;
-
+  while (!buf_len_ && next_element_ != end) {
     const UploadData::Element& element = *next_element_;
 
-    size_t size_remaining = kBufSize - buf_len_;
     if (element.type() == UploadData::TYPE_BYTES) {
+      // The bytes are consumed in place, all in one segment.
       const std::vector<char>& d = element.bytes();
-      size_t count = d.size() - next_element_offset_;
-
-      size_t bytes_copied = std::min(count, size_remaining);
-
-      memcpy(buf_ + buf_len_, &d[next_element_offset_], bytes_copied);
-      buf_len_ += bytes_copied;
-
-      if (bytes_copied == count) {
-        advance_to_next_element = true;
-      } else {
-        next_element_offset_ += bytes_copied;
+      if (!next_element_started_ && !d.empty()) {
+        buf_ = &d[0];
+        buf_len_ = d.size();
       }
     } else {
       DCHECK(element.type() == UploadData::TYPE_FILE);
 
-      if (!next_element_stream_.IsOpen()) {
-        int rv = next_element_stream_.Open(element.file_path(), false);
-        // If the file does not exist, that's technically okay.. we'll just
-        // upload an empty file.  This is for consistency with Mozilla.
-        DLOG_IF(WARNING, rv != OK) << "Failed to open \"" <<
-            element.file_path() << "\" for reading: " << rv;
-
-        next_element_remaining_ = 0;  // Default to reading nothing.
-        if (rv == OK) {
-          uint64 offset = element.file_range_offset();
-          if (offset && next_element_stream_.Seek(FROM_BEGIN, offset) < 0) {
-            DLOG(WARNING) << "Failed to seek \"" << element.file_path() <<
-                "\" to offset: " << offset;
-          } else {
-            next_element_remaining_ = element.file_range_length();
-          }
-        }
-      }
+      if (!next_element_started_)
+        OpenFile(element);
 
-      int rv = 0;
       int count = static_cast<int>(std::min(
-          static_cast<uint64>(size_remaining), next_element_remaining_));
-      if (count > 0 &&
-          (rv = next_element_stream_.Read(buf_ + buf_len_, count, NULL)) > 0) {
-        buf_len_ += rv;
-        next_element_remaining_ -= rv;
-      } else {
-        advance_to_next_element = true;
+          static_cast<uint64>(kFileBufSize), next_element_remaining_));
+      if (count > 0) {
+        if (!file_buf_.get())
+          file_buf_.reset(new char[kFileBufSize]);
+        int rv = next_element_stream_.Read(file_buf_.get(), count, NULL);
+        if (rv > 0) {
+          buf_ = file_buf_.get();
+          buf_len_ = rv;
+          next_element_remaining_ -= rv;
+        }
       }
     }
+    next_element_started_ = true;
 
-    if (advance_to_next_element) {
+    if (!buf_len_) {
       ++next_element_;
-      next_element_offset_ = 0;
+      next_element_started_ = false;
       next_element_stream_.Close();
     }
   }
 }
 
-}  // namespace net
+void UploadDataStream::OpenFile(const UploadData::Element& element) {
+  int rv = next_element_stream_.Open(element.file_path(), false);
+  // If the file does not exist, that's technically okay.. we'll just
+  // upload an empty file.  This is for consistency with Mozilla.
+  DLOG_IF(WARNING, rv != OK) << "Failed to open \"" <<
+      element.file_path() << "\" for reading: " << rv;
+
+  next_element_remaining_ = 0;  // Default to reading nothing.
+  if (rv == OK) {
+    uint64 offset = element.file_range_offset();
+    if (offset && next_element_stream_.Seek(FROM_BEGIN, offset) < 0) {
+      DLOG(WARNING) << "Failed to seek \"" << element.file_path() <<
+          "\" to offset: " << offset;
+    } else {
+      next_element_remaining_ = element.file_range_length();
+    }
+  }
+}
 
+}  // namespace net
@@ -5,23 +5,37 @@
 #ifndef NET_BASE_UPLOAD_DATA_STREAM_H_
 #define NET_BASE_UPLOAD_DATA_STREAM_H_
 
+#include "base/scoped_ptr.h"
 #include "net/base/file_input_stream.h"
+#include "net/base/socket.h"
 #include "net/base/upload_data.h"
 
 namespace net {
 
+// Walks the elements of an UploadData as a sequence of buffers to be written
+// to a socket.  TYPE_BYTES elements are sent straight from the UploadData,
+// and file ranges are read a large chunk at a time.
 class UploadDataStream {
  public:
   UploadDataStream(const UploadData* data);
   ~UploadDataStream();
 
-  // Returns the stream's buffer and buffer length.
+  // Returns the stream's current buffer and buffer length.  This is the
+  // next segment of the upload data to be consumed, and is empty only at the
+  // end of the data.
   const char* buf() const { return buf_; }
   size_t buf_len() const { return buf_len_; }
 
-  // Call to indicate that a portion of the stream's buffer was consumed.  This
-  // call modifies the stream's buffer so that it contains the next segment of
-  // the upload data to be consumed.
+  // Fills in up to |max_bufs| buffers with the data to be consumed next,
+  // starting with buf(), for use with Socket::WriteV.  Returns the number of
+  // buffers filled in.  The buffers stay valid until the next call to
+  // DidConsume or Reset.
+  int GetBuffers(Socket::WriteBuffer* bufs, int max_bufs) const;
+
+  // Call to indicate that a portion of the stream's data was consumed, which
+  // may run past the end of buf() into the other buffers from GetBuffers.
+  // This call advances the stream's buffer to the next segment of the upload
+  // data to be consumed.
   void DidConsume(size_t num_bytes);
 
   // Call to reset the stream position to the beginning.
@@ -32,24 +46,31 @@ class UploadDataStream {
   uint64 position() const { return current_position_; }
 
  private:
-  void FillBuf();
+  // Moves buf() on to the next data to be consumed once the current segment
+  // has all been consumed, reading from next_element_'s file if need be.
+  void LoadNextSegment();
+
+  // Opens the file of a TYPE_FILE element and seeks to its range.
+  void OpenFile(const UploadData::Element& element);
 
   const UploadData* data_;
 
-  // This buffer is filled with data to be uploaded.  The data to be sent is
-  // always at the front of the buffer.  If we cannot send all of the buffer at
-  // once, then we memmove the remaining portion and back-fill the buffer for
-  // the next "write" call.  buf_len_ indicates how much data is in the buffer.
-  enum { kBufSize = 16384 };
-  char buf_[kBufSize];
+  // The segment of the upload data to be consumed next.  It points either
+  // into next_element_'s bytes or into file_buf_.
+  const char* buf_;
   size_t buf_len_;
 
-  // Iterator to the upload element to be written to the send buffer next.
+  // Data read from the currently open file.  Allocated when the stream first
+  // reaches a TYPE_FILE element.
+  enum { kFileBufSize = 256 * 1024 };
+  scoped_array<char> file_buf_;
+
+  // Iterator to the upload element that buf_ comes from, or that will be
+  // loaded into buf_ next.
   std::vector<UploadData::Element>::const_iterator next_element_;
 
-  // The byte offset into next_element_'s data buffer if the next element is
-  // a TYPE_BYTES element.
-  size_t next_element_offset_;
+  // Whether next_element_ has been loaded into buf_ yet.
+  bool next_element_started_;
 
   // A stream to the currently open file, for next_element_ if the next element
   // is a TYPE_FILE element.
@@ -69,4 +90,3 @@ class UploadDataStream {
 }  // namespace net
 
 #endif  // NET_BASE_UPLOAD_DATA_STREAM_H_
-
@@ -0,0 +1,152 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <string>
+
+#include "base/file_util.h"
+#include "base/platform_test.h"
+#include "base/scoped_ptr.h"
+#include "net/base/upload_data.h"
+#include "net/base/upload_data_stream.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kMaxBufs = 16;
+
+// Larger than the chunks UploadDataStream reads files in, so that the file
+// takes more than one read.
+const int kFileSize = 600 * 1024;
+
+class UploadDataStreamTest : public PlatformTest {
+ public:
+  virtual void SetUp() {
+    PlatformTest::SetUp();
+
+    file_data_.resize(kFileSize);
+    for (int i = 0; i < kFileSize; ++i)
+      file_data_[i] = static_cast<char>(i * 7);
+    file_util::CreateTemporaryFileName(&temp_file_path_);
+    ASSERT_EQ(kFileSize, file_util::WriteFile(temp_file_path_,
+                                              file_data_.data(), kFileSize));
+  }
+  virtual void TearDown() {
+    file_util::Delete(temp_file_path_, false);
+
+    PlatformTest::TearDown();
+  }
+
+ protected:
+  // Consumes the whole of |stream|, at most |write_size| bytes at a time, the
+  // way a socket write would, and returns the data.
+  std::string ReadAll(net::UploadDataStream* stream, size_t write_size) {
+    std::string data;
+    net::Socket::WriteBuffer bufs[kMaxBufs];
+    while (stream->position() < stream->size()) {
+      int count = stream->GetBuffers(bufs, kMaxBufs);
+      EXPECT_GT(count, 0);
+      if (count <= 0)
+        break;
+      size_t written = 0;
+      for (int i = 0; i < count && written < write_size; ++i) {
+        size_t amount = std::min(static_cast<size_t>(bufs[i].len),
+                                 write_size - written);
+        data.append(bufs[i].data, amount);
+        written += amount;
+      }
+      stream->DidConsume(written);
+    }
+    EXPECT_EQ(0U, stream->buf_len());
+    return data;
+  }
+
+  std::wstring temp_file_path_;
+  std::string file_data_;
+};
+
+TEST_F(UploadDataStreamTest, EmptyUploadData) {
+  scoped_refptr<net::UploadData> upload_data = new net::UploadData;
+  net::UploadDataStream stream(upload_data);
+  EXPECT_EQ(0U, stream.size());
+  EXPECT_EQ(0U, stream.buf_len());
+
+  net::Socket::WriteBuffer bufs[kMaxBufs];
+  EXPECT_EQ(0, stream.GetBuffers(bufs, kMaxBufs));
+}
+
+// Bytes elements are handed out in place, several to a write.
+TEST_F(UploadDataStreamTest, BytesAreNotCopied) {
+  scoped_refptr<net::UploadData> upload_data = new net::UploadData;
+  upload_data->AppendBytes("abc", 3);
+  upload_data->AppendBytes("defg", 4);
+  upload_data->AppendBytes("h", 1);
+  net::UploadDataStream stream(upload_data);
+  const std::vector<net::UploadData::Element>& elements =
+      upload_data->elements();
+
+  net::Socket::WriteBuffer bufs[kMaxBufs];
+  ASSERT_EQ(3, stream.GetBuffers(bufs, kMaxBufs));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(&elements[i].bytes()[0], bufs[i].data);
+    EXPECT_EQ(static_cast<int>(elements[i].bytes().size()), bufs[i].len);
+  }
+  EXPECT_EQ(bufs[0].data, stream.buf());
+  EXPECT_EQ(3U, stream.buf_len());
+  EXPECT_EQ(2, stream.GetBuffers(bufs, 2));
+
+  // Consume into the middle of the second element.
+  stream.DidConsume(5);
+  EXPECT_EQ(5U, stream.position());
+  EXPECT_EQ(&elements[1].bytes()[2], stream.buf());
+  EXPECT_EQ(2U, stream.buf_len());
+  ASSERT_EQ(2, stream.GetBuffers(bufs, kMaxBufs));
+  EXPECT_EQ(&elements[2].bytes()[0], bufs[1].data);
+
+  stream.DidConsume(3);
+  EXPECT_EQ(8U, stream.position());
+  EXPECT_EQ(0U, stream.buf_len());
+  EXPECT_EQ(0, stream.GetBuffers(bufs, kMaxBufs));
+}
+
+TEST_F(UploadDataStreamTest, FileAndBytes) {
+  scoped_refptr<net::UploadData> upload_data = new net::UploadData;
+  upload_data->AppendBytes("head", 4);
+  upload_data->AppendFile(temp_file_path_);
+  upload_data->AppendBytes("middle", 6);
+  upload_data->AppendFileRange(temp_file_path_, 1000, 300 * 1024);
+  upload_data->AppendBytes("tail", 4);
+  net::UploadDataStream stream(upload_data);
+
+  std::string expected = "head" + file_data_ + "middle" +
+      file_data_.substr(1000, 300 * 1024) + "tail";
+  EXPECT_EQ(expected.size(), stream.size());
+
+  // A file ends the list of buffers, since it hasn't been read yet.
+  net::Socket::WriteBuffer bufs[kMaxBufs];
+  EXPECT_EQ(1, stream.GetBuffers(bufs, kMaxBufs));
+
+  EXPECT_TRUE(expected == ReadAll(&stream, 100 * 1024 + 3));
+
+  stream.Reset();
+  EXPECT_EQ(0U, stream.position());
+  EXPECT_TRUE(expected == ReadAll(&stream, 1));
+}
+
+// Files that can't be read are uploaded as empty.
+TEST_F(UploadDataStreamTest, MissingFile) {
+  std::wstring missing_file_path;
+  file_util::CreateTemporaryFileName(&missing_file_path);
+  file_util::Delete(missing_file_path, false);
+
+  scoped_refptr<net::UploadData> upload_data = new net::UploadData;
+  upload_data->AppendBytes("abc", 3);
+  upload_data->AppendFile(missing_file_path);
+  upload_data->AppendBytes("def", 3);
+  net::UploadDataStream stream(upload_data);
+
+  EXPECT_EQ("abcdef", ReadAll(&stream, 2));
+}
+
+}  // namespace
@@ -28,6 +28,22 @@ const int k64kEntriesStore = 160 * 1000 * 1000;
 const int kBaseTableLen = 64 * 1024;
 const int kDefaultCacheSize = 80 * 1024 * 1024;
 
+// With the segmented eviction policy, an entry moves to the protected list
+// after it has been opened this many times...
+const int kMinReuseToProtect = 2;
+
+// ... as long as it is not bigger than this fraction of the cache. One large
+// download should not be able to push out many small, frequently used entries,
+// and it should not be able to hide on the protected list either.
+const int kMaxProtectedEntryFraction = 64;
+
+// Maximum percentage of the entries that can be on the protected list.
+const int kMaxProtectedPercent = 75;
+
+// The number of histogram samples that a cache used by multiple threads keeps
+// between runs of the stats timer. Any more are dropped.
+const size_t kMaxPendingSamples = 1000;
+
 int DesiredIndexTableLen(int32 storage_size) {
   if (storage_size <= k64kEntriesStore)
     return kBaseTableLen;
@@ -105,6 +121,23 @@ std::wstring GetTempCacheName(const std::wstring& path,
   return std::wstring();
 }
 
+// Acquires a lock for the duration of a scope, if there is one to acquire.
+class ScopedExternalLock {
+ public:
+  explicit ScopedExternalLock(Lock* lock) : lock_(lock) {
+    if (lock_)
+      lock_->Acquire();
+  }
+  ~ScopedExternalLock() {
+    if (lock_)
+      lock_->Release();
+  }
+
+ private:
+  Lock* lock_;
+  DISALLOW_COPY_AND_ASSIGN(ScopedExternalLock);
+};
+
 // Moves the cache files to a new folder and creates a task to delete them.
 bool DelayedCacheCleanup(const std::wstring& full_path) {
   std::wstring path(full_path);
@@ -206,6 +239,12 @@ bool BackendImpl::Init() {
   if (!data_->header.this_id)
     data_->header.this_id++;
 
+  if (create_files)
+    data_->header.lru.policy = eviction_policy_;
+  else
+    eviction_policy_ = static_cast<EvictionPolicy>(data_->header.lru.policy);
+
+  block_files_.set_backend(this);
   if (!block_files_.Init(create_files))
     return false;
 
@@ -228,6 +267,7 @@ BackendImpl::~BackendImpl() {
 
   WaitForPendingIO(&num_pending_io_);
   DCHECK(!num_refs_);
+  ReportPendingSamples();
 }
 
 // ------------------------------------------------------------------------
@@ -253,8 +293,9 @@ bool BackendImpl::OpenEntry(const std::string& key, Entry** entry) {
 
   DCHECK(entry);
   *entry = cache_entry;
+  OnOpenEntry(cache_entry);
 
-  UMA_HISTOGRAM_TIMES(L"DiskCache.OpenTime", Time::Now() - start);
+  RecordTime(OPEN_TIME, Time::Now() - start);
   stats_.OnEvent(Stats::OPEN_HIT);
   return true;
 }
@@ -319,7 +360,7 @@ bool BackendImpl::CreateEntry(const std::string& key, Entry** entry) {
 
   data_->header.num_entries++;
   DCHECK(data_->header.num_entries > 0);
-  rankings_.Insert(cache_entry->rankings(), true);
+  rankings_.Insert(cache_entry->rankings(), true, Rankings::PROBATIONARY);
   if (!parent.get())
     data_->table[hash & mask_] = entry_address.value();
 
@@ -327,7 +368,7 @@ bool BackendImpl::CreateEntry(const std::string& key, Entry** entry) {
   *entry = NULL;
   cache_entry.swap(reinterpret_cast<EntryImpl**>(entry));
 
-  UMA_HISTOGRAM_TIMES(L"DiskCache.CreateTime", Time::Now() - start);
+  RecordTime(CREATE_TIME, Time::Now() - start);
   stats_.OnEvent(Stats::CREATE_HIT);
   Trace("create entry hit ");
   return true;
@@ -429,13 +470,15 @@ bool BackendImpl::OpenNextEntry(void** iter, Entry** next_entry) {
   if (disabled_)
     return false;
 
-  Rankings::ScopedRankingsBlock rankings(&rankings_,
-      reinterpret_cast<CacheRankingsBlock*>(*iter));
-  Rankings::ScopedRankingsBlock next(&rankings_,
-                                     rankings_.GetNext(rankings.get()));
+  scoped_ptr<Rankings::Iterator> iterator(
+      reinterpret_cast<Rankings::Iterator*>(*iter));
+  if (!iterator.get())
+    iterator.reset(new Rankings::Iterator(&rankings_));
+
   *next_entry = NULL;
   *iter = NULL;
-  if (!next.get())
+  CacheRankingsBlock* next = rankings_.GetNext(iterator.get());
+  if (!next)
     return false;
 
   scoped_refptr<EntryImpl> entry;
@@ -469,13 +512,13 @@ bool BackendImpl::OpenNextEntry(void** iter, Entry** next_entry) {
   }
 
   entry.swap(reinterpret_cast<EntryImpl**>(next_entry));
-  *iter = next.release();
+  *iter = iterator.release();
   return true;
 }
 
 void BackendImpl::EndEnumeration(void** iter) {
-  Rankings::ScopedRankingsBlock rankings(&rankings_,
-      reinterpret_cast<CacheRankingsBlock*>(*iter));
+  scoped_ptr<Rankings::Iterator> iterator(
+      reinterpret_cast<Rankings::Iterator*>(*iter));
   *iter = NULL;
 }
 
@@ -501,6 +544,14 @@ void BackendImpl::GetStats(StatsItems* stats) {
   item.second = StringPrintf("%d", data_->header.num_bytes);
   stats->push_back(item);
 
+  item.first = "Eviction policy";
+  item.second = eviction_policy_ == SEGMENTED_EVICTION ? "Segmented" : "LRU";
+  stats->push_back(item);
+
+  item.first = "Protected entries";
+  item.second = StringPrintf("%d", rankings_.Size(Rankings::PROTECTED));
+  stats->push_back(item);
+
   stats_.GetItems(stats);
 }
 
@@ -519,6 +570,11 @@ bool BackendImpl::SetMaxSize(int max_bytes) {
   return true;
 }
 
+void BackendImpl::SetEvictionPolicy(EvictionPolicy policy) {
+  DCHECK(!init_);
+  eviction_policy_ = policy;
+}
+
 std::wstring BackendImpl::GetFileName(Addr address) const {
   if (!address.is_separate_file() || !address.is_initialized()) {
     NOTREACHED();
@@ -574,17 +630,29 @@ void BackendImpl::DeleteBlock(Addr block_address, bool deep) {
   block_files_.DeleteBlock(block_address, deep);
 }
 
-void BackendImpl::UpdateRank(CacheRankingsBlock* node, bool modified) {
-  rankings_.UpdateRank(node, modified);
+void BackendImpl::UpdateRank(EntryImpl* entry, bool modified) {
+  rankings_.UpdateRank(entry->rankings(), modified, GetListForEntry(entry));
 }
 
-void BackendImpl::RecoveredEntry(CacheRankingsBlock* rankings) {
+LruData* BackendImpl::GetLruData() {
+  return &data_->header.lru;
+}
+
+void BackendImpl::RecoveredEntry(CacheRankingsBlock* rankings,
+                                 Rankings::List list) {
   Addr address(rankings->Data()->contents);
   EntryImpl* cache_entry = NULL;
   bool dirty;
   if (NewEntry(address, &cache_entry, &dirty))
     return;
 
+  // A move between lists may have been finished for this entry.
+  EntryStore* info = cache_entry->entry()->Data();
+  if (info->list != list) {
+    info->list = list;
+    cache_entry->entry()->Store();
+  }
+
   uint32 hash = cache_entry->GetHash();
   cache_entry->Release();
 
@@ -603,7 +671,7 @@ void BackendImpl::InternalDoomEntry(EntryImpl* entry) {
 
   Trace("Doom entry 0x%p", entry);
 
-  rankings_.Remove(entry->rankings());
+  rankings_.Remove(entry->rankings(), GetListForEntry(entry));
 
   entry->InternalDoom();
 
@@ -668,6 +736,7 @@ void BackendImpl::OnEvent(Stats::Counters an_event) {
 }
 
 void BackendImpl::OnStatsTimer() {
+  ScopedExternalLock lock(external_lock_);
   stats_.OnEvent(Stats::TIMER);
   int64 current = stats_.GetCounter(Stats::OPEN_ENTRIES);
   int64 time = stats_.GetCounter(Stats::TIMER);
@@ -685,6 +754,22 @@ void BackendImpl::OnStatsTimer() {
                          data_->header.num_bytes / (1024 * 1024));
     UMA_HISTOGRAM_COUNTS(L"DiskCache.MaxSize", max_size_ / (1024 * 1024));
   }
+
+  ReportPendingSamples();
+}
+
+void BackendImpl::RecordTime(HistogramType histogram, TimeDelta sample) {
+  RecordCount(histogram, static_cast<int>(sample.InMilliseconds()));
+}
+
+void BackendImpl::RecordCount(HistogramType histogram, int sample) {
+  if (!external_lock_) {
+    ReportSample(histogram, sample);
+    return;
+  }
+
+  if (pending_samples_.size() < kMaxPendingSamples)
+    pending_samples_.push_back(std::make_pair(histogram, sample));
 }
 
 void BackendImpl::IncrementIoCount() {
@@ -699,6 +784,10 @@ void BackendImpl::SetUnitTestMode() {
   unit_test_ = true;
 }
 
+void BackendImpl::SetExternalLock(Lock* lock) {
+  external_lock_ = lock;
+}
+
 void BackendImpl::ClearRefCountForTest() {
   num_refs_ = 0;
 }
@@ -936,7 +1025,7 @@ void BackendImpl::DestroyInvalidEntry(Addr address, EntryImpl* entry) {
   LOG(WARNING) << "Destroying invalid entry.";
   Trace("Destroying invalid entry 0x%p", entry);
 
-  rankings_.Remove(entry->rankings());
+  rankings_.Remove(entry->rankings(), GetListForEntry(entry));
   entry->SetPointerForInvalidEntry(GetCurrentEntryId());
 
   entry->InternalDoom();
@@ -946,50 +1035,129 @@ void BackendImpl::DestroyInvalidEntry(Addr address, EntryImpl* entry) {
   stats_.OnEvent(Stats::INVALID_ENTRY);
 }
 
+Rankings::List BackendImpl::GetListForEntry(EntryImpl* entry) {
+  int list = entry->entry()->Data()->list;
+  if (list < 0 || list >= Rankings::LAST_ELEMENT) {
+    NOTREACHED();
+    return Rankings::PROBATIONARY;
+  }
+  return static_cast<Rankings::List>(list);
+}
+
+void BackendImpl::OnOpenEntry(EntryImpl* entry) {
+  EntryStore* info = entry->entry()->Data();
+  Rankings::List list = GetListForEntry(entry);
+  stats_.OnEvent(Rankings::PROTECTED == list ? Stats::PROTECTED_HIT :
+                                               Stats::PROBATIONARY_HIT);
+  if (SEGMENTED_EVICTION != eviction_policy_)
+    return;
+
+  // The count is saved with the rest of the entry when it is closed.
+  if (info->reuse_count < kint32max) {
+    info->reuse_count++;
+    entry->entry()->set_modified();
+  }
+
+  if (Rankings::PROTECTED == list || info->reuse_count < kMinReuseToProtect)
+    return;
+
+  int64 size = entry->GetDataSize(0) + entry->GetDataSize(1);
+  if (size > max_size_ / kMaxProtectedEntryFraction)
+    return;
+
+  MoveToList(entry, Rankings::PROTECTED);
+  stats_.OnEvent(Stats::PROMOTE_ENTRY);
+
+  if (rankings_.Size(Rankings::PROTECTED) * 100 >
+      static_cast<int64>(data_->header.num_entries) * kMaxProtectedPercent)
+    DemoteProtectedEntry();
+}
+
+void BackendImpl::MoveToList(EntryImpl* entry, Rankings::List list) {
+  Trace("Move entry 0x%p to list %d", entry, list);
+  rankings_.Move(entry->rankings(), GetListForEntry(entry), list,
+                 entry->entry());
+}
+
+// The demoted entry goes to the head of the probationary list, so it has the
+// same chance of being reused as any other recent entry. Note that this
+// updates its last_used time.
+void BackendImpl::DemoteProtectedEntry() {
+  EntryImpl* entry;
+  {
+    Rankings::ScopedRankingsBlock node(&rankings_,
+        rankings_.GetPrev(NULL, Rankings::PROTECTED));
+    if (!node.get())
+      return;
+
+    bool dirty;
+    if (NewEntry(Addr(node->Data()->contents), &entry, &dirty)) {
+      Trace("NewEntry failed on Demote 0x%x", node->address().value());
+      return;
+    }
+
+    if (node->Data()->pointer)
+      entry = EntryImpl::Update(entry);
+  }
+
+  MoveToList(entry, Rankings::PROBATIONARY);
+  entry->Release();
+  stats_.OnEvent(Stats::DEMOTE_ENTRY);
+}
+
+// Entries are evicted from the tail of the probationary list first, and from
+// the protected list only when there is nothing else to evict.
 void BackendImpl::TrimCache(bool empty) {
   Trace("*** Trim Cache ***");
   if (disabled_)
     return;
 
   Time start = Time::Now();
-  Rankings::ScopedRankingsBlock node(&rankings_);
-  Rankings::ScopedRankingsBlock next(&rankings_, rankings_.GetPrev(node.get()));
-  DCHECK(next.get());
   int target_size = empty ? 0 : LowWaterAdjust(max_size_);
   int deleted = 0;
-  while (data_->header.num_bytes > target_size && next.get()) {
-    node.reset(next.release());
-    next.reset(rankings_.GetPrev(node.get()));
-    if (!node->Data()->pointer || empty) {
-      // This entry is not being used by anybody.
-      EntryImpl* entry;
-      bool dirty;
-      if (NewEntry(Addr(node->Data()->contents), &entry, &dirty)) {
-        Trace("NewEntry failed on Trim 0x%x", node->address().value());
-        continue;
-      }
-
-      if (node->Data()->pointer) {
-        entry = EntryImpl::Update(entry);
-      }
-      static Histogram counter(L"DiskCache.TrimAge", 1, 10000, 50);
-      counter.SetFlags(kUmaTargetedHistogramFlag);
-      counter.Add((Time::Now() - entry->GetLastUsed()).InHours());
-      entry->Doom();
-      entry->Release();
-      if (!empty)
-        stats_.OnEvent(Stats::TRIM_ENTRY);
-      if (++deleted == 4 && !empty) {
+  bool done = false;
+  for (int list = 0; list < Rankings::LAST_ELEMENT && !done; list++) {
+    Rankings::List current = static_cast<Rankings::List>(list);
+    Rankings::ScopedRankingsBlock node(&rankings_);
+    Rankings::ScopedRankingsBlock next(&rankings_,
+        rankings_.GetPrev(node.get(), current));
+    while (data_->header.num_bytes > target_size && next.get()) {
+      node.reset(next.release());
+      next.reset(rankings_.GetPrev(node.get(), current));
+      if (!node->Data()->pointer || empty) {
+        // This entry is not being used by anybody.
+        EntryImpl* entry;
+        bool dirty;
+        if (NewEntry(Addr(node->Data()->contents), &entry, &dirty)) {
+          Trace("NewEntry failed on Trim 0x%x", node->address().value());
+          continue;
+        }
+
+        if (node->Data()->pointer) {
+          entry = EntryImpl::Update(entry);
+        }
+        RecordCount(TRIM_AGE, (Time::Now() - entry->GetLastUsed()).InHours());
+        entry->Doom();
+        entry->Release();
+        if (!empty)
+          stats_.OnEvent(Stats::TRIM_ENTRY);
+        if (++deleted == 4 && !empty) {
 #if defined(OS_WIN)
-        MessageLoop::current()->PostTask(FROM_HERE,
-            factory_.NewRunnableMethod(&BackendImpl::TrimCache, false));
-        break;
+          // A cache shared between threads has no message loop of its own to
+          // continue on, so it just keeps going.
+          if (!external_lock_) {
+            MessageLoop::current()->PostTask(FROM_HERE,
+                factory_.NewRunnableMethod(&BackendImpl::TrimCache, false));
+            done = true;
+            break;
+          }
 #endif
+        }
       }
     }
   }
 
-  UMA_HISTOGRAM_TIMES(L"DiskCache.TotalTrimTime", Time::Now() - start);
+  RecordTime(TOTAL_TRIM_TIME, Time::Now() - start);
   Trace("*** Trim Cache end ***");
   return;
 }
@@ -1071,6 +1239,12 @@ bool BackendImpl::CheckIndex() {
     return false;
   }
 
+  if (data_->header.lru.policy != LRU_EVICTION &&
+      data_->header.lru.policy != SEGMENTED_EVICTION) {
+    LOG(ERROR) << "Invalid eviction policy";
+    return false;
+  }
+
   if (!mask_)
     mask_ = DesiredIndexTableLen(max_size_) - 1;
 
@@ -1120,4 +1294,61 @@ bool BackendImpl::CheckEntry(EntryImpl* cache_entry) {
   return !rankings->pointer;
 }
 
+// static
+void BackendImpl::ReportSample(HistogramType histogram, int sample) {
+  TimeDelta time = TimeDelta::FromMilliseconds(sample);
+  switch (histogram) {
+    case OPEN_TIME:
+      UMA_HISTOGRAM_TIMES(L"DiskCache.OpenTime", time);
+      break;
+    case CREATE_TIME:
+      UMA_HISTOGRAM_TIMES(L"DiskCache.CreateTime", time);
+      break;
+    case TRIM_AGE: {
+      static Histogram counter(L"DiskCache.TrimAge", 1, 10000, 50);
+      counter.SetFlags(kUmaTargetedHistogramFlag);
+      counter.Add(sample);
+      break;
+    }
+    case TOTAL_TRIM_TIME:
+      UMA_HISTOGRAM_TIMES(L"DiskCache.TotalTrimTime", time);
+      break;
+    case READ_TIME:
+      UMA_HISTOGRAM_TIMES(L"DiskCache.ReadTime", time);
+      break;
+    case WRITE_TIME:
+      UMA_HISTOGRAM_TIMES(L"DiskCache.WriteTime", time);
+      break;
+    case DELETE_HEADER:
+      UMA_HISTOGRAM_COUNTS(L"DiskCache.DeleteHeader", sample);
+      break;
+    case DELETE_DATA:
+      UMA_HISTOGRAM_COUNTS(L"DiskCache.DeleteData", sample);
+      break;
+    case GET_RANKINGS:
+      UMA_HISTOGRAM_TIMES(L"DiskCache.GetRankings", time);
+      break;
+    case UPDATE_RANK:
+      UMA_HISTOGRAM_TIMES(L"DiskCache.UpdateRank", time);
+      break;
+    case CREATE_BLOCK:
+      HISTOGRAM_TIMES(L"DiskCache.CreateBlock", time);
+      break;
+    case DELETE_BLOCK:
+      HISTOGRAM_TIMES(L"DiskCache.DeleteBlock", time);
+      break;
+    case GET_FILE_FOR_NEW_BLOCK:
+      HISTOGRAM_TIMES(L"DiskCache.GetFileForNewBlock", time);
+      break;
+    default:
+      NOTREACHED();
+  }
+}
+
+void BackendImpl::ReportPendingSamples() {
+  for (size_t i = 0; i < pending_samples_.size(); i++)
+    ReportSample(pending_samples_[i].first, pending_samples_[i].second);
+  pending_samples_.clear();
+}
+
 }  // namespace disk_cache
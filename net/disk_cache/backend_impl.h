@@ -7,7 +7,11 @@
 #ifndef NET_DISK_CACHE_BACKEND_IMPL_H__
 #define NET_DISK_CACHE_BACKEND_IMPL_H__
 
+#include <utility>
+#include <vector>
+
 #include "base/compiler_specific.h"
+#include "base/lock.h"
 #include "base/timer.h"
 #include "net/disk_cache/block_files.h"
 #include "net/disk_cache/disk_cache.h"
@@ -21,14 +25,35 @@ namespace disk_cache {
 // class handles the operations of the cache for a particular profile.
 class BackendImpl : public Backend {
  public:
+  // The histograms recorded by the cache, its entries and its block files.
+  enum HistogramType {
+    OPEN_TIME,
+    CREATE_TIME,
+    TRIM_AGE,
+    TOTAL_TRIM_TIME,
+    READ_TIME,
+    WRITE_TIME,
+    DELETE_HEADER,
+    DELETE_DATA,
+    GET_RANKINGS,
+    UPDATE_RANK,
+    CREATE_BLOCK,
+    DELETE_BLOCK,
+    GET_FILE_FOR_NEW_BLOCK
+  };
+
   explicit BackendImpl(const std::wstring& path)
       : path_(path), block_files_(path), mask_(0), max_size_(0),
+        eviction_policy_(LRU_EVICTION),
         init_(false), restarted_(false), unit_test_(false),
+        external_lock_(NULL),
         ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)) {}
   // mask can be used to limit the usable size of the hash table, for testing.
   BackendImpl(const std::wstring& path, uint32 mask)
       : path_(path), block_files_(path), mask_(mask), max_size_(0),
+        eviction_policy_(LRU_EVICTION),
         init_(false), restarted_(false), unit_test_(false),
+        external_lock_(NULL),
         ALLOW_THIS_IN_INITIALIZER_LIST(factory_(this)) {}
   ~BackendImpl();
 
@@ -51,6 +76,13 @@ class BackendImpl : public Backend {
   // Sets the maximum size for the total amount of data stored by this instance.
   bool SetMaxSize(int max_bytes);
 
+  // Sets the eviction policy to use if a new cache has to be created by Init.
+  // An existing cache keeps using the policy that it was created with.
+  void SetEvictionPolicy(EvictionPolicy policy);
+
+  // Returns the eviction policy of this cache.
+  EvictionPolicy eviction_policy() const { return eviction_policy_; }
+
   // Returns the full name for an external storage file.
   std::wstring GetFileName(Addr address) const;
 
@@ -69,11 +101,14 @@ class BackendImpl : public Backend {
   void DeleteBlock(Addr block_address, bool deep);
 
   // Updates the ranking information for an entry.
-  void UpdateRank(CacheRankingsBlock* node, bool modified);
+  void UpdateRank(EntryImpl* entry, bool modified);
 
-  // A node was recovered from a crash, it may not be on the index, so this
-  // method checks it and takes the appropriate action.
-  void RecoveredEntry(CacheRankingsBlock* rankings);
+  // Returns the data used by Rankings to keep track of the LRU lists.
+  LruData* GetLruData();
+
+  // A node was recovered from a crash and left on |list|. It may not be on the
+  // index, so this method checks it and takes the appropriate action.
+  void RecoveredEntry(CacheRankingsBlock* rankings, Rankings::List list);
 
   // Permanently deletes an entry.
   void InternalDoomEntry(EntryImpl* entry);
@@ -102,6 +137,12 @@ class BackendImpl : public Backend {
   // Timer callback to calculate usage statistics.
   void OnStatsTimer();
 
+  // Adds a sample to one of the histograms above. A cache used by more than
+  // one thread keeps the samples until the stats timer reports them, so that
+  // the histograms are only used by the thread that owns the cache.
+  void RecordTime(HistogramType histogram, TimeDelta sample);
+  void RecordCount(HistogramType histogram, int sample);
+
   // Handles the pending asynchronous IO count.
   void IncrementIoCount();
   void DecrementIoCount();
@@ -109,6 +150,11 @@ class BackendImpl : public Backend {
   // Sets internal parameters to enable unit testing mode.
   void SetUnitTestMode();
 
+  // Allows this object to be used by more than one thread (see ShardedBackend).
+  // Callers must hold |lock| while calling any method, and the work that the
+  // cache schedules for itself (like the stats timer) will acquire it too.
+  void SetExternalLock(Lock* lock);
+
   // Clears the counter of references to test handling of corruptions.
   void ClearRefCountForTest();
 
@@ -137,6 +183,20 @@ class BackendImpl : public Backend {
 
   void DestroyInvalidEntry(Addr address, EntryImpl* entry);
 
+  // Returns the rankings list that holds a given entry.
+  Rankings::List GetListForEntry(EntryImpl* entry);
+
+  // Updates the reuse information of an entry that was just opened, moving it
+  // to the protected list when it becomes eligible.
+  void OnOpenEntry(EntryImpl* entry);
+
+  // Moves an entry to the head of a given list.
+  void MoveToList(EntryImpl* entry, Rankings::List list);
+
+  // Moves the least recently used entry of the protected list back to the
+  // probationary list.
+  void DemoteProtectedEntry();
+
   // Deletes entries from the cache until the current size is below the limit.
   // If empty is true, the whole cache will be trimmed, regardless of being in
   // use.
@@ -162,6 +222,13 @@ class BackendImpl : public Backend {
   // Part of the self test. Returns false if the entry is corrupt.
   bool CheckEntry(EntryImpl* cache_entry);
 
+  // Adds a sample recorded by RecordTime (in milliseconds) or RecordCount to
+  // its histogram.
+  static void ReportSample(HistogramType histogram, int sample);
+
+  // Reports the samples kept while the cache is used by multiple threads.
+  void ReportPendingSamples();
+
   scoped_refptr<MappedFile> index_;  // The main cache index.
   std::wstring path_;  // Path to the folder used as backing storage.
   Index* data_;  // Pointer to the index data.
@@ -169,6 +236,7 @@ class BackendImpl : public Backend {
   Rankings rankings_;  // Rankings to be able to trim the cache.
   uint32 mask_;  // Binary mask to map a hash to the hash table.
   int32 max_size_;  // Maximum data size for this instance.
+  EvictionPolicy eviction_policy_;
   int num_refs_;  // Number of referenced cache entries.
   int max_refs_;  // Max number of eferenced cache entries.
   int num_pending_io_;  // Number of pending IO operations;
@@ -176,6 +244,12 @@ class BackendImpl : public Backend {
   bool restarted_;
   bool unit_test_;
   bool disabled_;
+  Lock* external_lock_;  // Serializes access from multiple threads, if any.
+
+  // Histogram samples waiting for the stats timer, when there is an
+  // |external_lock_|.
+  typedef std::vector<std::pair<HistogramType, int> > Samples;
+  Samples pending_samples_;
 
   Stats stats_;  // Usage statistcs.
   base::RepeatingTimer<BackendImpl> timer_;  // Usage timer.
@@ -11,6 +11,7 @@
 #include "net/disk_cache/disk_cache_test_base.h"
 #include "net/disk_cache/disk_cache_test_util.h"
 #include "net/disk_cache/mapped_file.h"
+#include "net/disk_cache/mem_backend_impl.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace {
@@ -91,6 +92,7 @@ class DiskCacheBackendTest : public DiskCacheTestWithCache {
   void BackendInvalidRankings();
   void BackendDisable();
   void BackendDisable2();
+  int BackendReusedEntriesLeft();
 };
 
 void DiskCacheBackendTest::BackendBasics() {
@@ -149,6 +151,12 @@ TEST_F(DiskCacheBackendTest, MemoryOnlyBasics) {
   BackendBasics();
 }
 
+TEST_F(DiskCacheBackendTest, ShardedBasics) {
+  SetShardedMode(4);
+  InitCache();
+  BackendBasics();
+}
+
 void DiskCacheBackendTest::BackendKeying() {
   const char* kName1 = "the first key";
   const char* kName2 = "the first Key";
@@ -200,6 +208,12 @@ TEST_F(DiskCacheBackendTest, MemoryOnlyKeying) {
   BackendKeying();
 }
 
+TEST_F(DiskCacheBackendTest, ShardedKeying) {
+  SetShardedMode(4);
+  InitCache();
+  BackendKeying();
+}
+
 TEST_F(DiskCacheBackendTest, ExternalFiles) {
   InitCache();
   // First, lets create a file on the folder.
@@ -280,6 +294,45 @@ TEST_F(DiskCacheBackendTest, MemoryOnlySetSize) {
   BackendSetSize();
 }
 
+// Tests that the memory-only cache is charged with the blocks that hold the
+// data, not with the size of the data.
+TEST_F(DiskCacheBackendTest, MemoryOnlyStorageSize) {
+  SetMemoryOnlyMode();
+  SetDirectMode();
+  InitCache();
+
+  std::string key("the key");
+  int key_size = static_cast<int>(key.size());
+  disk_cache::Entry* entry;
+  ASSERT_TRUE(cache_->CreateEntry(key, &entry));
+  EXPECT_EQ(key_size, mem_cache_->current_size());
+
+  char buffer[40000];
+  CacheTestFillBuffer(buffer, sizeof(buffer), false);
+  EXPECT_EQ(100, entry->WriteData(0, 0, buffer, 100, NULL, false));
+  EXPECT_EQ(key_size + 256, mem_cache_->current_size());
+
+  EXPECT_EQ(300, entry->WriteData(0, 100, buffer, 300, NULL, false));
+  EXPECT_EQ(key_size + 512, mem_cache_->current_size());
+
+  // 16 KB blocks plus the smallest block that holds the rest.
+  EXPECT_EQ(40000, entry->WriteData(1, 0, buffer, 40000, NULL, false));
+  EXPECT_EQ(key_size + 512 + 32768 + 8192, mem_cache_->current_size());
+
+  EXPECT_EQ(0, entry->WriteData(1, 1000, buffer, 0, NULL, true));
+  EXPECT_EQ(key_size + 512 + 1024, mem_cache_->current_size());
+  EXPECT_LE(mem_cache_->current_size(), mem_cache_->resident_size());
+
+  char buffer2[1000];
+  EXPECT_EQ(1000, entry->ReadData(1, 0, buffer2, 1000, NULL));
+  EXPECT_TRUE(!memcmp(buffer, buffer2, 1000));
+
+  entry->Doom();
+  entry->Close();
+  EXPECT_EQ(0, mem_cache_->current_size());
+  EXPECT_EQ(0, mem_cache_->arena()->resident_size());
+}
+
 void DiskCacheBackendTest::BackendLoad() {
   int seed = static_cast<int>(Time::Now().ToInternalValue());
   srand(seed);
@@ -535,6 +588,12 @@ TEST_F(DiskCacheBackendTest, MemoryOnlyEnumerations) {
   BackendEnumerations();
 }
 
+TEST_F(DiskCacheBackendTest, ShardedEnumerations) {
+  SetShardedMode(4);
+  InitCache();
+  BackendEnumerations();
+}
+
 // Verify handling of invalid entries while doing enumerations.
 // We'll be leaking memory from this test.
 TEST_F(DiskCacheBackendTest, InvalidEntryEnumeration) {
@@ -719,6 +778,127 @@ TEST_F(DiskCacheBackendTest, MemoryOnlyDoomBetween) {
   BackendDoomBetween();
 }
 
+TEST_F(DiskCacheBackendTest, ShardedDoomRecent) {
+  SetShardedMode(4);
+  InitCache();
+  BackendDoomRecent();
+}
+
+TEST_F(DiskCacheBackendTest, ShardedDoomBetween) {
+  SetShardedMode(4);
+  InitCache();
+  BackendDoomBetween();
+}
+
+TEST_F(DiskCacheBackendTest, SegmentedEnumerations) {
+  SetSegmentedEviction();
+  InitCache();
+  BackendEnumerations();
+}
+
+TEST_F(DiskCacheBackendTest, SegmentedDoomRecent) {
+  SetSegmentedEviction();
+  InitCache();
+  BackendDoomRecent();
+}
+
+TEST_F(DiskCacheBackendTest, SegmentedDoomBetween) {
+  SetSegmentedEviction();
+  InitCache();
+  BackendDoomBetween();
+}
+
+// Stores a few small entries that are reused, followed by a burst of large
+// entries that are never reused, and returns how many of the small entries are
+// still on the cache.
+int DiskCacheBackendTest::BackendReusedEntriesLeft() {
+  const int kCacheSize = 0x200000;  // 2 MB.
+  const int kSmallSize = 10 * 1024;
+  const int kLargeSize = 200 * 1024;
+  const int kNumSmall = 10;
+  const int kNumLarge = 12;
+  SetDirectMode();
+  SetMaxSize(kCacheSize);
+  InitCache();
+
+  scoped_array<char> buffer(new char[kLargeSize]);
+  memset(buffer.get(), 0, kLargeSize);
+  disk_cache::Entry* entry;
+  for (int i = 0; i < kNumSmall; i++) {
+    std::string key = StringPrintf("small %d", i);
+    EXPECT_TRUE(cache_->CreateEntry(key, &entry));
+    EXPECT_EQ(kSmallSize, entry->WriteData(0, 0, buffer.get(), kSmallSize,
+                                           NULL, false));
+    entry->Close();
+  }
+
+  for (int reuse = 0; reuse < 2; reuse++) {
+    for (int i = 0; i < kNumSmall; i++) {
+      std::string key = StringPrintf("small %d", i);
+      EXPECT_TRUE(cache_->OpenEntry(key, &entry));
+      EXPECT_EQ(kSmallSize, entry->ReadData(0, 0, buffer.get(), kSmallSize,
+                                            NULL));
+      entry->Close();
+    }
+  }
+
+  for (int i = 0; i < kNumLarge; i++) {
+    std::string key = StringPrintf("large %d", i);
+    EXPECT_TRUE(cache_->CreateEntry(key, &entry));
+    EXPECT_EQ(kLargeSize, entry->WriteData(0, 0, buffer.get(), kLargeSize,
+                                           NULL, false));
+    entry->Close();
+  }
+
+  int left = 0;
+  for (int i = 0; i < kNumSmall; i++) {
+    std::string key = StringPrintf("small %d", i);
+    if (cache_->OpenEntry(key, &entry)) {
+      left++;
+      entry->Close();
+    }
+  }
+  return left;
+}
+
+// A plain LRU evicts the oldest entries, no matter how often they were used.
+TEST_F(DiskCacheBackendTest, LruReusedEntries) {
+  EXPECT_EQ(0, BackendReusedEntriesLeft());
+  EXPECT_EQ(disk_cache::LRU_EVICTION, cache_impl_->eviction_policy());
+}
+
+// With the segmented policy, the reused entries are protected from the large
+// ones (up to the limit of the protected list).
+TEST_F(DiskCacheBackendTest, SegmentedReusedEntries) {
+  SetSegmentedEviction();
+  EXPECT_LE(7, BackendReusedEntriesLeft());
+
+  disk_cache::StatsItems stats;
+  cache_impl_->GetStats(&stats);
+  bool found = false;
+  for (size_t i = 0; i < stats.size(); i++) {
+    if (stats[i].first == "Protected hit ratio") {
+      EXPECT_NE("0%", stats[i].second);
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
+
+// The eviction policy is stored with the cache.
+TEST_F(DiskCacheBackendTest, EvictionPolicyPersists) {
+  SetSegmentedEviction();
+  InitCache();
+  EXPECT_EQ(disk_cache::SEGMENTED_EVICTION, cache_impl_->eviction_policy());
+  delete cache_impl_;
+
+  // The default policy does not apply to an existing cache.
+  cache_impl_ = new disk_cache::BackendImpl(GetCachePath());
+  cache_ = cache_impl_;
+  ASSERT_TRUE(cache_impl_->Init());
+  EXPECT_EQ(disk_cache::SEGMENTED_EVICTION, cache_impl_->eviction_policy());
+}
+
 TEST_F(DiskCacheTest, Backend_RecoverInsert) {
   // Tests with an empty cache.
   EXPECT_EQ(0, TestTransaction(L"insert_empty1", 0, false));
@@ -974,3 +1154,78 @@ TEST_F(DiskCacheBackendTest, MemoryOnlyDoomAll) {
   BackendDoomAll();
 }
 
+TEST_F(DiskCacheBackendTest, ShardedDoomAll) {
+  SetShardedMode(4);
+  InitCache();
+  BackendDoomAll();
+}
+
+namespace {
+
+// Creates, writes, reads back and dooms a set of entries of its own.
+class ShardedCacheUser : public PlatformThread::Delegate {
+ public:
+  ShardedCacheUser(disk_cache::Backend* cache, int id)
+      : cache_(cache), id_(id), errors_(0) {}
+
+  virtual void ThreadMain() {
+    const int kNumEntries = 50;
+    char buffer[100];
+    for (int i = 0; i < kNumEntries; i++) {
+      std::string key = StringPrintf("thread %d key %d", id_, i);
+      disk_cache::Entry* entry;
+      if (!cache_->CreateEntry(key, &entry)) {
+        errors_++;
+        continue;
+      }
+      if (static_cast<int>(key.size()) !=
+          entry->WriteData(0, 0, key.data(), static_cast<int>(key.size()),
+                           NULL, false))
+        errors_++;
+      entry->Close();
+
+      if (!cache_->OpenEntry(key, &entry)) {
+        errors_++;
+        continue;
+      }
+      int read = entry->ReadData(0, 0, buffer, sizeof(buffer), NULL);
+      if (key != std::string(buffer, std::max(read, 0)))
+        errors_++;
+      if (i % 2)
+        entry->Doom();
+      entry->Close();
+    }
+  }
+
+  int errors() const { return errors_; }
+
+ private:
+  disk_cache::Backend* cache_;
+  int id_;
+  int errors_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardedCacheUser);
+};
+
+}  // namespace
+
+// Tests that a sharded cache can be used from multiple threads at once.
+TEST_F(DiskCacheBackendTest, ShardedConcurrentAccess) {
+  SetShardedMode(4);
+  InitCache();
+
+  const int kNumThreads = 4;
+  scoped_ptr<ShardedCacheUser> users[kNumThreads];
+  PlatformThreadHandle threads[kNumThreads];
+  for (int i = 0; i < kNumThreads; i++) {
+    users[i].reset(new ShardedCacheUser(cache_, i));
+    ASSERT_TRUE(PlatformThread::Create(0, users[i].get(), &threads[i]));
+  }
+
+  for (int i = 0; i < kNumThreads; i++) {
+    PlatformThread::Join(threads[i]);
+    EXPECT_EQ(0, users[i]->errors());
+  }
+  EXPECT_EQ(kNumThreads * 25, cache_->GetEntryCount());
+}
+
@@ -5,9 +5,9 @@
 #include "net/disk_cache/block_files.h"
 
 #include "base/file_util.h"
-#include "base/histogram.h"
 #include "base/string_util.h"
 #include "base/time.h"
+#include "net/disk_cache/backend_impl.h"
 #include "net/disk_cache/file_lock.h"
 
 namespace {
@@ -38,7 +38,6 @@ bool CreateMapBlock(int target, int size, disk_cache::BlockFileHeader* header,
     return false;
   }
 
-  Time start = Time::Now();
   // We are going to process the map on 32-block chunks (32 bits), and on every
   // chunk, iterate through the 8 nibbles where the new block can be located.
   int current = header->hints[target - 1];
@@ -64,7 +63,6 @@ bool CreateMapBlock(int target, int size, disk_cache::BlockFileHeader* header,
       if (target != size) {
         header->empty[target - size - 1]++;
       }
-      HISTOGRAM_TIMES(L"DiskCache.CreateBlock", Time::Now() - start);
       return true;
     }
   }
@@ -83,7 +81,6 @@ void DeleteMapBlock(int index, int size, disk_cache::BlockFileHeader* header) {
     NOTREACHED();
     return;
   }
-  Time start = Time::Now();
   int byte_index = index / 8;
   uint8* byte_map = reinterpret_cast<uint8*>(header->allocation_map);
   uint8 map_block = byte_map[byte_index];
@@ -112,7 +109,6 @@ void DeleteMapBlock(int index, int size, disk_cache::BlockFileHeader* header) {
   }
   header->num_entries--;
   DCHECK(header->num_entries >= 0);
-  HISTOGRAM_TIMES(L"DiskCache.DeleteBlock", Time::Now() - start);
 }
 
 // Restores the "empty counters" and allocation hints.
@@ -305,7 +301,9 @@ MappedFile* BlockFiles::FileForNewBlock(FileType block_type, int block_count) {
       return NULL;
     break;
   }
-  HISTOGRAM_TIMES(L"DiskCache.GetFileForNewBlock", Time::Now() - start);
+  if (backend_)
+    backend_->RecordTime(BackendImpl::GET_FILE_FOR_NEW_BLOCK,
+                         Time::Now() - start);
   return file;
 }
 
@@ -363,9 +361,12 @@ bool BlockFiles::CreateBlock(FileType block_type, int block_count,
   }
 
   DCHECK(target_size);
+  Time start = Time::Now();
   int index;
   if (!CreateMapBlock(target_size, block_count, header, &index))
     return false;
+  if (backend_)
+    backend_->RecordTime(BackendImpl::CREATE_BLOCK, Time::Now() - start);
 
   Addr address(block_type, block_count, header->this_file, index);
   block_address->set_value(address.value());
@@ -391,7 +392,10 @@ void BlockFiles::DeleteBlock(Addr address, bool deep) {
     file->Write(zero_buffer_, size, offset);
 
   BlockFileHeader* header = reinterpret_cast<BlockFileHeader*>(file->buffer());
+  Time start = Time::Now();
   DeleteMapBlock(address.start_block(), address.num_blocks(), header);
+  if (backend_)
+    backend_->RecordTime(BackendImpl::DELETE_BLOCK, Time::Now() - start);
 }
 
 bool BlockFiles::FixBlockFileHeader(MappedFile* file) {
@@ -14,13 +14,14 @@
 
 namespace disk_cache {
 
+class BackendImpl;
 class EntryImpl;
 
 // This class handles the set of block-files open by the disk cache.
 class BlockFiles {
  public:
   explicit BlockFiles(const std::wstring& path)
-      : init_(false), zero_buffer_(NULL), path_(path) {}
+      : init_(false), zero_buffer_(NULL), path_(path), backend_(NULL) {}
   ~BlockFiles();
 
   // Performs the object initialization. create_files indicates if the backing
@@ -44,6 +45,10 @@ class BlockFiles {
   // cache is being purged.
   void CloseFiles();
 
+  // Sets the cache that records our histograms. Without one, nothing is
+  // recorded.
+  void set_backend(BackendImpl* backend) { backend_ = backend; }
+
  private:
   // Set force to true to overwrite the file if it exists.
   bool CreateBlockFile(int index, FileType file_type, bool force);
@@ -71,6 +76,7 @@ class BlockFiles {
   char* zero_buffer_;  // Buffer to speed-up cleaning deleted entries.
   std::wstring path_;  // Path to the backing folder.
   std::vector<MappedFile*> block_files_;  // The actual files.
+  BackendImpl* backend_;  // The cache that records our histograms, if any.
 
   DISALLOW_EVIL_CONSTRUCTORS(BlockFiles);
 };
@@ -7,6 +7,7 @@
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/string_util.h"
+#include "net/disk_cache/file.h"
 
 namespace disk_cache {
 
@@ -34,9 +35,7 @@ bool DeleteCacheFile(const std::wstring& name) {
 }
 
 void WaitForPendingIO(int* num_pending_io) {
-  if (*num_pending_io) {
-    NOTIMPLEMENTED();
-  }
+  File::WaitForPendingIO(num_pending_io);
 }
 
 }  // namespace disk_cache
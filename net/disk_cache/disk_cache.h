@@ -39,6 +39,14 @@ Backend* CreateCacheBackend(const std::wstring& path, bool force,
 // pointer can be NULL if a fatal error is found.
 Backend* CreateInMemoryCacheBackend(int max_bytes);
 
+// Returns an instance of a Backend that splits the cache stored on |path| into
+// |num_shards| independent parts, so that it can be used from multiple threads
+// at the same time. The same number of shards must be used every time that a
+// given folder is opened. See CreateCacheBackend for the meaning of the rest of
+// the arguments.
+Backend* CreateShardedCacheBackend(const std::wstring& path, bool force,
+                                   int max_bytes, int num_shards);
+
 // The root interface for a disk cache instance.
 class Backend {
  public:
@@ -96,6 +104,11 @@ class Backend {
 };
 
 // This interface represents an entry in the disk cache.
+//
+// An entry stores up to three streams of data, selected by the |index| passed
+// to ReadData and WriteData. The third stream (index 2) keeps track of the
+// sparse data of the entry, so an entry that uses ReadSparseData and
+// WriteSparseData should only access the first two streams directly.
 class Entry {
  public:
   // Marks this cache entry for deletion.
@@ -147,6 +160,28 @@ class Entry {
                         net::CompletionCallback* completion_callback,
                         bool truncate) = 0;
 
+  // Behaves like ReadData() except that this method reads the sparse data of
+  // the entry, which is addressed with 64-bit offsets and may have holes. The
+  // return value is the number of consecutive bytes that are stored starting
+  // at |offset| (up to |buf_len|), so it is zero if the byte at |offset| has
+  // not been written.
+  virtual int ReadSparseData(int64 offset, char* buf, int buf_len,
+                             net::CompletionCallback* completion_callback) = 0;
+
+  // Behaves like WriteData() except that this method writes the sparse data of
+  // the entry. Writing past the end of the stored data leaves a hole, and there
+  // is no way to truncate the sparse data: the entry should be doomed instead.
+  virtual int WriteSparseData(int64 offset, const char* buf, int buf_len,
+                              net::CompletionCallback* completion_callback) = 0;
+
+  // Returns information about the stored portion of the sparse data. |offset|
+  // and |len| describe the range to look at. |start| is set to the offset of
+  // the first stored byte within that range, and the return value is the
+  // number of consecutive bytes stored from there on, without going past the
+  // end of the range. Returns 0 if nothing within the range is stored, or a
+  // network error code.
+  virtual int GetAvailableRange(int64 offset, int len, int64* start) = 0;
+
  protected:
   virtual ~Entry() {}
 };
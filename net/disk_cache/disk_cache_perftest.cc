@@ -4,14 +4,18 @@
 
 #include <fcntl.h>
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/file_util.h"
 #include "base/perftimer.h"
+#include "base/platform_thread.h"
 #if defined(OS_WIN)
 #include "base/scoped_handle.h"
 #endif
+#include "base/scoped_ptr.h"
 #include "base/string_util.h"
 #include "base/timer.h"
 #include "net/base/net_errors.h"
@@ -20,6 +24,8 @@
 #include "net/disk_cache/disk_cache_test_base.h"
 #include "net/disk_cache/disk_cache_test_util.h"
 #include "net/disk_cache/hash.h"
+#include "net/disk_cache/mem_backend_impl.h"
+#include "net/disk_cache/sharded_backend.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 extern int g_cache_tests_max_id;
@@ -188,6 +194,66 @@ int TimeRead(int num_entries, disk_cache::Backend* cache,
   return expected;
 }
 
+// Opens and reads entries from a cache shared with other threads.
+class CacheReader : public PlatformThread::Delegate {
+ public:
+  CacheReader(disk_cache::Backend* cache, const TestEntries& entries,
+              int num_reads)
+      : cache_(cache), entries_(entries), num_reads_(num_reads), errors_(0) {}
+
+  virtual void ThreadMain() {
+    char buffer[kMaxSize];
+    for (int i = 0; i < num_reads_; i++) {
+      const TestEntry& entry = entries_[rand() % entries_.size()];
+      disk_cache::Entry* cache_entry;
+      if (!cache_->OpenEntry(entry.key, &cache_entry)) {
+        errors_++;
+        continue;
+      }
+      if (entry.data_len != cache_entry->ReadData(1, 0, buffer, entry.data_len,
+                                                  NULL))
+        errors_++;
+      cache_entry->Close();
+    }
+  }
+
+  int errors() const { return errors_; }
+
+ private:
+  disk_cache::Backend* cache_;
+  const TestEntries& entries_;
+  int num_reads_;
+  int errors_;
+
+  DISALLOW_COPY_AND_ASSIGN(CacheReader);
+};
+
+// Times |num_threads| threads reading |num_reads| entries each from |cache|.
+// Returns the number of errors found.
+int TimeConcurrentRead(disk_cache::Backend* cache, const TestEntries& entries,
+                       int num_threads, int num_reads, int num_shards) {
+  std::string message = StringPrintf("Read %d shards with %d threads",
+                                     num_shards, num_threads);
+  PerfTimeLogger timer(message.c_str());
+
+  std::vector<CacheReader*> readers;
+  std::vector<PlatformThreadHandle> threads(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    readers.push_back(new CacheReader(cache, entries, num_reads));
+    if (!PlatformThread::Create(0, readers[i], &threads[i]))
+      return num_reads;
+  }
+
+  int errors = 0;
+  for (int i = 0; i < num_threads; i++) {
+    PlatformThread::Join(threads[i]);
+    errors += readers[i]->errors();
+    delete readers[i];
+  }
+  timer.Done();
+  return errors;
+}
+
 int BlockSize() {
   // We can use form 1 to 4 blocks.
   return (rand() & 0x3) + 1;
@@ -258,6 +324,120 @@ TEST_F(DiskCacheTest, CacheBackendPerformance) {
   delete cache;
 }
 
+// Measures how the throughput of a multi-threaded workload scales with the
+// number of shards of the cache.
+TEST_F(DiskCacheTest, ShardedBackendPerformance) {
+  MessageLoopForIO message_loop;
+
+  int seed = static_cast<int>(Time::Now().ToInternalValue());
+  srand(seed);
+
+  const int kNumEntries = 1000;
+  const int kNumReads = 2000;
+  const int kShards[] = { 1, 8 };
+  for (size_t i = 0; i < arraysize(kShards); i++) {
+    std::wstring path = GetCachePath();
+    for (int j = 0; j < kShards[i]; j++) {
+      std::wstring shard_path =
+          disk_cache::ShardedBackend::GetShardPath(path, j);
+      ASSERT_TRUE(DeleteCache(shard_path.c_str()));
+    }
+    scoped_ptr<disk_cache::Backend> cache(
+        disk_cache::CreateShardedCacheBackend(path, true, 0, kShards[i]));
+    ASSERT_TRUE(NULL != cache.get());
+
+    TestEntries entries;
+    TimeWrite(kNumEntries, cache.get(), &entries);
+    ASSERT_EQ(kNumEntries, cache->GetEntryCount());
+
+    for (int threads = 1; threads <= 8; threads *= 2) {
+      EXPECT_EQ(0, TimeConcurrentRead(cache.get(), entries, threads,
+                                      kNumReads / threads, kShards[i]));
+    }
+    EXPECT_TRUE(cache->DoomAllEntries());
+  }
+}
+
+// Measures the memory used by the memory-only cache to store a typical mix of
+// entries (compared to the amount of data that they hold), and the speed of
+// key lookups.
+TEST_F(DiskCacheTest, MemBackendPerformance) {
+  int seed = static_cast<int>(Time::Now().ToInternalValue());
+  srand(seed);
+
+  const int kNumEntries = 20000;
+  const int kNumLookups = 1000000;
+  disk_cache::MemBackendImpl cache;
+  ASSERT_TRUE(cache.SetMaxSize(kint32max));
+  ASSERT_TRUE(cache.Init());
+
+  // Headers on the first stream and the body on the second one.
+  scoped_array<char> buffer(new char[64 * 1024]);
+  CacheTestFillBuffer(buffer.get(), 64 * 1024, false);
+  std::vector<std::string> keys;
+  int64 data_size = 0;
+
+  PerfTimeLogger timer1("Fill the memory cache");
+  for (int i = 0; i < kNumEntries; i++) {
+    std::string key = GenerateKey(true);
+    disk_cache::Entry* entry;
+    if (!cache.CreateEntry(key, &entry))
+      continue;
+
+    int header_size = 200 + rand() % 800;
+    int body_size = rand() % 8 ? 1024 + rand() % (15 * 1024) :
+                                 16 * 1024 + rand() % (48 * 1024);
+    EXPECT_EQ(header_size, entry->WriteData(0, 0, buffer.get(), header_size,
+                                            NULL, false));
+    // Bodies are written in chunks, as they arrive from the network.
+    for (int offset = 0; offset < body_size; offset += 4096) {
+      int len = std::min(4096, body_size - offset);
+      EXPECT_EQ(len, entry->WriteData(1, offset, buffer.get(), len, NULL,
+                                      false));
+    }
+    entry->Close();
+    keys.push_back(key);
+    data_size += key.size() + header_size + body_size;
+  }
+  timer1.Done();
+
+  LogPerfResult("MemBackend_data_size", static_cast<double>(data_size),
+                "bytes");
+  LogPerfResult("MemBackend_charged_size", cache.current_size(), "bytes");
+  LogPerfResult("MemBackend_resident_size",
+                static_cast<double>(cache.resident_size()), "bytes");
+  LogPerfResult("MemBackend_overhead",
+                100.0 * (cache.resident_size() - data_size) / data_size, "%");
+
+  PerfTimeLogger timer2("Memory cache lookups");
+  int hits = 0;
+  for (int i = 0; i < kNumLookups; i++) {
+    disk_cache::Entry* entry;
+    if (cache.OpenEntry(keys[rand() % keys.size()], &entry)) {
+      hits++;
+      entry->Close();
+    }
+  }
+  timer2.Done();
+  EXPECT_EQ(kNumLookups, hits);
+
+  std::vector<std::string> missing_keys;
+  for (int i = 0; i < kNumLookups / 10; i++)
+    missing_keys.push_back(GenerateKey(true) + "x");
+
+  PerfTimeLogger timer3("Memory cache failed lookups");
+  for (size_t i = 0; i < missing_keys.size(); i++) {
+    disk_cache::Entry* entry;
+    EXPECT_FALSE(cache.OpenEntry(missing_keys[i], &entry));
+  }
+  timer3.Done();
+
+  PerfTimeLogger timer4("Empty the memory cache");
+  EXPECT_TRUE(cache.DoomAllEntries());
+  timer4.Done();
+  EXPECT_EQ(0, cache.current_size());
+}
+
 // Creating and deleting "entries" on a block-file is something quite frequent
 // (after all, almost everything is stored on block files). The operation is
 // almost free when the file is empty, but can be expensive if the file gets
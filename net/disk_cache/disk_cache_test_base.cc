@@ -7,6 +7,7 @@
 #include "net/disk_cache/backend_impl.h"
 #include "net/disk_cache/disk_cache_test_util.h"
 #include "net/disk_cache/mem_backend_impl.h"
+#include "net/disk_cache/sharded_backend.h"
 
 void DiskCacheTestWithCache::SetMaxSize(int size) {
   size_ = size;
@@ -49,8 +50,20 @@ void DiskCacheTestWithCache::InitMemoryCache() {
 
 void DiskCacheTestWithCache::InitDiskCache() {
   std::wstring path = GetCachePath();
-  if (first_cleanup_)
+  if (first_cleanup_) {
     ASSERT_TRUE(DeleteCache(path.c_str()));
+    for (int i = 0; i < num_shards_; i++) {
+      std::wstring shard_path =
+          disk_cache::ShardedBackend::GetShardPath(path, i);
+      ASSERT_TRUE(DeleteCache(shard_path.c_str()));
+    }
+  }
+
+  if (num_shards_) {
+    cache_ = disk_cache::CreateShardedCacheBackend(path, force_creation_, size_,
+                                                   num_shards_);
+    return;
+  }
 
   if (!implementation_) {
     cache_ = disk_cache::CreateCacheBackend(path, force_creation_, size_);
@@ -68,6 +81,9 @@ void DiskCacheTestWithCache::InitDiskCache() {
   if (size_)
     EXPECT_TRUE(cache_impl_->SetMaxSize(size_));
 
+  if (segmented_eviction_)
+    cache_impl_->SetEvictionPolicy(disk_cache::SEGMENTED_EVICTION);
+
   ASSERT_TRUE(cache_impl_->Init());
 }
 
@@ -77,7 +93,14 @@ void DiskCacheTestWithCache::TearDown() {
 
   if (!memory_only_) {
     std::wstring path = GetCachePath();
-    EXPECT_TRUE(CheckCacheIntegrity(path));
+    if (num_shards_) {
+      for (int i = 0; i < num_shards_; i++) {
+        EXPECT_TRUE(CheckCacheIntegrity(
+            disk_cache::ShardedBackend::GetShardPath(path, i)));
+      }
+    } else {
+      EXPECT_TRUE(CheckCacheIntegrity(path));
+    }
   }
 
   PlatformTest::TearDown();
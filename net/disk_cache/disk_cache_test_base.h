@@ -28,8 +28,9 @@ class DiskCacheTestWithCache : public DiskCacheTest {
  protected:
   DiskCacheTestWithCache()
       : cache_(NULL), cache_impl_(NULL), mem_cache_(NULL), mask_(0), size_(0),
-        memory_only_(false), implementation_(false), force_creation_(false),
-        first_cleanup_(true) {}
+        num_shards_(0), memory_only_(false), implementation_(false),
+        force_creation_(false), first_cleanup_(true),
+        segmented_eviction_(false) {}
 
   void InitCache();
   virtual void TearDown();
@@ -40,11 +41,22 @@ class DiskCacheTestWithCache : public DiskCacheTest {
     memory_only_ = true;
   }
 
+  // Splits the cache into |num_shards| parts, through a ShardedBackend.
+  void SetShardedMode(int num_shards) {
+    num_shards_ = num_shards;
+  }
+
   // Use the implementation directly instead of the factory provided object.
   void SetDirectMode() {
     implementation_ = true;
   }
 
+  // Creates the cache with the segmented eviction policy.
+  void SetSegmentedEviction() {
+    segmented_eviction_ = true;
+    implementation_ = true;
+  }
+
   void SetMask(uint32 mask) {
     mask_ = mask;
   }
@@ -68,10 +80,12 @@ class DiskCacheTestWithCache : public DiskCacheTest {
 
   uint32 mask_;
   int size_;
+  int num_shards_;
   bool memory_only_;
   bool implementation_;
   bool force_creation_;
   bool first_cleanup_;
+  bool segmented_eviction_;
 
  private:
   void InitMemoryCache();
@@ -51,6 +51,13 @@
 // When the cache encounters an entry whose identifier is different than the one
 // being currently used, it means that the entry was not properly closed on a
 // previous run, so it is discarded.
+//
+// The sparse data of an entry (see Entry::ReadSparseData) is split into pieces
+// of kSparseChildSize bytes, each one stored by a regular "child" entry. The
+// third data stream of the parent entry holds a SparseHeader, and the first
+// stream of every child a SparseChildHeader, both with the same signature; the
+// key of a child is derived from that signature, so children left behind by a
+// previous entry with the same key are never mistaken for ours.
 
 #ifndef NET_DISK_CACHE_DISK_FORMAT_H__
 #define NET_DISK_CACHE_DISK_FORMAT_H__
@@ -63,7 +70,23 @@ typedef uint32 CacheAddr;
 
 const int kIndexTablesize = 0x10000;
 const uint32 kIndexMagic = 0xC103CAC3;
-const uint32 kCurrentVersion = 0x10003;  // Version 1.3.
+const uint32 kCurrentVersion = 0x20001;  // Version 2.1.
+
+// Eviction policies for the cache. The one in use is recorded on the index
+// header when the cache is created.
+enum EvictionPolicy {
+  LRU_EVICTION = 0,       // A single LRU list.
+  SEGMENTED_EVICTION = 1  // Probationary and protected lists (see Rankings).
+};
+
+// Bookkeeping for the LRU lists of the cache.
+struct LruData {
+  int32       policy;        // One of EvictionPolicy.
+  int32       sizes[2];      // Number of entries on each list.
+  CacheAddr   heads[2];      // Head and tail of each list.
+  CacheAddr   tails[2];
+  int32       pad;
+};
 
 // Header for the master index file.
 struct IndexHeader {
@@ -75,7 +98,7 @@ struct IndexHeader {
   int32       this_id;       // Id for all entries being changed (dirty flag).
   CacheAddr   stats;         // Storage for usage data.
   int32       table_len;     // Actual size of the table (0 == kIndexTablesize).
-  int32       pad[8];
+  LruData     lru;           // Eviction control data.
   IndexHeader() {
     memset(this, 0, sizeof(*this));
     magic = kIndexMagic;
@@ -101,11 +124,14 @@ struct EntryStore {
   CacheAddr   rankings_node;      // Rankings node for this entry.
   int32       key_len;
   CacheAddr   long_key;           // Optional address of a long key.
-  int32       data_size[2];       // We can store up to 2 data chunks for each
-  CacheAddr   data_addr[2];       // entry.
-  char        key[256 - 9 * 4];   // null terminated
+  int32       data_size[3];       // We can store up to 3 data chunks for each
+  CacheAddr   data_addr[3];       // entry.
+  int32       reuse_count;        // How often this entry was opened.
+  int32       list;               // Rankings list that holds this entry.
+  char        key[256 - 13 * 4];  // null terminated
 };
 
+COMPILE_ASSERT(sizeof(IndexHeader) == 64, bad_IndexHeader);
 COMPILE_ASSERT(sizeof(EntryStore) == 256, bad_EntyStore);
 const int kMaxInternalKeyLength = 4 * sizeof(EntryStore) -
                                   offsetof(EntryStore, key) - 1;
@@ -162,6 +188,31 @@ struct BlockFileHeader {
 
 COMPILE_ASSERT(sizeof(BlockFileHeader) == kBlockHeaderSize, bad_header);
 
+const uint32 kSparseMagic = 0xC105CAC3;
+const int kSparseIndex = 2;  // The data stream of the parent entry to use.
+const int kSparseChildSize = 1024 * 1024;  // The data stored by each child.
+
+// Header of the sparse data of an entry. It is followed by a bitmap with one
+// bit per child, set if the child may exist.
+struct SparseHeader {
+  int64       signature;          // Shared by the parent and its children.
+  uint32      magic;
+  int32       unused;
+};
+
+// Header of a child entry, stored on its first data stream (the data goes on
+// the second one). It is followed by |num_ranges| pairs of int32 values, the
+// start and end offsets (within the child) of the ranges of data that are
+// stored, sorted and without overlaps.
+struct SparseChildHeader {
+  int64       signature;          // Must match the one of the parent.
+  uint32      magic;
+  int32       num_ranges;
+};
+
+COMPILE_ASSERT(sizeof(SparseHeader) == 16, bad_SparseHeader);
+COMPILE_ASSERT(sizeof(SparseChildHeader) == 16, bad_SparseChildHeader);
+
 }  // namespace disk_cache
 
 #endif  // NET_DISK_CACHE_DISK_FORMAT_H__
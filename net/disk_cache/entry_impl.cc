@@ -4,12 +4,12 @@
 
 #include "net/disk_cache/entry_impl.h"
 
-#include "base/histogram.h"
 #include "base/message_loop.h"
 #include "base/string_util.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/backend_impl.h"
 #include "net/disk_cache/cache_util.h"
+#include "net/disk_cache/sparse_control.h"
 
 namespace {
 
@@ -88,7 +88,8 @@ EntryImpl::EntryImpl(BackendImpl* backend, Addr address)
   entry_.LazyInit(backend->File(address), address);
   doomed_ = false;
   backend_ = backend;
-  unreported_size_[0] = unreported_size_[1] = 0;
+  for (int i = 0; i < kKeyFileIndex; i++)
+    unreported_size_[i] = 0;
 }
 
 // When an entry is deleted from the cache, we clean up all the data associated
@@ -98,9 +99,12 @@ EntryImpl::EntryImpl(BackendImpl* backend, Addr address)
 // data related to a previous cache entry because the range was not fully
 // written before).
 EntryImpl::~EntryImpl() {
+  // The children of a sparse entry must be closed before we go away.
+  sparse_.reset();
+
   if (doomed_) {
-    UMA_HISTOGRAM_COUNTS(L"DiskCache.DeleteHeader", GetDataSize(0));
-    UMA_HISTOGRAM_COUNTS(L"DiskCache.DeleteData", GetDataSize(1));
+    backend_->RecordCount(BackendImpl::DELETE_HEADER, GetDataSize(0));
+    backend_->RecordCount(BackendImpl::DELETE_DATA, GetDataSize(1));
     for (int index = 0; index < kKeyFileIndex; index++) {
       Addr address(entry_.Data()->data_addr[index]);
       if (address.is_initialized()) {
@@ -157,6 +161,10 @@ void EntryImpl::Doom() {
   if (doomed_)
     return;
 
+  // The sparse data lives on other entries, so they go away with this one.
+  if (GetDataSize(kSparseIndex))
+    GetSparseControl()->DeleteChildren();
+
   SetPointerForInvalidEntry(backend_->GetCurrentEntryId());
   backend_->InternalDoomEntry(this);
 }
@@ -198,7 +206,7 @@ Time EntryImpl::GetLastModified() const {
 }
 
 int32 EntryImpl::GetDataSize(int index) const {
-  if (index < 0 || index > 1)
+  if (index < 0 || index >= kKeyFileIndex)
     return 0;
 
   CacheEntryBlock* entry = const_cast<CacheEntryBlock*>(&entry_);
@@ -208,7 +216,7 @@ int32 EntryImpl::GetDataSize(int index) const {
 int EntryImpl::ReadData(int index, int offset, char* buf, int buf_len,
                         net::CompletionCallback* completion_callback) {
   DCHECK(node_.Data()->dirty);
-  if (index < 0 || index > 1)
+  if (index < 0 || index >= kKeyFileIndex)
     return net::ERR_INVALID_ARGUMENT;
 
   int entry_size = entry_.Data()->data_size[index];
@@ -219,9 +227,6 @@ int EntryImpl::ReadData(int index, int offset, char* buf, int buf_len,
     return net::ERR_INVALID_ARGUMENT;
 
   Time start = Time::Now();
-  static Histogram stats(L"DiskCache.ReadTime", TimeDelta::FromMilliseconds(1),
-                         TimeDelta::FromSeconds(10), 50);
-  stats.SetFlags(kUmaTargetedHistogramFlag);
 
   if (offset + buf_len > entry_size)
     buf_len = entry_size - offset;
@@ -234,7 +239,7 @@ int EntryImpl::ReadData(int index, int offset, char* buf, int buf_len,
     // Complete the operation locally.
     DCHECK(kMaxBlockSize >= offset + buf_len);
     memcpy(buf , user_buffers_[index].get() + offset, buf_len);
-    stats.AddTime(Time::Now() - start);
+    backend_->RecordTime(BackendImpl::READ_TIME, Time::Now() - start);
     return buf_len;
   }
 
@@ -266,7 +271,7 @@ int EntryImpl::ReadData(int index, int offset, char* buf, int buf_len,
   if (io_callback && completed)
     io_callback->Discard();
 
-  stats.AddTime(Time::Now() - start);
+  backend_->RecordTime(BackendImpl::READ_TIME, Time::Now() - start);
   return (completed || !completion_callback) ? buf_len : net::ERR_IO_PENDING;
 }
 
@@ -274,7 +279,7 @@ int EntryImpl::WriteData(int index, int offset, const char* buf, int buf_len,
                          net::CompletionCallback* completion_callback,
                          bool truncate) {
   DCHECK(node_.Data()->dirty);
-  if (index < 0 || index > 1)
+  if (index < 0 || index >= kKeyFileIndex)
     return net::ERR_INVALID_ARGUMENT;
 
   if (offset < 0 || buf_len < 0)
@@ -293,9 +298,6 @@ int EntryImpl::WriteData(int index, int offset, const char* buf, int buf_len,
   }
 
   Time start = Time::Now();
-  static Histogram stats(L"DiskCache.WriteTime", TimeDelta::FromMilliseconds(1),
-                         TimeDelta::FromSeconds(10), 50);
-  stats.SetFlags(kUmaTargetedHistogramFlag);
 
   // Read the size at this point (it may change inside prepare).
   int entry_size = entry_.Data()->data_size[index];
@@ -330,7 +332,7 @@ int EntryImpl::WriteData(int index, int offset, const char* buf, int buf_len,
     // Complete the operation locally.
     DCHECK(kMaxBlockSize >= offset + buf_len);
     memcpy(user_buffers_[index].get() + offset, buf, buf_len);
-    stats.AddTime(Time::Now() - start);
+    backend_->RecordTime(BackendImpl::WRITE_TIME, Time::Now() - start);
     return buf_len;
   }
 
@@ -365,10 +367,34 @@ int EntryImpl::WriteData(int index, int offset, const char* buf, int buf_len,
   if (io_callback && completed)
     io_callback->Discard();
 
-  stats.AddTime(Time::Now() - start);
+  backend_->RecordTime(BackendImpl::WRITE_TIME, Time::Now() - start);
   return (completed || !completion_callback) ? buf_len : net::ERR_IO_PENDING;
 }
 
+int EntryImpl::ReadSparseData(int64 offset, char* buf, int buf_len,
+                              net::CompletionCallback* completion_callback) {
+  DCHECK(node_.Data()->dirty);
+  // The sparse data is always accessed synchronously, so the callback is not
+  // used.
+  int rv = GetSparseControl()->ReadData(offset, buf, buf_len);
+  if (rv > 0)
+    UpdateRank(false);
+  return rv;
+}
+
+int EntryImpl::WriteSparseData(int64 offset, const char* buf, int buf_len,
+                               net::CompletionCallback* completion_callback) {
+  DCHECK(node_.Data()->dirty);
+  int rv = GetSparseControl()->WriteData(offset, buf, buf_len);
+  if (rv > 0)
+    UpdateRank(true);
+  return rv;
+}
+
+int EntryImpl::GetAvailableRange(int64 offset, int len, int64* start) {
+  return GetSparseControl()->GetAvailableRange(offset, len, start);
+}
+
 uint32 EntryImpl::GetHash() {
   return entry_.Data()->hash;
 }
@@ -517,7 +543,7 @@ void EntryImpl::DecrementIoCount() {
 
 bool EntryImpl::CreateDataBlock(int index, int size) {
   Addr address(entry_.Data()->data_addr[index]);
-  DCHECK(0 == index || 1 == index);
+  DCHECK(index >= 0 && index < kKeyFileIndex);
 
   if (!CreateBlock(size, &address))
     return false;
@@ -564,7 +590,7 @@ void EntryImpl::DeleteData(Addr address, int index) {
 void EntryImpl::UpdateRank(bool modified) {
   if (!doomed_) {
     // Everything is handled by the backend.
-    backend_->UpdateRank(&node_, true);
+    backend_->UpdateRank(this, true);
     return;
   }
 
@@ -585,10 +611,10 @@ File* EntryImpl::GetBackingFile(Addr address, int index) {
 }
 
 File* EntryImpl::GetExternalFile(Addr address, int index) {
-  DCHECK(index >= 0 && index <= 2);
+  DCHECK(index >= 0 && index <= kKeyFileIndex);
   if (!files_[index].get()) {
     // For a key file, use mixed mode IO.
-    scoped_refptr<File> file(new File(2 == index));
+    scoped_refptr<File> file(new File(kKeyFileIndex == index));
     if (file->Init(backend_->GetFileName(address)))
       files_[index].swap(file);
   }
@@ -756,6 +782,12 @@ bool EntryImpl::Flush(int index, int size, bool async) {
   return true;
 }
 
+SparseControl* EntryImpl::GetSparseControl() {
+  if (!sparse_.get())
+    sparse_.reset(new SparseControl(backend_, this));
+  return sparse_.get();
+}
+
 void EntryImpl::Log(const char* msg) {
   void* pointer = NULL;
   int dirty = 0;
@@ -767,8 +799,9 @@ void EntryImpl::Log(const char* msg) {
   Trace("%s 0x%p 0x%x 0x%x", msg, reinterpret_cast<void*>(this),
         entry_.address().value(), node_.address().value());
 
-  Trace("  data: 0x%x 0x%x 0x%x", entry_.Data()->data_addr[0],
-        entry_.Data()->data_addr[1], entry_.Data()->long_key);
+  Trace("  data: 0x%x 0x%x 0x%x 0x%x", entry_.Data()->data_addr[0],
+        entry_.Data()->data_addr[1], entry_.Data()->data_addr[2],
+        entry_.Data()->long_key);
 
   Trace("  doomed: %d 0x%p 0x%x", doomed_, pointer, dirty);
 }
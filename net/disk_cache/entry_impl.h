@@ -5,6 +5,7 @@
 #ifndef NET_DISK_CACHE_ENTRY_IMPL_H__
 #define NET_DISK_CACHE_ENTRY_IMPL_H__
 
+#include "base/scoped_ptr.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/storage_block.h"
 #include "net/disk_cache/storage_block-inl.h"
@@ -12,6 +13,7 @@
 namespace disk_cache {
 
 class BackendImpl;
+class SparseControl;
 
 // This class implements the Entry interface. An object of this
 // class represents a single entry on the cache.
@@ -32,6 +34,11 @@ class EntryImpl : public Entry, public base::RefCounted<EntryImpl> {
   virtual int WriteData(int index, int offset, const char* buf, int buf_len,
                         net::CompletionCallback* completion_callback,
                         bool truncate);
+  virtual int ReadSparseData(int64 offset, char* buf, int buf_len,
+                             net::CompletionCallback* completion_callback);
+  virtual int WriteSparseData(int64 offset, const char* buf, int buf_len,
+                              net::CompletionCallback* completion_callback);
+  virtual int GetAvailableRange(int64 offset, int len, int64* start);
 
   inline CacheEntryBlock* entry() {
     return &entry_;
@@ -88,7 +95,7 @@ class EntryImpl : public Entry, public base::RefCounted<EntryImpl> {
   ~EntryImpl();
 
   // Index for the file used to store the key, if any (files_[kKeyFileIndex]).
-  static const int kKeyFileIndex = 2;
+  static const int kKeyFileIndex = 3;
 
   // Initializes the storage for an internal or external data block.
   bool CreateDataBlock(int index, int size);
@@ -124,15 +131,19 @@ class EntryImpl : public Entry, public base::RefCounted<EntryImpl> {
   // Flush the in-memory data to the backing storage.
   bool Flush(int index, int size, bool async);
 
+  // Returns the object that handles the sparse data of this entry.
+  SparseControl* GetSparseControl();
+
   // Logs this entry to the internal trace buffer.
   void Log(const char* msg);
 
   CacheEntryBlock entry_;     // Key related information for this entry.
   CacheRankingsBlock node_;   // Rankings related information for this entry.
   BackendImpl* backend_;      // Back pointer to the cache.
-  scoped_array<char> user_buffers_[2];  // Store user data.
-  scoped_refptr<File> files_[3];  // Files to store external user data and key.
-  int unreported_size_[2];    // Bytes not reported yet to the backend.
+  scoped_array<char> user_buffers_[3];  // Store user data.
+  scoped_refptr<File> files_[4];  // Files to store external user data and key.
+  int unreported_size_[3];    // Bytes not reported yet to the backend.
+  scoped_ptr<SparseControl> sparse_;  // Support for sparse entries.
   bool doomed_;               // True if this entry was removed from the cache.
 
   DISALLOW_EVIL_CONSTRUCTORS(EntryImpl);
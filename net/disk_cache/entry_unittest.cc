@@ -29,6 +29,9 @@ class DiskCacheEntryTest : public DiskCacheTestWithCache {
   void InvalidData();
   void DoomEntry();
   void DoomedEntry();
+  void BasicSparseIO();
+  void SparseHoles();
+  void DoomSparseEntry();
 };
 
 void DiskCacheEntryTest::InternalSyncIO() {
@@ -751,3 +754,248 @@ TEST_F(DiskCacheEntryTest, MemoryOnlyDoomedEntry) {
   DoomEntry();
 }
 
+// Verify that sparse data can be written and read back, even across children
+// and at big offsets.
+void DiskCacheEntryTest::BasicSparseIO() {
+  std::string key("the first key");
+  disk_cache::Entry* entry;
+  ASSERT_TRUE(cache_->CreateEntry(key, &entry));
+
+  const int kSize = 1024 * 1024 + 2048;
+  scoped_array<char> buffer1(new char[kSize]);
+  scoped_array<char> buffer2(new char[kSize]);
+  CacheTestFillBuffer(buffer1.get(), kSize, false);
+
+  // Nothing is stored yet.
+  EXPECT_EQ(0, entry->ReadSparseData(0, buffer2.get(), kSize, NULL));
+
+  // This write spans two children.
+  const int64 kOffset1 = 1024 * 1024 - 1024;
+  EXPECT_EQ(kSize, entry->WriteSparseData(kOffset1, buffer1.get(), kSize,
+                                          NULL));
+  const int64 kOffset2 = GG_INT64_C(0x500000000);
+  EXPECT_EQ(5000, entry->WriteSparseData(kOffset2, buffer1.get(), 5000, NULL));
+
+  memset(buffer2.get(), 0, kSize);
+  EXPECT_EQ(kSize, entry->ReadSparseData(kOffset1, buffer2.get(), kSize,
+                                         NULL));
+  EXPECT_EQ(0, memcmp(buffer1.get(), buffer2.get(), kSize));
+  entry->Close();
+
+  // The data is still there after reopening the entry, and the regular
+  // streams are not affected.
+  ASSERT_TRUE(cache_->OpenEntry(key, &entry));
+  EXPECT_EQ(0, entry->GetDataSize(0));
+  EXPECT_EQ(0, entry->GetDataSize(1));
+  memset(buffer2.get(), 0, kSize);
+  EXPECT_EQ(5000, entry->ReadSparseData(kOffset2, buffer2.get(), kSize, NULL));
+  EXPECT_EQ(0, memcmp(buffer1.get(), buffer2.get(), 5000));
+  EXPECT_EQ(100, entry->ReadSparseData(kOffset1 + 3000, buffer2.get(), 100,
+                                       NULL));
+  EXPECT_EQ(0, memcmp(buffer1.get() + 3000, buffer2.get(), 100));
+
+  // Reads stop at the end of the stored data.
+  EXPECT_EQ(kSize - 500, entry->ReadSparseData(kOffset1 + 500, buffer2.get(),
+                                               kSize, NULL));
+  EXPECT_EQ(0, entry->ReadSparseData(kOffset1 + kSize, buffer2.get(), kSize,
+                                     NULL));
+  entry->Close();
+}
+
+TEST_F(DiskCacheEntryTest, BasicSparseIO) {
+  InitCache();
+  BasicSparseIO();
+}
+
+TEST_F(DiskCacheEntryTest, MemoryOnlyBasicSparseIO) {
+  SetMemoryOnlyMode();
+  InitCache();
+  BasicSparseIO();
+}
+
+// Verify that holes on the sparse data are reported as such.
+void DiskCacheEntryTest::SparseHoles() {
+  std::string key("the first key");
+  disk_cache::Entry* entry;
+  ASSERT_TRUE(cache_->CreateEntry(key, &entry));
+
+  const int kSize = 16 * 1024;
+  char buffer1[kSize];
+  char buffer2[kSize];
+  CacheTestFillBuffer(buffer1, kSize, false);
+
+  int64 start;
+  EXPECT_EQ(0, entry->GetAvailableRange(0, kSize, &start));
+  EXPECT_EQ(0, start);
+
+  // Store [20000, 36384) and [40000, 56384), and then fill the gap partially.
+  EXPECT_EQ(kSize, entry->WriteSparseData(20000, buffer1, kSize, NULL));
+  EXPECT_EQ(kSize, entry->WriteSparseData(40000, buffer1, kSize, NULL));
+  EXPECT_EQ(0, entry->ReadSparseData(19999, buffer2, kSize, NULL));
+  EXPECT_EQ(kSize, entry->ReadSparseData(20000, buffer2, kSize, NULL));
+  EXPECT_EQ(kSize - 100, entry->ReadSparseData(20100, buffer2, kSize, NULL));
+  EXPECT_EQ(0, memcmp(buffer1 + 100, buffer2, kSize - 100));
+
+  EXPECT_EQ(kSize, entry->GetAvailableRange(0, 100000, &start));
+  EXPECT_EQ(20000, start);
+  EXPECT_EQ(1000, entry->GetAvailableRange(35384, 5000, &start));
+  EXPECT_EQ(35384, start);
+  EXPECT_EQ(100, entry->GetAvailableRange(36400, 3700, &start));
+  EXPECT_EQ(40000, start);
+  EXPECT_EQ(0, entry->GetAvailableRange(36384, 3616, &start));
+
+  EXPECT_EQ(3616, entry->WriteSparseData(36384, buffer1, 3616, NULL));
+  EXPECT_EQ(kSize * 2 + 3616, entry->GetAvailableRange(0, 100000, &start));
+  EXPECT_EQ(20000, start);
+
+  // A hole that spans a whole child.
+  const int64 kChild = 1024 * 1024;
+  EXPECT_EQ(kSize, entry->WriteSparseData(kChild * 3, buffer1, kSize, NULL));
+  EXPECT_EQ(kSize, entry->GetAvailableRange(kChild / 2, kChild * 3,
+                                            &start));
+  EXPECT_EQ(kChild * 3, start);
+  EXPECT_EQ(0, entry->ReadSparseData(kChild * 2, buffer2, kSize, NULL));
+
+  // Data that is contiguous across children is reported as one range.
+  EXPECT_EQ(kSize, entry->WriteSparseData(kChild * 3 - kSize, buffer1, kSize,
+                                          NULL));
+  EXPECT_EQ(kSize * 2, entry->GetAvailableRange(kChild * 2, kChild * 2,
+                                                &start));
+  EXPECT_EQ(kChild * 3 - kSize, start);
+  entry->Close();
+}
+
+TEST_F(DiskCacheEntryTest, SparseHoles) {
+  InitCache();
+  SparseHoles();
+}
+
+TEST_F(DiskCacheEntryTest, MemoryOnlySparseHoles) {
+  SetMemoryOnlyMode();
+  InitCache();
+  SparseHoles();
+}
+
+// Verify that the children of a sparse entry go away with the entry.
+void DiskCacheEntryTest::DoomSparseEntry() {
+  std::string key1("the first key");
+  std::string key2("the second key");
+  disk_cache::Entry *entry1, *entry2;
+  ASSERT_TRUE(cache_->CreateEntry(key1, &entry1));
+  ASSERT_TRUE(cache_->CreateEntry(key2, &entry2));
+
+  const int kSize = 4 * 1024;
+  char buffer[kSize];
+  CacheTestFillBuffer(buffer, kSize, false);
+
+  int64 offset = 1024 * 1024;
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(kSize, entry1->WriteSparseData(offset, buffer, kSize, NULL));
+    EXPECT_EQ(kSize, entry2->WriteSparseData(offset, buffer, kSize, NULL));
+    offset *= 4;
+  }
+  // Each entry stores data on five children.
+  EXPECT_EQ(12, cache_->GetEntryCount());
+
+  entry1->Close();
+  EXPECT_TRUE(cache_->DoomEntry(key1));
+  EXPECT_EQ(6, cache_->GetEntryCount());
+
+  entry2->Doom();
+  entry2->Close();
+  EXPECT_EQ(0, cache_->GetEntryCount());
+}
+
+TEST_F(DiskCacheEntryTest, DoomSparseEntry) {
+  InitCache();
+  DoomSparseEntry();
+}
+
+TEST_F(DiskCacheEntryTest, MemoryOnlyDoomSparseEntry) {
+  SetMemoryOnlyMode();
+  InitCache();
+  DoomSparseEntry();
+}
+
+// Verify that the backend can doom a sparse entry whose children are next to
+// it on the rankings, as the children go away with the entry.
+TEST_F(DiskCacheEntryTest, MemoryOnlyDoomSparseEntryAndNeighbors) {
+  SetMemoryOnlyMode();
+  InitCache();
+  std::string key("the first key");
+  disk_cache::Entry* entry;
+  ASSERT_TRUE(cache_->CreateEntry(key, &entry));
+
+  const int kSize = 4 * 1024;
+  char buffer[kSize];
+  CacheTestFillBuffer(buffer, kSize, false);
+
+  Time initial_time = Time::Now() - TimeDelta::FromMinutes(1);
+  int64 offset = 1024 * 1024;
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(kSize, entry->WriteSparseData(offset, buffer, kSize, NULL));
+    offset *= 4;
+  }
+  EXPECT_EQ(4, cache_->GetEntryCount());
+
+  // Using the entry moves it ahead of its children.
+  EXPECT_EQ(kSize, entry->WriteData(0, 0, buffer, kSize, NULL, false));
+  entry->Close();
+  Time end_time = Time::Now() + TimeDelta::FromMinutes(1);
+  EXPECT_TRUE(cache_->DoomEntriesBetween(initial_time, end_time));
+  EXPECT_EQ(0, cache_->GetEntryCount());
+
+  // Looking for data moves the children ahead of the entry.
+  ASSERT_TRUE(cache_->CreateEntry(key, &entry));
+  offset = 1024 * 1024;
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(kSize, entry->WriteSparseData(offset, buffer, kSize, NULL));
+    offset *= 4;
+  }
+  offset = 1024 * 1024;
+  for (int i = 0; i < 3; i++) {
+    int64 start;
+    EXPECT_EQ(kSize, entry->GetAvailableRange(offset, kSize, &start));
+    offset *= 4;
+  }
+  entry->Close();
+  EXPECT_TRUE(cache_->DoomAllEntries());
+  EXPECT_EQ(0, cache_->GetEntryCount());
+}
+
+// Verify that a read that is still in flight when the cache is destroyed is
+// completed, and its callback invoked.
+TEST_F(DiskCacheEntryTest, PendingIOOnDestruction) {
+  InitCache();
+  std::string key("the first key");
+  disk_cache::Entry *entry;
+  ASSERT_TRUE(cache_->CreateEntry(key, &entry));
+
+  const int kSize = 20000;
+  char buffer1[kSize];
+  char buffer2[kSize];
+  CacheTestFillBuffer(buffer1, sizeof(buffer1), false);
+  memset(buffer2, 0, sizeof(buffer2));
+  EXPECT_EQ(kSize, entry->WriteData(1, 0, buffer1, kSize, NULL, false));
+  entry->Close();
+
+  CallbackTest callback(1, false);
+  g_cache_tests_error = false;
+  g_cache_tests_max_id = 1;
+  g_cache_tests_received = 0;
+  MessageLoopHelper helper;
+
+  ASSERT_TRUE(cache_->OpenEntry(key, &entry));
+  int ret = entry->ReadData(1, 0, buffer2, kSize, &callback);
+  EXPECT_TRUE(kSize == ret || net::ERR_IO_PENDING == ret);
+  int expected = (net::ERR_IO_PENDING == ret) ? 1 : 0;
+  entry->Close();
+
+  // The cache waits for the pending read before going away.
+  delete cache_;
+  cache_ = NULL;
+
+  EXPECT_TRUE(helper.WaitUntilCacheIoFinished(expected));
+  EXPECT_FALSE(g_cache_tests_error);
+  EXPECT_EQ(0, memcmp(buffer1, buffer2, kSize));
+}
@@ -52,7 +52,9 @@ class File : public base::RefCounted<File> {
   bool Write(const void* buffer, size_t buffer_len, size_t offset);
 
   // Performs asynchronous IO. callback will be called when the IO completes,
-  // as an APC on the thread that queued the operation.
+  // as an APC on the thread that queued the operation. On POSIX, reads are
+  // performed on a worker thread and the callback is invoked from the message
+  // loop of the thread that queued the operation; writes are synchronous.
   bool Read(void* buffer, size_t buffer_len, size_t offset,
             FileIOCallback* callback, bool* completed);
   bool Write(const void* buffer, size_t buffer_len, size_t offset,
@@ -67,6 +69,12 @@ class File : public base::RefCounted<File> {
   bool SetLength(size_t length);
   size_t GetLength();
 
+#if defined(OS_POSIX)
+  // Blocks until |num_pending_io| IO operations started by the current thread
+  // complete, invoking their callbacks.
+  static void WaitForPendingIO(int* num_pending_io);
+#endif
+
  protected:
   virtual ~File();
 
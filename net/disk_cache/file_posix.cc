@@ -6,9 +6,164 @@
 
 #include <fcntl.h>
 
+#include <set>
+
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/message_loop.h"
+#include "base/thread_local.h"
+#include "base/waitable_event.h"
+#include "base/worker_pool.h"
 #include "net/disk_cache/disk_cache.h"
 
+namespace {
+
+class InFlightIO;
+
+// This class represents a single asynchronous read. The operation is started
+// on the thread that owns the file, the actual IO is performed on a worker
+// thread, and the callback is invoked back on the original thread. The file
+// is referenced while the operation is in flight.
+class BackgroundIO : public base::RefCountedThreadSafe<BackgroundIO> {
+ public:
+  BackgroundIO(disk_cache::File* file, void* buf, size_t buf_len,
+               size_t offset, disk_cache::FileIOCallback* callback,
+               InFlightIO* controller)
+      : io_completed_(true, false), file_(file), buf_(buf), buf_len_(buf_len),
+        offset_(offset), callback_(callback), bytes_(0),
+        controller_(controller), callback_loop_(MessageLoop::current()) {
+    file_->AddRef();
+  }
+  ~BackgroundIO() {}
+
+  // Performs the read on a worker thread, and notifies the original thread.
+  void Read();
+
+  // Runs on the original thread, when the read is complete.
+  void OnIOSignalled();
+
+  // Blocks the current thread until the read is complete.
+  void WaitForCompletion() {
+    io_completed_.Wait();
+  }
+
+  // Invokes the callback and releases the file. Must be called only once,
+  // after the read is complete.
+  void InvokeCallback();
+
+ private:
+  base::WaitableEvent io_completed_;
+  disk_cache::File* file_;
+  void* buf_;
+  size_t buf_len_;
+  size_t offset_;
+  disk_cache::FileIOCallback* callback_;
+  int bytes_;  // Result of the operation.
+  InFlightIO* controller_;  // The controller that tracks this operation.
+  MessageLoop* callback_loop_;  // The loop of the original thread.
+
+  DISALLOW_COPY_AND_ASSIGN(BackgroundIO);
+};
+
+// Keeps track of the asynchronous operations started by a given thread, so
+// that we can wait for all of them to complete if needed (for instance, when
+// the cache is being destroyed). There is one object per thread that uses
+// asynchronous IO.
+class InFlightIO {
+ public:
+  InFlightIO() {}
+  ~InFlightIO() {}
+
+  // Returns the object that tracks the operations of the current thread.
+  static InFlightIO* GetForCurrentThread();
+
+  // Starts an asynchronous read of |buf_len| bytes from |file|.
+  void PostRead(disk_cache::File* file, void* buf, size_t buf_len,
+                size_t offset, disk_cache::FileIOCallback* callback);
+
+  // Blocks until all operations in flight are complete, and invokes their
+  // callbacks. Returns false if there was nothing to wait for.
+  bool WaitForPendingIO();
+
+  // Invokes the callback of |operation|, unless that was already done.
+  void OnIOComplete(BackgroundIO* operation);
+
+ private:
+  typedef std::set<scoped_refptr<BackgroundIO> > IOList;
+  IOList io_list_;  // List of pending operations.
+
+  DISALLOW_COPY_AND_ASSIGN(InFlightIO);
+};
+
+base::LazyInstance<base::ThreadLocalPointer<InFlightIO> >
+    g_in_flight_io(base::LINKER_INITIALIZED);
+
+void BackgroundIO::Read() {
+  int bytes = pread(file_->os_file(), buf_, buf_len_, offset_);
+  bytes_ = bytes < 0 ? -1 : bytes;
+  io_completed_.Signal();
+  callback_loop_->PostTask(FROM_HERE,
+                           NewRunnableMethod(this,
+                                             &BackgroundIO::OnIOSignalled));
+}
+
+void BackgroundIO::OnIOSignalled() {
+  controller_->OnIOComplete(this);
+}
+
+void BackgroundIO::InvokeCallback() {
+  callback_->OnFileIOComplete(bytes_);
+  file_->Release();
+}
+
+// static
+InFlightIO* InFlightIO::GetForCurrentThread() {
+  // The object is not deleted when the thread goes away, but there are only a
+  // few threads that perform cache IO.
+  InFlightIO* controller = g_in_flight_io.Get().Get();
+  if (!controller) {
+    controller = new InFlightIO;
+    g_in_flight_io.Get().Set(controller);
+  }
+  return controller;
+}
+
+void InFlightIO::PostRead(disk_cache::File* file, void* buf, size_t buf_len,
+                          size_t offset, disk_cache::FileIOCallback* callback) {
+  scoped_refptr<BackgroundIO> operation =
+      new BackgroundIO(file, buf, buf_len, offset, callback, this);
+  io_list_.insert(operation);
+  WorkerPool::PostTask(FROM_HERE,
+                       NewRunnableMethod(operation.get(), &BackgroundIO::Read),
+                       true);
+}
+
+bool InFlightIO::WaitForPendingIO() {
+  if (io_list_.empty())
+    return false;
+
+  // The callbacks may start new operations, so we have to get a copy first.
+  IOList pending = io_list_;
+  for (IOList::iterator it = pending.begin(); it != pending.end(); ++it) {
+    (*it)->WaitForCompletion();
+    OnIOComplete(*it);
+  }
+  return true;
+}
+
+void InFlightIO::OnIOComplete(BackgroundIO* operation) {
+  IOList::iterator it = io_list_.find(operation);
+  if (it == io_list_.end())
+    return;  // We already invoked the callback from WaitForPendingIO.
+
+  // Keep the operation alive while we notify the callback.
+  scoped_refptr<BackgroundIO> protect(operation);
+  io_list_.erase(it);
+  operation->InvokeCallback();
+}
+
+}  // namespace
+
 namespace disk_cache {
 
 File::File(OSFile file)
@@ -72,11 +227,19 @@ bool File::Read(void* buffer, size_t buffer_len, size_t offset,
   if (buffer_len > ULONG_MAX || offset > ULONG_MAX)
     return false;
 
-  // TODO: Implement async IO.
-  bool ret = Read(buffer, buffer_len, offset);
-  if (ret && completed)
-    *completed = true;
-  return ret;
+  // The result is delivered through the message loop of the current thread,
+  // so we can only go asynchronous if there is one.
+  if (!callback || !MessageLoop::current()) {
+    bool ret = Read(buffer, buffer_len, offset);
+    if (ret && completed)
+      *completed = true;
+    return ret;
+  }
+
+  InFlightIO::GetForCurrentThread()->PostRead(this, buffer, buffer_len, offset,
+                                              callback);
+  *completed = false;
+  return true;
 }
 
 bool File::Write(const void* buffer, size_t buffer_len, size_t offset,
@@ -96,7 +259,9 @@ bool File::AsyncWrite(const void* buffer, size_t buffer_len, size_t offset,
   if (buffer_len > ULONG_MAX || offset > ULONG_MAX)
     return false;
 
-  // TODO: Implement async IO.
+  // Writes are performed synchronously: they are usually absorbed by the
+  // system cache, and this guarantees that a read issued after a write (even
+  // before the write completion is delivered) sees the new data.
   bool ret = Write(buffer, buffer_len, offset);
   if (ret && completed)
     *completed = true;
@@ -123,4 +288,15 @@ size_t File::GetLength() {
   return ret;
 }
 
+// static
+void File::WaitForPendingIO(int* num_pending_io) {
+  while (*num_pending_io) {
+    // The callbacks decrement |num_pending_io|, as they are invoked.
+    if (!InFlightIO::GetForCurrentThread()->WaitForPendingIO()) {
+      NOTREACHED() << "IO in flight on another thread";
+      break;
+    }
+  }
+}
+
 }  // namespace disk_cache
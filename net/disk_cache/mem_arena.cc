@@ -0,0 +1,136 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/mem_arena.h"
+
+#include "base/logging.h"
+
+namespace {
+
+// Each class is between 1.33 and 1.5 times the size of the previous one, so
+// no more than a third of a block is wasted.
+const int kBlockSizes[] = {
+  256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384
+};
+COMPILE_ASSERT(arraysize(kBlockSizes) == disk_cache::MemArena::kNumSizeClasses,
+               update_the_block_sizes);
+
+}  // namespace
+
+namespace disk_cache {
+
+struct MemArena::Slab {
+  explicit Slab(int size_class)
+      : memory(new char[kSlabSize]), size_class(size_class),
+        num_blocks(kSlabSize / kBlockSizes[size_class]), num_used(0),
+        num_carved(0), free_list(NULL), partial_index(-1) {}
+  ~Slab() {
+    delete[] memory;
+  }
+
+  char* memory;
+  int size_class;
+  int num_blocks;
+  int num_used;
+  int num_carved;      // Blocks that have been handed out at least once.
+  char* free_list;     // Released blocks, linked through their first bytes.
+  int partial_index;   // Position on partial_slabs_, or -1.
+};
+
+MemArena::MemArena() : resident_size_(0), allocated_size_(0) {
+}
+
+MemArena::~MemArena() {
+  DCHECK(!allocated_size_);
+  for (SlabsMap::iterator it = slabs_.begin(); it != slabs_.end(); ++it)
+    delete it->second;
+}
+
+// static
+int MemArena::GetSizeClass(int size) {
+  DCHECK(size > 0 && size <= kMaxBlockSize);
+  for (int i = 0; i < kNumSizeClasses; i++) {
+    if (size <= kBlockSizes[i])
+      return i;
+  }
+  NOTREACHED();
+  return kNumSizeClasses - 1;
+}
+
+// static
+int MemArena::GetBlockSize(int size_class) {
+  DCHECK(size_class >= 0 && size_class < kNumSizeClasses);
+  return kBlockSizes[size_class];
+}
+
+char* MemArena::Allocate(int size_class) {
+  DCHECK(size_class >= 0 && size_class < kNumSizeClasses);
+  std::vector<Slab*>& partial = partial_slabs_[size_class];
+  if (partial.empty()) {
+    Slab* slab = new Slab(size_class);
+    slabs_[slab->memory] = slab;
+    slab->partial_index = static_cast<int>(partial.size());
+    partial.push_back(slab);
+    resident_size_ += kSlabSize;
+  }
+
+  Slab* slab = partial.back();
+  char* block;
+  if (slab->free_list) {
+    block = slab->free_list;
+    memcpy(&slab->free_list, block, sizeof(block));
+  } else {
+    DCHECK_LT(slab->num_carved, slab->num_blocks);
+    block = slab->memory + slab->num_carved * kBlockSizes[size_class];
+    slab->num_carved++;
+  }
+
+  slab->num_used++;
+  if (slab->num_used == slab->num_blocks)
+    RemovePartialSlab(slab);
+
+  allocated_size_ += kBlockSizes[size_class];
+  return block;
+}
+
+void MemArena::Free(char* block, int size_class) {
+  SlabsMap::iterator it = slabs_.upper_bound(block);
+  DCHECK(it != slabs_.begin());
+  --it;
+  Slab* slab = it->second;
+  DCHECK(block < slab->memory + kSlabSize);
+  DCHECK_EQ(size_class, slab->size_class);
+
+  allocated_size_ -= kBlockSizes[size_class];
+  slab->num_used--;
+  if (!slab->num_used) {
+    // Nothing else lives here.
+    if (slab->partial_index >= 0)
+      RemovePartialSlab(slab);
+    slabs_.erase(it);
+    delete slab;
+    resident_size_ -= kSlabSize;
+    return;
+  }
+
+  memcpy(block, &slab->free_list, sizeof(block));
+  slab->free_list = block;
+  if (slab->partial_index < 0) {
+    std::vector<Slab*>& partial = partial_slabs_[size_class];
+    slab->partial_index = static_cast<int>(partial.size());
+    partial.push_back(slab);
+  }
+}
+
+void MemArena::RemovePartialSlab(Slab* slab) {
+  std::vector<Slab*>& partial = partial_slabs_[slab->size_class];
+  DCHECK(partial[slab->partial_index] == slab);
+  Slab* last = partial.back();
+  partial[slab->partial_index] = last;
+  last->partial_index = slab->partial_index;
+  partial.pop_back();
+  slab->partial_index = -1;
+}
+
+}  // namespace disk_cache
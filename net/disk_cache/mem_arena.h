@@ -0,0 +1,70 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface.
+
+#ifndef NET_DISK_CACHE_MEM_ARENA_H_
+#define NET_DISK_CACHE_MEM_ARENA_H_
+
+#include <map>
+#include <vector>
+
+#include "base/basictypes.h"
+
+namespace disk_cache {
+
+// This class hands out the blocks used by the memory-only cache to store the
+// user data of its entries. Blocks come in a few size classes (from 256 bytes
+// to kMaxBlockSize), and every block of a given class is carved out of a slab
+// of kSlabSize bytes dedicated to that class, so the cache allocates a small
+// number of big chunks of memory instead of one buffer per stream. A slab is
+// released as soon as none of its blocks is in use.
+class MemArena {
+ public:
+  enum {
+    kNumSizeClasses = 13,
+    kMaxBlockSize = 16 * 1024,
+    kSlabSize = 64 * 1024
+  };
+
+  MemArena();
+  ~MemArena();
+
+  // Returns the smallest size class with blocks of at least |size| bytes.
+  // |size| must be between 1 and kMaxBlockSize.
+  static int GetSizeClass(int size);
+
+  // Returns the size of the blocks of a given class.
+  static int GetBlockSize(int size_class);
+
+  // Returns a new block of the given class.
+  char* Allocate(int size_class);
+
+  // Returns |block|, allocated with the given class, to the arena.
+  void Free(char* block, int size_class);
+
+  // Returns the number of bytes held by the arena (the size of all the slabs).
+  int64 resident_size() const { return resident_size_; }
+
+  // Returns the number of bytes handed out as blocks.
+  int64 allocated_size() const { return allocated_size_; }
+
+ private:
+  struct Slab;
+  typedef std::map<char*, Slab*> SlabsMap;
+
+  // Removes |slab| from the list of slabs that have free blocks.
+  void RemovePartialSlab(Slab* slab);
+
+  SlabsMap slabs_;  // All the slabs, keyed by their first byte.
+  std::vector<Slab*> partial_slabs_[kNumSizeClasses];  // Slabs with room.
+  int64 resident_size_;
+  int64 allocated_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemArena);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_MEM_ARENA_H_
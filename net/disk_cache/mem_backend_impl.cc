@@ -4,8 +4,10 @@
 
 #include "net/disk_cache/mem_backend_impl.h"
 
+#include "base/string_util.h"
 #include "base/sys_info.h"
 #include "net/disk_cache/cache_util.h"
+#include "net/disk_cache/disk_format.h"
 #include "net/disk_cache/mem_entry_impl.h"
 
 namespace {
@@ -60,10 +62,10 @@ bool MemBackendImpl::Init() {
 }
 
 MemBackendImpl::~MemBackendImpl() {
-  EntryMap::iterator it = entries_.begin();
-  while (it != entries_.end()) {
-    it->second->Doom();
-    it = entries_.begin();
+  MemEntryImpl* entry = rankings_.GetNext(NULL);
+  while (entry) {
+    entry->Doom();
+    entry = rankings_.GetNext(NULL);
   }
   DCHECK(!current_size_);
 }
@@ -82,23 +84,22 @@ bool MemBackendImpl::SetMaxSize(int max_bytes) {
 }
 
 int32 MemBackendImpl::GetEntryCount() const {
-  return static_cast<int32>(entries_.size());
+  return static_cast<int32>(index_.size());
 }
 
 bool MemBackendImpl::OpenEntry(const std::string& key, Entry** entry) {
-  EntryMap::iterator it = entries_.find(key);
-  if (it == entries_.end())
+  MemEntryImpl* cache_entry = index_.Find(key);
+  if (!cache_entry)
     return false;
 
-  it->second->Open();
+  cache_entry->Open();
 
-  *entry = it->second;
+  *entry = cache_entry;
   return true;
 }
 
 bool MemBackendImpl::CreateEntry(const std::string& key, Entry** entry) {
-  EntryMap::iterator it = entries_.find(key);
-  if (it != entries_.end())
+  if (index_.Find(key))
     return false;
 
   MemEntryImpl* cache_entry = new MemEntryImpl(this);
@@ -108,7 +109,7 @@ bool MemBackendImpl::CreateEntry(const std::string& key, Entry** entry) {
   }
 
   rankings_.Insert(cache_entry);
-  entries_[key] = cache_entry;
+  index_.Insert(cache_entry);
 
   *entry = cache_entry;
   return true;
@@ -126,10 +127,7 @@ bool MemBackendImpl::DoomEntry(const std::string& key) {
 
 void MemBackendImpl::InternalDoomEntry(MemEntryImpl* entry) {
   rankings_.Remove(entry);
-  EntryMap::iterator it = entries_.find(entry->GetKey());
-  if (it != entries_.end())
-    entries_.erase(it);
-  else
+  if (!index_.Remove(entry))
     NOTREACHED();
 
   entry->InternalDoom();
@@ -160,7 +158,12 @@ bool MemBackendImpl::DoomEntriesBetween(const Time initial_time,
       break;
 
     if (node->GetLastUsed() < end_time) {
+      // The children of a sparse entry go away with it, and any of them may
+      // be |next|, so start over.
+      bool has_children = node->GetDataSize(kSparseIndex) != 0;
       node->Doom();
+      if (has_children)
+        next = rankings_.GetNext(NULL);
     }
   }
 
@@ -204,6 +207,27 @@ void MemBackendImpl::EndEnumeration(void** iter) {
   *iter = NULL;
 }
 
+void MemBackendImpl::GetStats(
+    std::vector<std::pair<std::string, std::string> >* stats) {
+  std::pair<std::string, std::string> item;
+
+  item.first = "Entries";
+  item.second = StringPrintf("%d", index_.size());
+  stats->push_back(item);
+
+  item.first = "Max size";
+  item.second = StringPrintf("%d", max_size_);
+  stats->push_back(item);
+
+  item.first = "Current size";
+  item.second = StringPrintf("%d", current_size_);
+  stats->push_back(item);
+
+  item.first = "Resident size";
+  item.second = Int64ToString(resident_size());
+  stats->push_back(item);
+}
+
 void MemBackendImpl::TrimCache(bool empty) {
   MemEntryImpl* next = rankings_.GetPrev(NULL);
 
@@ -214,7 +238,11 @@ void MemBackendImpl::TrimCache(bool empty) {
     MemEntryImpl* node = next;
     next = rankings_.GetPrev(next);
     if (!node->InUse() || empty) {
+      // See DoomEntriesBetween.
+      bool has_children = node->GetDataSize(kSparseIndex) != 0;
       node->Doom();
+      if (has_children)
+        next = rankings_.GetPrev(NULL);
     }
   }
 
@@ -249,5 +277,9 @@ int MemBackendImpl::MaxFileSize() const {
   return max_size_ / 8;
 }
 
+int64 MemBackendImpl::resident_size() const {
+  return arena_.resident_size() + index_.table_size();
+}
+
 }  // namespace disk_cache
 
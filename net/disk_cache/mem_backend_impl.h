@@ -7,9 +7,9 @@
 #ifndef NET_DISK_CACHE_MEM_BACKEND_IMPL_H__
 #define NET_DISK_CACHE_MEM_BACKEND_IMPL_H__
 
-#include "base/hash_tables.h"
-
 #include "net/disk_cache/disk_cache.h"
+#include "net/disk_cache/mem_arena.h"
+#include "net/disk_cache/mem_index.h"
 #include "net/disk_cache/mem_rankings.h"
 
 namespace disk_cache {
@@ -37,7 +37,7 @@ class MemBackendImpl : public Backend {
   virtual bool OpenNextEntry(void** iter, Entry** next_entry);
   virtual void EndEnumeration(void** iter);
   virtual void GetStats(
-      std::vector<std::pair<std::string, std::string> >* stats) {}
+      std::vector<std::pair<std::string, std::string> >* stats);
 
   // Sets the maximum size for the total amount of data stored by this instance.
   bool SetMaxSize(int max_bytes);
@@ -54,6 +54,15 @@ class MemBackendImpl : public Backend {
   // Returns the maximum size for a file to reside on the cache.
   int MaxFileSize() const;
 
+  // Returns the arena that holds the user data of the entries.
+  MemArena* arena() { return &arena_; }
+
+  // Returns the number of bytes charged against the maximum size.
+  int32 current_size() const { return current_size_; }
+
+  // Returns the memory used to store the entries' data and the index.
+  int64 resident_size() const;
+
  private:
   // Deletes entries from the cache until the current size is below the limit.
   // If empty is true, the whole cache will be trimmed, regardless of being in
@@ -64,9 +73,8 @@ class MemBackendImpl : public Backend {
   void AddStorageSize(int32 bytes);
   void SubstractStorageSize(int32 bytes);
 
-  typedef base::hash_map<std::string, MemEntryImpl*> EntryMap;
-
-  EntryMap entries_;
+  MemArena arena_;        // Storage for the user data.
+  MemIndex index_;        // Maps keys to entries.
   MemRankings rankings_;  // Rankings to be able to trim the cache.
   int32 max_size_;        // Maximum data size for this instance.
   int32 current_size_;
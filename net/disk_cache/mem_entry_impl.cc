@@ -4,8 +4,19 @@
 
 #include "net/disk_cache/mem_entry_impl.h"
 
+#include <algorithm>
+
 #include "net/base/net_errors.h"
+#include "net/disk_cache/mem_arena.h"
 #include "net/disk_cache/mem_backend_impl.h"
+#include "net/disk_cache/sparse_control.h"
+
+namespace {
+
+const int kMaxBlockSize = disk_cache::MemArena::kMaxBlockSize;
+const int kMaxSizeClass = disk_cache::MemArena::kNumSizeClasses - 1;
+
+}  // namespace
 
 namespace disk_cache {
 
@@ -13,12 +24,14 @@ MemEntryImpl::MemEntryImpl(MemBackendImpl* backend) {
   doomed_ = false;
   backend_ = backend;
   ref_count_ = 0;
-  data_size_[0] = data_size_[1] = 0;
+  for (int i = 0; i < kNumStreams; i++)
+    data_size_[i] = 0;
 }
 
 MemEntryImpl::~MemEntryImpl() {
-  backend_->ModifyStorageSize(data_size_[0], 0);
-  backend_->ModifyStorageSize(data_size_[1], 0);
+  sparse_.reset();
+  for (int i = 0; i < kNumStreams; i++)
+    SetCapacity(i, 0);
   backend_->ModifyStorageSize(static_cast<int32>(key_.size()), 0);
 }
 
@@ -34,7 +47,12 @@ bool MemEntryImpl::CreateEntry(const std::string& key) {
 void MemEntryImpl::Close() {
   ref_count_--;
   DCHECK(ref_count_ >= 0);
-  if (!ref_count_ && doomed_)
+  if (ref_count_)
+    return;
+
+  // Nobody is using the sparse data, so the children don't have to stay open.
+  sparse_.reset();
+  if (doomed_)
     delete this;
 }
 
@@ -51,6 +69,11 @@ bool MemEntryImpl::InUse() {
 void MemEntryImpl::Doom() {
   if (doomed_)
     return;
+
+  // The sparse data lives on other entries, so they go away with this one.
+  if (GetDataSize(kSparseIndex))
+    GetSparseControl()->DeleteChildren();
+
   backend_->InternalDoomEntry(this);
 }
 
@@ -73,7 +96,7 @@ Time MemEntryImpl::GetLastModified() const {
 }
 
 int32 MemEntryImpl::GetDataSize(int index) const {
-  if (index < 0 || index > 1)
+  if (index < 0 || index >= kNumStreams)
     return 0;
 
   return data_size_[index];
@@ -81,7 +104,7 @@ int32 MemEntryImpl::GetDataSize(int index) const {
 
 int MemEntryImpl::ReadData(int index, int offset, char* buf, int buf_len,
                            net::CompletionCallback* completion_callback) {
-  if (index < 0 || index > 1)
+  if (index < 0 || index >= kNumStreams)
     return net::ERR_INVALID_ARGUMENT;
 
   int entry_size = GetDataSize(index);
@@ -96,14 +119,14 @@ int MemEntryImpl::ReadData(int index, int offset, char* buf, int buf_len,
 
   UpdateRank(false);
 
-  memcpy(buf , &(data_[index])[offset], buf_len);
+  CopyFromStream(index, offset, buf, buf_len);
   return buf_len;
 }
 
 int MemEntryImpl::WriteData(int index, int offset, const char* buf, int buf_len,
                          net::CompletionCallback* completion_callback,
                          bool truncate) {
-  if (index < 0 || index > 1)
+  if (index < 0 || index >= kNumStreams)
     return net::ERR_INVALID_ARGUMENT;
 
   if (offset < 0 || buf_len < 0)
@@ -126,12 +149,11 @@ int MemEntryImpl::WriteData(int index, int offset, const char* buf, int buf_len,
   PrepareTarget(index, offset, buf_len);
 
   if (entry_size < offset + buf_len) {
-    backend_->ModifyStorageSize(entry_size, offset + buf_len);
     data_size_[index] = offset + buf_len;
   } else if (truncate) {
     if (entry_size > offset + buf_len) {
-      backend_->ModifyStorageSize(entry_size, offset + buf_len);
       data_size_[index] = offset + buf_len;
+      SetCapacity(index, offset + buf_len);
     }
   }
 
@@ -140,25 +162,137 @@ int MemEntryImpl::WriteData(int index, int offset, const char* buf, int buf_len,
   if (!buf_len)
     return 0;
 
-  memcpy(&(data_[index])[offset], buf, buf_len);
+  CopyToStream(index, offset, buf, buf_len);
   return buf_len;
 }
 
+int MemEntryImpl::ReadSparseData(int64 offset, char* buf, int buf_len,
+                                 net::CompletionCallback* completion_callback) {
+  int rv = GetSparseControl()->ReadData(offset, buf, buf_len);
+  if (rv > 0)
+    UpdateRank(false);
+  return rv;
+}
+
+int MemEntryImpl::WriteSparseData(
+    int64 offset, const char* buf, int buf_len,
+    net::CompletionCallback* completion_callback) {
+  int rv = GetSparseControl()->WriteData(offset, buf, buf_len);
+  if (rv > 0)
+    UpdateRank(true);
+  return rv;
+}
+
+int MemEntryImpl::GetAvailableRange(int64 offset, int len, int64* start) {
+  return GetSparseControl()->GetAvailableRange(offset, len, start);
+}
+
 void MemEntryImpl::PrepareTarget(int index, int offset, int buf_len) {
   int entry_size = GetDataSize(index);
 
   if (entry_size >= offset + buf_len)
     return;  // Not growing the stored data.
 
-  if (static_cast<int>(data_[index].size()) < offset + buf_len)
-    data_[index].resize(offset + buf_len);
+  if (data_[index].capacity < offset + buf_len)
+    SetCapacity(index, offset + buf_len);
 
   if (offset <= entry_size)
     return;  // There is no "hole" on the stored data.
 
   // Cleanup the hole not written by the user. The point is to avoid returning
   // random stuff later on.
-  memset(&(data_[index])[entry_size], 0, offset - entry_size);
+  ZeroStream(index, entry_size, offset - entry_size);
+}
+
+void MemEntryImpl::SetCapacity(int index, int size) {
+  Stream& stream = data_[index];
+  MemArena* arena = backend_->arena();
+  int old_capacity = stream.capacity;
+  int new_count = (size + kMaxBlockSize - 1) / kMaxBlockSize;
+  int new_tail_class = 0;
+  if (new_count)
+    new_tail_class = MemArena::GetSizeClass(size -
+                                            (new_count - 1) * kMaxBlockSize);
+
+  // Release the blocks that are not needed anymore.
+  while (static_cast<int>(stream.blocks.size()) > new_count) {
+    arena->Free(stream.blocks.back(), stream.tail_class);
+    stream.blocks.pop_back();
+    stream.tail_class = kMaxSizeClass;
+  }
+
+  // The last block that we keep may have to change its size, so we move its
+  // data to a new block.
+  int count = static_cast<int>(stream.blocks.size());
+  if (count) {
+    int last_class = count < new_count ? kMaxSizeClass : new_tail_class;
+    if (last_class != stream.tail_class) {
+      char* block = arena->Allocate(last_class);
+      int valid = data_size_[index] - (count - 1) * kMaxBlockSize;
+      valid = std::min(valid, MemArena::GetBlockSize(last_class));
+      valid = std::min(valid, MemArena::GetBlockSize(stream.tail_class));
+      if (valid > 0)
+        memcpy(block, stream.blocks.back(), valid);
+      arena->Free(stream.blocks.back(), stream.tail_class);
+      stream.blocks.back() = block;
+      stream.tail_class = last_class;
+    }
+  }
+
+  for (; count < new_count; count++) {
+    int size_class = count == new_count - 1 ? new_tail_class : kMaxSizeClass;
+    stream.blocks.push_back(arena->Allocate(size_class));
+    stream.tail_class = size_class;
+  }
+
+  stream.capacity = 0;
+  if (new_count) {
+    stream.capacity = (new_count - 1) * kMaxBlockSize +
+                      MemArena::GetBlockSize(new_tail_class);
+  }
+
+  // The backend is charged with the memory that we actually hold.
+  backend_->ModifyStorageSize(old_capacity, stream.capacity);
+}
+
+void MemEntryImpl::CopyToStream(int index, int offset, const char* buf,
+                                int buf_len) {
+  DCHECK_LE(offset + buf_len, data_[index].capacity);
+  while (buf_len) {
+    int block_offset = offset % kMaxBlockSize;
+    int len = std::min(buf_len, kMaxBlockSize - block_offset);
+    memcpy(data_[index].blocks[offset / kMaxBlockSize] + block_offset, buf,
+           len);
+    offset += len;
+    buf += len;
+    buf_len -= len;
+  }
+}
+
+void MemEntryImpl::CopyFromStream(int index, int offset, char* buf,
+                                  int buf_len) {
+  DCHECK_LE(offset + buf_len, data_[index].capacity);
+  while (buf_len) {
+    int block_offset = offset % kMaxBlockSize;
+    int len = std::min(buf_len, kMaxBlockSize - block_offset);
+    memcpy(buf, data_[index].blocks[offset / kMaxBlockSize] + block_offset,
+           len);
+    offset += len;
+    buf += len;
+    buf_len -= len;
+  }
+}
+
+void MemEntryImpl::ZeroStream(int index, int offset, int len) {
+  DCHECK_LE(offset + len, data_[index].capacity);
+  while (len) {
+    int block_offset = offset % kMaxBlockSize;
+    int block_len = std::min(len, kMaxBlockSize - block_offset);
+    memset(data_[index].blocks[offset / kMaxBlockSize] + block_offset, 0,
+           block_len);
+    offset += block_len;
+    len -= block_len;
+  }
 }
 
 void MemEntryImpl::UpdateRank(bool modified) {
@@ -172,5 +306,11 @@ void MemEntryImpl::UpdateRank(bool modified) {
     backend_->UpdateRank(this);
 }
 
+SparseControl* MemEntryImpl::GetSparseControl() {
+  if (!sparse_.get())
+    sparse_.reset(new SparseControl(backend_, this));
+  return sparse_.get();
+}
+
 }  // namespace disk_cache
 
@@ -5,11 +5,15 @@
 #ifndef NET_DISK_CACHE_MEM_ENTRY_IMPL_H__
 #define NET_DISK_CACHE_MEM_ENTRY_IMPL_H__
 
+#include <vector>
+
+#include "base/scoped_ptr.h"
 #include "net/disk_cache/disk_cache.h"
 
 namespace disk_cache {
 
 class MemBackendImpl;
+class SparseControl;
 
 // This class implements the Entry interface for the memory-only cache. An
 // object of this class represents a single entry on the cache.
@@ -29,6 +33,11 @@ class MemEntryImpl : public Entry {
   virtual int WriteData(int index, int offset, const char* buf, int buf_len,
                         net::CompletionCallback* completion_callback,
                         bool truncate);
+  virtual int ReadSparseData(int64 offset, char* buf, int buf_len,
+                             net::CompletionCallback* completion_callback);
+  virtual int WriteSparseData(int64 offset, const char* buf, int buf_len,
+                              net::CompletionCallback* completion_callback);
+  virtual int GetAvailableRange(int64 offset, int len, int64* start);
 
   // Performs the initialization of a EntryImpl that will be added to the
   // cache.
@@ -37,6 +46,10 @@ class MemEntryImpl : public Entry {
   // Permamently destroys this entry
   void InternalDoom();
 
+  const std::string& key() const {
+    return key_;
+  }
+
   MemEntryImpl* next() const {
     return next_;
   }
@@ -59,15 +72,42 @@ class MemEntryImpl : public Entry {
  private:
   ~MemEntryImpl();
 
+  // The user data of a stream is stored on blocks from the backend's arena.
+  // All blocks but the last one are MemArena::kMaxBlockSize bytes long; the
+  // last one is just big enough for the rest of the data.
+  struct Stream {
+    Stream() : tail_class(0), capacity(0) {}
+
+    std::vector<char*> blocks;
+    int tail_class;  // The size class of the last block.
+    int capacity;    // The size of all the blocks.
+  };
+
   // Grows and cleans up the data buffer.
   void PrepareTarget(int index, int offset, int buf_len);
 
+  // Reallocates the blocks of a stream so that they hold exactly |size| bytes
+  // (rounded up to the size of the last block), preserving the stored data.
+  void SetCapacity(int index, int size);
+
+  // Copies data to and from the blocks of a stream.
+  void CopyToStream(int index, int offset, const char* buf, int buf_len);
+  void CopyFromStream(int index, int offset, char* buf, int buf_len);
+  void ZeroStream(int index, int offset, int len);
+
   // Updates ranking information.
   void UpdateRank(bool modified);
 
+  // Returns the object that handles the sparse data of this entry.
+  SparseControl* GetSparseControl();
+
+  // The number of data streams of an entry.
+  static const int kNumStreams = 3;
+
   std::string key_;
-  std::vector<char> data_[2];  // User data.
-  int32 data_size_[2];
+  Stream data_[kNumStreams];   // User data.
+  int32 data_size_[kNumStreams];
+  scoped_ptr<SparseControl> sparse_;  // Support for sparse entries.
   int ref_count_;
 
   MemEntryImpl* next_;         // Pointers for the LRU list.
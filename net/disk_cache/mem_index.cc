@@ -0,0 +1,104 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/mem_index.h"
+
+#include "base/logging.h"
+#include "net/disk_cache/hash.h"
+#include "net/disk_cache/mem_entry_impl.h"
+
+namespace {
+
+const int kMinCapacity = 64;
+
+}  // namespace
+
+namespace disk_cache {
+
+MemIndex::MemIndex() : capacity_(0), size_(0) {
+  Resize(kMinCapacity);
+}
+
+MemIndex::~MemIndex() {
+}
+
+MemEntryImpl* MemIndex::Find(const std::string& key) const {
+  return table_[FindSlot(key, Hash(key))].entry;
+}
+
+void MemIndex::Insert(MemEntryImpl* entry) {
+  // Keep the load factor under 3/4 so that probe sequences stay short.
+  if ((size_ + 1) * 4 > capacity_ * 3)
+    Resize(capacity_ * 2);
+
+  uint32 hash = Hash(entry->key());
+  int slot = FindSlot(entry->key(), hash);
+  DCHECK(!table_[slot].entry);
+  table_[slot].hash = hash;
+  table_[slot].entry = entry;
+  size_++;
+}
+
+bool MemIndex::Remove(MemEntryImpl* entry) {
+  int slot = FindSlot(entry->key(), Hash(entry->key()));
+  if (table_[slot].entry != entry)
+    return false;
+
+  // Shift back the entries that follow, so that there is no need for
+  // tombstones: an entry can move to the empty slot unless its home slot lies
+  // (cyclically) between the empty slot and its current position.
+  int mask = capacity_ - 1;
+  int empty = slot;
+  for (int next = (slot + 1) & mask; table_[next].entry;
+       next = (next + 1) & mask) {
+    int home = table_[next].hash & mask;
+    if (((next - home) & mask) >= ((next - empty) & mask)) {
+      table_[empty] = table_[next];
+      empty = next;
+    }
+  }
+  table_[empty].entry = NULL;
+  size_--;
+
+  if (capacity_ > kMinCapacity && size_ * 8 < capacity_)
+    Resize(capacity_ / 2);
+  return true;
+}
+
+int MemIndex::table_size() const {
+  return capacity_ * sizeof(Slot);
+}
+
+int MemIndex::FindSlot(const std::string& key, uint32 hash) const {
+  int mask = capacity_ - 1;
+  for (int slot = hash & mask;; slot = (slot + 1) & mask) {
+    const Slot& current = table_[slot];
+    if (!current.entry)
+      return slot;
+    if (current.hash == hash && current.entry->key() == key)
+      return slot;
+  }
+}
+
+void MemIndex::Resize(int capacity) {
+  DCHECK(!(capacity & (capacity - 1)));
+  scoped_array<Slot> old_table(table_.release());
+  int old_capacity = capacity_;
+
+  table_.reset(new Slot[capacity]);
+  memset(table_.get(), 0, capacity * sizeof(Slot));
+  capacity_ = capacity;
+
+  int mask = capacity - 1;
+  for (int i = 0; i < old_capacity; i++) {
+    if (!old_table[i].entry)
+      continue;
+    int slot = old_table[i].hash & mask;
+    while (table_[slot].entry)
+      slot = (slot + 1) & mask;
+    table_[slot] = old_table[i];
+  }
+}
+
+}  // namespace disk_cache
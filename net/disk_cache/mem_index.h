@@ -0,0 +1,63 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface.
+
+#ifndef NET_DISK_CACHE_MEM_INDEX_H_
+#define NET_DISK_CACHE_MEM_INDEX_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/scoped_ptr.h"
+
+namespace disk_cache {
+
+class MemEntryImpl;
+
+// This class maps keys to entries for the memory-only cache. It is an open
+// addressing hash table (with linear probing) that stores the hash of the key
+// next to the entry, so most of the time a lookup touches a single cache line
+// and compares a single key.
+class MemIndex {
+ public:
+  MemIndex();
+  ~MemIndex();
+
+  // Returns the entry stored for |key|, or NULL.
+  MemEntryImpl* Find(const std::string& key) const;
+
+  // Adds |entry| to the index. There should be no entry with the same key.
+  void Insert(MemEntryImpl* entry);
+
+  // Removes |entry| from the index. Returns false if it was not there.
+  bool Remove(MemEntryImpl* entry);
+
+  int size() const { return size_; }
+
+  // Returns the memory used by the table.
+  int table_size() const;
+
+ private:
+  struct Slot {
+    uint32 hash;
+    MemEntryImpl* entry;
+  };
+
+  // Returns the slot that holds |key|, or the empty slot where it belongs.
+  int FindSlot(const std::string& key, uint32 hash) const;
+
+  // Moves the entries to a table of |capacity| slots.
+  void Resize(int capacity);
+
+  scoped_array<Slot> table_;
+  int capacity_;  // Always a power of two.
+  int size_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemIndex);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_MEM_INDEX_H_
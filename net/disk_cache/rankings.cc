@@ -4,7 +4,6 @@
 
 #include "net/disk_cache/rankings.h"
 
-#include "base/histogram.h"
 #include "net/disk_cache/backend_impl.h"
 #include "net/disk_cache/entry_impl.h"
 #include "net/disk_cache/errors.h"
@@ -14,10 +13,13 @@ disk_cache::RankCrashes g_rankings_crash = disk_cache::NO_CRASH;
 
 namespace {
 
-const int kHeadIndex = 0;
-const int kTailIndex = 1;
+// Indexes of the transaction record on the user data of the file header. The
+// heads and tails of the lists live on the index file (see LruData). While an
+// entry moves between lists, kMoveListIndex holds the target list plus one.
+const int kMoveListIndex = 1;
 const int kTransactionIndex = 2;
 const int kOperationIndex = 3;
+const int kOperationListIndex = 4;
 
 enum Operation {
   INSERT = 1,
@@ -29,13 +31,18 @@ enum Operation {
 // be created to keep track of the operation. If the process crashes before
 // finishing the operation, the transaction record (stored as part of the user
 // data on the file header) can be used to finish the operation.
+//
+// A move is a removal followed by an insertion that share one record: when the
+// removal is done, the record becomes the insertion on the target list, so the
+// node is never off both lists without a record of where it goes.
 class Transaction {
  public:
   // addr is the cache addres of the node being inserted or removed. We want to
   // avoid having the compiler doing optimizations on when to read or write
   // from user_data because it is the basis of the crash detection. Maybe
   // volatile is not enough for that, but it should be a good hint.
-  Transaction(volatile int32* user_data, disk_cache::Addr addr, Operation op);
+  Transaction(volatile int32* user_data, disk_cache::Addr addr, Operation op,
+              int list);
   ~Transaction();
  private:
   volatile int32* user_data_;
@@ -43,17 +50,31 @@ class Transaction {
 };
 
 Transaction::Transaction(volatile int32* user_data, disk_cache::Addr addr,
-                         Operation op) : user_data_(user_data) {
-  DCHECK(!user_data_[kTransactionIndex]);
+                         Operation op, int list) : user_data_(user_data) {
   DCHECK(addr.is_initialized());
+  if (user_data_[kTransactionIndex]) {
+    // The second half of a move.
+    DCHECK(user_data_[kTransactionIndex] == static_cast<int32>(addr.value()));
+    DCHECK(INSERT == op && INSERT == user_data_[kOperationIndex]);
+    DCHECK(list == user_data_[kOperationListIndex]);
+    return;
+  }
   user_data_[kOperationIndex] = op;
+  user_data_[kOperationListIndex] = list;
   user_data_[kTransactionIndex] = static_cast<int32>(addr.value());
 }
 
 Transaction::~Transaction() {
   DCHECK(user_data_[kTransactionIndex]);
+  if (REMOVE == user_data_[kOperationIndex] && user_data_[kMoveListIndex]) {
+    user_data_[kOperationIndex] = INSERT;
+    user_data_[kOperationListIndex] = user_data_[kMoveListIndex] - 1;
+    return;
+  }
+  user_data_[kMoveListIndex] = 0;
   user_data_[kTransactionIndex] = 0;
   user_data_[kOperationIndex] = 0;
+  user_data_[kOperationListIndex] = 0;
 }
 
 // Code locations that can generate crashes.
@@ -152,6 +173,20 @@ void GenerateCrash(CrashLocation location) {
 
 namespace disk_cache {
 
+Rankings::Iterator::Iterator(Rankings* rankings) : my_rankings(rankings) {
+  for (int i = 0; i < LAST_ELEMENT; i++) {
+    nodes[i] = NULL;
+    done[i] = false;
+  }
+}
+
+Rankings::Iterator::~Iterator() {
+  for (int i = 0; i < LAST_ELEMENT; i++) {
+    my_rankings->FreeRankingsBlock(nodes[i]);
+    delete nodes[i];
+  }
+}
+
 bool Rankings::Init(BackendImpl* backend) {
   DCHECK(!init_);
   if (init_)
@@ -161,9 +196,10 @@ bool Rankings::Init(BackendImpl* backend) {
   MappedFile* file = backend_->File(Addr(RANKINGS, 0, 0, 0));
 
   header_ = reinterpret_cast<BlockFileHeader*>(file->buffer());
+  control_data_ = backend_->GetLruData();
 
-  head_ = ReadHead();
-  tail_ = ReadTail();
+  ReadHeads();
+  ReadTails();
 
   if (header_->user[kTransactionIndex])
     CompleteTransaction();
@@ -174,9 +210,12 @@ bool Rankings::Init(BackendImpl* backend) {
 
 void Rankings::Reset() {
   init_ = false;
-  head_.set_value(0);
-  tail_.set_value(0);
+  for (int i = 0; i < LAST_ELEMENT; i++) {
+    heads_[i].set_value(0);
+    tails_[i].set_value(0);
+  }
   header_ = NULL;
+  control_data_ = NULL;
 }
 
 bool Rankings::GetRanking(CacheRankingsBlock* rankings) {
@@ -211,20 +250,22 @@ bool Rankings::GetRanking(CacheRankingsBlock* rankings) {
   EntryImpl* cache_entry =
       reinterpret_cast<EntryImpl*>(rankings->Data()->pointer);
   rankings->SetData(cache_entry->rankings()->Data());
-  UMA_HISTOGRAM_TIMES(L"DiskCache.GetRankings", Time::Now() - start);
+  backend_->RecordTime(BackendImpl::GET_RANKINGS, Time::Now() - start);
   return true;
 }
 
-void Rankings::Insert(CacheRankingsBlock* node, bool modified) {
-  Trace("Insert 0x%x", node->address().value());
+void Rankings::Insert(CacheRankingsBlock* node, bool modified, List list) {
+  Trace("Insert 0x%x l %d", node->address().value(), list);
   DCHECK(node->HasData());
-  Transaction lock(header_->user, node->address(), INSERT);
-  CacheRankingsBlock head(backend_->File(head_), head_);
-  if (head_.is_initialized()) {
+  Addr& my_head = heads_[list];
+  Addr& my_tail = tails_[list];
+  Transaction lock(header_->user, node->address(), INSERT, list);
+  CacheRankingsBlock head(backend_->File(my_head), my_head);
+  if (my_head.is_initialized()) {
     if (!GetRanking(&head))
       return;
 
-    if (head.Data()->prev != head_.value() &&  // Normal path.
+    if (head.Data()->prev != my_head.value() &&  // Normal path.
         head.Data()->prev != node->address().value()) {  // FinishInsert().
       backend_->CriticalError(ERR_INVALID_LINKS);
       return;
@@ -236,14 +277,15 @@ void Rankings::Insert(CacheRankingsBlock* node, bool modified) {
     UpdateIterators(&head);
   }
 
-  node->Data()->next = head_.value();
+  node->Data()->next = my_head.value();
   node->Data()->prev = node->address().value();
-  head_.set_value(node->address().value());
+  my_head.set_value(node->address().value());
 
-  if (!tail_.is_initialized() || tail_.value() == node->address().value()) {
-    tail_.set_value(node->address().value());
-    node->Data()->next = tail_.value();
-    WriteTail();
+  if (!my_tail.is_initialized() ||
+      my_tail.value() == node->address().value()) {
+    my_tail.set_value(node->address().value());
+    node->Data()->next = my_tail.value();
+    WriteTail(list);
     GenerateCrash(ON_INSERT_2);
   }
 
@@ -255,7 +297,8 @@ void Rankings::Insert(CacheRankingsBlock* node, bool modified) {
   GenerateCrash(ON_INSERT_3);
 
   // The last thing to do is move our head to point to a node already stored.
-  WriteHead();
+  WriteHead(list);
+  control_data_->sizes[list]++;
   GenerateCrash(ON_INSERT_4);
 }
 
@@ -285,9 +328,9 @@ void Rankings::Insert(CacheRankingsBlock* node, bool modified) {
 //    2. a(x, r), r(a, r), head(x), tail(a)           WriteTail()
 //    3. a(x, a), r(a, r), head(x), tail(a)           prev.Store()
 //    4. a(x, a), r(0, 0), head(x), tail(a)           next.Store()
-void Rankings::Remove(CacheRankingsBlock* node) {
-  Trace("Remove 0x%x (0x%x 0x%x)", node->address().value(), node->Data()->next,
-        node->Data()->prev);
+void Rankings::Remove(CacheRankingsBlock* node, List list) {
+  Trace("Remove 0x%x (0x%x 0x%x) l %d", node->address().value(),
+        node->Data()->next, node->Data()->prev, list);
   DCHECK(node->HasData());
   Addr next_addr(node->Data()->next);
   Addr prev_addr(node->Data()->prev);
@@ -305,32 +348,34 @@ void Rankings::Remove(CacheRankingsBlock* node) {
   if (!CheckLinks(node, &prev, &next))
     return;
 
-  Transaction lock(header_->user, node->address(), REMOVE);
+  Addr& my_head = heads_[list];
+  Addr& my_tail = tails_[list];
+  Transaction lock(header_->user, node->address(), REMOVE, list);
   prev.Data()->next = next.address().value();
   next.Data()->prev = prev.address().value();
   GenerateCrash(ON_REMOVE_1);
 
   CacheAddr node_value = node->address().value();
-  if (node_value == head_.value() || node_value == tail_.value()) {
-    if (head_.value() == tail_.value()) {
-      head_.set_value(0);
-      tail_.set_value(0);
+  if (node_value == my_head.value() || node_value == my_tail.value()) {
+    if (my_head.value() == my_tail.value()) {
+      my_head.set_value(0);
+      my_tail.set_value(0);
 
-      WriteHead();
+      WriteHead(list);
       GenerateCrash(ON_REMOVE_2);
-      WriteTail();
+      WriteTail(list);
       GenerateCrash(ON_REMOVE_3);
-    } else if (node_value == head_.value()) {
-      head_.set_value(next.address().value());
+    } else if (node_value == my_head.value()) {
+      my_head.set_value(next.address().value());
       next.Data()->prev = next.address().value();
 
-      WriteHead();
+      WriteHead(list);
       GenerateCrash(ON_REMOVE_4);
-    } else if (node_value == tail_.value()) {
-      tail_.set_value(prev.address().value());
+    } else if (node_value == my_tail.value()) {
+      my_tail.set_value(prev.address().value());
       prev.Data()->next = prev.address().value();
 
-      WriteTail();
+      WriteTail(list);
       GenerateCrash(ON_REMOVE_5);
 
       // Store the new tail to make sure we can undo the operation if we crash.
@@ -350,6 +395,7 @@ void Rankings::Remove(CacheRankingsBlock* node) {
   prev.Store();
   GenerateCrash(ON_REMOVE_8);
   node->Store();
+  control_data_->sizes[list]--;
   UpdateIterators(&next);
   UpdateIterators(&prev);
 }
@@ -358,11 +404,32 @@ void Rankings::Remove(CacheRankingsBlock* node) {
 // list. We want to avoid that case as much as we can (as while waiting for IO),
 // but the net effect is just an assert on debug when attempting to remove the
 // entry. Otherwise we'll need reentrant transactions, which is an overkill.
-void Rankings::UpdateRank(CacheRankingsBlock* node, bool modified) {
+void Rankings::UpdateRank(CacheRankingsBlock* node, bool modified,
+                          List list) {
   Time start = Time::Now();
-  Remove(node);
-  Insert(node, modified);
-  UMA_HISTOGRAM_TIMES(L"DiskCache.UpdateRank", Time::Now() - start);
+  Remove(node, list);
+  Insert(node, modified, list);
+  backend_->RecordTime(BackendImpl::UPDATE_RANK, Time::Now() - start);
+}
+
+bool Rankings::Move(CacheRankingsBlock* node, List from, List to,
+                    CacheEntryBlock* entry) {
+  Trace("Move 0x%x l %d to %d", node->address().value(), from, to);
+  DCHECK(from != to);
+  header_->user[kMoveListIndex] = to + 1;
+  Remove(node, from);
+  if (!header_->user[kTransactionIndex]) {
+    // Remove() gave up before touching the list.
+    header_->user[kMoveListIndex] = 0;
+    return false;
+  }
+
+  // If we crash from now on, CompleteTransaction() inserts the node on the
+  // target list and fixes up the entry.
+  entry->Data()->list = to;
+  entry->Store();
+  Insert(node, false, to);
+  return true;
 }
 
 void Rankings::CompleteTransaction() {
@@ -382,45 +449,62 @@ void Rankings::CompleteTransaction() {
   node.Data()->pointer = NULL;
   node.Store();
 
+  List list = static_cast<List>(header_->user[kOperationListIndex]);
+  if (list < 0 || list >= LAST_ELEMENT) {
+    NOTREACHED();
+    LOG(ERROR) << "Invalid rankings list to recover.";
+    return;
+  }
+
   // We want to leave the node inside the list. The entry must me marked as
   // dirty, and will be removed later. Otherwise, we'll get assertions when
   // attempting to remove the dirty entry.
   if (INSERT == header_->user[kOperationIndex]) {
-    Trace("FinishInsert h:0x%x t:0x%x", head_.value(), tail_.value());
-    FinishInsert(&node);
+    Trace("FinishInsert h:0x%x t:0x%x", heads_[list].value(),
+          tails_[list].value());
+    FinishInsert(&node, list);
   } else if (REMOVE == header_->user[kOperationIndex]) {
-    Trace("RevertRemove h:0x%x t:0x%x", head_.value(), tail_.value());
-    RevertRemove(&node);
+    Trace("RevertRemove h:0x%x t:0x%x", heads_[list].value(),
+          tails_[list].value());
+    RevertRemove(&node, list);
   } else {
     NOTREACHED();
     LOG(ERROR) << "Invalid operation to recover.";
   }
 }
 
-void Rankings::FinishInsert(CacheRankingsBlock* node) {
+void Rankings::FinishInsert(CacheRankingsBlock* node, List list) {
+  header_->user[kMoveListIndex] = 0;
   header_->user[kTransactionIndex] = 0;
   header_->user[kOperationIndex] = 0;
-  if (head_.value() != node->address().value()) {
-    if (tail_.value() == node->address().value()) {
+  header_->user[kOperationListIndex] = 0;
+  if (heads_[list].value() != node->address().value()) {
+    if (tails_[list].value() == node->address().value()) {
       // This part will be skipped by the logic of Insert.
-      node->Data()->next = tail_.value();
+      node->Data()->next = tails_[list].value();
     }
 
-    Insert(node, true);
+    Insert(node, true, list);
   }
 
   // Tell the backend about this entry.
-  backend_->RecoveredEntry(node);
+  backend_->RecoveredEntry(node, list);
 }
 
-void Rankings::RevertRemove(CacheRankingsBlock* node) {
+void Rankings::RevertRemove(CacheRankingsBlock* node, List list) {
   Addr next_addr(node->Data()->next);
   Addr prev_addr(node->Data()->prev);
   if (!next_addr.is_initialized() || !prev_addr.is_initialized()) {
-    // The operation actually finished. Nothing to do.
+    // The operation actually finished. If it was the first half of a move,
+    // the node still has to go on the target list.
+    if (header_->user[kMoveListIndex]) {
+      FinishInsert(node, static_cast<List>(header_->user[kMoveListIndex] - 1));
+      return;
+    }
     header_->user[kTransactionIndex] = 0;
     return;
   }
+  header_->user[kMoveListIndex] = 0;
   if (next_addr.is_separate_file() || prev_addr.is_separate_file()) {
     NOTREACHED();
     LOG(WARNING) << "Invalid rankings info.";
@@ -446,37 +530,42 @@ void Rankings::RevertRemove(CacheRankingsBlock* node) {
   if (node_value != next_addr.value())
     next.Data()->prev = node_value;
 
-  if (!head_.is_initialized() || !tail_.is_initialized()) {
-    head_.set_value(node_value);
-    tail_.set_value(node_value);
-    WriteHead();
-    WriteTail();
-  } else if (head_.value() == next.address().value()) {
-    head_.set_value(node_value);
+  Addr& my_head = heads_[list];
+  Addr& my_tail = tails_[list];
+  if (!my_head.is_initialized() || !my_tail.is_initialized()) {
+    my_head.set_value(node_value);
+    my_tail.set_value(node_value);
+    WriteHead(list);
+    WriteTail(list);
+  } else if (my_head.value() == next.address().value()) {
+    my_head.set_value(node_value);
     prev.Data()->next = next.address().value();
-    WriteHead();
-  } else if (tail_.value() == prev.address().value()) {
-    tail_.set_value(node_value);
+    WriteHead(list);
+  } else if (my_tail.value() == prev.address().value()) {
+    my_tail.set_value(node_value);
     next.Data()->prev = prev.address().value();
-    WriteTail();
+    WriteTail(list);
   }
 
   next.Store();
   prev.Store();
   header_->user[kTransactionIndex] = 0;
   header_->user[kOperationIndex] = 0;
+  header_->user[kOperationListIndex] = 0;
 }
 
-CacheRankingsBlock* Rankings::GetNext(CacheRankingsBlock* node) {
+CacheRankingsBlock* Rankings::GetNext(CacheRankingsBlock* node, List list) {
   ScopedRankingsBlock next(this);
   if (!node) {
-    if (!head_.is_initialized())
+    Addr& my_head = heads_[list];
+    if (!my_head.is_initialized())
       return NULL;
-    next.reset(new CacheRankingsBlock(backend_->File(head_), head_));
+    next.reset(new CacheRankingsBlock(backend_->File(my_head), my_head));
   } else {
-    if (!tail_.is_initialized())
+    Addr& my_tail = tails_[list];
+    if (!my_tail.is_initialized())
       return NULL;
-    if (tail_.value() == node->address().value())
+    if (my_tail.value() == node->address().value())
       return NULL;
     Addr address(node->Data()->next);
     next.reset(new CacheRankingsBlock(backend_->File(address), address));
@@ -493,16 +582,18 @@ CacheRankingsBlock* Rankings::GetNext(CacheRankingsBlock* node) {
   return next.release();
 }
 
-CacheRankingsBlock* Rankings::GetPrev(CacheRankingsBlock* node) {
+CacheRankingsBlock* Rankings::GetPrev(CacheRankingsBlock* node, List list) {
   ScopedRankingsBlock prev(this);
   if (!node) {
-    if (!tail_.is_initialized())
+    Addr& my_tail = tails_[list];
+    if (!my_tail.is_initialized())
       return NULL;
-    prev.reset(new CacheRankingsBlock(backend_->File(tail_), tail_));
+    prev.reset(new CacheRankingsBlock(backend_->File(my_tail), my_tail));
   } else {
-    if (!head_.is_initialized())
+    Addr& my_head = heads_[list];
+    if (!my_head.is_initialized())
       return NULL;
-    if (head_.value() == node->address().value())
+    if (my_head.value() == node->address().value())
       return NULL;
     Addr address(node->Data()->prev);
     prev.reset(new CacheRankingsBlock(backend_->File(address), address));
@@ -523,24 +614,78 @@ void Rankings::FreeRankingsBlock(CacheRankingsBlock* node) {
   TrackRankingsBlock(node, false);
 }
 
+// Every list is sorted by the time of last use, so we only have to look at the
+// next node of each list and pick the most recent one.
+CacheRankingsBlock* Rankings::GetNext(Iterator* iterator) {
+  CacheRankingsBlock* candidates[LAST_ELEMENT];
+  int best = -1;
+  for (int i = 0; i < LAST_ELEMENT; i++) {
+    candidates[i] = NULL;
+    if (iterator->done[i])
+      continue;
+
+    candidates[i] = GetNext(iterator->nodes[i], static_cast<List>(i));
+    if (!candidates[i]) {
+      iterator->done[i] = true;
+      continue;
+    }
+
+    if (best < 0 ||
+        candidates[i]->Data()->last_used > candidates[best]->Data()->last_used)
+      best = i;
+  }
+
+  for (int i = 0; i < LAST_ELEMENT; i++) {
+    if (i != best) {
+      FreeRankingsBlock(candidates[i]);
+      delete candidates[i];
+    }
+  }
+
+  if (best < 0)
+    return NULL;
+
+  FreeRankingsBlock(iterator->nodes[best]);
+  delete iterator->nodes[best];
+  iterator->nodes[best] = candidates[best];
+  return candidates[best];
+}
+
+int32 Rankings::Size(List list) const {
+  return control_data_->sizes[list];
+}
+
 int Rankings::SelfCheck() {
-  if (!head_.is_initialized()) {
-    if (!tail_.is_initialized())
+  int total = 0;
+  for (int i = 0; i < LAST_ELEMENT; i++) {
+    int partial = CheckList(static_cast<List>(i));
+    if (partial < 0)
+      return partial;
+    total += partial;
+  }
+  return total;
+}
+
+int Rankings::CheckList(List list) {
+  Addr& my_head = heads_[list];
+  Addr& my_tail = tails_[list];
+  if (!my_head.is_initialized()) {
+    if (!my_tail.is_initialized())
       return 0;
     return ERR_INVALID_TAIL;
   }
-  if (!tail_.is_initialized())
+  if (!my_tail.is_initialized())
     return ERR_INVALID_HEAD;
 
-  if (tail_.is_separate_file())
+  if (my_tail.is_separate_file())
     return ERR_INVALID_TAIL;
 
-  if (head_.is_separate_file())
+  if (my_head.is_separate_file())
     return ERR_INVALID_HEAD;
 
   int num_items = 0;
-  Addr address(head_.value());
-  Addr prev(head_.value());
+  Addr address(my_head.value());
+  Addr prev(my_head.value());
   scoped_ptr<CacheRankingsBlock> node;
   do {
     node.reset(new CacheRankingsBlock(backend_->File(address), address));
@@ -576,31 +721,31 @@ bool Rankings::SanityCheck(CacheRankingsBlock* node, bool from_list) {
   if (!data->next && !data->prev && from_list)
     return false;
 
-  if ((node->address().value() == data->prev) && (head_.value() != data->prev))
+  if ((node->address().value() == data->prev) && !IsHead(data->prev))
     return false;
 
-  if ((node->address().value() == data->next) && (tail_.value() != data->next))
+  if ((node->address().value() == data->next) && !IsTail(data->next))
     return false;
 
   return true;
 }
 
-Addr Rankings::ReadHead() {
-  CacheAddr head = static_cast<CacheAddr>(header_->user[kHeadIndex]);
-  return Addr(head);
+void Rankings::ReadHeads() {
+  for (int i = 0; i < LAST_ELEMENT; i++)
+    heads_[i] = Addr(control_data_->heads[i]);
 }
 
-Addr Rankings::ReadTail() {
-  CacheAddr tail = static_cast<CacheAddr>(header_->user[kTailIndex]);
-  return Addr(tail);
+void Rankings::ReadTails() {
+  for (int i = 0; i < LAST_ELEMENT; i++)
+    tails_[i] = Addr(control_data_->tails[i]);
 }
 
-void Rankings::WriteHead() {
-  header_->user[kHeadIndex] = static_cast<int32>(head_.value());
+void Rankings::WriteHead(List list) {
+  control_data_->heads[list] = heads_[list].value();
 }
 
-void Rankings::WriteTail() {
-  header_->user[kTailIndex] = static_cast<int32>(tail_.value());
+void Rankings::WriteTail(List list) {
+  control_data_->tails[list] = tails_[list].value();
 }
 
 bool Rankings::CheckEntry(CacheRankingsBlock* rankings) {
@@ -614,9 +759,9 @@ bool Rankings::CheckEntry(CacheRankingsBlock* rankings) {
 bool Rankings::CheckLinks(CacheRankingsBlock* node, CacheRankingsBlock* prev,
                           CacheRankingsBlock* next) {
   if ((prev->Data()->next != node->address().value() &&
-       head_.value() != node->address().value()) ||
+       !IsHead(node->address().value())) ||
       (next->Data()->prev != node->address().value() &&
-       tail_.value() != node->address().value())) {
+       !IsTail(node->address().value()))) {
     LOG(ERROR) << "Inconsistent LRU.";
 
     if (prev->Data()->next == next->address().value() &&
@@ -647,6 +792,22 @@ bool Rankings::CheckSingleLink(CacheRankingsBlock* prev,
   return true;
 }
 
+bool Rankings::IsHead(CacheAddr addr) {
+  for (int i = 0; i < LAST_ELEMENT; i++) {
+    if (addr == heads_[i].value())
+      return true;
+  }
+  return false;
+}
+
+bool Rankings::IsTail(CacheAddr addr) {
+  for (int i = 0; i < LAST_ELEMENT; i++) {
+    if (addr == tails_[i].value())
+      return true;
+  }
+  return false;
+}
+
 void Rankings::TrackRankingsBlock(CacheRankingsBlock* node,
                                   bool start_tracking) {
   if (!node)
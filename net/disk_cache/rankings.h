@@ -46,8 +46,23 @@ enum RankCrashes {
 };
 
 // This class handles the ranking information for the cache.
+//
+// Entries are kept on LRU lists, sorted by the time of their last use. A cache
+// that uses the plain LRU eviction policy stores all the entries on the first
+// list. With the segmented policy, new entries start on the probationary list,
+// and entries that are reused often enough (and are small enough) move to the
+// protected list, which is only used for eviction after the probationary list
+// runs out. The policy is decided by the backend; this class only maintains
+// the lists.
 class Rankings {
  public:
+  // Possible lists of entries.
+  enum List {
+    PROBATIONARY = 0,  // Also the only list for the plain LRU policy.
+    PROTECTED,
+    LAST_ELEMENT
+  };
+
   // This class provides a specialized version of scoped_ptr, that calls
   // Rankings whenever a CacheRankingsBlock is deleted, to keep track of cache
   // iterators that may go stale.
@@ -73,8 +88,21 @@ class Rankings {
     DISALLOW_EVIL_CONSTRUCTORS(ScopedRankingsBlock);
   };
 
-  Rankings()
-      : init_(false), head_(0), tail_(0) {}
+  // Keeps track of an enumeration of the entries of all the lists, from the
+  // most recently used to the least recently used.
+  struct Iterator {
+    explicit Iterator(Rankings* rankings);
+    ~Iterator();
+
+    Rankings* my_rankings;
+    CacheRankingsBlock* nodes[LAST_ELEMENT];  // Last node returned, per list.
+    bool done[LAST_ELEMENT];  // There is nothing left on a given list.
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(Iterator);
+  };
+
+  Rankings() : init_(false), control_data_(NULL) {}
   ~Rankings() {}
 
   bool Init(BackendImpl* backend);
@@ -83,20 +111,35 @@ class Rankings {
   void Reset();
 
   // Inserts a given entry at the head of the queue.
-  void Insert(CacheRankingsBlock* node, bool modified);
+  void Insert(CacheRankingsBlock* node, bool modified, List list);
 
   // Removes a given entry from the LRU list.
-  void Remove(CacheRankingsBlock* node);
+  void Remove(CacheRankingsBlock* node, List list);
 
   // Moves a given entry to the head.
-  void UpdateRank(CacheRankingsBlock* node, bool modified);
+  void UpdateRank(CacheRankingsBlock* node, bool modified, List list);
+
+  // Moves a given entry from the list |from| to the head of the list |to|, and
+  // records the new list on |entry|. The move is one transaction, so a crash
+  // leaves the entry on one of the lists, and |entry| agrees with it. Returns
+  // false if the entry could not be removed from |from|.
+  bool Move(CacheRankingsBlock* node, List from, List to,
+            CacheEntryBlock* entry);
 
   // Iterates through the list.
-  CacheRankingsBlock* GetNext(CacheRankingsBlock* node);
-  CacheRankingsBlock* GetPrev(CacheRankingsBlock* node);
+  CacheRankingsBlock* GetNext(CacheRankingsBlock* node, List list);
+  CacheRankingsBlock* GetPrev(CacheRankingsBlock* node, List list);
   void FreeRankingsBlock(CacheRankingsBlock* node);
 
-  // Peforms a simple self-check of the list, and returns the number of items
+  // Returns the next node of an enumeration of all the lists, merged by the
+  // time of last use, or NULL when there is nothing left. The returned node is
+  // owned by the iterator.
+  CacheRankingsBlock* GetNext(Iterator* iterator);
+
+  // Returns the number of entries stored on a given list.
+  int32 Size(List list) const;
+
+  // Peforms a simple self-check of the lists, and returns the number of items
   // or an error code (negative value).
   int SelfCheck();
 
@@ -108,18 +151,25 @@ class Rankings {
   typedef std::pair<CacheAddr, CacheRankingsBlock*> IteratorPair;
   typedef std::list<IteratorPair> IteratorList;
 
-  Addr ReadHead();
-  Addr ReadTail();
-  void WriteHead();
-  void WriteTail();
+  void ReadHeads();
+  void ReadTails();
+  void WriteHead(List list);
+  void WriteTail(List list);
 
   // Gets the rankings information for a given rankings node.
   bool GetRanking(CacheRankingsBlock* rankings);
 
   // Finishes a list modification after a crash.
   void CompleteTransaction();
-  void FinishInsert(CacheRankingsBlock* rankings);
-  void RevertRemove(CacheRankingsBlock* rankings);
+  void FinishInsert(CacheRankingsBlock* rankings, List list);
+  void RevertRemove(CacheRankingsBlock* rankings, List list);
+
+  // Self-check of a single list. Returns the number of items or an error.
+  int CheckList(List list);
+
+  // Returns true if addr is the head or the tail of any list.
+  bool IsHead(CacheAddr addr);
+  bool IsTail(CacheAddr addr);
 
   // Returns false if this entry will not be recognized as dirty (called during
   // selfcheck).
@@ -139,9 +189,10 @@ class Rankings {
   void UpdateIterators(CacheRankingsBlock* node);
 
   bool init_;
-  Addr head_;
-  Addr tail_;
+  Addr heads_[LAST_ELEMENT];
+  Addr tails_[LAST_ELEMENT];
   BlockFileHeader* header_;  // Header of the block-file used to store rankings.
+  LruData* control_data_;  // Data related to the LRU lists.
   BackendImpl* backend_;
   IteratorList iterators_;
 
@@ -0,0 +1,334 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/sharded_backend.h"
+
+#include <map>
+
+#include "base/file_util.h"
+#include "base/lock.h"
+#include "base/logging.h"
+#include "base/string_util.h"
+#include "net/disk_cache/backend_impl.h"
+#include "net/disk_cache/hash.h"
+
+namespace {
+
+// The default size of the whole cache, same as for a regular disk cache.
+const int kDefaultCacheSize = 80 * 1024 * 1024;
+
+// Used to enumerate the entries of all the shards.
+struct ShardedIterator {
+  ShardedIterator() : shard(0), iter(NULL) {}
+
+  int shard;  // The shard being enumerated.
+  void* iter;  // The enumeration state of that shard.
+};
+
+}  // namespace
+
+namespace disk_cache {
+
+Backend* CreateShardedCacheBackend(const std::wstring& full_path, bool force,
+                                   int max_bytes, int num_shards) {
+  ShardedBackend* cache = new ShardedBackend(full_path, num_shards);
+  if (cache->Init(force, max_bytes))
+    return cache;
+
+  delete cache;
+  LOG(ERROR) << "Unable to create sharded cache";
+  return NULL;
+}
+
+// ------------------------------------------------------------------------
+
+struct ShardedBackend::Shard {
+  Shard() {}
+
+  scoped_ptr<BackendImpl> backend;
+
+  // Serializes all access to |backend| and to the entries that it returns.
+  Lock lock;
+
+  // The entries handed out to our callers, keyed by the entry of |backend|.
+  typedef std::map<Entry*, ShardEntry*> EntriesMap;
+  EntriesMap open_entries;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Shard);
+};
+
+// Forwards every call to an entry of a shard, while holding the shard's lock.
+// Each object holds as many references to the wrapped entry as the number of
+// times that the entry was opened through the ShardedBackend.
+class ShardedBackend::ShardEntry : public Entry {
+ public:
+  ShardEntry(Shard* shard, Entry* entry)
+      : shard_(shard), entry_(entry), num_opens_(1) {}
+
+  // Records one more reference to the wrapped entry. The lock must be held.
+  void AddRef() {
+    num_opens_++;
+  }
+
+  // Entry interface.
+  virtual void Doom() {
+    AutoLock lock(shard_->lock);
+    entry_->Doom();
+  }
+
+  virtual void Close() {
+    AutoLock lock(shard_->lock);
+    entry_->Close();
+    if (--num_opens_)
+      return;
+
+    shard_->open_entries.erase(entry_);
+    delete this;
+  }
+
+  virtual std::string GetKey() const {
+    AutoLock lock(shard_->lock);
+    return entry_->GetKey();
+  }
+
+  virtual Time GetLastUsed() const {
+    AutoLock lock(shard_->lock);
+    return entry_->GetLastUsed();
+  }
+
+  virtual Time GetLastModified() const {
+    AutoLock lock(shard_->lock);
+    return entry_->GetLastModified();
+  }
+
+  virtual int32 GetDataSize(int index) const {
+    AutoLock lock(shard_->lock);
+    return entry_->GetDataSize(index);
+  }
+
+  virtual int ReadData(int index, int offset, char* buf, int buf_len,
+                       net::CompletionCallback* completion_callback) {
+    AutoLock lock(shard_->lock);
+    return entry_->ReadData(index, offset, buf, buf_len, NULL);
+  }
+
+  virtual int WriteData(int index, int offset, const char* buf, int buf_len,
+                        net::CompletionCallback* completion_callback,
+                        bool truncate) {
+    AutoLock lock(shard_->lock);
+    return entry_->WriteData(index, offset, buf, buf_len, NULL, truncate);
+  }
+
+  // The children of a sparse entry are stored on the same shard as the entry.
+  virtual int ReadSparseData(int64 offset, char* buf, int buf_len,
+                             net::CompletionCallback* completion_callback) {
+    AutoLock lock(shard_->lock);
+    return entry_->ReadSparseData(offset, buf, buf_len, NULL);
+  }
+
+  virtual int WriteSparseData(int64 offset, const char* buf, int buf_len,
+                              net::CompletionCallback* completion_callback) {
+    AutoLock lock(shard_->lock);
+    return entry_->WriteSparseData(offset, buf, buf_len, NULL);
+  }
+
+  virtual int GetAvailableRange(int64 offset, int len, int64* start) {
+    AutoLock lock(shard_->lock);
+    return entry_->GetAvailableRange(offset, len, start);
+  }
+
+ private:
+  ~ShardEntry() {}
+
+  Shard* shard_;
+  Entry* entry_;
+  int num_opens_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardEntry);
+};
+
+// ------------------------------------------------------------------------
+
+ShardedBackend::ShardedBackend(const std::wstring& path, int num_shards)
+    : path_(path), num_shards_(num_shards), shards_(new Shard[num_shards]) {
+  DCHECK_GT(num_shards, 0);
+}
+
+ShardedBackend::~ShardedBackend() {
+  for (int i = 0; i < num_shards_; i++)
+    DCHECK(shards_[i].open_entries.empty());
+}
+
+bool ShardedBackend::Init(bool force, int max_bytes) {
+  if (max_bytes < 0)
+    return false;
+  if (!max_bytes)
+    max_bytes = kDefaultCacheSize;
+
+  for (int i = 0; i < num_shards_; i++) {
+    // CreateCacheBackend takes care of discarding a broken shard if needed.
+    Backend* cache = CreateCacheBackend(GetShardPath(path_, i), force,
+                                        max_bytes / num_shards_);
+    if (!cache)
+      return false;
+
+    shards_[i].backend.reset(static_cast<BackendImpl*>(cache));
+    shards_[i].backend->SetExternalLock(&shards_[i].lock);
+  }
+  return true;
+}
+
+// static
+std::wstring ShardedBackend::GetShardPath(const std::wstring& path,
+                                          int shard) {
+  std::wstring shard_path(path);
+  file_util::AppendToPath(&shard_path, StringPrintf(L"shard_%02d", shard));
+  return shard_path;
+}
+
+int32 ShardedBackend::GetEntryCount() const {
+  int32 count = 0;
+  for (int i = 0; i < num_shards_; i++) {
+    AutoLock lock(shards_[i].lock);
+    count += shards_[i].backend->GetEntryCount();
+  }
+  return count;
+}
+
+bool ShardedBackend::OpenEntry(const std::string& key, Entry** entry) {
+  Shard* shard = GetShard(key);
+  AutoLock lock(shard->lock);
+  Entry* shard_entry;
+  if (!shard->backend->OpenEntry(key, &shard_entry))
+    return false;
+
+  *entry = WrapEntry(shard, shard_entry);
+  return true;
+}
+
+bool ShardedBackend::CreateEntry(const std::string& key, Entry** entry) {
+  Shard* shard = GetShard(key);
+  AutoLock lock(shard->lock);
+  Entry* shard_entry;
+  if (!shard->backend->CreateEntry(key, &shard_entry))
+    return false;
+
+  *entry = WrapEntry(shard, shard_entry);
+  return true;
+}
+
+bool ShardedBackend::DoomEntry(const std::string& key) {
+  Shard* shard = GetShard(key);
+  AutoLock lock(shard->lock);
+  return shard->backend->DoomEntry(key);
+}
+
+bool ShardedBackend::DoomAllEntries() {
+  bool result = true;
+  for (int i = 0; i < num_shards_; i++) {
+    AutoLock lock(shards_[i].lock);
+    if (!shards_[i].backend->DoomAllEntries())
+      result = false;
+  }
+  return result;
+}
+
+bool ShardedBackend::DoomEntriesBetween(const Time initial_time,
+                                        const Time end_time) {
+  bool result = true;
+  for (int i = 0; i < num_shards_; i++) {
+    AutoLock lock(shards_[i].lock);
+    if (!shards_[i].backend->DoomEntriesBetween(initial_time, end_time))
+      result = false;
+  }
+  return result;
+}
+
+bool ShardedBackend::DoomEntriesSince(const Time initial_time) {
+  bool result = true;
+  for (int i = 0; i < num_shards_; i++) {
+    AutoLock lock(shards_[i].lock);
+    if (!shards_[i].backend->DoomEntriesSince(initial_time))
+      result = false;
+  }
+  return result;
+}
+
+// Enumerates the shards one after another.
+bool ShardedBackend::OpenNextEntry(void** iter, Entry** next_entry) {
+  ShardedIterator* sharded_iter = reinterpret_cast<ShardedIterator*>(*iter);
+  if (!sharded_iter)
+    sharded_iter = new ShardedIterator;
+
+  for (; sharded_iter->shard < num_shards_; sharded_iter->shard++) {
+    Shard* shard = &shards_[sharded_iter->shard];
+    AutoLock lock(shard->lock);
+    Entry* shard_entry;
+    if (shard->backend->OpenNextEntry(&sharded_iter->iter, &shard_entry)) {
+      *next_entry = WrapEntry(shard, shard_entry);
+      *iter = sharded_iter;
+      return true;
+    }
+    // The shard's iterator is released when it runs out of entries.
+    DCHECK(!sharded_iter->iter);
+  }
+
+  delete sharded_iter;
+  *iter = NULL;
+  return false;
+}
+
+void ShardedBackend::EndEnumeration(void** iter) {
+  ShardedIterator* sharded_iter = reinterpret_cast<ShardedIterator*>(*iter);
+  if (!sharded_iter)
+    return;
+
+  if (sharded_iter->iter) {
+    Shard* shard = &shards_[sharded_iter->shard];
+    AutoLock lock(shard->lock);
+    shard->backend->EndEnumeration(&sharded_iter->iter);
+  }
+  delete sharded_iter;
+  *iter = NULL;
+}
+
+void ShardedBackend::GetStats(
+    std::vector<std::pair<std::string, std::string> >* stats) {
+  for (int i = 0; i < num_shards_; i++) {
+    std::vector<std::pair<std::string, std::string> > shard_stats;
+    {
+      AutoLock lock(shards_[i].lock);
+      shards_[i].backend->GetStats(&shard_stats);
+    }
+
+    std::string prefix = StringPrintf("Shard %d: ", i);
+    for (size_t j = 0; j < shard_stats.size(); j++) {
+      stats->push_back(std::make_pair(prefix + shard_stats[j].first,
+                                      shard_stats[j].second));
+    }
+  }
+}
+
+ShardedBackend::Shard* ShardedBackend::GetShard(const std::string& key) {
+  // BackendImpl uses the low bits of the hash to select a bucket of its
+  // table, so we use the high bits; otherwise each shard would only use a
+  // fraction of its table.
+  uint32 hash = Hash(key);
+  return &shards_[(hash >> 16) % num_shards_];
+}
+
+Entry* ShardedBackend::WrapEntry(Shard* shard, Entry* entry) {
+  Shard::EntriesMap::iterator it = shard->open_entries.find(entry);
+  if (it != shard->open_entries.end()) {
+    it->second->AddRef();
+    return it->second;
+  }
+
+  ShardEntry* shard_entry = new ShardEntry(shard, entry);
+  shard->open_entries[entry] = shard_entry;
+  return shard_entry;
+}
+
+}  // namespace disk_cache
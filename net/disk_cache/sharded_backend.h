@@ -0,0 +1,77 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_SHARDED_BACKEND_H_
+#define NET_DISK_CACHE_SHARDED_BACKEND_H_
+
+#include "base/scoped_ptr.h"
+#include "net/disk_cache/disk_cache.h"
+
+namespace disk_cache {
+
+class BackendImpl;
+
+// This class implements the Backend interface by splitting the cache into a
+// number of shards, each one of them a regular BackendImpl (with its own index,
+// rankings and block files) stored on a sub-folder of the cache, and guarded by
+// its own lock. Keys are assigned to shards by hash, so operations on entries
+// that live on different shards can proceed in parallel.
+//
+// Unlike the other backends, this object and the entries that it returns can
+// be used from any thread, although it should be created and destroyed on a
+// thread with a MessageLoop (the one that runs the periodic cache tasks). All
+// IO is performed synchronously, so ReadData and WriteData never return
+// ERR_IO_PENDING, and they ignore the completion callback.
+class ShardedBackend : public Backend {
+ public:
+  ShardedBackend(const std::wstring& path, int num_shards);
+  ~ShardedBackend();
+
+  // Creates or opens the shards. max_bytes is split evenly between them, with
+  // zero meaning the default size for the whole cache. If force is true, a
+  // shard that cannot be initialized is discarded and created again.
+  bool Init(bool force, int max_bytes);
+
+  // Backend interface.
+  virtual int32 GetEntryCount() const;
+  virtual bool OpenEntry(const std::string& key, Entry** entry);
+  virtual bool CreateEntry(const std::string& key, Entry** entry);
+  virtual bool DoomEntry(const std::string& key);
+  virtual bool DoomAllEntries();
+  virtual bool DoomEntriesBetween(const Time initial_time,
+                                  const Time end_time);
+  virtual bool DoomEntriesSince(const Time initial_time);
+  virtual bool OpenNextEntry(void** iter, Entry** next_entry);
+  virtual void EndEnumeration(void** iter);
+  virtual void GetStats(
+      std::vector<std::pair<std::string, std::string> >* stats);
+
+  // Returns the folder used by the given shard of a cache stored on |path|.
+  static std::wstring GetShardPath(const std::wstring& path, int shard);
+
+  int num_shards() const { return num_shards_; }
+
+ private:
+  class ShardEntry;
+  struct Shard;
+
+  // Returns the shard that stores |key|.
+  Shard* GetShard(const std::string& key);
+
+  // Returns the object to hand out for |entry|, an entry of |shard|. There is
+  // only one of them per open entry. The shard's lock must be held.
+  Entry* WrapEntry(Shard* shard, Entry* entry);
+
+  std::wstring path_;
+  int num_shards_;
+  scoped_array<Shard> shards_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardedBackend);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SHARDED_BACKEND_H_
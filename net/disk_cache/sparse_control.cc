@@ -0,0 +1,440 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/sparse_control.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/rand_util.h"
+#include "base/string_util.h"
+#include "net/base/net_errors.h"
+#include "net/disk_cache/disk_cache.h"
+
+namespace {
+
+// The maximum number of children of an entry. The sparse data is limited to
+// offsets below kMaxChildren * kSparseChildSize (1 TB).
+const int64 kMaxChildren = 1024 * 1024;
+
+// The data streams of a child entry.
+const int kChildHeaderIndex = 0;
+const int kChildDataIndex = 1;
+
+const int kBitsPerWord = 32;
+
+}  // namespace
+
+namespace disk_cache {
+
+SparseControl::SparseControl(Backend* backend, Entry* entry)
+    : backend_(backend),
+      entry_(entry),
+      initialized_(false),
+      child_(NULL),
+      child_id_(0) {
+  memset(&sparse_header_, 0, sizeof(sparse_header_));
+}
+
+SparseControl::~SparseControl() {
+  CloseChild();
+}
+
+int SparseControl::ReadData(int64 offset, char* buf, int buf_len) {
+  if (offset < 0 || buf_len < 0)
+    return net::ERR_INVALID_ARGUMENT;
+
+  if (!buf_len || !Init(false))
+    return 0;
+
+  int total = 0;
+  while (buf_len) {
+    int64 child_id = offset / kSparseChildSize;
+    if (child_id >= kMaxChildren || !OpenChild(child_id, false))
+      break;
+
+    int child_offset = static_cast<int>(offset % kSparseChildSize);
+    int len = std::min(buf_len, kSparseChildSize - child_offset);
+    int start, end;
+    if (!FindChildRange(child_offset, child_offset + len, &start, &end) ||
+        start != child_offset)
+      break;
+
+    int rv = child_->ReadData(kChildDataIndex, start, buf, end - start, NULL);
+    if (rv != end - start) {
+      // The child is not usable anymore.
+      child_->Doom();
+      CloseChild();
+      SetChildPresent(child_id, false);
+      if (!total)
+        return rv < 0 ? rv : net::ERR_FAILED;
+      break;
+    }
+
+    total += rv;
+    offset += rv;
+    buf += rv;
+    buf_len -= rv;
+    if (end != child_offset + len)
+      break;  // There is a hole after this range.
+  }
+  return total;
+}
+
+int SparseControl::WriteData(int64 offset, const char* buf, int buf_len) {
+  if (offset < 0 || buf_len < 0)
+    return net::ERR_INVALID_ARGUMENT;
+
+  if (offset + buf_len > kMaxChildren * kSparseChildSize)
+    return net::ERR_FAILED;
+
+  if (!buf_len)
+    return 0;
+
+  if (!Init(true))
+    return net::ERR_FAILED;
+
+  int total = 0;
+  while (buf_len) {
+    int64 child_id = offset / kSparseChildSize;
+    if (!OpenChild(child_id, true))
+      break;
+
+    int child_offset = static_cast<int>(offset % kSparseChildSize);
+    int len = std::min(buf_len, kSparseChildSize - child_offset);
+
+    // The data goes first, so that a failure to write it leaves the child
+    // header describing what is actually stored.
+    int rv = child_->WriteData(kChildDataIndex, child_offset, buf, len, NULL,
+                               false);
+    if (rv != len) {
+      child_->Doom();
+      CloseChild();
+      SetChildPresent(child_id, false);
+      break;
+    }
+
+    AddChildRange(child_offset, child_offset + len);
+    if (!WriteChildHeader()) {
+      child_->Doom();
+      CloseChild();
+      SetChildPresent(child_id, false);
+      break;
+    }
+
+    total += len;
+    offset += len;
+    buf += len;
+    buf_len -= len;
+  }
+  return total ? total : net::ERR_FAILED;
+}
+
+int SparseControl::GetAvailableRange(int64 offset, int len, int64* start) {
+  if (offset < 0 || len < 0 || !start)
+    return net::ERR_INVALID_ARGUMENT;
+
+  *start = offset;
+  if (!len || !Init(false))
+    return 0;
+
+  // Look for the first stored byte, and then for the end of the data that
+  // follows it without holes.
+  bool found = false;
+  int total = 0;
+  int64 end = offset + len;
+  while (offset < end) {
+    int64 child_id = offset / kSparseChildSize;
+    if (child_id >= kMaxChildren)
+      break;
+
+    int64 child_start = child_id * kSparseChildSize;
+    int child_offset = static_cast<int>(offset - child_start);
+    int child_end = static_cast<int>(
+        std::min(end - child_start, static_cast<int64>(kSparseChildSize)));
+    int range_start, range_end;
+    if (!OpenChild(child_id, false) ||
+        !FindChildRange(child_offset, child_end, &range_start, &range_end)) {
+      if (found)
+        break;
+      offset = child_start + kSparseChildSize;
+      continue;
+    }
+
+    if (found && range_start != child_offset)
+      break;
+
+    if (!found) {
+      found = true;
+      *start = child_start + range_start;
+    }
+    total += range_end - range_start;
+    if (range_end != child_end)
+      break;
+    offset = child_start + child_end;
+  }
+  return total;
+}
+
+void SparseControl::DeleteChildren() {
+  if (!Init(false))
+    return;
+
+  CloseChild();
+  for (size_t word = 0; word < children_map_.size(); word++) {
+    if (!children_map_[word])
+      continue;
+    for (int bit = 0; bit < kBitsPerWord; bit++) {
+      if (children_map_[word] & (1U << bit))
+        backend_->DoomEntry(GenerateChildKey(word * kBitsPerWord + bit));
+    }
+  }
+  children_map_.clear();
+}
+
+bool SparseControl::Init(bool create) {
+  if (initialized_)
+    return true;
+
+  key_ = entry_->GetKey();
+  int size = entry_->GetDataSize(kSparseIndex);
+  if (size >= static_cast<int>(sizeof(sparse_header_))) {
+    int rv = entry_->ReadData(kSparseIndex, 0,
+                              reinterpret_cast<char*>(&sparse_header_),
+                              sizeof(sparse_header_), NULL);
+    if (rv == sizeof(sparse_header_) && sparse_header_.magic == kSparseMagic) {
+      int map_len = (size - sizeof(sparse_header_)) / sizeof(uint32);
+      children_map_.resize(map_len);
+      if (map_len) {
+        int bytes = map_len * sizeof(uint32);
+        rv = entry_->ReadData(kSparseIndex, sizeof(sparse_header_),
+                              reinterpret_cast<char*>(&children_map_[0]),
+                              bytes, NULL);
+        if (rv != bytes)
+          children_map_.clear();
+      }
+      initialized_ = true;
+      return true;
+    }
+  }
+
+  if (!create)
+    return false;
+
+  // Any sparse data that we don't understand is lost.
+  children_map_.clear();
+  memset(&sparse_header_, 0, sizeof(sparse_header_));
+  sparse_header_.signature = static_cast<int64>(base::RandUInt64());
+  sparse_header_.magic = kSparseMagic;
+  if (!WriteSparseHeader())
+    return false;
+
+  initialized_ = true;
+  return true;
+}
+
+bool SparseControl::OpenChild(int64 child_id, bool create) {
+  if (child_ && child_id_ == child_id)
+    return true;
+
+  CloseChild();
+  std::string key = GenerateChildKey(child_id);
+  if (ChildPresent(child_id)) {
+    Entry* child;
+    if (backend_->OpenEntry(key, &child)) {
+      child_ = child;
+      child_id_ = child_id;
+      if (LoadChildHeader())
+        return true;
+
+      // This is not one of our children.
+      child_->Doom();
+      CloseChild();
+    }
+    SetChildPresent(child_id, false);
+  }
+
+  if (!create)
+    return false;
+
+  Entry* child;
+  if (!backend_->CreateEntry(key, &child)) {
+    // There may be a stale entry with the same key.
+    backend_->DoomEntry(key);
+    if (!backend_->CreateEntry(key, &child))
+      return false;
+  }
+
+  child_ = child;
+  child_id_ = child_id;
+  if (!WriteChildHeader()) {
+    child_->Doom();
+    CloseChild();
+    return false;
+  }
+  SetChildPresent(child_id, true);
+  return true;
+}
+
+void SparseControl::CloseChild() {
+  if (child_) {
+    child_->Close();
+    child_ = NULL;
+  }
+  child_ranges_.clear();
+}
+
+bool SparseControl::LoadChildHeader() {
+  DCHECK(child_);
+  child_ranges_.clear();
+
+  SparseChildHeader header;
+  int size = child_->GetDataSize(kChildHeaderIndex);
+  if (size < static_cast<int>(sizeof(header)))
+    return false;
+
+  int rv = child_->ReadData(kChildHeaderIndex, 0,
+                            reinterpret_cast<char*>(&header), sizeof(header),
+                            NULL);
+  if (rv != sizeof(header) || header.magic != kSparseMagic ||
+      header.signature != sparse_header_.signature || header.num_ranges < 0)
+    return false;
+
+  int bytes = header.num_ranges * 2 * sizeof(int32);
+  if (size != static_cast<int>(sizeof(header)) + bytes)
+    return false;
+
+  if (!bytes)
+    return true;
+
+  std::vector<int32> values(header.num_ranges * 2);
+  rv = child_->ReadData(kChildHeaderIndex, sizeof(header),
+                        reinterpret_cast<char*>(&values[0]), bytes, NULL);
+  if (rv != bytes)
+    return false;
+
+  // The ranges must be sorted, and they must describe data that is there.
+  int previous_end = -1;
+  int data_size = child_->GetDataSize(kChildDataIndex);
+  for (int i = 0; i < header.num_ranges; i++) {
+    int start = values[i * 2];
+    int end = values[i * 2 + 1];
+    if (start <= previous_end || end <= start || end > data_size) {
+      child_ranges_.clear();
+      return false;
+    }
+    child_ranges_.push_back(Range(start, end));
+    previous_end = end;
+  }
+  return true;
+}
+
+bool SparseControl::WriteSparseHeader() {
+  int rv = entry_->WriteData(kSparseIndex, 0,
+                             reinterpret_cast<char*>(&sparse_header_),
+                             sizeof(sparse_header_), NULL, true);
+  return rv == sizeof(sparse_header_);
+}
+
+bool SparseControl::WriteChildHeader() {
+  DCHECK(child_);
+  SparseChildHeader header;
+  memset(&header, 0, sizeof(header));
+  header.signature = sparse_header_.signature;
+  header.magic = kSparseMagic;
+  header.num_ranges = static_cast<int32>(child_ranges_.size());
+
+  std::vector<char> buffer(sizeof(header) +
+                           child_ranges_.size() * 2 * sizeof(int32));
+  memcpy(&buffer[0], &header, sizeof(header));
+  int32* values = reinterpret_cast<int32*>(&buffer[sizeof(header)]);
+  for (size_t i = 0; i < child_ranges_.size(); i++) {
+    values[i * 2] = child_ranges_[i].first;
+    values[i * 2 + 1] = child_ranges_[i].second;
+  }
+
+  int len = static_cast<int>(buffer.size());
+  int rv = child_->WriteData(kChildHeaderIndex, 0, &buffer[0], len, NULL,
+                             true);
+  return rv == len;
+}
+
+bool SparseControl::FindChildRange(int offset, int end, int* start,
+                                   int* range_end) const {
+  for (size_t i = 0; i < child_ranges_.size(); i++) {
+    const Range& range = child_ranges_[i];
+    if (range.second <= offset)
+      continue;
+    if (range.first >= end)
+      return false;
+    *start = std::max(range.first, offset);
+    *range_end = std::min(range.second, end);
+    return true;
+  }
+  return false;
+}
+
+void SparseControl::AddChildRange(int start, int end) {
+  DCHECK(start < end);
+  RangeList ranges;
+  ranges.reserve(child_ranges_.size() + 1);
+  bool added = false;
+  for (size_t i = 0; i < child_ranges_.size(); i++) {
+    const Range& range = child_ranges_[i];
+    if (range.second < start) {
+      ranges.push_back(range);
+    } else if (range.first > end) {
+      if (!added) {
+        ranges.push_back(Range(start, end));
+        added = true;
+      }
+      ranges.push_back(range);
+    } else {
+      // Overlapping or adjacent ranges are merged.
+      start = std::min(start, range.first);
+      end = std::max(end, range.second);
+    }
+  }
+  if (!added)
+    ranges.push_back(Range(start, end));
+  child_ranges_.swap(ranges);
+}
+
+std::string SparseControl::GenerateChildKey(int64 child_id) const {
+  return "Range_" + key_ + ":" + Int64ToString(sparse_header_.signature) +
+         ":" + Int64ToString(child_id);
+}
+
+bool SparseControl::ChildPresent(int64 child_id) const {
+  size_t word = static_cast<size_t>(child_id / kBitsPerWord);
+  if (word >= children_map_.size())
+    return false;
+  return (children_map_[word] & (1U << (child_id % kBitsPerWord))) != 0;
+}
+
+void SparseControl::SetChildPresent(int64 child_id, bool present) {
+  size_t word = static_cast<size_t>(child_id / kBitsPerWord);
+  size_t first_word = word;
+  if (word >= children_map_.size()) {
+    if (!present)
+      return;
+    // The new part of the bitmap is written as well.
+    first_word = children_map_.size();
+    children_map_.resize(word + 1);
+  }
+
+  uint32 mask = 1 << (child_id % kBitsPerWord);
+  if (present)
+    children_map_[word] |= mask;
+  else
+    children_map_[word] &= ~mask;
+
+  int offset = sizeof(sparse_header_) + first_word * sizeof(uint32);
+  int len = (word - first_word + 1) * sizeof(uint32);
+  char* data = reinterpret_cast<char*>(&children_map_[first_word]);
+  int rv = entry_->WriteData(kSparseIndex, offset, data, len, NULL, false);
+  LOG_IF(ERROR, rv != len) << "Failed to update the sparse data map";
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,93 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface.
+
+#ifndef NET_DISK_CACHE_SPARSE_CONTROL_H_
+#define NET_DISK_CACHE_SPARSE_CONTROL_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "net/disk_cache/disk_format.h"
+
+namespace disk_cache {
+
+class Backend;
+class Entry;
+
+// This class implements the sparse data of an entry on top of regular entries
+// of the same backend, as described in net/disk_cache/disk_format.h. It is
+// used by all the backends, and it performs all the IO synchronously.
+class SparseControl {
+ public:
+  // |entry| is the parent entry, which owns this object, and |backend| is the
+  // cache that stores it.
+  SparseControl(Backend* backend, Entry* entry);
+  ~SparseControl();
+
+  // Implementation of the sparse methods of Entry.
+  int ReadData(int64 offset, char* buf, int buf_len);
+  int WriteData(int64 offset, const char* buf, int buf_len);
+  int GetAvailableRange(int64 offset, int len, int64* start);
+
+  // Dooms the children of the entry. Called when the parent is doomed.
+  void DeleteChildren();
+
+ private:
+  // The start and end offsets of some data stored by a child.
+  typedef std::pair<int, int> Range;
+  typedef std::vector<Range> RangeList;
+
+  // Loads the sparse header of the entry. If the entry has no sparse data (or
+  // the header is not valid), a new header is written if |create| is true;
+  // otherwise, returns false.
+  bool Init(bool create);
+
+  // Makes |child_id| the current child, opening the entry that stores it, or
+  // creating it if |create| is true. Returns false if there is no such child.
+  bool OpenChild(int64 child_id, bool create);
+  void CloseChild();
+
+  // Reads the header of the current child. Returns false if it is not one of
+  // our children.
+  bool LoadChildHeader();
+
+  // Writes the sparse header of the entry or the header of the current child.
+  bool WriteSparseHeader();
+  bool WriteChildHeader();
+
+  // Looks for the first range stored by the current child that overlaps with
+  // [offset, end), and returns in |start| and |range_end| the part of it that
+  // lies within [offset, end). Returns false if there is none.
+  bool FindChildRange(int offset, int end, int* start, int* range_end) const;
+
+  // Records that the current child stores [start, end).
+  void AddChildRange(int start, int end);
+
+  // Returns the key of the entry that stores |child_id|.
+  std::string GenerateChildKey(int64 child_id) const;
+
+  bool ChildPresent(int64 child_id) const;
+  void SetChildPresent(int64 child_id, bool present);
+
+  Backend* backend_;
+  Entry* entry_;
+  bool initialized_;
+  std::string key_;  // The key of |entry_|.
+  SparseHeader sparse_header_;
+  std::vector<uint32> children_map_;  // One bit per child.
+
+  Entry* child_;  // The current child, if any.
+  int64 child_id_;
+  RangeList child_ranges_;  // The data stored by |child_|.
+
+  DISALLOW_COPY_AND_ASSIGN(SparseControl);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SPARSE_CONTROL_H_
@@ -53,6 +53,10 @@ static const char* kCounterNames[] = {
   "Open rankings",
   "Get rankings",
   "Fatal error",
+  "Probationary hit",
+  "Protected hit",
+  "Promote entry",
+  "Demote entry",
 };
 COMPILE_ASSERT(arraysize(kCounterNames) == disk_cache::Stats::MAX_COUNTER,
                update_the_names);
@@ -120,9 +124,9 @@ bool Stats::Init(BackendImpl* backend, uint32* storage_addr) {
 
   storage_addr_ = address.value();
   backend_ = backend;
-  if (!size_histogram_.get()) {
+  if (!size_histogram_.get() && !StatsHistogram::InUse()) {
     // Stats may be reused when the cache is re-created, but we want only one
-    // histogram at any given time.
+    // histogram at any given time (even if there are multiple caches).
     size_histogram_.reset(new StatsHistogram(L"DiskCache.SizeStats"));
     size_histogram_->Init(this);
   }
@@ -251,6 +255,13 @@ int64 Stats::GetCounter(Counters counter) const {
   return counters_[counter];
 }
 
+int Stats::GetHitRatio(Counters hits) const {
+  int64 opens = counters_[OPEN_HIT] + counters_[OPEN_MISS];
+  if (!opens)
+    return 0;
+  return static_cast<int>(GetCounter(hits) * 100 / opens);
+}
+
 void Stats::GetItems(StatsItems* items) {
   std::pair<std::string, std::string> item;
   for (int i = 0; i < kDataSizesLength; i++) {
@@ -264,6 +275,14 @@ void Stats::GetItems(StatsItems* items) {
     item.second = StringPrintf("0x%I64x", counters_[i]);
     items->push_back(item);
   }
+
+  item.first = "Probationary hit ratio";
+  item.second = StringPrintf("%d%%", GetHitRatio(PROBATIONARY_HIT));
+  items->push_back(item);
+
+  item.first = "Protected hit ratio";
+  item.second = StringPrintf("%d%%", GetHitRatio(PROTECTED_HIT));
+  items->push_back(item);
 }
 
 }  // namespace disk_cache
@@ -41,6 +41,10 @@ class Stats {
     OPEN_RANKINGS,  // An entry has to be read just to modify rankings.
     GET_RANKINGS,  // We got the ranking info without reading the whole entry.
     FATAL_ERROR,
+    PROBATIONARY_HIT,  // OPEN_HIT for an entry on the probationary list.
+    PROTECTED_HIT,  // OPEN_HIT for an entry on the protected list.
+    PROMOTE_ENTRY,  // An entry moved to the protected list.
+    DEMOTE_ENTRY,  // An entry moved back to the probationary list.
     MAX_COUNTER
   };
 
@@ -57,6 +61,10 @@ class Stats {
   void SetCounter(Counters counter, int64 value);
   int64 GetCounter(Counters counter) const;
 
+  // Returns the percentage of the open requests that were satisfied by the
+  // given hit counter (PROBATIONARY_HIT, PROTECTED_HIT or OPEN_HIT).
+  int GetHitRatio(Counters hits) const;
+
   void GetItems(StatsItems* items);
 
   // Support for StatsHistograms. Together, these methods allow StatsHistograms
@@ -30,6 +30,12 @@ class StatsHistogram : public Histogram {
   // We'll be reporting data from the given set of cache stats.
   bool Init(const Stats* stats);
 
+  // Returns true if some cache is already reporting its stats. There can only
+  // be one at any given time.
+  static bool InUse() {
+    return stats_ != NULL;
+  }
+
   virtual Sample ranges(size_t i) const;
   virtual size_t bucket_count() const;
   virtual void SnapshotSample(SampleSet* sample) const;
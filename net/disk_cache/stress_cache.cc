@@ -10,20 +10,29 @@
 // The child application has two threads: one to exercise the cache in an
 // infinite loop, and another one to asynchronously kill the process.
 
+// When started with --stall, the application instead measures for how long the
+// thread that uses the cache is unable to run other tasks while large entries
+// are being read, which is what the network IO thread experiences.
+
 #include <windows.h>
 #include <string>
 
 #include "base/at_exit.h"
+#include "base/compiler_specific.h"
 #include "base/logging.h"
 #include "base/message_loop.h"
 #include "base/path_service.h"
+#include "base/scoped_ptr.h"
 #include "base/string_util.h"
 #include "base/thread.h"
+#include "base/timer.h"
+#include "net/base/net_errors.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/disk_cache_test_util.h"
 
 const int kError = -1;
 const int kExpectedCrash = 1000000;
+const char kStallSwitch[] = "--stall";
 
 // Starts a new process.
 int RunSlave(int iteration) {
@@ -179,6 +188,168 @@ void CrashHandler(const std::string& str) {
 
 // -----------------------------------------------------------------------
 
+// Runs every few milliseconds on the thread that uses the cache, and keeps
+// track of how late it is.
+class StallMonitor {
+ public:
+  StallMonitor() : num_stalls_(0) {}
+
+  void Start() {
+    last_check_ = TimeTicks::Now();
+    timer_.Start(TimeDelta::FromMilliseconds(kPeriodMs), this,
+                 &StallMonitor::OnTimer);
+  }
+
+  void Stop() {
+    timer_.Stop();
+  }
+
+  void OnTimer() {
+    TimeTicks now = TimeTicks::Now();
+    TimeDelta stall = now - last_check_ - TimeDelta::FromMilliseconds(kPeriodMs);
+    last_check_ = now;
+
+    // Ignore the regular jitter of the timer.
+    if (stall < TimeDelta::FromMilliseconds(kPeriodMs))
+      return;
+
+    num_stalls_++;
+    total_stall_ += stall;
+    if (stall > max_stall_)
+      max_stall_ = stall;
+  }
+
+  int num_stalls() const { return num_stalls_; }
+  TimeDelta total_stall() const { return total_stall_; }
+  TimeDelta max_stall() const { return max_stall_; }
+
+ private:
+  static const int kPeriodMs = 5;
+
+  base::RepeatingTimer<StallMonitor> timer_;
+  TimeTicks last_check_;
+  int num_stalls_;
+  TimeDelta total_stall_;
+  TimeDelta max_stall_;
+};
+
+const int kLargeDataLen = 1024 * 1024;
+
+// Reads random entries from the cache, one after another, using asynchronous
+// IO whenever the cache supports it.
+class CacheReader {
+ public:
+  CacheReader(disk_cache::Backend* cache, const std::string* keys,
+              int num_keys, int num_reads)
+      : cache_(cache), keys_(keys), num_keys_(num_keys),
+        num_reads_(num_reads), reads_done_(0), entry_(NULL),
+        buffer_(new char[kLargeDataLen]),
+        ALLOW_THIS_IN_INITIALIZER_LIST(
+            callback_(this, &CacheReader::OnReadComplete)),
+        ALLOW_THIS_IN_INITIALIZER_LIST(method_factory_(this)) {}
+
+  ~CacheReader() {
+    if (entry_)
+      entry_->Close();
+  }
+
+  // Starts reading when the message loop runs.
+  void Start() {
+    MessageLoop::current()->PostTask(FROM_HERE,
+        method_factory_.NewRunnableMethod(&CacheReader::ReadNext));
+  }
+
+ private:
+  void ReadNext() {
+    if (entry_)
+      entry_->Close();
+    entry_ = NULL;
+
+    if (reads_done_ == num_reads_) {
+      MessageLoop::current()->Quit();
+      return;
+    }
+    reads_done_++;
+
+    CHECK(cache_->OpenEntry(keys_[rand() % num_keys_], &entry_));
+    int ret = entry_->ReadData(0, 0, buffer_.get(), kLargeDataLen, &callback_);
+    if (net::ERR_IO_PENDING != ret)
+      OnReadComplete(ret);
+  }
+
+  void OnReadComplete(int result) {
+    CHECK(kLargeDataLen == result);
+
+    // Give other tasks a chance to run before the next read.
+    MessageLoop::current()->PostTask(FROM_HERE,
+        method_factory_.NewRunnableMethod(&CacheReader::ReadNext));
+  }
+
+  disk_cache::Backend* cache_;
+  const std::string* keys_;
+  int num_keys_;
+  int num_reads_;
+  int reads_done_;
+  disk_cache::Entry* entry_;
+  scoped_array<char> buffer_;
+  net::CompletionCallbackImpl<CacheReader> callback_;
+  ScopedRunnableMethodFactory<CacheReader> method_factory_;
+};
+
+// Reads large entries from the cache while monitoring the current thread.
+int StallTest() {
+  MessageLoopForIO message_loop;
+
+  int cache_size = 0x8000000;  // 128MB
+  std::wstring path = GetCachePath();
+  path.append(L"_stall");
+  scoped_ptr<disk_cache::Backend> cache(
+      disk_cache::CreateCacheBackend(path, true, cache_size));
+  if (!cache.get()) {
+    printf("Unable to initialize cache.\n");
+    return kError;
+  }
+
+  // The entries are preserved between runs, so the test measures a cold
+  // cache if the system cache is flushed between runs.
+  const int kNumKeys = 64;
+  std::string keys[kNumKeys];
+  scoped_array<char> data(new char[kLargeDataLen]);
+  memset(data.get(), 'k', kLargeDataLen);
+  for (int i = 0; i < kNumKeys; i++) {
+    keys[i] = StringPrintf("stall test entry %d", i);
+    disk_cache::Entry* entry;
+    if (cache->OpenEntry(keys[i], &entry)) {
+      entry->Close();
+      continue;
+    }
+    CHECK(cache->CreateEntry(keys[i], &entry));
+    CHECK(kLargeDataLen == entry->WriteData(0, 0, data.get(), kLargeDataLen,
+                                            NULL, false));
+    entry->Close();
+  }
+
+  const int kNumReads = 500;
+  CacheReader reader(cache.get(), keys, kNumKeys, kNumReads);
+  StallMonitor monitor;
+  monitor.Start();
+  TimeTicks start = TimeTicks::Now();
+  reader.Start();
+  message_loop.Run();
+  TimeDelta elapsed = TimeTicks::Now() - start;
+  monitor.Stop();
+
+  printf("Read %d MB in %d ms.\n", kNumReads * (kLargeDataLen >> 20),
+         static_cast<int>(elapsed.InMilliseconds()));
+  printf("IO thread stalls: %d, total %d ms, max %d ms.\n",
+         monitor.num_stalls(),
+         static_cast<int>(monitor.total_stall().InMilliseconds()),
+         static_cast<int>(monitor.max_stall().InMilliseconds()));
+  return 0;
+}
+
+// -----------------------------------------------------------------------
+
 int main(int argc, const char* argv[]) {
   // Setup an AtExitManager so Singleton objects will be destructed.
   base::AtExitManager at_exit_manager; 
@@ -186,6 +357,9 @@ int main(int argc, const char* argv[]) {
   if (argc < 2)
     return MasterCode();
 
+  if (!strcmp(argv[1], kStallSwitch))
+    return StallTest();
+
   logging::SetLogAssertHandler(CrashHandler);
 
   // Some time for the memory manager to flush stuff.
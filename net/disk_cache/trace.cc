@@ -8,6 +8,8 @@
 #include <windows.h>
 #endif
 
+#include "base/lazy_instance.h"
+#include "base/lock.h"
 #include "base/logging.h"
 
 // Change this value to 1 to enable tracing on a release build. By default,
@@ -44,25 +46,35 @@ namespace disk_cache {
 
 #if ENABLE_TRACING
 
+// The buffer is shared by all the caches alive (there may be several when the
+// cache is sharded), possibly running on different threads.
 static TraceBuffer* s_trace_buffer = NULL;
+static int s_trace_users = 0;
+static base::LazyInstance<Lock> s_trace_lock(base::LINKER_INITIALIZED);
 
 bool InitTrace(void) {
-  DCHECK(!s_trace_buffer);
-  if (s_trace_buffer)
-    return false;
+  AutoLock lock(s_trace_lock.Get());
+  if (s_trace_users++)
+    return true;
 
+  DCHECK(!s_trace_buffer);
   s_trace_buffer = new TraceBuffer;
   memset(s_trace_buffer, 0, sizeof(*s_trace_buffer));
   return true;
 }
 
 void DestroyTrace(void) {
+  AutoLock lock(s_trace_lock.Get());
   DCHECK(s_trace_buffer);
+  if (--s_trace_users)
+    return;
+
   delete s_trace_buffer;
   s_trace_buffer = NULL;
 }
 
 void Trace(const char* format, ...) {
+  AutoLock lock(s_trace_lock.Get());
   DCHECK(s_trace_buffer);
   va_list ap;
   va_start(ap, format);
@@ -84,6 +96,7 @@ void Trace(const char* format, ...) {
 
 // Writes the last num_traces to the debugger output.
 void DumpTrace(int num_traces) {
+  AutoLock lock(s_trace_lock.Get());
   DCHECK(s_trace_buffer);
   DebugOutput("Last traces:\n");
 
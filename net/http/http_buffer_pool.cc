@@ -0,0 +1,43 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_buffer_pool.h"
+
+#include <stdlib.h>
+
+#include "base/logging.h"
+
+namespace net {
+
+HttpBufferPool::HttpBufferPool(int buffer_size, int max_free_buffers)
+    : buffer_size_(buffer_size),
+      max_free_buffers_(max_free_buffers) {
+  DCHECK(buffer_size > 0);
+  DCHECK(max_free_buffers >= 0);
+}
+
+HttpBufferPool::~HttpBufferPool() {
+  for (size_t i = 0; i < free_buffers_.size(); ++i)
+    free(free_buffers_[i]);
+}
+
+char* HttpBufferPool::Get() {
+  if (free_buffers_.empty())
+    return static_cast<char*>(malloc(buffer_size_));
+
+  char* buffer = free_buffers_.back();
+  free_buffers_.pop_back();
+  return buffer;
+}
+
+void HttpBufferPool::Release(char* buffer) {
+  DCHECK(buffer);
+  if (free_buffers_.size() >= max_free_buffers_) {
+    free(buffer);
+    return;
+  }
+  free_buffers_.push_back(buffer);
+}
+
+}  // namespace net
@@ -0,0 +1,46 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_HTTP_BUFFER_POOL_H_
+#define NET_HTTP_HTTP_BUFFER_POOL_H_
+
+#include <vector>
+
+#include "base/basictypes.h"
+
+namespace net {
+
+// HttpBufferPool keeps a few fixed-size buffers around so that transactions
+// don't have to allocate a new one for every response they read.  Buffers are
+// handed out by Get and handed back with Release; at most |max_free_buffers|
+// released buffers are kept for reuse.  This class is not thread safe.
+class HttpBufferPool {
+ public:
+  HttpBufferPool(int buffer_size, int max_free_buffers);
+  ~HttpBufferPool();
+
+  // Returns a buffer of buffer_size() bytes.
+  char* Get();
+
+  // Returns |buffer|, obtained from Get, to the pool.
+  void Release(char* buffer);
+
+  int buffer_size() const { return buffer_size_; }
+
+  // Returns the number of buffers available for reuse.
+  int free_buffer_count() const {
+    return static_cast<int>(free_buffers_.size());
+  }
+
+ private:
+  const int buffer_size_;
+  const size_t max_free_buffers_;
+  std::vector<char*> free_buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpBufferPool);
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_BUFFER_POOL_H_
@@ -0,0 +1,48 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_buffer_pool.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+TEST(HttpBufferPoolTest, ReusesBuffers) {
+  net::HttpBufferPool pool(4096, 2);
+  EXPECT_EQ(4096, pool.buffer_size());
+  EXPECT_EQ(0, pool.free_buffer_count());
+
+  char* buffer1 = pool.Get();
+  char* buffer2 = pool.Get();
+  ASSERT_TRUE(buffer1);
+  ASSERT_TRUE(buffer2);
+  EXPECT_TRUE(buffer1 != buffer2);
+
+  // The whole buffer is usable.
+  memset(buffer1, 'a', pool.buffer_size());
+
+  pool.Release(buffer1);
+  EXPECT_EQ(1, pool.free_buffer_count());
+  EXPECT_EQ(buffer1, pool.Get());
+  EXPECT_EQ(0, pool.free_buffer_count());
+
+  pool.Release(buffer2);
+  pool.Release(buffer1);
+  EXPECT_EQ(2, pool.free_buffer_count());
+}
+
+TEST(HttpBufferPoolTest, LimitsFreeBuffers) {
+  net::HttpBufferPool pool(100, 2);
+  char* buffers[4];
+  for (int i = 0; i < 4; ++i)
+    buffers[i] = pool.Get();
+  for (int i = 0; i < 4; ++i)
+    pool.Release(buffers[i]);
+  EXPECT_EQ(2, pool.free_buffer_count());
+
+  // Buffers are reused last in, first out.
+  EXPECT_EQ(buffers[1], pool.Get());
+  EXPECT_EQ(buffers[0], pool.Get());
+  EXPECT_EQ(0, pool.free_buffer_count());
+  // Releases the two buffers just obtained.
+  pool.Release(buffers[0]);
+  pool.Release(buffers[1]);
+}
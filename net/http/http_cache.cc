@@ -20,6 +20,7 @@
 #include "net/http/http_response_info.h"
 #include "net/http/http_transaction.h"
 #include "net/http/http_util.h"
+#include "net/http/partial_data.h"
 
 namespace net {
 
@@ -51,9 +52,12 @@ enum {
   // This bit is set if the response info has vary header data.
   RESPONSE_INFO_HAS_VARY_DATA = 1 << 11,
 
-  // TODO(darin): Add other bits to indicate alternate request methods and
-  // whether or not we are storing a partial document.  For now, we don't
-  // support storing those.
+  // This bit is set if the response body is stored as sparse data, because
+  // it was fetched by range requests.
+  RESPONSE_INFO_IS_SPARSE = 1 << 12,
+
+  // TODO(darin): Add other bits to indicate alternate request methods.  For
+  // now, we don't support storing those.
 };
 
 //-----------------------------------------------------------------------------
@@ -66,7 +70,7 @@ struct HeaderNameAndValue {
 // If the request includes one of these request headers, then avoid caching
 // to avoid getting confused.
 static const HeaderNameAndValue kPassThroughHeaders[] = {
-  { "range", NULL },                // causes unexpected 206s
+  { "if-range", NULL },             // causes unexpected 206s
   { "if-modified-since", NULL },    // causes unexpected 304s
   { "if-none-match", NULL },        // causes unexpected 304s
   { "if-unmodified-since", NULL },  // causes unexpected 412s
@@ -147,7 +151,9 @@ HttpCache::ActiveEntry::ActiveEntry(disk_cache::Entry* e)
     : disk_entry(e),
       writer(NULL),
       will_process_pending_queue(false),
-      doomed(false) {
+      doomed(false),
+      streaming(false),
+      truncated(false) {
 }
 
 HttpCache::ActiveEntry::~ActiveEntry() {
@@ -166,7 +172,12 @@ class HttpCache::Transaction : public HttpTransaction {
         callback_(NULL),
         mode_(NONE),
         read_buf_(NULL),
+        read_buf_len_(0),
         read_offset_(0),
+        waiting_for_writer_(false),
+        resuming_(false),
+        is_sparse_(false),
+        partial_started_(false),
         effective_load_flags_(0),
         final_upload_progress_(0),
         ALLOW_THIS_IN_INITIALIZER_LIST(
@@ -175,7 +186,8 @@ class HttpCache::Transaction : public HttpTransaction {
             network_read_callback_(this, &Transaction::OnNetworkReadCompleted)),
         ALLOW_THIS_IN_INITIALIZER_LIST(
             cache_read_callback_(new CancelableCompletionCallback<Transaction>(
-                this, &Transaction::OnCacheReadCompleted))) {
+                this, &Transaction::OnCacheReadCompleted))),
+        ALLOW_THIS_IN_INITIALIZER_LIST(task_factory_(this)) {
   }
 
   // Clean up the transaction.
@@ -226,6 +238,15 @@ class HttpCache::Transaction : public HttpTransaction {
   // to the transaction.  Returns network error code.
   int EntryAvailable(ActiveEntry* entry);
 
+  // Returns true if this transaction would read the response stored on
+  // |entry| as it is, without validating it, so it can read it while it is
+  // being written.
+  bool CanReadWhileWriting(ActiveEntry* entry);
+
+  // Called by the HttpCache when the writer of the entry that this transaction
+  // is streaming has appended data to it, or is done with it.
+  void OnWriterProgress();
+
  private:
   // This is a helper function used to trigger a completion callback.  It may
   // only be called if callback_ is non-null.
@@ -247,9 +268,74 @@ class HttpCache::Transaction : public HttpTransaction {
   // Called to begin reading from the cache.  Returns network error code.
   int BeginCacheRead();
 
+  // Called to begin reading from a cache entry that is still being written.
+  // Returns network error code.
+  int BeginStreamingRead();
+
+  // Called to read response data from the cache entry into read_buf_.
+  // Returns network error code.
+  int ReadFromEntry();
+
+  // Called once a read from the cache entry has completed.  Returns the result
+  // of the Read call, which is ERR_IO_PENDING if the transaction has to wait
+  // for the writer of the entry.
+  int HandleCacheReadResult(int result);
+
+  // Called when the entry that this transaction was streaming ends early,
+  // because its writer failed, to fetch the rest of the response from the
+  // network.  Returns the result of the Read call.
+  int ResumeFromNetwork();
+
+  // Called once the network transaction started by ResumeFromNetwork has
+  // started.  Returns the result of the Read call.
+  int HandleResumeStarted(int result);
+
   // Called to begin validating the cache entry.  Returns network error code.
   int BeginCacheValidation();
 
+  // Called instead of BeginCacheValidation (or BeginCacheRead) for a range
+  // request, or for a request that finds an entry stored as sparse data.
+  // Returns network error code.
+  int BeginPartialCacheValidation();
+
+  // Called to give up on the cache entry and fetch the response from the
+  // network.  Returns network error code.
+  int BypassCacheEntry();
+
+  // Called to process the first network response of a partial transaction.
+  // Returns false if the response should be handled as a regular one.
+  bool HandlePartialResponse(const HttpResponseInfo& new_response);
+
+  // Sets client_response_ from the stored response_.
+  void SetClientResponse();
+
+  // Points request_ to a request for the current piece of the range.
+  void SetPieceRequest();
+
+  // Called to fetch the current piece of the range from the network, while
+  // the user is reading the response.  Returns the result of the Read call.
+  int StartNetworkPiece();
+
+  // Called once the network transaction for a piece has started.  Returns the
+  // result of the Read call.
+  int HandleNetworkPieceStarted(int result);
+
+  // Called to read a range of the response body, piece by piece.  Returns
+  // network error code.
+  int ReadPartial(char* buf, int buf_len);
+
+  // Called to read data for the current piece into read_buf_.  Returns
+  // network error code.
+  int ReadPartialPiece();
+
+  // Called once a read of a piece has completed.  Both return the result of
+  // the Read call.
+  int HandlePartialNetworkReadResult(int result);
+  int HandlePartialCacheReadResult(int result);
+
+  // Called when a partial transaction is done with its cache entry.
+  void ReleasePartialEntry(bool success);
+
   // Called to begin a network transaction.  Returns network error code.
   int BeginNetworkRequest();
 
@@ -295,6 +381,9 @@ class HttpCache::Transaction : public HttpTransaction {
   // Called to signal completion of the cache's ReadData method:
   void OnCacheReadCompleted(int result);
 
+  // Called to retry a read that was waiting for the writer of the entry.
+  void OnResumeCacheRead();
+
   const HttpRequestInfo* request_;
   scoped_ptr<HttpRequestInfo> custom_request_;
   HttpCache* cache_;
@@ -306,19 +395,28 @@ class HttpCache::Transaction : public HttpTransaction {
   std::string cache_key_;
   Mode mode_;
   char* read_buf_;
+  int read_buf_len_;
   int read_offset_;
+  bool waiting_for_writer_;
+  bool resuming_;  // We are fetching the rest of a truncated entry.
+  scoped_ptr<PartialData> partial_;  // We are dealing with range requests.
+  bool is_sparse_;  // The response body is stored as sparse data.
+  bool partial_started_;  // The user is reading the range.
+  HttpResponseInfo client_response_;  // The response to a range request.
   int effective_load_flags_;
   uint64 final_upload_progress_;
   CompletionCallbackImpl<Transaction> network_info_callback_;
   CompletionCallbackImpl<Transaction> network_read_callback_;
   scoped_refptr<CancelableCompletionCallback<Transaction> > cache_read_callback_;
+  ScopedRunnableMethodFactory<Transaction> task_factory_;
 };
 
 HttpCache::Transaction::~Transaction() {
   if (entry_) {
     if (mode_ & WRITE) {
-      // Assume that this is not a successful write.
-      cache_->DoneWritingToEntry(entry_, false);
+      // Assume that this is not a successful write, unless the data is stored
+      // as sparse data: whatever was written is still good.
+      cache_->DoneWritingToEntry(entry_, is_sparse_);
     } else {
       cache_->DoneReadingFromEntry(entry_, this);
     }
@@ -348,6 +446,8 @@ int HttpCache::Transaction::Start(const HttpRequestInfo* request,
   int rv;
 
   if (ShouldPassThrough()) {
+    partial_.reset();
+
     // if must use cache, then we must fail.  this can happen for back/forward
     // navigations to a page generated via a form post.
     if (effective_load_flags_ & LOAD_ONLY_FROM_CACHE)
@@ -428,10 +528,18 @@ int HttpCache::Transaction::Read(char* buf, int buf_len,
     DCHECK(mode_ & WRITE);
     DoneWritingToEntry(mode_ == READ_WRITE);
     mode_ = NONE;
+    partial_.reset();
   }
 
   int rv;
 
+  if (partial_.get()) {
+    rv = ReadPartial(buf, buf_len);
+    if (rv == ERR_IO_PENDING)
+      callback_ = callback;
+    return rv;
+  }
+
   switch (mode_) {
     case NONE:
     case WRITE:
@@ -443,15 +551,9 @@ int HttpCache::Transaction::Read(char* buf, int buf_len,
       break;
     case READ:
       DCHECK(entry_);
-      cache_read_callback_->AddRef();  // Balanced in OnCacheReadCompleted
-      rv = entry_->disk_entry->ReadData(kResponseContentIndex, read_offset_,
-                                        buf, buf_len, cache_read_callback_);
       read_buf_ = buf;
-      if (rv >= 0) {
-        OnCacheReadCompleted(rv);
-      } else if (rv != ERR_IO_PENDING) {
-        cache_read_callback_->Release();
-      }
+      read_buf_len_ = buf_len;
+      rv = ReadFromEntry();
       break;
     default:
       NOTREACHED();
@@ -467,12 +569,16 @@ const HttpResponseInfo* HttpCache::Transaction::GetResponseInfo() const {
   // Null headers means we encountered an error or haven't a response yet
   if (auth_response_.headers)
     return &auth_response_;
+  if (partial_.get() && client_response_.headers)
+    return &client_response_;
   return (response_.headers || response_.ssl_info.cert) ? &response_ : NULL;
 }
 
 LoadState HttpCache::Transaction::GetLoadState() const {
   if (network_trans_.get())
     return network_trans_->GetLoadState();
+  if (waiting_for_writer_)
+    return LOAD_STATE_WAITING_FOR_CACHE;
   if (entry_ || !request_)
     return LOAD_STATE_IDLE;
   return LOAD_STATE_WAITING_FOR_CACHE;
@@ -514,6 +620,7 @@ int HttpCache::Transaction::AddToEntry() {
     if (!entry) {
       DLOG(WARNING) << "unable to create cache entry";
       mode_ = NONE;
+      partial_.reset();
       return BeginNetworkRequest();
     }
   }
@@ -534,8 +641,13 @@ int HttpCache::Transaction::EntryAvailable(ActiveEntry* entry) {
   //    to be validated and then issue a network request if needed or just read
   //    from the cache if the cache entry is already valid.
   //
+  //  o if another transaction is writing the response body, then we can read
+  //    what it has written so far.
+  //
   int rv;
   entry_ = entry;
+  if (entry->writer && entry->writer != this)
+    return BeginStreamingRead();
   switch (mode_) {
     case READ:
       rv = BeginCacheRead();
@@ -553,6 +665,35 @@ int HttpCache::Transaction::EntryAvailable(ActiveEntry* entry) {
   return rv;
 }
 
+bool HttpCache::Transaction::CanReadWhileWriting(ActiveEntry* entry) {
+  // Ranges are only served from complete entries.
+  if (partial_.get())
+    return false;
+
+  if (mode_ == READ)
+    return true;
+  if (mode_ != READ_WRITE)
+    return false;
+
+  // This is what BeginCacheValidation will find.
+  if (effective_load_flags_ & LOAD_PREFERRING_CACHE)
+    return true;
+  bool is_sparse;
+  if (!HttpCache::ReadResponseInfo(entry->disk_entry, &response_, &is_sparse))
+    return false;
+  return !RequiresValidation();
+}
+
+void HttpCache::Transaction::OnWriterProgress() {
+  if (!waiting_for_writer_)
+    return;
+  waiting_for_writer_ = false;
+
+  // The writer is in the middle of its own work, so retry the read later.
+  MessageLoop::current()->PostTask(FROM_HERE,
+      task_factory_.NewRunnableMethod(&Transaction::OnResumeCacheRead));
+}
+
 void HttpCache::Transaction::DoCallback(int rv) {
   DCHECK(rv != ERR_IO_PENDING);
   DCHECK(callback_);
@@ -604,10 +745,13 @@ void HttpCache::Transaction::SetRequest(const HttpRequestInfo* request) {
   };
 
   // scan request headers to see if we have any that would impact our load flags
+  bool range_found = false;
   HttpUtil::HeadersIterator it(request_->extra_headers.begin(),
                                request_->extra_headers.end(),
                                "\r\n");
   while (it.GetNext()) {
+    if (LowerCaseEqualsASCII(it.name_begin(), it.name_end(), "range"))
+      range_found = true;
     for (size_t i = 0; i < ARRAYSIZE_UNSAFE(kSpecialHeaders); ++i) {
       if (HeaderMatches(it, kSpecialHeaders[i].search)) {
         effective_load_flags_ |= kSpecialHeaders[i].load_flag;
@@ -615,6 +759,15 @@ void HttpCache::Transaction::SetRequest(const HttpRequestInfo* request) {
       }
     }
   }
+
+  if (range_found) {
+    partial_.reset(new PartialData);
+    if (!partial_->Init(request_->extra_headers)) {
+      // We only serve a single range with a known start from the cache.
+      partial_.reset();
+      effective_load_flags_ |= LOAD_DISABLE_CACHE;
+    }
+  }
 }
 
 bool HttpCache::Transaction::ShouldPassThrough() {
@@ -642,7 +795,20 @@ int HttpCache::Transaction::BeginCacheRead() {
   DCHECK(mode_ == READ);
 
   // read response headers
-  return HandleResult(ReadResponseInfoFromEntry());
+  int rv = ReadResponseInfoFromEntry();
+  if (rv == OK && (partial_.get() || is_sparse_))
+    return BeginPartialCacheValidation();
+  return HandleResult(rv);
+}
+
+int HttpCache::Transaction::BeginStreamingRead() {
+  DCHECK(mode_ & READ);
+
+  // The HttpCache only gives us the entry if we were going to read it as it
+  // is (see CanReadWhileWriting).
+  int rv = ReadResponseInfoFromEntry();
+  mode_ = READ;
+  return HandleResult(rv);
 }
 
 int HttpCache::Transaction::BeginCacheValidation() {
@@ -651,6 +817,8 @@ int HttpCache::Transaction::BeginCacheValidation() {
   int rv = ReadResponseInfoFromEntry();
   if (rv != OK) {
     DCHECK(rv != ERR_IO_PENDING);
+  } else if (partial_.get() || is_sparse_) {
+    return BeginPartialCacheValidation();
   } else if (effective_load_flags_ & LOAD_PREFERRING_CACHE ||
              !RequiresValidation()) {
     cache_->ConvertWriterToReader(entry_);
@@ -751,6 +919,11 @@ bool HttpCache::Transaction::ConditionalizeRequest() {
   custom_request_.reset(new HttpRequestInfo(*request_));
   request_ = custom_request_.get();
 
+  // A range is served from the cache once we know that the whole stored
+  // resource is still valid.
+  if (partial_.get())
+    custom_request_->extra_headers = partial_->extra_headers();
+
   if (!etag_value.empty()) {
     custom_request_->extra_headers.append("If-None-Match: ");
     custom_request_->extra_headers.append(etag_value);
@@ -769,7 +942,8 @@ bool HttpCache::Transaction::ConditionalizeRequest() {
 int HttpCache::Transaction::ReadResponseInfoFromEntry() {
   DCHECK(entry_);
 
-  if (!HttpCache::ReadResponseInfo(entry_->disk_entry, &response_))
+  if (!HttpCache::ReadResponseInfo(entry_->disk_entry, &response_,
+                                   &is_sparse_))
     return ERR_FAILED;
 
   return OK;
@@ -813,7 +987,7 @@ void HttpCache::Transaction::WriteResponseInfoToEntry() {
   bool skip_transient_headers = (cache_->mode() != RECORD);
 
   if (!HttpCache::WriteResponseInfo(entry_->disk_entry, &response_,
-                                    skip_transient_headers)) {
+                                    skip_transient_headers, is_sparse_)) {
     DLOG(ERROR) << "failed to write response info to cache";
     DoneWritingToEntry(false);
   }
@@ -826,6 +1000,8 @@ void HttpCache::Transaction::AppendResponseDataToEntry(const char* data,
 
   int current_size = entry_->disk_entry->GetDataSize(kResponseContentIndex);
   WriteToEntry(kResponseContentIndex, current_size, data, data_len);
+  if (entry_)
+    cache_->DidAppendToEntry(entry_);
 }
 
 void HttpCache::Transaction::DoneWritingToEntry(bool success) {
@@ -844,11 +1020,27 @@ void HttpCache::Transaction::DoneWritingToEntry(bool success) {
 void HttpCache::Transaction::OnNetworkInfoAvailable(int result) {
   DCHECK(result != ERR_IO_PENDING);
 
+  if (partial_started_) {
+    result = HandleNetworkPieceStarted(result);
+    if (result != ERR_IO_PENDING)
+      HandleResult(result);
+    return;
+  }
+
+  if (resuming_) {
+    result = HandleResumeStarted(result);
+    if (result != ERR_IO_PENDING)
+      HandleResult(result);
+    return;
+  }
+
   if (result == OK) {
     const HttpResponseInfo* new_response = network_trans_->GetResponseInfo();
     if (new_response->headers->response_code() == 401 ||
         new_response->headers->response_code() == 407) {
       auth_response_ = *new_response;
+    } else if (partial_.get() && HandlePartialResponse(*new_response)) {
+      // The response is handled piece by piece.
     } else {
       // Are we expecting a response to a conditional query?
       if (mode_ == READ_WRITE) {
@@ -889,6 +1081,11 @@ void HttpCache::Transaction::OnNetworkInfoAvailable(int result) {
 }
 
 void HttpCache::Transaction::OnNetworkReadCompleted(int result) {
+  if (partial_started_) {
+    HandleResult(HandlePartialNetworkReadResult(result));
+    return;
+  }
+
   DCHECK(mode_ & WRITE || mode_ == NONE);
 
   if (result > 0) {
@@ -899,17 +1096,385 @@ void HttpCache::Transaction::OnNetworkReadCompleted(int result) {
   HandleResult(result);
 }
 
+int HttpCache::Transaction::ReadFromEntry() {
+  cache_read_callback_->AddRef();  // Balanced in OnCacheReadCompleted
+  int rv = entry_->disk_entry->ReadData(kResponseContentIndex, read_offset_,
+                                        read_buf_, read_buf_len_,
+                                        cache_read_callback_);
+  if (rv >= 0) {
+    cache_read_callback_->Release();
+    rv = HandleCacheReadResult(rv);
+  } else if (rv != ERR_IO_PENDING) {
+    cache_read_callback_->Release();
+  }
+  return rv;
+}
+
+int HttpCache::Transaction::HandleCacheReadResult(int result) {
+  if (result > 0) {
+    read_offset_ += result;
+  } else if (result == 0) {  // end of file
+    if (entry_->writer) {
+      // We caught up with the writer; wait for it to append more data.
+      waiting_for_writer_ = true;
+      return ERR_IO_PENDING;
+    }
+    bool truncated = entry_->truncated;
+    cache_->DoneReadingFromEntry(entry_, this);
+    entry_ = NULL;
+    if (truncated)
+      return ResumeFromNetwork();
+  }
+  return result;
+}
+
+int HttpCache::Transaction::ResumeFromNetwork() {
+  DCHECK(!entry_);
+  DCHECK(!network_trans_.get());
+  mode_ = NONE;
+
+  // The user already has the response headers, so we can only continue with
+  // the body of the same response.
+  std::string validator = PartialData::GetValidator(response_.headers);
+  if ((effective_load_flags_ & LOAD_ONLY_FROM_CACHE) ||
+      (read_offset_ && validator.empty()))
+    return ERR_CACHE_READ_FAILURE;
+
+  HttpRequestInfo* request = new HttpRequestInfo(*request_);
+  if (read_offset_) {
+    request->extra_headers.append(StringPrintf("Range: bytes=%d-\r\n",
+                                               read_offset_));
+    request->extra_headers.append("If-Range: " + validator + "\r\n");
+  }
+  custom_request_.reset(request);
+  request_ = request;
+
+  network_trans_.reset(cache_->network_layer_->CreateTransaction());
+  if (!network_trans_.get())
+    return ERR_FAILED;
+
+  resuming_ = true;
+  int rv = network_trans_->Start(request_, &network_info_callback_);
+  if (rv != ERR_IO_PENDING)
+    rv = HandleResumeStarted(rv);
+  return rv;
+}
+
+int HttpCache::Transaction::HandleResumeStarted(int result) {
+  resuming_ = false;
+  if (result != OK)
+    return result;
+
+  // Anything but the rest of the response we were reading would corrupt the
+  // body that the user gets.
+  const HttpResponseHeaders* headers =
+      network_trans_->GetResponseInfo()->headers;
+  if (read_offset_) {
+    int64 first, last, length;
+    if (headers->response_code() != 206 ||
+        !headers->GetContentRange(&first, &last, &length) ||
+        first != read_offset_)
+      return ERR_CACHE_READ_FAILURE;
+  } else if (headers->response_code() != 200) {
+    return ERR_CACHE_READ_FAILURE;
+  }
+
+  return network_trans_->Read(read_buf_, read_buf_len_,
+                              &network_read_callback_);
+}
+
 void HttpCache::Transaction::OnCacheReadCompleted(int result) {
   DCHECK(cache_);
   cache_read_callback_->Release();  // Balance the AddRef() from Start()
 
+  if (partial_started_) {
+    HandleResult(HandlePartialCacheReadResult(result));
+    return;
+  }
+
+  result = HandleCacheReadResult(result);
+  if (result != ERR_IO_PENDING)
+    HandleResult(result);
+}
+
+void HttpCache::Transaction::OnResumeCacheRead() {
+  int rv = ReadFromEntry();
+  if (rv != ERR_IO_PENDING)
+    HandleResult(rv);
+}
+
+int HttpCache::Transaction::BeginPartialCacheValidation() {
+  DCHECK(mode_ & READ);
+
+  if (!partial_.get()) {
+    // The request is for the whole resource, but only some of it is stored.
+    partial_.reset(new PartialData);
+    partial_->InitWholeResource(request_->extra_headers);
+  }
+
+  // The stored headers describe the whole resource.  If the body is not sparse
+  // data, it is complete.
+  int64 length = is_sparse_ ? response_.headers->GetContentLength() :
+      entry_->disk_entry->GetDataSize(kResponseContentIndex);
+  if (response_.headers->response_code() != 200 || length < 0 ||
+      !partial_->SetResourceLength(length))
+    return BypassCacheEntry();
+
+  partial_->PrepareNextPiece(entry_->disk_entry, is_sparse_);
+  bool range_cached = partial_->piece_cached() && partial_->IsLastPiece();
+
+  if (mode_ == READ) {
+    if (!range_cached)
+      return BypassCacheEntry();
+    SetClientResponse();
+    return HandleResult(OK);
+  }
+
+  if (!(effective_load_flags_ & LOAD_PREFERRING_CACHE) &&
+      RequiresValidation()) {
+    // Validate the whole resource before serving any of it.  We'll find out
+    // how to serve the range once we hear back from the server.
+    if (!ConditionalizeRequest())
+      return BypassCacheEntry();
+    return BeginNetworkRequest();
+  }
+
+  SetClientResponse();
+  if (range_cached) {
+    cache_->ConvertWriterToReader(entry_);
+    mode_ = READ;
+    return HandleResult(OK);
+  }
+
+  // We stay as the writer of the entry, to store the missing pieces.
+  if (partial_->piece_cached())
+    return HandleResult(OK);
+
+  SetPieceRequest();
+  return BeginNetworkRequest();
+}
+
+int HttpCache::Transaction::BypassCacheEntry() {
+  if (entry_->writer == this) {
+    // The entry was not modified.
+    cache_->DoneWritingToEntry(entry_, true);
+  } else {
+    cache_->DoneReadingFromEntry(entry_, this);
+  }
+  entry_ = NULL;
+  partial_.reset();
+  is_sparse_ = false;
+
+  if (mode_ == READ) {
+    mode_ = NONE;
+    return HandleResult(ERR_CACHE_MISS);
+  }
+  mode_ = NONE;
+  return BeginNetworkRequest();
+}
+
+bool HttpCache::Transaction::HandlePartialResponse(
+    const HttpResponseInfo& new_response) {
+  DCHECK(mode_ & WRITE);
+  int response_code = new_response.headers->response_code();
+
+  if (mode_ == WRITE) {
+    // This is the response to the original range request, for a new entry.
+    // Only a 206 that we can validate later is stored as sparse data; a 200
+    // is stored as usual.
+    if (response_code == 206 &&
+        partial_->ValidatePieceResponse(new_response.headers) &&
+        !PartialData::GetValidator(new_response.headers).empty()) {
+      response_ = new_response;
+      response_.headers = partial_->CreateStoredHeaders(new_response.headers);
+      is_sparse_ = true;
+      WriteResponseInfoToEntry();
+      if (entry_) {
+        SetClientResponse();
+        return true;
+      }
+      is_sparse_ = false;
+    } else if (response_code == 200) {
+      partial_.reset();
+      return false;
+    }
+  } else if (response_code == 304 ||
+             (response_code == 206 &&
+              partial_->ValidatePieceResponse(new_response.headers))) {
+    // Either the stored resource is still valid, or we got the first piece of
+    // the range.
+    if (response_code == 304) {
+      response_.headers->Update(*new_response.headers);
+      WriteResponseInfoToEntry();
+      if (entry_) {
+        final_upload_progress_ = network_trans_->GetUploadProgress();
+        network_trans_.reset();
+        if (!is_sparse_ ||
+            (partial_->piece_cached() && partial_->IsLastPiece())) {
+          cache_->ConvertWriterToReader(entry_);
+          mode_ = READ;
+        }
+      }
+    }
+    if (entry_) {
+      SetClientResponse();
+      return true;
+    }
+  } else if (!is_sparse_) {
+    // The resource changed; store the new response as usual.
+    mode_ = WRITE;
+    partial_.reset();
+    return false;
+  }
+
+  // The resource changed, or we cannot store it.  Give the response to the
+  // user as it is.
+  DoneWritingToEntry(false);
+  partial_.reset();
+  is_sparse_ = false;
+  response_ = new_response;
+  return true;
+}
+
+void HttpCache::Transaction::SetClientResponse() {
+  client_response_ = response_;
+  client_response_.headers = partial_->CreateClientHeaders(response_.headers);
+}
+
+void HttpCache::Transaction::SetPieceRequest() {
+  // The user's own validators don't apply to the pieces; we use ours.
+  custom_request_.reset(new HttpRequestInfo(*request_));
+  custom_request_->extra_headers = partial_->extra_headers();
+  partial_->AddPieceHeaders(PartialData::GetValidator(response_.headers),
+                            &custom_request_->extra_headers);
+  request_ = custom_request_.get();
+}
+
+int HttpCache::Transaction::StartNetworkPiece() {
+  DCHECK(!network_trans_.get());
+
+  SetPieceRequest();
+  network_trans_.reset(cache_->network_layer_->CreateTransaction());
+  if (!network_trans_.get())
+    return ERR_FAILED;
+
+  int rv = network_trans_->Start(request_, &network_info_callback_);
+  if (rv != ERR_IO_PENDING)
+    rv = HandleNetworkPieceStarted(rv);
+  return rv;
+}
+
+int HttpCache::Transaction::HandleNetworkPieceStarted(int result) {
+  if (result != OK) {
+    ReleasePartialEntry(true);
+    return result;
+  }
+
+  const HttpResponseInfo* new_response = network_trans_->GetResponseInfo();
+  if (!partial_->ValidatePieceResponse(new_response->headers)) {
+    // The resource changed while the user was reading it.
+    ReleasePartialEntry(false);
+    return ERR_CACHE_READ_FAILURE;
+  }
+  return ReadPartialPiece();
+}
+
+int HttpCache::Transaction::ReadPartial(char* buf, int buf_len) {
+  partial_started_ = true;
+  read_buf_ = buf;
+  read_buf_len_ = buf_len;
+
+  if (partial_->IsDone()) {
+    ReleasePartialEntry(true);
+    return 0;
+  }
+  if (!entry_)
+    return ERR_CACHE_READ_FAILURE;
+
+  if (partial_->IsPieceDone()) {
+    if (network_trans_.get()) {
+      final_upload_progress_ = network_trans_->GetUploadProgress();
+      network_trans_.reset();
+    }
+    partial_->PrepareNextPiece(entry_->disk_entry, is_sparse_);
+  }
+
+  if (!partial_->piece_cached() && !network_trans_.get()) {
+    if (!(mode_ & WRITE)) {
+      ReleasePartialEntry(false);
+      return ERR_CACHE_READ_FAILURE;
+    }
+    return StartNetworkPiece();
+  }
+  return ReadPartialPiece();
+}
+
+int HttpCache::Transaction::ReadPartialPiece() {
+  int len = partial_->PieceBytesToRead(read_buf_len_);
+  if (!partial_->piece_cached()) {
+    DCHECK(network_trans_.get());
+    int rv = network_trans_->Read(read_buf_, len, &network_read_callback_);
+    if (rv != ERR_IO_PENDING)
+      rv = HandlePartialNetworkReadResult(rv);
+    return rv;
+  }
+
+  cache_read_callback_->AddRef();  // Balanced in OnCacheReadCompleted
+  int rv;
+  if (is_sparse_) {
+    rv = entry_->disk_entry->ReadSparseData(partial_->current_offset(),
+                                            read_buf_, len,
+                                            cache_read_callback_);
+  } else {
+    rv = entry_->disk_entry->ReadData(
+        kResponseContentIndex, static_cast<int>(partial_->current_offset()),
+        read_buf_, len, cache_read_callback_);
+  }
+  if (rv != ERR_IO_PENDING) {
+    cache_read_callback_->Release();
+    rv = HandlePartialCacheReadResult(rv);
+  }
+  return rv;
+}
+
+int HttpCache::Transaction::HandlePartialNetworkReadResult(int result) {
   if (result > 0) {
-    read_offset_ += result;
-  } else if (result == 0) {  // end of file
+    if (entry_ &&
+        entry_->disk_entry->WriteSparseData(partial_->current_offset(),
+                                            read_buf_, result,
+                                            NULL) != result) {
+      // The piece will be fetched again next time.
+      DLOG(ERROR) << "failed to write response data to cache";
+    }
+    partial_->OnDataRead(result);
+  } else {
+    // What we stored so far is still good.
+    ReleasePartialEntry(true);
+    if (result == 0)
+      result = ERR_CONNECTION_CLOSED;  // The piece is not complete.
+  }
+  return result;
+}
+
+int HttpCache::Transaction::HandlePartialCacheReadResult(int result) {
+  if (result > 0) {
+    partial_->OnDataRead(result);
+    return result;
+  }
+  ReleasePartialEntry(false);
+  return ERR_CACHE_READ_FAILURE;
+}
+
+void HttpCache::Transaction::ReleasePartialEntry(bool success) {
+  if (!entry_)
+    return;
+
+  if (mode_ & WRITE) {
+    DoneWritingToEntry(success);
+  } else {
     cache_->DoneReadingFromEntry(entry_, this);
     entry_ = NULL;
   }
-  HandleResult(result);
 }
 
 //-----------------------------------------------------------------------------
@@ -992,6 +1557,22 @@ void HttpCache::Suspend(bool suspend) {
 // static
 bool HttpCache::ReadResponseInfo(disk_cache::Entry* disk_entry,
                                  HttpResponseInfo* response_info) {
+  bool is_sparse;
+  return ReadResponseInfo(disk_entry, response_info, &is_sparse);
+}
+
+// static
+bool HttpCache::WriteResponseInfo(disk_cache::Entry* disk_entry,
+                                  const HttpResponseInfo* response_info,
+                                  bool skip_transient_headers) {
+  return WriteResponseInfo(disk_entry, response_info, skip_transient_headers,
+                           false);
+}
+
+// static
+bool HttpCache::ReadResponseInfo(disk_cache::Entry* disk_entry,
+                                 HttpResponseInfo* response_info,
+                                 bool* is_sparse) {
   int size = disk_entry->GetDataSize(kResponseInfoIndex);
 
   std::string data;
@@ -1015,6 +1596,7 @@ bool HttpCache::ReadResponseInfo(disk_cache::Entry* disk_entry,
     DLOG(ERROR) << "unexpected response info version: " << version;
     return false;
   }
+  *is_sparse = (flags & RESPONSE_INFO_IS_SPARSE) != 0;
 
   // read request-time
   int64 time_val;
@@ -1061,7 +1643,8 @@ bool HttpCache::ReadResponseInfo(disk_cache::Entry* disk_entry,
 // static
 bool HttpCache::WriteResponseInfo(disk_cache::Entry* disk_entry,
                                   const HttpResponseInfo* response_info,
-                                  bool skip_transient_headers) {
+                                  bool skip_transient_headers,
+                                  bool is_sparse) {
   int flags = RESPONSE_INFO_VERSION;
   if (response_info->ssl_info.cert) {
     flags |= RESPONSE_INFO_HAS_CERT;
@@ -1071,6 +1654,8 @@ bool HttpCache::WriteResponseInfo(disk_cache::Entry* disk_entry,
     flags |= RESPONSE_INFO_HAS_SECURITY_BITS;
   if (response_info->vary_data.is_valid())
     flags |= RESPONSE_INFO_HAS_VARY_DATA;
+  if (is_sparse)
+    flags |= RESPONSE_INFO_IS_SPARSE;
 
   Pickle pickle;
   pickle.WriteInt(flags);
@@ -1194,18 +1779,29 @@ int HttpCache::AddTransactionToEntry(ActiveEntry* entry, Transaction* trans) {
 
   // We implement a basic reader/writer lock for the disk cache entry.  If
   // there is already a writer, then everyone has to wait for the writer to
-  // finish before they can access the cache entry.  There can be multiple
+  // start writing the response body before they can access the cache entry.
+  // From then on, they read the body as it is written.  There can be multiple
   // readers.
   //
   // NOTE: If the transaction can only write, then the entry should not be in
   // use (since any existing entry should have already been doomed).
 
-  if (entry->writer || entry->will_process_pending_queue) {
+  if ((entry->writer && !entry->streaming) ||
+      entry->will_process_pending_queue) {
     entry->pending_queue.push_back(trans);
     return ERR_IO_PENDING;
   }
 
-  if (trans->mode() & Transaction::WRITE) {
+  if (entry->writer) {
+    // Only a transaction that would read the stored response as it is can
+    // read it while it is being written.  The others (say, those that have to
+    // validate it) wait for the writer to finish, as usual.
+    if (!trans->CanReadWhileWriting(entry)) {
+      entry->pending_queue.push_back(trans);
+      return ERR_IO_PENDING;
+    }
+    entry->readers.push_back(trans);
+  } else if (trans->mode() & Transaction::WRITE) {
     // transaction needs exclusive access to the entry
     if (entry->readers.empty()) {
       entry->writer = trans;
@@ -1227,11 +1823,35 @@ int HttpCache::AddTransactionToEntry(ActiveEntry* entry, Transaction* trans) {
   return trans->EntryAvailable(entry);
 }
 
+void HttpCache::DidAppendToEntry(ActiveEntry* entry) {
+  DCHECK(entry->writer);
+
+  if (!entry->streaming) {
+    // The writer is committed to the response now, so let the pending
+    // transactions read it.
+    entry->streaming = true;
+    ProcessPendingQueue(entry);
+  }
+  NotifyStreamingReaders(entry);
+}
+
 void HttpCache::DoneWritingToEntry(ActiveEntry* entry, bool success) {
-  DCHECK(entry->readers.empty());
+  DCHECK(entry->readers.empty() || entry->streaming);
+
+  if (!success && !entry->doomed) {
+    // Make sure that nobody else finds this entry.  It is destroyed once the
+    // readers that are streaming it are done with it.
+    DoomEntry(entry->disk_entry->GetKey());
+  }
 
   entry->writer = NULL;
 
+  if (entry->streaming) {
+    entry->streaming = false;
+    entry->truncated = !success;
+    NotifyStreamingReaders(entry);
+  }
+
   if (success) {
     ProcessPendingQueue(entry);
   } else {
@@ -1239,8 +1859,8 @@ void HttpCache::DoneWritingToEntry(ActiveEntry* entry, bool success) {
     TransactionList pending_queue;
     pending_queue.swap(entry->pending_queue);
 
-    entry->disk_entry->Doom();
-    DestroyEntry(entry);
+    if (entry->readers.empty() && !entry->will_process_pending_queue)
+      DestroyEntry(entry);
 
     // We need to do something about these pending entries, which now need to
     // be added to a new entry.
@@ -1251,9 +1871,13 @@ void HttpCache::DoneWritingToEntry(ActiveEntry* entry, bool success) {
   }
 }
 
-void HttpCache::DoneReadingFromEntry(ActiveEntry* entry, Transaction* trans) {
-  DCHECK(!entry->writer);
+void HttpCache::NotifyStreamingReaders(ActiveEntry* entry) {
+  TransactionList::iterator it = entry->readers.begin();
+  for (; it != entry->readers.end(); ++it)
+    (*it)->OnWriterProgress();
+}
 
+void HttpCache::DoneReadingFromEntry(ActiveEntry* entry, Transaction* trans) {
   TransactionList::iterator it =
       std::find(entry->readers.begin(), entry->readers.end(), trans);
   DCHECK(it != entry->readers.end());
@@ -1307,22 +1931,32 @@ void HttpCache::ProcessPendingQueue(ActiveEntry* entry) {
 void HttpCache::OnProcessPendingQueue(ActiveEntry* entry) {
   entry->will_process_pending_queue = false;
 
-  if (entry->writer)
+  if (entry->writer && !entry->streaming)
     return;
 
   // If no one is interested in this entry, then we can de-activate it.
   if (entry->pending_queue.empty()) {
-    if (entry->readers.empty())
+    if (!entry->writer && entry->readers.empty())
       DestroyEntry(entry);
     return;
   }
 
-  // Promote next transaction from the pending queue.
-  Transaction* next = entry->pending_queue.front();
-  if ((next->mode() & Transaction::WRITE) && !entry->readers.empty())
+  // Promote next transaction from the pending queue.  While the entry is being
+  // written, that is the first one that can read it.
+  TransactionList::iterator it = entry->pending_queue.begin();
+  if (entry->writer) {
+    while (it != entry->pending_queue.end() &&
+           !(*it)->CanReadWhileWriting(entry))
+      ++it;
+    if (it == entry->pending_queue.end())
+      return;  // have to wait
+  } else if (((*it)->mode() & Transaction::WRITE) &&
+             !entry->readers.empty()) {
     return;  // have to wait
+  }
 
-  entry->pending_queue.erase(entry->pending_queue.begin());
+  Transaction* next = *it;
+  entry->pending_queue.erase(it);
 
   AddTransactionToEntry(entry, next);
 }
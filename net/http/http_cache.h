@@ -103,6 +103,12 @@ class HttpCache : public HttpTransactionFactory {
 
   typedef std::list<Transaction*> TransactionList;
 
+  // While the writer is appending the response body to the entry (that is,
+  // once it has written the first bytes of the body), transactions that would
+  // read the stored response without validating it may attach to the entry
+  // and read the data that is already there.  They wait for the writer when
+  // they catch up with it, and fetch the rest of the body from the network if
+  // the writer fails.
   struct ActiveEntry {
     disk_cache::Entry* disk_entry;
     Transaction*       writer;
@@ -110,6 +116,8 @@ class HttpCache : public HttpTransactionFactory {
     TransactionList    pending_queue;
     bool               will_process_pending_queue;
     bool               doomed;
+    bool               streaming;  // The writer is appending the body.
+    bool               truncated;  // The writer failed to write the body.
 
     explicit ActiveEntry(disk_cache::Entry*);
     ~ActiveEntry();
@@ -121,6 +129,16 @@ class HttpCache : public HttpTransactionFactory {
 
   // Methods ------------------------------------------------------------------
 
+  // Versions of ReadResponseInfo and WriteResponseInfo that also handle the
+  // flag that tells if the response body is stored as sparse data.
+  static bool ReadResponseInfo(disk_cache::Entry* disk_entry,
+                               HttpResponseInfo* response_info,
+                               bool* is_sparse);
+  static bool WriteResponseInfo(disk_cache::Entry* disk_entry,
+                                const HttpResponseInfo* response_info,
+                                bool skip_transient_headers,
+                                bool is_sparse);
+
   void DoomEntry(const std::string& key);
   void FinalizeDoomedEntry(ActiveEntry* entry);
   ActiveEntry* FindActiveEntry(const std::string& key);
@@ -130,7 +148,9 @@ class HttpCache : public HttpTransactionFactory {
   ActiveEntry* CreateEntry(const std::string& cache_key);
   void DestroyEntry(ActiveEntry* entry);
   int AddTransactionToEntry(ActiveEntry* entry, Transaction* trans);
+  void DidAppendToEntry(ActiveEntry* entry);
   void DoneWritingToEntry(ActiveEntry* entry, bool success);
+  void NotifyStreamingReaders(ActiveEntry* entry);
   void DoneReadingFromEntry(ActiveEntry* entry, Transaction* trans);
   void ConvertWriterToReader(ActiveEntry* entry);
   void RemovePendingTransaction(Transaction* trans);
@@ -0,0 +1,656 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Replays an access log through HttpCache, on top of a network layer that
+// serves the recorded responses, and reports how well the cache does with each
+// storage backend.
+//
+// The log is a text file with one request per line:
+//
+//   <network time in ms> <response size> <url> <header>|<header>|...
+//
+// where the network time is how long the original request took to complete
+// over the network, and the headers are the response headers (the status line
+// is always "HTTP/1.1 200 OK"). Empty lines and lines that start with '#' are
+// ignored. Pass the log with --cache-trace=<file>; without it, a synthetic log
+// (with a fixed seed) is used.
+//
+// It also measures how long concurrent fetches of the same large resource wait
+// for their data while the first one downloads it.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/command_line.h"
+#include "base/compiler_specific.h"
+#include "base/file_util.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "base/scoped_ptr.h"
+#include "base/string_util.h"
+#include "base/task.h"
+#include "base/time.h"
+#include "googleurl/src/gurl.h"
+#include "net/base/load_flags.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/disk_cache/backend_impl.h"
+#include "net/disk_cache/disk_cache.h"
+#include "net/disk_cache/disk_cache_test_util.h"
+#include "net/http/http_cache.h"
+#include "net/http/http_request_info.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_response_info.h"
+#include "net/http/http_transaction.h"
+#include "net/http/http_transaction_factory.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kCacheSize = 10 * 1024 * 1024;
+
+// One request of the log.
+struct TraceRequest {
+  int network_time_ms;
+  int size;
+  std::string url;
+  std::string headers;  // One header per line, terminated by '\n'.
+};
+
+typedef std::vector<TraceRequest> Trace;
+
+bool ParseTrace(const std::string& data, Trace* trace) {
+  std::vector<std::string> lines;
+  SplitString(data, '\n', &lines);
+  for (size_t i = 0; i < lines.size(); i++) {
+    const std::string& line = lines[i];
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::vector<std::string> fields;
+    SplitString(line, ' ', &fields);
+    if (fields.size() < 3)
+      return false;
+
+    TraceRequest request;
+    if (!StringToInt(fields[0], &request.network_time_ms) ||
+        !StringToInt(fields[1], &request.size) || request.size < 0)
+      return false;
+    request.url = fields[2];
+
+    // The headers may contain spaces.
+    std::string headers;
+    for (size_t j = 3; j < fields.size(); j++) {
+      if (j > 3)
+        headers.push_back(' ');
+      headers.append(fields[j]);
+    }
+    std::vector<std::string> header_lines;
+    SplitString(headers, '|', &header_lines);
+    for (size_t j = 0; j < header_lines.size(); j++) {
+      if (!header_lines[j].empty())
+        request.headers.append(header_lines[j] + "\n");
+    }
+    trace->push_back(request);
+  }
+  return !trace->empty();
+}
+
+// Builds a log that looks like regular browsing: most requests go to a set of
+// small resources with a skewed popularity, some go to medium sized ones, and
+// a few download large files that are never requested again.
+void GenerateTrace(Trace* trace) {
+  const int kNumRequests = 20000;
+  const int kNumResources = 3000;
+  srand(7);
+
+  // Popularity follows (roughly) Zipf's law, so we pick the rank of the
+  // resource from the cumulative distribution.
+  std::vector<double> cumulative(kNumResources);
+  double total = 0;
+  for (int i = 0; i < kNumResources; i++) {
+    total += 1.0 / (i + 1);
+    cumulative[i] = total;
+  }
+
+  std::vector<int> sizes(kNumResources);
+  for (int i = 0; i < kNumResources; i++) {
+    if (rand() % 10)
+      sizes[i] = 1024 + rand() % (30 * 1024);
+    else
+      sizes[i] = 30 * 1024 + rand() % (270 * 1024);
+  }
+
+  for (int i = 0; i < kNumRequests; i++) {
+    TraceRequest request;
+    request.headers = "Cache-Control: max-age=1000000\n";
+    if (rand() % 200 == 0) {
+      request.url = StringPrintf("http://media.example.com/%d.flv", i);
+      request.size = 1024 * 1024 + rand() % (4 * 1024 * 1024);
+      request.network_time_ms = 2000 + rand() % 8000;
+    } else {
+      double value = total * rand() / RAND_MAX;
+      int resource = static_cast<int>(
+          std::lower_bound(cumulative.begin(), cumulative.end(), value) -
+          cumulative.begin());
+      resource = std::min(resource, kNumResources - 1);
+      request.url = StringPrintf("http://www.example.com/r/%d", resource);
+      request.size = sizes[resource];
+      request.network_time_ms = 30 + rand() % 300;
+    }
+    trace->push_back(request);
+  }
+}
+
+// A network transaction that serves the request that is being replayed.
+class ReplayNetworkTransaction : public net::HttpTransaction {
+ public:
+  explicit ReplayNetworkTransaction(const TraceRequest* request)
+      : request_(request), data_cursor_(0) {
+  }
+
+  virtual int Start(const net::HttpRequestInfo* request_info,
+                    net::CompletionCallback* callback) {
+    if (!request_ || request_info->url.spec() != GURL(request_->url).spec())
+      return net::ERR_FAILED;
+
+    std::string header_data = "HTTP/1.1 200 OK\n" + request_->headers + "\n";
+    std::replace(header_data.begin(), header_data.end(), '\n', '\0');
+
+    response_.request_time = Time::Now();
+    response_.response_time = Time::Now();
+    response_.headers = new net::HttpResponseHeaders(header_data);
+    return net::OK;
+  }
+
+  virtual int RestartIgnoringLastError(net::CompletionCallback* callback) {
+    return net::ERR_FAILED;
+  }
+
+  virtual int RestartWithAuth(const std::wstring& username,
+                              const std::wstring& password,
+                              net::CompletionCallback* callback) {
+    return net::ERR_FAILED;
+  }
+
+  virtual int Read(char* buf, int buf_len, net::CompletionCallback* callback) {
+    int num = std::min(buf_len, request_->size - data_cursor_);
+    memset(buf, 'a', num);
+    data_cursor_ += num;
+    return num;
+  }
+
+  virtual const net::HttpResponseInfo* GetResponseInfo() const {
+    return &response_;
+  }
+
+  virtual net::LoadState GetLoadState() const {
+    return net::LOAD_STATE_IDLE;
+  }
+
+  virtual uint64 GetUploadProgress() const {
+    return 0;
+  }
+
+ private:
+  const TraceRequest* request_;
+  net::HttpResponseInfo response_;
+  int data_cursor_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReplayNetworkTransaction);
+};
+
+class ReplayNetworkLayer : public net::HttpTransactionFactory {
+ public:
+  ReplayNetworkLayer() : current_request_(NULL), transaction_count_(0) {}
+
+  // Sets the request that is about to be replayed.
+  void set_current_request(const TraceRequest* request) {
+    current_request_ = request;
+  }
+
+  virtual net::HttpTransaction* CreateTransaction() {
+    transaction_count_++;
+    return new ReplayNetworkTransaction(current_request_);
+  }
+
+  virtual net::HttpCache* GetCache() {
+    return NULL;
+  }
+
+  virtual net::AuthCache* GetAuthCache() {
+    return NULL;
+  }
+
+  virtual void Suspend(bool suspend) {}
+
+  int transaction_count() const { return transaction_count_; }
+
+ private:
+  const TraceRequest* current_request_;
+  int transaction_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReplayNetworkLayer);
+};
+
+// Forwards everything to another backend, counting the entries created.
+class CountingBackend : public disk_cache::Backend {
+ public:
+  explicit CountingBackend(disk_cache::Backend* backend)
+      : backend_(backend), num_creates_(0) {}
+
+  virtual int32 GetEntryCount() const {
+    return backend_->GetEntryCount();
+  }
+
+  virtual bool OpenEntry(const std::string& key, disk_cache::Entry** entry) {
+    return backend_->OpenEntry(key, entry);
+  }
+
+  virtual bool CreateEntry(const std::string& key,
+                           disk_cache::Entry** entry) {
+    if (!backend_->CreateEntry(key, entry))
+      return false;
+    num_creates_++;
+    return true;
+  }
+
+  virtual bool DoomEntry(const std::string& key) {
+    return backend_->DoomEntry(key);
+  }
+
+  virtual bool DoomAllEntries() {
+    return backend_->DoomAllEntries();
+  }
+
+  virtual bool DoomEntriesBetween(const Time initial_time,
+                                  const Time end_time) {
+    return backend_->DoomEntriesBetween(initial_time, end_time);
+  }
+
+  virtual bool DoomEntriesSince(const Time initial_time) {
+    return backend_->DoomEntriesSince(initial_time);
+  }
+
+  virtual bool OpenNextEntry(void** iter, disk_cache::Entry** next_entry) {
+    return backend_->OpenNextEntry(iter, next_entry);
+  }
+
+  virtual void EndEnumeration(void** iter) {
+    backend_->EndEnumeration(iter);
+  }
+
+  virtual void GetStats(
+      std::vector<std::pair<std::string, std::string> >* stats) {
+    backend_->GetStats(stats);
+  }
+
+  int num_creates() const { return num_creates_; }
+
+ private:
+  scoped_ptr<disk_cache::Backend> backend_;
+  int num_creates_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingBackend);
+};
+
+// Returns the given percentile of a sorted set of samples.
+double Percentile(const std::vector<double>& sorted, int percentile) {
+  if (sorted.empty())
+    return 0;
+  size_t index = sorted.size() * percentile / 100;
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Replays |trace| through an HttpCache that stores its data on |backend|
+// (which is owned by the cache), and logs the results with |name| as prefix.
+void ReplayTrace(const char* name, const Trace& trace,
+                 disk_cache::Backend* backend) {
+  ReplayNetworkLayer* network_layer = new ReplayNetworkLayer;
+  CountingBackend* counting_backend = new CountingBackend(backend);
+  net::HttpCache cache(network_layer, counting_backend);
+
+  int hits = 0;
+  int64 bytes = 0;
+  int64 bytes_from_cache = 0;
+  int failures = 0;
+  std::vector<double> latencies;
+  std::vector<double> modeled_latencies;
+  scoped_array<char> buffer(new char[32 * 1024]);
+
+  PerfTimeLogger timer(StringPrintf("%s_replay", name).c_str());
+  for (size_t i = 0; i < trace.size(); i++) {
+    const TraceRequest& request = trace[i];
+    network_layer->set_current_request(&request);
+    int network_transactions = network_layer->transaction_count();
+
+    net::HttpRequestInfo request_info;
+    request_info.url = GURL(request.url);
+    request_info.method = "GET";
+    request_info.load_flags = net::LOAD_NORMAL;
+
+    PerfTimer latency;
+    scoped_ptr<net::HttpTransaction> transaction(cache.CreateTransaction());
+    TestCompletionCallback callback;
+    int rv = transaction->Start(&request_info, &callback);
+    if (rv == net::ERR_IO_PENDING)
+      rv = callback.WaitForResult();
+
+    int received = 0;
+    while (rv == net::OK || rv > 0) {
+      rv = transaction->Read(buffer.get(), 32 * 1024, &callback);
+      if (rv == net::ERR_IO_PENDING)
+        rv = callback.WaitForResult();
+      if (rv > 0)
+        received += rv;
+      if (!rv)
+        break;
+    }
+    transaction.reset();
+    double elapsed = latency.Elapsed().InMillisecondsF();
+
+    if (rv < 0 || received != request.size) {
+      failures++;
+      continue;
+    }
+
+    latencies.push_back(elapsed);
+    bytes += received;
+    if (network_layer->transaction_count() == network_transactions) {
+      hits++;
+      bytes_from_cache += received;
+      modeled_latencies.push_back(elapsed);
+    } else {
+      modeled_latencies.push_back(elapsed + request.network_time_ms);
+    }
+  }
+  timer.Done();
+
+  std::sort(latencies.begin(), latencies.end());
+  std::sort(modeled_latencies.begin(), modeled_latencies.end());
+
+  // Every entry that was created and is not there anymore was evicted (or
+  // replaced by a newer version of the resource).
+  int evicted = counting_backend->num_creates() -
+                counting_backend->GetEntryCount();
+
+  std::string prefix(name);
+  LogPerfResult((prefix + "_hit_ratio").c_str(),
+                trace.size() ? 100.0 * hits / trace.size() : 0, "%");
+  LogPerfResult((prefix + "_byte_hit_ratio").c_str(),
+                bytes ? 100.0 * bytes_from_cache / bytes : 0, "%");
+  LogPerfResult((prefix + "_bytes_from_cache").c_str(),
+                static_cast<double>(bytes_from_cache), "bytes");
+  LogPerfResult((prefix + "_latency_p50").c_str(),
+                Percentile(latencies, 50), "ms");
+  LogPerfResult((prefix + "_latency_p99").c_str(),
+                Percentile(latencies, 99), "ms");
+  LogPerfResult((prefix + "_modeled_latency_p50").c_str(),
+                Percentile(modeled_latencies, 50), "ms");
+  LogPerfResult((prefix + "_modeled_latency_p99").c_str(),
+                Percentile(modeled_latencies, 99), "ms");
+  LogPerfResult((prefix + "_evicted_entries").c_str(), evicted, "entries");
+  LogPerfResult((prefix + "_eviction_churn").c_str(),
+                counting_backend->num_creates() ?
+                    100.0 * evicted / counting_backend->num_creates() : 0,
+                "%");
+  LogPerfResult((prefix + "_failures").c_str(), failures, "requests");
+}
+
+// A network transaction that downloads a large response over a slow link: it
+// delivers a chunk of the body every kChunkDelayMs.
+class SlowNetworkTransaction : public net::HttpTransaction {
+ public:
+  enum {
+    kBodySize = 1024 * 1024,
+    kChunkSize = 16 * 1024,
+    kChunkDelayMs = 5
+  };
+
+  SlowNetworkTransaction()
+      : ALLOW_THIS_IN_INITIALIZER_LIST(task_factory_(this)),
+        data_cursor_(0) {
+  }
+
+  virtual int Start(const net::HttpRequestInfo* request_info,
+                    net::CompletionCallback* callback) {
+    std::string header_data = StringPrintf(
+        "HTTP/1.1 200 OK\nCache-Control: max-age=1000000\n"
+        "Content-Length: %d\n\n", kBodySize);
+    std::replace(header_data.begin(), header_data.end(), '\n', '\0');
+
+    response_.request_time = Time::Now();
+    response_.response_time = Time::Now();
+    response_.headers = new net::HttpResponseHeaders(header_data);
+    return net::OK;
+  }
+
+  virtual int RestartIgnoringLastError(net::CompletionCallback* callback) {
+    return net::ERR_FAILED;
+  }
+
+  virtual int RestartWithAuth(const std::wstring& username,
+                              const std::wstring& password,
+                              net::CompletionCallback* callback) {
+    return net::ERR_FAILED;
+  }
+
+  virtual int Read(char* buf, int buf_len, net::CompletionCallback* callback) {
+    int num = std::min(std::min(buf_len, static_cast<int>(kChunkSize)),
+                       kBodySize - data_cursor_);
+    if (!num)
+      return 0;
+    memset(buf, 'a', num);
+    data_cursor_ += num;
+    MessageLoop::current()->PostDelayedTask(FROM_HERE,
+        task_factory_.NewRunnableMethod(&SlowNetworkTransaction::RunCallback,
+                                        callback, num),
+        kChunkDelayMs);
+    return net::ERR_IO_PENDING;
+  }
+
+  virtual const net::HttpResponseInfo* GetResponseInfo() const {
+    return &response_;
+  }
+
+  virtual net::LoadState GetLoadState() const {
+    return net::LOAD_STATE_READING_RESPONSE;
+  }
+
+  virtual uint64 GetUploadProgress() const {
+    return 0;
+  }
+
+ private:
+  void RunCallback(net::CompletionCallback* callback, int result) {
+    callback->Run(result);
+  }
+
+  ScopedRunnableMethodFactory<SlowNetworkTransaction> task_factory_;
+  net::HttpResponseInfo response_;
+  int data_cursor_;
+
+  DISALLOW_COPY_AND_ASSIGN(SlowNetworkTransaction);
+};
+
+class SlowNetworkLayer : public net::HttpTransactionFactory {
+ public:
+  SlowNetworkLayer() : transaction_count_(0) {}
+
+  virtual net::HttpTransaction* CreateTransaction() {
+    transaction_count_++;
+    return new SlowNetworkTransaction();
+  }
+
+  virtual net::HttpCache* GetCache() {
+    return NULL;
+  }
+
+  virtual net::AuthCache* GetAuthCache() {
+    return NULL;
+  }
+
+  virtual void Suspend(bool suspend) {}
+
+  int transaction_count() const { return transaction_count_; }
+
+ private:
+  int transaction_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(SlowNetworkLayer);
+};
+
+// Reads a transaction to the end, recording when the first and the last bytes
+// of the body arrive.  Quits the message loop when the last of the fetches
+// that share |pending_fetches| is done.
+class FetchConsumer : public CallbackRunner< Tuple1<int> > {
+ public:
+  FetchConsumer(net::HttpTransactionFactory* factory, int* pending_fetches)
+      : trans_(factory->CreateTransaction()),
+        pending_fetches_(pending_fetches),
+        reading_(false),
+        received_(0),
+        error_(net::OK) {
+  }
+
+  void Start(const net::HttpRequestInfo* request) {
+    start_time_ = TimeTicks::Now();
+    int rv = trans_->Start(request, this);
+    if (rv != net::ERR_IO_PENDING)
+      RunWithParams(Tuple1<int>(rv));
+  }
+
+  int received() const { return received_; }
+  int error() const { return error_; }
+  double first_byte_ms() const {
+    return (first_byte_time_ - start_time_).InMillisecondsF();
+  }
+  double done_ms() const {
+    return (done_time_ - start_time_).InMillisecondsF();
+  }
+
+ private:
+  virtual void RunWithParams(const Tuple1<int>& params) {
+    int rv = params.a;
+    for (;;) {
+      if (reading_ && rv > 0) {
+        if (!received_)
+          first_byte_time_ = TimeTicks::Now();
+        received_ += rv;
+      } else if (rv != net::OK || reading_) {
+        break;
+      }
+      reading_ = true;
+      rv = trans_->Read(buf_, sizeof(buf_), this);
+      if (rv == net::ERR_IO_PENDING)
+        return;
+    }
+
+    error_ = rv;
+    done_time_ = TimeTicks::Now();
+    trans_.reset();
+    if (--(*pending_fetches_) == 0)
+      MessageLoop::current()->Quit();
+  }
+
+  scoped_ptr<net::HttpTransaction> trans_;
+  int* pending_fetches_;
+  bool reading_;
+  int received_;
+  int error_;
+  TimeTicks start_time_;
+  TimeTicks first_byte_time_;
+  TimeTicks done_time_;
+  char buf_[32 * 1024];
+
+  DISALLOW_COPY_AND_ASSIGN(FetchConsumer);
+};
+
+}  // namespace
+
+TEST(HttpCacheTest, TraceReplayPerformance) {
+  MessageLoopForIO message_loop;
+
+  Trace trace;
+  std::wstring trace_file =
+      CommandLine().GetSwitchValue(L"cache-trace");
+  if (trace_file.empty()) {
+    GenerateTrace(&trace);
+  } else {
+    std::string data;
+    ASSERT_TRUE(file_util::ReadFileToString(trace_file, &data));
+    ASSERT_TRUE(ParseTrace(data, &trace));
+  }
+
+  std::wstring path = GetCachePath();
+  ASSERT_TRUE(DeleteCache(path.c_str()));
+  disk_cache::Backend* disk_cache =
+      disk_cache::CreateCacheBackend(path, false, kCacheSize);
+  ASSERT_TRUE(NULL != disk_cache);
+  ReplayTrace("http_cache_disk", trace, disk_cache);
+  MessageLoop::current()->RunAllPending();
+
+  // Same thing, using the segmented eviction policy.
+  ASSERT_TRUE(DeleteCache(path.c_str()));
+  disk_cache::BackendImpl* segmented_cache = new disk_cache::BackendImpl(path);
+  ASSERT_TRUE(segmented_cache->SetMaxSize(kCacheSize));
+  segmented_cache->SetEvictionPolicy(disk_cache::SEGMENTED_EVICTION);
+  ASSERT_TRUE(segmented_cache->Init());
+  ReplayTrace("http_cache_disk_segmented", trace, segmented_cache);
+  MessageLoop::current()->RunAllPending();
+
+  disk_cache::Backend* memory_cache =
+      disk_cache::CreateInMemoryCacheBackend(kCacheSize);
+  ASSERT_TRUE(NULL != memory_cache);
+  ReplayTrace("http_cache_memory", trace, memory_cache);
+}
+
+// Several tabs load the same large resource at the same time.  The first fetch
+// goes to the network, and the others read the response from the cache as it
+// arrives.
+TEST(HttpCacheTest, ConcurrentFetchPerformance) {
+  MessageLoopForIO message_loop;
+
+  SlowNetworkLayer* network_layer = new SlowNetworkLayer;
+  net::HttpCache cache(network_layer,
+                       disk_cache::CreateInMemoryCacheBackend(kCacheSize));
+
+  net::HttpRequestInfo request_info;
+  request_info.url = GURL("http://www.example.com/large.flv");
+  request_info.method = "GET";
+  request_info.load_flags = net::LOAD_NORMAL;
+
+  const int kNumFetches = 8;
+  int pending_fetches = kNumFetches;
+  std::vector<FetchConsumer*> fetches;
+  PerfTimeLogger timer("http_cache_concurrent_fetch");
+  for (int i = 0; i < kNumFetches; i++) {
+    fetches.push_back(new FetchConsumer(&cache, &pending_fetches));
+    fetches.back()->Start(&request_info);
+  }
+  MessageLoop::current()->Run();
+  timer.Done();
+
+  std::vector<double> first_byte;
+  std::vector<double> done;
+  for (int i = 0; i < kNumFetches; i++) {
+    EXPECT_EQ(net::OK, fetches[i]->error());
+    EXPECT_EQ(SlowNetworkTransaction::kBodySize, fetches[i]->received());
+    first_byte.push_back(fetches[i]->first_byte_ms());
+    done.push_back(fetches[i]->done_ms());
+    delete fetches[i];
+  }
+  std::sort(first_byte.begin(), first_byte.end());
+  std::sort(done.begin(), done.end());
+
+  LogPerfResult("http_cache_concurrent_first_byte_p50",
+                Percentile(first_byte, 50), "ms");
+  LogPerfResult("http_cache_concurrent_first_byte_max",
+                first_byte.back(), "ms");
+  LogPerfResult("http_cache_concurrent_done_max", done.back(), "ms");
+  LogPerfResult("http_cache_concurrent_network_transactions",
+                network_layer->transaction_count(), "transactions");
+}
@@ -59,7 +59,7 @@ class MockDiskEntry : public disk_cache::Entry,
   }
 
   virtual int32 GetDataSize(int index) const {
-    DCHECK(index >= 0 && index < 2);
+    DCHECK(index >= 0 && index < 3);
     return static_cast<int32>(data_[index].size());
   }
 
@@ -96,6 +96,58 @@ class MockDiskEntry : public disk_cache::Entry,
     return buf_len;
   }
 
+  // The sparse data is kept on data_[2], and sparse_present_ tells which of
+  // its bytes were written.
+  virtual int ReadSparseData(int64 offset, char* buf, int buf_len,
+                             net::CompletionCallback* callback) {
+    if (offset < 0)
+      return net::ERR_FAILED;
+
+    int num = 0;
+    while (num < buf_len && IsSparseBytePresent(offset + num)) {
+      buf[num] = data_[2][static_cast<size_t>(offset + num)];
+      num++;
+    }
+
+    if (!callback || (test_mode_ & TEST_MODE_SYNC_CACHE_READ))
+      return num;
+
+    CallbackLater(callback, num);
+    return net::ERR_IO_PENDING;
+  }
+
+  virtual int WriteSparseData(int64 offset, const char* buf, int buf_len,
+                              net::CompletionCallback* callback) {
+    if (offset < 0 || buf_len < 0)
+      return net::ERR_FAILED;
+
+    size_t end = static_cast<size_t>(offset + buf_len);
+    if (end > data_[2].size()) {
+      data_[2].resize(end);
+      sparse_present_.resize(end);
+    }
+    for (int i = 0; i < buf_len; i++) {
+      data_[2][static_cast<size_t>(offset + i)] = buf[i];
+      sparse_present_[static_cast<size_t>(offset + i)] = true;
+    }
+    return buf_len;
+  }
+
+  virtual int GetAvailableRange(int64 offset, int len, int64* start) {
+    if (offset < 0 || len < 0)
+      return net::ERR_FAILED;
+
+    int64 end = offset + len;
+    while (offset < end && !IsSparseBytePresent(offset))
+      offset++;
+    *start = offset;
+
+    int num = 0;
+    while (offset + num < end && IsSparseBytePresent(offset + num))
+      num++;
+    return num;
+  }
+
  private:
   // Unlike the callbacks for MockHttpTransaction, we want this one to run even
   // if the consumer called Close on the MockDiskEntry.  We achieve that by
@@ -108,8 +160,14 @@ class MockDiskEntry : public disk_cache::Entry,
     callback->Run(result);
   }
 
+  bool IsSparseBytePresent(int64 offset) const {
+    return offset < static_cast<int64>(sparse_present_.size()) &&
+           sparse_present_[static_cast<size_t>(offset)];
+  }
+
   std::string key_;
-  std::vector<char> data_[2];
+  std::vector<char> data_[3];
+  std::vector<bool> sparse_present_;
   int test_mode_;
   bool doomed_;
 };
@@ -252,8 +310,9 @@ void ReadAndVerifyTransaction(net::HttpTransaction* trans,
   EXPECT_EQ(0, memcmp(trans_info.data, content.data(), content.size()));
 }
 
-void RunTransactionTest(net::HttpCache* cache,
-                        const MockTransaction& trans_info) {
+void RunTransactionTestWithResponse(net::HttpCache* cache,
+                                    const MockTransaction& trans_info,
+                                    std::string* response_headers) {
   MockHttpRequest request(trans_info);
   TestCompletionCallback callback;
 
@@ -270,9 +329,81 @@ void RunTransactionTest(net::HttpCache* cache,
   const net::HttpResponseInfo* response = trans->GetResponseInfo();
   ASSERT_TRUE(response);
 
+  if (response_headers)
+    response->headers->GetNormalizedHeaders(response_headers);
+
   ReadAndVerifyTransaction(trans.get(), trans_info);
 }
 
+void RunTransactionTest(net::HttpCache* cache,
+                        const MockTransaction& trans_info) {
+  RunTransactionTestWithResponse(cache, trans_info, NULL);
+}
+
+// This server serves the 80 bytes of kRangeData, honoring a single "bytes="
+// range in the request.  A request with If-Range or If-None-Match gets the
+// whole resource or a 304, depending on g_range_resource_modified.
+const char kRangeData[] =
+    "rg: 00-09 rg: 10-19 rg: 20-29 rg: 30-39 "
+    "rg: 40-49 rg: 50-59 rg: 60-69 rg: 70-79 ";
+bool g_range_resource_modified = false;
+
+void RangeTransactionServer_Handler(const net::HttpRequestInfo* request,
+                                    std::string* response_status,
+                                    std::string* response_headers,
+                                    std::string* response_data) {
+  const std::string& headers = request->extra_headers;
+  response_headers->assign("Cache-Control: max-age=10000\n"
+                           "ETag: \"foo\"\n");
+
+  bool has_validator = headers.find("If-Range:") != std::string::npos ||
+                       headers.find("If-None-Match:") != std::string::npos;
+  if (has_validator && !g_range_resource_modified &&
+      headers.find("If-None-Match:") != std::string::npos) {
+    response_status->assign("HTTP/1.1 304 Not Modified");
+    response_data->clear();
+    return;
+  }
+
+  size_t pos = headers.find("Range: bytes=");
+  if (pos == std::string::npos || (has_validator &&
+                                   g_range_resource_modified)) {
+    response_status->assign("HTTP/1.1 200 OK");
+    response_data->assign(kRangeData);
+    return;
+  }
+
+  pos += strlen("Range: bytes=");
+  std::string range = headers.substr(pos, headers.find("\r\n", pos) - pos);
+  range = range.substr(0, range.find(','));
+  size_t dash = range.find('-');
+  int64 first = 0, last = 79;
+  EXPECT_TRUE(StringToInt64(range.substr(0, dash), &first));
+  if (dash + 1 < range.size())
+    EXPECT_TRUE(StringToInt64(range.substr(dash + 1), &last));
+  last = std::min(last, static_cast<int64>(79));
+
+  response_status->assign("HTTP/1.1 206 Partial Content");
+  response_headers->append(StringPrintf("Content-Range: bytes %d-%d/80\n",
+                                        static_cast<int>(first),
+                                        static_cast<int>(last)));
+  response_data->assign(kRangeData + first,
+                        static_cast<size_t>(last - first + 1));
+}
+
+const MockTransaction kRangeGET_TransactionOK = {
+  "http://www.google.com/range",
+  "GET",
+  "Range: bytes=40-49\r\n",
+  net::LOAD_NORMAL,
+  "HTTP/1.1 206 Partial Content",
+  "",
+  "rg: 40-49 ",
+  TEST_MODE_NORMAL,
+  &RangeTransactionServer_Handler,
+  0
+};
+
 }  // namespace
 
 
@@ -584,6 +715,210 @@ TEST(HttpCache, SimpleGET_ManyWriters_CancelFirst) {
   }
 }
 
+TEST(HttpCache, SimpleGET_StreamingReaders) {
+  MockHttpCache cache;
+
+  ScopedMockTransaction transaction(kSimpleGET_Transaction);
+  transaction.data = "0123456789abcdefghij";
+  MockHttpRequest request(transaction);
+
+  Context writer(cache.http_cache()->CreateTransaction());
+  int rv = writer.trans->Start(&request, &writer.callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = writer.callback.WaitForResult();
+  ASSERT_EQ(net::OK, rv);
+
+  // The readers have to wait until the writer starts writing the body.
+  const int kNumReaders = 3;
+  std::vector<Context*> readers;
+  for (int i = 0; i < kNumReaders; ++i) {
+    readers.push_back(new Context(cache.http_cache()->CreateTransaction()));
+    EXPECT_EQ(net::ERR_IO_PENDING,
+              readers[i]->trans->Start(&request, &readers[i]->callback));
+  }
+
+  char buf[32];
+  rv = writer.trans->Read(buf, 10, &writer.callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = writer.callback.WaitForResult();
+  EXPECT_EQ(10, rv);
+
+  // Now the readers get what has been written so far, and then wait for the
+  // writer.
+  char reader_bufs[kNumReaders][32];
+  for (int i = 0; i < kNumReaders; ++i) {
+    Context* c = readers[i];
+    EXPECT_EQ(net::OK, c->callback.WaitForResult());
+
+    rv = c->trans->Read(reader_bufs[i], sizeof(reader_bufs[i]), &c->callback);
+    if (rv == net::ERR_IO_PENDING)
+      rv = c->callback.WaitForResult();
+    EXPECT_EQ(10, rv);
+    EXPECT_EQ("0123456789", std::string(reader_bufs[i], rv));
+
+    rv = c->trans->Read(reader_bufs[i], sizeof(reader_bufs[i]), &c->callback);
+    EXPECT_EQ(net::ERR_IO_PENDING, rv);
+  }
+  MessageLoop::current()->RunAllPending();
+  for (int i = 0; i < kNumReaders; ++i) {
+    EXPECT_EQ(net::LOAD_STATE_WAITING_FOR_CACHE,
+              readers[i]->trans->GetLoadState());
+  }
+
+  // The rest of the body wakes them up.
+  rv = writer.trans->Read(buf, sizeof(buf), &writer.callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = writer.callback.WaitForResult();
+  EXPECT_EQ(10, rv);
+
+  for (int i = 0; i < kNumReaders; ++i) {
+    Context* c = readers[i];
+    rv = c->callback.WaitForResult();
+    EXPECT_EQ(10, rv);
+    EXPECT_EQ("abcdefghij", std::string(reader_bufs[i], rv));
+  }
+
+  // Let the writer see the end of the body, and the readers after it.
+  rv = writer.trans->Read(buf, sizeof(buf), &writer.callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = writer.callback.WaitForResult();
+  EXPECT_EQ(0, rv);
+  for (int i = 0; i < kNumReaders; ++i) {
+    Context* c = readers[i];
+    rv = c->trans->Read(reader_bufs[i], sizeof(reader_bufs[i]), &c->callback);
+    if (rv == net::ERR_IO_PENDING)
+      rv = c->callback.WaitForResult();
+    EXPECT_EQ(0, rv);
+    delete c;
+  }
+
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0, cache.disk_cache()->open_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
+// This server serves kStreamingData, honoring a "bytes=N-" range if the
+// request has an If-Range that matches its ETag.
+const char kStreamingData[] = "0123456789abcdefghij";
+
+static void StreamingServer_Handler(const net::HttpRequestInfo* request,
+                                    std::string* response_status,
+                                    std::string* response_headers,
+                                    std::string* response_data) {
+  const std::string& headers = request->extra_headers;
+  response_headers->assign("Cache-Control: max-age=10000\n"
+                           "ETag: \"bar\"\n");
+
+  size_t pos = headers.find("Range: bytes=");
+  if (pos == std::string::npos ||
+      headers.find("If-Range: \"bar\"") == std::string::npos) {
+    response_status->assign("HTTP/1.1 200 OK");
+    response_data->assign(kStreamingData);
+    return;
+  }
+
+  pos += strlen("Range: bytes=");
+  int first = 0;
+  EXPECT_TRUE(StringToInt(headers.substr(pos, headers.find('-', pos) - pos),
+                          &first));
+  int last = static_cast<int>(strlen(kStreamingData)) - 1;
+  response_status->assign("HTTP/1.1 206 Partial Content");
+  response_headers->append(StringPrintf("Content-Range: bytes %d-%d/%d\n",
+                                        first, last, last + 1));
+  response_data->assign(kStreamingData + first);
+}
+
+TEST(HttpCache, SimpleGET_StreamingReaders_WriterFails) {
+  MockHttpCache cache;
+
+  ScopedMockTransaction transaction(kSimpleGET_Transaction);
+  transaction.data = kStreamingData;
+  transaction.handler = StreamingServer_Handler;
+  MockHttpRequest request(transaction);
+
+  Context* writer = new Context(cache.http_cache()->CreateTransaction());
+  int rv = writer->trans->Start(&request, &writer->callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = writer->callback.WaitForResult();
+  ASSERT_EQ(net::OK, rv);
+
+  Context reader(cache.http_cache()->CreateTransaction());
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            reader.trans->Start(&request, &reader.callback));
+
+  char buf[32];
+  rv = writer->trans->Read(buf, 10, &writer->callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = writer->callback.WaitForResult();
+  EXPECT_EQ(10, rv);
+  EXPECT_EQ(net::OK, reader.callback.WaitForResult());
+
+  rv = reader.trans->Read(buf, sizeof(buf), &reader.callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = reader.callback.WaitForResult();
+  EXPECT_EQ(10, rv);
+  rv = reader.trans->Read(buf, sizeof(buf), &reader.callback);
+  EXPECT_EQ(net::ERR_IO_PENDING, rv);
+
+  // Cancelling the writer makes the reader fetch the rest of the body.
+  delete writer;
+  rv = reader.callback.WaitForResult();
+  EXPECT_EQ(10, rv);
+  EXPECT_EQ("abcdefghij", std::string(buf, rv));
+  rv = reader.trans->Read(buf, sizeof(buf), &reader.callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = reader.callback.WaitForResult();
+  EXPECT_EQ(0, rv);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+
+  // The partial entry is not reused.
+  RunTransactionTest(cache.http_cache(), transaction);
+  EXPECT_EQ(3, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0, cache.disk_cache()->open_count());
+  EXPECT_EQ(2, cache.disk_cache()->create_count());
+}
+
+TEST(HttpCache, SimpleGET_StreamingReaders_Validation) {
+  MockHttpCache cache;
+
+  ScopedMockTransaction transaction(kSimpleGET_Transaction);
+  transaction.data = kStreamingData;
+  MockHttpRequest request(transaction);
+
+  Context writer(cache.http_cache()->CreateTransaction());
+  int rv = writer.trans->Start(&request, &writer.callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = writer.callback.WaitForResult();
+  ASSERT_EQ(net::OK, rv);
+
+  // This transaction has to validate the response, so it can't read it while
+  // it is being written.
+  MockHttpRequest validating_request(transaction);
+  validating_request.extra_headers = "cache-control: max-age=0\r\n";
+  Context validator(cache.http_cache()->CreateTransaction());
+  EXPECT_EQ(net::ERR_IO_PENDING,
+            validator.trans->Start(&validating_request, &validator.callback));
+
+  char buf[32];
+  rv = writer.trans->Read(buf, 10, &writer.callback);
+  if (rv == net::ERR_IO_PENDING)
+    rv = writer.callback.WaitForResult();
+  EXPECT_EQ(10, rv);
+  MessageLoop::current()->RunAllPending();
+  EXPECT_FALSE(validator.callback.have_result());
+
+  // Once the writer is done, it validates the response.
+  std::string content;
+  EXPECT_EQ(net::OK, ReadTransaction(writer.trans.get(), &content));
+  EXPECT_EQ("abcdefghij", content);
+  EXPECT_EQ(net::OK, validator.callback.WaitForResult());
+  ReadAndVerifyTransaction(validator.trans.get(), transaction);
+
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0, cache.disk_cache()->open_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
 TEST(HttpCache, SimpleGET_AbandonedCacheRead) {
   MockHttpCache cache;
 
@@ -738,6 +1073,160 @@ TEST(HttpCache, RangeGET_SkipsCache) {
   EXPECT_EQ(0, cache.disk_cache()->create_count());
 }
 
+TEST(HttpCache, RangeGET_OK) {
+  MockHttpCache cache;
+  ScopedMockTransaction transaction(kRangeGET_TransactionOK);
+  std::string headers;
+
+  // Write to the cache (40-49).
+  RunTransactionTestWithResponse(cache.http_cache(), transaction, &headers);
+  EXPECT_TRUE(StartsWithASCII(headers, "HTTP/1.1 206", true));
+  EXPECT_NE(std::string::npos, headers.find("bytes 40-49/80"));
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+
+  // Read from the cache (40-49).
+  RunTransactionTestWithResponse(cache.http_cache(), transaction, &headers);
+  EXPECT_TRUE(StartsWithASCII(headers, "HTTP/1.1 206", true));
+  EXPECT_NE(std::string::npos, headers.find("bytes 40-49/80"));
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+
+  // Make sure we only fetch what is missing (30-39 and 50-59).
+  transaction.request_headers = "Range: bytes=30-59\r\n";
+  transaction.data = "rg: 30-39 rg: 40-49 rg: 50-59 ";
+  RunTransactionTestWithResponse(cache.http_cache(), transaction, &headers);
+  EXPECT_NE(std::string::npos, headers.find("bytes 30-59/80"));
+  EXPECT_NE(std::string::npos, headers.find("Content-Length: 30"));
+  EXPECT_EQ(3, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+
+  // An open ended range that is already stored.
+  transaction.request_headers = "Range: bytes=30-\r\n";
+  transaction.data = "rg: 30-39 rg: 40-49 rg: 50-59 rg: 60-69 rg: 70-79 ";
+  RunTransactionTestWithResponse(cache.http_cache(), transaction, &headers);
+  EXPECT_NE(std::string::npos, headers.find("bytes 30-79/80"));
+  EXPECT_EQ(4, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
+TEST(HttpCache, RangeGET_SyncOK) {
+  MockHttpCache cache;
+  ScopedMockTransaction transaction(kRangeGET_TransactionOK);
+  transaction.test_mode = TEST_MODE_SYNC_NET_START | TEST_MODE_SYNC_NET_READ |
+                          TEST_MODE_SYNC_CACHE_START |
+                          TEST_MODE_SYNC_CACHE_READ;
+
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  transaction.request_headers = "Range: bytes=20-59\r\n";
+  transaction.data = "rg: 20-29 rg: 30-39 rg: 40-49 rg: 50-59 ";
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  EXPECT_EQ(3, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
+TEST(HttpCache, RangeGET_Validation304) {
+  MockHttpCache cache;
+  ScopedMockTransaction transaction(kRangeGET_TransactionOK);
+
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  // The stored range is validated with the server before using it.
+  transaction.load_flags = net::LOAD_VALIDATE_CACHE;
+  std::string headers;
+  RunTransactionTestWithResponse(cache.http_cache(), transaction, &headers);
+  EXPECT_NE(std::string::npos, headers.find("bytes 40-49/80"));
+
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
+TEST(HttpCache, RangeGET_ModifiedResource) {
+  MockHttpCache cache;
+  ScopedMockTransaction transaction(kRangeGET_TransactionOK);
+
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  // The server replies to the If-Range of the missing piece with the whole
+  // resource, which goes to the user as it is.
+  g_range_resource_modified = true;
+  transaction.request_headers = "Range: bytes=30-49\r\n";
+  transaction.data = kRangeData;
+  std::string headers;
+  RunTransactionTestWithResponse(cache.http_cache(), transaction, &headers);
+  g_range_resource_modified = false;
+  EXPECT_TRUE(StartsWithASCII(headers, "HTTP/1.1 200", true));
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+
+  // The old entry was discarded.
+  transaction.request_headers = kRangeGET_TransactionOK.request_headers;
+  transaction.data = kRangeGET_TransactionOK.data;
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  EXPECT_EQ(3, cache.network_layer()->transaction_count());
+  EXPECT_EQ(2, cache.disk_cache()->create_count());
+}
+
+TEST(HttpCache, GET_OverSparseEntry) {
+  MockHttpCache cache;
+  ScopedMockTransaction transaction(kRangeGET_TransactionOK);
+
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  // A request for the whole resource fetches the pieces around 40-49.
+  transaction.request_headers = "";
+  transaction.data = kRangeData;
+  std::string headers;
+  RunTransactionTestWithResponse(cache.http_cache(), transaction, &headers);
+  EXPECT_TRUE(StartsWithASCII(headers, "HTTP/1.1 200", true));
+  EXPECT_NE(std::string::npos, headers.find("Content-Length: 80"));
+  EXPECT_EQ(3, cache.network_layer()->transaction_count());
+
+  // Now everything is stored.
+  RunTransactionTest(cache.http_cache(), transaction);
+  EXPECT_EQ(3, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
+TEST(HttpCache, RangeGET_OverFullEntry) {
+  MockHttpCache cache;
+  ScopedMockTransaction transaction(kRangeGET_TransactionOK);
+
+  // Store the whole resource.
+  transaction.request_headers = "";
+  transaction.status = "HTTP/1.1 200 OK";
+  transaction.data = kRangeData;
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  // The range is served from the stored body.
+  transaction.request_headers = "Range: bytes=20-29\r\n";
+  transaction.data = "rg: 20-29 ";
+  std::string headers;
+  RunTransactionTestWithResponse(cache.http_cache(), transaction, &headers);
+  EXPECT_TRUE(StartsWithASCII(headers, "HTTP/1.1 206", true));
+  EXPECT_NE(std::string::npos, headers.find("bytes 20-29/80"));
+
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, cache.disk_cache()->open_count());
+  EXPECT_EQ(1, cache.disk_cache()->create_count());
+}
+
+TEST(HttpCache, RangeGET_MultipleRanges_SkipsCache) {
+  MockHttpCache cache;
+  ScopedMockTransaction transaction(kRangeGET_TransactionOK);
+
+  // We don't serve several ranges, so the request goes to the server (which
+  // only honors the first one here).
+  transaction.request_headers = "Range: bytes=40-49, 60-69\r\n";
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+  EXPECT_EQ(0, cache.disk_cache()->open_count());
+  EXPECT_EQ(0, cache.disk_cache()->create_count());
+}
+
 TEST(HttpCache, SyncRead) {
   MockHttpCache cache;
 
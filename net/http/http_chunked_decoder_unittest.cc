@@ -57,6 +57,18 @@ TEST(HttpChunkedDecoderTest, Basic) {
   RunTest(inputs, arraysize(inputs), "hello", true);
 }
 
+TEST(HttpChunkedDecoderTest, BytesAfterEOF) {
+  // The next response on a pipelined connection follows the final CRLF.
+  net::HttpChunkedDecoder decoder;
+  std::string input = "5\r\nhello\r\n0\r\n\r\nHTTP/1.1 200 OK";
+  int n = decoder.FilterBuf(&input[0], static_cast<int>(input.size()));
+  EXPECT_EQ(5, n);
+  EXPECT_TRUE(decoder.reached_eof());
+  EXPECT_EQ(15, decoder.bytes_after_eof());
+  EXPECT_EQ("hello", input.substr(0, n));
+  EXPECT_EQ("HTTP/1.1 200 OK", input.substr(n, decoder.bytes_after_eof()));
+}
+
 TEST(HttpChunkedDecoderTest, OneChunk) {
   const char* inputs[] = {
     "5\r\nhello\r\n"
@@ -24,6 +24,9 @@ namespace net {
 bool HttpNetworkLayer::use_winhttp_ = false;
 #endif
 
+// static
+bool HttpNetworkLayer::enable_pipelining_ = false;
+
 // static
 HttpTransactionFactory* HttpNetworkLayer::CreateFactory(
     const ProxyInfo* pi) {
@@ -42,6 +45,11 @@ void HttpNetworkLayer::UseWinHttp(bool value) {
 }
 #endif
 
+// static
+void HttpNetworkLayer::EnablePipelining(bool value) {
+  enable_pipelining_ = value;
+}
+
 //-----------------------------------------------------------------------------
 
 HttpNetworkLayer::HttpNetworkLayer(const ProxyInfo* pi)
@@ -65,8 +73,10 @@ HttpTransaction* HttpNetworkLayer::CreateTransaction() {
   if (suspended_)
     return NULL;
 
-  if (!session_)
+  if (!session_) {
     session_ = new HttpNetworkSession(proxy_resolver_.release());
+    session_->pipeline_manager()->set_enabled(enable_pipelining_);
+  }
 
   return new HttpNetworkTransaction(
       session_, ClientSocketFactory::GetDefaultFactory());
@@ -29,6 +29,10 @@ class HttpNetworkLayer : public HttpTransactionFactory {
   static void UseWinHttp(bool value);
 #endif
 
+  // If value is true, then requests are pipelined on persistent connections
+  // to servers that support them.  Affects the sessions created afterwards.
+  static void EnablePipelining(bool value);
+
   // HttpTransactionFactory methods:
   virtual HttpTransaction* CreateTransaction();
   virtual HttpCache* GetCache();
@@ -39,6 +43,7 @@ class HttpNetworkLayer : public HttpTransactionFactory {
 #if defined(OS_WIN)
   static bool use_winhttp_;
 #endif
+  static bool enable_pipelining_;
 
   // The pending proxy resolver to use when lazily creating session_.
   // NULL afterwards.
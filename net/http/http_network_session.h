@@ -9,6 +9,8 @@
 #include "net/base/auth_cache.h"
 #include "net/base/client_socket_pool.h"
 #include "net/base/ssl_config_service.h"
+#include "net/http/http_buffer_pool.h"
+#include "net/http/http_pipeline_manager.h"
 #include "net/proxy/proxy_service.h"
 
 namespace net {
@@ -16,20 +18,37 @@ namespace net {
 // This class holds session objects used by HttpNetworkTransaction objects.
 class HttpNetworkSession : public base::RefCounted<HttpNetworkSession> {
  public:
-  // Allow up to 6 connections per host.
+  // Allow up to 6 connections per host, and up to 256 connections overall.
   enum {
-    MAX_SOCKETS_PER_GROUP = 6
+    MAX_SOCKETS_PER_GROUP = 6,
+    MAX_SOCKETS = 256
   };
 
+  // Response headers are read into buffers of HEADER_BUFFER_SIZE bytes, and
+  // up to MAX_FREE_HEADER_BUFFERS of them are kept around for reuse.
+  enum {
+    HEADER_BUFFER_SIZE = 4096,
+    MAX_FREE_HEADER_BUFFERS = 16
+  };
+
+  // When pipelining is enabled, up to MAX_PIPELINE_DEPTH requests may be sent
+  // on a connection before their responses are read.
+  enum { MAX_PIPELINE_DEPTH = 4 };
+
   explicit HttpNetworkSession(ProxyResolver* proxy_resolver)
-      : connection_pool_(new ClientSocketPool(MAX_SOCKETS_PER_GROUP)),
+      : connection_pool_(new ClientSocketPool(MAX_SOCKETS_PER_GROUP,
+                                              MAX_SOCKETS)),
+        pipeline_manager_(connection_pool_, MAX_PIPELINE_DEPTH),
+        header_buffer_pool_(HEADER_BUFFER_SIZE, MAX_FREE_HEADER_BUFFERS),
         proxy_resolver_(proxy_resolver),
         proxy_service_(proxy_resolver) {
   }
 
   AuthCache* auth_cache() { return &auth_cache_; }
   ClientSocketPool* connection_pool() { return connection_pool_; }
+  HttpPipelineManager* pipeline_manager() { return &pipeline_manager_; }
   ProxyService* proxy_service() { return &proxy_service_; }
+  HttpBufferPool* header_buffer_pool() { return &header_buffer_pool_; }
 #if defined(OS_WIN)
   SSLConfigService* ssl_config_service() { return &ssl_config_service_; }
 #endif
@@ -37,6 +56,8 @@ class HttpNetworkSession : public base::RefCounted<HttpNetworkSession> {
  private:
   AuthCache auth_cache_;
   scoped_refptr<ClientSocketPool> connection_pool_;
+  HttpPipelineManager pipeline_manager_;
+  HttpBufferPool header_buffer_pool_;
   scoped_ptr<ProxyResolver> proxy_resolver_;
   ProxyService proxy_service_;
 #if defined(OS_WIN)
@@ -20,6 +20,8 @@
 #include "net/http/http_auth_handler.h"
 #include "net/http/http_chunked_decoder.h"
 #include "net/http/http_network_session.h"
+#include "net/http/http_pipeline_manager.h"
+#include "net/http/http_pipelined_connection.h"
 #include "net/http/http_request_info.h"
 #include "net/http/http_util.h"
 
@@ -43,6 +45,7 @@ HttpNetworkTransaction::HttpNetworkTransaction(HttpNetworkSession* session,
       socket_factory_(csf),
       connection_(session->connection_pool()),
       reused_socket_(false),
+      pipelining_disabled_(false),
       using_ssl_(false),
       using_proxy_(false),
       using_tunnel_(false),
@@ -52,6 +55,8 @@ HttpNetworkTransaction::HttpNetworkTransaction(HttpNetworkSession* session,
       header_buf_len_(0),
       header_buf_body_offset_(-1),
       header_buf_http_offset_(-1),
+      header_buf_pooled_(false),
+      header_buf_scanned_len_(0),
       content_length_(-1),  // -1 means unspecified.
       content_read_(0),
       read_buf_(NULL),
@@ -104,8 +109,7 @@ int HttpNetworkTransaction::RestartWithAuth(
   auth_data_[target]->password = password;
 
   next_state_ = STATE_INIT_CONNECTION;
-  connection_.set_socket(NULL);
-  connection_.Reset();
+  CloseConnection();
 
   // Reset the other member variables.
   ResetStateForRestart();
@@ -124,7 +128,7 @@ int HttpNetworkTransaction::Read(char* buf, int buf_len,
   DCHECK(buf);
   DCHECK(buf_len > 0);
 
-  if (!connection_.is_initialized())
+  if (!connection_.is_initialized() && !pipelined_socket_.get())
     return 0;  // connection_ has been reset.  Treat like EOF.
 
   read_buf_ = buf;
@@ -175,9 +179,12 @@ HttpNetworkTransaction::~HttpNetworkTransaction() {
   // try to reuse it later on.
   if (connection_.is_initialized())
     connection_.set_socket(NULL);
+  pipelined_socket_.reset();
 
   if (pac_request_)
     session_->proxy_service()->CancelPacRequest(pac_request_);
+
+  ReleaseHeaderBuf();
 }
 
 void HttpNetworkTransaction::BuildRequestHeaders() {
@@ -403,14 +410,30 @@ int HttpNetworkTransaction::DoInitConnection() {
   using_tunnel_ = !proxy_info_.is_direct() && using_ssl_;
 
   // Build the string used to uniquely identify connections of this type.
-  std::string connection_group;
+  connection_group_.clear();
   if (using_proxy_ || using_tunnel_)
-    connection_group = "proxy/" + proxy_info_.proxy_server() + "/";
+    connection_group_ = "proxy/" + proxy_info_.proxy_server() + "/";
   if (!using_proxy_)
-    connection_group.append(request_->url.GetOrigin().spec());
+    connection_group_.append(request_->url.GetOrigin().spec());
+  DCHECK(!connection_group_.empty());
+
+  // Only requests that are safe to send again, and whose responses can't be
+  // confused with an SSL handshake, are pipelined.
+  HttpPipelineManager* pipeline_manager = session_->pipeline_manager();
+  if (pipeline_manager->enabled() && !pipelining_disabled_ && !using_ssl_ &&
+      request_->method == "GET" && !request_->upload_data) {
+    pipelined_socket_.reset(
+        pipeline_manager->RequestSocket(connection_group_));
+    if (pipelined_socket_.get()) {
+      // The request is on a keep-alive connection, so it can be resent if the
+      // connection turns out to be closed.
+      reused_socket_ = true;
+      next_state_ = STATE_WRITE_HEADERS;
+      return OK;
+    }
+  }
 
-  DCHECK(!connection_group.empty());
-  return connection_.Init(connection_group, &io_callback_);
+  return connection_.Init(connection_group_, &io_callback_);
 }
 
 int HttpNetworkTransaction::DoInitConnectionComplete(int result) {
@@ -547,7 +570,7 @@ int HttpNetworkTransaction::DoWriteHeaders() {
                                  request_headers_bytes_sent_);
   DCHECK(buf_len > 0);
 
-  return connection_.socket()->Write(buf, buf_len, &io_callback_);
+  return socket()->Write(buf, buf_len, &io_callback_);
 }
 
 int HttpNetworkTransaction::DoWriteHeadersComplete(int result) {
@@ -571,10 +594,13 @@ int HttpNetworkTransaction::DoWriteBody() {
   DCHECK(request_->upload_data);
   DCHECK(request_body_stream_.get());
 
-  const char* buf = request_body_stream_->buf();
-  int buf_len = static_cast<int>(request_body_stream_->buf_len());
+  // The body's buffers go to the socket as they are, several at a time, so
+  // they aren't copied on the way.
+  Socket::WriteBuffer bufs[kMaxBodyWriteBuffers];
+  int buf_count =
+      request_body_stream_->GetBuffers(bufs, kMaxBodyWriteBuffers);
 
-  return connection_.socket()->Write(buf, buf_len, &io_callback_);
+  return socket()->WriteV(bufs, buf_count, &io_callback_);
 }
 
 int HttpNetworkTransaction::DoWriteBodyComplete(int result) {
@@ -595,16 +621,13 @@ int HttpNetworkTransaction::DoReadHeaders() {
   next_state_ = STATE_READ_HEADERS_COMPLETE;
 
   // Grow the read buffer if necessary.
-  if (header_buf_len_ == header_buf_capacity_) {
-    header_buf_capacity_ += kHeaderBufInitialSize;
-    header_buf_.reset(static_cast<char*>(
-        realloc(header_buf_.release(), header_buf_capacity_)));
-  }
+  if (header_buf_len_ == header_buf_capacity_)
+    GrowHeaderBuf();
 
   char* buf = header_buf_.get() + header_buf_len_;
   int buf_len = header_buf_capacity_ - header_buf_len_;
 
-  return connection_.socket()->Read(buf, buf_len, &io_callback_);
+  return socket()->Read(buf, buf_len, &io_callback_);
 }
 
 int HttpNetworkTransaction::HandleConnectionClosedBeforeEndOfHeaders() {
@@ -662,8 +685,13 @@ int HttpNetworkTransaction::DoReadHeadersComplete(int result) {
     }
 
     if (has_found_status_line_start()) {
+      // Only scan the new data, backing up enough to catch an end-of-headers
+      // marker (LF [CR] LF) that straddles the previous read.
+      int scan_offset = std::max(header_buf_http_offset_,
+                                 header_buf_scanned_len_ - 2);
       int eoh = HttpUtil::LocateEndOfHeaders(
-          header_buf_.get(), header_buf_len_, header_buf_http_offset_);
+          header_buf_.get(), header_buf_len_, scan_offset);
+      header_buf_scanned_len_ = header_buf_len_;
       if (eoh == -1) {
         // Prevent growing the headers buffer indefinitely.
         if (header_buf_len_ >= kMaxHeaderBufSize)
@@ -692,7 +720,7 @@ int HttpNetworkTransaction::DoReadHeadersComplete(int result) {
 int HttpNetworkTransaction::DoReadBody() {
   DCHECK(read_buf_);
   DCHECK(read_buf_len_ > 0);
-  DCHECK(connection_.is_initialized());
+  DCHECK(connection_.is_initialized() || pipelined_socket_.get());
 
   next_state_ = STATE_READ_BODY_COMPLETE;
 
@@ -700,27 +728,32 @@ int HttpNetworkTransaction::DoReadBody() {
   if (content_length_ != -1 && content_read_ >= content_length_)
     return 0;
 
+  // The next response on a pipelined connection may follow this one, so don't
+  // read past the end of the body.
+  if (pipelined_socket_.get() && content_length_ != -1) {
+    read_buf_len_ = static_cast<int>(
+        std::min<int64>(read_buf_len_, content_length_ - content_read_));
+  }
+
   // We may have some data remaining in the header buffer.
   if (header_buf_.get() && header_buf_body_offset_ < header_buf_len_) {
     int n = std::min(read_buf_len_, header_buf_len_ - header_buf_body_offset_);
     memcpy(read_buf_, header_buf_.get() + header_buf_body_offset_, n);
     header_buf_body_offset_ += n;
-    if (header_buf_body_offset_ == header_buf_len_) {
-      header_buf_.reset();
-      header_buf_capacity_ = 0;
-      header_buf_len_ = 0;
-      header_buf_body_offset_ = -1;
-    }
+    if (header_buf_body_offset_ == header_buf_len_)
+      ReleaseHeaderBuf();
     return n;
   }
 
-  return connection_.socket()->Read(read_buf_, read_buf_len_, &io_callback_);
+  return socket()->Read(read_buf_, read_buf_len_, &io_callback_);
 }
 
 int HttpNetworkTransaction::DoReadBodyComplete(int result) {
   // We are done with the Read call.
 
-  bool unfiltered_eof = (result == 0);
+  // A zero length body doesn't mean that the server closed the connection.
+  bool unfiltered_eof = (result == 0 &&
+      !(content_length_ != -1 && content_read_ >= content_length_));
 
   // Filter incoming data if appropriate.  FilterBuf may return an error.
   if (result > 0 && chunked_decoder_.get()) {
@@ -754,9 +787,35 @@ int HttpNetworkTransaction::DoReadBodyComplete(int result) {
 
   // Clean up the HttpConnection if we are done.
   if (done) {
-    if (!keep_alive)
-      connection_.set_socket(NULL);
-    connection_.Reset();
+    if (keep_alive) {
+      session_->pipeline_manager()->OnResponseComplete(connection_group_,
+                                                       *response_.headers);
+    }
+    if (pipelined_socket_.get()) {
+      // Give back what was read of the next response, in order: PushBack
+      // puts the data in front of what was pushed back before.
+      if (keep_alive && header_buf_.get() &&
+          header_buf_body_offset_ < header_buf_len_) {
+        pipelined_socket_->PushBack(header_buf_.get() + header_buf_body_offset_,
+                                    header_buf_len_ - header_buf_body_offset_);
+      }
+      if (keep_alive && chunked_decoder_.get() &&
+          chunked_decoder_->bytes_after_eof()) {
+        pipelined_socket_->PushBack(read_buf_ + result,
+                                    chunked_decoder_->bytes_after_eof());
+      }
+      ReleaseHeaderBuf();
+      if (keep_alive) {
+        pipelined_socket_->set_response_complete();
+      } else {
+        pipelined_socket_->Disconnect();
+      }
+      pipelined_socket_.reset();
+    } else {
+      if (!keep_alive)
+        connection_.set_socket(NULL);
+      connection_.Reset();
+    }
     // The next Read call will return 0 (EOF).
   }
 
@@ -770,9 +829,8 @@ int HttpNetworkTransaction::DoReadBodyComplete(int result) {
 int HttpNetworkTransaction::DidReadResponseHeaders() {
   scoped_refptr<HttpResponseHeaders> headers;
   if (has_found_status_line_start()) {
-    headers = new HttpResponseHeaders(
-        HttpUtil::AssembleRawHeaders(
-            header_buf_.get(), header_buf_body_offset_));
+    headers = new HttpResponseHeaders(header_buf_.get(),
+                                      header_buf_body_offset_);
   } else {
     // Fabricate a status line to to preserve the HTTP/0.9 version.
     // (otherwise HttpResponseHeaders will default it to HTTP/1.0).
@@ -803,6 +861,7 @@ int HttpNetworkTransaction::DidReadResponseHeaders() {
               header_buf_len_);
     }
     header_buf_body_offset_ = -1;
+    header_buf_scanned_len_ = 0;
     next_state_ = STATE_READ_HEADERS;
     return OK;
   }
@@ -818,6 +877,7 @@ int HttpNetworkTransaction::DidReadResponseHeaders() {
     request_headers_bytes_sent_ = 0;
     header_buf_len_ = 0;
     header_buf_body_offset_ = 0;
+    header_buf_scanned_len_ = 0;
     establishing_tunnel_ = false;
     return OK;
   }
@@ -932,11 +992,58 @@ int HttpNetworkTransaction::HandleIOError(int error) {
   return error;
 }
 
-void HttpNetworkTransaction::ResetStateForRestart() {
+void HttpNetworkTransaction::GrowHeaderBuf() {
+  HttpBufferPool* pool = session_->header_buffer_pool();
+  if (!header_buf_.get()) {
+    header_buf_.reset(pool->Get());
+    header_buf_capacity_ = pool->buffer_size();
+    header_buf_pooled_ = true;
+    return;
+  }
+
+  header_buf_capacity_ += kHeaderBufInitialSize;
+  if (header_buf_pooled_) {
+    // The headers have outgrown the pooled buffer.
+    char* buf = static_cast<char*>(malloc(header_buf_capacity_));
+    memcpy(buf, header_buf_.get(), header_buf_len_);
+    pool->Release(header_buf_.release());
+    header_buf_.reset(buf);
+    header_buf_pooled_ = false;
+  } else {
+    header_buf_.reset(static_cast<char*>(
+        realloc(header_buf_.release(), header_buf_capacity_)));
+  }
+}
+
+void HttpNetworkTransaction::ReleaseHeaderBuf() {
+  if (header_buf_pooled_)
+    session_->header_buffer_pool()->Release(header_buf_.release());
   header_buf_.reset();
+  header_buf_pooled_ = false;
   header_buf_capacity_ = 0;
   header_buf_len_ = 0;
   header_buf_body_offset_ = -1;
+  header_buf_scanned_len_ = 0;
+}
+
+ClientSocket* HttpNetworkTransaction::socket() {
+  if (pipelined_socket_.get())
+    return pipelined_socket_.get();
+  return connection_.socket();
+}
+
+void HttpNetworkTransaction::CloseConnection() {
+  if (pipelined_socket_.get()) {
+    pipelined_socket_.reset();
+    pipelining_disabled_ = true;
+  } else {
+    connection_.set_socket(NULL);
+    connection_.Reset();
+  }
+}
+
+void HttpNetworkTransaction::ResetStateForRestart() {
+  ReleaseHeaderBuf();
   header_buf_http_offset_ = -1;
   content_length_ = -1;
   content_read_ = 0;
@@ -959,8 +1066,7 @@ bool HttpNetworkTransaction::ShouldResendRequest() {
       header_buf_len_) {  // We have received some response headers.
     return false;
   }
-  connection_.set_socket(NULL);
-  connection_.Reset();
+  CloseConnection();
   request_headers_bytes_sent_ = 0;
   if (request_body_stream_.get())
     request_body_stream_->Reset();
@@ -24,6 +24,7 @@ class ClientSocketFactory;
 class HostResolver;
 class HttpChunkedDecoder;
 class HttpNetworkSession;
+class HttpPipelinedSocket;
 class UploadDataStream;
 
 class HttpNetworkTransaction : public HttpTransaction {
@@ -113,6 +114,23 @@ class HttpNetworkTransaction : public HttpTransaction {
   // requests.
   int HandleConnectionClosedBeforeEndOfHeaders();
 
+  // Makes room for more response headers in header_buf_.  The first buffer
+  // comes from the session's pool; it is only replaced by a bigger one when
+  // the headers don't fit.
+  void GrowHeaderBuf();
+
+  // Hands header_buf_ back to the session's pool (or frees it) and resets the
+  // bookkeeping of the header buffer.
+  void ReleaseHeaderBuf();
+
+  // Returns the socket on which the request is sent: the pipelined socket if
+  // the request is pipelined, or else the socket of |connection_|.
+  ClientSocket* socket();
+
+  // Closes the connection so that it is not reused.  If the request was
+  // pipelined, the request will not be pipelined again.
+  void CloseConnection();
+
   // Return true if based on the bytes read so far, the start of the
   // status line is known. This is used to distingish between HTTP/0.9
   // responses (which have no status line) and HTTP/1.x responses.
@@ -181,6 +199,15 @@ class HttpNetworkTransaction : public HttpTransaction {
   ClientSocketHandle connection_;
   bool reused_socket_;
 
+  // The group name of |connection_|, used to identify the origin.
+  std::string connection_group_;
+
+  // Set instead of |connection_| if the request is sent on a pipelined
+  // connection.  |pipelining_disabled_| is true once the request has been
+  // resent after a failure of its pipelined connection.
+  scoped_ptr<HttpPipelinedSocket> pipelined_socket_;
+  bool pipelining_disabled_;
+
   bool using_ssl_;     // True if handling a HTTPS request
   bool using_proxy_;   // True if using a proxy for HTTP (not HTTPS)
   bool using_tunnel_;  // True if using a tunnel for HTTPS
@@ -198,6 +225,9 @@ class HttpNetworkTransaction : public HttpTransaction {
   size_t request_headers_bytes_sent_;
   scoped_ptr<UploadDataStream> request_body_stream_;
 
+  // The most request body buffers handed to the socket in one write.
+  enum { kMaxBodyWriteBuffers = 16 };
+
   // The read buffer may be larger than it is full.  The 'capacity' indicates
   // the allocation size of the buffer, and the 'len' indicates how much data
   // is in the buffer already.  The 'body offset' indicates the offset of the
@@ -207,6 +237,13 @@ class HttpNetworkTransaction : public HttpTransaction {
   int header_buf_len_;
   int header_buf_body_offset_;
 
+  // True if header_buf_ was obtained from the session's header buffer pool.
+  bool header_buf_pooled_;
+
+  // The number of bytes of the read buffer that have already been searched
+  // for the end-of-headers marker, so that each read only scans new data.
+  int header_buf_scanned_len_;
+
   // The number of bytes by which the header buffer is grown when it reaches
   // capacity.
   enum { kHeaderBufInitialSize = 4096 };
@@ -78,7 +78,6 @@ class MockTCPClientSocket : public net::ClientSocket {
   MockTCPClientSocket(const net::AddressList& addresses)
       : data_(mock_sockets[mock_sockets_index++]),
         ALLOW_THIS_IN_INITIALIZER_LIST(method_factory_(this)),
-        callback_(NULL),
         read_index_(0),
         read_offset_(0),
         write_index_(0),
@@ -87,7 +86,6 @@ class MockTCPClientSocket : public net::ClientSocket {
   }
   // ClientSocket methods:
   virtual int Connect(net::CompletionCallback* callback) {
-    DCHECK(!callback_);
     if (connected_)
       return net::OK;
     connected_ = true;
@@ -103,14 +101,13 @@ class MockTCPClientSocket : public net::ClientSocket {
   }
   virtual void Disconnect() {
     connected_ = false;
-    callback_ = NULL;
+    method_factory_.RevokeAll();
   }
   virtual bool IsConnected() const {
     return connected_;
   }
   // Socket methods:
   virtual int Read(char* buf, int buf_len, net::CompletionCallback* callback) {
-    DCHECK(!callback_);
     MockRead& r = data_->reads[read_index_];
     int result = r.result;
     if (r.data) {
@@ -134,7 +131,6 @@ class MockTCPClientSocket : public net::ClientSocket {
   }
   virtual int Write(const char* buf, int buf_len,
                     net::CompletionCallback* callback) {
-    DCHECK(!callback_);
     // Not using mock writes; succeed synchronously.
     if (!data_->writes)
       return buf_len;
@@ -159,21 +155,18 @@ class MockTCPClientSocket : public net::ClientSocket {
     return result;
   }
  private:
+  // A read and a write may be pending at the same time on a pipelined
+  // connection, so each task carries its own callback.
   void RunCallbackAsync(net::CompletionCallback* callback, int result) {
-    callback_ = callback;
     MessageLoop::current()->PostTask(FROM_HERE,
         method_factory_.NewRunnableMethod(
-            &MockTCPClientSocket::RunCallback, result));
+            &MockTCPClientSocket::RunCallback, callback, result));
   }
-  void RunCallback(int result) {
-    net::CompletionCallback* c = callback_;
-    callback_ = NULL;
-    if (c)
-      c->Run(result);
+  void RunCallback(net::CompletionCallback* callback, int result) {
+    callback->Run(result);
   }
   MockSocket* data_;
   ScopedRunnableMethodFactory<MockTCPClientSocket> method_factory_;
-  net::CompletionCallback* callback_;
   int read_index_;
   int read_offset_;
   int write_index_;
@@ -856,3 +849,174 @@ TEST_F(HttpNetworkTransactionTest, LargeHeadersNoBody) {
   const net::HttpResponseInfo* response = trans->GetResponseInfo();
   EXPECT_TRUE(response == NULL);
 }
+
+// Test reading headers that outgrow the first header buffer, with the
+// end-of-headers marker split across reads.
+TEST_F(HttpNetworkTransactionTest, LargeHeadersSplitEndOfHeaders) {
+  std::string large_headers_string;
+  FillLargeHeadersString(&large_headers_string, 10 * 1024);
+
+  MockRead data_reads[] = {
+    MockRead("HTTP/1.0 200 OK\r\n"),
+    MockRead(true, large_headers_string.data(), large_headers_string.size()),
+    MockRead("\r"),
+    MockRead("\nhello world"),
+    MockRead(false, net::OK),
+  };
+  SimpleGetHelperResult out = SimpleGetHelper(data_reads);
+  EXPECT_EQ(net::OK, out.rv);
+  EXPECT_EQ("HTTP/1.0 200 OK", out.status_line);
+  EXPECT_EQ("hello world", out.response_data);
+}
+
+// Test that once a server has kept a connection alive, the next requests to it
+// are pipelined on that connection, and that responses that arrive in a single
+// read are handed to the right transactions, even when the end of the first
+// one is only found by the chunked decoder.
+TEST_F(HttpNetworkTransactionTest, Pipelining) {
+  scoped_refptr<net::HttpNetworkSession> session = CreateSession();
+  session->pipeline_manager()->set_enabled(true);
+
+  MockRead data_reads[] = {
+    MockRead("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n"),
+    MockRead("hello"),
+    MockRead("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+             "5\r\nworld\r\n0\r\n\r\n"
+             "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nfoo"),
+    MockRead(false, net::OK),
+  };
+  MockSocket data;
+  data.reads = data_reads;
+  mock_sockets[0] = &data;
+  mock_sockets[1] = NULL;
+
+  std::string response_data;
+
+  // The first response tells that the server keeps connections alive.
+  {
+    scoped_ptr<net::HttpTransaction> trans(
+        new net::HttpNetworkTransaction(session, &mock_socket_factory));
+    net::HttpRequestInfo request;
+    request.method = "GET";
+    request.url = GURL("http://www.google.com/");
+    request.load_flags = 0;
+
+    TestCompletionCallback callback;
+    int rv = trans->Start(&request, &callback);
+    EXPECT_EQ(net::ERR_IO_PENDING, rv);
+    EXPECT_EQ(net::OK, callback.WaitForResult());
+    EXPECT_EQ(net::OK, ReadTransaction(trans.get(), &response_data));
+    EXPECT_EQ("hello", response_data);
+  }
+  // Let the socket go back to the pool.
+  MessageLoop::current()->RunAllPending();
+
+  net::HttpRequestInfo request1;
+  request1.method = "GET";
+  request1.url = GURL("http://www.google.com/a");
+  request1.load_flags = 0;
+  net::HttpRequestInfo request2;
+  request2.method = "GET";
+  request2.url = GURL("http://www.google.com/b");
+  request2.load_flags = 0;
+
+  scoped_ptr<net::HttpTransaction> trans1(
+      new net::HttpNetworkTransaction(session, &mock_socket_factory));
+  scoped_ptr<net::HttpTransaction> trans2(
+      new net::HttpNetworkTransaction(session, &mock_socket_factory));
+
+  TestCompletionCallback callback1;
+  TestCompletionCallback callback2;
+  EXPECT_EQ(net::ERR_IO_PENDING, trans1->Start(&request1, &callback1));
+  EXPECT_EQ(net::ERR_IO_PENDING, trans2->Start(&request2, &callback2));
+
+  // The second request was sent without waiting for the first response.
+  EXPECT_EQ(1, session->pipeline_manager()->pipelined_request_count());
+
+  EXPECT_EQ(net::OK, callback1.WaitForResult());
+  EXPECT_EQ(net::OK, ReadTransaction(trans1.get(), &response_data));
+  EXPECT_EQ("world", response_data);
+
+  EXPECT_EQ(net::OK, callback2.WaitForResult());
+  EXPECT_EQ(net::OK, ReadTransaction(trans2.get(), &response_data));
+  EXPECT_EQ("foo", response_data);
+
+  // Pipelining saved the round trip of the second request, and only that one.
+  EXPECT_EQ(1, session->pipeline_manager()->pipelined_request_count());
+}
+
+// Test that a pipelined request dropped by the server is sent again on a new
+// connection, and that the server is not sent pipelined requests anymore.
+TEST_F(HttpNetworkTransactionTest, PipeliningServerClosesConnection) {
+  scoped_refptr<net::HttpNetworkSession> session = CreateSession();
+  session->pipeline_manager()->set_enabled(true);
+
+  MockRead data_reads1[] = {
+    MockRead("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n"),
+    MockRead("hello"),
+    MockRead("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nworld"),
+    MockRead(false, net::OK),
+  };
+  MockRead data_reads2[] = {
+    MockRead("HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\nfoo"),
+    MockRead(false, net::OK),
+  };
+  MockSocket data1;
+  data1.reads = data_reads1;
+  MockSocket data2;
+  data2.reads = data_reads2;
+  mock_sockets[0] = &data1;
+  mock_sockets[1] = &data2;
+  mock_sockets[2] = NULL;
+
+  std::string response_data;
+
+  {
+    scoped_ptr<net::HttpTransaction> trans(
+        new net::HttpNetworkTransaction(session, &mock_socket_factory));
+    net::HttpRequestInfo request;
+    request.method = "GET";
+    request.url = GURL("http://www.google.com/");
+    request.load_flags = 0;
+
+    TestCompletionCallback callback;
+    int rv = trans->Start(&request, &callback);
+    EXPECT_EQ(net::ERR_IO_PENDING, rv);
+    EXPECT_EQ(net::OK, callback.WaitForResult());
+    EXPECT_EQ(net::OK, ReadTransaction(trans.get(), &response_data));
+    EXPECT_EQ("hello", response_data);
+  }
+  MessageLoop::current()->RunAllPending();
+
+  net::HttpRequestInfo request1;
+  request1.method = "GET";
+  request1.url = GURL("http://www.google.com/a");
+  request1.load_flags = 0;
+  net::HttpRequestInfo request2;
+  request2.method = "GET";
+  request2.url = GURL("http://www.google.com/b");
+  request2.load_flags = 0;
+
+  scoped_ptr<net::HttpTransaction> trans1(
+      new net::HttpNetworkTransaction(session, &mock_socket_factory));
+  scoped_ptr<net::HttpTransaction> trans2(
+      new net::HttpNetworkTransaction(session, &mock_socket_factory));
+
+  TestCompletionCallback callback1;
+  TestCompletionCallback callback2;
+  EXPECT_EQ(net::ERR_IO_PENDING, trans1->Start(&request1, &callback1));
+  EXPECT_EQ(net::ERR_IO_PENDING, trans2->Start(&request2, &callback2));
+
+  EXPECT_EQ(net::OK, callback1.WaitForResult());
+  EXPECT_EQ(net::OK, ReadTransaction(trans1.get(), &response_data));
+  EXPECT_EQ("world", response_data);
+
+  // The server closed the connection instead of answering the second request.
+  EXPECT_EQ(net::OK, callback2.WaitForResult());
+  EXPECT_EQ(net::OK, ReadTransaction(trans2.get(), &response_data));
+  EXPECT_EQ("foo", response_data);
+  EXPECT_EQ(2, mock_sockets_index);
+
+  EXPECT_TRUE(session->pipeline_manager()->IsBlacklisted(
+      "http://www.google.com/"));
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_pipeline_manager.h"
+
+#include <algorithm>
+
+#include "base/histogram.h"
+#include "base/logging.h"
+#include "net/base/client_socket_pool.h"
+#include "net/http/http_pipelined_connection.h"
+#include "net/http/http_response_headers.h"
+
+namespace net {
+
+HttpPipelineManager::HttpPipelineManager(ClientSocketPool* pool,
+                                         int max_depth)
+    : pool_(pool),
+      max_depth_(max_depth),
+      enabled_(false),
+      pipelined_request_count_(0) {
+  DCHECK(max_depth > 1);
+}
+
+HttpPipelineManager::~HttpPipelineManager() {
+  // The connections are referenced by the transactions using them, which
+  // keep the session alive.
+  DCHECK(connections_.empty());
+}
+
+HttpPipelinedSocket* HttpPipelineManager::RequestSocket(
+    const std::string& group_name) {
+  if (!enabled_ || !capable_groups_.count(group_name) ||
+      blacklist_.count(group_name))
+    return NULL;
+
+  // An idle connection doesn't make the request wait for other responses, so
+  // it is better than any pipelined connection.
+  scoped_refptr<HttpPipelinedConnection> connection =
+      new HttpPipelinedConnection(this, pool_, group_name);
+  if (connection->Init()) {
+    connections_[group_name].push_back(connection);
+    return connection->CreateSocket();
+  }
+
+  // Otherwise, queue the request on the connection with the fewest requests.
+  ConnectionMap::iterator it = connections_.find(group_name);
+  if (it == connections_.end())
+    return NULL;
+  HttpPipelinedConnection* best = NULL;
+  for (size_t i = 0; i < it->second.size(); ++i) {
+    HttpPipelinedConnection* candidate = it->second[i];
+    if (candidate->depth() < max_depth_ &&
+        (!best || candidate->depth() < best->depth()))
+      best = candidate;
+  }
+  return best ? best->CreateSocket() : NULL;
+}
+
+void HttpPipelineManager::OnResponseComplete(
+    const std::string& group_name,
+    const HttpResponseHeaders& headers) {
+  if (headers.GetHttpVersion() >= HttpVersion(1, 1))
+    capable_groups_.insert(group_name);
+}
+
+bool HttpPipelineManager::IsBlacklisted(const std::string& group_name) const {
+  return blacklist_.count(group_name) != 0;
+}
+
+void HttpPipelineManager::OnRequestPipelined() {
+  pipelined_request_count_++;
+}
+
+void HttpPipelineManager::OnConnectionClosed(
+    HttpPipelinedConnection* connection,
+    bool server_misbehaved) {
+  if (server_misbehaved)
+    blacklist_.insert(connection->group_name());
+  RemoveConnection(connection);
+}
+
+void HttpPipelineManager::RemoveConnection(
+    HttpPipelinedConnection* connection) {
+  UMA_HISTOGRAM_COUNTS_100(L"Net.Pipeline_RequestsPerConnection",
+                           connection->request_count());
+
+  ConnectionMap::iterator it = connections_.find(connection->group_name());
+  DCHECK(it != connections_.end());
+  ConnectionList& list = it->second;
+  ConnectionList::iterator pos =
+      std::find(list.begin(), list.end(), connection);
+  DCHECK(pos != list.end());
+  list.erase(pos);
+  if (list.empty())
+    connections_.erase(it);
+}
+
+}  // namespace net
@@ -0,0 +1,93 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_HTTP_PIPELINE_MANAGER_H_
+#define NET_HTTP_HTTP_PIPELINE_MANAGER_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/ref_counted.h"
+
+namespace net {
+
+class ClientSocketPool;
+class HttpPipelinedConnection;
+class HttpPipelinedSocket;
+class HttpResponseHeaders;
+
+// HttpPipelineManager decides which requests are pipelined, and keeps track of
+// the HttpPipelinedConnections of a session.  Connections are identified by
+// the same group names as in the ClientSocketPool.
+//
+// Pipelining is off by default.  Once enabled, requests to a group are
+// pipelined after a response from it shows that the server keeps HTTP/1.1
+// connections alive.  A group whose server misbehaves on a pipelined
+// connection is blacklisted, and its requests go back to getting a connection
+// each.
+class HttpPipelineManager {
+ public:
+  // |max_depth| is the maximum number of requests on a connection whose
+  // responses have not been read.
+  HttpPipelineManager(ClientSocketPool* pool, int max_depth);
+  ~HttpPipelineManager();
+
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+  bool enabled() const { return enabled_; }
+
+  // Returns a socket on which to send a request of |group_name|, on an idle
+  // persistent connection taken from the pool or behind the requests already
+  // sent on a pipelined connection.  Returns NULL if the request should not
+  // be pipelined.  The caller owns the returned object.
+  HttpPipelinedSocket* RequestSocket(const std::string& group_name);
+
+  // Called when a response of |group_name| has been read in full and the
+  // connection is kept alive.
+  void OnResponseComplete(const std::string& group_name,
+                          const HttpResponseHeaders& headers);
+
+  // Returns true if requests of |group_name| are no longer pipelined because
+  // the server misbehaved.
+  bool IsBlacklisted(const std::string& group_name) const;
+
+  // Returns the number of requests sent without waiting for the response to
+  // the previous one, that is, the number of round trips saved.
+  int pipelined_request_count() const { return pipelined_request_count_; }
+
+ private:
+  friend class HttpPipelinedConnection;
+
+  typedef std::vector<HttpPipelinedConnection*> ConnectionList;
+  typedef std::map<std::string, ConnectionList> ConnectionMap;
+
+  // Methods called by HttpPipelinedConnection.
+  void OnRequestPipelined();
+  void OnConnectionClosed(HttpPipelinedConnection* connection,
+                          bool server_misbehaved);
+  void RemoveConnection(HttpPipelinedConnection* connection);
+
+  scoped_refptr<ClientSocketPool> pool_;
+  int max_depth_;
+  bool enabled_;
+
+  // The groups known to keep HTTP/1.1 connections alive.
+  std::set<std::string> capable_groups_;
+
+  // The groups that misbehaved on a pipelined connection.
+  std::set<std::string> blacklist_;
+
+  // The pipelined connections with requests on them.
+  ConnectionMap connections_;
+
+  int pipelined_request_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpPipelineManager);
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_PIPELINE_MANAGER_H_
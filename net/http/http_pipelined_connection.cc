@@ -0,0 +1,360 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_pipelined_connection.h"
+
+#include <algorithm>
+
+#include "base/compiler_specific.h"
+#include "base/logging.h"
+#include "base/message_loop.h"
+#include "net/base/net_errors.h"
+#include "net/http/http_pipeline_manager.h"
+
+namespace net {
+
+HttpPipelinedConnection::HttpPipelinedConnection(HttpPipelineManager* manager,
+                                                 ClientSocketPool* pool,
+                                                 const std::string& group_name)
+    : manager_(manager),
+      connection_(pool),
+      group_name_(group_name),
+      reading_socket_(NULL),
+      writing_socket_(NULL),
+      request_count_(0),
+      closed_(false),
+      ALLOW_THIS_IN_INITIALIZER_LIST(
+          read_callback_(this, &HttpPipelinedConnection::OnReadComplete)),
+      ALLOW_THIS_IN_INITIALIZER_LIST(
+          write_callback_(this, &HttpPipelinedConnection::OnWriteComplete)) {
+}
+
+HttpPipelinedConnection::~HttpPipelinedConnection() {
+  DCHECK(sockets_.empty());
+}
+
+bool HttpPipelinedConnection::Init() {
+  // A connection that has yet to be established could be to a server that
+  // doesn't keep connections alive, so only an idle one will do.
+  return connection_.InitWithIdleSocket(group_name_);
+}
+
+HttpPipelinedSocket* HttpPipelinedConnection::CreateSocket() {
+  DCHECK(!closed_);
+  HttpPipelinedSocket* socket = new HttpPipelinedSocket(this);
+  sockets_.push_back(socket);
+  request_count_++;
+  return socket;
+}
+
+int HttpPipelinedConnection::Read(HttpPipelinedSocket* socket,
+                                  char* buf, int buf_len,
+                                  CompletionCallback* callback) {
+  DCHECK(!socket->read_callback_);
+  if (closed_)
+    return ERR_CONNECTION_CLOSED;
+
+  if (!socket->request_sent_) {
+    // The next request can go out now.
+    socket->request_sent_ = true;
+    HttpPipelinedSocket* writer = GetWriter();
+    if (writer && writer->write_callback_) {
+      MessageLoop::current()->PostTask(FROM_HERE, NewRunnableMethod(
+          this, &HttpPipelinedConnection::ProcessPendingIO));
+    }
+  }
+
+  if (socket != sockets_.front()) {
+    // Wait for the previous responses.
+    socket->read_buf_ = buf;
+    socket->read_buf_len_ = buf_len;
+    socket->read_callback_ = callback;
+    return ERR_IO_PENDING;
+  }
+
+  int rv = DoRead(socket, buf, buf_len);
+  if (rv == ERR_IO_PENDING)
+    socket->read_callback_ = callback;
+  return rv;
+}
+
+int HttpPipelinedConnection::Write(HttpPipelinedSocket* socket,
+                                   const char* buf, int buf_len,
+                                   CompletionCallback* callback) {
+  DCHECK(!socket->write_callback_);
+  DCHECK(!socket->request_sent_);
+  if (closed_)
+    return ERR_CONNECTION_CLOSED;
+
+  if (socket != GetWriter()) {
+    // Wait until the previous requests have been sent.
+    socket->write_buf_ = buf;
+    socket->write_buf_len_ = buf_len;
+    socket->write_callback_ = callback;
+    return ERR_IO_PENDING;
+  }
+
+  int rv = DoWrite(socket, buf, buf_len);
+  if (rv == ERR_IO_PENDING)
+    socket->write_callback_ = callback;
+  return rv;
+}
+
+void HttpPipelinedConnection::PushBack(const char* data, int data_len) {
+  // This data comes before anything that was pushed back earlier.
+  unread_data_.insert(0, data, data_len);
+}
+
+void HttpPipelinedConnection::OnSocketDestroyed(HttpPipelinedSocket* socket) {
+  std::deque<HttpPipelinedSocket*>::iterator it =
+      std::find(sockets_.begin(), sockets_.end(), socket);
+  DCHECK(it != sockets_.end());
+  bool was_first = (it == sockets_.begin());
+  sockets_.erase(it);
+  if (reading_socket_ == socket)
+    reading_socket_ = NULL;
+  if (writing_socket_ == socket)
+    writing_socket_ = NULL;
+
+  if (closed_)
+    return;
+
+  if (!was_first || !socket->response_complete_) {
+    // The rest of the response is still coming, or the request may be only
+    // partially sent; there is no telling where the next response starts.
+    Close(false);
+    return;
+  }
+
+  if (sockets_.empty()) {
+    if (!unread_data_.empty()) {
+      // The server sent more than it was asked for.
+      Close(false);
+      return;
+    }
+    // Nothing is left on the connection, so it goes back to the pool.
+    manager_->RemoveConnection(this);
+    manager_ = NULL;
+    connection_.Reset();
+    return;
+  }
+
+  if (sockets_.front()->read_callback_) {
+    MessageLoop::current()->PostTask(FROM_HERE, NewRunnableMethod(
+        this, &HttpPipelinedConnection::ProcessPendingIO));
+  }
+}
+
+HttpPipelinedSocket* HttpPipelinedConnection::GetWriter() const {
+  for (size_t i = 0; i < sockets_.size(); ++i) {
+    if (!sockets_[i]->request_sent_)
+      return sockets_[i];
+  }
+  return NULL;
+}
+
+void HttpPipelinedConnection::ProcessPendingIO() {
+  if (closed_)
+    return;
+
+  // Only one callback is run per task, since running it may destroy any of
+  // the sockets.
+  HttpPipelinedSocket* writer = GetWriter();
+  if (writer && writer->write_callback_ && writing_socket_ != writer) {
+    int rv = DoWrite(writer, writer->write_buf_, writer->write_buf_len_);
+    if (rv != ERR_IO_PENDING) {
+      CompletionCallback* callback = writer->write_callback_;
+      writer->write_callback_ = NULL;
+      writer->write_buf_ = NULL;
+      MessageLoop::current()->PostTask(FROM_HERE, NewRunnableMethod(
+          this, &HttpPipelinedConnection::ProcessPendingIO));
+      callback->Run(rv);
+      return;
+    }
+  }
+
+  if (sockets_.empty())
+    return;
+  HttpPipelinedSocket* reader = sockets_.front();
+  if (reader->read_callback_ && reading_socket_ != reader) {
+    int rv = DoRead(reader, reader->read_buf_, reader->read_buf_len_);
+    if (rv != ERR_IO_PENDING) {
+      CompletionCallback* callback = reader->read_callback_;
+      reader->read_callback_ = NULL;
+      reader->read_buf_ = NULL;
+      callback->Run(rv);
+    }
+  }
+}
+
+int HttpPipelinedConnection::DoRead(HttpPipelinedSocket* socket,
+                                    char* buf, int buf_len) {
+  DCHECK(socket == sockets_.front());
+  DCHECK(!reading_socket_);
+
+  if (!unread_data_.empty()) {
+    int rv = std::min(buf_len, static_cast<int>(unread_data_.size()));
+    memcpy(buf, unread_data_.data(), rv);
+    unread_data_.erase(0, rv);
+    return rv;
+  }
+
+  int rv = connection_.socket()->Read(buf, buf_len, &read_callback_);
+  if (rv == ERR_IO_PENDING) {
+    reading_socket_ = socket;
+    socket->read_buf_ = buf;
+    socket->read_buf_len_ = buf_len;
+  } else if (rv <= 0) {
+    // Dropping pipelined requests after answering the previous ones is how
+    // servers that can't cope with pipelining usually behave.
+    Close(socket->was_pipelined_);
+  }
+  return rv;
+}
+
+int HttpPipelinedConnection::DoWrite(HttpPipelinedSocket* socket,
+                                     const char* buf, int buf_len) {
+  DCHECK(!writing_socket_);
+
+  // A request sent before the previous response has been read saves a round
+  // trip.
+  if (socket != sockets_.front() && !socket->was_pipelined_) {
+    socket->was_pipelined_ = true;
+    manager_->OnRequestPipelined();
+  }
+
+  int rv = connection_.socket()->Write(buf, buf_len, &write_callback_);
+  if (rv == ERR_IO_PENDING) {
+    writing_socket_ = socket;
+    socket->write_buf_ = buf;
+    socket->write_buf_len_ = buf_len;
+  }
+  return rv;
+}
+
+void HttpPipelinedConnection::OnReadComplete(int result) {
+  HttpPipelinedSocket* socket = reading_socket_;
+  reading_socket_ = NULL;
+  if (!socket || closed_)
+    return;
+
+  if (result <= 0)
+    Close(socket->was_pipelined_);
+
+  CompletionCallback* callback = socket->read_callback_;
+  socket->read_callback_ = NULL;
+  socket->read_buf_ = NULL;
+  callback->Run(result);
+}
+
+void HttpPipelinedConnection::OnWriteComplete(int result) {
+  HttpPipelinedSocket* socket = writing_socket_;
+  writing_socket_ = NULL;
+  if (!socket || closed_)
+    return;
+
+  CompletionCallback* callback = socket->write_callback_;
+  socket->write_callback_ = NULL;
+  socket->write_buf_ = NULL;
+  callback->Run(result);
+}
+
+void HttpPipelinedConnection::Close(bool server_misbehaved) {
+  if (closed_)
+    return;
+  closed_ = true;
+
+  if (manager_) {
+    manager_->OnConnectionClosed(this, server_misbehaved);
+    manager_ = NULL;
+  }
+
+  connection_.set_socket(NULL);
+  connection_.Reset();
+  reading_socket_ = NULL;
+  writing_socket_ = NULL;
+  unread_data_.clear();
+
+  MessageLoop::current()->PostTask(FROM_HERE, NewRunnableMethod(
+      this, &HttpPipelinedConnection::FailPendingIO));
+}
+
+void HttpPipelinedConnection::FailPendingIO() {
+  DCHECK(closed_);
+  for (size_t i = 0; i < sockets_.size(); ++i) {
+    HttpPipelinedSocket* socket = sockets_[i];
+    CompletionCallback* callback = socket->read_callback_ ?
+        socket->read_callback_ : socket->write_callback_;
+    if (!callback)
+      continue;
+    socket->read_callback_ = NULL;
+    socket->read_buf_ = NULL;
+    socket->write_callback_ = NULL;
+    socket->write_buf_ = NULL;
+
+    // Running the callback may destroy any of the sockets, so the others are
+    // handled by another task.
+    MessageLoop::current()->PostTask(FROM_HERE, NewRunnableMethod(
+        this, &HttpPipelinedConnection::FailPendingIO));
+    callback->Run(ERR_CONNECTION_CLOSED);
+    return;
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+HttpPipelinedSocket::HttpPipelinedSocket(HttpPipelinedConnection* connection)
+    : connection_(connection),
+      request_sent_(false),
+      response_complete_(false),
+      was_pipelined_(false),
+      read_buf_(NULL),
+      read_buf_len_(0),
+      read_callback_(NULL),
+      write_buf_(NULL),
+      write_buf_len_(0),
+      write_callback_(NULL) {
+}
+
+HttpPipelinedSocket::~HttpPipelinedSocket() {
+  connection_->OnSocketDestroyed(this);
+}
+
+void HttpPipelinedSocket::PushBack(const char* data, int data_len) {
+  DCHECK(data_len > 0);
+  connection_->PushBack(data, data_len);
+}
+
+int HttpPipelinedSocket::Connect(CompletionCallback* callback) {
+  return IsConnected() ? OK : ERR_CONNECTION_CLOSED;
+}
+
+int HttpPipelinedSocket::ReconnectIgnoringLastError(
+    CompletionCallback* callback) {
+  NOTREACHED();
+  return ERR_UNEXPECTED;
+}
+
+void HttpPipelinedSocket::Disconnect() {
+  // The server is not keeping the connection alive; that is a problem only
+  // if other requests were sent on it.
+  connection_->Close(connection_->depth() > 1);
+}
+
+bool HttpPipelinedSocket::IsConnected() const {
+  return !connection_->closed_ &&
+         connection_->connection_.socket()->IsConnected();
+}
+
+int HttpPipelinedSocket::Read(char* buf, int buf_len,
+                              CompletionCallback* callback) {
+  return connection_->Read(this, buf, buf_len, callback);
+}
+
+int HttpPipelinedSocket::Write(const char* buf, int buf_len,
+                               CompletionCallback* callback) {
+  return connection_->Write(this, buf, buf_len, callback);
+}
+
+}  // namespace net
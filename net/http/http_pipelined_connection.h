@@ -0,0 +1,178 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_HTTP_PIPELINED_CONNECTION_H_
+#define NET_HTTP_HTTP_PIPELINED_CONNECTION_H_
+
+#include <deque>
+#include <string>
+
+#include "base/ref_counted.h"
+#include "net/base/client_socket.h"
+#include "net/base/client_socket_handle.h"
+#include "net/base/completion_callback.h"
+
+namespace net {
+
+class ClientSocketPool;
+class HttpPipelineManager;
+class HttpPipelinedSocket;
+
+// An HttpPipelinedConnection sends several requests on one persistent
+// connection without waiting for the responses to the previous ones, as
+// described in section 8.1.2.2 of RFC 2616.
+//
+// Each request gets its own HttpPipelinedSocket, which the transaction uses in
+// place of a regular socket.  Requests are written in the order in which the
+// sockets were created, and a socket can only read once the responses of all
+// the previous ones have been read in full.  Since a transaction may read past
+// the end of its response, it hands those bytes back (see PushBack) so that
+// they are the first ones read by the next socket.
+//
+// If anything goes wrong, the connection is closed and every request still on
+// it fails with ERR_CONNECTION_CLOSED, so that it is sent again on a
+// connection of its own.
+class HttpPipelinedConnection
+    : public base::RefCounted<HttpPipelinedConnection> {
+ public:
+  HttpPipelinedConnection(HttpPipelineManager* manager,
+                          ClientSocketPool* pool,
+                          const std::string& group_name);
+
+  // Takes an idle persistent connection of the group from the pool.  Returns
+  // false if there is none, in which case this object should be discarded.
+  bool Init();
+
+  // Returns a socket for the next request on this connection.  The caller
+  // owns the returned object.
+  HttpPipelinedSocket* CreateSocket();
+
+  // Returns the number of requests on this connection whose responses have
+  // not been read in full.
+  int depth() const { return static_cast<int>(sockets_.size()); }
+
+  // Returns the number of requests sent on this connection so far.
+  int request_count() const { return request_count_; }
+
+  const std::string& group_name() const { return group_name_; }
+
+ private:
+  friend class base::RefCounted<HttpPipelinedConnection>;
+  friend class HttpPipelinedSocket;
+
+  ~HttpPipelinedConnection();
+
+  // Methods called by HttpPipelinedSocket.
+  int Read(HttpPipelinedSocket* socket, char* buf, int buf_len,
+           CompletionCallback* callback);
+  int Write(HttpPipelinedSocket* socket, const char* buf, int buf_len,
+            CompletionCallback* callback);
+  void PushBack(const char* data, int data_len);
+  void OnSocketDestroyed(HttpPipelinedSocket* socket);
+
+  // Returns the socket that is allowed to write: the first one that has not
+  // finished sending its request.  Returns NULL if there is none.
+  HttpPipelinedSocket* GetWriter() const;
+
+  // Starts the I/O on the underlying socket that was waiting for its turn.
+  // Run asynchronously, since the waiting sockets were told ERR_IO_PENDING.
+  void ProcessPendingIO();
+
+  // Reads or writes on the underlying socket on behalf of |socket|.  Return
+  // ERR_IO_PENDING if the operation is in progress.
+  int DoRead(HttpPipelinedSocket* socket, char* buf, int buf_len);
+  int DoWrite(HttpPipelinedSocket* socket, const char* buf, int buf_len);
+
+  // Callbacks of the underlying socket.
+  void OnReadComplete(int result);
+  void OnWriteComplete(int result);
+
+  // Closes the underlying connection and fails the requests left on it.
+  // |server_misbehaved| is true if the server is to blame, in which case it
+  // won't be sent pipelined requests again.
+  void Close(bool server_misbehaved);
+
+  // Completes the pending operations of the sockets left on a closed
+  // connection with ERR_CONNECTION_CLOSED.
+  void FailPendingIO();
+
+  HttpPipelineManager* manager_;  // NULL once this connection is closed.
+  ClientSocketHandle connection_;
+  std::string group_name_;
+
+  // The sockets in request order.  The first one is the one reading its
+  // response.
+  std::deque<HttpPipelinedSocket*> sockets_;
+
+  // Data read from the underlying socket that belongs to the next response.
+  std::string unread_data_;
+
+  // The sockets that have a Read or Write in progress on the underlying
+  // socket.
+  HttpPipelinedSocket* reading_socket_;
+  HttpPipelinedSocket* writing_socket_;
+
+  int request_count_;
+
+  bool closed_;
+
+  CompletionCallbackImpl<HttpPipelinedConnection> read_callback_;
+  CompletionCallbackImpl<HttpPipelinedConnection> write_callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpPipelinedConnection);
+};
+
+// The socket used by a transaction for a request sent on an
+// HttpPipelinedConnection.  The request is considered sent as soon as the
+// transaction starts reading.
+class HttpPipelinedSocket : public ClientSocket {
+ public:
+  virtual ~HttpPipelinedSocket();
+
+  // Gives back |data|, which was read past the end of this request's response,
+  // so that the next request on the connection reads it first.
+  void PushBack(const char* data, int data_len);
+
+  // Indicates that the response has been read in full, so the connection can
+  // move on to the next request once this socket is destroyed.  Destroying
+  // the socket without calling this method closes the connection.
+  void set_response_complete() { response_complete_ = true; }
+
+  // ClientSocket methods:
+  virtual int Connect(CompletionCallback* callback);
+  virtual int ReconnectIgnoringLastError(CompletionCallback* callback);
+  virtual void Disconnect();
+  virtual bool IsConnected() const;
+
+  // Socket methods:
+  virtual int Read(char* buf, int buf_len, CompletionCallback* callback);
+  virtual int Write(const char* buf, int buf_len, CompletionCallback* callback);
+
+ private:
+  friend class HttpPipelinedConnection;
+
+  explicit HttpPipelinedSocket(HttpPipelinedConnection* connection);
+
+  scoped_refptr<HttpPipelinedConnection> connection_;
+
+  bool request_sent_;
+  bool response_complete_;
+
+  // True if the request was sent before the previous response was read.
+  bool was_pipelined_;
+
+  // The Read or Write call waiting for its turn or for the underlying socket.
+  char* read_buf_;
+  int read_buf_len_;
+  CompletionCallback* read_callback_;
+  const char* write_buf_;
+  int write_buf_len_;
+  CompletionCallback* write_callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpPipelinedSocket);
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_HTTP_PIPELINED_CONNECTION_H_
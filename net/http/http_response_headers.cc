@@ -80,6 +80,11 @@ HttpResponseHeaders::HttpResponseHeaders(const std::string& raw_input)
   Parse(raw_input);
 }
 
+HttpResponseHeaders::HttpResponseHeaders(const char* buf, int buf_len)
+    : response_code_(-1) {
+  ParseBuffer(buf, buf_len);
+}
+
 HttpResponseHeaders::HttpResponseHeaders(const Pickle& pickle, void** iter)
     : response_code_(-1) {
   std::string raw_input;
@@ -214,10 +219,49 @@ void HttpResponseHeaders::Parse(const std::string& raw_input) {
   // it (to populate our parsed_ vector).
   raw_headers_.append(line_end + 1, raw_input.end());
 
-  // Adjust to point at the null byte following the status line
-  line_end = raw_headers_.begin() + status_line_len - 1;
+  ParseHeaderLines(status_line_len);
+}
+
+void HttpResponseHeaders::ParseBuffer(const char* buf, int buf_len) {
+  // Skip any leading slop, like HttpUtil::AssembleRawHeaders does.
+  int status_begin_offset = HttpUtil::LocateStartOfStatusLine(buf, buf_len);
+  if (status_begin_offset != -1) {
+    buf += status_begin_offset;
+    buf_len -= status_begin_offset;
+  }
+  const char* end = buf + buf_len;
+  const char* status_line_end = HttpUtil::FindStatusLineEnd(buf, end);
+
+  // There are headers if anything other than line terminators follows the
+  // status line.
+  bool has_headers = false;
+  for (const char* p = status_line_end; p != end; ++p) {
+    if (*p != '\r' && *p != '\n') {
+      has_headers = true;
+      break;
+    }
+  }
+
+  // ParseStatusLine adds a normalized status line to raw_headers_.  The
+  // status line is short, so a copy of it (with the sentinel null byte that
+  // ParseStatusLine expects) is cheap.
+  std::string status_line(buf, status_line_end);
+  status_line.push_back('\0');
+  raw_headers_.reserve(buf_len + 2);
+  ParseStatusLine(status_line.begin(), status_line.end() - 1, has_headers);
+
+  // Including a terminating null byte.
+  size_t status_line_len = raw_headers_.size();
+
+  HttpUtil::AppendHeaderLines(status_line_end, end, &raw_headers_);
+  raw_headers_.push_back('\0');
+
+  ParseHeaderLines(status_line_len);
+}
 
-  HttpUtil::HeadersIterator headers(line_end + 1, raw_headers_.end(),
+void HttpResponseHeaders::ParseHeaderLines(size_t status_line_len) {
+  HttpUtil::HeadersIterator headers(raw_headers_.begin() + status_line_len,
+                                    raw_headers_.end(),
                                     std::string(1, '\0'));
   while (headers.GetNext()) {
     AddHeader(headers.name_begin(),
@@ -935,5 +979,52 @@ int64 HttpResponseHeaders::GetContentLength() const {
   return result;
 }
 
+bool HttpResponseHeaders::GetContentRange(int64* first_byte_position,
+                                          int64* last_byte_position,
+                                          int64* instance_length) const {
+  std::string value;
+  if (!EnumerateHeader(NULL, "content-range", &value))
+    return false;
+
+  // Expect "bytes first-last/length", where length may be "*".
+  std::string::const_iterator begin = value.begin();
+  std::string::const_iterator end = value.end();
+  HttpUtil::TrimLWS(&begin, &end);
+  static const char kBytes[] = "bytes";
+  const size_t kBytesLen = arraysize(kBytes) - 1;
+  if (static_cast<size_t>(end - begin) <= kBytesLen ||
+      !LowerCaseEqualsASCII(begin, begin + kBytesLen, kBytes) ||
+      !HttpUtil::IsLWS(*(begin + kBytesLen)))
+    return false;
+  begin += kBytesLen;
+
+  std::string spec(begin, end);
+  size_t dash = spec.find('-');
+  size_t slash = spec.find('/');
+  if (dash == std::string::npos || slash == std::string::npos || dash > slash)
+    return false;
+
+  std::string first, last, length;
+  TrimWhitespace(spec.substr(0, dash), TRIM_ALL, &first);
+  TrimWhitespace(spec.substr(dash + 1, slash - dash - 1), TRIM_ALL, &last);
+  TrimWhitespace(spec.substr(slash + 1), TRIM_ALL, &length);
+
+  int64 first_value, last_value, length_value = -1;
+  if (!StringToInt64(first, &first_value) ||
+      !StringToInt64(last, &last_value) ||
+      first_value < 0 || last_value < first_value)
+    return false;
+
+  if (length != "*") {
+    if (!StringToInt64(length, &length_value) || length_value <= last_value)
+      return false;
+  }
+
+  *first_byte_position = first_value;
+  *last_byte_position = last_value;
+  *instance_length = length_value;
+  return true;
+}
+
 }  // namespace net
 
@@ -36,6 +36,14 @@ class HttpResponseHeaders :
   //
   explicit HttpResponseHeaders(const std::string& raw_headers);
 
+  // Parses the response headers exactly as they were received from the
+  // network: |buf| holds |buf_len| bytes ending at the end-of-headers marker
+  // (see HttpUtil::LocateEndOfHeaders).  This is equivalent to
+  //   HttpResponseHeaders(HttpUtil::AssembleRawHeaders(buf, buf_len))
+  // but the headers are assembled straight into this object, without going
+  // through an intermediate copy.
+  HttpResponseHeaders(const char* buf, int buf_len);
+
   // Initializes from the representation stored in the given pickle.  The data
   // for this object is found relative to the given pickle_iter, which should
   // be passed to the pickle's various Read* methods.
@@ -185,6 +193,14 @@ class HttpResponseHeaders :
   // no such header in the response.
   int64 GetContentLength() const;
 
+  // Extracts the values of the byte-range-resp-spec of a Content-Range header
+  // (see section 14.16 of RFC 2616), as in "bytes 0-499/1234".  Returns false
+  // if there is no such header or it cannot be parsed.  |instance_length| is
+  // set to -1 if the length of the whole resource is unknown ("*").
+  bool GetContentRange(int64* first_byte_position,
+                       int64* last_byte_position,
+                       int64* instance_length) const;
+
   // Returns the HTTP response code.  This is 0 if the response code text seems
   // to exist but could not be parsed.  Otherwise, it defaults to 200 if the
   // response code is not found in the raw headers.
@@ -202,6 +218,13 @@ class HttpResponseHeaders :
   // Initializes from the given raw headers.
   void Parse(const std::string& raw_input);
 
+  // Initializes from the headers received from the network.
+  void ParseBuffer(const char* buf, int buf_len);
+
+  // Populates parsed_ with the header lines that follow the status line in
+  // raw_headers_, which ends at |status_line_len|.
+  void ParseHeaderLines(size_t status_line_len);
+
   // Helper function for ParseStatusLine.
   // Tries to extract the "HTTP/X.Y" from a status line formatted like:
   //    HTTP/1.1 200 OK
@@ -0,0 +1,66 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/perftimer.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::HttpResponseHeaders;
+
+namespace {
+
+// A typical set of response headers, as they come from the network.
+const char kResponse[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Mon, 10 Nov 2008 18:06:11 GMT\r\n"
+    "Server: Apache/2.2.3 (Unix)\r\n"
+    "Last-Modified: Fri, 07 Nov 2008 21:12:32 GMT\r\n"
+    "ETag: \"6b0c8e-2a5d-45b1cd6a5f400\"\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "Cache-Control: max-age=3600, public\r\n"
+    "Expires: Mon, 10 Nov 2008 19:06:11 GMT\r\n"
+    "Vary: Accept-Encoding,\r\n"
+    "  User-Agent\r\n"
+    "Content-Encoding: gzip\r\n"
+    "Content-Length: 3612\r\n"
+    "Set-Cookie: a=1; path=/\r\n"
+    "Set-Cookie: b=2; path=/\r\n"
+    "Keep-Alive: timeout=15, max=100\r\n"
+    "Connection: Keep-Alive\r\n"
+    "Content-Type: text/html; charset=utf-8\r\n"
+    "\r\n";
+
+const int kIterations = 20000;
+
+}  // namespace
+
+// Parses the headers through AssembleRawHeaders, the way they were parsed
+// before HttpResponseHeaders could take the network buffer.
+TEST(HttpResponseHeadersPerfTest, ParseAssembled) {
+  int buf_len = static_cast<int>(arraysize(kResponse) - 1);
+  PerfTimer timer;
+  for (int i = 0; i < kIterations; ++i) {
+    scoped_refptr<HttpResponseHeaders> parsed = new HttpResponseHeaders(
+        net::HttpUtil::AssembleRawHeaders(kResponse, buf_len));
+    EXPECT_EQ(200, parsed->response_code());
+  }
+  LogPerfResult("HttpResponseHeaders_parse_assembled",
+                timer.Elapsed().InMillisecondsF() * 1000 / kIterations, "us");
+}
+
+// Parses the headers straight from the network buffer.
+TEST(HttpResponseHeadersPerfTest, ParseFromBuffer) {
+  int buf_len = static_cast<int>(arraysize(kResponse) - 1);
+  PerfTimer timer;
+  for (int i = 0; i < kIterations; ++i) {
+    scoped_refptr<HttpResponseHeaders> parsed =
+        new HttpResponseHeaders(kResponse, buf_len);
+    EXPECT_EQ(200, parsed->response_code());
+  }
+  LogPerfResult("HttpResponseHeaders_parse_from_buffer",
+                timer.Elapsed().InMillisecondsF() * 1000 / kIterations, "us");
+}
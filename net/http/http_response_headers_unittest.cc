@@ -8,6 +8,7 @@
 #include "base/pickle.h"
 #include "base/time.h"
 #include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 using namespace std;
@@ -1011,6 +1012,71 @@ TEST(HttpResponseHeadersTest, GetContentLength) {
   }
 }
 
+TEST(HttpResponseHeadersTest, GetContentRange) {
+  const struct {
+    const char* headers;
+    bool expected_return_value;
+    int64 expected_first_byte_position;
+    int64 expected_last_byte_position;
+    int64 expected_instance_length;
+  } tests[] = {
+    { "HTTP/1.1 206 Partial Content\n",
+      false, 0, 0, 0
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range: bytes 0-50/51\n",
+      true, 0, 50, 51
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range:   bytes   1000 - 1999 / 8000\n",
+      true, 1000, 1999, 8000
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range: BYTES 10-20/*\n",
+      true, 10, 20, -1
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range: bytes 0-50\n",
+      false, 0, 0, 0
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range: bytes 50-0/100\n",
+      false, 0, 0, 0
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range: bytes 0-50/50\n",
+      false, 0, 0, 0
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range: bytes */100\n",
+      false, 0, 0, 0
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range: items 0-50/100\n",
+      false, 0, 0, 0
+    },
+    { "HTTP/1.1 206 Partial Content\n"
+      "Content-Range: bytes0-50/100\n",
+      false, 0, 0, 0
+    },
+  };
+  for (size_t i = 0; i < ARRAYSIZE_UNSAFE(tests); ++i) {
+    string headers(tests[i].headers);
+    HeadersToRaw(&headers);
+    scoped_refptr<HttpResponseHeaders> parsed =
+        new HttpResponseHeaders(headers);
+
+    int64 first = 0, last = 0, length = 0;
+    EXPECT_EQ(tests[i].expected_return_value,
+              parsed->GetContentRange(&first, &last, &length));
+    if (tests[i].expected_return_value) {
+      EXPECT_EQ(tests[i].expected_first_byte_position, first);
+      EXPECT_EQ(tests[i].expected_last_byte_position, last);
+      EXPECT_EQ(tests[i].expected_instance_length, length);
+    }
+  }
+}
+
 TEST(HttpResponseHeadersTest, IsKeepAlive) {
   const struct {
     const char* headers;
@@ -1091,3 +1157,40 @@ TEST(HttpResponseHeadersTest, GetStatusBadStatusLine) {
   // HTTP/1.0 200 OK.
   EXPECT_EQ(std::string("OK"), parsed->GetStatusText());
 }
+
+// Parsing the headers straight from the network buffer should give the same
+// result as assembling them first.
+TEST(HttpResponseHeadersTest, ParseFromNetworkBuffer) {
+  const char* tests[] = {
+    "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\n",
+    "HTTP/1.1 200 OK\nContent-Type: text/html\n\n",
+    "  \nHTTP/1.0 301 Moved\r\nLocation: http://a/\r\n\r\n",
+    "HTTP/1.1 200 OK\r\nFoo: 1\r\n  2\r\n\t3\r\nBar: 4\r\n\r\n",
+    "HTTP/1.1 200 OK\r\n  Foo: 1\r\n\r\n",
+    "HTTP/1.1 200 OK\r\n: empty\r\nFoo:\r\n\r\n",
+    "HTTP/0.9 200 OK\r\n\r\n",
+    "HTTP/0.9 200 OK\r\nFoo: 1\r\n\r\n",
+    "HTTP/1.1 404",
+    "garbage\r\nFoo: 1\r\n\r\n",
+    "",
+  };
+  for (size_t i = 0; i < arraysize(tests); ++i) {
+    const char* buf = tests[i];
+    int buf_len = static_cast<int>(strlen(buf));
+    scoped_refptr<HttpResponseHeaders> expected =
+        new HttpResponseHeaders(net::HttpUtil::AssembleRawHeaders(buf,
+                                                                  buf_len));
+    scoped_refptr<HttpResponseHeaders> parsed =
+        new HttpResponseHeaders(buf, buf_len);
+
+    EXPECT_EQ(expected->raw_headers(), parsed->raw_headers()) << i;
+    EXPECT_EQ(expected->response_code(), parsed->response_code()) << i;
+    EXPECT_TRUE(expected->GetParsedHttpVersion() ==
+                parsed->GetParsedHttpVersion()) << i;
+
+    std::string expected_headers, headers;
+    expected->GetNormalizedHeaders(&expected_headers);
+    parsed->GetNormalizedHeaders(&headers);
+    EXPECT_EQ(expected_headers, headers) << i;
+  }
+}
@@ -383,15 +383,7 @@ static bool IsLineSegmentContinuable(const char* begin, const char* end) {
   return true;
 }
 
-// Helper used by AssembleRawHeaders, to find the end of the status line.
-static const char* FindStatusLineEnd(const char* begin, const char* end) {
-  size_t i = StringPiece(begin, end - begin).find_first_of("\r\n");
-  if (i == StringPiece::npos)
-    return end;
-  return begin + i;
-}
-
-// Helper used by AssembleRawHeaders, to skip past leading LWS.
+// Helper used by AppendHeaderLines, to skip past leading LWS.
 static const char* FindFirstNonLWS(const char* begin, const char* end) {
   for (const char* cur = begin; cur != end; ++cur) {
     if (!HttpUtil::IsLWS(*cur))
@@ -416,13 +408,22 @@ std::string HttpUtil::AssembleRawHeaders(const char* input_begin,
   // Copy the status line.
   const char* status_line_end = FindStatusLineEnd(input_begin, input_end);
   raw_headers.append(input_begin, status_line_end);
+  raw_headers.push_back('\0');
+
+  AppendHeaderLines(status_line_end, input_end, &raw_headers);
+
+  raw_headers.push_back('\0');
+  return raw_headers;
+}
 
-  // After the status line, every subsequent line is a header line segment.
-  // Should a segment start with LWS, it is a continuation of the previous
-  // line's field-value.
+// static
+void HttpUtil::AppendHeaderLines(const char* begin, const char* end,
+                                 std::string* output) {
+  // Every line is a header line segment.  Should a segment start with LWS, it
+  // is a continuation of the previous line's field-value.
 
   // TODO(ericroman): is this too permissive? (delimits on [\r\n]+)
-  CStringTokenizer lines(status_line_end, input_end, "\r\n");
+  CStringTokenizer lines(begin, end, "\r\n");
 
   // This variable is true when the previous line was continuable.
   bool prev_line_continuable = false;
@@ -430,25 +431,29 @@ std::string HttpUtil::AssembleRawHeaders(const char* input_begin,
   while (lines.GetNext()) {
     const char* line_begin = lines.token_begin();
     const char* line_end = lines.token_end();
-     
+
     if (prev_line_continuable && IsLWS(*line_begin)) {
-      // Join continuation; reduce the leading LWS to a single SP.
-      raw_headers.push_back(' ');
-      raw_headers.append(FindFirstNonLWS(line_begin, line_end), line_end);
+      // Join continuation; reduce the leading LWS to a single SP, in place of
+      // the terminator of the previous line.
+      (*output)[output->size() - 1] = ' ';
+      output->append(FindFirstNonLWS(line_begin, line_end), line_end);
     } else {
-      // Terminate the previous line.
-      raw_headers.push_back('\0');
-
       // Copy the raw data to output.
-      raw_headers.append(line_begin, line_end);
+      output->append(line_begin, line_end);
 
       // Check if the current line can be continued.
       prev_line_continuable = IsLineSegmentContinuable(line_begin, line_end);
     }
+    output->push_back('\0');
   }
+}
 
-  raw_headers.append("\0\0", 2);
-  return raw_headers;
+// static
+const char* HttpUtil::FindStatusLineEnd(const char* begin, const char* end) {
+  size_t i = StringPiece(begin, end - begin).find_first_of("\r\n");
+  if (i == StringPiece::npos)
+    return end;
+  return begin + i;
 }
 
 // BNF from section 4.2 of RFC 2616:
@@ -102,6 +102,16 @@ class HttpUtil {
   // the end-of-headers marker as defined by LocateEndOfHeaders.
   static std::string AssembleRawHeaders(const char* buf, int buf_len);
 
+  // Appends the header lines found in [begin, end) to |output|, in the format
+  // produced by AssembleRawHeaders: each line is terminated by \0 and
+  // continuation lines are joined to the line they continue.  Empty lines are
+  // skipped.
+  static void AppendHeaderLines(const char* begin, const char* end,
+                                std::string* output);
+
+  // Returns a pointer to the first CR or LF in [begin, end), or |end|.
+  static const char* FindStatusLineEnd(const char* begin, const char* end);
+
   // Used to iterate over the name/value pairs of HTTP headers.  To iterate
   // over the values in a multi-value header, use ValuesIterator.
   // See AssembleRawHeaders for joining line continuations (this iterator
@@ -0,0 +1,232 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/partial_data.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/string_util.h"
+#include "net/disk_cache/disk_cache.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_util.h"
+
+namespace {
+
+// Returns new headers with the given |status_line|, the header lines of
+// |headers| minus Content-Length and Content-Range, and |extra_lines| (each
+// one terminated by "\n").
+net::HttpResponseHeaders* RebuildHeaders(
+    const std::string& status_line,
+    const net::HttpResponseHeaders* headers,
+    const std::string& extra_lines) {
+  std::string raw_headers(status_line);
+  raw_headers.push_back('\0');
+
+  void* iter = NULL;
+  std::string name, value;
+  while (headers->EnumerateHeaderLines(&iter, &name, &value)) {
+    if (LowerCaseEqualsASCII(name, "content-length") ||
+        LowerCaseEqualsASCII(name, "content-range"))
+      continue;
+    raw_headers.append(name + ": " + value);
+    raw_headers.push_back('\0');
+  }
+
+  std::string lines(extra_lines);
+  std::replace(lines.begin(), lines.end(), '\n', '\0');
+  raw_headers.append(lines);
+  raw_headers.push_back('\0');
+  return new net::HttpResponseHeaders(raw_headers);
+}
+
+}  // namespace
+
+namespace net {
+
+PartialData::PartialData()
+    : range_start_(0),
+      range_end_(kint64max),
+      resource_length_(-1),
+      current_offset_(0),
+      piece_end_(kint64max),
+      piece_cached_(false),
+      whole_resource_(false) {
+}
+
+PartialData::~PartialData() {
+}
+
+bool PartialData::Init(const std::string& headers) {
+  std::string range;
+  bool found = false;
+  extra_headers_.clear();
+  HttpUtil::HeadersIterator it(headers.begin(), headers.end(), "\r\n");
+  while (it.GetNext()) {
+    if (!LowerCaseEqualsASCII(it.name_begin(), it.name_end(), "range")) {
+      extra_headers_.append(it.name_begin(), it.values_end());
+      extra_headers_.append("\r\n");
+      continue;
+    }
+    if (found)
+      return false;
+    found = true;
+    range = it.values();
+  }
+  if (!found)
+    return false;
+
+  // Expect "bytes=first-" or "bytes=first-last".
+  size_t equals = range.find('=');
+  if (equals == std::string::npos)
+    return false;
+
+  std::string unit, spec;
+  TrimWhitespace(range.substr(0, equals), TRIM_ALL, &unit);
+  TrimWhitespace(range.substr(equals + 1), TRIM_ALL, &spec);
+  if (!LowerCaseEqualsASCII(unit, "bytes") ||
+      spec.find(',') != std::string::npos)
+    return false;
+
+  size_t dash = spec.find('-');
+  if (dash == std::string::npos || !dash)
+    return false;  // A suffix range needs the length of the resource.
+
+  std::string first, last;
+  TrimWhitespace(spec.substr(0, dash), TRIM_ALL, &first);
+  TrimWhitespace(spec.substr(dash + 1), TRIM_ALL, &last);
+  if (!StringToInt64(first, &range_start_) || range_start_ < 0)
+    return false;
+
+  range_end_ = kint64max;
+  if (!last.empty() &&
+      (!StringToInt64(last, &range_end_) || range_end_ < range_start_))
+    return false;
+
+  current_offset_ = range_start_;
+  piece_end_ = range_end_;
+  return true;
+}
+
+void PartialData::InitWholeResource(const std::string& headers) {
+  extra_headers_ = headers;
+  whole_resource_ = true;
+  range_start_ = current_offset_ = 0;
+  range_end_ = piece_end_ = kint64max;
+}
+
+bool PartialData::SetResourceLength(int64 length) {
+  DCHECK(length >= 0);
+  resource_length_ = length;
+  if (range_start_ >= length && !(whole_resource_ && !length))
+    return false;
+
+  range_end_ = std::min(range_end_, length - 1);
+  piece_end_ = std::min(piece_end_, range_end_);
+  return true;
+}
+
+void PartialData::PrepareNextPiece(disk_cache::Entry* entry, bool sparse) {
+  DCHECK(resource_length_ >= 0);
+  if (!sparse) {
+    // The whole resource is stored.
+    piece_cached_ = true;
+    piece_end_ = range_end_;
+    return;
+  }
+
+  int len = static_cast<int>(
+      std::min(range_end_ - current_offset_ + 1,
+               static_cast<int64>(kint32max)));
+  int64 start;
+  int rv = entry->GetAvailableRange(current_offset_, len, &start);
+  if (rv <= 0) {
+    // Nothing else is stored.
+    piece_cached_ = false;
+    piece_end_ = range_end_;
+  } else if (start == current_offset_) {
+    piece_cached_ = true;
+    piece_end_ = start + rv - 1;
+  } else {
+    // Fetch the hole up to the next stored byte.
+    piece_cached_ = false;
+    piece_end_ = start - 1;
+  }
+}
+
+void PartialData::AddPieceHeaders(const std::string& validator,
+                                  std::string* headers) const {
+  headers->append("Range: bytes=" + Int64ToString(current_offset_) + "-");
+  if (piece_end_ != kint64max)
+    headers->append(Int64ToString(piece_end_));
+  headers->append("\r\n");
+
+  if (!validator.empty())
+    headers->append("If-Range: " + validator + "\r\n");
+}
+
+bool PartialData::ValidatePieceResponse(const HttpResponseHeaders* headers) {
+  if (headers->response_code() != 206)
+    return false;
+
+  int64 first, last, length;
+  if (!headers->GetContentRange(&first, &last, &length) || length < 0)
+    return false;
+
+  if (resource_length_ >= 0) {
+    if (length != resource_length_)
+      return false;
+  } else if (!SetResourceLength(length)) {
+    return false;
+  }
+
+  return first == current_offset_ && last == piece_end_;
+}
+
+int PartialData::PieceBytesToRead(int buf_len) const {
+  DCHECK(!IsPieceDone());
+  int64 remaining = piece_end_ - current_offset_ + 1;
+  return static_cast<int>(std::min(static_cast<int64>(buf_len), remaining));
+}
+
+bool PartialData::IsDone() const {
+  return current_offset_ > range_end_;
+}
+
+HttpResponseHeaders* PartialData::CreateClientHeaders(
+    const HttpResponseHeaders* headers) const {
+  DCHECK(resource_length_ >= 0);
+  if (whole_resource_) {
+    return RebuildHeaders(headers->GetStatusLine(), headers,
+        "Content-Length: " + Int64ToString(resource_length_) + "\n");
+  }
+
+  std::string lines = "Content-Range: bytes " + Int64ToString(range_start_) +
+                      "-" + Int64ToString(range_end_) + "/" +
+                      Int64ToString(resource_length_) + "\n";
+  lines.append("Content-Length: " +
+               Int64ToString(range_end_ - range_start_ + 1) + "\n");
+  return RebuildHeaders("HTTP/1.1 206 Partial Content", headers, lines);
+}
+
+HttpResponseHeaders* PartialData::CreateStoredHeaders(
+    const HttpResponseHeaders* headers) const {
+  DCHECK(resource_length_ >= 0);
+  return RebuildHeaders("HTTP/1.1 200 OK", headers,
+      "Content-Length: " + Int64ToString(resource_length_) + "\n");
+}
+
+// static
+std::string PartialData::GetValidator(const HttpResponseHeaders* headers) {
+  std::string etag;
+  if (headers->EnumerateHeader(NULL, "etag", &etag) && !etag.empty() &&
+      !StartsWithASCII(etag, "W/", true))
+    return etag;
+
+  std::string last_modified;
+  headers->EnumerateHeader(NULL, "last-modified", &last_modified);
+  return last_modified;
+}
+
+}  // namespace net
@@ -0,0 +1,113 @@
+// Copyright (c) 2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_HTTP_PARTIAL_DATA_H_
+#define NET_HTTP_PARTIAL_DATA_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+
+namespace disk_cache {
+class Entry;
+}
+
+namespace net {
+
+class HttpResponseHeaders;
+
+// This class keeps track of a byte range request served by the HttpCache.
+//
+// The response body of a resource that was fetched by range requests is
+// stored as the sparse data of the cache entry, along with headers that
+// describe the whole resource (a 200 response with the full Content-Length).
+// A request is served piece by piece: each piece is a run of bytes that is
+// either stored by the entry or missing from it, in which case it is fetched
+// from the network with a range request of its own.
+class PartialData {
+ public:
+  PartialData();
+  ~PartialData();
+
+  // Looks for a single "bytes=first-[last]" range in the extra request
+  // |headers|.  Returns false if there is no Range header, or if it asks for
+  // something that cannot be served from the cache (several ranges, or a
+  // suffix range), in which case the request should not use the cache.
+  bool Init(const std::string& headers);
+
+  // Sets up this object to serve the whole resource, for a request without a
+  // Range header that finds a sparse entry.
+  void InitWholeResource(const std::string& headers);
+
+  // The extra request headers, without the Range header.
+  const std::string& extra_headers() const { return extra_headers_; }
+
+  // Sets the length of the whole resource, which resolves the end of the
+  // requested range.  Returns false if the range cannot be satisfied.
+  bool SetResourceLength(int64 length);
+
+  // Finds out how the piece that starts at the current offset has to be
+  // served: from the data stored by |entry| or from the network.  |sparse|
+  // tells if the response body is stored as sparse data.
+  void PrepareNextPiece(disk_cache::Entry* entry, bool sparse);
+
+  // True if the current piece is stored by the cache entry.
+  bool piece_cached() const { return piece_cached_; }
+
+  int64 current_offset() const { return current_offset_; }
+
+  // Appends to |headers| the Range header that fetches the current piece from
+  // the network.  If |validator| is not empty, it is sent as If-Range, so the
+  // server replies with the whole resource if it has changed.
+  void AddPieceHeaders(const std::string& validator,
+                       std::string* headers) const;
+
+  // Returns true if |headers| are those of a 206 response for the current
+  // piece.  The length of the resource is learned from the response if it was
+  // not known yet.
+  bool ValidatePieceResponse(const HttpResponseHeaders* headers);
+
+  // Returns the number of bytes of a |buf_len| bytes read that belong to the
+  // current piece.
+  int PieceBytesToRead(int buf_len) const;
+
+  // Records that |bytes| of the current piece were given to the user.
+  void OnDataRead(int bytes) { current_offset_ += bytes; }
+
+  bool IsPieceDone() const { return current_offset_ > piece_end_; }
+  bool IsLastPiece() const { return piece_end_ >= range_end_; }
+  bool IsDone() const;
+
+  // Returns the headers that the user gets for the requested range, given the
+  // stored |headers| of the whole resource.
+  HttpResponseHeaders* CreateClientHeaders(
+      const HttpResponseHeaders* headers) const;
+
+  // Returns the headers to store for the whole resource, given the |headers|
+  // of a 206 response for a piece of it.
+  HttpResponseHeaders* CreateStoredHeaders(
+      const HttpResponseHeaders* headers) const;
+
+  // Returns the value to send as If-Range for the resource described by
+  // |headers|: a strong ETag or the Last-Modified date.  Returns an empty
+  // string if there is none, in which case the resource is not stored as
+  // sparse data.
+  static std::string GetValidator(const HttpResponseHeaders* headers);
+
+ private:
+  std::string extra_headers_;
+  int64 range_start_;
+  int64 range_end_;  // Inclusive, kint64max until the length is known.
+  int64 resource_length_;  // -1 if unknown.
+  int64 current_offset_;
+  int64 piece_end_;  // The last byte of the current piece.
+  bool piece_cached_;
+  bool whole_resource_;  // The user didn't ask for a range.
+
+  DISALLOW_COPY_AND_ASSIGN(PartialData);
+};
+
+}  // namespace net
+
+#endif  // NET_HTTP_PARTIAL_DATA_H_
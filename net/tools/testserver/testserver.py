@@ -99,6 +99,7 @@ class TestPageHandler(BaseHTTPServer.BaseHTTPRequestHandler):
       self.ClientRedirectHandler,
       self.DefaultResponseHandler]
     self._post_handlers = [
+      self.SinkHandler,
       self.EchoTitleHandler,
       self.EchoAllHandler,
       self.EchoHandler] + self._get_handlers
@@ -387,6 +388,27 @@ class TestPageHandler(BaseHTTPServer.BaseHTTPRequestHandler):
     self.wfile.write(request)
     return True
 
+  def SinkHandler(self):
+    """This handler reads and discards the payload of the request, and returns
+    its length, for timing large uploads."""
+
+    if self.path.find("/sink") != 0:
+      return False
+
+    length = int(self.headers.getheader('content-length'))
+    remaining = length
+    while remaining > 0:
+      data = self.rfile.read(min(remaining, 64 * 1024))
+      if not data:
+        break
+      remaining -= len(data)
+
+    self.send_response(200)
+    self.send_header('Content-type', 'text/plain')
+    self.end_headers()
+    self.wfile.write(str(length - remaining))
+    return True
+
   def EchoTitleHandler(self):
     """This handler is like Echo, but sets the page title to the request."""
 
@@ -10,6 +10,7 @@
 #include "base/message_loop.h"
 #include "base/string_util.h"
 #include "net/base/cookie_monster.h"
+#include "net/base/filter.h"
 #include "net/base/load_flags.h"
 #include "net/base/net_errors.h"
 #include "net/base/net_util.h"
@@ -557,7 +558,8 @@ void URLRequestHttpJob::AddExtraHeaders() {
   if (!SdchManager::Global() ||
       !SdchManager::Global()->IsInSupportedDomain(request_->url())) {
     // Tell the server what compression formats we support (other than SDCH).
-    request_info_.extra_headers += "Accept-Encoding: gzip,deflate,bzip2\r\n";
+    request_info_.extra_headers += "Accept-Encoding: " +
+        Filter::GetAcceptEncodings() + "\r\n";
     return;
   }
 
@@ -582,7 +584,8 @@ void URLRequestHttpJob::AddExtraHeaders() {
   request_info_.extra_headers += "\r\n";
 
   // Tell the server what compression formats we support.
-  request_info_.extra_headers += "Accept-Encoding: gzip,deflate,bzip2,sdch\r\n";
+  request_info_.extra_headers += "Accept-Encoding: " +
+      Filter::GetAcceptEncodings() + ",sdch\r\n";
 }
 
 void URLRequestHttpJob::FetchResponseCookies() {
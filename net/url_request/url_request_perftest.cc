@@ -0,0 +1,84 @@
+// Copyright (c) 2006-2008 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/file_util.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "base/process_util.h"
+#include "base/scoped_ptr.h"
+#include "base/string_util.h"
+#include "base/sys_info.h"
+#include "net/url_request/url_request.h"
+#include "net/url_request/url_request_unittest.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+const int kMegabyte = 1024 * 1024;
+const int kUploadSizeInMegabytes = 1024;
+
+// Writes a file of |size_in_megabytes| MB to a temporary path.
+bool CreateUploadFile(int size_in_megabytes, std::wstring* path) {
+  if (!file_util::CreateTemporaryFileName(path))
+    return false;
+  FILE* file = file_util::OpenFile(*path, "wb");
+  if (!file)
+    return false;
+  std::string chunk(kMegabyte, 'u');
+  bool ok = true;
+  for (int i = 0; i < size_in_megabytes && ok; ++i)
+    ok = fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+  file_util::CloseFile(file);
+  return ok;
+}
+
+}  // namespace
+
+// Uploads a 1 GB file to the test server, which discards it, and reports how
+// much CPU time the browser side spent on each MB.
+TEST(URLRequestPerfTest, UploadLargeFile) {
+  MessageLoopForIO message_loop;
+  TestServer server(L"net/data");
+
+  std::wstring path;
+  ASSERT_TRUE(CreateUploadFile(kUploadSizeInMegabytes, &path));
+
+  scoped_ptr<process_util::ProcessMetrics> metrics(
+      process_util::ProcessMetrics::CreateProcessMetrics(
+          process_util::GetCurrentProcessHandle()));
+  // The first call only records the starting point.
+  metrics->GetCPUUsage();
+
+  TestDelegate d;
+  PerfTimer timer;
+  {
+    URLRequest r(server.TestServerPage("sink"), &d);
+    r.set_context(new TestURLRequestContext());
+    r.set_method("POST");
+    r.AppendFileToUpload(path);
+
+    r.Start();
+    EXPECT_TRUE(r.is_pending());
+
+    MessageLoop::current()->Run();
+  }
+  double elapsed_ms = timer.Elapsed().InMillisecondsF();
+  int cpu_usage = metrics->GetCPUUsage();
+
+  file_util::Delete(path, false);
+
+  ASSERT_EQ(1, d.response_started_count());
+  EXPECT_EQ(Int64ToString(static_cast<int64>(kUploadSizeInMegabytes) *
+                          kMegabyte),
+            d.data_received());
+
+  // GetCPUUsage() is a percentage of all the processors.
+  double cpu_ms =
+      elapsed_ms * cpu_usage * base::SysInfo::NumberOfProcessors() / 100;
+  LogPerfResult("URLRequest_upload_1GB_file", elapsed_ms, "ms");
+  LogPerfResult("URLRequest_upload_cpu_per_MB",
+                cpu_ms / kUploadSizeInMegabytes, "ms");
+}